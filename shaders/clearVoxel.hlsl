@@ -9,10 +9,10 @@ struct Resources
 
 ConstantBuffer<Resources> g_Resources : register(b6);
 
+// one thread group per brick in the brick pool
 [numthreads(8,8,8)]
-void main(uint3 ThreadID : SV_DispatchThreadID)
+void main(uint3 groupID : SV_GroupID, uint groupIndex : SV_GroupIndex)
 {
     RWStructuredBuffer<Voxel> voxels = ResourceDescriptorHeap[g_Resources.VoxelIndex];
-    voxels[Flatten(ThreadID, VOXEL_DIMENSION)].Radiance = 0;
-    voxels[Flatten(ThreadID, VOXEL_DIMENSION)].Normal = 0;
+    ClearVoxel(voxels, groupID.x * VOXELS_PER_BRICK + groupIndex);
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+struct Resources
+{
+    uint TexIndex;
+    uint Dimension;
+};
+
+ConstantBuffer<Resources> g_Resources : register(b6);
+
+[numthreads(8, 8, 8)]
+void main(uint3 texCoord : SV_DispatchThreadID)
+{
+    RWTexture3D<float4> tex = ResourceDescriptorHeap[g_Resources.TexIndex];
+
+    if (all(texCoord < g_Resources.Dimension))
+        tex[texCoord] = 0;
+}
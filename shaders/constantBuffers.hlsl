@@ -2,6 +2,7 @@
 #define __CONSTANT_BUFFERS_HLSL__
 
 #include "structs.hlsl"
+#include "constants.hlsl"
 
 cbuffer ObjectCB : register(b0)
 {
@@ -31,6 +32,14 @@ cbuffer PassCB : register(b1)
     float2 g_PreviousJitter;
     bool g_EnableGI;
     bool g_EnableIBL;
+    float2 _Pad2;
+    float4 g_IrradianceSH[9]; // L2 spherical harmonics of the diffuse irradiance, rgb
+    float4 g_ClipmapLevels[VOXEL_CLIPMAP_MAX_LEVELS]; // xyz: world position of the window's min corner, w: voxel size
+    uint4 g_ClipmapTexIndices[VOXEL_CLIPMAP_MAX_LEVELS / 4];
+    uint g_ClipmapLevelCount;
+    uint g_ClipmapResolution;
+    bool g_UseClipmap;
+    float _Pad3;
 };
 
 cbuffer MatCB : register(b2)
@@ -10,6 +10,19 @@ static const float VOXEL_GRID_SIZE = 0.1;
 static const float3 VOXEL_GRID_WORLD_POS = 0;
 static const float VOXEL_COMPRESS_COLOR_RANGE = 10.0;
 
+// the voxel grid is stored sparsely in bricks of 8^3 voxels, see VoxelBricks.h
+static const uint VOXEL_BRICK_SIZE = 8;
+static const uint VOXEL_BRICK_DIMENSION = VOXEL_DIMENSION / VOXEL_BRICK_SIZE;
+static const uint VOXELS_PER_BRICK = VOXEL_BRICK_SIZE * VOXEL_BRICK_SIZE * VOXEL_BRICK_SIZE;
+static const uint INVALID_BRICK = 0xFFFFFFFF;
+
+// camera centred clipmap levels, see VoxelClipmap.h
+#define VOXEL_CLIPMAP_MAX_LEVELS 8
+
+// 1: one 64-bit word per voxel (shared exponent radiance, octahedral normal, coverage),
+// 0: two 64-bit fixed point sums. Mirrors VOXEL_COMPACT_PACKING in VoxelPacking.h
+#define VOXEL_COMPACT_PACKING 1
+
 static const float PI = 3.141592653589793;
 static const float TWO_PI = 2 * PI;
 static const float Epsilon = 0.00001;
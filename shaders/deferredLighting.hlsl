@@ -3,6 +3,7 @@
 #include "samplers.hlsl"
 #include "cascadedShadow.hlsl"
 #include "voxelUtils.hlsl"
+#include "voxelClipmap.hlsl"
 
 struct Resources
 {
@@ -14,7 +15,6 @@ struct Resources
 	uint DepthTexIndex;
 	uint ShadowMapTexIndex;
     uint VoxelTexIndex;
-    uint IrradianceMapIndex;
     uint SpecularMapIndex;
     uint BRDFLUTIndex;
 };
@@ -137,7 +137,11 @@ float4 PS(VertexOut pin) : SV_Target
     {
         Texture3D voxels = ResourceDescriptorHeap[g_Resources.VoxelTexIndex];
     
-        float4 diffuseIndirectColor = TraceDiffuseCone(voxels, g_SamplerLinearClamp, positionW, normalW);
+        float4 diffuseIndirectColor;
+        if (g_UseClipmap)
+            diffuseIndirectColor = TraceClipmapDiffuseCone(positionW, normalW);
+        else
+            diffuseIndirectColor = TraceDiffuseCone(voxels, g_SamplerLinearClamp, positionW, normalW);
         // float4 specularIndirectColor = TraceSpecularCone(voxels, g_SamplerLinearClamp, positionW, normalW, V, roughness);
         
         ambient += diffuseIndirectColor.rgb;
@@ -146,7 +150,6 @@ float4 PS(VertexOut pin) : SV_Target
 
     if (g_EnableIBL)
     {
-        TextureCube irradianceTexture = ResourceDescriptorHeap[g_Resources.IrradianceMapIndex];
         TextureCube specularTexture = ResourceDescriptorHeap[g_Resources.SpecularMapIndex];
         Texture2D specularBRDFLUT = ResourceDescriptorHeap[g_Resources.BRDFLUTIndex];
 
@@ -160,7 +163,7 @@ float4 PS(VertexOut pin) : SV_Target
         float3 F0 = lerp(Fdielectric, albedo, metalness);
             
         // Ambient lighting (IBL).
-        float3 irradiance = irradianceTexture.Sample(g_SamplerAnisotropicWrap, normalW).rgb;
+        float3 irradiance = EvaluateSH9(g_IrradianceSH, normalW);
                 
         // Calculate Fresnel term for ambient lighting.
         // Since we use pre-filtered cubemap(s) and irradiance is coming from many directions
@@ -171,7 +174,7 @@ float4 PS(VertexOut pin) : SV_Target
         // Get diffuse contribution factor (as with direct lighting).
         float3 kd = lerp(1.0 - F, 0.0, metalness);
 
-        // Irradiance map contains exitant radiance assuming Lambertian BRDF, no need to scale by 1/PI here either.
+        // Irradiance SH is pre-scaled to exitant radiance assuming Lambertian BRDF, no need to scale by 1/PI here either.
         float3 diffuseIBL = kd * albedo * irradiance;
 
         // Sample pre-filtered specular reflection environment at correct mipmap level.
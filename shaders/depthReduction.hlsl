@@ -0,0 +1,61 @@
+struct Resources
+{
+    uint DepthTexIndex;
+    uint ResultIndex; // min and max view depth as float bits
+    uint Width;
+    uint Height;
+    float ProjA; // g_Proj[2][2]
+    float ProjB; // g_Proj[3][2]
+};
+
+ConstantBuffer<Resources> g_Resources : register(b6);
+
+groupshared uint s_MinDepth;
+groupshared uint s_MaxDepth;
+
+// the view depths are positive, so their float bits order like the values and the
+// min and max can be taken with integer atomics
+[numthreads(16, 16, 1)]
+void main(uint3 dispatchID : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    if (groupIndex == 0)
+    {
+        s_MinDepth = asuint(3.402823466e+38f);
+        s_MaxDepth = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    uint minDepth = asuint(3.402823466e+38f);
+    uint maxDepth = 0;
+
+    if (all(dispatchID.xy < uint2(g_Resources.Width, g_Resources.Height)))
+    {
+        Texture2D depthTex = ResourceDescriptorHeap[g_Resources.DepthTexIndex];
+        float depth = depthTex.Load(int3(dispatchID.xy, 0)).r;
+
+        // the sky stays at the far plane
+        if (depth < 1.0f)
+        {
+            float viewDepth = g_Resources.ProjB / (depth - g_Resources.ProjA);
+            minDepth = asuint(viewDepth);
+            maxDepth = asuint(viewDepth);
+        }
+    }
+
+    minDepth = WaveActiveMin(minDepth);
+    maxDepth = WaveActiveMax(maxDepth);
+
+    if (WaveIsFirstLane())
+    {
+        InterlockedMin(s_MinDepth, minDepth);
+        InterlockedMax(s_MaxDepth, maxDepth);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (groupIndex == 0 && s_MaxDepth > 0)
+    {
+        RWByteAddressBuffer result = ResourceDescriptorHeap[g_Resources.ResultIndex];
+        result.InterlockedMin(0, s_MinDepth);
+        result.InterlockedMax(4, s_MaxDepth);
+    }
+}
@@ -110,4 +110,23 @@ float3 DoSpotLight(Light light, float3 albedo, float3 normal, float metalness, f
     return DoDirectLighting(light, albedo, normal, metalness, roughness, L, V) * attenuation * spotIntensity * light.Intensity;
 }
 
+// Evaluates L2 spherical harmonics in direction n (normalized).
+// See "An Efficient Representation for Irradiance Environment Maps", the basis matches SphericalHarmonics.cpp.
+float3 EvaluateSH9(float4 sh[9], float3 n)
+{
+    float3 result = sh[0].rgb * 0.282095;
+
+    result += sh[1].rgb * 0.488603 * n.y;
+    result += sh[2].rgb * 0.488603 * n.z;
+    result += sh[3].rgb * 0.488603 * n.x;
+
+    result += sh[4].rgb * 1.092548 * n.x * n.y;
+    result += sh[5].rgb * 1.092548 * n.y * n.z;
+    result += sh[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0);
+    result += sh[7].rgb * 1.092548 * n.x * n.z;
+    result += sh[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+
+    return max(result, 0.0);
+}
+
 #endif // __LIGHTING_UTILS_HLSL__
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef __STRUCTS_HLSL__
 #define __STRUCTS_HLSL__
 
+#include "constants.hlsl"
+
 struct Material
 {
     float4 AmbientColor;
@@ -57,10 +59,15 @@ struct ShadowData
     int NumSamples;
 };
 
+// accessed through ClearVoxel, AccumulateVoxel and LoadVoxel in voxelUtils.hlsl
 struct Voxel
 {
+#if VOXEL_COMPACT_PACKING
+    uint64_t Packed;
+#else
     uint64_t Radiance;
     uint64_t Normal;
+#endif
 };
 
 #endif // __STRUCTS_HLSL__
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "structs.hlsl"
+#include "constants.hlsl"
+#include "voxelUtils.hlsl"
+
+struct Resources
+{
+    uint VoxelIndex;
+    uint UpdateListIndex;
+    uint UpdateMaskIndex;
+    uint UpdateStamp;
+};
+
+ConstantBuffer<Resources> g_Resources : register(b6);
+
+// one thread group per updated brick, clears it in the brick pool
+// and stamps it so the voxelizer writes to it
+[numthreads(8, 8, 8)]
+void main(uint3 groupID : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    RWStructuredBuffer<Voxel> voxels = ResourceDescriptorHeap[g_Resources.VoxelIndex];
+    StructuredBuffer<uint> updateList = ResourceDescriptorHeap[g_Resources.UpdateListIndex];
+    RWStructuredBuffer<uint> updateMask = ResourceDescriptorHeap[g_Resources.UpdateMaskIndex];
+
+    uint slot = updateList[groupID.x];
+    ClearVoxel(voxels, slot * VOXELS_PER_BRICK + groupIndex);
+
+    if (groupIndex == 0)
+        updateMask[slot] = g_Resources.UpdateStamp;
+}
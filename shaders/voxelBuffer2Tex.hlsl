@@ -6,34 +6,32 @@ struct Resources
 {
     uint BufferIndex;
     uint TexIndex;
+    uint BrickListIndex;
+    uint UpdateListIndex;
 };
 
 ConstantBuffer<Resources> g_Resources : register(b6);
 
+// one thread group per updated brick, the update list holds its slot in the brick pool
 [numthreads(8, 8, 8)]
-void main(uint3 texCoord : SV_DispatchThreadID)
+void main(uint3 groupID : SV_GroupID, uint3 localCoord : SV_GroupThreadID)
 {
     RWStructuredBuffer<Voxel> buffer = ResourceDescriptorHeap[g_Resources.BufferIndex];
     RWTexture3D<float4> tex = ResourceDescriptorHeap[g_Resources.TexIndex];
+    StructuredBuffer<uint> brickList = ResourceDescriptorHeap[g_Resources.BrickListIndex];
+    StructuredBuffer<uint> updateList = ResourceDescriptorHeap[g_Resources.UpdateListIndex];
 
-    uint bufferIndex = Flatten(texCoord, VOXEL_DIMENSION);
-    float4 color = ConvUINT64ToFloat4(buffer[bufferIndex].Radiance);
-    
-    // reset buffer
-    // buffer[bufferIndex].Radiance = 0;
+    uint slot = updateList[groupID.x];
+    uint3 texCoord = UnpackBrick(brickList[slot]) * VOXEL_BRICK_SIZE + localCoord;
+    uint bufferIndex = slot * VOXELS_PER_BRICK + Flatten(localCoord, VOXEL_BRICK_SIZE);
 
-    if (color.a <= 0)
+    float4 color;
+    float3 normal;
+    if (!LoadVoxel(buffer, bufferIndex, color, normal))
     {
         tex[texCoord] = 0;
         return;
     }
-    
-    color.rgb /= 50.0;
-    color.a /= 255.0;
-
-    // avoid very bright spot when alpha is low
-    color.a = max(color.a, 1); 
-    color /= color.a;
 
     tex[texCoord] = color;
 
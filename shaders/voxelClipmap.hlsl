@@ -0,0 +1,103 @@
+#ifndef __VOXEL_CLIPMAP_HLSL__
+#define __VOXEL_CLIPMAP_HLSL__
+
+#include "constantBuffers.hlsl"
+#include "samplers.hlsl"
+#include "voxelUtils.hlsl"
+
+// finest level whose window contains the position with a one voxel border for filtering,
+// g_ClipmapLevelCount if none does
+uint ClipmapLevelForPosition(float3 position)
+{
+    for (uint level = 0; level < g_ClipmapLevelCount; level++)
+    {
+        float3 local = (position - g_ClipmapLevels[level].xyz) / g_ClipmapLevels[level].w;
+        if (all(local > 1.0f) && all(local < g_ClipmapResolution - 1.0f))
+            return level;
+    }
+
+    return g_ClipmapLevelCount;
+}
+
+float4 SampleClipmap(uint level, float3 position)
+{
+    Texture3D<float4> voxels = ResourceDescriptorHeap[NonUniformResourceIndex(g_ClipmapTexIndices[level / 4][level % 4])];
+
+    // the level texture is stored toroidally, the wrap sampler takes care of the modulo
+    float3 uvw = position / (g_ClipmapLevels[level].w * g_ClipmapResolution);
+    return voxels.SampleLevel(g_SamplerLinearWrap, uvw, 0);
+}
+
+float4 TraceClipmapCone(float3 pos, float3 N, float3 direction, float aperture)
+{
+    float4 color = 0.0;
+
+    float tanHalfAperture = tan(aperture / 2.0f);
+    float voxelSize = g_ClipmapLevels[0].w;
+
+    // offset along the normal direction to avoid sampling itself
+    float3 start = pos + 0.5f * voxelSize * sqrt(3) * N;
+    float distance = voxelSize;
+
+    // ray-marching along the direction
+    // color.a acts as occlusion, we stop when we reaches one
+    for (int i = 0; i < NUM_STEPS && color.a < 1.0f; ++i)
+    {
+        float3 position = start + distance * direction;
+        float diameter = max(voxelSize, 2.0f * tanHalfAperture * distance);
+
+        // the level is picked by the distance from the camera, or coarser
+        // when the cone has outgrown the voxels of that level
+        uint level = max(ClipmapLevelForPosition(position), (uint)log2(diameter / voxelSize));
+        if (level >= g_ClipmapLevelCount)
+            break;
+
+        float4 voxelColor = SampleClipmap(level, position);
+        if (voxelColor.a > 0)
+        {
+            // front-to-back alpha blending
+            float a = 1.0 - color.a;
+            color.rgb += a * voxelColor.rgb;
+            color.a += a * voxelColor.a;
+        }
+
+        distance += 0.5f * diameter;
+    }
+
+    return color;
+}
+
+float4 TraceClipmapDiffuseCone(float3 pos, float3 N)
+{
+    float3 S, T;
+    ComputeBasisVectors(N, S, T);
+
+    // same cone layout as TraceDiffuseCone
+    float aperture = PI / 3.0f;
+
+    float3 direction = N;
+    float4 color = TraceClipmapCone(pos, N, direction, aperture);
+
+    direction = 0.7071f * N + 0.7071f * T;
+    color += TraceClipmapCone(pos, N, direction, aperture);
+
+    direction = 0.7071f * N + 0.7071f * (0.309f * T + 0.951f * S);
+    color += TraceClipmapCone(pos, N, direction, aperture);
+
+    direction = 0.7071f * N + 0.7071f * (-0.809f * T + 0.588f * S);
+    color += TraceClipmapCone(pos, N, direction, aperture);
+
+    direction = 0.7071f * N - 0.7071f * (-0.809f * T - 0.588f * S);
+    color += TraceClipmapCone(pos, N, direction, aperture);
+
+    direction = 0.7071f * N - 0.7071f * (0.309f * T - 0.951f * S);
+    color += TraceClipmapCone(pos, N, direction, aperture);
+
+    color /= 6.0f;
+    color.rgb = max(0, color.rgb);
+    color.a = saturate(color.a);
+
+    return color;
+}
+
+#endif // __VOXEL_CLIPMAP_HLSL__
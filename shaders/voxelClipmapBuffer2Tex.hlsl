@@ -0,0 +1,42 @@
+#include "structs.hlsl"
+#include "constants.hlsl"
+#include "voxelUtils.hlsl"
+
+struct Resources
+{
+    uint BufferIndex;
+    uint TexIndex;
+    uint Resolution;
+    int RegionMinX;
+    int RegionMinY;
+    int RegionMinZ;
+    int RegionMaxX;
+    int RegionMaxY;
+    int RegionMaxZ;
+};
+
+ConstantBuffer<Resources> g_Resources : register(b6);
+
+// one thread per voxel of the revoxelized region of a clipmap level
+[numthreads(8, 8, 8)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+    RWStructuredBuffer<Voxel> buffer = ResourceDescriptorHeap[g_Resources.BufferIndex];
+    RWTexture3D<float4> tex = ResourceDescriptorHeap[g_Resources.TexIndex];
+
+    int3 voxel = int3(g_Resources.RegionMinX, g_Resources.RegionMinY, g_Resources.RegionMinZ) + int3(threadID);
+    if (any(voxel >= int3(g_Resources.RegionMaxX, g_Resources.RegionMaxY, g_Resources.RegionMaxZ)))
+        return;
+
+    uint3 texCoord = ClipmapVoxelToTexel(voxel, g_Resources.Resolution);
+    uint bufferIndex = Flatten(texCoord, g_Resources.Resolution);
+
+    float4 color;
+    float3 normal;
+    bool covered = LoadVoxel(buffer, bufferIndex, color, normal);
+
+    // reset buffer for the next region
+    ClearVoxel(buffer, bufferIndex);
+
+    tex[texCoord] = covered ? color : 0;
+}
@@ -1,17 +1,32 @@
+#include "structs.hlsl"
+#include "constants.hlsl"
+#include "voxelUtils.hlsl"
+
 struct Resources
 {
     uint PrevMipIndex;
     uint CurrMipIndex;
+    uint BrickListIndex;
+    uint BrickListOffset;
+    uint Dimension;
 };
 
 ConstantBuffer<Resources> g_Resources : register(b6);
 
+// one thread group per updated brick of the current mip level
 [numthreads(8, 8, 8)]
-void main(uint3 ThreadID : SV_DispatchThreadID)
+void main(uint3 groupID : SV_GroupID, uint3 localCoord : SV_GroupThreadID)
 {
     float4 gatherValue = 0.0;
     RWTexture3D<float4> prevMip = ResourceDescriptorHeap[g_Resources.PrevMipIndex];
     RWTexture3D<float4> currMip = ResourceDescriptorHeap[g_Resources.CurrMipIndex];
+    StructuredBuffer<uint> brickList = ResourceDescriptorHeap[g_Resources.BrickListIndex];
+
+    uint3 ThreadID = UnpackBrick(brickList[g_Resources.BrickListOffset + groupID.x]) * VOXEL_BRICK_SIZE + localCoord;
+
+    // the last levels are smaller than a brick
+    if (any(ThreadID >= g_Resources.Dimension))
+        return;
     
     [unroll]
     for (int i = 0; i < 2; i++)
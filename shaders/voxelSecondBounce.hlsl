@@ -9,20 +9,35 @@ struct Resources
     uint BufferIndex;
     uint InputTexIndex;
     uint OutputTexIndex;
+    uint BrickListIndex;
+    uint UpdateListIndex;
+    uint RevoxelizedCount;
+    float BlendFactor;
 };
 
 ConstantBuffer<Resources> g_Resources : register(b6);
 
+// one thread group per updated brick, the update list holds its slot in the brick pool.
+// The first RevoxelizedCount bricks were just revoxelized and are overwritten, the others
+// are a time slice of the static bricks and are blended with their previous value.
 [numthreads(8, 8, 8)]
-void main(uint3 texCoord : SV_DispatchThreadID)
+void main(uint3 groupID : SV_GroupID, uint3 localCoord : SV_GroupThreadID)
 {
     RWStructuredBuffer<Voxel> buffer = ResourceDescriptorHeap[g_Resources.BufferIndex];
     Texture3D<float4> input = ResourceDescriptorHeap[g_Resources.InputTexIndex];
     RWTexture3D<float4> output = ResourceDescriptorHeap[g_Resources.OutputTexIndex];
+    StructuredBuffer<uint> brickList = ResourceDescriptorHeap[g_Resources.BrickListIndex];
+    StructuredBuffer<uint> updateList = ResourceDescriptorHeap[g_Resources.UpdateListIndex];
 
-    uint bufferIndex = Flatten(texCoord, VOXEL_DIMENSION);
+    uint slot = updateList[groupID.x];
+    uint3 texCoord = UnpackBrick(brickList[slot]) * VOXEL_BRICK_SIZE + localCoord;
+    uint bufferIndex = slot * VOXELS_PER_BRICK + Flatten(localCoord, VOXEL_BRICK_SIZE);
 
-    if (buffer[bufferIndex].Normal == 0)
+    float blendFactor = groupID.x < g_Resources.RevoxelizedCount ? 1.0f : g_Resources.BlendFactor;
+
+    float4 radiance;
+    float3 normal;
+    if (!LoadVoxel(buffer, bufferIndex, radiance, normal))
     {
         output[texCoord] = 0;
     }
@@ -35,21 +50,14 @@ void main(uint3 texCoord : SV_DispatchThreadID)
         voxelCenter *= VOXEL_GRID_SIZE;
         voxelCenter += VOXEL_GRID_WORLD_POS;
 
-        float4 normals = ConvUINT64ToFloat4(buffer[bufferIndex].Normal);
-        float3 normal = normals.xyz / 50.0;
-        normal /= normals.w;
-        normal = normalize(normal);
-
         float4 color = TraceDiffuseCone(input, g_SamplerLinearClamp, voxelCenter, normal);
         color.a = 1;
 
         color += input[texCoord];
         color /= color.a;
 
-        output[texCoord] = color;
+        output[texCoord] = lerp(output[texCoord], color, blendFactor);
     }
 
-    // reset buffer
-    buffer[bufferIndex].Radiance = 0;
-    buffer[bufferIndex].Normal = 0;
+    // the buffer keeps the voxels for the next time slice, BeginUpdate clears revoxelized bricks
 }
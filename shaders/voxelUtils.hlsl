@@ -1,9 +1,16 @@
+#ifndef __VOXEL_UTILS_HLSL__
+#define __VOXEL_UTILS_HLSL__
+
 #include "constants.hlsl"
+#include "structs.hlsl"
 #include "utils.hlsl"
 
 #define VOXEL_OFFSET_CORRECTION_FACTOR 5
 #define NUM_STEPS 100
 
+// offsets into the voxel stats buffer, see VoxelStat in VXGI.h
+#define VOXEL_STAT_MISSING_BRICK_FRAGMENTS 0
+
 uint Flatten(uint3 texCoord, uint dim)
 {
     return texCoord.x * dim * dim + 
@@ -26,6 +33,31 @@ uint3 Unflatten(uint i, uint dim)
     return coord;
 }
 
+// same packing as BrickOccupancy::PackBrick
+uint3 UnpackBrick(uint packed)
+{
+    return uint3(packed & 0x3FF, (packed >> 10) & 0x3FF, (packed >> 20) & 0x3FF);
+}
+
+// slot of the brick containing the voxel in the brick pool, INVALID_BRICK if not allocated
+uint BrickPoolIndex(StructuredBuffer<uint> indirection, uint3 texCoord)
+{
+    return indirection[Flatten(texCoord / VOXEL_BRICK_SIZE, VOXEL_BRICK_DIMENSION)];
+}
+
+// world aligned voxel coordinate of a clipmap level, same as VoxelClipmap::WorldToVoxel
+int3 ClipmapWorldToVoxel(float3 position, float voxelSize)
+{
+    return int3(floor(position / voxelSize));
+}
+
+// toroidal addressing, voxel v lives at texel v mod resolution
+uint3 ClipmapVoxelToTexel(int3 voxel, uint resolution)
+{
+    int3 texel = voxel % (int)resolution;
+    return uint3(texel + (texel < 0) * (int)resolution);
+}
+
 // ref: https://xeolabs.com/pdfs/OpenGLInsights.pdf Chapter 22
 uint64_t ConvFloat4ToUINT64(float4 val)
 {
@@ -38,6 +70,7 @@ float4 ConvUINT64ToFloat4(uint64_t val)
     return clamp(re, float4(0.0, 0.0, 0.0, 0.0), float4(65535.0, 65535.0, 65535.0, 65535.0));
 }
 
+#if !VOXEL_COMPACT_PACKING
 void ImageAtomicUINT64Avg(RWStructuredBuffer<Voxel> voxels, uint index, float4 val)
 {
     val.rgb *= 65535.0f;
@@ -60,6 +93,165 @@ void ImageAtomicUINT64Avg(RWStructuredBuffer<Voxel> voxels, uint index, float4 v
         InterlockedCompareExchange(voxels[index].Radiance, prevStoredVal, newVal, curStoredVal);
     }
 }
+#endif
+
+// Compact voxel record, mirrored by VoxelPacking.h:
+//   bits  0-31 radiance, RGB9E5 (9 bit mantissas, 5 bit shared exponent)
+//   bits 32-51 normal, octahedral with 10 bits per axis
+//   bits 52-63 coverage, number of fragments averaged so far, saturating
+// Fragments are averaged in with a compare exchange loop, one 64-bit atomic per fragment.
+static const uint RGB9E5_MANTISSA_BITS = 9;
+static const int RGB9E5_EXP_BIAS = 15;
+static const float RGB9E5_MAX_VALUE = 65408.0; // (511 / 512) * 2^16
+static const uint VOXEL_MAX_COVERAGE = 4095;
+
+uint PackRGB9E5(float3 rgb)
+{
+    float3 color = clamp(rgb, 0, RGB9E5_MAX_VALUE);
+
+    // black would take the log of zero, any value below the smallest exponent encodes the same
+    float maxColor = max(max(color.r, color.g), max(color.b, 1.0e-20));
+
+    int exponent = max(-RGB9E5_EXP_BIAS - 1, (int)floor(log2(maxColor))) + 1 + RGB9E5_EXP_BIAS;
+    float denom = exp2(exponent - RGB9E5_EXP_BIAS - (int)RGB9E5_MANTISSA_BITS);
+
+    // rounding can carry the largest mantissa into the next exponent
+    if (floor(maxColor / denom + 0.5) == 512.0)
+    {
+        denom *= 2;
+        exponent++;
+    }
+
+    uint3 mantissa = (uint3)floor(color / denom + 0.5);
+    return mantissa.r | (mantissa.g << 9) | (mantissa.b << 18) | ((uint)exponent << 27);
+}
+
+float3 UnpackRGB9E5(uint packed)
+{
+    uint3 mantissa = uint3(packed, packed >> 9, packed >> 18) & 0x1FF;
+    int exponent = packed >> 27;
+    return mantissa * exp2(exponent - RGB9E5_EXP_BIAS - (int)RGB9E5_MANTISSA_BITS);
+}
+
+uint PackOctahedralNormal(float3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+
+    float2 oct = n.xy;
+    if (n.z < 0)
+    {
+        oct = 1 - abs(n.yx);
+        oct.x *= n.x >= 0 ? 1.0 : -1.0;
+        oct.y *= n.y >= 0 ? 1.0 : -1.0;
+    }
+
+    uint2 quantized = (uint2)round(saturate(oct * 0.5 + 0.5) * 1023.0);
+    return quantized.x | (quantized.y << 10);
+}
+
+float3 UnpackOctahedralNormal(uint packed)
+{
+    float2 oct = float2(packed & 0x3FF, (packed >> 10) & 0x3FF) / 1023.0 * 2 - 1;
+
+    float3 n = float3(oct, 1 - abs(oct.x) - abs(oct.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0 ? -t : t;
+    n.y += n.y >= 0 ? -t : t;
+    return normalize(n);
+}
+
+uint64_t PackVoxel(float3 radiance, float3 normal, uint coverage)
+{
+    return uint64_t(PackRGB9E5(radiance)) | (uint64_t(PackOctahedralNormal(normal)) << 32) | (uint64_t(min(coverage, VOXEL_MAX_COVERAGE)) << 52);
+}
+
+void UnpackVoxel(uint64_t packed, out float3 radiance, out float3 normal, out uint coverage)
+{
+    radiance = UnpackRGB9E5(uint(packed));
+    normal = UnpackOctahedralNormal(uint(packed >> 32) & 0xFFFFF);
+    coverage = uint(packed >> 52);
+}
+
+// Running average of the fragments, the weight of a new one stops shrinking once the coverage
+// saturates. Mirrored by VoxelPacking::Accumulate, keep the two the same.
+uint64_t AccumulatePackedVoxel(uint64_t packed, float3 radiance, float3 normal)
+{
+    // an interpolated normal is shorter than one and would weigh less in the average
+    normal = normalize(normal);
+
+    float3 prevRadiance, prevNormal;
+    uint coverage;
+    UnpackVoxel(packed, prevRadiance, prevNormal, coverage);
+
+    if (coverage == 0)
+        return PackVoxel(radiance, normal, 1);
+
+    float weight = 1.0 / (coverage + 1);
+    float3 averageNormal = prevNormal * (1 - weight) + normal * weight;
+
+    // opposite normals cancel out, keep the new one then
+    if (dot(averageNormal, averageNormal) <= 1.0e-8)
+        averageNormal = normal;
+
+    return PackVoxel(lerp(prevRadiance, radiance, weight), normalize(averageNormal), coverage + 1);
+}
+
+void ClearVoxel(RWStructuredBuffer<Voxel> voxels, uint index)
+{
+#if VOXEL_COMPACT_PACKING
+    voxels[index].Packed = 0;
+#else
+    voxels[index].Radiance = 0;
+    voxels[index].Normal = 0;
+#endif
+}
+
+void AccumulateVoxel(RWStructuredBuffer<Voxel> voxels, uint index, float3 radiance, float alpha, float3 normal)
+{
+#if VOXEL_COMPACT_PACKING
+    // the compact record has no opacity, voxels are either empty or opaque
+    uint64_t prevStoredVal = 0;
+    uint64_t curStoredVal;
+
+    InterlockedCompareExchange(voxels[index].Packed, prevStoredVal, AccumulatePackedVoxel(prevStoredVal, radiance, normal), curStoredVal);
+    [allow_uav_condition]
+    while (curStoredVal != prevStoredVal)
+    {
+        prevStoredVal = curStoredVal;
+        InterlockedCompareExchange(voxels[index].Packed, prevStoredVal, AccumulatePackedVoxel(prevStoredVal, radiance, normal), curStoredVal);
+    }
+#else
+    InterlockedAdd(voxels[index].Radiance, ConvFloat4ToUINT64(float4(radiance * 50.0, alpha * 255.0)));
+    InterlockedAdd(voxels[index].Normal, ConvFloat4ToUINT64(float4(normal * 50.0, 1)));
+#endif
+}
+
+// averaged radiance and opacity, and normal of a voxel, false if no fragment covered it
+bool LoadVoxel(RWStructuredBuffer<Voxel> voxels, uint index, out float4 radiance, out float3 normal)
+{
+#if VOXEL_COMPACT_PACKING
+    uint coverage;
+    UnpackVoxel(voxels[index].Packed, radiance.rgb, normal, coverage);
+    radiance.a = 1;
+    return coverage > 0;
+#else
+    radiance = ConvUINT64ToFloat4(voxels[index].Radiance);
+    normal = 0;
+    if (radiance.a <= 0)
+        return false;
+
+    radiance.rgb /= 50.0;
+    radiance.a /= 255.0;
+
+    // avoid very bright spot when alpha is low
+    radiance.a = max(radiance.a, 1);
+    radiance /= radiance.a;
+
+    float4 normals = ConvUINT64ToFloat4(voxels[index].Normal);
+    normal = normalize(normals.xyz / 50.0 / normals.w);
+    return true;
+#endif
+}
 
 uint3 WorldPosToVoxelIndex(float3 position)
 {
@@ -175,4 +367,6 @@ float4 TraceSpecularCone(Texture3D<float4> voxels, SamplerState linearSampler, f
     color.a = saturate(color.a);
     
     return color;
-}
\ No newline at end of file
+}
+
+#endif // __VOXEL_UTILS_HLSL__
\ No newline at end of file
@@ -10,6 +10,25 @@ struct Resources
 {
     uint VoxelIndex;
     uint ShadowMapTexIndex;
+#ifdef VOXEL_CLIPMAP
+    // clipmap level window and the region of it being revoxelized, in level voxel coordinates
+    int OriginX;
+    int OriginY;
+    int OriginZ;
+    float VoxelSize;
+    uint Resolution;
+    int RegionMinX;
+    int RegionMinY;
+    int RegionMinZ;
+    int RegionMaxX;
+    int RegionMaxY;
+    int RegionMaxZ;
+#else
+    uint BrickIndirectionIndex;
+    uint StatsIndex;
+    uint UpdateMaskIndex;
+    uint UpdateStamp;
+#endif
 };
 
 ConstantBuffer<Resources> g_Resources : register(b6);
@@ -148,8 +167,15 @@ void GS(triangle GeometryInOut input[3], inout TriangleStream<GeometryInOut> tri
     
     for (uint i = 0; i < 3; i++)
     {
+#ifdef VOXEL_CLIPMAP
+        // World space -> Clipmap level space, centred on the level window
+        float3 origin = float3(g_Resources.OriginX, g_Resources.OriginY, g_Resources.OriginZ);
+        float3 levelCenter = (origin + g_Resources.Resolution * 0.5) * g_Resources.VoxelSize;
+        output[i].PositionH.xyz = (input[i].PositionH.xyz - levelCenter) / (g_Resources.VoxelSize * 0.5);
+#else
         // World space -> Voxel grid space
         output[i].PositionH.xyz = (input[i].PositionH.xyz - VOXEL_GRID_WORLD_POS) / VOXEL_GRID_SIZE;
+#endif
         
         // Project to the dominant axis orthogonally
         [flatten]
@@ -167,7 +193,11 @@ void GS(triangle GeometryInOut input[3], inout TriangleStream<GeometryInOut> tri
         }
         
         // Voxel grid space -> Clip space
+#ifdef VOXEL_CLIPMAP
+        output[i].PositionH.xy /= g_Resources.Resolution;
+#else
         output[i].PositionH.xy /= VOXEL_DIMENSION;
+#endif
         output[i].PositionH.zw = 1;
         
         output[i].PositionW = input[i].PositionW;
@@ -182,6 +212,54 @@ void GS(triangle GeometryInOut input[3], inout TriangleStream<GeometryInOut> tri
     }
 }
 
+// Index of the voxel the fragment writes to, false if it must not be written
+bool FindVoxel(float3 positionW, out uint voxelIndex)
+{
+    voxelIndex = 0;
+
+#ifdef VOXEL_CLIPMAP
+    int3 voxel = ClipmapWorldToVoxel(positionW, g_Resources.VoxelSize);
+    int3 regionMin = int3(g_Resources.RegionMinX, g_Resources.RegionMinY, g_Resources.RegionMinZ);
+    int3 regionMax = int3(g_Resources.RegionMaxX, g_Resources.RegionMaxY, g_Resources.RegionMaxZ);
+
+    // the rest of the level keeps its voxels, and anything outside the window would wrap around
+    if (any(voxel < regionMin) || any(voxel >= regionMax))
+        return false;
+
+    voxelIndex = Flatten(ClipmapVoxelToTexel(voxel, g_Resources.Resolution), g_Resources.Resolution);
+    return true;
+#else
+    float3 position = positionW / VOXEL_DIMENSION / VOXEL_GRID_SIZE;
+    uint3 texIndex = uint3(
+        (position.x * 0.5 + 0.5f) * VOXEL_DIMENSION,
+        (position.y * -0.5 + 0.5f) * VOXEL_DIMENSION,
+        (position.z * 0.5 + 0.5f) * VOXEL_DIMENSION
+    );
+
+    if (any(texIndex >= VOXEL_DIMENSION))
+        return false;
+
+    StructuredBuffer<uint> brickIndirection = ResourceDescriptorHeap[g_Resources.BrickIndirectionIndex];
+    uint brick = BrickPoolIndex(brickIndirection, texIndex);
+
+    // the CPU occupancy is conservative, count the fragments it missed so they can be spotted
+    if (brick == INVALID_BRICK)
+    {
+        RWByteAddressBuffer stats = ResourceDescriptorHeap[g_Resources.StatsIndex];
+        stats.InterlockedAdd(VOXEL_STAT_MISSING_BRICK_FRAGMENTS * 4, 1);
+        return false;
+    }
+
+    // only the bricks scheduled for this update are rewritten, the rest keep their cached voxels
+    RWStructuredBuffer<uint> updateMask = ResourceDescriptorHeap[g_Resources.UpdateMaskIndex];
+    if (updateMask[brick] != g_Resources.UpdateStamp)
+        return false;
+
+    voxelIndex = brick * VOXELS_PER_BRICK + Flatten(texIndex % VOXEL_BRICK_SIZE, VOXEL_BRICK_SIZE);
+    return true;
+#endif
+}
+
 void PS(GeometryInOut pin)
 {
     RWStructuredBuffer<Voxel> voxels = ResourceDescriptorHeap[g_Resources.VoxelIndex];
@@ -194,14 +272,8 @@ void PS(GeometryInOut pin)
     float metalness = GetMetalness(pin.TexCoord);
     float roughness = GetRoughness(pin.TexCoord);
     
-    float3 positionW = pin.PositionW / VOXEL_DIMENSION / VOXEL_GRID_SIZE;
-    uint3 texIndex = uint3(
-        (positionW.x * 0.5 + 0.5f) * VOXEL_DIMENSION,
-        (positionW.y * -0.5 + 0.5f) * VOXEL_DIMENSION,
-        (positionW.z * 0.5 + 0.5f) * VOXEL_DIMENSION
-    );    
-    
-    if (all(texIndex < VOXEL_DIMENSION) && all(texIndex >= 0))
+    uint voxelIndex;
+    if (FindVoxel(pin.PositionW, voxelIndex))
     {
         float shadowFactor = 1.0f;
 
@@ -254,9 +326,7 @@ void PS(GeometryInOut pin)
             }
         }
         
-        uint voxelIndex = Flatten(texIndex, VOXEL_DIMENSION);
-        InterlockedAdd(voxels[voxelIndex].Radiance, ConvFloat4ToUINT64(float4(directLighting * 50.0, alpha * 255.0)));
-        InterlockedAdd(voxels[voxelIndex].Normal, ConvFloat4ToUINT64(float4(pin.NormalW * 50.0, 1)));
+        AccumulateVoxel(voxels, voxelIndex, directLighting, alpha, normalize(pin.NormalW));
         // ImageAtomicUINT64Avg(voxels, Flatten(texIndex), float4(directLighting, alpha));
     }
 }
\ No newline at end of file
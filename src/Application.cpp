@@ -1,35 +1,82 @@
 #include "Application.h"
 #include <imgui.h>
 #include "rendering/RenderingSettings.h"
+#include "rendering/GpuProfiler.h"
 
 RenderingSettings g_RenderingSettings;
+RenderingStats g_RenderingStats;
 
 Application::Application()
 {
     m_Window = std::make_unique<Window>();
     m_Window->Callback = std::bind(&Application::OnEvent, this, std::placeholders::_1);
 
-    m_DxContext = make_ref<DxContext>(m_Window->GetHandle(), m_Window->GetWidth(), m_Window->GetHeight());
-    m_Renderer = std::make_unique<Renderer>(m_DxContext, m_Window->GetWidth(), m_Window->GetHeight());
-    m_UI = std::make_unique<UI>(m_DxContext, m_Window->GetHandle());
+    m_Renderer = std::make_unique<Renderer>(m_Window->GetWidth(), m_Window->GetHeight());
+
+    const auto mainThread = InitGraph::Affinity::MainThread;
+    InitGraph graph;
+
+    // the uploads of the steps are waited for once, at the end
+    graph.Add("DxContext", {}, [this]()
+    {
+        m_DxContext = make_ref<DxContext>(m_Window->GetHandle(), m_Window->GetWidth(), m_Window->GetHeight());
+        m_DxContext->BeginFlushBatch();
+    }, mainThread);
+
+    m_Renderer->AddInitSteps(graph, m_DxContext);
+    graph.Add("UI", {"DxContext"}, [this]() { m_UI = std::make_unique<UI>(m_DxContext, m_Window->GetHandle()); }, mainThread);
+
+    UINT deferredFlushes = 0;
+    graph.Add("GPU sync", graph.Names(), [&]()
+    {
+        deferredFlushes = m_DxContext->EndFlushBatch();
+        m_DxContext->EndLoad();
+    }, mainThread);
+
+    // a step missing its dependency is a bug in the code that added it, startup cannot go on without it
+    bool ran = graph.Run();
+    ASSERT(ran, "Startup graph is not valid: " + graph.Validate());
+
+    std::ostringstream report;
+    graph.WriteReport(report);
+    LOG_INFO("{}GPU sync stood in for {} flush(es)", report.str(), deferredFlushes);
 }
 
 Application::~Application()
 {
     m_DxContext->Flush();
+    m_DxContext->GetStagingManager().LogStats();
 }
 
-void Application::Run()
+void Application::Run(Benchmark *benchmark)
 {
-    m_Renderer->Setup();
+    PROFILE_THREAD("Main");
+
+    m_Benchmark = benchmark;
+    if (m_Benchmark)
+    {
+        // frames are timed without waiting for the display
+        g_RenderingSettings.EnableVSync = false;
+        Timer.SetFixedDeltaTime(m_Benchmark->TimeStep());
+        m_Renderer->SetInputEnabled(false);
+    }
 
     Timer.Reset();
 
     while (Running)
     {
+        PROFILE_FRAME();
+        CounterRegistry::Global().NewFrame();
+
+        int64_t frameStart = Clock::System().Now();
+        Timer.SetSmoothing(g_RenderingSettings.SmoothDeltaTime ? SMOOTHING_FRAMES : 1);
         Timer.Tick();
 
         m_Window->OnUpdate(Timer);
+
+        if (m_Benchmark && !m_Benchmark->BeginFrame(m_Renderer->GetCamera(), g_RenderingSettings))
+            break;
+
         m_Renderer->OnUpdate(Timer);
 
         m_UI->BeginFrame();
@@ -40,7 +87,36 @@ void Application::Run()
 
         m_UI->EndFrame();
         m_Renderer->EndFrame();
+
+        // a benchmark runs as fast as it can
+        if (!m_Benchmark)
+            PaceFrame();
+
+        if (m_Benchmark)
+        {
+            double frameMs = (Clock::System().Now() - frameStart) * 1.0e-6;
+#ifdef ENABLE_PROFILER
+            double gpuMs = GpuProfiler::LastFrameMs();
+#else
+            double gpuMs = -1.0;
+#endif
+            m_Benchmark->RecordCounters(CounterRegistry::Global());
+            m_Benchmark->EndFrame(frameMs - m_Renderer->GetWaitTimeMs(), gpuMs);
+        }
     }
+
+    m_Benchmark = nullptr;
+}
+
+void Application::PaceFrame()
+{
+    m_FramePacer.SetTargetFps(g_RenderingSettings.FrameRateLimit);
+    m_FramePacer.Wait();
+
+    FrameStats errors = m_FramePacer.DeadlineErrors();
+    g_RenderingStats.Pacing.DeadlineErrorP50 = errors.P50;
+    g_RenderingStats.Pacing.DeadlineErrorP99 = errors.P99;
+    g_RenderingStats.Pacing.SpinMargin = m_FramePacer.SpinMarginMs();
 }
 
 void Application::OnEvent(Event &e)
@@ -96,7 +172,7 @@ void Application::OnMouseReleased(MouseButtonReleasedEvent &e)
 void Application::OnMouseMoved(MouseMovedEvent &e)
 {
     auto &io = ImGui::GetIO();
-    if (io.WantCaptureMouse)
+    if (io.WantCaptureMouse || m_Benchmark)
         return;
 
     if ((e.GetBtnState() & MK_LBUTTON))
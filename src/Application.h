@@ -5,7 +5,10 @@
 #include "core/Window.h"
 #include "core/UI.h"
 #include "core/Timer.h"
+#include "core/FramePacer.h"
+#include "core/InitGraph.h"
 #include "dx/DxContext.h"
+#include "Benchmark.h"
 
 #include "event/Event.h"
 #include "event/ApplicationEvent.h"
@@ -18,7 +21,8 @@ public:
     Application();
     ~Application();
 
-    void Run();
+    // with a benchmark the camera follows its path and the loop ends with the path
+    void Run(Benchmark *benchmark = nullptr);
 
     void OnEvent(Event &e);
 
@@ -34,6 +38,12 @@ public:
     bool Running = true;
     Timer Timer;
 
+private:
+    // waits out the rest of the frame under a frame rate limit
+    void PaceFrame();
+
+    static constexpr int SMOOTHING_FRAMES = 8;
+
 private:
     std::unique_ptr<Window> m_Window;
     std::unique_ptr<Renderer> m_Renderer;
@@ -41,6 +51,9 @@ private:
 
     Ref<DxContext> m_DxContext;
 
+    Benchmark *m_Benchmark = nullptr;
+    FramePacer m_FramePacer;
+
     int m_LastMousePosX = 0;
     int m_LastMousePosY = 0;
 };
@@ -0,0 +1,262 @@
+#include "Benchmark.h"
+
+Benchmark::Benchmark(int gpuLatency)
+    : m_GpuLatency(gpuLatency)
+{
+}
+
+bool Benchmark::Load(const std::string &filename)
+{
+    CameraPath path;
+    return path.Load(filename) && SetPath(path);
+}
+
+bool Benchmark::SetPath(const CameraPath &path)
+{
+    RenderingSettings scratch;
+    for (const auto &change : path.SettingChanges())
+    {
+        if (!ApplySetting(scratch, change.Name, change.Value))
+        {
+            LOG_ERROR("Benchmark: unknown setting {}", change.Name);
+            return false;
+        }
+    }
+
+    m_Path = path;
+    m_Frame = 0;
+    m_NextSettingChange = 0;
+    m_Frames.clear();
+    m_Counters.clear();
+    return true;
+}
+
+bool Benchmark::BeginFrame(Camera &camera, RenderingSettings &settings)
+{
+    // the warmup frames stay at the start of the path
+    int recorded = std::max(m_Frame - m_Path.WarmupFrames(), 0);
+    m_Time = recorded * (double)m_Path.TimeStep();
+    if (m_Time > m_Path.Duration())
+        return false;
+
+    const auto &changes = m_Path.SettingChanges();
+    for (; m_NextSettingChange < changes.size() && changes[m_NextSettingChange].Time <= m_Time; m_NextSettingChange++)
+        ApplySetting(settings, changes[m_NextSettingChange].Name, changes[m_NextSettingChange].Value);
+
+    XMFLOAT3 position, target;
+    m_Path.Sample((float)m_Time, position, target);
+    camera.LookAt(position, target, XMFLOAT3(0.0f, 1.0f, 0.0f));
+    return true;
+}
+
+void Benchmark::EndFrame(double cpuMs, double gpuMs)
+{
+    int warmup = m_Path.WarmupFrames();
+    if (m_Frame >= warmup)
+        m_Frames.push_back({m_Time, cpuMs});
+
+    // the GPU time belongs to an earlier frame, the ones of the last few frames never arrive
+    int gpuFrame = m_Frame - m_GpuLatency - warmup;
+    if (gpuMs >= 0.0 && gpuFrame >= 0)
+        m_Frames[gpuFrame].GpuMs = gpuMs;
+
+    m_Frame++;
+}
+
+void Benchmark::RecordCounters(const CounterRegistry &counters)
+{
+    if (m_Frame < m_Path.WarmupFrames())
+        return;
+
+    int count = counters.Count();
+    for (int id = (int)m_Counters.size(); id < count; id++)
+        m_Counters.push_back({counters.Name(id), {}});
+
+    for (int id = 0; id < count; id++)
+        m_Counters[id].second.push_back((double)counters.Value(id));
+}
+
+BenchmarkResults Benchmark::Results() const
+{
+    std::vector<double> cpu, gpu;
+    for (const auto &frame : m_Frames)
+    {
+        cpu.push_back(frame.CpuMs);
+        if (frame.GpuMs >= 0.0)
+            gpu.push_back(frame.GpuMs);
+    }
+
+    BenchmarkResults results;
+    results.Cpu = FrameStats::Compute(cpu);
+    results.Gpu = FrameStats::Compute(gpu);
+
+    for (const auto &[name, values] : m_Counters)
+        results.Counters.push_back({name, FrameStats::Compute(values)});
+    return results;
+}
+
+void Benchmark::WriteCsv(std::ostream &out) const
+{
+    out << "frame,time,cpu_ms,gpu_ms\n";
+    for (size_t i = 0; i < m_Frames.size(); i++)
+    {
+        const auto &frame = m_Frames[i];
+        out << i << ',' << frame.Time << ',' << frame.CpuMs << ',';
+        if (frame.GpuMs >= 0.0)
+            out << frame.GpuMs;
+        out << '\n';
+    }
+}
+
+static void WriteStats(std::ostream &out, const std::string &name, const FrameStats &stats, const char *indent = "  ")
+{
+    out << indent << "\"" << name << "\": {\"count\": " << stats.Count << ", \"mean\": " << stats.Mean
+        << ", \"stddev\": " << stats.StdDev << ", \"min\": " << stats.Min << ", \"max\": " << stats.Max
+        << ", \"p50\": " << stats.P50 << ", \"p95\": " << stats.P95 << ", \"p99\": " << stats.P99 << "}";
+}
+
+void Benchmark::WriteJson(std::ostream &out) const
+{
+    BenchmarkResults results = Results();
+
+    out.precision(9);
+    out << "{\n";
+    out << "  \"frames\": " << m_Frames.size() << ",\n";
+    out << "  \"timestep\": " << m_Path.TimeStep() << ",\n";
+    WriteStats(out, "cpu", results.Cpu);
+    out << ",\n";
+    WriteStats(out, "gpu", results.Gpu);
+
+    out << ",\n  \"counters\": {";
+    for (size_t i = 0; i < results.Counters.size(); i++)
+    {
+        out << (i == 0 ? "\n" : ",\n");
+        WriteStats(out, results.Counters[i].first, results.Counters[i].second, "    ");
+    }
+    out << "\n  }\n}\n";
+}
+
+// reads the flat object of numbers written by WriteStats
+static bool ReadStats(const std::string &json, const char *name, FrameStats &stats)
+{
+    size_t begin = json.find("\"" + std::string(name) + "\"");
+    if (begin == std::string::npos)
+        return false;
+
+    begin = json.find('{', begin);
+    size_t end = json.find('}', begin);
+    if (begin == std::string::npos || end == std::string::npos)
+        return false;
+
+    std::string object = json.substr(begin + 1, end - begin - 1);
+    auto number = [&](const char *key, double &value)
+    {
+        size_t pos = object.find("\"" + std::string(key) + "\"");
+        if (pos == std::string::npos || (pos = object.find(':', pos)) == std::string::npos)
+            return false;
+        value = strtod(object.c_str() + pos + 1, nullptr);
+        return true;
+    };
+
+    double count = 0.0;
+    bool valid = number("count", count) && number("mean", stats.Mean) && number("stddev", stats.StdDev) &&
+                 number("min", stats.Min) && number("max", stats.Max) &&
+                 number("p50", stats.P50) && number("p95", stats.P95) && number("p99", stats.P99);
+    stats.Count = (int)count;
+    return valid;
+}
+
+bool Benchmark::ReadJson(std::istream &in, BenchmarkResults &results)
+{
+    std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return ReadStats(json, "cpu", results.Cpu) && ReadStats(json, "gpu", results.Gpu);
+}
+
+int Benchmark::Compare(const BenchmarkResults &results, const BenchmarkResults &baseline, double tolerance)
+{
+    int regressions = 0;
+
+    auto compare = [&](const char *name, const FrameStats &current, const FrameStats &base)
+    {
+        if (current.Count == 0 || base.Count == 0)
+        {
+            LOG_WARN("Benchmark: no {} times to compare", name);
+            return;
+        }
+
+        std::pair<const char *, double FrameStats::*> values[] = {
+            {"mean", &FrameStats::Mean}, {"p50", &FrameStats::P50}, {"p95", &FrameStats::P95}, {"p99", &FrameStats::P99}};
+
+        for (const auto &[label, value] : values)
+        {
+            double change = base.*value > 0.0 ? current.*value / (base.*value) - 1.0 : 0.0;
+            bool slower = change > tolerance;
+            regressions += slower ? 1 : 0;
+
+            if (slower)
+                LOG_ERROR("Benchmark: {} {} {:.3f} ms vs {:.3f} ms ({:+.1f}%)", name, label, current.*value, base.*value, change * 100.0);
+            else
+                LOG_INFO("Benchmark: {} {} {:.3f} ms vs {:.3f} ms ({:+.1f}%)", name, label, current.*value, base.*value, change * 100.0);
+        }
+    };
+
+    compare("cpu", results.Cpu, baseline.Cpu);
+    compare("gpu", results.Gpu, baseline.Gpu);
+    return regressions;
+}
+
+bool Benchmark::ApplySetting(RenderingSettings &settings, const std::string &name, float value)
+{
+    std::unordered_map<std::string, bool *> bools = {
+        {"EnableVSync", &settings.EnableVSync},
+        {"EnableIBL", &settings.EnableIBL},
+        {"UseIndirectDraw", &settings.UseIndirectDraw},
+        {"FitCascadesToScene", &settings.FitCascadesToScene},
+        {"FitCascadesToDepth", &settings.FitCascadesToDepth},
+        {"CacheStaticShadows", &settings.CacheStaticShadows},
+        {"ShowCascades", &settings.ShowCascades},
+        {"UseVogelDiskSample", &settings.UseVogelDiskSample},
+        {"EnableToneMapping", &settings.EnableToneMapping},
+        {"EnableMotionBlur", &settings.EnableMotionBlur},
+        {"GI.Enable", &settings.GI.Enable},
+        {"GI.UseClipmap", &settings.GI.UseClipmap},
+        {"GI.DynamicUpdate", &settings.GI.DynamicUpdate},
+        {"GI.SecondBounce", &settings.GI.SecondBounce},
+        {"GI.DebugVoxel", &settings.GI.DebugVoxel},
+    };
+
+    std::unordered_map<std::string, int *> ints = {
+        {"DistantCascadeInterval", &settings.DistantCascadeInterval},
+        {"NumSamples", &settings.NumSamples},
+        {"AntialisingMethod", (int *)&settings.AntialisingMethod},
+        {"GI.DebugVoxelMipLevel", &settings.GI.DebugVoxelMipLevel},
+        {"GI.UpdateBudget", &settings.GI.UpdateBudget},
+        {"GI.SecondBounceSchedule", &settings.GI.SecondBounceSchedule},
+        {"GI.SecondBounceBudget", &settings.GI.SecondBounceBudget},
+    };
+
+    std::unordered_map<std::string, float *> floats = {
+        {"MaxShadowDistance", &settings.MaxShadowDistance},
+        {"CascadeRangeScale", &settings.CascadeRangeScale},
+        {"CascadeTransitionRatio", &settings.CascadeTransitionRatio},
+        {"ShadowSoftness", &settings.ShadowSoftness},
+        {"Exposure", &settings.Exposure},
+        {"MotionBlurAmount", &settings.MotionBlurAmount},
+        {"GI.SecondBounceFraction", &settings.GI.SecondBounceFraction},
+        {"GI.SecondBounceBlend", &settings.GI.SecondBounceBlend},
+        {"SunTheta", &settings.SunTheta},
+        {"SunPhi", &settings.SunPhi},
+        {"SunLightIntensity", &settings.SunLightIntensity},
+    };
+
+    if (auto it = bools.find(name); it != bools.end())
+        *it->second = value != 0.0f;
+    else if (auto it = ints.find(name); it != ints.end())
+        *it->second = (int)lroundf(value);
+    else if (auto it = floats.find(name); it != floats.end())
+        *it->second = value;
+    else
+        return false;
+
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "pch.h"
+#include "core/FrameStats.h"
+#include "rendering/Camera.h"
+#include "rendering/CameraPath.h"
+#include "rendering/RenderingSettings.h"
+
+struct BenchmarkFrame
+{
+    double Time;         // on the camera path, in seconds
+    double CpuMs;        // main thread, without waiting for the frame resource and the swap chain
+    double GpuMs = -1.0; // negative without a GPU timestamp for the frame
+};
+
+struct BenchmarkResults
+{
+    FrameStats Cpu;
+    FrameStats Gpu; // empty without the GPU profiler
+
+    // per frame values of the counters, in the order they were registered
+    std::vector<std::pair<std::string, FrameStats>> Counters;
+};
+
+// Flies the camera along a scripted path with a fixed time step and records the time of every
+// frame. The frames are written to CSV and the statistics to JSON, which later runs are compared
+// against to catch regressions.
+class Benchmark
+{
+public:
+    // gpuLatency is the number of frames the GPU time of a frame arrives late
+    Benchmark(int gpuLatency);
+
+    bool Load(const std::string &filename);
+    bool SetPath(const CameraPath &path);
+
+    float TimeStep() const { return m_Path.TimeStep(); }
+
+    // places the camera and applies the settings for the next frame, false once the path is done
+    bool BeginFrame(Camera &camera, RenderingSettings &settings);
+
+    // gpuMs is the latest GPU frame time that came back, negative if none did
+    void EndFrame(double cpuMs, double gpuMs);
+
+    // takes the values of the frame that is still being recorded, call before EndFrame
+    void RecordCounters(const CounterRegistry &counters);
+
+    const std::vector<BenchmarkFrame> &Frames() const { return m_Frames; }
+    BenchmarkResults Results() const;
+
+    void WriteCsv(std::ostream &out) const;
+    void WriteJson(std::ostream &out) const;
+    static bool ReadJson(std::istream &in, BenchmarkResults &results);
+
+    // logs the mean and percentiles against the baseline and returns how many of them got slower
+    // by more than tolerance, a fraction of the baseline
+    static int Compare(const BenchmarkResults &results, const BenchmarkResults &baseline, double tolerance);
+
+    // sets a field of the settings by the name used in the camera path files
+    static bool ApplySetting(RenderingSettings &settings, const std::string &name, float value);
+
+private:
+    CameraPath m_Path;
+    int m_GpuLatency;
+
+    int m_Frame = 0; // warmup frames included
+    size_t m_NextSettingChange = 0;
+    double m_Time = 0.0;
+
+    std::vector<BenchmarkFrame> m_Frames;
+
+    // by counter id, a counter registered during the run has fewer values
+    std::vector<std::pair<std::string, std::vector<double>>> m_Counters;
+};
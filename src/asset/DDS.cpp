@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "DDS.h"
+
+// see https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+namespace
+{
+    const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+    const uint32_t DDS_FOURCC_DX10 = 0x30315844; // "DX10"
+
+    const uint32_t DDSD_CAPS = 0x1;
+    const uint32_t DDSD_HEIGHT = 0x2;
+    const uint32_t DDSD_WIDTH = 0x4;
+    const uint32_t DDSD_PITCH = 0x8;
+    const uint32_t DDSD_PIXELFORMAT = 0x1000;
+    const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+
+    const uint32_t DDPF_FOURCC = 0x4;
+
+    const uint32_t DDSCAPS_COMPLEX = 0x8;
+    const uint32_t DDSCAPS_TEXTURE = 0x1000;
+    const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+    const uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xFE00;
+
+    const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+    const uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+    struct DDSPixelFormat
+    {
+        uint32_t Size;
+        uint32_t Flags;
+        uint32_t FourCC;
+        uint32_t RGBBitCount;
+        uint32_t RBitMask;
+        uint32_t GBitMask;
+        uint32_t BBitMask;
+        uint32_t ABitMask;
+    };
+
+    struct DDSHeader
+    {
+        uint32_t Size;
+        uint32_t Flags;
+        uint32_t Height;
+        uint32_t Width;
+        uint32_t PitchOrLinearSize;
+        uint32_t Depth;
+        uint32_t MipMapCount;
+        uint32_t Reserved1[11];
+        DDSPixelFormat PixelFormat;
+        uint32_t Caps;
+        uint32_t Caps2;
+        uint32_t Caps3;
+        uint32_t Caps4;
+        uint32_t Reserved2;
+    };
+
+    struct DDSHeaderDX10
+    {
+        uint32_t DXGIFormat;
+        uint32_t ResourceDimension;
+        uint32_t MiscFlag;
+        uint32_t ArraySize;
+        uint32_t MiscFlags2;
+    };
+
+    static_assert(sizeof(DDSHeader) == 124, "DDS header has to be 124 bytes.");
+    static_assert(sizeof(DDSHeaderDX10) == 20, "DDS DX10 header has to be 20 bytes.");
+}
+
+UINT TextureData::BytesPerPixel(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        return 16;
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    case DXGI_FORMAT_R32G32_FLOAT:
+        return 8;
+    case DXGI_FORMAT_R16G16_FLOAT:
+    case DXGI_FORMAT_R32_FLOAT:
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        return 4;
+    case DXGI_FORMAT_R16_FLOAT:
+        return 2;
+    default:
+        ASSERT(false, "Unsupported texture format: {}", (int)format);
+        return 0;
+    }
+}
+
+size_t TextureData::SubresourceOffset(UINT arraySlice, UINT level) const
+{
+    size_t sliceSize = 0;
+    for (UINT i = 0; i < Levels; i++)
+        sliceSize += SubresourceSize(i);
+
+    size_t offset = arraySlice * sliceSize;
+    for (UINT i = 0; i < level; i++)
+        offset += SubresourceSize(i);
+
+    return offset;
+}
+
+bool DDS::Load(const std::string &filename, TextureData &texture)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+        return false;
+
+    uint32_t magic = 0;
+    DDSHeader header = {};
+    DDSHeaderDX10 headerDX10 = {};
+
+    file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+    if (!file || magic != DDS_MAGIC || header.Size != sizeof(DDSHeader))
+    {
+        LOG_CHANNEL_WARN(Asset, "Invalid DDS file: {}", filename);
+        return false;
+    }
+
+    if (!(header.PixelFormat.Flags & DDPF_FOURCC) || header.PixelFormat.FourCC != DDS_FOURCC_DX10)
+    {
+        LOG_CHANNEL_WARN(Asset, "Only DDS files with a DX10 header are supported: {}", filename);
+        return false;
+    }
+
+    file.read(reinterpret_cast<char *>(&headerDX10), sizeof(headerDX10));
+    if (!file || headerDX10.ResourceDimension != DDS_DIMENSION_TEXTURE2D)
+    {
+        LOG_CHANNEL_WARN(Asset, "Only 2D DDS textures are supported: {}", filename);
+        return false;
+    }
+
+    texture.Width = header.Width;
+    texture.Height = header.Height;
+    texture.Levels = std::max(header.MipMapCount, 1u);
+    texture.Format = (DXGI_FORMAT)headerDX10.DXGIFormat;
+    texture.IsCubemap = (headerDX10.MiscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) != 0;
+    texture.ArraySize = std::max(headerDX10.ArraySize, 1u) * (texture.IsCubemap ? 6 : 1);
+
+    texture.Allocate();
+    file.read(reinterpret_cast<char *>(texture.Data.data()), texture.Data.size());
+
+    if (!file)
+    {
+        LOG_CHANNEL_WARN(Asset, "Truncated DDS file: {}", filename);
+        return false;
+    }
+
+    return true;
+}
+
+bool DDS::Save(const std::string &filename, const TextureData &texture)
+{
+    ASSERT(texture.Data.size() == texture.TotalSize(), "Texture data does not match its description.");
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        LOG_CHANNEL_WARN(Asset, "Failed to open {} for writing.", filename);
+        return false;
+    }
+
+    DDSHeader header = {};
+    header.Size = sizeof(DDSHeader);
+    header.Flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PITCH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+    header.Height = texture.Height;
+    header.Width = texture.Width;
+    header.PitchOrLinearSize = texture.RowPitch(0);
+    header.Depth = 1;
+    header.MipMapCount = texture.Levels;
+    header.PixelFormat.Size = sizeof(DDSPixelFormat);
+    header.PixelFormat.Flags = DDPF_FOURCC;
+    header.PixelFormat.FourCC = DDS_FOURCC_DX10;
+    header.Caps = DDSCAPS_TEXTURE | (texture.Levels > 1 ? DDSCAPS_MIPMAP | DDSCAPS_COMPLEX : 0);
+    header.Caps2 = texture.IsCubemap ? DDSCAPS2_CUBEMAP_ALLFACES : 0;
+
+    if (texture.IsCubemap)
+        header.Caps |= DDSCAPS_COMPLEX;
+
+    DDSHeaderDX10 headerDX10 = {};
+    headerDX10.DXGIFormat = texture.Format;
+    headerDX10.ResourceDimension = DDS_DIMENSION_TEXTURE2D;
+    headerDX10.MiscFlag = texture.IsCubemap ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+    headerDX10.ArraySize = texture.IsCubemap ? texture.ArraySize / 6 : texture.ArraySize;
+
+    file.write(reinterpret_cast<const char *>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(&headerDX10), sizeof(headerDX10));
+    file.write(reinterpret_cast<const char *>(texture.Data.data()), texture.Data.size());
+
+    return (bool)file;
+}
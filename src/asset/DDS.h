@@ -0,0 +1,42 @@
+#pragma once
+
+#include "pch.h"
+
+// CPU copy of an uncompressed texture. Subresources are packed tightly
+// in D3D12 subresource order: all mips of array slice 0, then slice 1, ...
+struct TextureData
+{
+    UINT Width = 0;
+    UINT Height = 0;
+    UINT ArraySize = 1;
+    UINT Levels = 1;
+    DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+    bool IsCubemap = false;
+
+    std::vector<uint8_t> Data;
+
+    static UINT BytesPerPixel(DXGI_FORMAT format);
+
+    UINT LevelWidth(UINT level) const { return std::max(Width >> level, 1u); }
+    UINT LevelHeight(UINT level) const { return std::max(Height >> level, 1u); }
+    UINT RowPitch(UINT level) const { return LevelWidth(level) * BytesPerPixel(Format); }
+
+    size_t SubresourceSize(UINT level) const { return (size_t)RowPitch(level) * LevelHeight(level); }
+    size_t SubresourceOffset(UINT arraySlice, UINT level) const;
+    size_t TotalSize() const { return SubresourceOffset(ArraySize, 0); }
+
+    void Allocate() { Data.assign(TotalSize(), 0); }
+
+    template <typename T>
+    T *Subresource(UINT arraySlice, UINT level) { return reinterpret_cast<T *>(Data.data() + SubresourceOffset(arraySlice, level)); }
+    template <typename T>
+    const T *Subresource(UINT arraySlice, UINT level) const { return reinterpret_cast<const T *>(Data.data() + SubresourceOffset(arraySlice, level)); }
+};
+
+// Reads and writes DDS files with the DX10 extended header.
+class DDS
+{
+public:
+    static bool Load(const std::string &filename, TextureData &texture);
+    static bool Save(const std::string &filename, const TextureData &texture);
+};
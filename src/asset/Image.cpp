@@ -6,7 +6,7 @@
 
 std::shared_ptr<Image> Image::FromFile(const std::string &filename, int channels)
 {
-    LOG_INFO("Loading image: {}", filename);
+    LOG_CHANNEL_INFO(Asset, "Loading image: {}", filename);
 
     std::shared_ptr<Image> image(new Image());
 
@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "Clock.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CLOCK_USE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+static int64_t SteadyNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Clock &Clock::System()
+{
+    static SystemClock clock;
+    return clock;
+}
+
+SystemClock::SystemClock()
+{
+#ifdef CLOCK_USE_TSC
+    // counts the ticks of a few milliseconds, the counter is invariant on every x64 CPU this runs on
+    int64_t clockStart = SteadyNow();
+    int64_t tscStart = (int64_t)__rdtsc();
+
+    int64_t elapsed;
+    do
+        elapsed = SteadyNow() - clockStart;
+    while (elapsed < 20'000'000);
+
+    m_NsPerTick = (double)elapsed / (double)((int64_t)__rdtsc() - tscStart);
+    m_TscStart = tscStart;
+#endif
+
+#ifdef _WIN32
+    // Windows 10 1803 and later, the regular timer is used before that
+    m_Timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!m_Timer)
+        m_Timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+#endif
+}
+
+SystemClock::~SystemClock()
+{
+#ifdef _WIN32
+    if (m_Timer)
+        CloseHandle(m_Timer);
+#endif
+}
+
+int64_t SystemClock::Now()
+{
+#ifdef CLOCK_USE_TSC
+    // relative to the start, a double holds the nanoseconds of a few months exactly
+    return (int64_t)(((int64_t)__rdtsc() - m_TscStart) * m_NsPerTick);
+#else
+    return SteadyNow();
+#endif
+}
+
+void SystemClock::Sleep(int64_t ns)
+{
+    if (ns <= 0)
+        return;
+
+#ifdef _WIN32
+    if (m_Timer)
+    {
+        // relative due times are negative, in units of 100 ns
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -std::max<int64_t>(ns / 100, 1);
+        if (SetWaitableTimer(m_Timer, &dueTime, 0, nullptr, nullptr, FALSE))
+        {
+            WaitForSingleObject(m_Timer, INFINITE);
+            return;
+        }
+    }
+#endif
+
+    std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "pch.h"
+
+// A monotonic clock in nanoseconds. Timer and FramePacer read the time through it, so that tests
+// can drive them with a FakeClock.
+class Clock
+{
+public:
+    virtual ~Clock() = default;
+
+    virtual int64_t Now() = 0;
+
+    // may return later than asked, by up to the granularity of the scheduler
+    virtual void Sleep(int64_t ns) = 0;
+
+    // the clock of the process
+    static Clock &System();
+};
+
+// Reads the time stamp counter where there is one, calibrated once against the steady clock, and
+// the steady clock elsewhere. Sleeps on a high resolution waitable timer on Windows, whose
+// regular sleep only wakes up on the 15.6 ms system tick.
+class SystemClock : public Clock
+{
+public:
+    SystemClock();
+    ~SystemClock();
+
+    SystemClock(const SystemClock &) = delete;
+    SystemClock &operator=(const SystemClock &) = delete;
+
+    int64_t Now() override;
+    void Sleep(int64_t ns) override;
+
+    bool UsesTsc() const { return m_NsPerTick > 0.0; }
+
+private:
+    int64_t m_TscStart = 0;
+    double m_NsPerTick = 0.0;
+
+#ifdef _WIN32
+    HANDLE m_Timer = nullptr;
+#endif
+};
+
+// Time only passes when told to. Every read moves it on by Step, so that spinning on it ends, and
+// every sleep by Oversleep more than asked, like a coarse scheduler.
+class FakeClock : public Clock
+{
+public:
+    int64_t Now() override { return m_Now += Step; }
+
+    void Sleep(int64_t ns) override
+    {
+        m_Now += ns + Oversleep;
+        Sleeps++;
+    }
+
+    void Advance(int64_t ns) { m_Now += ns; }
+
+    int64_t Step = 0;
+    int64_t Oversleep = 0;
+    int Sleeps = 0;
+
+private:
+    int64_t m_Now = 0;
+};
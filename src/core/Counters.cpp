@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "Counters.h"
+
+int CounterRegistry::Register(const char *name, CounterKind kind)
+{
+    std::lock_guard<std::mutex> lock(m_RegisterMutex);
+
+    int count = m_Count.load(std::memory_order_relaxed);
+    for (int id = 0; id < count; id++)
+    {
+        if (m_Counters[id].Name == name)
+            return id;
+    }
+
+    if (count == MAX_COUNTERS)
+    {
+        LOG_WARN("Counters: no room for {}, MAX_COUNTERS is {}", name, MAX_COUNTERS);
+        return INVALID_ID;
+    }
+
+    m_Counters[count].Name = name;
+    m_Counters[count].Kind = kind;
+
+    // the name is written before the counter becomes visible to Count
+    m_Count.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void CounterRegistry::NewFrame()
+{
+    int count = Count();
+    for (int id = 0; id < count; id++)
+    {
+        auto &counter = m_Counters[id];
+        if (counter.Kind == CounterKind::PerFrame)
+            counter.Last = counter.Value.exchange(0, std::memory_order_relaxed);
+        else
+            counter.Last = counter.Value.load(std::memory_order_relaxed);
+
+        counter.History[m_Next] = (float)counter.Last;
+    }
+
+    // counters registered later start with zeros in their history
+    m_Next = (m_Next + 1) % HISTORY_SIZE;
+    m_Frames = std::min(m_Frames + 1, HISTORY_SIZE);
+}
+
+void CounterRegistry::WriteCsv(std::ostream &out) const
+{
+    int count = Count();
+
+    out << "frame";
+    for (int id = 0; id < count; id++)
+        out << ',' << m_Counters[id].Name;
+    out << '\n';
+
+    for (int frame = 0; frame < m_Frames; frame++)
+    {
+        int index = (HistoryOffset() + frame) % HISTORY_SIZE;
+
+        out << frame;
+        for (int id = 0; id < count; id++)
+            out << ',' << (int64_t)m_Counters[id].History[index];
+        out << '\n';
+    }
+}
+
+CounterRegistry &CounterRegistry::Global()
+{
+    static CounterRegistry registry;
+    return registry;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+enum class CounterKind
+{
+    PerFrame, // summed over a frame and cleared for the next one
+    Gauge     // keeps the last value set
+};
+
+// Numbers any subsystem publishes, kept for the last HISTORY_SIZE frames. A counter is registered
+// once by name, under a lock, into a table that never moves, so publishing a value is a single
+// relaxed atomic operation that never waits, from any thread. NewFrame, on the main thread, moves
+// the values of the frame into the history; an add racing with it lands in the next frame.
+class CounterRegistry
+{
+public:
+    static constexpr int MAX_COUNTERS = 64;
+    static constexpr int HISTORY_SIZE = 240;
+    static constexpr int INVALID_ID = -1;
+
+    // the id of the counter with this name, registered on first use, INVALID_ID once the table is
+    // full; the kind of the first registration is kept
+    int Register(const char *name, CounterKind kind = CounterKind::PerFrame);
+
+    void Add(int id, int64_t value = 1)
+    {
+        if (id != INVALID_ID)
+            m_Counters[id].Value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void Set(int id, int64_t value)
+    {
+        if (id != INVALID_ID)
+            m_Counters[id].Value.store(value, std::memory_order_relaxed);
+    }
+
+    void NewFrame();
+
+    int Count() const { return m_Count.load(std::memory_order_acquire); }
+    const std::string &Name(int id) const { return m_Counters[id].Name; }
+    CounterKind Kind(int id) const { return m_Counters[id].Kind; }
+
+    // of the frame that is still being recorded
+    int64_t Value(int id) const { return m_Counters[id].Value.load(std::memory_order_relaxed); }
+
+    // of the last frame NewFrame closed
+    int64_t LastFrame(int id) const { return m_Counters[id].Last; }
+
+    // the history is a ring of Frames() values that starts at HistoryOffset(), as ImGui::PlotLines
+    // takes it; only the main thread reads it
+    const float *History(int id) const { return m_Counters[id].History; }
+    int Frames() const { return m_Frames; }
+    int HistoryOffset() const { return m_Frames < HISTORY_SIZE ? 0 : m_Next; }
+
+    // the history, a column per counter and a row per frame, oldest first
+    void WriteCsv(std::ostream &out) const;
+
+    static CounterRegistry &Global();
+
+private:
+    struct Counter
+    {
+        std::atomic<int64_t> Value = 0;
+        std::string Name;
+        CounterKind Kind = CounterKind::PerFrame;
+
+        int64_t Last = 0;
+        float History[HISTORY_SIZE] = {};
+    };
+
+    std::mutex m_RegisterMutex;
+    std::atomic<int> m_Count = 0;
+    Counter m_Counters[MAX_COUNTERS];
+
+    int m_Next = 0;
+    int m_Frames = 0;
+};
+
+// The counter is looked up once per call site, e.g. COUNTER_ADD("Draw Calls", 1)
+#define COUNTER_ADD(name, value)                                                                   \
+    do                                                                                             \
+    {                                                                                              \
+        static const int counterId = ::CounterRegistry::Global().Register(name);                   \
+        ::CounterRegistry::Global().Add(counterId, value);                                         \
+    } while (0)
+
+#define COUNTER_SET(name, value)                                                                   \
+    do                                                                                             \
+    {                                                                                              \
+        static const int counterId =                                                               \
+            ::CounterRegistry::Global().Register(name, ::CounterKind::Gauge);                      \
+        ::CounterRegistry::Global().Set(counterId, value);                                         \
+    } while (0)
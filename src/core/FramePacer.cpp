@@ -0,0 +1,80 @@
+#include "pch.h"
+#include "FramePacer.h"
+
+FramePacer::FramePacer(Clock &clock)
+    : m_Clock(clock)
+{
+    m_Errors.reserve(HISTORY_SIZE);
+}
+
+void FramePacer::SetTargetFps(double fps)
+{
+    int64_t period = fps > 0.0 ? (int64_t)(1.0e9 / fps) : 0;
+    if (period == m_Period)
+        return;
+
+    m_Period = period;
+    m_Deadline = 0;
+    m_Errors.clear();
+    m_NextError = 0;
+}
+
+void FramePacer::Wait()
+{
+    m_LastSpin = 0;
+    if (m_Period == 0)
+        return;
+
+    int64_t now = m_Clock.Now();
+    if (m_Deadline == 0)
+    {
+        m_Deadline = now + m_Period;
+        return;
+    }
+
+    if (now < m_Deadline)
+    {
+        int64_t wakeUp = m_SpinEnabled ? m_Deadline - m_SpinMargin : m_Deadline;
+        if (wakeUp > now)
+        {
+            m_Clock.Sleep(wakeUp - now);
+            now = m_Clock.Now();
+
+            // keeps the margin a little above the latest recent wake up
+            int64_t oversleep = std::max<int64_t>(now - wakeUp, 0);
+            m_Oversleep = std::max(oversleep, m_Oversleep - m_Oversleep / 32);
+            int64_t maxMargin = std::max(MIN_SPIN_MARGIN, std::min(MAX_SPIN_MARGIN, m_Period / 2));
+            m_SpinMargin = std::clamp(m_Oversleep + m_Oversleep / 4, MIN_SPIN_MARGIN, maxMargin);
+        }
+
+        int64_t spinStart = now;
+        while (now < m_Deadline)
+            now = m_Clock.Now();
+        m_LastSpin = now - spinStart;
+    }
+
+    RecordError(now - m_Deadline);
+
+    if (now - m_Deadline > m_Period)
+        m_Deadline = now + m_Period;
+    else
+        m_Deadline += m_Period;
+}
+
+FrameStats FramePacer::DeadlineErrors() const
+{
+    return FrameStats::Compute(m_Errors);
+}
+
+void FramePacer::RecordError(int64_t error)
+{
+    double us = error * 1.0e-3;
+    if (m_Errors.size() < HISTORY_SIZE)
+    {
+        m_Errors.push_back(us);
+        return;
+    }
+
+    m_Errors[m_NextError] = us;
+    m_NextError = (m_NextError + 1) % HISTORY_SIZE;
+}
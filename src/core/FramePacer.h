@@ -0,0 +1,55 @@
+#pragma once
+
+#include "pch.h"
+#include "Clock.h"
+#include "FrameStats.h"
+
+// Holds the frame rate at a target by waiting at the end of every frame until the frame is due.
+// Most of the wait is slept, the last part, the spin margin, is spun on the clock since a sleep
+// may wake up late. The margin follows how late the recent sleeps woke up. A frame that misses its
+// deadline by more than a whole period starts the schedule over, so the frames after a hitch are
+// not rushed to catch up.
+class FramePacer
+{
+public:
+    FramePacer(Clock &clock = Clock::System());
+
+    // 0 turns the limit off
+    void SetTargetFps(double fps);
+    double GetTargetFps() const { return m_Period > 0 ? 1.0e9 / m_Period : 0.0; }
+
+    // false sleeps the whole wait, for comparison
+    void SetSpinEnabled(bool enabled) { m_SpinEnabled = enabled; }
+
+    // call once per frame, before the timer ticks
+    void Wait();
+
+    // how late Wait returned over the last frames, in us
+    FrameStats DeadlineErrors() const;
+
+    double SpinMarginMs() const { return m_SpinMargin * 1.0e-6; }
+
+    // time spent spinning in the last Wait
+    double LastSpinMs() const { return m_LastSpin * 1.0e-6; }
+
+    static constexpr int64_t MIN_SPIN_MARGIN = 250'000; // ns
+    static constexpr int64_t MAX_SPIN_MARGIN = 4'000'000;
+    static constexpr size_t HISTORY_SIZE = 600;
+
+private:
+    void RecordError(int64_t error);
+
+private:
+    Clock &m_Clock;
+
+    int64_t m_Period = 0;   // ns, 0 without a limit
+    int64_t m_Deadline = 0; // of the current frame, 0 until the first Wait
+    bool m_SpinEnabled = true;
+
+    int64_t m_SpinMargin = 2'000'000;
+    int64_t m_Oversleep = 0; // the latest recent wake up, decays over the frames
+    int64_t m_LastSpin = 0;
+
+    std::vector<double> m_Errors;
+    size_t m_NextError = 0;
+};
@@ -0,0 +1,41 @@
+#include "pch.h"
+#include "FrameStats.h"
+
+FrameStats FrameStats::Compute(std::vector<double> samples)
+{
+    FrameStats stats;
+    stats.Count = (int)samples.size();
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+    stats.Min = samples.front();
+    stats.Max = samples.back();
+    stats.P50 = Percentile(samples, 0.50);
+    stats.P95 = Percentile(samples, 0.95);
+    stats.P99 = Percentile(samples, 0.99);
+
+    double sum = 0.0;
+    for (double sample : samples)
+        sum += sample;
+    stats.Mean = sum / samples.size();
+
+    // the sample standard deviation, the frames are a sample of all the frames the path could have
+    double squares = 0.0;
+    for (double sample : samples)
+        squares += (sample - stats.Mean) * (sample - stats.Mean);
+    stats.StdDev = samples.size() > 1 ? sqrt(squares / (samples.size() - 1)) : 0.0;
+
+    return stats;
+}
+
+double FrameStats::Percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    double rank = std::clamp(p, 0.0, 1.0) * (sorted.size() - 1);
+    size_t lower = (size_t)rank;
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (rank - lower) * (sorted[upper] - sorted[lower]);
+}
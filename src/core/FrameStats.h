@@ -0,0 +1,21 @@
+#pragma once
+
+#include "pch.h"
+
+// Summary of a series of frame times in milliseconds.
+struct FrameStats
+{
+    int Count = 0;
+    double Mean = 0.0;
+    double StdDev = 0.0;
+    double Min = 0.0;
+    double Max = 0.0;
+    double P50 = 0.0;
+    double P95 = 0.0;
+    double P99 = 0.0;
+
+    static FrameStats Compute(std::vector<double> samples);
+
+    // linear interpolation between the closest ranks of the sorted samples, p in [0, 1]
+    static double Percentile(const std::vector<double> &sorted, double p);
+};
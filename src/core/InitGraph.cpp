@@ -0,0 +1,348 @@
+#include "pch.h"
+#include "InitGraph.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iomanip>
+
+InitGraph::InitGraph(Clock &clock)
+    : m_Clock(clock)
+{
+}
+
+void InitGraph::Add(const std::string &name, const std::vector<std::string> &dependencies, std::function<void()> func,
+                    Affinity affinity)
+{
+    Step step;
+    step.Name = name;
+    step.Dependencies = dependencies;
+    step.Func = std::move(func);
+    step.MainThread = affinity == Affinity::MainThread;
+    m_Steps.push_back(std::move(step));
+}
+
+std::vector<std::string> InitGraph::Names() const
+{
+    std::vector<std::string> names;
+    for (const auto &step : m_Steps)
+        names.push_back(step.Name);
+    return names;
+}
+
+size_t InitGraph::Find(const std::string &name) const
+{
+    for (size_t i = 0; i < m_Steps.size(); i++)
+    {
+        if (m_Steps[i].Name == name)
+            return i;
+    }
+    return m_Steps.size();
+}
+
+std::string InitGraph::Validate() const
+{
+    for (size_t i = 0; i < m_Steps.size(); i++)
+    {
+        if (Find(m_Steps[i].Name) != i)
+            return "step '" + m_Steps[i].Name + "' is added twice";
+
+        for (const auto &dependency : m_Steps[i].Dependencies)
+        {
+            if (Find(dependency) == m_Steps.size())
+                return "step '" + m_Steps[i].Name + "' depends on '" + dependency + "', which is no step";
+        }
+    }
+
+    // whatever is left after taking away the steps without dependencies, again and again, lies on a cycle
+    std::vector<size_t> waiting(m_Steps.size());
+    for (size_t i = 0; i < m_Steps.size(); i++)
+        waiting[i] = m_Steps[i].Dependencies.size();
+
+    for (bool progress = true; progress;)
+    {
+        progress = false;
+        for (size_t i = 0; i < m_Steps.size(); i++)
+        {
+            if (waiting[i] != 0)
+                continue;
+
+            waiting[i] = SIZE_MAX;
+            progress = true;
+            for (size_t j = 0; j < m_Steps.size(); j++)
+            {
+                for (const auto &dependency : m_Steps[j].Dependencies)
+                    waiting[j] -= dependency == m_Steps[i].Name && waiting[j] != SIZE_MAX ? 1 : 0;
+            }
+        }
+    }
+
+    std::string cycle;
+    for (size_t i = 0; i < m_Steps.size(); i++)
+    {
+        if (waiting[i] != SIZE_MAX)
+            cycle += (cycle.empty() ? "'" : ", '") + m_Steps[i].Name + "'";
+    }
+    return cycle.empty() ? std::string() : "the steps " + cycle + " depend on each other";
+}
+
+bool InitGraph::Run(UINT numWorkers)
+{
+    std::string error = Validate();
+    if (!error.empty())
+    {
+        LOG_ERROR("InitGraph: {}", error);
+        return false;
+    }
+
+    const size_t count = m_Steps.size();
+
+    std::vector<size_t> waiting(count);
+    std::vector<std::vector<size_t>> dependents(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        waiting[i] = m_Steps[i].Dependencies.size();
+        for (const auto &dependency : m_Steps[i].Dependencies)
+            dependents[Find(dependency)].push_back(i);
+    }
+
+    UINT numWorkerSteps = 0;
+    for (const auto &step : m_Steps)
+        numWorkerSteps += step.MainThread ? 0 : 1;
+    numWorkers = std::min(numWorkers, numWorkerSteps);
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<size_t> mainReady, workerReady;
+    size_t finished = 0, running = 0;
+    std::exception_ptr exception;
+    bool stop = false;
+
+    auto push = [&](size_t i)
+    {
+        (m_Steps[i].MainThread || numWorkers == 0 ? mainReady : workerReady).push_back(i);
+    };
+
+    auto done = [&]()
+    {
+        return finished == count || (exception && running == 0);
+    };
+
+    const int64_t origin = m_Clock.Now();
+
+    // called and returns with the lock held, which is let go of while the step runs
+    auto run = [&](size_t i, int thread, std::unique_lock<std::mutex> &lock)
+    {
+        running++;
+        lock.unlock();
+
+        Step &step = m_Steps[i];
+        step.Thread = thread;
+        step.Start = m_Clock.Now() - origin;
+
+        std::exception_ptr failure;
+        try
+        {
+            PROFILE_SCOPE(Profiler::Intern(step.Name));
+            step.Func();
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+        }
+
+        step.End = m_Clock.Now() - origin;
+
+        lock.lock();
+        running--;
+        finished++;
+
+        if (failure && !exception)
+        {
+            exception = failure;
+            mainReady.clear();
+            workerReady.clear();
+        }
+
+        if (!exception)
+        {
+            for (size_t dependent : dependents[i])
+            {
+                if (--waiting[dependent] == 0)
+                    push(dependent);
+            }
+        }
+
+        wake.notify_all();
+    };
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (waiting[i] == 0)
+            push(i);
+    }
+
+    auto worker = [&](int thread)
+    {
+        PROFILE_THREAD("Init");
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [&]() { return !workerReady.empty() || stop; });
+            if (workerReady.empty())
+                return;
+
+            size_t i = workerReady.front();
+            workerReady.pop_front();
+            run(i, thread, lock);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (UINT i = 0; i < numWorkers; i++)
+        threads.emplace_back(worker, i + 1);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [&]() { return !mainReady.empty() || done(); });
+            if (mainReady.empty())
+                break;
+
+            size_t i = mainReady.front();
+            mainReady.pop_front();
+            run(i, 0, lock);
+        }
+
+        stop = true;
+        wake.notify_all();
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    if (exception)
+        std::rethrow_exception(exception);
+
+    return true;
+}
+
+int64_t InitGraph::Total() const
+{
+    int64_t total = 0;
+    for (const auto &step : m_Steps)
+        total = std::max(total, step.End);
+    return total;
+}
+
+std::vector<size_t> InitGraph::CriticalPath(int64_t *duration) const
+{
+    // the longest chain that ends in every step, the steps are visited after their dependencies
+    std::vector<int64_t> longest(m_Steps.size(), -1);
+    std::vector<size_t> previous(m_Steps.size(), SIZE_MAX);
+
+    for (bool progress = true; progress;)
+    {
+        progress = false;
+        for (size_t i = 0; i < m_Steps.size(); i++)
+        {
+            if (longest[i] >= 0)
+                continue;
+
+            int64_t before = 0;
+            size_t slowest = SIZE_MAX;
+            bool ready = true;
+            for (const auto &dependency : m_Steps[i].Dependencies)
+            {
+                size_t j = Find(dependency);
+                if (j == m_Steps.size() || longest[j] < 0)
+                {
+                    ready = false;
+                    break;
+                }
+                if (slowest == SIZE_MAX || longest[j] > before)
+                {
+                    before = longest[j];
+                    slowest = j;
+                }
+            }
+
+            if (ready)
+            {
+                longest[i] = before + m_Steps[i].End - m_Steps[i].Start;
+                previous[i] = slowest;
+                progress = true;
+            }
+        }
+    }
+
+    size_t last = SIZE_MAX;
+    for (size_t i = 0; i < m_Steps.size(); i++)
+    {
+        if (longest[i] >= 0 && (last == SIZE_MAX || longest[i] > longest[last]))
+            last = i;
+    }
+
+    if (duration)
+        *duration = last == SIZE_MAX ? 0 : longest[last];
+
+    std::vector<size_t> path;
+    for (size_t i = last; i != SIZE_MAX; i = previous[i])
+        path.push_back(i);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void InitGraph::WriteReport(std::ostream &out) const
+{
+    int64_t total = Total();
+    int64_t critical = 0;
+    std::vector<size_t> path = CriticalPath(&critical);
+
+    int64_t work = 0;
+    size_t nameWidth = 4;
+    for (const auto &step : m_Steps)
+    {
+        work += step.End - step.Start;
+        nameWidth = std::max(nameWidth, step.Name.size());
+    }
+
+    std::vector<size_t> order(m_Steps.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return m_Steps[a].Start < m_Steps[b].Start; });
+
+    out << std::fixed << std::setprecision(1);
+    out << "Startup: " << m_Steps.size() << " steps in " << total * 1.0e-6 << " ms, critical path " << critical * 1.0e-6
+        << " ms, " << work * 1.0e-6 << " ms of work\n";
+    out << std::left << std::setw(nameWidth + 2) << "step" << std::setw(8) << "thread" << std::right << std::setw(10) << "start ms"
+        << std::setw(10) << "time ms" << "\n";
+
+    for (size_t i : order)
+    {
+        const Step &step = m_Steps[i];
+
+        std::string bar(BAR_WIDTH, ' ');
+        if (total > 0)
+        {
+            int begin = (int)(step.Start * BAR_WIDTH / total);
+            int end = std::max(begin + 1, (int)((step.End * BAR_WIDTH + total - 1) / total));
+            for (int x = begin; x < std::min(end, BAR_WIDTH); x++)
+                bar[x] = '#';
+        }
+
+        bool onPath = std::find(path.begin(), path.end(), i) != path.end();
+
+        out << std::left << std::setw(nameWidth + 2) << step.Name << std::setw(8)
+            << (step.Thread == 0 ? std::string("main") : std::to_string(step.Thread)) << std::right << std::setw(10)
+            << step.Start * 1.0e-6 << std::setw(10) << (step.End - step.Start) * 1.0e-6 << "  |" << bar << "|"
+            << (onPath ? " *" : "") << "\n";
+    }
+
+    out << "critical path (*):";
+    for (size_t i = 0; i < path.size(); i++)
+        out << (i == 0 ? " " : " > ") << m_Steps[path[i]].Name;
+    out << "\n";
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "pch.h"
+#include "Clock.h"
+#include "Parallel.h"
+
+// Runs the steps of startup as soon as the steps they depend on are done. Steps that need the
+// calling thread, the window or the command list of the DxContext, run there one at a time, the
+// others run on worker threads next to them. Every step is timed for the startup report.
+class InitGraph
+{
+public:
+    enum class Affinity
+    {
+        Worker,
+        MainThread
+    };
+
+    struct Step
+    {
+        std::string Name;
+        std::vector<std::string> Dependencies;
+        std::function<void()> Func;
+        bool MainThread = false;
+
+        // filled in by Run, ns since the start of Run, thread 0 is the calling thread
+        int64_t Start = 0;
+        int64_t End = 0;
+        int Thread = 0;
+    };
+
+    InitGraph(Clock &clock = Clock::System());
+
+    // the dependencies may be added after the step that names them
+    void Add(const std::string &name, const std::vector<std::string> &dependencies, std::function<void()> func,
+             Affinity affinity = Affinity::Worker);
+
+    // names of the steps added so far, for a step that has to wait for all of them
+    std::vector<std::string> Names() const;
+
+    // empty if every dependency is a step and there are no cycles
+    std::string Validate() const;
+
+    // Runs every step once and returns when they are done, false if the graph is not valid. With
+    // no workers the worker steps run on the calling thread as well, in the order they get ready.
+    // An exception thrown by a step lets the running steps finish, skips the rest and is thrown
+    // again from here.
+    bool Run(UINT numWorkers = Parallel::NumThreads() - 1);
+
+    const std::vector<Step> &Steps() const { return m_Steps; }
+
+    // from the start of Run to the end of the last step
+    int64_t Total() const;
+
+    // The longest chain of dependencies by the time its steps took, how long startup takes with any
+    // number of threads. Returns the indices of its steps, first to last.
+    std::vector<size_t> CriticalPath(int64_t *duration = nullptr) const;
+
+    // a line per step in the order they started, with a bar of when it ran, then the totals
+    void WriteReport(std::ostream &out) const;
+
+    static constexpr int BAR_WIDTH = 40;
+
+private:
+    size_t Find(const std::string &name) const;
+
+private:
+    Clock &m_Clock;
+    std::vector<Step> m_Steps;
+};
@@ -1,11 +1,96 @@
 #include "Log.h"
 
-std::shared_ptr<spdlog::logger> Log::s_Logger;
+#include <spdlog/cfg/env.h>
 
-void Log::Init()
+std::shared_ptr<spdlog::logger> Log::s_Loggers[(int)LogChannel::Count];
+spdlog::sink_ptr Log::s_Sink;
+bool Log::s_Async = false;
+
+void Log::Init(const LogSettings &settings)
 {
     spdlog::set_pattern("%^[%T] %6n: %v%$");
+    spdlog::set_level(spdlog::level::trace);
+
+    // all channels share the sink and its lock, which only the worker takes in async mode
+    s_Sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+
+    s_Async = settings.Async;
+    if (s_Async)
+        spdlog::init_thread_pool(settings.QueueSize, 1);
+
+    CreateLoggers(s_Async, settings.Overflow);
+    spdlog::cfg::load_env_levels();
+
+    spdlog::flush_every(std::chrono::seconds(settings.FlushIntervalSeconds));
+
+    // the queue has to be written out before the statics of spdlog are destroyed, which happens
+    // after the handlers registered from here on
+    static bool shutdownRegistered = false;
+    if (!shutdownRegistered)
+    {
+        std::atexit(Shutdown);
+        shutdownRegistered = true;
+    }
+}
+
+void Log::Shutdown()
+{
+    if (!s_Async)
+        return;
+
+    // drops the last reference to the thread pool, whose worker writes out the queue before it
+    // is joined
+    spdlog::shutdown();
+
+    s_Async = false;
+    CreateLoggers(false, LogOverflow::Block);
+}
+
+const char *Log::ChannelName(LogChannel channel)
+{
+    switch (channel)
+    {
+    case LogChannel::Asset:
+        return "ASSET";
+    case LogChannel::IBL:
+        return "IBL";
+    case LogChannel::Voxel:
+        return "VOXEL";
+    default:
+        return "RENDERER";
+    }
+}
+
+size_t Log::DroppedMessages()
+{
+    if (!s_Async)
+        return 0;
+
+    auto threadPool = spdlog::thread_pool();
+    return threadPool ? threadPool->overrun_counter() : 0;
+}
+
+void Log::CreateLoggers(bool async, LogOverflow overflow)
+{
+    auto policy = overflow == LogOverflow::DropOldest ? spdlog::async_overflow_policy::overrun_oldest
+                                                      : spdlog::async_overflow_policy::block;
+
+    for (int i = 0; i < (int)LogChannel::Count; i++)
+    {
+        const char *name = ChannelName((LogChannel)i);
+        std::shared_ptr<spdlog::logger> previous = s_Loggers[i];
+
+        spdlog::drop(name);
+        if (async)
+            s_Loggers[i] = std::make_shared<spdlog::async_logger>(name, s_Sink, spdlog::thread_pool(), policy);
+        else
+            s_Loggers[i] = std::make_shared<spdlog::logger>(name, s_Sink);
+
+        // takes the pattern and level set on spdlog and registers the logger
+        spdlog::initialize_logger(s_Loggers[i]);
+        if (previous)
+            s_Loggers[i]->set_level(previous->level());
 
-    s_Logger = spdlog::stdout_color_mt("RENDERER");
-    s_Logger->set_level(spdlog::level::trace);
-}
\ No newline at end of file
+        s_Loggers[i]->flush_on(spdlog::level::err);
+    }
+}
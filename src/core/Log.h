@@ -1,22 +1,76 @@
 #pragma once
 
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
 #include <spdlog/fmt/ostr.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
+// a logger per subsystem, so that their levels can be set apart
+enum class LogChannel
+{
+    Renderer,
+    Asset, // images, meshes and textures
+    IBL,
+    Voxel,
+    Count
+};
+
+enum class LogOverflow
+{
+    Block,     // the caller waits for room in the queue, nothing is lost
+    DropOldest // the oldest queued message makes room, the caller never waits
+};
+
+struct LogSettings
+{
+    // messages are formatted on the calling thread and written by a background thread
+    bool Async = true;
+    size_t QueueSize = 8192; // messages
+    LogOverflow Overflow = LogOverflow::Block;
+    int FlushIntervalSeconds = 1;
+};
+
 class Log
 {
 public:
-    static void Init();
+    // the levels can be overridden with the SPDLOG_LEVEL environment variable, e.g.
+    // SPDLOG_LEVEL=info,ASSET=warn
+    static void Init(const LogSettings &settings = LogSettings());
 
-    static std::shared_ptr<spdlog::logger> &GetLogger() { return s_Logger; }
+    // writes out what is still queued, later messages are written synchronously; runs at exit and
+    // when an assertion fails
+    static void Shutdown();
+
+    static std::shared_ptr<spdlog::logger> &GetLogger(LogChannel channel = LogChannel::Renderer) { return s_Loggers[(int)channel]; }
+
+    static void SetLevel(LogChannel channel, spdlog::level::level_enum level) { s_Loggers[(int)channel]->set_level(level); }
+    static spdlog::level::level_enum GetLevel(LogChannel channel) { return s_Loggers[(int)channel]->level(); }
+
+    static const char *ChannelName(LogChannel channel);
+
+    static bool IsAsync() { return s_Async; }
+
+    // messages dropped by LogOverflow::DropOldest since Init
+    static size_t DroppedMessages();
+
+private:
+    static void CreateLoggers(bool async, LogOverflow overflow);
 
 private:
-    static std::shared_ptr<spdlog::logger> s_Logger;
+    static std::shared_ptr<spdlog::logger> s_Loggers[(int)LogChannel::Count];
+    static spdlog::sink_ptr s_Sink;
+    static bool s_Async;
 };
 
 #define LOG_CRITICAL(...) ::Log::GetLogger()->critical(__VA_ARGS__)
 #define LOG_ERROR(...) ::Log::GetLogger()->error(__VA_ARGS__)
 #define LOG_WARN(...) ::Log::GetLogger()->warn(__VA_ARGS__)
 #define LOG_INFO(...) ::Log::GetLogger()->info(__VA_ARGS__)
-#define LOG_TRACE(...) ::Log::GetLogger()->trace(__VA_ARGS__)
\ No newline at end of file
+#define LOG_TRACE(...) ::Log::GetLogger()->trace(__VA_ARGS__)
+
+// e.g. LOG_CHANNEL_INFO(Asset, "Loading image: {}", filename)
+#define LOG_CHANNEL_CRITICAL(channel, ...) ::Log::GetLogger(::LogChannel::channel)->critical(__VA_ARGS__)
+#define LOG_CHANNEL_ERROR(channel, ...) ::Log::GetLogger(::LogChannel::channel)->error(__VA_ARGS__)
+#define LOG_CHANNEL_WARN(channel, ...) ::Log::GetLogger(::LogChannel::channel)->warn(__VA_ARGS__)
+#define LOG_CHANNEL_INFO(channel, ...) ::Log::GetLogger(::LogChannel::channel)->info(__VA_ARGS__)
+#define LOG_CHANNEL_TRACE(channel, ...) ::Log::GetLogger(::LogChannel::channel)->trace(__VA_ARGS__)
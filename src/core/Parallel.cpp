@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "Parallel.h"
+
+#include <exception>
+
+void Parallel::For(UINT count, const std::function<void(UINT)> &func, UINT grainSize)
+{
+    grainSize = std::max(grainSize, 1u);
+
+    UINT numChunks = (count + grainSize - 1) / grainSize;
+    UINT numThreads = std::min(NumThreads(), numChunks);
+
+    if (numThreads <= 1)
+    {
+        for (UINT i = 0; i < count; i++)
+            func(i);
+        return;
+    }
+
+    std::atomic<UINT> nextChunk = 0;
+
+    std::mutex mutex;
+    std::exception_ptr exception;
+
+    auto worker = [&]()
+    {
+        PROFILE_SCOPE("Parallel::For");
+
+        try
+        {
+            for (UINT chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++)
+            {
+                UINT end = std::min(count, (chunk + 1) * grainSize);
+                for (UINT i = chunk * grainSize; i < end; i++)
+                    func(i);
+            }
+        }
+        catch (...)
+        {
+            // no chunks are handed out after this, the ones that are running finish
+            nextChunk = numChunks;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!exception)
+                exception = std::current_exception();
+        }
+    };
+
+    // the calling thread takes part in the work as well
+    std::vector<std::thread> threads;
+    for (UINT i = 1; i < numThreads; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto &thread : threads)
+        thread.join();
+
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+UINT Parallel::NumThreads()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "pch.h"
+
+class Parallel
+{
+public:
+    // Calls func(i) for every i in [0, count) from all hardware threads, returns once all calls are done.
+    // Indices are handed out in chunks of grainSize to keep the contention on the shared counter low.
+    // The first exception thrown by func stops the remaining chunks and is thrown again from here,
+    // after every thread has been joined.
+    static void For(UINT count, const std::function<void(UINT)> &func, UINT grainSize = 1);
+
+    static UINT NumThreads();
+};
@@ -0,0 +1,286 @@
+#include "pch.h"
+#include "Profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+ProfileBuffer::ProfileBuffer(uint32_t id)
+    : Name("Thread " + std::to_string(id)), m_Id(id), m_Events(Capacity)
+{
+}
+
+uint64_t ProfileBuffer::Drain(std::vector<ProfileEvent> &events)
+{
+    uint64_t written = m_Written.load(std::memory_order_acquire);
+    uint64_t dropped = 0;
+
+    if (written - m_Read > Capacity)
+    {
+        dropped = written - Capacity - m_Read;
+        m_Read = written - Capacity;
+    }
+
+    size_t first = events.size();
+    for (uint64_t i = m_Read; i < written; i++)
+        events.push_back(m_Events[i & (Capacity - 1)]);
+
+    // the writer keeps going while the events are copied and may have overwritten the oldest ones
+    uint64_t overwritten = m_Written.load(std::memory_order_acquire);
+    if (overwritten > m_Read + Capacity)
+    {
+        uint64_t lost = std::min(overwritten - Capacity - m_Read, written - m_Read);
+        events.erase(events.begin() + first, events.begin() + first + lost);
+        dropped += lost;
+    }
+
+    m_Read = written;
+    return dropped;
+}
+
+// hands the buffer back when its thread exits
+struct ProfileBufferOwner
+{
+    ~ProfileBufferOwner() { Profiler::ReleaseBuffer(); }
+};
+
+thread_local ProfileBuffer *Profiler::s_ThreadBuffer = nullptr;
+
+std::mutex Profiler::s_Mutex;
+std::vector<std::unique_ptr<ProfileBuffer>> Profiler::s_Buffers;
+std::unordered_set<std::string> Profiler::s_Names;
+
+ProfileFrame Profiler::s_LastFrame;
+uint64_t Profiler::s_FrameIndex = 0;
+int64_t Profiler::s_FrameStart = 0;
+uint64_t Profiler::s_DroppedEvents = 0;
+
+int Profiler::s_CaptureFramesLeft = 0;
+std::string Profiler::s_CaptureFilename;
+std::vector<ProfileFrame> Profiler::s_CapturedFrames;
+
+double Profiler::TicksToNs(int64_t ticks)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    // counts the ticks of a few milliseconds once
+    static const double nsPerTick = []()
+    {
+        auto clockStart = std::chrono::steady_clock::now();
+        int64_t start = Now();
+
+        std::chrono::steady_clock::duration elapsed;
+        do
+            elapsed = std::chrono::steady_clock::now() - clockStart;
+        while (elapsed < std::chrono::milliseconds(20));
+
+        return std::chrono::duration<double, std::nano>(elapsed).count() / (double)(Now() - start);
+    }();
+    return ticks * nsPerTick;
+#else
+    return (double)ticks;
+#endif
+}
+
+ProfileBuffer *Profiler::AcquireBuffer()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+
+        for (auto &buffer : s_Buffers)
+        {
+            if (!buffer->InUse)
+            {
+                s_ThreadBuffer = buffer.get();
+                break;
+            }
+        }
+
+        if (!s_ThreadBuffer)
+        {
+            s_Buffers.push_back(std::make_unique<ProfileBuffer>((uint32_t)s_Buffers.size()));
+            s_ThreadBuffer = s_Buffers.back().get();
+        }
+
+        s_ThreadBuffer->InUse = true;
+    }
+
+    thread_local ProfileBufferOwner owner;
+    return s_ThreadBuffer;
+}
+
+void Profiler::ReleaseBuffer()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+
+    // the events still in the buffer are drained with the next frame
+    s_ThreadBuffer->InUse = false;
+    s_ThreadBuffer->Depth = 0;
+    s_ThreadBuffer->Name = "Thread " + std::to_string(s_ThreadBuffer->Id());
+    s_ThreadBuffer = nullptr;
+}
+
+void Profiler::SetThreadName(const char *name)
+{
+    ProfileBuffer *buffer = ThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    buffer->Name = name;
+}
+
+ProfileBuffer *Profiler::AddTrack(const char *name)
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+
+    s_Buffers.push_back(std::make_unique<ProfileBuffer>((uint32_t)s_Buffers.size()));
+    s_Buffers.back()->InUse = true;
+    s_Buffers.back()->Name = name;
+    return s_Buffers.back().get();
+}
+
+const char *Profiler::Intern(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+
+    // the nodes of the set never move
+    return s_Names.insert(name).first->c_str();
+}
+
+std::string Profiler::ThreadName(uint32_t thread)
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    return thread < s_Buffers.size() ? s_Buffers[thread]->Name : std::string();
+}
+
+size_t Profiler::NumBuffers()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    return s_Buffers.size();
+}
+
+void Profiler::NewFrame()
+{
+    int64_t now = Now();
+
+    ProfileFrame frame;
+    frame.Index = s_FrameIndex++;
+    frame.Start = s_FrameStart;
+    frame.End = now;
+    frame.Events.reserve(s_LastFrame.Events.size());
+
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        for (auto &buffer : s_Buffers)
+            s_DroppedEvents += buffer->Drain(frame.Events);
+    }
+
+    // a scope starts before the ones nested in it, ties only happen between a parent and its
+    // children at the resolution of the clock
+    auto earlier = [](const ProfileEvent &a, const ProfileEvent &b)
+    {
+        if (a.Thread != b.Thread)
+            return a.Thread < b.Thread;
+        if (a.Start != b.Start)
+            return a.Start < b.Start;
+        return a.Depth < b.Depth;
+    };
+    std::sort(frame.Events.begin(), frame.Events.end(), earlier);
+
+    s_FrameStart = now;
+
+    // the first frame has no start, it only collects what happened before the main loop
+    if (frame.Index == 0)
+        frame.Start = frame.Events.empty() ? now : frame.Events.front().Start;
+
+    if (s_CaptureFramesLeft > 0)
+    {
+        s_CapturedFrames.push_back(frame);
+
+        if (--s_CaptureFramesLeft == 0)
+        {
+            std::ofstream file(s_CaptureFilename);
+            WriteChromeTrace(file, s_CapturedFrames);
+            LOG_INFO("Profiler: wrote {} frame(s) to {}", s_CapturedFrames.size(), s_CaptureFilename);
+            s_CapturedFrames.clear();
+        }
+    }
+
+    s_LastFrame = std::move(frame);
+}
+
+void Profiler::CaptureFrames(int numFrames, const std::string &filename)
+{
+    s_CaptureFramesLeft = std::max(numFrames, 1);
+    s_CaptureFilename = filename;
+    s_CapturedFrames.clear();
+}
+
+static void WriteJsonString(std::ostream &out, const char *str)
+{
+    out << '"';
+    for (; *str; str++)
+    {
+        char c = *str;
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            out << ' ';
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+void Profiler::WriteChromeTrace(std::ostream &out, const std::vector<ProfileFrame> &frames)
+{
+    // timestamps are in microseconds relative to the first frame
+    int64_t origin = frames.empty() ? 0 : frames.front().Start;
+    auto micros = [origin](int64_t ticks)
+    {
+        return TicksToNs(ticks - origin) * 1.0e-3;
+    };
+
+    std::vector<bool> threads;
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    out.precision(3);
+    out << std::fixed;
+
+    bool first = true;
+    auto separator = [&]()
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    for (const auto &frame : frames)
+    {
+        separator();
+        out << "{\"name\":\"Frame " << frame.Index << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":" << micros(frame.Start) << "}";
+
+        for (const auto &event : frame.Events)
+        {
+            if (event.Thread >= threads.size())
+                threads.resize(event.Thread + 1, false);
+            threads[event.Thread] = true;
+
+            separator();
+            out << "{\"name\":";
+            WriteJsonString(out, event.Name);
+            out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.Thread
+                << ",\"ts\":" << micros(event.Start) << ",\"dur\":" << TicksToNs(event.End - event.Start) * 1.0e-3 << "}";
+        }
+    }
+
+    for (uint32_t i = 0; i < threads.size(); i++)
+    {
+        if (!threads[i])
+            continue;
+
+        separator();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":";
+        WriteJsonString(out, ThreadName(i).c_str());
+        out << "}}";
+    }
+
+    out << "\n]}\n";
+}
+
+#endif
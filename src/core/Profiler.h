@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// The CPU profiler is compiled in with the YARENDERER_PROFILER build option, which defines
+// ENABLE_PROFILER. Without it the macros below expand to nothing.
+#ifdef ENABLE_PROFILER
+
+#if defined(_M_X64) || defined(__x86_64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+struct ProfileEvent
+{
+    const char *Name; // string literal, only the pointer is kept
+    int64_t Start;    // in ticks of Profiler::Now
+    int64_t End;
+    uint32_t Depth;  // number of enclosing scopes on the same thread
+    uint32_t Thread; // id of the thread buffer
+};
+
+struct ProfileFrame
+{
+    uint64_t Index = 0;
+    int64_t Start = 0;
+    int64_t End = 0;
+
+    // the scopes that ended during the frame, sorted by thread and start time, so that every
+    // scope is directly followed by the scopes nested in it
+    std::vector<ProfileEvent> Events;
+};
+
+// Events of a single thread. Only the owning thread writes and only the main thread reads at the
+// frame boundary. Both sides keep ever growing counters into the ring, so neither of them locks.
+class ProfileBuffer
+{
+public:
+    static constexpr uint32_t Capacity = 1 << 13;
+
+    ProfileBuffer(uint32_t id);
+
+    void Push(const char *name, int64_t start, int64_t end, uint32_t depth)
+    {
+        uint64_t written = m_Written.load(std::memory_order_relaxed);
+        m_Events[written & (Capacity - 1)] = {name, start, end, depth, m_Id};
+        m_Written.store(written + 1, std::memory_order_release);
+    }
+
+    // appends the events written since the last call, returns the number of events lost because
+    // the writer went around the ring before they were read
+    uint64_t Drain(std::vector<ProfileEvent> &events);
+
+    uint32_t Id() const { return m_Id; }
+
+    uint32_t Depth = 0;
+    bool InUse = false;
+    std::string Name;
+
+private:
+    uint32_t m_Id;
+    std::vector<ProfileEvent> m_Events;
+    std::atomic<uint64_t> m_Written = 0;
+    uint64_t m_Read = 0;
+};
+
+// Hierarchical scope profiler. Every thread records into its own buffer, which are gathered into
+// a frame by NewFrame on the main thread. Buffers of threads that exit are reused by new threads.
+class Profiler
+{
+public:
+    // reads the time stamp counter, which is invariant on every x64 CPU this runs on and far
+    // cheaper than QueryPerformanceCounter, the ticks are calibrated against the steady clock
+    static int64_t Now()
+    {
+#if defined(_M_X64) || defined(__x86_64__)
+        return (int64_t)__rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static double TicksToNs(int64_t ticks);
+    static double TicksToMs(int64_t ticks) { return TicksToNs(ticks) * 1.0e-6; }
+
+    static ProfileBuffer *ThreadBuffer() { return s_ThreadBuffer ? s_ThreadBuffer : AcquireBuffer(); }
+    static void SetThreadName(const char *name);
+
+    // a buffer that belongs to no thread, for events timed elsewhere such as on the GPU, the
+    // caller is its only writer
+    static ProfileBuffer *AddTrack(const char *name);
+
+    // a copy of name that lives as long as the profiler, for scope names built at runtime
+    static const char *Intern(const std::string &name);
+
+    // closes the current frame, call once per frame from the main thread
+    static void NewFrame();
+
+    static const ProfileFrame &LastFrame() { return s_LastFrame; }
+    static std::string ThreadName(uint32_t thread);
+    static size_t NumBuffers();
+    static uint64_t DroppedEvents() { return s_DroppedEvents; }
+
+    // writes the next numFrames frames to a Chrome trace file, which Perfetto opens as well
+    static void CaptureFrames(int numFrames, const std::string &filename);
+    static bool IsCapturing() { return s_CaptureFramesLeft > 0; }
+
+    static void WriteChromeTrace(std::ostream &out, const std::vector<ProfileFrame> &frames);
+
+private:
+    static ProfileBuffer *AcquireBuffer();
+    static void ReleaseBuffer();
+
+    friend struct ProfileBufferOwner;
+
+private:
+    static thread_local ProfileBuffer *s_ThreadBuffer;
+
+    static std::mutex s_Mutex;
+    static std::vector<std::unique_ptr<ProfileBuffer>> s_Buffers;
+    static std::unordered_set<std::string> s_Names;
+
+    static ProfileFrame s_LastFrame;
+    static uint64_t s_FrameIndex;
+    static int64_t s_FrameStart;
+    static uint64_t s_DroppedEvents;
+
+    static int s_CaptureFramesLeft;
+    static std::string s_CaptureFilename;
+    static std::vector<ProfileFrame> s_CapturedFrames;
+};
+
+class ProfileScope
+{
+public:
+    ProfileScope(const char *name)
+        : m_Name(name), m_Buffer(Profiler::ThreadBuffer()), m_Depth(m_Buffer->Depth++)
+    {
+        m_Start = Profiler::Now();
+    }
+
+    ~ProfileScope()
+    {
+        int64_t end = Profiler::Now();
+        m_Buffer->Depth--;
+        m_Buffer->Push(m_Name, m_Start, end, m_Depth);
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    const char *m_Name;
+    ProfileBuffer *m_Buffer;
+    uint32_t m_Depth;
+    int64_t m_Start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) ::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD(name) ::Profiler::SetThreadName(name)
+#define PROFILE_FRAME() ::Profiler::NewFrame()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+#define PROFILE_FRAME()
+
+#endif
@@ -0,0 +1,88 @@
+#include "pch.h"
+#include "RangeAllocator.h"
+
+RangeAllocator::RangeAllocator(UINT64 capacity)
+{
+    Reset(capacity);
+}
+
+void RangeAllocator::Reset(UINT64 capacity)
+{
+    m_FreeRanges.clear();
+    m_Capacity = capacity;
+    m_UsedSize = 0;
+
+    if (capacity > 0)
+        m_FreeRanges[0] = capacity;
+}
+
+UINT64 RangeAllocator::Allocate(UINT64 size, UINT64 alignment)
+{
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, "The alignment has to be a power of two.");
+
+    if (size == 0)
+        return InvalidOffset;
+
+    for (auto it = m_FreeRanges.begin(); it != m_FreeRanges.end(); ++it)
+    {
+        UINT64 start = it->first;
+        UINT64 offset = (start + alignment - 1) & ~(alignment - 1);
+        UINT64 padding = offset - start;
+        if (it->second < padding + size)
+            continue;
+
+        UINT64 remaining = it->second - padding - size;
+
+        if (padding > 0)
+            it->second = padding;
+        else
+            m_FreeRanges.erase(it);
+
+        if (remaining > 0)
+            m_FreeRanges[offset + size] = remaining;
+
+        m_UsedSize += size;
+        return offset;
+    }
+
+    return InvalidOffset;
+}
+
+void RangeAllocator::Free(UINT64 offset, UINT64 size)
+{
+    if (offset == InvalidOffset || size == 0)
+        return;
+
+    ASSERT(offset + size <= m_Capacity, "Freeing a range outside of the allocator.");
+    m_UsedSize -= size;
+
+    auto next = m_FreeRanges.lower_bound(offset);
+
+    // merge with the following free range
+    if (next != m_FreeRanges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = m_FreeRanges.erase(next);
+    }
+
+    // merge with the preceding free range
+    if (next != m_FreeRanges.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            prev->second += size;
+            return;
+        }
+    }
+
+    m_FreeRanges[offset] = size;
+}
+
+UINT64 RangeAllocator::LargestFreeRange() const
+{
+    UINT64 largest = 0;
+    for (const auto &[offset, size] : m_FreeRanges)
+        largest = std::max(largest, size);
+    return largest;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "pch.h"
+
+// First-fit allocator handing out [offset, offset + size) ranges of an abstract
+// address space, e.g. elements of a large GPU buffer. Freed neighbours are merged.
+// The padding in front of an aligned range stays free.
+class RangeAllocator
+{
+public:
+    static const UINT64 InvalidOffset = UINT64_MAX;
+
+    RangeAllocator(UINT64 capacity = 0);
+
+    void Reset(UINT64 capacity);
+
+    // alignment is a power of two
+    UINT64 Allocate(UINT64 size, UINT64 alignment = 1);
+    void Free(UINT64 offset, UINT64 size);
+
+    UINT64 Capacity() const { return m_Capacity; }
+    UINT64 UsedSize() const { return m_UsedSize; }
+    UINT64 LargestFreeRange() const;
+    size_t NumFreeRanges() const { return m_FreeRanges.size(); }
+
+private:
+    // offset -> size of every free range, ordered by offset
+    std::map<UINT64, UINT64> m_FreeRanges;
+
+    UINT64 m_Capacity = 0;
+    UINT64 m_UsedSize = 0;
+};
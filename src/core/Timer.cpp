@@ -1,19 +1,16 @@
 #include "Timer.h"
 
-Timer::Timer()
-    : m_SecondsPerCount(0.0), m_DeltaTime(0.0f), m_BaseTime(0),
+Timer::Timer(Clock &clock)
+    : m_Clock(clock), m_DeltaTime(0.0), m_RawDeltaTime(0.0), m_BaseTime(0),
       m_CurrTime(0), m_PrevTime(0)
 {
-    __int64 countsPerSec;
-    QueryPerformanceFrequency((LARGE_INTEGER *)&countsPerSec);
-    m_SecondsPerCount = 1.0 / (double)countsPerSec;
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
 // time when the clock is stopped.
 float Timer::TotalTime() const
 {
-    return (float)((m_CurrTime - m_BaseTime) * m_SecondsPerCount);
+    return (float)((m_CurrTime - m_BaseTime) * 1.0e-9);
 }
 
 float Timer::DeltaTime() const
@@ -26,22 +23,49 @@ float Timer::DeltaTimeMS() const
     return (float)m_DeltaTime * 1000.0f;
 }
 
+float Timer::RawDeltaTime() const
+{
+    return (float)m_RawDeltaTime;
+}
+
 void Timer::Reset()
 {
-    __int64 currTime;
-    QueryPerformanceCounter((LARGE_INTEGER *)&currTime);
+    int64_t currTime = m_Clock.Now();
     m_BaseTime = currTime;
     m_PrevTime = currTime;
+    m_CurrTime = currTime;
+
+    m_HistoryCount = 0;
+    m_HistoryNext = 0;
+}
+
+void Timer::SetSmoothing(int frames)
+{
+    frames = std::clamp(frames, 1, MAX_SMOOTHING_FRAMES);
+    if (frames == m_SmoothingFrames)
+        return;
+
+    // the frames already in the history are averaged from the start
+    m_SmoothingFrames = frames;
+    m_HistoryCount = 0;
+    m_HistoryNext = 0;
 }
 
 void Timer::Tick()
 {
-    __int64 currTime;
-    QueryPerformanceCounter((LARGE_INTEGER *)&currTime);
-    m_CurrTime = currTime;
+    if (m_FixedDeltaTime > 0.0)
+    {
+        m_DeltaTime = m_FixedDeltaTime;
+        m_RawDeltaTime = m_FixedDeltaTime;
+        m_CurrTime = m_PrevTime + (int64_t)(m_FixedDeltaTime * 1.0e9);
+        m_PrevTime = m_CurrTime;
+        return;
+    }
+
+    m_CurrTime = m_Clock.Now();
 
     // Time difference between this frame and the previous.
-    m_DeltaTime = (m_CurrTime - m_PrevTime) * m_SecondsPerCount;
+    m_RawDeltaTime = (m_CurrTime - m_PrevTime) * 1.0e-9;
 
     // Prepare for next frame.
     m_PrevTime = m_CurrTime;
@@ -49,8 +73,18 @@ void Timer::Tick()
     // Force nonnegative.  The DXSDK's CDXUTTimer mentions that if the
     // processor goes into a power save mode or we get shuffled to another
     // processor, then m_DeltaTime can be negative.
-    if (m_DeltaTime < 0.0)
+    if (m_RawDeltaTime < 0.0)
     {
-        m_DeltaTime = 0.0;
+        m_RawDeltaTime = 0.0;
     }
-}
\ No newline at end of file
+
+    m_History[m_HistoryNext] = m_RawDeltaTime;
+    m_HistoryNext = (m_HistoryNext + 1) % m_SmoothingFrames;
+    m_HistoryCount = std::min(m_HistoryCount + 1, m_SmoothingFrames);
+
+    // a hitch is spread over the next frames instead of landing on one
+    double sum = 0.0;
+    for (int i = 0; i < m_HistoryCount; i++)
+        sum += m_History[i];
+    m_DeltaTime = sum / m_HistoryCount;
+}
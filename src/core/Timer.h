@@ -1,22 +1,45 @@
 #pragma once
 
+#include "Clock.h"
+
 class Timer
 {
 public:
-    Timer();
+    Timer(Clock &clock = Clock::System());
 
     float TotalTime() const;   // in seconds
     float DeltaTime() const;   // in seconds
     float DeltaTimeMS() const; // in ms
 
+    // the time between the last two ticks, DeltaTime is averaged over the last frames
+    float RawDeltaTime() const; // in seconds
+
     void Reset(); // Call before message loop.
     void Tick();  // Call every frame.
 
+    // Advances the time by a fixed step every tick instead of the time that passed, 0 to go back.
+    void SetFixedDeltaTime(double seconds) { m_FixedDeltaTime = seconds; }
+
+    // Averages the delta time over the last frames, up to MAX_SMOOTHING_FRAMES, 1 to turn it off.
+    // Keeps the jitter of single frames out of the velocities TAA and motion blur see.
+    void SetSmoothing(int frames);
+
+    static constexpr int MAX_SMOOTHING_FRAMES = 16;
+
 private:
-    double m_SecondsPerCount;
+    Clock &m_Clock;
+
     double m_DeltaTime;
+    double m_RawDeltaTime;
+    double m_FixedDeltaTime = 0.0;
+
+    // in ns of m_Clock
+    int64_t m_BaseTime;
+    int64_t m_CurrTime;
+    int64_t m_PrevTime;
 
-    __int64 m_BaseTime;
-    __int64 m_CurrTime;
-    __int64 m_PrevTime;
+    double m_History[MAX_SMOOTHING_FRAMES] = {};
+    int m_HistoryCount = 0;
+    int m_HistoryNext = 0;
+    int m_SmoothingFrames = 1;
 };
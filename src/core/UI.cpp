@@ -5,8 +5,10 @@
 #include "backends/imgui_impl_win32.h"
 
 #include "rendering/RenderingSettings.h"
+#include "rendering/GpuProfiler.h"
 
 extern RenderingSettings g_RenderingSettings;
+extern RenderingStats g_RenderingStats;
 
 UI::UI(Ref<DxContext> dxContext, HWND hwnd)
     : m_DxContext(dxContext)
@@ -60,8 +62,17 @@ void UI::BeginFrame()
 
 void UI::Render()
 {
+    PROFILE_FUNCTION();
+
     // ImGui::ShowDemoWindow();
 
+#ifdef ENABLE_PROFILER
+    DrawProfiler();
+#endif
+
+    DrawGpuMemory();
+    DrawCounters();
+
     if (!ImGui::Begin("Rendering Settings"))
     {
         // Early out if the window is collapsed, as an optimization.
@@ -74,7 +85,13 @@ void UI::Render()
     if (ImGui::CollapsingHeader("General", ImGuiTreeNodeFlags_DefaultOpen))
     {
         ImGui::Checkbox("VSync", &g_RenderingSettings.EnableVSync);
+        ImGui::SliderInt("Frame Rate Limit (0 = Off)", &g_RenderingSettings.FrameRateLimit, 0, 240);
+        ImGui::Checkbox("Smooth Delta Time", &g_RenderingSettings.SmoothDeltaTime);
+        if (g_RenderingSettings.FrameRateLimit > 0)
+            ImGui::Text("Pacing Error: p50 %.0f us, p99 %.0f us (spin margin %.2f ms)", g_RenderingStats.Pacing.DeadlineErrorP50,
+                        g_RenderingStats.Pacing.DeadlineErrorP99, g_RenderingStats.Pacing.SpinMargin);
         ImGui::Checkbox("Enable IBL", &g_RenderingSettings.EnableIBL);
+        ImGui::Checkbox("Indirect Draw", &g_RenderingSettings.UseIndirectDraw);
     }
 
     if (ImGui::CollapsingHeader("Graphics", ImGuiTreeNodeFlags_DefaultOpen))
@@ -98,6 +115,18 @@ void UI::Render()
             ImGui::SeparatorText("Cascade Shadow");
             ImGui::SliderFloat("Cascade Range Scale", &g_RenderingSettings.CascadeRangeScale, 1.0f, 5.0f, "%.3f");
             ImGui::SliderFloat("Cascade Transition Ratio", &g_RenderingSettings.CascadeTransitionRatio, 0.0f, 0.5f, "%.3f");
+            ImGui::Checkbox("Fit Cascades to Scene", &g_RenderingSettings.FitCascadesToScene);
+            ImGui::Checkbox("Fit Cascades to Depth", &g_RenderingSettings.FitCascadesToDepth);
+            ImGui::Checkbox("Cache Static Shadows", &g_RenderingSettings.CacheStaticShadows);
+            ImGui::SliderInt("Distant Cascade Interval", &g_RenderingSettings.DistantCascadeInterval, 1, 16);
+
+            ImGui::SeparatorText("Stats");
+            ImGui::Text("Visible Depth: %.2f - %.2f", g_RenderingStats.Shadow.VisibleMinDepth, g_RenderingStats.Shadow.VisibleMaxDepth);
+            ImGui::Text("Cascade Redraws: %d", g_RenderingStats.Shadow.CascadeRedraws);
+            ImGui::Text("Casters: %d (%d dynamic)", g_RenderingStats.Shadow.ShadowCasters, g_RenderingStats.Shadow.DynamicCasters);
+            for (int i = 0; i < 4; i++)
+                ImGui::Text("Cascade %d: %.2f wide, %.2f deep, %d casters", i, 2.0f * g_RenderingStats.Shadow.CascadeExtents[i],
+                            g_RenderingStats.Shadow.CascadeDepthRanges[i], g_RenderingStats.Shadow.CascadeCasters[i]);
 
             ImGui::SeparatorText("PCSS");
             ImGui::SliderFloat("Shadow Softness", &g_RenderingSettings.ShadowSoftness, 0.0f, 1.0f, "%.3f");
@@ -110,10 +139,25 @@ void UI::Render()
         if (ImGui::TreeNodeEx("VXGI", ImGuiTreeNodeFlags_DefaultOpen))
         {
             ImGui::Checkbox("Enable GI", &g_RenderingSettings.GI.Enable);
+            ImGui::Checkbox("Use Clipmap", &g_RenderingSettings.GI.UseClipmap);
             ImGui::Checkbox("Dynamic Update", &g_RenderingSettings.GI.DynamicUpdate);
             ImGui::Checkbox("Second Bounce", &g_RenderingSettings.GI.SecondBounce);
             ImGui::Checkbox("Debug Voxel", &g_RenderingSettings.GI.DebugVoxel);
             ImGui::SliderInt("Debug Voxel Mip Level", &g_RenderingSettings.GI.DebugVoxelMipLevel, 0, 7);
+            ImGui::SliderInt("Update Budget (Bricks)", &g_RenderingSettings.GI.UpdateBudget, 64, 8192);
+
+            ImGui::SeparatorText("Second Bounce Time Slicing");
+            ImGui::Combo("Schedule", &g_RenderingSettings.GI.SecondBounceSchedule, "Interleaved\0Checkerboard\0\0");
+            ImGui::SliderFloat("Fraction per Frame", &g_RenderingSettings.GI.SecondBounceFraction, 0.01f, 1.0f, "%.3f");
+            ImGui::SliderInt("Budget (Bricks)", &g_RenderingSettings.GI.SecondBounceBudget, 64, 8192);
+            ImGui::SliderFloat("Temporal Blend", &g_RenderingSettings.GI.SecondBounceBlend, 0.05f, 1.0f, "%.3f");
+
+            ImGui::SeparatorText("Stats");
+            ImGui::Text("Dirty Bricks: %d", g_RenderingStats.GI.DirtyBricks);
+            ImGui::Text("Updated Bricks: %d", g_RenderingStats.GI.UpdatedBricks);
+            ImGui::Text("Voxels Touched: %d", g_RenderingStats.GI.VoxelsTouched);
+            ImGui::Text("Second Bounce Bricks: %d (1/%d per frame)", g_RenderingStats.GI.SecondBounceBricks, g_RenderingStats.GI.SecondBounceSlices);
+            ImGui::Text("Dispatches: %d", g_RenderingStats.GI.Dispatches);
 
             ImGui::TreePop();
         }
@@ -143,11 +187,196 @@ void UI::Render()
         }
     }
 
+    if (ImGui::CollapsingHeader("Log"))
+    {
+        // in the order of spdlog::level::level_enum
+        for (int i = 0; i < (int)LogChannel::Count; i++)
+        {
+            auto channel = (LogChannel)i;
+            int level = (int)Log::GetLevel(channel);
+            if (ImGui::Combo(Log::ChannelName(channel), &level, "Trace\0Debug\0Info\0Warn\0Error\0Critical\0Off\0\0"))
+                Log::SetLevel(channel, (spdlog::level::level_enum)level);
+        }
+
+        ImGui::Text("Mode: %s", Log::IsAsync() ? "Async" : "Sync");
+        ImGui::Text("Dropped Messages: %zu", Log::DroppedMessages());
+    }
+
+    ImGui::End();
+}
+
+#ifdef ENABLE_PROFILER
+// draws the scopes in [begin, end) of a single thread, each scope is followed by the ones nested in it
+static void DrawProfileScopes(const std::vector<ProfileEvent> &events, size_t begin, size_t end)
+{
+    size_t i = begin;
+    while (i < end)
+    {
+        const ProfileEvent &event = events[i];
+
+        size_t next = i + 1;
+        while (next < end && events[next].Depth > event.Depth)
+            next++;
+
+        bool leaf = next == i + 1;
+        ImGuiTreeNodeFlags flags = leaf ? ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen : ImGuiTreeNodeFlags_DefaultOpen;
+
+        if (ImGui::TreeNodeEx(event.Name, flags, "%s: %.3f ms", event.Name, Profiler::TicksToMs(event.End - event.Start)) && !leaf)
+        {
+            DrawProfileScopes(events, i + 1, next);
+            ImGui::TreePop();
+        }
+
+        i = next;
+    }
+}
+
+void UI::DrawProfiler()
+{
+    if (!ImGui::Begin("Profiler"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    if (!m_ProfilerPaused)
+        m_ProfilerFrame = Profiler::LastFrame();
+
+    const auto &frame = m_ProfilerFrame;
+    ImGui::Text("Frame %llu: %.3f ms", (unsigned long long)frame.Index, Profiler::TicksToMs(frame.End - frame.Start));
+    if (Profiler::DroppedEvents() > 0)
+        ImGui::Text("Dropped Events: %llu", (unsigned long long)Profiler::DroppedEvents());
+    if (GpuProfiler::DroppedScopes() > 0)
+        ImGui::Text("Dropped GPU Scopes: %llu", (unsigned long long)GpuProfiler::DroppedScopes());
+    ImGui::TextDisabled("GPU scopes lag %d frames behind", NUM_FRAMES_IN_FLIGHT);
+
+    ImGui::Checkbox("Pause", &m_ProfilerPaused);
+
+    ImGui::SliderInt("Capture Frames", &m_ProfilerCaptureFrames, 1, 600);
+    if (Profiler::IsCapturing())
+        ImGui::Text("Capturing...");
+    else if (ImGui::Button("Capture Chrome Trace"))
+        Profiler::CaptureFrames(m_ProfilerCaptureFrames, "profile.json");
+
+    ImGui::SeparatorText("Scopes");
+
+    size_t begin = 0;
+    while (begin < frame.Events.size())
+    {
+        uint32_t thread = frame.Events[begin].Thread;
+
+        size_t end = begin;
+        while (end < frame.Events.size() && frame.Events[end].Thread == thread)
+            end++;
+
+        std::string name = Profiler::ThreadName(thread);
+        if (ImGui::TreeNodeEx((void *)(intptr_t)thread, ImGuiTreeNodeFlags_DefaultOpen, "%s", name.c_str()))
+        {
+            DrawProfileScopes(frame.Events, begin, end);
+            ImGui::TreePop();
+        }
+
+        begin = end;
+    }
+
+    ImGui::End();
+}
+#endif
+
+void UI::DrawGpuMemory()
+{
+    if (!ImGui::Begin("GPU Memory"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    const float MB = 1024.0f * 1024.0f;
+
+    DXGI_QUERY_VIDEO_MEMORY_INFO videoMemory = m_DxContext->QueryVideoMemory();
+    GpuMemoryTracker tracker = GpuMemory::Snapshot();
+
+    ImGui::Text("Budget: %.1f MB", videoMemory.Budget / MB);
+    if (videoMemory.CurrentUsage > videoMemory.Budget)
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "In Use: %.1f MB, over budget", videoMemory.CurrentUsage / MB);
+    else
+        ImGui::Text("In Use: %.1f MB (%.0f%%)", videoMemory.CurrentUsage / MB, 100.0f * videoMemory.CurrentUsage / std::max<UINT64>(videoMemory.Budget, 1));
+    ImGui::Text("Tracked: %.1f MB, peak %.1f MB", tracker.TotalBytes() / MB, tracker.PeakTotalBytes() / MB);
+    ImGui::TextDisabled("The swap chain and descriptor heaps are not tracked");
+
+    if (ImGui::BeginTable("Categories", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+    {
+        ImGui::TableSetupColumn("Category");
+        ImGui::TableSetupColumn("Count");
+        ImGui::TableSetupColumn("MB");
+        ImGui::TableSetupColumn("Peak MB");
+        ImGui::TableHeadersRow();
+
+        for (int i = 0; i < (int)GpuMemoryCategory::Count; i++)
+        {
+            auto category = (GpuMemoryCategory)i;
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", GpuMemoryTracker::CategoryName(category));
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", tracker.Count(category));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", tracker.Bytes(category) / MB);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", tracker.PeakBytes(category) / MB);
+        }
+
+        ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Reset Peaks"))
+        GpuMemory::ResetPeaks();
+    ImGui::SameLine();
+    if (ImGui::Button("Write JSON"))
+        GpuMemory::WriteJson("gpu_memory.json");
+
+    ImGui::End();
+}
+
+void UI::DrawCounters()
+{
+    if (!ImGui::Begin("Counters"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    auto &counters = CounterRegistry::Global();
+
+    if (ImGui::Button("Write CSV"))
+    {
+        std::ofstream file("counters.csv");
+        counters.WriteCsv(file);
+        LOG_INFO("Counters: wrote {} frame(s) to counters.csv", counters.Frames());
+    }
+
+    // see YARendererReport capture frame.ycap
+    ImGui::SameLine();
+    if (ImGui::Button("Capture Frame") && !m_DxContext->IsCapturing())
+        m_DxContext->CaptureNextFrame("frame.ycap");
+
+    for (int id = 0; id < counters.Count(); id++)
+    {
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%lld", (long long)counters.LastFrame(id));
+
+        ImGui::PlotLines(counters.Name(id).c_str(), counters.History(id), counters.Frames(), counters.HistoryOffset(),
+                         overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+    }
+
     ImGui::End();
 }
 
 void UI::EndFrame()
 {
+    PROFILE_FUNCTION();
+
     auto commandList = m_DxContext->GetCommandList();
     commandList->SetDescriptorHeaps(1, m_DxContext->GetImGuiHeap().GetAddressOf());
     commandList->OMSetRenderTargets(1, &m_DxContext->CurrentBackBuffer().Rtv.CPUHandle, true, nullptr);
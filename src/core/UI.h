@@ -14,7 +14,19 @@ public:
 
 private:
     void SetDarkThemeColors();
+    void DrawGpuMemory();
+    void DrawCounters();
+
+#ifdef ENABLE_PROFILER
+    void DrawProfiler();
+#endif
 
 private:
     Ref<DxContext> m_DxContext;
+
+#ifdef ENABLE_PROFILER
+    ProfileFrame m_ProfilerFrame;
+    bool m_ProfilerPaused = false;
+    int m_ProfilerCaptureFrames = 60;
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,501 @@
+#include "pch.h"
+#include "CaptureCommandList.h"
+
+std::mutex CaptureCommandList::s_UploadRangesMutex;
+std::map<D3D12_GPU_VIRTUAL_ADDRESS, CaptureCommandList::UploadRange> CaptureCommandList::s_UploadRanges;
+
+ComPtr<CaptureCommandList> CaptureCommandList::Create(GraphicsCommandList commandList, std::shared_ptr<FrameCapture> capture)
+{
+	// the reference the constructor starts with is handed to the ComPtr
+	ComPtr<CaptureCommandList> captureCommandList;
+	captureCommandList.Attach(new CaptureCommandList(commandList, capture));
+	return captureCommandList;
+}
+
+CaptureCommandList::CaptureCommandList(GraphicsCommandList commandList, std::shared_ptr<FrameCapture> capture)
+	: m_CommandList(commandList), m_Capture(capture)
+{
+	// a command list from the pool was just reset, nothing is bound
+	Record(CaptureOp::ResetState);
+}
+
+void CaptureCommandList::RegisterUploadRange(D3D12_GPU_VIRTUAL_ADDRESS address, const BYTE *mappedData, UINT64 size, UINT elementSize)
+{
+	std::lock_guard<std::mutex> lock(s_UploadRangesMutex);
+	s_UploadRanges[address] = {mappedData, size, elementSize};
+}
+
+void CaptureCommandList::UnregisterUploadRange(D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	std::lock_guard<std::mutex> lock(s_UploadRangesMutex);
+	s_UploadRanges.erase(address);
+}
+
+void CaptureCommandList::Record(CaptureOp op, std::initializer_list<uint32_t> args, std::initializer_list<uint64_t> objects,
+								const void *data, UINT dataSize)
+{
+	CaptureCommand command;
+	command.Op = op;
+	std::copy_n(args.begin(), std::min(args.size(), _countof(command.Args)), command.Args);
+	std::copy_n(objects.begin(), std::min(objects.size(), _countof(command.Objects)), command.Objects);
+
+	m_Capture->Add(command, data, dataSize);
+}
+
+void CaptureCommandList::RecordRootView(bool compute, UINT parameter, CaptureView view, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	Record(CaptureOp::SetRootView, {compute, parameter, (uint32_t)view}, {address});
+
+	if (view != CaptureView::CBV || m_Capture->HasBuffer(address))
+		return;
+
+	// the element the view starts in, up to the end of the element
+	std::lock_guard<std::mutex> lock(s_UploadRangesMutex);
+	auto it = s_UploadRanges.upper_bound(address);
+	if (it == s_UploadRanges.begin())
+		return;
+
+	--it;
+	UINT64 offset = address - it->first;
+	const UploadRange &range = it->second;
+	if (offset >= range.Size)
+		return;
+
+	UINT64 size = std::min<UINT64>(range.ElementSize - offset % range.ElementSize, range.Size - offset);
+	m_Capture->AddBuffer(address, range.MappedData + offset, (uint32_t)size);
+}
+
+HRESULT CaptureCommandList::QueryInterface(REFIID riid, void **ppvObject)
+{
+	if (!ppvObject)
+		return E_POINTER;
+
+	if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D12Object) || riid == __uuidof(ID3D12DeviceChild) ||
+		riid == __uuidof(ID3D12CommandList) || riid == __uuidof(ID3D12GraphicsCommandList) ||
+		riid == __uuidof(ID3D12GraphicsCommandList1) || riid == __uuidof(ID3D12GraphicsCommandList2))
+	{
+		*ppvObject = static_cast<ID3D12GraphicsCommandList2 *>(this);
+		AddRef();
+		return S_OK;
+	}
+
+	// newer interfaces would bypass the capture
+	*ppvObject = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG CaptureCommandList::AddRef()
+{
+	return ++m_RefCount;
+}
+
+ULONG CaptureCommandList::Release()
+{
+	ULONG refCount = --m_RefCount;
+	if (refCount == 0)
+		delete this;
+	return refCount;
+}
+
+HRESULT CaptureCommandList::GetPrivateData(REFGUID guid, UINT *pDataSize, void *pData)
+{
+	return m_CommandList->GetPrivateData(guid, pDataSize, pData);
+}
+
+HRESULT CaptureCommandList::SetPrivateData(REFGUID guid, UINT DataSize, const void *pData)
+{
+	return m_CommandList->SetPrivateData(guid, DataSize, pData);
+}
+
+HRESULT CaptureCommandList::SetPrivateDataInterface(REFGUID guid, const IUnknown *pData)
+{
+	return m_CommandList->SetPrivateDataInterface(guid, pData);
+}
+
+HRESULT CaptureCommandList::SetName(LPCWSTR Name)
+{
+	return m_CommandList->SetName(Name);
+}
+
+HRESULT CaptureCommandList::GetDevice(REFIID riid, void **ppvDevice)
+{
+	return m_CommandList->GetDevice(riid, ppvDevice);
+}
+
+D3D12_COMMAND_LIST_TYPE CaptureCommandList::GetType()
+{
+	return m_CommandList->GetType();
+}
+
+HRESULT CaptureCommandList::Close()
+{
+	return m_CommandList->Close();
+}
+
+HRESULT CaptureCommandList::Reset(ID3D12CommandAllocator *pAllocator, ID3D12PipelineState *pInitialState)
+{
+	Record(CaptureOp::ResetState);
+	if (pInitialState)
+		Record(CaptureOp::SetPipelineState, {}, {(uint64_t)pInitialState});
+
+	return m_CommandList->Reset(pAllocator, pInitialState);
+}
+
+void CaptureCommandList::ClearState(ID3D12PipelineState *pPipelineState)
+{
+	Record(CaptureOp::ResetState);
+	if (pPipelineState)
+		Record(CaptureOp::SetPipelineState, {}, {(uint64_t)pPipelineState});
+
+	m_CommandList->ClearState(pPipelineState);
+}
+
+void CaptureCommandList::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
+{
+	Record(CaptureOp::Draw, {VertexCountPerInstance, InstanceCount});
+	m_CommandList->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+}
+
+void CaptureCommandList::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
+{
+	Record(CaptureOp::DrawIndexed, {IndexCountPerInstance, InstanceCount});
+	m_CommandList->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+}
+
+void CaptureCommandList::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
+{
+	Record(CaptureOp::Dispatch, {ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ});
+	m_CommandList->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+}
+
+void CaptureCommandList::CopyBufferRegion(ID3D12Resource *pDstBuffer, UINT64 DstOffset, ID3D12Resource *pSrcBuffer, UINT64 SrcOffset, UINT64 NumBytes)
+{
+	Record(CaptureOp::Copy, {(uint32_t)std::min<UINT64>(NumBytes, UINT32_MAX)}, {(uint64_t)pDstBuffer, (uint64_t)pSrcBuffer});
+	m_CommandList->CopyBufferRegion(pDstBuffer, DstOffset, pSrcBuffer, SrcOffset, NumBytes);
+}
+
+void CaptureCommandList::CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION *pDst, UINT DstX, UINT DstY, UINT DstZ, const D3D12_TEXTURE_COPY_LOCATION *pSrc, const D3D12_BOX *pSrcBox)
+{
+	Record(CaptureOp::Copy, {}, {(uint64_t)pDst->pResource, (uint64_t)pSrc->pResource});
+	m_CommandList->CopyTextureRegion(pDst, DstX, DstY, DstZ, pSrc, pSrcBox);
+}
+
+void CaptureCommandList::CopyResource(ID3D12Resource *pDstResource, ID3D12Resource *pSrcResource)
+{
+	Record(CaptureOp::Copy, {}, {(uint64_t)pDstResource, (uint64_t)pSrcResource});
+	m_CommandList->CopyResource(pDstResource, pSrcResource);
+}
+
+void CaptureCommandList::CopyTiles(ID3D12Resource *pTiledResource, const D3D12_TILED_RESOURCE_COORDINATE *pTileRegionStartCoordinate, const D3D12_TILE_REGION_SIZE *pTileRegionSize, ID3D12Resource *pBuffer, UINT64 BufferStartOffsetInBytes, D3D12_TILE_COPY_FLAGS Flags)
+{
+	Record(CaptureOp::Copy, {}, {(uint64_t)pTiledResource, (uint64_t)pBuffer});
+	m_CommandList->CopyTiles(pTiledResource, pTileRegionStartCoordinate, pTileRegionSize, pBuffer, BufferStartOffsetInBytes, Flags);
+}
+
+void CaptureCommandList::ResolveSubresource(ID3D12Resource *pDstResource, UINT DstSubresource, ID3D12Resource *pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format)
+{
+	Record(CaptureOp::Copy, {}, {(uint64_t)pDstResource, (uint64_t)pSrcResource});
+	m_CommandList->ResolveSubresource(pDstResource, DstSubresource, pSrcResource, SrcSubresource, Format);
+}
+
+void CaptureCommandList::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopology)
+{
+	Record(CaptureOp::SetTopology, {(uint32_t)PrimitiveTopology});
+	m_CommandList->IASetPrimitiveTopology(PrimitiveTopology);
+}
+
+void CaptureCommandList::RSSetViewports(UINT NumViewports, const D3D12_VIEWPORT *pViewports)
+{
+	Record(CaptureOp::SetViewports, {NumViewports}, {}, pViewports, NumViewports * sizeof(D3D12_VIEWPORT));
+	m_CommandList->RSSetViewports(NumViewports, pViewports);
+}
+
+void CaptureCommandList::RSSetScissorRects(UINT NumRects, const D3D12_RECT *pRects)
+{
+	Record(CaptureOp::SetScissorRects, {NumRects}, {}, pRects, NumRects * sizeof(D3D12_RECT));
+	m_CommandList->RSSetScissorRects(NumRects, pRects);
+}
+
+void CaptureCommandList::OMSetBlendFactor(const FLOAT BlendFactor[4])
+{
+	m_CommandList->OMSetBlendFactor(BlendFactor);
+}
+
+void CaptureCommandList::OMSetStencilRef(UINT StencilRef)
+{
+	m_CommandList->OMSetStencilRef(StencilRef);
+}
+
+void CaptureCommandList::SetPipelineState(ID3D12PipelineState *pPipelineState)
+{
+	Record(CaptureOp::SetPipelineState, {}, {(uint64_t)pPipelineState});
+	m_CommandList->SetPipelineState(pPipelineState);
+}
+
+void CaptureCommandList::ResourceBarrier(UINT NumBarriers, const D3D12_RESOURCE_BARRIER *pBarriers)
+{
+	UINT transitions = 0, uavBarriers = 0;
+	for (UINT i = 0; i < NumBarriers; i++)
+	{
+		transitions += pBarriers[i].Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION ? 1 : 0;
+		uavBarriers += pBarriers[i].Type == D3D12_RESOURCE_BARRIER_TYPE_UAV ? 1 : 0;
+	}
+
+	Record(CaptureOp::Barrier, {NumBarriers, transitions, uavBarriers});
+	m_CommandList->ResourceBarrier(NumBarriers, pBarriers);
+}
+
+void CaptureCommandList::ExecuteBundle(ID3D12GraphicsCommandList *pCommandList)
+{
+	m_CommandList->ExecuteBundle(pCommandList);
+}
+
+void CaptureCommandList::SetDescriptorHeaps(UINT NumDescriptorHeaps, ID3D12DescriptorHeap *const *ppDescriptorHeaps)
+{
+	// one heap of each shader visible type at most
+	uint64_t heaps[2] = {};
+	for (UINT i = 0; i < std::min(NumDescriptorHeaps, 2u); i++)
+		heaps[i] = (uint64_t)ppDescriptorHeaps[i];
+
+	Record(CaptureOp::SetDescriptorHeaps, {NumDescriptorHeaps}, {heaps[0], heaps[1]});
+	m_CommandList->SetDescriptorHeaps(NumDescriptorHeaps, ppDescriptorHeaps);
+}
+
+void CaptureCommandList::SetComputeRootSignature(ID3D12RootSignature *pRootSignature)
+{
+	Record(CaptureOp::SetRootSignature, {1}, {(uint64_t)pRootSignature});
+	m_CommandList->SetComputeRootSignature(pRootSignature);
+}
+
+void CaptureCommandList::SetGraphicsRootSignature(ID3D12RootSignature *pRootSignature)
+{
+	Record(CaptureOp::SetRootSignature, {0}, {(uint64_t)pRootSignature});
+	m_CommandList->SetGraphicsRootSignature(pRootSignature);
+}
+
+void CaptureCommandList::SetComputeRootDescriptorTable(UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor)
+{
+	Record(CaptureOp::SetDescriptorTable, {1, RootParameterIndex}, {BaseDescriptor.ptr});
+	m_CommandList->SetComputeRootDescriptorTable(RootParameterIndex, BaseDescriptor);
+}
+
+void CaptureCommandList::SetGraphicsRootDescriptorTable(UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor)
+{
+	Record(CaptureOp::SetDescriptorTable, {0, RootParameterIndex}, {BaseDescriptor.ptr});
+	m_CommandList->SetGraphicsRootDescriptorTable(RootParameterIndex, BaseDescriptor);
+}
+
+void CaptureCommandList::SetComputeRoot32BitConstant(UINT RootParameterIndex, UINT SrcData, UINT DestOffsetIn32BitValues)
+{
+	Record(CaptureOp::SetRootConstants, {1, RootParameterIndex, DestOffsetIn32BitValues}, {}, &SrcData, sizeof(UINT));
+	m_CommandList->SetComputeRoot32BitConstant(RootParameterIndex, SrcData, DestOffsetIn32BitValues);
+}
+
+void CaptureCommandList::SetGraphicsRoot32BitConstant(UINT RootParameterIndex, UINT SrcData, UINT DestOffsetIn32BitValues)
+{
+	Record(CaptureOp::SetRootConstants, {0, RootParameterIndex, DestOffsetIn32BitValues}, {}, &SrcData, sizeof(UINT));
+	m_CommandList->SetGraphicsRoot32BitConstant(RootParameterIndex, SrcData, DestOffsetIn32BitValues);
+}
+
+void CaptureCommandList::SetComputeRoot32BitConstants(UINT RootParameterIndex, UINT Num32BitValuesToSet, const void *pSrcData, UINT DestOffsetIn32BitValues)
+{
+	Record(CaptureOp::SetRootConstants, {1, RootParameterIndex, DestOffsetIn32BitValues}, {}, pSrcData, Num32BitValuesToSet * sizeof(UINT));
+	m_CommandList->SetComputeRoot32BitConstants(RootParameterIndex, Num32BitValuesToSet, pSrcData, DestOffsetIn32BitValues);
+}
+
+void CaptureCommandList::SetGraphicsRoot32BitConstants(UINT RootParameterIndex, UINT Num32BitValuesToSet, const void *pSrcData, UINT DestOffsetIn32BitValues)
+{
+	Record(CaptureOp::SetRootConstants, {0, RootParameterIndex, DestOffsetIn32BitValues}, {}, pSrcData, Num32BitValuesToSet * sizeof(UINT));
+	m_CommandList->SetGraphicsRoot32BitConstants(RootParameterIndex, Num32BitValuesToSet, pSrcData, DestOffsetIn32BitValues);
+}
+
+void CaptureCommandList::SetComputeRootConstantBufferView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	RecordRootView(true, RootParameterIndex, CaptureView::CBV, BufferLocation);
+	m_CommandList->SetComputeRootConstantBufferView(RootParameterIndex, BufferLocation);
+}
+
+void CaptureCommandList::SetGraphicsRootConstantBufferView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	RecordRootView(false, RootParameterIndex, CaptureView::CBV, BufferLocation);
+	m_CommandList->SetGraphicsRootConstantBufferView(RootParameterIndex, BufferLocation);
+}
+
+void CaptureCommandList::SetComputeRootShaderResourceView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	RecordRootView(true, RootParameterIndex, CaptureView::SRV, BufferLocation);
+	m_CommandList->SetComputeRootShaderResourceView(RootParameterIndex, BufferLocation);
+}
+
+void CaptureCommandList::SetGraphicsRootShaderResourceView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	RecordRootView(false, RootParameterIndex, CaptureView::SRV, BufferLocation);
+	m_CommandList->SetGraphicsRootShaderResourceView(RootParameterIndex, BufferLocation);
+}
+
+void CaptureCommandList::SetComputeRootUnorderedAccessView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	RecordRootView(true, RootParameterIndex, CaptureView::UAV, BufferLocation);
+	m_CommandList->SetComputeRootUnorderedAccessView(RootParameterIndex, BufferLocation);
+}
+
+void CaptureCommandList::SetGraphicsRootUnorderedAccessView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation)
+{
+	RecordRootView(false, RootParameterIndex, CaptureView::UAV, BufferLocation);
+	m_CommandList->SetGraphicsRootUnorderedAccessView(RootParameterIndex, BufferLocation);
+}
+
+void CaptureCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW *pView)
+{
+	if (pView)
+		Record(CaptureOp::SetIndexBuffer, {pView->SizeInBytes, (uint32_t)pView->Format}, {pView->BufferLocation});
+	else
+		Record(CaptureOp::SetIndexBuffer);
+
+	m_CommandList->IASetIndexBuffer(pView);
+}
+
+void CaptureCommandList::IASetVertexBuffers(UINT StartSlot, UINT NumViews, const D3D12_VERTEX_BUFFER_VIEW *pViews)
+{
+	Record(CaptureOp::SetVertexBuffers, {StartSlot, NumViews}, {}, pViews, pViews ? NumViews * sizeof(D3D12_VERTEX_BUFFER_VIEW) : 0);
+	m_CommandList->IASetVertexBuffers(StartSlot, NumViews, pViews);
+}
+
+void CaptureCommandList::SOSetTargets(UINT StartSlot, UINT NumViews, const D3D12_STREAM_OUTPUT_BUFFER_VIEW *pViews)
+{
+	m_CommandList->SOSetTargets(StartSlot, NumViews, pViews);
+}
+
+void CaptureCommandList::OMSetRenderTargets(UINT NumRenderTargetDescriptors, const D3D12_CPU_DESCRIPTOR_HANDLE *pRenderTargetDescriptors, BOOL RTsSingleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE *pDepthStencilDescriptor)
+{
+	// a single handle stands for the whole range
+	UINT handles = RTsSingleHandleToDescriptorRange ? std::min(NumRenderTargetDescriptors, 1u) : NumRenderTargetDescriptors;
+	Record(CaptureOp::SetRenderTargets, {NumRenderTargetDescriptors, (uint32_t)RTsSingleHandleToDescriptorRange},
+		   {pDepthStencilDescriptor ? (uint64_t)pDepthStencilDescriptor->ptr : 0},
+		   pRenderTargetDescriptors, pRenderTargetDescriptors ? handles * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) : 0);
+
+	m_CommandList->OMSetRenderTargets(NumRenderTargetDescriptors, pRenderTargetDescriptors, RTsSingleHandleToDescriptorRange, pDepthStencilDescriptor);
+}
+
+void CaptureCommandList::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView, D3D12_CLEAR_FLAGS ClearFlags, FLOAT Depth, UINT8 Stencil, UINT NumRects, const D3D12_RECT *pRects)
+{
+	Record(CaptureOp::Clear, {(uint32_t)CaptureClear::DepthStencil}, {(uint64_t)DepthStencilView.ptr});
+	m_CommandList->ClearDepthStencilView(DepthStencilView, ClearFlags, Depth, Stencil, NumRects, pRects);
+}
+
+void CaptureCommandList::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE RenderTargetView, const FLOAT ColorRGBA[4], UINT NumRects, const D3D12_RECT *pRects)
+{
+	Record(CaptureOp::Clear, {(uint32_t)CaptureClear::RenderTarget}, {(uint64_t)RenderTargetView.ptr});
+	m_CommandList->ClearRenderTargetView(RenderTargetView, ColorRGBA, NumRects, pRects);
+}
+
+void CaptureCommandList::ClearUnorderedAccessViewUint(D3D12_GPU_DESCRIPTOR_HANDLE ViewGPUHandleInCurrentHeap, D3D12_CPU_DESCRIPTOR_HANDLE ViewCPUHandle, ID3D12Resource *pResource, const UINT Values[4], UINT NumRects, const D3D12_RECT *pRects)
+{
+	Record(CaptureOp::Clear, {(uint32_t)CaptureClear::UnorderedAccess}, {(uint64_t)pResource});
+	m_CommandList->ClearUnorderedAccessViewUint(ViewGPUHandleInCurrentHeap, ViewCPUHandle, pResource, Values, NumRects, pRects);
+}
+
+void CaptureCommandList::ClearUnorderedAccessViewFloat(D3D12_GPU_DESCRIPTOR_HANDLE ViewGPUHandleInCurrentHeap, D3D12_CPU_DESCRIPTOR_HANDLE ViewCPUHandle, ID3D12Resource *pResource, const FLOAT Values[4], UINT NumRects, const D3D12_RECT *pRects)
+{
+	Record(CaptureOp::Clear, {(uint32_t)CaptureClear::UnorderedAccess}, {(uint64_t)pResource});
+	m_CommandList->ClearUnorderedAccessViewFloat(ViewGPUHandleInCurrentHeap, ViewCPUHandle, pResource, Values, NumRects, pRects);
+}
+
+void CaptureCommandList::DiscardResource(ID3D12Resource *pResource, const D3D12_DISCARD_REGION *pRegion)
+{
+	m_CommandList->DiscardResource(pResource, pRegion);
+}
+
+void CaptureCommandList::BeginQuery(ID3D12QueryHeap *pQueryHeap, D3D12_QUERY_TYPE Type, UINT Index)
+{
+	m_CommandList->BeginQuery(pQueryHeap, Type, Index);
+}
+
+void CaptureCommandList::EndQuery(ID3D12QueryHeap *pQueryHeap, D3D12_QUERY_TYPE Type, UINT Index)
+{
+	m_CommandList->EndQuery(pQueryHeap, Type, Index);
+}
+
+void CaptureCommandList::ResolveQueryData(ID3D12QueryHeap *pQueryHeap, D3D12_QUERY_TYPE Type, UINT StartIndex, UINT NumQueries, ID3D12Resource *pDestinationBuffer, UINT64 AlignedDestinationBufferOffset)
+{
+	m_CommandList->ResolveQueryData(pQueryHeap, Type, StartIndex, NumQueries, pDestinationBuffer, AlignedDestinationBufferOffset);
+}
+
+void CaptureCommandList::SetPredication(ID3D12Resource *pBuffer, UINT64 AlignedBufferOffset, D3D12_PREDICATION_OP Operation)
+{
+	m_CommandList->SetPredication(pBuffer, AlignedBufferOffset, Operation);
+}
+
+void CaptureCommandList::SetMarker(UINT Metadata, const void *pData, UINT Size)
+{
+	m_CommandList->SetMarker(Metadata, pData, Size);
+}
+
+void CaptureCommandList::BeginEvent(UINT Metadata, const void *pData, UINT Size)
+{
+	// metadata 0 is a wide string and 1 a narrow one; PIX encodes its own events, those are unnamed
+	std::string name;
+	if (Metadata == 0)
+	{
+		auto chars = static_cast<const wchar_t *>(pData);
+		for (UINT i = 0; i < Size / sizeof(wchar_t) && chars[i]; i++)
+			name.push_back(chars[i] < 128 ? (char)chars[i] : '?');
+	}
+	else if (Metadata == 1)
+	{
+		name.assign(static_cast<const char *>(pData), strnlen(static_cast<const char *>(pData), Size));
+	}
+
+	Record(CaptureOp::BeginPass, {}, {}, name.c_str(), (UINT)name.size());
+	m_CommandList->BeginEvent(Metadata, pData, Size);
+}
+
+void CaptureCommandList::EndEvent()
+{
+	Record(CaptureOp::EndPass);
+	m_CommandList->EndEvent();
+}
+
+void CaptureCommandList::ExecuteIndirect(ID3D12CommandSignature *pCommandSignature, UINT MaxCommandCount, ID3D12Resource *pArgumentBuffer, UINT64 ArgumentBufferOffset, ID3D12Resource *pCountBuffer, UINT64 CountBufferOffset)
+{
+	Record(CaptureOp::ExecuteIndirect, {MaxCommandCount}, {(uint64_t)pCommandSignature, (uint64_t)pArgumentBuffer});
+	m_CommandList->ExecuteIndirect(pCommandSignature, MaxCommandCount, pArgumentBuffer, ArgumentBufferOffset, pCountBuffer, CountBufferOffset);
+}
+
+void CaptureCommandList::AtomicCopyBufferUINT(ID3D12Resource *pDstBuffer, UINT64 DstOffset, ID3D12Resource *pSrcBuffer, UINT64 SrcOffset, UINT Dependencies, ID3D12Resource *const *ppDependentResources, const D3D12_SUBRESOURCE_RANGE_UINT64 *pDependentSubresourceRanges)
+{
+	Record(CaptureOp::Copy, {sizeof(UINT)}, {(uint64_t)pDstBuffer, (uint64_t)pSrcBuffer});
+	m_CommandList->AtomicCopyBufferUINT(pDstBuffer, DstOffset, pSrcBuffer, SrcOffset, Dependencies, ppDependentResources, pDependentSubresourceRanges);
+}
+
+void CaptureCommandList::AtomicCopyBufferUINT64(ID3D12Resource *pDstBuffer, UINT64 DstOffset, ID3D12Resource *pSrcBuffer, UINT64 SrcOffset, UINT Dependencies, ID3D12Resource *const *ppDependentResources, const D3D12_SUBRESOURCE_RANGE_UINT64 *pDependentSubresourceRanges)
+{
+	Record(CaptureOp::Copy, {sizeof(UINT64)}, {(uint64_t)pDstBuffer, (uint64_t)pSrcBuffer});
+	m_CommandList->AtomicCopyBufferUINT64(pDstBuffer, DstOffset, pSrcBuffer, SrcOffset, Dependencies, ppDependentResources, pDependentSubresourceRanges);
+}
+
+void CaptureCommandList::OMSetDepthBounds(FLOAT Min, FLOAT Max)
+{
+	m_CommandList->OMSetDepthBounds(Min, Max);
+}
+
+void CaptureCommandList::SetSamplePositions(UINT NumSamplesPerPixel, UINT NumPixels, D3D12_SAMPLE_POSITION *pSamplePositions)
+{
+	m_CommandList->SetSamplePositions(NumSamplesPerPixel, NumPixels, pSamplePositions);
+}
+
+void CaptureCommandList::ResolveSubresourceRegion(ID3D12Resource *pDstResource, UINT DstSubresource, UINT DstX, UINT DstY, ID3D12Resource *pSrcResource, UINT SrcSubresource, D3D12_RECT *pSrcRect, DXGI_FORMAT Format, D3D12_RESOLVE_MODE ResolveMode)
+{
+	Record(CaptureOp::Copy, {}, {(uint64_t)pDstResource, (uint64_t)pSrcResource});
+	m_CommandList->ResolveSubresourceRegion(pDstResource, DstSubresource, DstX, DstY, pSrcResource, SrcSubresource, pSrcRect, Format, ResolveMode);
+}
+
+void CaptureCommandList::SetViewInstanceMask(UINT Mask)
+{
+	m_CommandList->SetViewInstanceMask(Mask);
+}
+
+void CaptureCommandList::WriteBufferImmediate(UINT Count, const D3D12_WRITEBUFFERIMMEDIATE_PARAMETER *pParams, const D3D12_WRITEBUFFERIMMEDIATE_MODE *pModes)
+{
+	m_CommandList->WriteBufferImmediate(Count, pParams, pModes);
+}
@@ -89,6 +89,11 @@ bool CommandQueue::IsFenceComplete(UINT64 fenceValue)
 	return m_Fence->GetCompletedValue() >= fenceValue;
 }
 
+UINT64 CommandQueue::GetCompletedFenceValue()
+{
+	return m_Fence->GetCompletedValue();
+}
+
 void CommandQueue::WaitForFenceValue(UINT64 fenceValue)
 {
 	if (!IsFenceComplete(fenceValue))
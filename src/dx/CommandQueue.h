@@ -12,6 +12,7 @@ public:
 
 	UINT64 Signal();
 	bool IsFenceComplete(UINT64 fenceValue);
+	UINT64 GetCompletedFenceValue();
 	void WaitForFenceValue(UINT64 fenceValue);
 	void Flush();
 
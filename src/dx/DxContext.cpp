@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "DxContext.h"
+#include "Utils.h"
 
 DxContext::DxContext(HWND hWnd, UINT width, UINT height)
 	: m_hWnd(hWnd), m_Width(width), m_Height(height)
@@ -11,6 +12,7 @@ DxContext::DxContext(HWND hWnd, UINT width, UINT height)
 
 	CreateDevice();
 	m_CommandQueue = std::make_shared<CommandQueue>(m_Device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+	m_StagingManager = std::make_unique<StagingManager>(m_Device, STAGING_RING_SIZE);
 	CreateSwapChain();
 
 	CreateDescriptorHeaps();
@@ -29,12 +31,29 @@ void DxContext::Present(bool vsync)
 	ThrowIfFailed(m_SwapChain->Present(sync, flag));
 
 	m_CurrBackBuffer = (m_CurrBackBuffer + 1) % NUM_FRAMES_IN_FLIGHT;
+
+	if (m_Capture)
+		WriteCapture();
+
+	// the frame to capture starts with the command lists recorded after this
+	if (!m_CaptureFilename.empty() && !m_Capture)
+		m_Capture = std::make_shared<FrameCapture>();
 }
 
 GraphicsCommandList DxContext::GetCommandList()
 {
 	if (!m_ActiveCommandList)
+	{
+		// recycle the staging memory of copies that have completed by now
+		m_StagingManager->Reclaim(GetCompletedFenceValue());
 		m_ActiveCommandList = m_CommandQueue->GetFreeCommandList();
+
+		if (m_Capture)
+		{
+			m_ActiveCaptureList = CaptureCommandList::Create(m_ActiveCommandList, m_Capture);
+			m_ActiveCommandList = m_ActiveCaptureList;
+		}
+	}
 	return m_ActiveCommandList;
 }
 
@@ -42,11 +61,92 @@ UINT64 DxContext::ExecuteCommandList()
 {
 	ASSERT(m_ActiveCommandList, "No Active Command List.");
 
-	UINT64 newFenceValue = m_CommandQueue->ExecuteCommandList(m_ActiveCommandList);
+	// only the real command list can be executed
+	GraphicsCommandList commandList = m_ActiveCaptureList ? m_ActiveCaptureList->Real() : m_ActiveCommandList;
+
+	UINT64 newFenceValue = m_CommandQueue->ExecuteCommandList(commandList);
 	m_ActiveCommandList = nullptr;
+	m_ActiveCaptureList = nullptr;
+
+	// staging memory used by this command list can be reused once the fence is reached
+	m_StagingManager->Submit(newFenceValue);
+
 	return newFenceValue;
 }
 
+void DxContext::Flush()
+{
+	m_CommandQueue->Flush();
+	m_StagingManager->Reclaim(GetCompletedFenceValue());
+}
+
+void DxContext::BeginFlushBatch()
+{
+	m_FlushBatchDepth++;
+}
+
+UINT DxContext::EndFlushBatch()
+{
+	ASSERT(m_FlushBatchDepth > 0, "EndFlushBatch without BeginFlushBatch.");
+
+	UINT deferredFlushes = 0;
+	if (--m_FlushBatchDepth == 0)
+	{
+		Flush();
+		deferredFlushes = m_DeferredFlushes;
+		m_DeferredFlushes = 0;
+	}
+	return deferredFlushes;
+}
+
+void DxContext::DeferFlush()
+{
+	if (m_FlushBatchDepth == 0)
+	{
+		Flush();
+		return;
+	}
+
+	// what is done by now can be recycled without waiting
+	m_DeferredFlushes++;
+	m_StagingManager->Reclaim(GetCompletedFenceValue());
+}
+
+void DxContext::EndLoad()
+{
+	m_StagingManager->Reclaim(GetCompletedFenceValue());
+	if (!m_StagingManager->EndLoad(STAGING_RING_STEADY_SIZE))
+		LOG_WARN("Staging memory: copies are still in flight, the ring is not trimmed");
+
+	m_StagingManager->LogStats();
+}
+
+void DxContext::CaptureNextFrame(const std::string &filename)
+{
+	m_CaptureFilename = filename;
+}
+
+void DxContext::WriteCapture()
+{
+	std::ofstream file(m_CaptureFilename, std::ios::binary);
+	m_Capture->Write(file);
+
+	if (file)
+		LOG_INFO("FrameCapture: wrote {} command(s) and {} constant buffer(s) to {}", m_Capture->Commands().size(), m_Capture->Buffers().size(), m_CaptureFilename);
+	else
+		LOG_ERROR("FrameCapture: failed to write {}", m_CaptureFilename);
+
+	m_Capture = nullptr;
+	m_CaptureFilename.clear();
+}
+
+DXGI_QUERY_VIDEO_MEMORY_INFO DxContext::QueryVideoMemory()
+{
+	DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+	ThrowIfFailed(m_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info));
+	return info;
+}
+
 void DxContext::EnableDebugLayer()
 {
 #if defined(_DEBUG)
@@ -236,6 +336,8 @@ void DxContext::ResizeSwapChain()
 
 void DxContext::ResizeDepthStencilBuffer(GraphicsCommandList commandList)
 {
+	GpuMemoryScope memoryScope(GpuMemoryCategory::GBuffer);
+
 	// Create the depth/stencil buffer and view.
 	D3D12_RESOURCE_DESC depthStencilDesc = {};
 	depthStencilDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
@@ -261,7 +363,7 @@ void DxContext::ResizeDepthStencilBuffer(GraphicsCommandList commandList)
 	optClear.DepthStencil.Depth = 1.0f;
 	optClear.DepthStencil.Stencil = 0;
 
-	ThrowIfFailed(m_Device->CreateCommittedResource(
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
 		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 		D3D12_HEAP_FLAG_NONE,
 		&depthStencilDesc,
@@ -278,8 +380,8 @@ void DxContext::ResizeDepthStencilBuffer(GraphicsCommandList commandList)
 	m_Device->CreateDepthStencilView(m_DepthStencilBuffer.Resource.Get(), &dsvDesc, m_DepthStencilBuffer.Dsv.CPUHandle);
 
 	// Transition the resource from its initial state to be used as a depth buffer.
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_DepthStencilBuffer.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_DepthStencilBuffer.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_DEPTH_WRITE));
 
 	// Create depth buffer shader resource view
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
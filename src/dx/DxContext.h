@@ -3,8 +3,16 @@
 #include "dx.h"
 
 #include "CommandQueue.h"
+#include "CaptureCommandList.h"
 #include "Texture.h"
 #include "DescriptorHeap.h"
+#include "StagingManager.h"
+
+// The staging ring is sized for the uploads of loading the scene and trimmed to the steady-state
+// size by EndLoad. Requests that do not fit fall back to dedicated buffers either way, their count
+// and the peaks of both phases are logged so the sizes can be tuned.
+const UINT64 STAGING_RING_SIZE = 64 * 1024 * 1024;
+const UINT64 STAGING_RING_STEADY_SIZE = 4 * 1024 * 1024;
 
 class DxContext
 {
@@ -23,11 +31,35 @@ public:
 	DescriptorHeap &GetCbvSrvUavHeap() { return m_CbvSrvUavHeap; }
 	DescriptorHeap &GetImGuiHeap() { return m_ImGuiHeap; }
 
+	StagingManager &GetStagingManager() { return *m_StagingManager; }
+
+	// the budget the OS gives the process in local video memory and how much of it is used
+	DXGI_QUERY_VIDEO_MEMORY_INFO QueryVideoMemory();
+
 	GraphicsCommandList GetCommandList();
 	UINT64 ExecuteCommandList();
 	UINT64 Signal() { return m_CommandQueue->Signal(); }
 	void WaitForFenceValue(UINT64 fenceValue) { m_CommandQueue->WaitForFenceValue(fenceValue); }
-	void Flush() { m_CommandQueue->Flush(); }
+	UINT64 GetCompletedFenceValue() { return m_CommandQueue->GetCompletedFenceValue(); }
+	ComPtr<ID3D12CommandQueue> GetCommandQueue() { return m_CommandQueue->GetCommandQueue(); }
+	void Flush();
+
+	// Between these, DeferFlush does not wait but leaves it to EndFlushBatch to wait once for all
+	// the work submitted so far. For the callers that only flush to have their uploads done before
+	// anything uses them, which the queue ensures anyway. Flush still waits right away, for the
+	// callers that read back results or free what the GPU may still use. EndFlushBatch returns how
+	// many flushes it stood in for.
+	void BeginFlushBatch();
+	UINT EndFlushBatch();
+	void DeferFlush();
+
+	// after the uploads of loading are done, trims the staging ring and logs its use while loading
+	void EndLoad();
+
+	// records the command lists of the next frame, from the next Present to the one after it, and
+	// writes them to a file for YARendererReport capture
+	void CaptureNextFrame(const std::string &filename);
+	bool IsCapturing() const { return m_Capture || !m_CaptureFilename.empty(); }
 
 private:
 	void EnableDebugLayer();
@@ -43,6 +75,8 @@ private:
 	void ResizeSwapChain();
 	void ResizeDepthStencilBuffer(GraphicsCommandList commandList);
 
+	void WriteCapture();
+
 private:
 	HWND m_hWnd;
 
@@ -53,6 +87,15 @@ private:
 	Ref<CommandQueue> m_CommandQueue;
 	GraphicsCommandList m_ActiveCommandList = nullptr;
 
+	UINT m_FlushBatchDepth = 0;
+	UINT m_DeferredFlushes = 0;
+
+	std::string m_CaptureFilename;
+	std::shared_ptr<FrameCapture> m_Capture;
+	ComPtr<CaptureCommandList> m_ActiveCaptureList;
+
+	std::unique_ptr<StagingManager> m_StagingManager;
+
 	int m_CurrBackBuffer = 0;
 	SwapChain m_SwapChain;
 	Texture m_SwapChainBuffer[NUM_FRAMES_IN_FLIGHT];
@@ -0,0 +1,417 @@
+#include "pch.h"
+#include "FrameCapture.h"
+
+#include <iomanip>
+#include <tuple>
+
+// Written and read field by field, little-endian as on every platform we run on, so the file has
+// no padding and does not depend on the layout of the structs
+namespace
+{
+	const uint32_t MAX_COMMANDS = 1 << 24;
+	const uint32_t MAX_DATA_SIZE = 1 << 30;
+
+	template <typename T>
+	void WriteValue(std::ostream &out, T value)
+	{
+		out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool ReadValue(std::istream &in, T &value)
+	{
+		return (bool)in.read(reinterpret_cast<char *>(&value), sizeof(T));
+	}
+
+	bool ReadBytes(std::istream &in, std::vector<uint8_t> &bytes, uint32_t size)
+	{
+		bytes.resize(size);
+		return size == 0 || (bool)in.read(reinterpret_cast<char *>(bytes.data()), size);
+	}
+
+	// what is bound, to tell the state sets that change nothing; the graphics and compute
+	// bindings are kept apart as the command list keeps them
+	struct BoundState
+	{
+		uint64_t PipelineState = 0;
+		uint64_t RootSignature[2] = {};
+		std::map<uint32_t, uint64_t> Tables[2]; // by root parameter
+		std::map<uint32_t, uint64_t> Views[2];
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> Constants[2]; // (parameter, value index)
+		uint64_t Heaps[2] = {};
+		uint32_t Topology = 0;
+		std::map<uint32_t, std::vector<uint8_t>> VertexBuffers; // by first slot
+		std::tuple<uint64_t, uint32_t, uint32_t> IndexBuffer = {};
+		std::tuple<uint32_t, uint32_t, uint64_t, std::vector<uint8_t>> RenderTargets;
+		std::vector<uint8_t> Viewports;
+		std::vector<uint8_t> ScissorRects;
+	};
+
+	template <typename Map, typename Key, typename Value>
+	bool SetIfChanged(Map &map, const Key &key, const Value &value)
+	{
+		auto it = map.find(key);
+		if (it != map.end() && it->second == value)
+			return false;
+
+		map[key] = value;
+		return true;
+	}
+
+	template <typename T>
+	bool SetIfChanged(T &bound, const T &value)
+	{
+		if (bound == value)
+			return false;
+
+		bound = value;
+		return true;
+	}
+}
+
+void FrameCapture::Add(const CaptureCommand &command, const void *data, uint32_t dataSize)
+{
+	CaptureCommand added = command;
+	added.DataOffset = (uint32_t)m_Data.size();
+	added.DataSize = dataSize;
+
+	if (dataSize > 0)
+	{
+		auto bytes = static_cast<const uint8_t *>(data);
+		m_Data.insert(m_Data.end(), bytes, bytes + dataSize);
+	}
+
+	m_Commands.push_back(added);
+}
+
+void FrameCapture::AddBuffer(uint64_t address, const void *data, uint32_t size)
+{
+	if (HasBuffer(address))
+		return;
+
+	auto bytes = static_cast<const uint8_t *>(data);
+	m_BufferIndices.emplace(address, m_Buffers.size());
+	m_Buffers.push_back({address, std::vector<uint8_t>(bytes, bytes + size)});
+}
+
+std::vector<uint8_t> FrameCapture::CommandData(const CaptureCommand &command) const
+{
+	auto first = m_Data.begin() + command.DataOffset;
+	return std::vector<uint8_t>(first, first + command.DataSize);
+}
+
+std::string FrameCapture::PassName(const CaptureCommand &command) const
+{
+	auto name = reinterpret_cast<const char *>(m_Data.data() + command.DataOffset);
+	return std::string(name, strnlen(name, command.DataSize));
+}
+
+void FrameCapture::Write(std::ostream &out) const
+{
+	WriteValue(out, MAGIC);
+	WriteValue(out, VERSION);
+	WriteValue(out, (uint32_t)m_Commands.size());
+	WriteValue(out, (uint32_t)m_Data.size());
+	WriteValue(out, (uint32_t)m_Buffers.size());
+
+	for (auto &command : m_Commands)
+	{
+		WriteValue(out, (uint8_t)command.Op);
+		for (auto arg : command.Args)
+			WriteValue(out, arg);
+		for (auto object : command.Objects)
+			WriteValue(out, object);
+		WriteValue(out, command.DataOffset);
+		WriteValue(out, command.DataSize);
+	}
+
+	out.write(reinterpret_cast<const char *>(m_Data.data()), m_Data.size());
+
+	for (auto &buffer : m_Buffers)
+	{
+		WriteValue(out, buffer.Address);
+		WriteValue(out, (uint32_t)buffer.Bytes.size());
+		out.write(reinterpret_cast<const char *>(buffer.Bytes.data()), buffer.Bytes.size());
+	}
+}
+
+bool FrameCapture::Read(std::istream &in, FrameCapture &capture, std::string &error)
+{
+	capture = FrameCapture();
+
+	uint32_t magic, version, commandCount, dataSize, bufferCount;
+	if (!ReadValue(in, magic) || !ReadValue(in, version) || !ReadValue(in, commandCount) ||
+		!ReadValue(in, dataSize) || !ReadValue(in, bufferCount))
+	{
+		error = "truncated header";
+		return false;
+	}
+
+	if (magic != MAGIC)
+	{
+		error = "not a frame capture";
+		return false;
+	}
+
+	if (version != VERSION)
+	{
+		error = "version " + std::to_string(version) + ", expected " + std::to_string(VERSION);
+		return false;
+	}
+
+	if (commandCount > MAX_COMMANDS || dataSize > MAX_DATA_SIZE || bufferCount > MAX_COMMANDS)
+	{
+		error = "corrupt header";
+		return false;
+	}
+
+	capture.m_Commands.resize(commandCount);
+	for (auto &command : capture.m_Commands)
+	{
+		uint8_t op;
+		bool ok = ReadValue(in, op);
+		for (auto &arg : command.Args)
+			ok = ok && ReadValue(in, arg);
+		for (auto &object : command.Objects)
+			ok = ok && ReadValue(in, object);
+		ok = ok && ReadValue(in, command.DataOffset) && ReadValue(in, command.DataSize);
+
+		if (!ok)
+		{
+			error = "truncated commands";
+			return false;
+		}
+
+		if (op >= (uint8_t)CaptureOp::Count)
+		{
+			error = "unknown command " + std::to_string(op);
+			return false;
+		}
+
+		if ((uint64_t)command.DataOffset + command.DataSize > dataSize)
+		{
+			error = "command data out of range";
+			return false;
+		}
+
+		command.Op = (CaptureOp)op;
+	}
+
+	if (!ReadBytes(in, capture.m_Data, dataSize))
+	{
+		error = "truncated data";
+		return false;
+	}
+
+	for (uint32_t i = 0; i < bufferCount; i++)
+	{
+		uint64_t address;
+		uint32_t size;
+		std::vector<uint8_t> bytes;
+		if (!ReadValue(in, address) || !ReadValue(in, size) || size > MAX_DATA_SIZE ||
+			!ReadBytes(in, bytes, size))
+		{
+			error = "truncated buffers";
+			return false;
+		}
+
+		capture.AddBuffer(address, bytes.data(), size);
+	}
+
+	return true;
+}
+
+std::vector<CapturePassStats> FrameCapture::Analyze() const
+{
+	std::vector<CapturePassStats> passes(1);
+	passes[0].Name = "Total";
+
+	// the frame and the passes that are open
+	std::vector<size_t> open = {0};
+	BoundState bound;
+
+	for (auto &command : m_Commands)
+	{
+		const uint32_t *args = command.Args;
+		const uint64_t *objects = command.Objects;
+		uint32_t compute = args[0] ? 1 : 0;
+
+		UINT draws = 0, dispatches = 0, barriers = 0, barrierCalls = 0, stateSets = 0, redundant = 0;
+		UINT64 primitives = 0, threadGroups = 0, bytesBound = 0;
+
+		auto stateSet = [&](bool changed) {
+			stateSets++;
+			redundant += changed ? 0 : 1;
+		};
+
+		switch (command.Op)
+		{
+		case CaptureOp::BeginPass:
+		{
+			CapturePassStats pass;
+			pass.Name = open.size() == 1 ? PassName(command) : passes[open.back()].Name + "/" + PassName(command);
+			pass.Depth = (int)open.size();
+
+			open.push_back(passes.size());
+			passes.push_back(pass);
+			continue;
+		}
+
+		case CaptureOp::EndPass:
+			// an unmatched end closes nothing
+			if (open.size() > 1)
+				open.pop_back();
+			continue;
+
+		case CaptureOp::ResetState:
+			bound = BoundState();
+			break;
+
+		case CaptureOp::Draw:
+		case CaptureOp::DrawIndexed:
+			draws = 1;
+			primitives = (UINT64)args[0] / 3 * args[1];
+			break;
+
+		case CaptureOp::ExecuteIndirect:
+			draws = args[0];
+			break;
+
+		case CaptureOp::Dispatch:
+			dispatches = 1;
+			threadGroups = (UINT64)args[0] * args[1] * args[2];
+			break;
+
+		case CaptureOp::Barrier:
+			barriers = args[0];
+			barrierCalls = 1;
+			break;
+
+		case CaptureOp::SetPipelineState:
+			stateSet(SetIfChanged(bound.PipelineState, objects[0]));
+			break;
+
+		case CaptureOp::SetRootSignature:
+		{
+			bool changed = SetIfChanged(bound.RootSignature[compute], objects[0]);
+			stateSet(changed);
+
+			// a new root signature drops every root argument set before it
+			if (changed)
+			{
+				bound.Tables[compute].clear();
+				bound.Views[compute].clear();
+				bound.Constants[compute].clear();
+			}
+			break;
+		}
+
+		case CaptureOp::SetRootConstants:
+		{
+			auto values = reinterpret_cast<const uint32_t *>(m_Data.data() + command.DataOffset);
+			bool changed = false;
+			for (uint32_t i = 0; i < command.DataSize / 4; i++)
+			{
+				uint32_t value;
+				memcpy(&value, values + i, sizeof(value));
+				changed |= SetIfChanged(bound.Constants[compute], std::make_pair(args[1], args[2] + i), value);
+			}
+
+			stateSet(changed);
+			bytesBound = command.DataSize;
+			break;
+		}
+
+		case CaptureOp::SetRootView:
+		{
+			stateSet(SetIfChanged(bound.Views[compute], args[1], objects[0]));
+
+			auto buffer = m_BufferIndices.find(objects[0]);
+			if ((CaptureView)args[2] == CaptureView::CBV && buffer != m_BufferIndices.end())
+				bytesBound = m_Buffers[buffer->second].Bytes.size();
+			break;
+		}
+
+		case CaptureOp::SetDescriptorTable:
+			stateSet(SetIfChanged(bound.Tables[compute], args[1], objects[0]));
+			break;
+
+		case CaptureOp::SetDescriptorHeaps:
+		{
+			uint64_t heaps[2] = {objects[0], objects[1]};
+			bool changed = heaps[0] != bound.Heaps[0] || heaps[1] != bound.Heaps[1];
+			bound.Heaps[0] = heaps[0];
+			bound.Heaps[1] = heaps[1];
+			stateSet(changed);
+			break;
+		}
+
+		case CaptureOp::SetTopology:
+			stateSet(SetIfChanged(bound.Topology, args[0]));
+			break;
+
+		case CaptureOp::SetVertexBuffers:
+			stateSet(SetIfChanged(bound.VertexBuffers, args[0], CommandData(command)));
+			break;
+
+		case CaptureOp::SetIndexBuffer:
+			stateSet(SetIfChanged(bound.IndexBuffer, std::make_tuple(objects[0], args[0], args[1])));
+			break;
+
+		case CaptureOp::SetRenderTargets:
+			stateSet(SetIfChanged(bound.RenderTargets, std::make_tuple(args[0], args[1], objects[0], CommandData(command))));
+			break;
+
+		case CaptureOp::SetViewports:
+		case CaptureOp::SetScissorRects:
+		{
+			auto &boundRects = command.Op == CaptureOp::SetViewports ? bound.Viewports : bound.ScissorRects;
+			stateSet(SetIfChanged(boundRects, CommandData(command)));
+			break;
+		}
+
+		default:
+			break;
+		}
+
+		for (size_t index : open)
+		{
+			CapturePassStats &pass = passes[index];
+			pass.Draws += draws;
+			pass.Primitives += primitives;
+			pass.Dispatches += dispatches;
+			pass.ThreadGroups += threadGroups;
+			pass.Barriers += barriers;
+			pass.BarrierCalls += barrierCalls;
+			pass.StateSets += stateSets;
+			pass.RedundantStateSets += redundant;
+			pass.BytesBound += bytesBound;
+		}
+	}
+
+	return passes;
+}
+
+void FrameCapture::WriteReport(std::ostream &out, const std::vector<CapturePassStats> &passes)
+{
+	const int nameWidth = 40;
+
+	out << std::left << std::setw(nameWidth) << "Pass" << std::right << std::setw(8) << "Draws"
+		<< std::setw(12) << "Primitives" << std::setw(10) << "Dispatch" << std::setw(10) << "Barriers"
+		<< std::setw(8) << "Calls" << std::setw(8) << "Sets" << std::setw(11) << "Redundant"
+		<< std::setw(12) << "Bytes" << '\n';
+
+	for (auto &pass : passes)
+	{
+		// nested passes show only their own name, indented under their parent
+		std::string name = pass.Name.substr(pass.Name.rfind('/') + 1);
+		name = std::string(pass.Depth * 2, ' ') + name;
+		if ((int)name.size() >= nameWidth)
+			name = name.substr(0, nameWidth - 1);
+
+		out << std::left << std::setw(nameWidth) << name << std::right << std::setw(8) << pass.Draws
+			<< std::setw(12) << pass.Primitives << std::setw(10) << pass.Dispatches << std::setw(10)
+			<< pass.Barriers << std::setw(8) << pass.BarrierCalls << std::setw(8) << pass.StateSets
+			<< std::setw(11) << pass.RedundantStateSets << std::setw(12) << pass.BytesBound << '\n';
+	}
+}
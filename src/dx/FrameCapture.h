@@ -0,0 +1,118 @@
+#pragma once
+
+#include "pch.h"
+
+enum class CaptureOp : uint8_t
+{
+	BeginPass,			// Data: the name
+	EndPass,
+	ResetState,			// Reset or ClearState of the command list
+	Draw,				// Args: vertices per instance, instances
+	DrawIndexed,		// Args: indices per instance, instances
+	ExecuteIndirect,	// Args: max commands
+	Dispatch,			// Args: thread groups in x, y and z
+	Barrier,			// Args: barriers, of them transitions, UAV barriers
+	SetPipelineState,	// Objects[0]: the state
+	SetRootSignature,	// Args[0]: compute; Objects[0]: the signature
+	SetRootConstants,	// Args: compute, parameter, first value; Data: the values
+	SetRootView,		// Args: compute, parameter, CaptureView; Objects[0]: GPU address
+	SetDescriptorTable, // Args: compute, parameter; Objects[0]: GPU handle
+	SetDescriptorHeaps, // Objects: the heaps
+	SetTopology,		// Args[0]: the topology
+	SetVertexBuffers,	// Args: first slot, views; Data: the views
+	SetIndexBuffer,		// Args: size, format; Objects[0]: address
+	SetRenderTargets,	// Args: render targets, single handle range; Objects[0]: depth handle; Data: render target handles
+	SetViewports,		// Args[0]: viewports; Data: the viewports
+	SetScissorRects,	// Args[0]: rects; Data: the rects
+	Clear,				// Args[0]: CaptureClear
+	Copy,				// Args[0]: bytes for buffer copies, 0 for textures
+	Count
+};
+
+enum class CaptureView : uint32_t
+{
+	CBV,
+	SRV,
+	UAV
+};
+
+enum class CaptureClear : uint32_t
+{
+	RenderTarget,
+	DepthStencil,
+	UnorderedAccess
+};
+
+struct CaptureCommand
+{
+	CaptureOp Op = CaptureOp::Count;
+	uint32_t Args[3] = {};
+	uint64_t Objects[2] = {};
+
+	// into FrameCapture::Data
+	uint32_t DataOffset = 0;
+	uint32_t DataSize = 0;
+};
+
+// Contents of a constant buffer bound during the frame, as they were when it was bound
+struct CaptureBuffer
+{
+	uint64_t Address;
+	std::vector<uint8_t> Bytes;
+};
+
+// Numbers of a pass, including the passes nested in it
+struct CapturePassStats
+{
+	std::string Name;
+	int Depth = 0;
+
+	UINT Draws = 0; // ExecuteIndirect counts its maximum command count
+	UINT64 Primitives = 0; // indices or vertices over 3, of the direct draws only
+	UINT Dispatches = 0;
+	UINT64 ThreadGroups = 0;
+	UINT Barriers = 0;
+	UINT BarrierCalls = 0;
+
+	UINT StateSets = 0;
+	UINT RedundantStateSets = 0; // set to what was already bound
+	UINT64 BytesBound = 0;		 // root constants and the constant buffers that were captured
+};
+
+// One frame of recorded commands, as CaptureCommandList records them, in a compact binary file.
+// Needs no GPU: the commands keep only numbers, pointers and addresses, and the analysis only
+// compares them.
+class FrameCapture
+{
+public:
+	static const uint32_t MAGIC = 0x50414359; // "YCAP"
+	static const uint32_t VERSION = 1;
+
+	void Add(const CaptureCommand &command, const void *data = nullptr, uint32_t dataSize = 0);
+
+	// keeps the first contents seen at an address
+	void AddBuffer(uint64_t address, const void *data, uint32_t size);
+	bool HasBuffer(uint64_t address) const { return m_BufferIndices.count(address) > 0; }
+
+	const std::vector<CaptureCommand> &Commands() const { return m_Commands; }
+	const std::vector<uint8_t> &Data() const { return m_Data; }
+	const std::vector<CaptureBuffer> &Buffers() const { return m_Buffers; }
+
+	std::vector<uint8_t> CommandData(const CaptureCommand &command) const;
+	std::string PassName(const CaptureCommand &command) const;
+
+	void Write(std::ostream &out) const;
+	static bool Read(std::istream &in, FrameCapture &capture, std::string &error);
+
+	// a row for the whole frame, then one per pass in the order they began; commands outside of
+	// any pass count for the frame only
+	std::vector<CapturePassStats> Analyze() const;
+
+	static void WriteReport(std::ostream &out, const std::vector<CapturePassStats> &passes);
+
+private:
+	std::vector<CaptureCommand> m_Commands;
+	std::vector<uint8_t> m_Data;
+	std::vector<CaptureBuffer> m_Buffers;
+	std::unordered_map<uint64_t, size_t> m_BufferIndices;
+};
@@ -0,0 +1,161 @@
+#include "pch.h"
+#include "GpuMemory.h"
+
+std::mutex GpuMemory::s_Mutex;
+GpuMemoryTracker GpuMemory::s_Tracker;
+std::unordered_map<ID3D12Object *, UINT64> GpuMemory::s_Ids;
+
+thread_local GpuMemoryCategory GpuMemory::s_Category = GpuMemoryCategory::Other;
+
+// {5E0C9C2B-6A0B-4B7E-9A43-3C1B8E2F7D11}
+static const GUID GPU_MEMORY_RELEASE_GUID = {0x5e0c9c2b, 0x6a0b, 0x4b7e, {0x9a, 0x43, 0x3c, 0x1b, 0x8e, 0x2f, 0x7d, 0x11}};
+
+// Attached to a tracked object as private data, which the object releases when it is destroyed.
+class GpuMemoryRelease : public IUnknown
+{
+public:
+	GpuMemoryRelease(ID3D12Object *object, UINT64 id)
+		: m_Object(object), m_Id(id)
+	{
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **object) override
+	{
+		if (riid != __uuidof(IUnknown))
+		{
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+
+		AddRef();
+		*object = static_cast<IUnknown *>(this);
+		return S_OK;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override { return ++m_RefCount; }
+
+	ULONG STDMETHODCALLTYPE Release() override
+	{
+		ULONG refCount = --m_RefCount;
+		if (refCount == 0)
+		{
+			GpuMemory::Untrack(m_Object, m_Id);
+			delete this;
+		}
+		return refCount;
+	}
+
+private:
+	std::atomic<ULONG> m_RefCount = 1;
+	ID3D12Object *m_Object;
+	UINT64 m_Id;
+};
+
+static GpuMemoryCategory HeapCategory(D3D12_HEAP_TYPE type)
+{
+	switch (type)
+	{
+	case D3D12_HEAP_TYPE_UPLOAD:
+		return GpuMemoryCategory::Upload;
+	case D3D12_HEAP_TYPE_READBACK:
+		return GpuMemoryCategory::Readback;
+	default:
+		return GpuMemory::CurrentCategory();
+	}
+}
+
+HRESULT GpuMemory::CreateCommittedResource(ID3D12Device *device, const D3D12_HEAP_PROPERTIES *heapProperties, D3D12_HEAP_FLAGS heapFlags,
+										   const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initialState,
+										   const D3D12_CLEAR_VALUE *optimizedClearValue, REFIID riid, void **resource)
+{
+	HRESULT hr = device->CreateCommittedResource(heapProperties, heapFlags, desc, initialState, optimizedClearValue, riid, resource);
+	if (FAILED(hr) || !resource || !*resource)
+		return hr;
+
+	// the same pointer the caller gets back for an ID3D12Resource
+	ComPtr<ID3D12Resource> created;
+	if (FAILED(static_cast<IUnknown *>(*resource)->QueryInterface(IID_PPV_ARGS(&created))))
+		return hr;
+
+	UINT64 bytes = device->GetResourceAllocationInfo(0, 1, desc).SizeInBytes;
+	Track(created.Get(), HeapCategory(heapProperties->Type), bytes, desc);
+	return hr;
+}
+
+HRESULT GpuMemory::CreateHeap(ID3D12Device *device, const D3D12_HEAP_DESC *desc, REFIID riid, void **heap)
+{
+	HRESULT hr = device->CreateHeap(desc, riid, heap);
+	if (FAILED(hr) || !heap || !*heap)
+		return hr;
+
+	ComPtr<ID3D12Heap> created;
+	if (FAILED(static_cast<IUnknown *>(*heap)->QueryInterface(IID_PPV_ARGS(&created))))
+		return hr;
+
+	Track(created.Get(), HeapCategory(desc->Properties.Type), desc->SizeInBytes, nullptr);
+	return hr;
+}
+
+GpuMemoryCategory GpuMemory::CategoryOf(ID3D12Object *object)
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+
+	auto it = s_Ids.find(object);
+	if (it == s_Ids.end())
+		return GpuMemoryCategory::Other;
+
+	return s_Tracker.Allocations().at(it->second).Category;
+}
+
+GpuMemoryTracker GpuMemory::Snapshot()
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	return s_Tracker;
+}
+
+void GpuMemory::ResetPeaks()
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	s_Tracker.ResetPeaks();
+}
+
+bool GpuMemory::WriteJson(const std::string &filename)
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		LOG_ERROR("GpuMemory: cannot write {}", filename);
+		return false;
+	}
+
+	GpuMemoryTracker tracker = Snapshot();
+	tracker.WriteJson(file);
+	LOG_INFO("GpuMemory: wrote {} allocation(s), {:.1f} MB, to {}", tracker.Allocations().size(), tracker.TotalBytes() / (1024.0 * 1024.0), filename);
+	return true;
+}
+
+void GpuMemory::Track(ID3D12Object *object, GpuMemoryCategory category, UINT64 bytes, const D3D12_RESOURCE_DESC *desc)
+{
+	UINT64 id;
+	{
+		std::lock_guard<std::mutex> lock(s_Mutex);
+		id = s_Tracker.Add(category, bytes, desc);
+		s_Ids[object] = id;
+	}
+
+	// the object holds the only reference from here on, a failure releases it right away
+	auto release = new GpuMemoryRelease(object, id);
+	object->SetPrivateDataInterface(GPU_MEMORY_RELEASE_GUID, release);
+	release->Release();
+}
+
+void GpuMemory::Untrack(ID3D12Object *object, UINT64 id)
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+
+	s_Tracker.Remove(id);
+
+	auto it = s_Ids.find(object);
+	if (it != s_Ids.end() && it->second == id)
+		s_Ids.erase(it);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "pch.h"
+#include "GpuMemoryTracker.h"
+
+// Records the memory of every resource and heap created through it. A resource is counted under
+// the category of the innermost GpuMemoryScope on the creating thread, except for upload and
+// readback heaps, which always count as Upload and Readback. Nothing has to be released by hand:
+// the entry is removed when the device destroys the resource, through a private data interface
+// attached to it.
+class GpuMemory
+{
+public:
+	// same as ID3D12Device::CreateCommittedResource
+	static HRESULT CreateCommittedResource(ID3D12Device *device, const D3D12_HEAP_PROPERTIES *heapProperties, D3D12_HEAP_FLAGS heapFlags,
+										   const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initialState,
+										   const D3D12_CLEAR_VALUE *optimizedClearValue, REFIID riid, void **resource);
+
+	// same as ID3D12Device::CreateHeap, for the memory that reserved resources are mapped to
+	static HRESULT CreateHeap(ID3D12Device *device, const D3D12_HEAP_DESC *desc, REFIID riid, void **heap);
+
+	// the category a resource was counted under, Other if it was not created here
+	static GpuMemoryCategory CategoryOf(ID3D12Object *object);
+
+	static GpuMemoryCategory CurrentCategory() { return s_Category; }
+
+	// a copy of the totals, taken under the lock
+	static GpuMemoryTracker Snapshot();
+	static void ResetPeaks();
+	static bool WriteJson(const std::string &filename);
+
+private:
+	static void Track(ID3D12Object *object, GpuMemoryCategory category, UINT64 bytes, const D3D12_RESOURCE_DESC *desc);
+	static void Untrack(ID3D12Object *object, UINT64 id);
+
+	friend class GpuMemoryScope;
+	friend class GpuMemoryRelease;
+
+private:
+	static std::mutex s_Mutex;
+	static GpuMemoryTracker s_Tracker;
+	static std::unordered_map<ID3D12Object *, UINT64> s_Ids;
+
+	static thread_local GpuMemoryCategory s_Category;
+};
+
+// counts the resources created on this thread under category until it goes out of scope
+class GpuMemoryScope
+{
+public:
+	GpuMemoryScope(GpuMemoryCategory category)
+		: m_Previous(GpuMemory::s_Category)
+	{
+		GpuMemory::s_Category = category;
+	}
+
+	~GpuMemoryScope() { GpuMemory::s_Category = m_Previous; }
+
+	GpuMemoryScope(const GpuMemoryScope &) = delete;
+	GpuMemoryScope &operator=(const GpuMemoryScope &) = delete;
+
+private:
+	GpuMemoryCategory m_Previous;
+};
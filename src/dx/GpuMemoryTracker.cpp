@@ -0,0 +1,313 @@
+#include "pch.h"
+#include "GpuMemoryTracker.h"
+
+UINT64 GpuMemoryTracker::Add(GpuMemoryCategory category, UINT64 bytes, const D3D12_RESOURCE_DESC *desc)
+{
+	GpuAllocation allocation = {category, bytes, {}};
+	if (desc)
+		allocation.Desc = *desc;
+
+	UINT64 id = m_NextId++;
+	m_Allocations.emplace(id, allocation);
+
+	CategoryTotals &totals = m_Categories[(int)category];
+	totals.Bytes += bytes;
+	totals.PeakBytes = std::max(totals.PeakBytes, totals.Bytes);
+	totals.Count++;
+
+	m_TotalBytes += bytes;
+	m_PeakTotalBytes = std::max(m_PeakTotalBytes, m_TotalBytes);
+
+	return id;
+}
+
+void GpuMemoryTracker::Remove(UINT64 id)
+{
+	auto it = m_Allocations.find(id);
+	if (it == m_Allocations.end())
+		return;
+
+	CategoryTotals &totals = m_Categories[(int)it->second.Category];
+	totals.Bytes -= it->second.Bytes;
+	totals.Count--;
+
+	m_TotalBytes -= it->second.Bytes;
+	m_Allocations.erase(it);
+}
+
+void GpuMemoryTracker::ResetPeaks()
+{
+	for (auto &totals : m_Categories)
+		totals.PeakBytes = totals.Bytes;
+
+	m_PeakTotalBytes = m_TotalBytes;
+}
+
+static const char *DimensionName(D3D12_RESOURCE_DIMENSION dimension)
+{
+	switch (dimension)
+	{
+	case D3D12_RESOURCE_DIMENSION_BUFFER:
+		return "buffer";
+	case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+		return "texture1d";
+	case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+		return "texture2d";
+	case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+		return "texture3d";
+	default:
+		return "heap";
+	}
+}
+
+void GpuMemoryTracker::WriteJson(std::ostream &out) const
+{
+	out << "{\n";
+	out << "  \"total\": {\"bytes\": " << m_TotalBytes << ", \"peak\": " << m_PeakTotalBytes << "},\n";
+
+	out << "  \"categories\": [\n";
+	for (int i = 0; i < (int)GpuMemoryCategory::Count; i++)
+	{
+		const CategoryTotals &totals = m_Categories[i];
+		out << "    {\"name\": \"" << CategoryName((GpuMemoryCategory)i) << "\", \"count\": " << totals.Count
+			<< ", \"bytes\": " << totals.Bytes << ", \"peak\": " << totals.PeakBytes << "}"
+			<< (i + 1 < (int)GpuMemoryCategory::Count ? ",\n" : "\n");
+	}
+	out << "  ],\n";
+
+	// the ids break ties, so that the same allocations always come out in the same order
+	std::vector<std::pair<UINT64, const GpuAllocation *>> allocations;
+	for (const auto &[id, allocation] : m_Allocations)
+		allocations.push_back({id, &allocation});
+
+	auto larger = [](const auto &a, const auto &b)
+	{
+		if (a.second->Bytes != b.second->Bytes)
+			return a.second->Bytes > b.second->Bytes;
+		return a.first < b.first;
+	};
+	std::sort(allocations.begin(), allocations.end(), larger);
+
+	out << "  \"allocations\": [\n";
+	for (size_t i = 0; i < allocations.size(); i++)
+	{
+		const GpuAllocation &allocation = *allocations[i].second;
+		const D3D12_RESOURCE_DESC &desc = allocation.Desc;
+
+		out << "    {\"category\": \"" << CategoryName(allocation.Category) << "\", \"bytes\": " << allocation.Bytes
+			<< ", \"dimension\": \"" << DimensionName(desc.Dimension) << "\"";
+		if (desc.Dimension != D3D12_RESOURCE_DIMENSION_UNKNOWN)
+		{
+			out << ", \"width\": " << desc.Width << ", \"height\": " << desc.Height << ", \"depth\": " << desc.DepthOrArraySize
+				<< ", \"mips\": " << desc.MipLevels << ", \"format\": " << (int)desc.Format;
+		}
+		out << "}" << (i + 1 < allocations.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+const char *GpuMemoryTracker::CategoryName(GpuMemoryCategory category)
+{
+	switch (category)
+	{
+	case GpuMemoryCategory::GBuffer:
+		return "GBuffer";
+	case GpuMemoryCategory::RenderTarget:
+		return "RenderTarget";
+	case GpuMemoryCategory::Shadow:
+		return "Shadow";
+	case GpuMemoryCategory::Voxel:
+		return "Voxel";
+	case GpuMemoryCategory::IBL:
+		return "IBL";
+	case GpuMemoryCategory::Mesh:
+		return "Mesh";
+	case GpuMemoryCategory::Texture:
+		return "Texture";
+	case GpuMemoryCategory::Upload:
+		return "Upload";
+	case GpuMemoryCategory::Readback:
+		return "Readback";
+	default:
+		return "Other";
+	}
+}
+
+static bool IsBlockCompressed(DXGI_FORMAT format)
+{
+	return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+		   (format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+}
+
+UINT64 GpuMemoryTracker::EstimateSize(const D3D12_RESOURCE_DESC &desc)
+{
+	const UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	auto alignUp = [](UINT64 size, UINT64 alignment)
+	{
+		return (size + alignment - 1) & ~(alignment - 1);
+	};
+
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		return alignUp(desc.Width, alignment);
+
+	UINT bits = BitsPerPixel(desc.Format);
+	bool compressed = IsBlockCompressed(desc.Format);
+
+	UINT64 width = desc.Width;
+	UINT height = desc.Height;
+	UINT depth = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? desc.DepthOrArraySize : 1;
+	UINT arraySize = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize;
+
+	UINT levels = desc.MipLevels;
+	if (levels == 0)
+	{
+		UINT64 largest = std::max<UINT64>({width, height, depth});
+		while (largest >> levels)
+			levels++;
+	}
+
+	UINT64 sliceBytes = 0;
+	for (UINT level = 0; level < levels; level++)
+	{
+		UINT64 w = std::max<UINT64>(width >> level, 1);
+		UINT64 h = std::max<UINT64>(height >> level, 1);
+		UINT64 d = std::max<UINT64>(depth >> level, 1);
+
+		// blocks of 4x4 pixels
+		if (compressed)
+			sliceBytes += ((w + 3) / 4) * ((h + 3) / 4) * bits * 2 * d;
+		else
+			sliceBytes += (w * bits + 7) / 8 * h * d;
+	}
+
+	UINT samples = std::max(desc.SampleDesc.Count, 1u);
+	UINT64 bytes = sliceBytes * arraySize * samples;
+
+	if (samples > 1)
+		return alignUp(bytes, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT);
+
+	// only textures that ask for it and fit into 64KB get the small alignment
+	if (desc.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT && bytes <= alignment)
+		return alignUp(bytes, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT);
+
+	return alignUp(bytes, alignment);
+}
+
+UINT GpuMemoryTracker::BitsPerPixel(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R32G8X24_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+	case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+	case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+		return 64;
+
+	case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_R16G16_TYPELESS:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R32_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R24G8_TYPELESS:
+	case DXGI_FORMAT_D24_UNORM_S8_UINT:
+	case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+	case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+		return 32;
+
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_D16_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+		return 16;
+
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "pch.h"
+
+enum class GpuMemoryCategory
+{
+	GBuffer,	  // G-buffer and depth buffer
+	RenderTarget, // SSAO, TAA and post processing targets
+	Shadow,
+	Voxel,
+	IBL,
+	Mesh,	 // geometry pool
+	Texture, // material textures
+	Upload,	 // everything in an upload heap
+	Readback,
+	Other,
+	Count
+};
+
+struct GpuAllocation
+{
+	GpuMemoryCategory Category;
+	UINT64 Bytes;
+	D3D12_RESOURCE_DESC Desc; // zero for heaps
+};
+
+// Totals and peaks of the GPU memory held per category. Only does the bookkeeping, the sizes come
+// from the caller, either from the device or from EstimateSize. Not thread safe, see GpuMemory.
+class GpuMemoryTracker
+{
+public:
+	static const UINT64 INVALID_ID = 0;
+
+	// returns the id to remove the allocation with
+	UINT64 Add(GpuMemoryCategory category, UINT64 bytes, const D3D12_RESOURCE_DESC *desc = nullptr);
+	void Remove(UINT64 id);
+
+	UINT64 Bytes(GpuMemoryCategory category) const { return m_Categories[(int)category].Bytes; }
+	UINT64 PeakBytes(GpuMemoryCategory category) const { return m_Categories[(int)category].PeakBytes; }
+	UINT Count(GpuMemoryCategory category) const { return m_Categories[(int)category].Count; }
+
+	UINT64 TotalBytes() const { return m_TotalBytes; }
+	UINT64 PeakTotalBytes() const { return m_PeakTotalBytes; }
+
+	// peaks start over from the current totals
+	void ResetPeaks();
+
+	const std::unordered_map<UINT64, GpuAllocation> &Allocations() const { return m_Allocations; }
+
+	// totals and peaks per category, then every allocation from the largest down
+	void WriteJson(std::ostream &out) const;
+
+	static const char *CategoryName(GpuMemoryCategory category);
+
+	// size of a committed resource as the device usually places it: the subresources packed one
+	// after another, rounded up to the 64KB placement alignment, 4MB for multisampled textures
+	static UINT64 EstimateSize(const D3D12_RESOURCE_DESC &desc);
+
+	// 0 for formats without a fixed size, block compressed formats count per pixel as well
+	static UINT BitsPerPixel(DXGI_FORMAT format);
+
+private:
+	struct CategoryTotals
+	{
+		UINT64 Bytes = 0;
+		UINT64 PeakBytes = 0;
+		UINT Count = 0;
+	};
+
+	CategoryTotals m_Categories[(int)GpuMemoryCategory::Count];
+	UINT64 m_TotalBytes = 0;
+	UINT64 m_PeakTotalBytes = 0;
+
+	std::unordered_map<UINT64, GpuAllocation> m_Allocations;
+	UINT64 m_NextId = 1;
+};
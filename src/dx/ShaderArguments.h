@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// The DXC arguments every shader is compiled with, shared with tools/ShaderReport so the report
+// measures the code the renderer runs. Plain C++, the report builds without the Windows SDK.
+inline std::vector<std::wstring> ShaderArguments(
+	const std::wstring &entrypoint, const std::wstring &target,
+	const std::vector<std::pair<std::string, std::string>> &defines)
+{
+	std::vector<std::wstring> arguments = {
+		L"-E", entrypoint,
+		L"-T", target,
+		L"-I", L"shaders/",
+		L"-Zi", // DXC_ARG_DEBUG
+		L"-WX"}; // DXC_ARG_WARNINGS_ARE_ERRORS
+
+	// -D NAME=VALUE for every macro
+	for (const auto &[name, value] : defines)
+	{
+		std::string define = name + "=" + value;
+		arguments.push_back(L"-D");
+		arguments.push_back(std::wstring(define.begin(), define.end()));
+	}
+
+	return arguments;
+}
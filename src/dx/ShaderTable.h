@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// An entry point of a file in shaders/, with the macros it is compiled with
+struct ShaderEntry
+{
+	const wchar_t *File;
+	const wchar_t *Entry;
+	const wchar_t *Target;
+	std::vector<std::pair<std::string, std::string>> Defines;
+};
+
+// Every shader the renderer compiles. PipelineStates and SSAO compile them from here and
+// tools/ShaderReport measures All, so the report cannot miss or misname one. Plain C++ like
+// ShaderArguments, for the report to build without the Windows SDK.
+class ShaderTable
+{
+public:
+	static inline const ShaderEntry SkyboxVS = {L"skybox.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry SkyboxPS = {L"skybox.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry ShadowVS = {L"shadow.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry GBufferVS = {L"gbuffer.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry GBufferPS = {L"gbuffer.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry DeferredLightingVS = {L"deferredLighting.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry DeferredLightingPS = {L"deferredLighting.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry TaaVS = {L"taa.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry TaaPS = {L"taa.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry FxaaVS = {L"fxaa.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry FxaaPS = {L"fxaa.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry MotionBlurVS = {L"motionBlur.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry MotionBlurPS = {L"motionBlur.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry ToneMappingVS = {L"toneMapping.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry ToneMappingPS = {L"toneMapping.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry ClearVoxelCS = {L"clearVoxel.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry ClearVoxelTextureCS = {L"clearVoxelTexture.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry VoxelBeginUpdateCS = {L"voxelBeginUpdate.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry VoxelizeVS = {L"voxelize.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry VoxelizeGS = {L"voxelize.hlsl", L"GS", L"gs_6_6", {}};
+	static inline const ShaderEntry VoxelizePS = {L"voxelize.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry VoxelizeClipmapVS = {L"voxelize.hlsl", L"VS", L"vs_6_6", {{"VOXEL_CLIPMAP", "1"}}};
+	static inline const ShaderEntry VoxelizeClipmapGS = {L"voxelize.hlsl", L"GS", L"gs_6_6", {{"VOXEL_CLIPMAP", "1"}}};
+	static inline const ShaderEntry VoxelizeClipmapPS = {L"voxelize.hlsl", L"PS", L"ps_6_6", {{"VOXEL_CLIPMAP", "1"}}};
+	static inline const ShaderEntry VoxelBuffer2TexCS = {L"voxelBuffer2Tex.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry VoxelClipmapBuffer2TexCS = {L"voxelClipmapBuffer2Tex.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry VoxelDebugVS = {L"voxelDebug.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry VoxelDebugGS = {L"voxelDebug.hlsl", L"GS", L"gs_6_6", {}};
+	static inline const ShaderEntry VoxelDebugPS = {L"voxelDebug.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry VoxelMipmapCS = {L"voxelMipmap.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry VoxelSecondBounceCS = {L"voxelSecondBounce.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry DepthReductionCS = {L"depthReduction.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry Equirect2CubeCS = {L"equirect2cube.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry SpMapCS = {L"spmap.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry SpBRDFCS = {L"spbrdf.hlsl", L"main", L"cs_6_6", {}};
+	static inline const ShaderEntry MipmapCS = {L"downsample_array.hlsl", L"downsample_linear", L"cs_6_6", {}};
+	static inline const ShaderEntry DebugVS = {L"debug.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry DebugPS = {L"debug.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry SSAOVS = {L"ssao.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry SSAOPS = {L"ssao.hlsl", L"PS", L"ps_6_6", {}};
+	static inline const ShaderEntry SSAOBlurVS = {L"ssaoBlur.hlsl", L"VS", L"vs_6_6", {}};
+	static inline const ShaderEntry SSAOBlurPS = {L"ssaoBlur.hlsl", L"PS", L"ps_6_6", {}};
+
+	// the entries above, in the order they are listed
+	static inline const std::vector<const ShaderEntry *> All = {
+		&SkyboxVS, &SkyboxPS, &ShadowVS, &GBufferVS, &GBufferPS, &DeferredLightingVS, &DeferredLightingPS,
+		&TaaVS, &TaaPS, &FxaaVS, &FxaaPS, &MotionBlurVS, &MotionBlurPS, &ToneMappingVS, &ToneMappingPS,
+		&ClearVoxelCS, &ClearVoxelTextureCS, &VoxelBeginUpdateCS,
+		&VoxelizeVS, &VoxelizeGS, &VoxelizePS, &VoxelizeClipmapVS, &VoxelizeClipmapGS, &VoxelizeClipmapPS,
+		&VoxelBuffer2TexCS, &VoxelClipmapBuffer2TexCS, &VoxelDebugVS, &VoxelDebugGS, &VoxelDebugPS,
+		&VoxelMipmapCS, &VoxelSecondBounceCS, &DepthReductionCS,
+		&Equirect2CubeCS, &SpMapCS, &SpBRDFCS, &MipmapCS, &DebugVS, &DebugPS,
+		&SSAOVS, &SSAOPS, &SSAOBlurVS, &SSAOBlurPS};
+};
@@ -0,0 +1,145 @@
+#include "pch.h"
+#include "StagingManager.h"
+
+StagingManager::StagingManager(Device device, UINT64 ringSize)
+	: m_Device(device), m_Ring(ringSize)
+{
+	CreateRing(ringSize);
+}
+
+void StagingManager::CreateRing(UINT64 size)
+{
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_RingBuffer)));
+	SET_NAME(m_RingBuffer, "Staging Ring");
+
+	// keep the ring mapped for its whole lifetime
+	ThrowIfFailed(m_RingBuffer->Map(0, nullptr, reinterpret_cast<void **>(&m_RingCPUAddress)));
+
+	m_Ring = StagingRing(size);
+}
+
+StagingManager::~StagingManager()
+{
+	if (m_RingBuffer != nullptr)
+		m_RingBuffer->Unmap(0, nullptr);
+}
+
+StagingAllocation StagingManager::Allocate(UINT64 size, UINT64 alignment)
+{
+	COUNTER_ADD("Upload Bytes", size);
+
+	StagingAllocation allocation;
+
+	UINT64 offset = m_Ring.Allocate(size, alignment);
+	if (offset != StagingRing::InvalidOffset)
+	{
+		allocation.Resource = m_RingBuffer.Get();
+		allocation.Offset = offset;
+		allocation.CPUAddress = m_RingCPUAddress + offset;
+
+		m_PeakBytes = std::max(m_PeakBytes, UsedBytes());
+		return allocation;
+	}
+
+	// the ring is full or the request is larger than the ring
+	DedicatedBuffer dedicated = {nullptr, size, 0};
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&dedicated.Buffer)));
+
+	ThrowIfFailed(dedicated.Buffer->Map(0, nullptr, reinterpret_cast<void **>(&allocation.CPUAddress)));
+	allocation.Resource = dedicated.Buffer.Get();
+	allocation.Offset = 0;
+
+	m_PendingDedicatedBuffers.push_back(dedicated);
+	m_DedicatedBytes += size;
+	m_NumDedicatedAllocations++;
+
+	m_PeakBytes = std::max(m_PeakBytes, UsedBytes());
+
+	return allocation;
+}
+
+void StagingManager::CopyToBuffer(GraphicsCommandList commandList, ID3D12Resource *destination, UINT64 destinationOffset,
+								  const void *data, UINT64 size)
+{
+	StagingAllocation allocation = Allocate(size, 16);
+	memcpy(allocation.CPUAddress, data, size);
+
+	commandList->CopyBufferRegion(destination, destinationOffset, allocation.Resource, allocation.Offset, size);
+}
+
+void StagingManager::CopyToTexture(GraphicsCommandList commandList, ID3D12Resource *destination,
+								   UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA *data)
+{
+	UINT64 requiredSize = GetRequiredIntermediateSize(destination, firstSubresource, numSubresources);
+	StagingAllocation allocation = Allocate(requiredSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+	UpdateSubresources(commandList.Get(), destination, allocation.Resource, allocation.Offset,
+					   firstSubresource, numSubresources, data);
+}
+
+void StagingManager::Submit(UINT64 fenceValue)
+{
+	m_Ring.Submit(fenceValue);
+
+	for (auto &dedicated : m_PendingDedicatedBuffers)
+	{
+		dedicated.Buffer->Unmap(0, nullptr);
+		dedicated.FenceValue = fenceValue;
+		m_InFlightDedicatedBuffers.push(dedicated);
+	}
+	m_PendingDedicatedBuffers.clear();
+}
+
+void StagingManager::Reclaim(UINT64 completedFenceValue)
+{
+	m_Ring.Reclaim(completedFenceValue);
+
+	while (!m_InFlightDedicatedBuffers.empty() && m_InFlightDedicatedBuffers.front().FenceValue <= completedFenceValue)
+	{
+		m_DedicatedBytes -= m_InFlightDedicatedBuffers.front().Size;
+		m_InFlightDedicatedBuffers.pop();
+	}
+}
+
+bool StagingManager::EndLoad(UINT64 ringSize)
+{
+	if (m_Loading)
+	{
+		m_Loading = false;
+		m_LoadPeakBytes = m_PeakBytes;
+		m_NumLoadDedicatedAllocations = m_NumDedicatedAllocations;
+		m_PeakBytes = UsedBytes();
+		m_NumDedicatedAllocations = 0;
+	}
+
+	if (ringSize == m_Ring.Capacity() || m_Ring.UsedBytes() > 0)
+		return false;
+
+	m_RingBuffer->Unmap(0, nullptr);
+	m_RingBuffer = nullptr;
+	CreateRing(ringSize);
+	return true;
+}
+
+void StagingManager::LogStats() const
+{
+	const double MB = 1024.0 * 1024.0;
+
+	LOG_INFO("Staging memory: {:.2f} MB ring, {:.2f} MB resident, {:.2f} MB in use", m_Ring.Capacity() / MB, ResidentBytes() / MB, UsedBytes() / MB);
+	LOG_INFO("  loading: {:.2f} MB peak, {} dedicated fallback allocation(s)", LoadPeakBytes() / MB,
+			 m_Loading ? m_NumDedicatedAllocations : m_NumLoadDedicatedAllocations);
+	if (!m_Loading)
+		LOG_INFO("  steady state: {:.2f} MB peak, {} dedicated fallback allocation(s)", SteadyPeakBytes() / MB, m_NumDedicatedAllocations);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "pch.h"
+
+#include "dx.h"
+#include "StagingRing.h"
+
+struct StagingAllocation
+{
+	ID3D12Resource *Resource = nullptr;
+	UINT64 Offset = 0;
+	BYTE *CPUAddress = nullptr;
+};
+
+// Hands out upload memory for CPU -> GPU copies from a persistently mapped ring.
+// Requests that do not fit fall back to a dedicated upload buffer with the same
+// lifetime rules. Either way the memory is recycled once the copy has completed,
+// so textures and meshes no longer keep their own upload heaps alive.
+class StagingManager
+{
+public:
+	StagingManager(Device device, UINT64 ringSize);
+	~StagingManager();
+
+	StagingAllocation Allocate(UINT64 size, UINT64 alignment = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+	void CopyToBuffer(GraphicsCommandList commandList, ID3D12Resource *destination, UINT64 destinationOffset,
+					  const void *data, UINT64 size);
+	void CopyToTexture(GraphicsCommandList commandList, ID3D12Resource *destination,
+					   UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA *data);
+
+	// called by DxContext when the command list recording the copies is executed / retired
+	void Submit(UINT64 fenceValue);
+	void Reclaim(UINT64 completedFenceValue);
+
+	// Ends the loading phase, the peaks and fallbacks count towards the steady state from here.
+	// The ring is replaced by one of ringSize if no copy out of it is in flight anymore, returns
+	// whether it was.
+	bool EndLoad(UINT64 ringSize);
+
+	// staging memory that is currently alive: the ring plus any dedicated fallback buffers
+	UINT64 ResidentBytes() const { return m_Ring.Capacity() + m_DedicatedBytes; }
+	// staging memory that copies use right now, out of the ring and in dedicated buffers
+	UINT64 UsedBytes() const { return m_Ring.UsedBytes() + m_DedicatedBytes; }
+
+	// the most UsedBytes while loading and since, the steady state is 0 until EndLoad
+	UINT64 LoadPeakBytes() const { return m_Loading ? m_PeakBytes : m_LoadPeakBytes; }
+	UINT64 SteadyPeakBytes() const { return m_Loading ? 0 : m_PeakBytes; }
+
+	void LogStats() const;
+
+private:
+	void CreateRing(UINT64 size);
+
+private:
+	struct DedicatedBuffer
+	{
+		Resource Buffer;
+		UINT64 Size;
+		UINT64 FenceValue;
+	};
+
+	Device m_Device;
+
+	Resource m_RingBuffer;
+	BYTE *m_RingCPUAddress = nullptr;
+	StagingRing m_Ring;
+
+	std::vector<DedicatedBuffer> m_PendingDedicatedBuffers;
+	std::queue<DedicatedBuffer> m_InFlightDedicatedBuffers;
+	UINT64 m_DedicatedBytes = 0;
+
+	bool m_Loading = true;
+	UINT64 m_PeakBytes = 0;
+	UINT64 m_LoadPeakBytes = 0;
+	UINT m_NumDedicatedAllocations = 0;
+	UINT m_NumLoadDedicatedAllocations = 0;
+};
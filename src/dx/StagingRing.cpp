@@ -0,0 +1,71 @@
+#include "pch.h"
+#include "StagingRing.h"
+
+static UINT64 AlignUp(UINT64 value, UINT64 alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+StagingRing::StagingRing(UINT64 capacity)
+	: m_Capacity(capacity)
+{
+}
+
+UINT64 StagingRing::Allocate(UINT64 size, UINT64 alignment)
+{
+	if (size == 0 || size > m_Capacity)
+		return InvalidOffset;
+
+	// restart from the beginning whenever the ring drains, keeps large allocations from wrapping
+	if (m_UsedBytes == 0)
+		m_Head = m_Tail = 0;
+	else if (m_Head == m_Tail)
+		return InvalidOffset;
+
+	UINT64 offset = AlignUp(m_Head, alignment);
+	UINT64 padding = offset - m_Head;
+
+	if (m_Head >= m_Tail)
+	{
+		// free space is [head, capacity) followed by [0, tail)
+		if (offset + size > m_Capacity)
+		{
+			if (size > m_Tail)
+				return InvalidOffset;
+
+			padding = m_Capacity - m_Head;
+			offset = 0;
+		}
+	}
+	else if (offset + size > m_Tail)
+	{
+		// free space is [head, tail)
+		return InvalidOffset;
+	}
+
+	m_Head = offset + size;
+	m_UsedBytes += padding + size;
+	m_PendingBytes += padding + size;
+
+	return offset;
+}
+
+void StagingRing::Submit(UINT64 fenceValue)
+{
+	if (m_PendingBytes == 0)
+		return;
+
+	m_Submissions.push({m_Head, m_PendingBytes, fenceValue});
+	m_PendingBytes = 0;
+}
+
+void StagingRing::Reclaim(UINT64 completedFenceValue)
+{
+	while (!m_Submissions.empty() && m_Submissions.front().FenceValue <= completedFenceValue)
+	{
+		const auto &submission = m_Submissions.front();
+		m_Tail = submission.End;
+		m_UsedBytes -= submission.Bytes;
+		m_Submissions.pop();
+	}
+}
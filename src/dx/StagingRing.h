@@ -0,0 +1,42 @@
+#pragma once
+
+#include "pch.h"
+
+// Bookkeeping of a ring of staging memory, independent of any D3D object.
+// Allocations are tagged with the fence of the command list that consumes them
+// on Submit, and the ring space is given back once that fence has completed.
+class StagingRing
+{
+public:
+	static const UINT64 InvalidOffset = UINT64_MAX;
+
+	StagingRing(UINT64 capacity);
+
+	// returns InvalidOffset if there is not enough free space left
+	UINT64 Allocate(UINT64 size, UINT64 alignment);
+
+	void Submit(UINT64 fenceValue);
+	void Reclaim(UINT64 completedFenceValue);
+
+	UINT64 Capacity() const { return m_Capacity; }
+	UINT64 UsedBytes() const { return m_UsedBytes; }
+	UINT64 PendingBytes() const { return m_PendingBytes; }
+
+private:
+	struct Submission
+	{
+		UINT64 End;
+		UINT64 Bytes;
+		UINT64 FenceValue;
+	};
+
+	UINT64 m_Capacity;
+
+	UINT64 m_Head = 0; // next free byte
+	UINT64 m_Tail = 0; // oldest byte still in use
+	UINT64 m_UsedBytes = 0;
+
+	// bytes allocated since the last Submit, including alignment and wrap-around padding
+	UINT64 m_PendingBytes = 0;
+	std::queue<Submission> m_Submissions;
+};
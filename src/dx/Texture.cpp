@@ -1,4 +1,5 @@
 #include "Texture.h"
+#include "Utils.h"
 
 Texture Texture::Create(Device device, UINT width, UINT height, UINT depth, DXGI_FORMAT format, UINT levels)
 {
@@ -19,7 +20,7 @@ Texture Texture::Create(Device device, UINT width, UINT height, UINT depth, DXGI
 	desc.SampleDesc = {1, 0};
 	desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS | D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
 
-	ThrowIfFailed(device->CreateCommittedResource(
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(device.Get(),
 		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 		D3D12_HEAP_FLAG_NONE,
 		&desc,
@@ -30,36 +31,24 @@ Texture Texture::Create(Device device, UINT width, UINT height, UINT depth, DXGI
 	return texture;
 }
 
-Texture Texture::Create(Device device, GraphicsCommandList commandList, Ref<Image> &image, DXGI_FORMAT format, UINT levels)
+Texture Texture::Create(Device device, GraphicsCommandList commandList, StagingManager &stagingManager, Ref<Image> &image, DXGI_FORMAT format, UINT levels)
 {
 	Texture texture = Create(device, image->Width(), image->Height(), 1, format, levels);
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(texture.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
 
-	// create an upload heap and upload the texture
-	// reference: https://www.braynzarsoft.net/viewtutorial/q16390-directx-12-textures-from-file
-
-	UINT64 textureUploadBufferSize;
-	device->GetCopyableFootprints(&texture.Resource->GetDesc(), 0, 1, 0, nullptr, nullptr, nullptr, &textureUploadBufferSize);
-
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(textureUploadBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(texture.UploadHeap.GetAddressOf())));
+	// the pixels go through the staging ring, no upload heap is kept around after the copy
 
 	D3D12_SUBRESOURCE_DATA sub = {};
 	sub.pData = image->Pixels<void>();
 	sub.RowPitch = image->Pitch();
 	sub.SlicePitch = image->Pitch() * image->Height();
 
-	UpdateSubresources(commandList.Get(), texture.Resource.Get(), texture.UploadHeap.Get(), 0, 0, 1, &sub);
+	stagingManager.CopyToTexture(commandList, texture.Resource.Get(), 0, 1, &sub);
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(texture.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON));
 
 	return texture;
 }
@@ -73,9 +62,11 @@ void Texture::Resize(Device device, UINT width, UINT height)
 	desc.Width = width;
 	desc.Height = height;
 
+	// counted under the same category as before
+	GpuMemoryScope memoryScope(GpuMemory::CategoryOf(Resource.Get()));
 	Resource = nullptr;
 
-	ThrowIfFailed(device->CreateCommittedResource(
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(device.Get(),
 		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 		D3D12_HEAP_FLAG_NONE,
 		&desc,
@@ -3,11 +3,12 @@
 #include "pch.h"
 #include "asset/Image.h"
 #include "DescriptorHeap.h"
+#include "StagingManager.h"
 
 struct Texture
 {
 	static Texture Create(Device device, UINT width, UINT height, UINT depth, DXGI_FORMAT format, UINT levels = 0);
-	static Texture Create(Device device, GraphicsCommandList commandList,
+	static Texture Create(Device device, GraphicsCommandList commandList, StagingManager& stagingManager,
 		Ref<Image>& image, DXGI_FORMAT format, UINT levels = 0);
 
 	void Resize(Device device, UINT width, UINT height);
@@ -21,7 +22,6 @@ struct Texture
 	UINT Width, Height, Levels;
 
 	ComPtr<ID3D12Resource> Resource = nullptr;
-	ComPtr<ID3D12Resource> UploadHeap = nullptr;
 
 	Descriptor Rtv;
 	Descriptor Dsv;
@@ -2,6 +2,7 @@
 
 #include "dx.h"
 #include "Utils.h"
+#include "CaptureCommandList.h"
 
 template<typename T>
 class UploadBuffer
@@ -22,7 +23,7 @@ public:
 		if (isConstantBuffer)
 			m_ElementByteSize = Utils::CalcConstantBufferByteSize(sizeof(T));
 
-		ThrowIfFailed(device->CreateCommittedResource(
+		ThrowIfFailed(GpuMemory::CreateCommittedResource(device.Get(),
 			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
 			D3D12_HEAP_FLAG_NONE,
 			&CD3DX12_RESOURCE_DESC::Buffer(m_ElementByteSize * elementCount),
@@ -32,6 +33,11 @@ public:
 
 		ThrowIfFailed(m_UploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_MappedData)));
 
+		// so a frame capture can save what the constant buffer views point at
+		if (isConstantBuffer)
+			CaptureCommandList::RegisterUploadRange(m_UploadBuffer->GetGPUVirtualAddress(), m_MappedData,
+				(UINT64)m_ElementByteSize * elementCount, m_ElementByteSize);
+
 		// We do not need to unmap until we are done with the resource.  However, we must not write to
 		// the resource while it is in use by the GPU (so we must use synchronization techniques).
 	}
@@ -41,7 +47,11 @@ public:
 	~UploadBuffer()
 	{
 		if (m_UploadBuffer != nullptr)
+		{
+			if (m_IsConstantBuffer)
+				CaptureCommandList::UnregisterUploadRange(m_UploadBuffer->GetGPUVirtualAddress());
 			m_UploadBuffer->Unmap(0, nullptr);
+		}
 
 		m_MappedData = nullptr;
 	}
@@ -53,6 +63,7 @@ public:
 
 	void CopyData(int elementIndex, const T& data)
 	{
+		COUNTER_ADD("Upload Bytes", sizeof(T));
 		memcpy(&m_MappedData[elementIndex * m_ElementByteSize], &data, sizeof(T));
 	}
 
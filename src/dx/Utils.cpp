@@ -1,8 +1,10 @@
 #include "Utils.h"
+#include "ShaderArguments.h"
 
-static ComPtr<IDxcUtils> g_DxcUtils = nullptr;
-static ComPtr<IDxcCompiler3> g_DxcCompiler = nullptr;
-static ComPtr<IDxcIncludeHandler> g_DxcIncludeHandler = nullptr;
+// the compiler may not be used by two threads at once, PipelineStates compiles on many
+static thread_local ComPtr<IDxcUtils> g_DxcUtils = nullptr;
+static thread_local ComPtr<IDxcCompiler3> g_DxcCompiler = nullptr;
+static thread_local ComPtr<IDxcIncludeHandler> g_DxcIncludeHandler = nullptr;
 
 Shader Utils::CompileShader(const std::wstring &filename, const D3D_SHADER_MACRO *defines, const std::wstring &entrypoint, const std::wstring &target)
 {
@@ -13,12 +15,15 @@ Shader Utils::CompileShader(const std::wstring &filename, const D3D_SHADER_MACRO
 		ThrowIfFailed(g_DxcUtils->CreateDefaultIncludeHandler(&g_DxcIncludeHandler));
 	}
 
-	std::vector<LPCWSTR> compilationArguments = {
-		L"-E", entrypoint.data(),
-		L"-T", target.data(),
-		L"-I", L"shaders/",
-		DXC_ARG_DEBUG,
-		DXC_ARG_WARNINGS_ARE_ERRORS};
+	std::vector<std::pair<std::string, std::string>> macros;
+	for (const D3D_SHADER_MACRO *macro = defines; macro && macro->Name; macro++)
+		macros.emplace_back(macro->Name, macro->Definition ? macro->Definition : "1");
+
+	// the wide strings have to outlive the compilation
+	std::vector<std::wstring> arguments = ShaderArguments(entrypoint, target, macros);
+	std::vector<LPCWSTR> compilationArguments;
+	for (const auto &argument : arguments)
+		compilationArguments.push_back(argument.c_str());
 
 	ComPtr<IDxcBlobEncoding> pSource = nullptr;
 	g_DxcUtils->LoadFile(filename.data(), nullptr, &pSource);
@@ -50,6 +55,22 @@ Shader Utils::CompileShader(const std::wstring &filename, const D3D_SHADER_MACRO
 	return shader;
 }
 
+Shader Utils::CompileShader(const ShaderEntry &shader)
+{
+	std::vector<D3D_SHADER_MACRO> defines;
+	for (const auto &[name, value] : shader.Defines)
+		defines.push_back({name.c_str(), value.c_str()});
+	defines.push_back({nullptr, nullptr});
+
+	return CompileShader(std::wstring(L"shaders\\") + shader.File, defines.data(), shader.Entry, shader.Target);
+}
+
+void Utils::ResourceBarrier(ID3D12GraphicsCommandList *commandList, UINT numBarriers, const D3D12_RESOURCE_BARRIER *barriers)
+{
+	COUNTER_ADD("Barriers", numBarriers);
+	commandList->ResourceBarrier(numBarriers, barriers);
+}
+
 RootSignature Utils::CreateRootSignature(
 	Device device,
 	CD3DX12_ROOT_SIGNATURE_DESC &desc)
@@ -77,12 +98,12 @@ RootSignature Utils::CreateRootSignature(
 	return rootSignature;
 }
 
-Resource Utils::CreateDefaultBuffer(Device device, GraphicsCommandList commandList, const void *initData, UINT64 byteSize, Resource &uploadBuffer)
+Resource Utils::CreateDefaultBuffer(Device device, GraphicsCommandList commandList, const void *initData, UINT64 byteSize, StagingManager &stagingManager)
 {
 	Resource defaultBuffer;
 
 	// Create the actual default buffer resource.
-	ThrowIfFailed(device->CreateCommittedResource(
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(device.Get(),
 		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 		D3D12_HEAP_FLAG_NONE,
 		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
@@ -90,34 +111,13 @@ Resource Utils::CreateDefaultBuffer(Device device, GraphicsCommandList commandLi
 		nullptr,
 		IID_PPV_ARGS(defaultBuffer.GetAddressOf())));
 
-	// In order to copy CPU memory data into our default buffer, we need to create
-	// an intermediate upload heap.
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
-
-	// Describe the data we want to copy into the default buffer.
-	D3D12_SUBRESOURCE_DATA subResourceData = {};
-	subResourceData.pData = initData;
-	subResourceData.RowPitch = byteSize;
-	subResourceData.SlicePitch = subResourceData.RowPitch;
-
-	// Schedule to copy the data to the default buffer resource.  At a high level, the helper function UpdateSubresources
-	// will copy the CPU memory into the intermediate upload heap.  Then, using ID3D12CommandList::CopySubresourceRegion,
-	// the intermediate upload heap data will be copied to mBuffer.
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
-																		  D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
-	UpdateSubresources<1>(commandList.Get(), defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subResourceData);
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
-																		  D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
-
-	// Note: uploadBuffer has to be kept alive after the above function calls because
-	// the command list has not been executed yet that performs the actual copy.
-	// The caller can Release the uploadBuffer after it knows the copy has been executed.
+	// The data goes through the staging ring, which recycles the intermediate
+	// memory once the command list performing the copy has completed.
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+																			 D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+	stagingManager.CopyToBuffer(commandList, defaultBuffer.Get(), 0, initData, byteSize);
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+																			 D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
 
 	return defaultBuffer;
 }
\ No newline at end of file
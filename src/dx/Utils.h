@@ -2,6 +2,8 @@
 
 #include "pch.h"
 #include "dx/dx.h"
+#include "dx/StagingManager.h"
+#include "dx/ShaderTable.h"
 
 class Utils
 {
@@ -10,12 +12,21 @@ public:
 		const std::wstring &filename, const D3D_SHADER_MACRO *defines,
 		const std::wstring &entrypoint, const std::wstring &target);
 
+	// a shader of the ShaderTable, from shaders/
+	static Shader CompileShader(const ShaderEntry &shader);
+
+	// records the barriers and adds them to the Barriers counter, every barrier is issued through here
+	static void ResourceBarrier(ID3D12GraphicsCommandList *commandList, UINT numBarriers, const D3D12_RESOURCE_BARRIER *barriers);
+	static void ResourceBarrier(GraphicsCommandList commandList, UINT numBarriers, const D3D12_RESOURCE_BARRIER *barriers) { ResourceBarrier(commandList.Get(), numBarriers, barriers); }
+	static void ResourceBarrier(ID3D12GraphicsCommandList *commandList, const D3D12_RESOURCE_BARRIER &barrier) { ResourceBarrier(commandList, 1, &barrier); }
+	static void ResourceBarrier(GraphicsCommandList commandList, const D3D12_RESOURCE_BARRIER &barrier) { ResourceBarrier(commandList.Get(), 1, &barrier); }
+
 	static RootSignature CreateRootSignature(
 		Device device, CD3DX12_ROOT_SIGNATURE_DESC &desc);
 
 	static Resource CreateDefaultBuffer(
 		Device device, GraphicsCommandList commandList,
-		const void *initData, UINT64 byteSize, Resource &uploadBuffer);
+		const void *initData, UINT64 byteSize, StagingManager &stagingManager);
 
 	static UINT CalcConstantBufferByteSize(UINT byteSize)
 	{
@@ -3,6 +3,8 @@
 #include "pch.h"
 #include <dxcapi.h>
 
+#include "GpuMemory.h"
+
 const int NUM_FRAMES_IN_FLIGHT = 3;
 const DXGI_FORMAT BACK_BUFFER_FORMAT = DXGI_FORMAT_R16G16B16A16_FLOAT;
 const DXGI_FORMAT DEPTH_STENCIL_FORMAT = DXGI_FORMAT_D24_UNORM_S8_UINT;
@@ -25,6 +27,7 @@ typedef ComPtr<ID3DBlob> Blob;
 typedef ComPtr<IDxcBlob> Shader;
 typedef ComPtr<ID3D12PipelineState> PipelineState;
 typedef ComPtr<ID3D12RootSignature> RootSignature;
+typedef ComPtr<ID3D12CommandSignature> CommandSignature;
 typedef ComPtr<ID3D12CommandAllocator> CommandAllocator;
 typedef ComPtr<ID3D12GraphicsCommandList2> GraphicsCommandList;
 typedef ComPtr<ID3D12Fence> Fence;
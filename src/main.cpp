@@ -1,4 +1,7 @@
 #include "Application.h"
+#include "Benchmark.h"
+
+#include <fstream>
 
 #if defined(_DEBUG)
 #include <initguid.h>
@@ -12,15 +15,86 @@ void ReportLiveObjects()
 }
 #endif
 
+// Flies the camera along a path with a fixed time step and writes the frame times to <name>.csv
+// and their statistics to <name>.json. With the JSON of an earlier run as the baseline, fails if
+// the mean or a percentile got slower by more than the tolerance, 0.05 by default.
+// Usage: YARenderer --benchmark <path.txt> [--out <name>] [--baseline <name.json>] [--tolerance <fraction>]
+int RunBenchmark(int argc, char const *argv[])
+{
+	std::string out = "benchmark";
+	std::string baselineFile;
+	double tolerance = 0.05;
+
+	for (int i = 3; i < argc; i += 2)
+	{
+		std::string option = argv[i];
+		if (i + 1 >= argc)
+		{
+			LOG_ERROR("Benchmark: {} needs a value", option);
+			return 1;
+		}
+
+		if (option == "--out")
+			out = argv[i + 1];
+		else if (option == "--baseline")
+			baselineFile = argv[i + 1];
+		else if (option == "--tolerance")
+			tolerance = std::stod(argv[i + 1]);
+		else
+		{
+			LOG_ERROR("Benchmark: unknown option {}", option);
+			return 1;
+		}
+	}
+
+	Benchmark benchmark(NUM_FRAMES_IN_FLIGHT);
+	if (!benchmark.Load(argv[2]))
+		return 1;
+
+	BenchmarkResults baseline;
+	if (!baselineFile.empty())
+	{
+		std::ifstream file(baselineFile);
+		if (!file || !Benchmark::ReadJson(file, baseline))
+		{
+			LOG_ERROR("Benchmark: cannot read the baseline {}", baselineFile);
+			return 1;
+		}
+	}
+
+	Application().Run(&benchmark);
+
+	std::ofstream csv(out + ".csv");
+	benchmark.WriteCsv(csv);
+	std::ofstream json(out + ".json");
+	benchmark.WriteJson(json);
+
+	BenchmarkResults results = benchmark.Results();
+	LOG_INFO("Benchmark: {} frames, written to {}.csv and {}.json", results.Cpu.Count, out, out);
+	LOG_INFO("  cpu: mean {:.3f} ms, p50 {:.3f} ms, p95 {:.3f} ms, p99 {:.3f} ms", results.Cpu.Mean, results.Cpu.P50, results.Cpu.P95, results.Cpu.P99);
+	if (results.Gpu.Count > 0)
+		LOG_INFO("  gpu: mean {:.3f} ms, p50 {:.3f} ms, p95 {:.3f} ms, p99 {:.3f} ms", results.Gpu.Mean, results.Gpu.P50, results.Gpu.P95, results.Gpu.P99);
+
+	if (baselineFile.empty())
+		return 0;
+
+	int regressions = Benchmark::Compare(results, baseline, tolerance);
+	LOG_INFO("Benchmark: {} value(s) slower than {} by more than {:.1f}%", regressions, baselineFile, tolerance * 100.0);
+	return regressions == 0 ? 0 : 1;
+}
+
 int main(int argc, char const *argv[])
 {
 	Log::Init();
 	LOG_WARN("Initialized.");
 
+	if (argc >= 3 && std::string(argv[1]) == "--benchmark")
+		return RunBenchmark(argc, argv);
+
 #if defined(_DEBUG)
 	std::atexit(ReportLiveObjects);
 #endif
 
 	Application().Run();
 	return 0;
-}
\ No newline at end of file
+}
@@ -17,9 +17,13 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <queue>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 #include "directx/d3dx12.h"
 
@@ -49,6 +53,8 @@ inline Ref<T> make_ref(Args &&...args)
 }
 
 #include "core/Log.h"
+#include "core/Profiler.h"
+#include "core/Counters.h"
 
 // undefine min/max macros from the windows.h
 #if defined(max)
@@ -64,6 +70,7 @@ inline Ref<T> make_ref(Args &&...args)
         if (!(x))                                            \
         {                                                    \
             LOG_ERROR("Assertion Failed: {0}", __VA_ARGS__); \
+            ::Log::Shutdown();                               \
             __debugbreak();                                  \
         }                                                    \
     }
@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "CameraPath.h"
+
+bool CameraPath::Load(const std::string &filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		LOG_ERROR("Camera path: cannot open {}", filename);
+		return false;
+	}
+
+	std::string error;
+	if (!Parse(file, error))
+	{
+		LOG_ERROR("Camera path: {}: {}", filename, error);
+		return false;
+	}
+	return true;
+}
+
+bool CameraPath::Parse(std::istream &in, std::string &error)
+{
+	m_Keys.clear();
+	m_SettingChanges.clear();
+
+	std::string line;
+	for (int lineNumber = 1; std::getline(in, line); lineNumber++)
+	{
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream tokens(line);
+		std::string command;
+		if (!(tokens >> command))
+			continue;
+
+		bool valid = false;
+		if (command == "timestep")
+		{
+			valid = (tokens >> m_TimeStep) && m_TimeStep > 0.0f;
+		}
+		else if (command == "warmup")
+		{
+			valid = (tokens >> m_WarmupFrames) && m_WarmupFrames >= 0;
+		}
+		else if (command == "key")
+		{
+			CameraKey key;
+			valid = (bool)(tokens >> key.Time >> key.Position.x >> key.Position.y >> key.Position.z >>
+						   key.Target.x >> key.Target.y >> key.Target.z);
+			if (valid && !m_Keys.empty() && key.Time <= m_Keys.back().Time)
+			{
+				error = "line " + std::to_string(lineNumber) + ": keys must be in increasing time";
+				return false;
+			}
+			m_Keys.push_back(key);
+		}
+		else if (command == "set")
+		{
+			SettingChange change;
+			valid = (bool)(tokens >> change.Time >> change.Name >> change.Value);
+			m_SettingChanges.push_back(change);
+		}
+
+		if (!valid)
+		{
+			error = "line " + std::to_string(lineNumber) + ": cannot read '" + line + "'";
+			return false;
+		}
+	}
+
+	if (m_Keys.empty())
+	{
+		error = "no camera keys";
+		return false;
+	}
+
+	std::stable_sort(m_SettingChanges.begin(), m_SettingChanges.end(),
+					 [](const SettingChange &a, const SettingChange &b)
+					 { return a.Time < b.Time; });
+	return true;
+}
+
+// cubic Hermite segment with the tangents of a Catmull-Rom spline through keys that are not
+// evenly spaced in time
+static XMFLOAT3 Interpolate(const XMFLOAT3 CameraKey::*member, const std::vector<CameraKey> &keys, size_t i, float time)
+{
+	auto tangent = [&](size_t k)
+	{
+		size_t prev = k > 0 ? k - 1 : k;
+		size_t next = std::min(k + 1, keys.size() - 1);
+		const XMFLOAT3 &a = keys[prev].*member;
+		const XMFLOAT3 &b = keys[next].*member;
+		float dt = keys[next].Time - keys[prev].Time;
+		return XMFLOAT3((b.x - a.x) / dt, (b.y - a.y) / dt, (b.z - a.z) / dt);
+	};
+
+	float dt = keys[i + 1].Time - keys[i].Time;
+	float s = (time - keys[i].Time) / dt;
+	float s2 = s * s;
+	float s3 = s2 * s;
+
+	float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+	float h10 = (s3 - 2.0f * s2 + s) * dt;
+	float h01 = -2.0f * s3 + 3.0f * s2;
+	float h11 = (s3 - s2) * dt;
+
+	const XMFLOAT3 &p0 = keys[i].*member;
+	const XMFLOAT3 &p1 = keys[i + 1].*member;
+	XMFLOAT3 m0 = tangent(i);
+	XMFLOAT3 m1 = tangent(i + 1);
+
+	return XMFLOAT3(h00 * p0.x + h10 * m0.x + h01 * p1.x + h11 * m1.x,
+					h00 * p0.y + h10 * m0.y + h01 * p1.y + h11 * m1.y,
+					h00 * p0.z + h10 * m0.z + h01 * p1.z + h11 * m1.z);
+}
+
+void CameraPath::Sample(float time, XMFLOAT3 &position, XMFLOAT3 &target) const
+{
+	if (time <= m_Keys.front().Time || m_Keys.size() == 1)
+	{
+		position = m_Keys.front().Position;
+		target = m_Keys.front().Target;
+		return;
+	}
+
+	if (time >= m_Keys.back().Time)
+	{
+		position = m_Keys.back().Position;
+		target = m_Keys.back().Target;
+		return;
+	}
+
+	// the segment that contains time
+	auto next = std::upper_bound(m_Keys.begin(), m_Keys.end(), time,
+								 [](float t, const CameraKey &key)
+								 { return t < key.Time; });
+	size_t i = (next - m_Keys.begin()) - 1;
+
+	position = Interpolate(&CameraKey::Position, m_Keys, i, time);
+	target = Interpolate(&CameraKey::Target, m_Keys, i, time);
+}
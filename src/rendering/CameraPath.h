@@ -0,0 +1,49 @@
+#pragma once
+
+#include "pch.h"
+
+struct CameraKey
+{
+	float Time; // in seconds
+	XMFLOAT3 Position;
+	XMFLOAT3 Target; // the point the camera looks at
+};
+
+struct SettingChange
+{
+	float Time;
+	std::string Name; // a field of RenderingSettings, e.g. "EnableMotionBlur" or "GI.SecondBounce"
+	float Value;
+};
+
+// A scripted camera flight with settings changes over time, read from a text file:
+//
+//   # comment
+//   timestep 0.0166667                 seconds per frame, 1/60 by default
+//   warmup 120                         frames rendered at the start before recording
+//   key <time> <px py pz> <tx ty tz>   camera position and target, in increasing time
+//   set <time> <setting> <value>       booleans are 0 or 1
+//
+// The position and target are interpolated with a Catmull-Rom spline through the keys.
+class CameraPath
+{
+public:
+	bool Load(const std::string &filename);
+	bool Parse(std::istream &in, std::string &error);
+
+	// clamped to the first and last key
+	void Sample(float time, XMFLOAT3 &position, XMFLOAT3 &target) const;
+
+	float Duration() const { return m_Keys.empty() ? 0.0f : m_Keys.back().Time; }
+	float TimeStep() const { return m_TimeStep; }
+	int WarmupFrames() const { return m_WarmupFrames; }
+
+	const std::vector<CameraKey> &Keys() const { return m_Keys; }
+	const std::vector<SettingChange> &SettingChanges() const { return m_SettingChanges; } // sorted by time
+
+private:
+	std::vector<CameraKey> m_Keys;
+	std::vector<SettingChange> m_SettingChanges;
+	float m_TimeStep = 1.0f / 60.0f;
+	int m_WarmupFrames = 0;
+};
@@ -0,0 +1,457 @@
+#include "pch.h"
+#include "CascadeFitting.h"
+
+void CascadeFitting::Fit(const Camera &camera, FXMVECTOR lightDir, const std::vector<BoundingBox> &bounds,
+						 const CascadeFitSettings &settings, CascadeFit &fit)
+{
+	std::vector<BoundingBox> boundsLS;
+	Fit(camera, lightDir, bounds, settings, fit, boundsLS);
+}
+
+void CascadeFitting::Fit(const Camera &camera, FXMVECTOR lightDir, const std::vector<BoundingBox> &bounds,
+						 const CascadeFitSettings &settings, CascadeFit &fit, std::vector<BoundingBox> &boundsLS)
+{
+	static_assert(NUM_CASCADES == 4, "the cascades are batched into the lanes of a vector");
+
+	FitSplits(camera, bounds, settings, fit.Ends);
+
+	XMMATRIX lightView = LightView(lightDir);
+	fit.LightView = lightView;
+
+	XMFLOAT3 centersWS[NUM_CASCADES];
+	XMFLOAT4 radii;
+	BoundingSpheres(camera, fit.Ends, settings.TransitionRatio, centersWS, &radii.x);
+
+	// the sphere centres in light space, one cascade per lane
+	XMVECTOR worldX = XMVectorSet(centersWS[0].x, centersWS[1].x, centersWS[2].x, centersWS[3].x);
+	XMVECTOR worldY = XMVectorSet(centersWS[0].y, centersWS[1].y, centersWS[2].y, centersWS[3].y);
+	XMVECTOR worldZ = XMVectorSet(centersWS[0].z, centersWS[1].z, centersWS[2].z, centersWS[3].z);
+
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, lightView);
+	XMVECTOR sphereX = worldX * XMVectorReplicate(m._11) + (worldY * XMVectorReplicate(m._21) + (worldZ * XMVectorReplicate(m._31) + XMVectorReplicate(m._41)));
+	XMVECTOR sphereY = worldX * XMVectorReplicate(m._12) + (worldY * XMVectorReplicate(m._22) + (worldZ * XMVectorReplicate(m._32) + XMVectorReplicate(m._42)));
+	XMVECTOR sphereZ = worldX * XMVectorReplicate(m._13) + (worldY * XMVectorReplicate(m._23) + (worldZ * XMVectorReplicate(m._33) + XMVectorReplicate(m._43)));
+	XMVECTOR sphereRadius = XMLoadFloat4(&radii);
+
+	// the receivers of all cascades in one pass over the boxes
+	XMVECTOR receiverMinX = XMVectorReplicate(FLT_MAX);
+	XMVECTOR receiverMinY = XMVectorReplicate(FLT_MAX);
+	XMVECTOR receiverMaxX = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR receiverMaxY = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR receiverFar = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR hasReceivers = XMVectorFalseInt();
+
+	if (settings.FitToScene)
+	{
+		boundsLS.resize(bounds.size());
+		for (size_t i = 0; i < bounds.size(); i++)
+			bounds[i].Transform(boundsLS[i], lightView);
+
+		for (const auto &box : boundsLS)
+		{
+			XMVECTOR centerX = XMVectorReplicate(box.Center.x);
+			XMVECTOR centerY = XMVectorReplicate(box.Center.y);
+			XMVECTOR centerZ = XMVectorReplicate(box.Center.z);
+			XMVECTOR extentX = XMVectorReplicate(box.Extents.x);
+			XMVECTOR extentY = XMVectorReplicate(box.Extents.y);
+			XMVECTOR extentZ = XMVectorReplicate(box.Extents.z);
+
+			XMVECTOR overlap = XMVectorLessOrEqual(XMVectorAbs(centerX - sphereX), extentX + sphereRadius);
+			overlap = XMVectorAndInt(overlap, XMVectorLessOrEqual(XMVectorAbs(centerY - sphereY), extentY + sphereRadius));
+			overlap = XMVectorAndInt(overlap, XMVectorLessOrEqual(XMVectorAbs(centerZ - sphereZ), extentZ + sphereRadius));
+
+			receiverMinX = XMVectorSelect(receiverMinX, XMVectorMin(receiverMinX, XMVectorMax(centerX - extentX, sphereX - sphereRadius)), overlap);
+			receiverMinY = XMVectorSelect(receiverMinY, XMVectorMin(receiverMinY, XMVectorMax(centerY - extentY, sphereY - sphereRadius)), overlap);
+			receiverMaxX = XMVectorSelect(receiverMaxX, XMVectorMax(receiverMaxX, XMVectorMin(centerX + extentX, sphereX + sphereRadius)), overlap);
+			receiverMaxY = XMVectorSelect(receiverMaxY, XMVectorMax(receiverMaxY, XMVectorMin(centerY + extentY, sphereY + sphereRadius)), overlap);
+			receiverFar = XMVectorSelect(receiverFar, XMVectorMax(receiverFar, XMVectorMin(centerZ + extentZ, sphereZ + sphereRadius)), overlap);
+			hasReceivers = XMVectorOrInt(hasReceivers, overlap);
+		}
+	}
+
+	XMFLOAT4 sphere[3], receiverMin[2], receiverMax[2], farthest;
+	XMStoreFloat4(&sphere[0], sphereX);
+	XMStoreFloat4(&sphere[1], sphereY);
+	XMStoreFloat4(&sphere[2], sphereZ);
+	XMStoreFloat4(&receiverMin[0], receiverMinX);
+	XMStoreFloat4(&receiverMin[1], receiverMinY);
+	XMStoreFloat4(&receiverMax[0], receiverMaxX);
+	XMStoreFloat4(&receiverMax[1], receiverMaxY);
+	XMStoreFloat4(&farthest, receiverFar);
+
+	uint32_t receivers[4];
+	XMStoreInt4(receivers, hasReceivers);
+
+	// the squares, snapped to texels
+	XMFLOAT4 squareX, squareY, squareExtent;
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		float radius = (&radii.x)[i];
+		float halfExtent = radius;
+		float centerX = (&sphere[0].x)[i];
+		float centerY = (&sphere[1].x)[i];
+
+		if (receivers[i])
+		{
+			// the texel snapping below moves the centre by up to a texel, 2 * halfExtent / SHADOW_MAP_SIZE
+			float minX = (&receiverMin[0].x)[i], minY = (&receiverMin[1].x)[i];
+			float maxX = (&receiverMax[0].x)[i], maxY = (&receiverMax[1].x)[i];
+			float receiverExtent = 0.5f * std::max(maxX - minX, maxY - minY);
+			receiverExtent = QuantizeExtent(receiverExtent / (1.0f - 2.0f / SHADOW_MAP_SIZE));
+
+			if (receiverExtent < radius)
+			{
+				halfExtent = receiverExtent;
+				centerX = 0.5f * (minX + maxX);
+				centerY = 0.5f * (minY + maxY);
+			}
+		}
+
+		// for removing edge shimmer effect
+		float worldUnitsPerTexel = halfExtent * 2.0f / SHADOW_MAP_SIZE;
+		(&squareX.x)[i] = floorf(centerX / worldUnitsPerTexel) * worldUnitsPerTexel;
+		(&squareY.x)[i] = floorf(centerY / worldUnitsPerTexel) * worldUnitsPerTexel;
+		(&squareExtent.x)[i] = halfExtent;
+	}
+
+	// every caster in front of the receivers within the squares, however close to the light
+	XMVECTOR lightNear = receiverFar;
+	if (XMVector4NotEqualInt(hasReceivers, XMVectorFalseInt()))
+	{
+		XMVECTOR squareCenterX = XMLoadFloat4(&squareX);
+		XMVECTOR squareCenterY = XMLoadFloat4(&squareY);
+		XMVECTOR halfExtent = XMLoadFloat4(&squareExtent);
+
+		for (const auto &box : boundsLS)
+		{
+			XMVECTOR boxNear = XMVectorReplicate(box.Center.z - box.Extents.z);
+
+			XMVECTOR inside = XMVectorLessOrEqual(XMVectorAbs(XMVectorReplicate(box.Center.x) - squareCenterX), XMVectorReplicate(box.Extents.x) + halfExtent);
+			inside = XMVectorAndInt(inside, XMVectorLessOrEqual(XMVectorAbs(XMVectorReplicate(box.Center.y) - squareCenterY), XMVectorReplicate(box.Extents.y) + halfExtent));
+			inside = XMVectorAndInt(inside, XMVectorLess(boxNear, receiverFar));
+
+			lightNear = XMVectorSelect(lightNear, XMVectorMin(lightNear, boxNear), inside);
+		}
+	}
+
+	XMFLOAT4 nearest;
+	XMStoreFloat4(&nearest, lightNear);
+
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		float radius = (&radii.x)[i];
+		float centerZ = (&sphere[2].x)[i];
+
+		float nearZ, farZ;
+		if (receivers[i])
+		{
+			nearZ = (&nearest.x)[i];
+			farZ = (&farthest.x)[i];
+
+			float margin = std::max(0.005f * (farZ - nearZ), 0.01f);
+			nearZ -= margin;
+			farZ += margin;
+		}
+		else if (settings.FitToScene)
+		{
+			// nothing to shadow, the cascade only has to stay valid
+			nearZ = centerZ - radius;
+			farZ = centerZ + radius;
+		}
+		else
+		{
+			float sceneRadius = 50.0f;
+			float backDistance = sceneRadius + XMVectorGetX(XMVector3Length(XMLoadFloat3(&centersWS[i])));
+			nearZ = centerZ - backDistance;
+			farZ = centerZ + backDistance;
+		}
+
+		float centerX = (&squareX.x)[i];
+		float centerY = (&squareY.x)[i];
+		float halfExtent = (&squareExtent.x)[i];
+
+		XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(centerX - halfExtent, centerX + halfExtent,
+															 centerY - halfExtent, centerY + halfExtent, nearZ, farZ);
+		fit.ViewProj[i] = lightView * lightProj;
+		fit.Radius[i] = halfExtent;
+		fit.Center[i] = XMFLOAT2(centerX, centerY);
+		fit.LightNear[i] = nearZ;
+		fit.LightFar[i] = farZ;
+	}
+}
+
+void CascadeFitting::BoundingSpheres(const Camera &camera, const float *ends, float transitionRatio, XMFLOAT3 *centers, float *radii)
+{
+	// squared diagonal of a cross section of the view frustum per squared depth
+	float tanY = tanf(0.5f * camera.GetFovY());
+	float tanX = tanY * camera.GetAspect();
+	XMVECTOR diagonalScale = XMVectorReplicate(4.0f * (tanX * tanX + tanY * tanY));
+
+	// one cascade per lane, all but the first reach back over the transition from the previous one
+	XMVECTOR cascadeStart = XMVectorSet(ends[0], ends[1], ends[2], ends[3]);
+	XMVECTOR previousStart = XMVectorSet(ends[0], ends[0], ends[1], ends[2]);
+	XMVECTOR cascadeNear = cascadeStart - (cascadeStart - previousStart) * XMVectorReplicate(transitionRatio);
+	XMVECTOR cascadeFar = XMVectorSet(ends[1], ends[2], ends[3], ends[4]);
+
+	// Calculate the bounding sphere
+	// ref: https://zhuanlan.zhihu.com/p/515385379
+	XMVECTOR a2 = cascadeNear * cascadeNear * diagonalScale;
+	XMVECTOR b2 = cascadeFar * cascadeFar * diagonalScale;
+	XMVECTOR len = cascadeFar - cascadeNear;
+	XMVECTOR x = XMVectorMin(len * XMVectorReplicate(0.5f) - (a2 - b2) / (XMVectorReplicate(8.0f) * len), len);
+	XMVECTOR quarter = XMVectorReplicate(0.25f);
+	XMVECTOR radius = XMVectorSqrt(XMVectorMax(x * x + a2 * quarter, (len - x) * (len - x) + b2 * quarter));
+
+	XMFLOAT4 distance;
+	XMStoreFloat4(&distance, cascadeNear + x);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4 *>(radii), radius);
+
+	for (int i = 0; i < NUM_CASCADES; i++)
+		XMStoreFloat3(&centers[i], camera.GetPosition() + camera.GetLook() * (&distance.x)[i]);
+}
+
+void CascadeFitting::FitReference(const Camera &camera, FXMVECTOR lightDir, const std::vector<BoundingBox> &bounds,
+								  const CascadeFitSettings &settings, CascadeFit &fit)
+{
+	FitSplits(camera, bounds, settings, fit.Ends);
+
+	// squared diagonal of a cross section of the view frustum per squared depth
+	float tanY = tanf(0.5f * camera.GetFovY());
+	float tanX = tanY * camera.GetAspect();
+	float diagonalScale = 4.0f * (tanX * tanX + tanY * tanY);
+
+	XMMATRIX lightView = LightView(lightDir);
+	fit.LightView = lightView;
+
+	std::vector<BoundingBox> boundsLS;
+	if (settings.FitToScene)
+	{
+		boundsLS.resize(bounds.size());
+		for (size_t i = 0; i < bounds.size(); i++)
+			bounds[i].Transform(boundsLS[i], lightView);
+	}
+
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		float cascadeNear = fit.Ends[i];
+		float cascadeFar = fit.Ends[i + 1];
+
+		if (i > 0)
+			cascadeNear -= (fit.Ends[i] - fit.Ends[i - 1]) * settings.TransitionRatio;
+
+		// Calculate the bounding sphere
+		// ref: https://zhuanlan.zhihu.com/p/515385379
+		float a2 = cascadeNear * cascadeNear * diagonalScale;
+		float b2 = cascadeFar * cascadeFar * diagonalScale;
+		float len = cascadeFar - cascadeNear;
+		float x = std::min(len * 0.5f - (a2 - b2) / (8.0f * len), len);
+		float sphereRadius = sqrtf(std::max(x * x + a2 * 0.25f, (len - x) * (len - x) + b2 * 0.25f));
+
+		XMVECTOR sphereCenterWS = camera.GetPosition() + camera.GetLook() * (cascadeNear + x);
+		XMFLOAT3 sphereCenter;
+		XMStoreFloat3(&sphereCenter, XMVector3TransformCoord(sphereCenterWS, lightView));
+
+		// light space square and depth range the cascade covers
+		float halfExtent = sphereRadius;
+		float centerX = sphereCenter.x;
+		float centerY = sphereCenter.y;
+		float receiverFar = sphereCenter.z + sphereRadius;
+		bool hasReceivers = false;
+
+		if (settings.FitToScene)
+		{
+			// the receivers are the parts of the boxes inside the cube around the sphere
+			XMFLOAT2 receiverMin(FLT_MAX, FLT_MAX);
+			XMFLOAT2 receiverMax(-FLT_MAX, -FLT_MAX);
+			receiverFar = -FLT_MAX;
+
+			for (const auto &box : boundsLS)
+			{
+				if (fabsf(box.Center.x - sphereCenter.x) > box.Extents.x + sphereRadius ||
+					fabsf(box.Center.y - sphereCenter.y) > box.Extents.y + sphereRadius ||
+					fabsf(box.Center.z - sphereCenter.z) > box.Extents.z + sphereRadius)
+					continue;
+
+				receiverMin.x = std::min(receiverMin.x, std::max(box.Center.x - box.Extents.x, sphereCenter.x - sphereRadius));
+				receiverMin.y = std::min(receiverMin.y, std::max(box.Center.y - box.Extents.y, sphereCenter.y - sphereRadius));
+				receiverMax.x = std::max(receiverMax.x, std::min(box.Center.x + box.Extents.x, sphereCenter.x + sphereRadius));
+				receiverMax.y = std::max(receiverMax.y, std::min(box.Center.y + box.Extents.y, sphereCenter.y + sphereRadius));
+				receiverFar = std::max(receiverFar, std::min(box.Center.z + box.Extents.z, sphereCenter.z + sphereRadius));
+				hasReceivers = true;
+			}
+
+			if (hasReceivers)
+			{
+				// the texel snapping below moves the centre by up to a texel, 2 * halfExtent / SHADOW_MAP_SIZE
+				float receiverExtent = 0.5f * std::max(receiverMax.x - receiverMin.x, receiverMax.y - receiverMin.y);
+				receiverExtent = QuantizeExtent(receiverExtent / (1.0f - 2.0f / SHADOW_MAP_SIZE));
+
+				if (receiverExtent < sphereRadius)
+				{
+					halfExtent = receiverExtent;
+					centerX = 0.5f * (receiverMin.x + receiverMax.x);
+					centerY = 0.5f * (receiverMin.y + receiverMax.y);
+				}
+			}
+		}
+
+		// for removing edge shimmer effect
+		float worldUnitsPerTexel = halfExtent * 2.0f / SHADOW_MAP_SIZE;
+		centerX = floorf(centerX / worldUnitsPerTexel) * worldUnitsPerTexel;
+		centerY = floorf(centerY / worldUnitsPerTexel) * worldUnitsPerTexel;
+
+		float lightNear, lightFar;
+		if (hasReceivers)
+		{
+			// every caster in front of the receivers within the square, however close to the light
+			lightNear = receiverFar;
+			lightFar = receiverFar;
+
+			for (const auto &box : boundsLS)
+			{
+				if (fabsf(box.Center.x - centerX) > box.Extents.x + halfExtent ||
+					fabsf(box.Center.y - centerY) > box.Extents.y + halfExtent ||
+					box.Center.z - box.Extents.z >= receiverFar)
+					continue;
+
+				lightNear = std::min(lightNear, box.Center.z - box.Extents.z);
+			}
+
+			float margin = std::max(0.005f * (lightFar - lightNear), 0.01f);
+			lightNear -= margin;
+			lightFar += margin;
+		}
+		else if (settings.FitToScene)
+		{
+			// nothing to shadow, the cascade only has to stay valid
+			lightNear = sphereCenter.z - sphereRadius;
+			lightFar = sphereCenter.z + sphereRadius;
+		}
+		else
+		{
+			float sceneRadius = 50.0f;
+			float backDistance = sceneRadius + XMVectorGetX(XMVector3Length(sphereCenterWS));
+			lightNear = sphereCenter.z - backDistance;
+			lightFar = sphereCenter.z + backDistance;
+		}
+
+		XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(centerX - halfExtent, centerX + halfExtent,
+															 centerY - halfExtent, centerY + halfExtent, lightNear, lightFar);
+		fit.ViewProj[i] = lightView * lightProj;
+		fit.Radius[i] = halfExtent;
+		fit.Center[i] = XMFLOAT2(centerX, centerY);
+		fit.LightNear[i] = lightNear;
+		fit.LightFar[i] = lightFar;
+	}
+}
+
+void CascadeFitting::FitSplits(const Camera &camera, const std::vector<BoundingBox> &bounds, const CascadeFitSettings &settings,
+							   float *ends)
+{
+	float nearZ = camera.GetNearZ();
+	float minDepth = nearZ;
+	float maxDepth = settings.MaxShadowDistance;
+
+	if (settings.FitToScene)
+	{
+		float sceneMinDepth, sceneMaxDepth;
+		if (ViewDepthRange(camera, bounds, settings.MaxShadowDistance, sceneMinDepth, sceneMaxDepth))
+		{
+			minDepth = sceneMinDepth;
+			maxDepth = sceneMaxDepth;
+		}
+
+		// the pixels are a few frames old, leave some room for the camera having moved since
+		if (settings.MaxDepth > settings.MinDepth)
+		{
+			if (settings.MinDepth > 0.0f)
+				minDepth = std::max(minDepth, QuantizeDepthDown(settings.MinDepth * 0.9f));
+			maxDepth = std::min(maxDepth, QuantizeExtent(settings.MaxDepth * 1.1f));
+		}
+
+		maxDepth = std::max(maxDepth, minDepth + 0.01f * settings.MaxShadowDistance);
+	}
+
+	// the first cascade still covers whatever is in front of the fitted range
+	Splits(minDepth, maxDepth, settings.RangeScale, ends);
+	ends[0] = nearZ;
+}
+
+XMMATRIX CascadeFitting::LightView(FXMVECTOR lightDir)
+{
+	XMVECTOR direction = XMVector3Normalize(lightDir);
+	XMVECTOR lightUp = fabsf(XMVectorGetY(direction)) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	return XMMatrixLookToLH(XMVectorZero(), direction, lightUp);
+}
+
+bool CascadeFitting::ViewDepthRange(const Camera &camera, const std::vector<BoundingBox> &bounds, float maxDistance,
+									float &minDepth, float &maxDepth)
+{
+	XMMATRIX view = camera.GetView();
+	float nearZ = camera.GetNearZ();
+	float tanY = tanf(0.5f * camera.GetFovY());
+	float tanX = tanY * camera.GetAspect();
+
+	minDepth = FLT_MAX;
+	maxDepth = -FLT_MAX;
+
+	for (const auto &box : bounds)
+	{
+		BoundingBox boxVS;
+		box.Transform(boxVS, view);
+
+		const XMFLOAT3 &c = boxVS.Center;
+		const XMFLOAT3 &e = boxVS.Extents;
+		float zMin = c.z - e.z;
+		float zMax = c.z + e.z;
+
+		if (zMax < nearZ || zMin > maxDistance)
+			continue;
+
+		// entirely outside one of the side planes, |x| <= z * tanX and |y| <= z * tanY
+		if (c.x - e.x > zMax * tanX || c.x + e.x < -zMax * tanX ||
+			c.y - e.y > zMax * tanY || c.y + e.y < -zMax * tanY)
+			continue;
+
+		minDepth = std::min(minDepth, std::max(zMin, nearZ));
+		maxDepth = std::max(maxDepth, std::min(zMax, maxDistance));
+	}
+
+	return minDepth <= maxDepth;
+}
+
+void CascadeFitting::Splits(float nearZ, float farZ, float rangeScale, float *ends)
+{
+	float expScale[NUM_CASCADES] = {1.0f};
+	float expNormalizeFactor = 1.0f;
+	for (int i = 1; i < NUM_CASCADES; i++)
+	{
+		expScale[i] = expScale[i - 1] * rangeScale;
+		expNormalizeFactor += expScale[i];
+	}
+	expNormalizeFactor = 1.0f / expNormalizeFactor;
+
+	ends[0] = nearZ;
+
+	float percentage = 0.0f;
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		percentage += expScale[i] * expNormalizeFactor;
+		ends[i + 1] = nearZ + percentage * (farZ - nearZ);
+	}
+
+	ends[NUM_CASCADES] = farZ;
+}
+
+float CascadeFitting::QuantizeExtent(float extent)
+{
+	float step = exp2f(ceilf(log2f(extent))) / 16.0f;
+	return ceilf(extent / step) * step;
+}
+
+float CascadeFitting::QuantizeDepthDown(float depth)
+{
+	float step = exp2f(floorf(log2f(depth))) / 16.0f;
+	return floorf(depth / step) * step;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "pch.h"
+#include "Camera.h"
+
+#define NUM_CASCADES 4
+#define SHADOW_MAP_SIZE 4096
+
+struct CascadeFitSettings
+{
+	float MaxShadowDistance = 100.0f;
+	float RangeScale = 1.5f; // depth range of a cascade relative to the previous one
+	float TransitionRatio = 0.2f; // part of a cascade blended into the next one, which reaches back to cover it
+
+	// clamp the splits to the scene and fit the light space volumes to the casters
+	bool FitToScene = true;
+
+	// view depth range of the pixels visible in a previous frame, ignored if MaxDepth <= MinDepth
+	float MinDepth = 0.0f;
+	float MaxDepth = 0.0f;
+};
+
+struct CascadeFit
+{
+	XMMATRIX LightView;
+	XMMATRIX ViewProj[NUM_CASCADES];
+	float Radius[NUM_CASCADES]; // half extent of the square a cascade covers
+	XMFLOAT2 Center[NUM_CASCADES]; // light space centre of the square
+	float Ends[NUM_CASCADES + 1]; // view depth, Ends[0] is the camera near plane
+	float LightNear[NUM_CASCADES]; // light space depth range of the projections
+	float LightFar[NUM_CASCADES];
+};
+
+// Fits the cascades of the sun's shadow map to the view. Without fitting the splits divide
+// [near, MaxShadowDistance] exponentially and each cascade covers the bounding sphere of its
+// slice of the view frustum, with a fixed depth range around it.
+//
+// With fitting the splits divide the depth range the bounds (and the visible pixels, if known)
+// cover in the view frustum instead, the visible depth range rounded to 1/16 of an octave so that
+// the splits do not follow the jittered depth buffer from frame to frame. A cascade then only covers the receivers inside its sphere,
+// in depth from the closest caster in front of them to the farthest of them. The extents are
+// rounded up to 1/16 of an octave and the centres snapped to texels, so while the camera moves
+// the projections only change in steps and the shadows do not shimmer.
+class CascadeFitting
+{
+public:
+	// bounds are the world space boxes of the casters, which receive shadows as well. All cascades
+	// are fitted at once, one per lane of a vector; boundsLS keeps the light space boxes between
+	// calls so that fitting every frame does not allocate.
+	static void Fit(const Camera &camera, FXMVECTOR lightDir, const std::vector<BoundingBox> &bounds,
+					const CascadeFitSettings &settings, CascadeFit &fit, std::vector<BoundingBox> &boundsLS);
+	static void Fit(const Camera &camera, FXMVECTOR lightDir, const std::vector<BoundingBox> &bounds,
+					const CascadeFitSettings &settings, CascadeFit &fit);
+
+	// the same fit one cascade after the other, kept as the reference for Fit
+	static void FitReference(const Camera &camera, FXMVECTOR lightDir, const std::vector<BoundingBox> &bounds,
+							 const CascadeFitSettings &settings, CascadeFit &fit);
+
+	// world space bounding spheres of the cascades' slices of the view frustum, the slices given
+	// by ends and reaching back over the transition from the previous cascade
+	static void BoundingSpheres(const Camera &camera, const float *ends, float transitionRatio, XMFLOAT3 *centers, float *radii);
+
+	// view depth range the bounds cover inside the view frustum up to maxDistance, false if none does
+	static bool ViewDepthRange(const Camera &camera, const std::vector<BoundingBox> &bounds, float maxDistance,
+							   float &minDepth, float &maxDepth);
+
+	// exponential splits of [nearZ, farZ] into ends[0] = nearZ ... ends[NUM_CASCADES] = farZ
+	static void Splits(float nearZ, float farZ, float rangeScale, float *ends);
+
+	// rounds a positive extent up to the next 1/16 of an octave
+	static float QuantizeExtent(float extent);
+
+	// rounds a positive depth down to the previous 1/16 of an octave
+	static float QuantizeDepthDown(float depth);
+
+private:
+	static void FitSplits(const Camera &camera, const std::vector<BoundingBox> &bounds, const CascadeFitSettings &settings, float *ends);
+	static XMMATRIX LightView(FXMVECTOR lightDir);
+};
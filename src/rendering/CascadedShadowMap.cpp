@@ -7,6 +7,8 @@ extern RenderingSettings g_RenderingSettings;
 CascadedShadowMap::CascadedShadowMap(Ref<DxContext> dxContext)
 	: m_Device(dxContext->GetDevice())
 {
+	GpuMemoryScope memoryScope(GpuMemoryCategory::Shadow);
+
 	D3D12_RESOURCE_DESC texDesc = {};
 	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 	texDesc.Alignment = 0;
@@ -24,7 +26,7 @@ CascadedShadowMap::CascadedShadowMap(Ref<DxContext> dxContext)
 	optClear.DepthStencil.Depth = 1.0f;
 	optClear.DepthStencil.Stencil = 0;
 
-	ThrowIfFailed(m_Device->CreateCommittedResource(
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
 		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 		D3D12_HEAP_FLAG_NONE,
 		&texDesc,
@@ -32,6 +34,15 @@ CascadedShadowMap::CascadedShadowMap(Ref<DxContext> dxContext)
 		&optClear,
 		IID_PPV_ARGS(&m_Resource)));
 
+	// only ever copied from, apart from redrawing its cascades
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COPY_SOURCE,
+		&optClear,
+		IID_PPV_ARGS(&m_StaticResource)));
+
 	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
 	dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
 	dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
@@ -54,6 +65,9 @@ CascadedShadowMap::CascadedShadowMap(Ref<DxContext> dxContext)
 		dsvDesc.Texture2DArray.FirstArraySlice = i;
 		m_Device->CreateDepthStencilView(m_Resource.Get(), &dsvDesc, m_Dsvs[i].CPUHandle);
 
+		m_StaticDsvs[i] = dxContext->GetDsvHeap().Alloc();
+		m_Device->CreateDepthStencilView(m_StaticResource.Get(), &dsvDesc, m_StaticDsvs[i].CPUHandle);
+
 		m_Srvs[i] = dxContext->GetCbvSrvUavHeap().Alloc();
 		srvDesc.Texture2DArray.FirstArraySlice = i;
 		m_Device->CreateShaderResourceView(m_Resource.Get(), &srvDesc, m_Srvs[i].CPUHandle);
@@ -65,100 +79,44 @@ CascadedShadowMap::CascadedShadowMap(Ref<DxContext> dxContext)
 	m_Device->CreateShaderResourceView(m_Resource.Get(), &srvDesc, m_Srvs[4].CPUHandle);
 }
 
-void CascadedShadowMap::CalcOrthoProjs(const Camera &camera, const Light &mainLight)
+void CascadedShadowMap::CalcOrthoProjs(const Camera &camera, const Light &mainLight, const std::vector<BoundingBox> &casterBounds,
+									   float minDepth, float maxDepth)
 {
-	// Calculate each cascade's range
-	m_CascadeEnds[0] = camera.GetNearZ();
+	PROFILE_FUNCTION();
 
-	float expScale[NUM_CASCADES] = {1.0f};
-	float expNormalizeFactor = 1.0f;
-	for (int i = 1; i < NUM_CASCADES; i++)
-	{
-		expScale[i] = expScale[i - 1] * g_RenderingSettings.CascadeRangeScale;
-		expNormalizeFactor += expScale[i];
-	}
-	expNormalizeFactor = 1.0f / expNormalizeFactor;
+	CascadeFitSettings settings;
+	settings.MaxShadowDistance = g_RenderingSettings.MaxShadowDistance;
+	settings.RangeScale = g_RenderingSettings.CascadeRangeScale;
+	settings.TransitionRatio = g_RenderingSettings.CascadeTransitionRatio;
+	settings.FitToScene = g_RenderingSettings.FitCascadesToScene;
 
-	float percentage = 0.0f;
-	for (int i = 0; i < NUM_CASCADES; i++)
+	if (g_RenderingSettings.FitCascadesToDepth)
 	{
-		float percentageOffset = expScale[i] * expNormalizeFactor;
-		percentage += percentageOffset;
-		m_CascadeEnds[i + 1] = percentage * g_RenderingSettings.MaxShadowDistance;
+		settings.MinDepth = minDepth;
+		settings.MaxDepth = maxDepth;
 	}
 
-	XMMATRIX view = camera.GetView();
-
 	// Only the first "main" light casts a shadow.
-	XMVECTOR lightDir = XMLoadFloat4(&mainLight.DirectionWS);
-	XMVECTOR lightUp = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	CascadeFit fit;
+	CascadeFitting::Fit(camera, XMLoadFloat4(&mainLight.DirectionWS), casterBounds, settings, fit, m_CasterBoundsLS);
+
+	// without caching every cascade is redrawn, and the stale layer is redrawn once enabled again
+	if (!g_RenderingSettings.CacheStaticShadows)
+		m_Cache.Invalidate();
+
+	ShadowCacheSettings cacheSettings;
+	cacheSettings.DistantInterval = g_RenderingSettings.DistantCascadeInterval;
+	m_Cache.Update(fit, XMLoadFloat4(&mainLight.DirectionWS), cacheSettings);
 
 	for (int i = 0; i < NUM_CASCADES; i++)
 	{
-		float nearZ = m_CascadeEnds[i];
-		float farZ = m_CascadeEnds[i + 1];
-
-		if (i > 0)
-		{
-			float cascadeLength = m_CascadeEnds[i] - m_CascadeEnds[i - 1];
-			nearZ -= cascadeLength * g_RenderingSettings.CascadeTransitionRatio;
-		}
-
-		// Get frustum corner coordinates in world space
-		XMMATRIX proj = XMMatrixPerspectiveFovLH(camera.GetFovY(), camera.GetAspect(), nearZ, farZ);
-		XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-		XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
-
-		std::vector<XMVECTOR> frustumCornersWS;
-
-		for (int x = 0; x < 2; x++)
-		{
-			for (int y = 0; y < 2; y++)
-			{
-				for (int z = 0; z < 2; z++)
-				{
-					XMVECTOR NDCCoords = XMVectorSet(2.0f * x - 1.0f, 2.0f * y - 1.0f, z, 1.0f);
-					auto world = XMVector4Transform(NDCCoords, invViewProj);
-					float w = XMVectorGetW(world);
-					frustumCornersWS.push_back(world / w);
-				}
-			}
-		}
-
-		// Calculate the bounding sphere
-		// ref: https://zhuanlan.zhihu.com/p/515385379
-		auto nearPlaneDiagonal = frustumCornersWS[6] - frustumCornersWS[0];
-		float a2 = XMVectorGetX(XMVector3LengthSq(nearPlaneDiagonal));
-
-		auto farPlaneDiagonal = frustumCornersWS[7] - frustumCornersWS[1];
-		float b2 = XMVectorGetX(XMVector3LengthSq(farPlaneDiagonal));
-
-		float len = farZ - nearZ;
-		float x = len * 0.5f - (a2 - b2) / (8.0f * len);
-
-		auto sphereCenterWS = camera.GetPosition() + camera.GetLook() * (nearZ + x);
-		float sphereRadius = sqrtf(x * x + a2 * 0.25);
-		// LOG_INFO("Cascade radius [{}]: {}", i, sphereRadius);
-
-		// for removing edge shimmer effect
-		XMMATRIX shadowView = XMMatrixLookAtLH(XMVectorSet(0, 0, 0, 1), -lightDir, lightUp);
-		XMMATRIX invShadowView = XMMatrixInverse(&XMMatrixDeterminant(shadowView), shadowView);
-
-		float worldUnitsPerTexel = sphereRadius * 2.0 / SHADOW_MAP_SIZE;
-		auto vWorldUnitsPerTexel = XMVectorSet(worldUnitsPerTexel, worldUnitsPerTexel, 1, 1);
-
-		auto sphereCenterLS = XMVector3Transform(sphereCenterWS, shadowView);
-		sphereCenterLS /= vWorldUnitsPerTexel;
-		sphereCenterLS = XMVectorFloor(sphereCenterLS);
-		sphereCenterLS *= vWorldUnitsPerTexel;
-		sphereCenterWS = XMVector3Transform(sphereCenterLS, invShadowView);
-
-		float sceneRadius = 50.0f; // TODO: use an actual bounding sphere?
-		float backDistance = sceneRadius + XMVectorGetX(XMVector3Length(sphereCenterWS));
-
-		XMMATRIX lightView = XMMatrixLookAtLH(sphereCenterWS - lightDir * backDistance, sphereCenterWS, lightUp);
-		XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(-sphereRadius, sphereRadius, -sphereRadius, sphereRadius, 0, backDistance * 2);
-		m_ViewProjMatrix[i] = lightView * lightProj;
-		m_CascadeRadius[i] = sphereRadius;
+		m_ViewProjMatrix[i] = fit.ViewProj[i];
+		m_CascadeRadius[i] = fit.Radius[i];
+		m_CascadeDepthRange[i] = fit.LightFar[i] - fit.LightNear[i];
 	}
+
+	for (int i = 0; i <= NUM_CASCADES; i++)
+		m_CascadeEnds[i] = fit.Ends[i];
+
+	m_Fit = fit;
 }
\ No newline at end of file
@@ -4,25 +4,39 @@
 #include "dx/DxContext.h"
 #include "Camera.h"
 #include "Light.h"
+#include "CascadeFitting.h"
+#include "ShadowCascadeCache.h"
 
-#define NUM_CASCADES 4
 #define NUM_FRUSTUM_CORNERS 8
-#define SHADOW_MAP_SIZE 4096
 
 class CascadedShadowMap
 {
 public:
 	CascadedShadowMap(Ref<DxContext> dxContext);
 
-	void CalcOrthoProjs(const Camera &camera, const Light &mainLight);
+	// casterBounds are the world space boxes the cascades are fitted to, minDepth and maxDepth the
+	// view depth range of the visible pixels if known, see CascadeFitting
+	void CalcOrthoProjs(const Camera &camera, const Light &mainLight, const std::vector<BoundingBox> &casterBounds,
+						float minDepth = 0.0f, float maxDepth = 0.0f);
 
 	XMMATRIX ViewProjMatrix(int index) const { return m_ViewProjMatrix[index]; }
 	float CascadeRadius(int index) const { return m_CascadeRadius[index]; }
 	float CascadeEnds(int index) const { return m_CascadeEnds[index]; }
+	float CascadeDepthRange(int index) const { return m_CascadeDepthRange[index]; }
+	const CascadeFit &Fit() const { return m_Fit; }
+
+	// whether the static casters of a cascade have to be redrawn into the static layer this frame
+	bool NeedsStaticRedraw(int index) const { return m_Cache.NeedsRedraw(index); }
+	int StaticRedrawCount() const { return m_Cache.RedrawCount(); }
+	void InvalidateStaticCasters() { m_Cache.Invalidate(); }
 
 	ID3D12Resource *GetResource() { return m_Resource.Get(); }
 	Descriptor &Dsv(int index) { return m_Dsvs[index]; }
 	Descriptor &Srv(int index) { return m_Srvs[index]; }
+
+	// the static casters only, copied into the shadow map before the dynamic ones are drawn
+	ID3D12Resource *GetStaticResource() { return m_StaticResource.Get(); }
+	Descriptor &StaticDsv(int index) { return m_StaticDsvs[index]; }
 	D3D12_VIEWPORT &Viewport() { return m_Viewport; }
 	D3D12_RECT &ScissorRect() { return m_ScissorRect; }
 
@@ -38,7 +52,14 @@ private:
 	Descriptor m_Dsvs[4];
 	Descriptor m_Srvs[5]; // 0-3 for each cascade depth, 4 for the whole resource
 
+	Resource m_StaticResource;
+	Descriptor m_StaticDsvs[4];
+	ShadowCascadeCache m_Cache;
+
 	XMMATRIX m_ViewProjMatrix[NUM_CASCADES];
 	float m_CascadeRadius[NUM_CASCADES];
 	float m_CascadeEnds[NUM_CASCADES + 1];
+	float m_CascadeDepthRange[NUM_CASCADES];
+	CascadeFit m_Fit;
+	std::vector<BoundingBox> m_CasterBoundsLS; // kept between frames, see CascadeFitting::Fit
 };
\ No newline at end of file
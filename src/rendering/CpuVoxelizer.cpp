@@ -0,0 +1,597 @@
+#include "pch.h"
+#include "CpuVoxelizer.h"
+
+#include "Mesh.h"
+#include "asset/Image.h"
+#include "core/Parallel.h"
+
+#include <filesystem>
+
+static_assert(VOXEL_COMPACT_PACKING, "The CPU voxelizer writes compact voxel records.");
+
+static const UINT NUM_BRICKS = VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION;
+
+static const char *CACHE_DIRECTORY = "resources/cache/voxels";
+
+// bump when the voxelizer or the file layout changes, old bakes are simply never hit again
+static const UINT BAKE_VERSION = 1;
+static const UINT BAKE_MAGIC = 0x58564159; // "YAVX"
+
+static const UINT64 FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+static const UINT64 FNV_PRIME = 0x100000001b3ull;
+
+static const UINT64 RADIANCE_MASK = 0xFFFFFFFFull;
+
+struct BakeHeader
+{
+    UINT Magic;
+    UINT Version;
+    UINT Dimension;
+    UINT BrickSize;
+    float GridSize;
+    UINT NumBricks;
+};
+
+static UINT64 HashBytes(UINT64 hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+template <typename T>
+static UINT64 HashValue(UINT64 hash, const T &value)
+{
+    return HashBytes(hash, &value, sizeof(T));
+}
+
+static UINT BrickIndex(UINT x, UINT y, UINT z)
+{
+    return (x * VOXEL_BRICK_DIMENSION + y) * VOXEL_BRICK_DIMENSION + z;
+}
+
+// index of a voxel inside its brick, same as Flatten in voxelUtils.hlsl
+static UINT LocalVoxelIndex(UINT x, UINT y, UINT z)
+{
+    return ((x % VOXEL_BRICK_SIZE) * VOXEL_BRICK_SIZE + y % VOXEL_BRICK_SIZE) * VOXEL_BRICK_SIZE + z % VOXEL_BRICK_SIZE;
+}
+
+// Triangle vs voxel separating axis test with everything that only depends on the triangle
+// hoisted out. The 9 edge cross products and the triangle normal are projected once, padded
+// to 12 axes and stored as 3 groups of 4, so a voxel is tested with 9 multiply adds and 6
+// compares. The box face axes are covered by only visiting voxels inside the triangle bounds.
+struct TriangleVoxelTest
+{
+    XMVECTOR AxisX[3];
+    XMVECTOR AxisY[3];
+    XMVECTOR AxisZ[3];
+
+    // range of the axis projection of a voxel centre overlapping the triangle
+    XMVECTOR Lower[3];
+    XMVECTOR Upper[3];
+
+    TriangleVoxelTest(const XMFLOAT3 v[3])
+    {
+        XMFLOAT3 axes[12] = {};
+        for (int k = 0; k < 3; k++)
+        {
+            const XMFLOAT3 &a = v[k];
+            const XMFLOAT3 &b = v[(k + 1) % 3];
+            XMFLOAT3 e(b.x - a.x, b.y - a.y, b.z - a.z);
+
+            axes[3 * k + 0] = XMFLOAT3(0.0f, -e.z, e.y);
+            axes[3 * k + 1] = XMFLOAT3(e.z, 0.0f, -e.x);
+            axes[3 * k + 2] = XMFLOAT3(-e.y, e.x, 0.0f);
+        }
+        XMStoreFloat3(&axes[9], XMVector3Cross(XMLoadFloat3(&v[1]) - XMLoadFloat3(&v[0]), XMLoadFloat3(&v[2]) - XMLoadFloat3(&v[0])));
+
+        // the unused axes are zero and always pass
+        float lower[12], upper[12];
+        for (int i = 0; i < 12; i++)
+        {
+            const XMFLOAT3 &axis = axes[i];
+            float p0 = axis.x * v[0].x + axis.y * v[0].y + axis.z * v[0].z;
+            float p1 = axis.x * v[1].x + axis.y * v[1].y + axis.z * v[1].z;
+            float p2 = axis.x * v[2].x + axis.y * v[2].y + axis.z * v[2].z;
+            float radius = 0.5f * (fabsf(axis.x) + fabsf(axis.y) + fabsf(axis.z));
+
+            lower[i] = std::min({p0, p1, p2}) - radius;
+            upper[i] = std::max({p0, p1, p2}) + radius;
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            AxisX[i] = XMVectorSet(axes[4 * i].x, axes[4 * i + 1].x, axes[4 * i + 2].x, axes[4 * i + 3].x);
+            AxisY[i] = XMVectorSet(axes[4 * i].y, axes[4 * i + 1].y, axes[4 * i + 2].y, axes[4 * i + 3].y);
+            AxisZ[i] = XMVectorSet(axes[4 * i].z, axes[4 * i + 1].z, axes[4 * i + 2].z, axes[4 * i + 3].z);
+            Lower[i] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&lower[4 * i]));
+            Upper[i] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&upper[4 * i]));
+        }
+    }
+
+    bool Overlaps(FXMVECTOR center) const
+    {
+        XMVECTOR x = XMVectorSplatX(center);
+        XMVECTOR y = XMVectorSplatY(center);
+        XMVECTOR z = XMVectorSplatZ(center);
+
+        XMVECTOR inside = XMVectorTrueInt();
+        for (int i = 0; i < 3; i++)
+        {
+            XMVECTOR projection = XMVectorMultiplyAdd(AxisZ[i], z, XMVectorMultiplyAdd(AxisY[i], y, XMVectorMultiply(AxisX[i], x)));
+            inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(projection, Lower[i]));
+            inside = XMVectorAndInt(inside, XMVectorLessOrEqual(projection, Upper[i]));
+        }
+        return XMVector4EqualInt(inside, XMVectorTrueInt());
+    }
+};
+
+// nearest texel with wrap addressing, LDR textures are sRGB like their GPU views
+static XMVECTOR SampleAlbedo(const Image &image, XMFLOAT2 texCoord)
+{
+    float u = texCoord.x - floorf(texCoord.x);
+    float v = texCoord.y - floorf(texCoord.y);
+    int x = std::min(int(u * image.Width()), image.Width() - 1);
+    int y = std::min(int(v * image.Height()), image.Height() - 1);
+    int offset = (y * image.Width() + x) * image.Channels();
+
+    if (image.IsHDR())
+        return XMLoadFloat3(reinterpret_cast<const XMFLOAT3 *>(image.Pixels<float>() + offset));
+
+    const unsigned char *texel = image.Pixels<unsigned char>() + offset;
+    return XMColorSRGBToRGB(XMVectorSet(texel[0], texel[1], texel[2], 255.0f) / 255.0f);
+}
+
+UINT64 VoxelVolume::Voxel(UINT x, UINT y, UINT z) const
+{
+    if (x >= VOXEL_DIMENSION || y >= VOXEL_DIMENSION || z >= VOXEL_DIMENSION)
+        return 0;
+
+    // the pool order is sorted by packed coordinate
+    UINT packed = BrickOccupancy::PackBrick(x / VOXEL_BRICK_SIZE, y / VOXEL_BRICK_SIZE, z / VOXEL_BRICK_SIZE);
+    auto it = std::lower_bound(Bricks.begin(), Bricks.end(), packed);
+    if (it == Bricks.end() || *it != packed)
+        return 0;
+
+    return Voxels[(it - Bricks.begin()) * VOXELS_PER_BRICK + LocalVoxelIndex(x, y, z)];
+}
+
+UINT VoxelVolume::NumSolidVoxels() const
+{
+    return (UINT)std::count_if(Voxels.begin(), Voxels.end(), [](UINT64 voxel)
+                               { return (voxel >> 52) != 0; });
+}
+
+void VoxelVolume::MarkBricks(BrickOccupancy &occupancy) const
+{
+    for (UINT packed : Bricks)
+    {
+        XMUINT3 brick = BrickOccupancy::UnpackBrick(packed);
+        occupancy.MarkBrick(brick.x, brick.y, brick.z);
+    }
+}
+
+bool VoxelVolume::Load(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    BakeHeader header = {};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || header.Magic != BAKE_MAGIC || header.Version != BAKE_VERSION ||
+        header.Dimension != VOXEL_DIMENSION || header.BrickSize != VOXEL_BRICK_SIZE || header.GridSize != VOXEL_GRID_SIZE ||
+        header.NumBricks > NUM_BRICKS)
+    {
+        LOG_CHANNEL_WARN(Voxel, "Ignoring voxel bake with a different layout: {}", filename);
+        return false;
+    }
+
+    std::vector<UINT> bricks(header.NumBricks);
+    std::vector<UINT64> voxels((size_t)header.NumBricks * VOXELS_PER_BRICK);
+    file.read(reinterpret_cast<char *>(bricks.data()), bricks.size() * sizeof(UINT));
+    file.read(reinterpret_cast<char *>(voxels.data()), voxels.size() * sizeof(UINT64));
+    if (!file)
+    {
+        LOG_CHANNEL_WARN(Voxel, "Truncated voxel bake: {}", filename);
+        return false;
+    }
+
+    Bricks = std::move(bricks);
+    Voxels = std::move(voxels);
+    MissingFragments = 0;
+
+    LOG_CHANNEL_INFO(Voxel, "Loaded voxel bake: {} ({} bricks)", filename, Bricks.size());
+    return true;
+}
+
+bool VoxelVolume::Save(const std::string &filename) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        LOG_CHANNEL_WARN(Voxel, "Failed to save voxel bake: {}", filename);
+        return false;
+    }
+
+    BakeHeader header = {BAKE_MAGIC, BAKE_VERSION, VOXEL_DIMENSION, VOXEL_BRICK_SIZE, VOXEL_GRID_SIZE, (UINT)Bricks.size()};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(Bricks.data()), Bricks.size() * sizeof(UINT));
+    file.write(reinterpret_cast<const char *>(Voxels.data()), Voxels.size() * sizeof(UINT64));
+
+    if (!file)
+    {
+        LOG_CHANNEL_WARN(Voxel, "Failed to save voxel bake: {}", filename);
+        return false;
+    }
+
+    LOG_CHANNEL_INFO(Voxel, "Saved voxel bake: {}", filename);
+    return true;
+}
+
+CpuVoxelizer::CpuVoxelizer(const BrickOccupancy &occupancy, const VoxelizerLight &sun, const VoxelizerSettings &settings)
+    : m_Sun(sun), m_Settings(settings)
+{
+    XMStoreFloat3(&m_Sun.Direction, XMVector3Normalize(XMLoadFloat3(&sun.Direction)));
+
+    m_Bricks = occupancy.OccupiedBricks(0);
+    m_BrickSlots.assign(NUM_BRICKS, INVALID_BRICK);
+    for (UINT slot = 0; slot < m_Bricks.size(); slot++)
+    {
+        XMUINT3 brick = BrickOccupancy::UnpackBrick(m_Bricks[slot]);
+        m_BrickSlots[BrickIndex(brick.x, brick.y, brick.z)] = slot;
+    }
+
+    m_Voxels = std::vector<std::atomic<UINT64>>((size_t)m_Bricks.size() * VOXELS_PER_BRICK);
+    for (auto &voxel : m_Voxels)
+        voxel.store(0, std::memory_order_relaxed);
+}
+
+UINT CpuVoxelizer::FindBrick(UINT x, UINT y, UINT z) const
+{
+    return m_BrickSlots[BrickIndex(x / VOXEL_BRICK_SIZE, y / VOXEL_BRICK_SIZE, z / VOXEL_BRICK_SIZE)];
+}
+
+void CpuVoxelizer::AddMesh(Mesh &mesh, FXMMATRIX world)
+{
+    const auto &vertices = mesh.Vertices();
+    const auto &indices = mesh.Indices();
+    const auto &subMeshes = mesh.SubMeshes();
+    const auto &materials = mesh.Materials();
+
+    if (m_Settings.SampleTextures)
+    {
+        std::vector<std::string> filenames;
+        for (const auto &material : materials)
+        {
+            if (material.HasAlbedoTexture && m_Textures.find(material.AlbedoFilename) == m_Textures.end())
+                filenames.push_back(material.AlbedoFilename);
+        }
+        std::sort(filenames.begin(), filenames.end());
+        filenames.erase(std::unique(filenames.begin(), filenames.end()), filenames.end());
+
+        std::vector<std::shared_ptr<Image>> images(filenames.size());
+        Parallel::For((UINT)filenames.size(), [&](UINT i)
+                      { images[i] = Image::FromFile(filenames[i]); });
+
+        for (UINT i = 0; i < filenames.size(); i++)
+            m_Textures[filenames[i]] = images[i];
+    }
+
+    std::vector<XMFLOAT3> positions(vertices.size());
+    std::vector<XMFLOAT3> normals(vertices.size());
+    Parallel::For((UINT)vertices.size(), [&](UINT i)
+                  {
+        XMStoreFloat3(&positions[i], WorldToVoxelSpace(XMVector3TransformCoord(XMLoadFloat3(&vertices[i].Position), world)));
+        // like the voxelize vertex shader, without the inverse transpose
+        XMStoreFloat3(&normals[i], XMVector3TransformNormal(XMLoadFloat3(&vertices[i].Normal), world)); },
+                  4096);
+
+    // first index and submesh of every triangle, transparent submeshes are not voxelized
+    std::vector<std::pair<UINT, UINT>> triangles;
+    triangles.reserve(indices.size() / 3);
+    for (UINT s = 0; s < subMeshes.size(); s++)
+    {
+        if (subMeshes[s].Transparent)
+            continue;
+
+        for (UINT i = 0; i + 2 < subMeshes[s].IndexCount; i += 3)
+            triangles.emplace_back(subMeshes[s].StartIndexLocation + i, s);
+    }
+
+    Parallel::For((UINT)triangles.size(), [&](UINT t)
+                  {
+        const auto &subMesh = subMeshes[triangles[t].second];
+        const auto &material = materials[subMesh.MaterialIndex];
+
+        Triangle triangle;
+        for (int k = 0; k < 3; k++)
+        {
+            UINT index = indices[triangles[t].first + k] + subMesh.BaseVertexLocation;
+            triangle.Positions[k] = positions[index];
+            triangle.Normals[k] = normals[index];
+            triangle.TexCoords[k] = vertices[index].TexCoord;
+        }
+
+        // the voxel space cross product, flipped back into world space where y is not negated
+        XMFLOAT3 cross;
+        XMStoreFloat3(&cross, XMVector3Cross(XMLoadFloat3(&triangle.Positions[1]) - XMLoadFloat3(&triangle.Positions[0]),
+                                             XMLoadFloat3(&triangle.Positions[2]) - XMLoadFloat3(&triangle.Positions[0])));
+        triangle.FaceNormal = XMFLOAT3(-cross.x, cross.y, -cross.z);
+
+        // metals have no diffuse part, see DoDirectLighting in voxelize.hlsl
+        float kd = 1.0f - material.Metalness;
+        triangle.Albedo = XMFLOAT3(material.Albedo.x * kd, material.Albedo.y * kd, material.Albedo.z * kd);
+
+        auto texture = material.HasAlbedoTexture ? m_Textures.find(material.AlbedoFilename) : m_Textures.end();
+        triangle.Texture = texture != m_Textures.end() ? texture->second.get() : nullptr;
+
+        VoxelizeTriangle(triangle); },
+                  256);
+}
+
+void CpuVoxelizer::AddTriangle(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2, const XMFLOAT3 &albedo)
+{
+    Triangle triangle;
+    XMStoreFloat3(&triangle.Positions[0], WorldToVoxelSpace(p0));
+    XMStoreFloat3(&triangle.Positions[1], WorldToVoxelSpace(p1));
+    XMStoreFloat3(&triangle.Positions[2], WorldToVoxelSpace(p2));
+
+    XMStoreFloat3(&triangle.FaceNormal, XMVector3Normalize(XMVector3Cross(p1 - p0, p2 - p0)));
+    for (int k = 0; k < 3; k++)
+    {
+        triangle.Normals[k] = triangle.FaceNormal;
+        triangle.TexCoords[k] = XMFLOAT2(0.0f, 0.0f);
+    }
+
+    triangle.Albedo = albedo;
+    triangle.Texture = nullptr;
+
+    VoxelizeTriangle(triangle);
+}
+
+void CpuVoxelizer::VoxelizeTriangle(const Triangle &triangle)
+{
+    XMVECTOR v0 = XMLoadFloat3(&triangle.Positions[0]);
+    XMVECTOR v1 = XMLoadFloat3(&triangle.Positions[1]);
+    XMVECTOR v2 = XMLoadFloat3(&triangle.Positions[2]);
+    XMVECTOR e0 = v1 - v0;
+    XMVECTOR e1 = v2 - v0;
+
+    // degenerate triangles are not rasterized either
+    float d00 = XMVectorGetX(XMVector3Dot(e0, e0));
+    float d01 = XMVectorGetX(XMVector3Dot(e0, e1));
+    float d11 = XMVectorGetX(XMVector3Dot(e1, e1));
+    float denom = d00 * d11 - d01 * d01;
+    if (denom <= 1.0e-12f)
+        return;
+    float invDenom = 1.0f / denom;
+
+    XMFLOAT3 minPoint, maxPoint;
+    XMStoreFloat3(&minPoint, XMVectorMin(XMVectorMin(v0, v1), v2));
+    XMStoreFloat3(&maxPoint, XMVectorMax(XMVectorMax(v0, v1), v2));
+
+    auto voxelRange = [](float minValue, float maxValue, int &first, int &last)
+    {
+        first = std::max((int)floorf(std::max(minValue, -1.0f)), 0);
+        last = std::min((int)floorf(std::min(maxValue, (float)VOXEL_DIMENSION)), VOXEL_DIMENSION - 1);
+    };
+
+    int x0, x1, y0, y1, z0, z1;
+    voxelRange(minPoint.x, maxPoint.x, x0, x1);
+    voxelRange(minPoint.y, maxPoint.y, y0, y1);
+    voxelRange(minPoint.z, maxPoint.z, z0, z1);
+
+    TriangleVoxelTest test(triangle.Positions);
+
+    XMVECTOR toLight = -XMLoadFloat3(&m_Sun.Direction);
+    XMVECTOR radiance = XMLoadFloat3(&m_Sun.Radiance);
+
+    for (int x = x0; x <= x1; x++)
+        for (int y = y0; y <= y1; y++)
+            for (int z = z0; z <= z1; z++)
+            {
+                XMVECTOR center = XMVectorSet(x + 0.5f, y + 0.5f, z + 0.5f, 0.0f);
+                if (!test.Overlaps(center))
+                    continue;
+
+                UINT slot = FindBrick(x, y, z);
+                if (slot == INVALID_BRICK)
+                {
+                    m_MissingFragments.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                // barycentrics of the point of the triangle closest to the voxel centre
+                XMVECTOR p = center - v0;
+                float d20 = XMVectorGetX(XMVector3Dot(p, e0));
+                float d21 = XMVectorGetX(XMVector3Dot(p, e1));
+                float b1 = std::max((d11 * d20 - d01 * d21) * invDenom, 0.0f);
+                float b2 = std::max((d00 * d21 - d01 * d20) * invDenom, 0.0f);
+                float b0 = std::max(1.0f - b1 - b2, 0.0f);
+                float sum = b0 + b1 + b2;
+                XMVECTOR weights = XMVectorSet(b0, b1, b2, 0.0f) / sum;
+
+                XMVECTOR normal = XMVectorSplatX(weights) * XMLoadFloat3(&triangle.Normals[0]) +
+                                  XMVectorSplatY(weights) * XMLoadFloat3(&triangle.Normals[1]) +
+                                  XMVectorSplatZ(weights) * XMLoadFloat3(&triangle.Normals[2]);
+                if (XMVectorGetX(XMVector3LengthSq(normal)) <= 1.0e-12f)
+                    normal = XMLoadFloat3(&triangle.FaceNormal);
+                normal = XMVector3Normalize(normal);
+
+                XMVECTOR albedo = XMLoadFloat3(&triangle.Albedo);
+                if (triangle.Texture)
+                {
+                    XMFLOAT2 texCoord(XMVectorGetX(weights) * triangle.TexCoords[0].x + XMVectorGetY(weights) * triangle.TexCoords[1].x + XMVectorGetZ(weights) * triangle.TexCoords[2].x,
+                                      XMVectorGetX(weights) * triangle.TexCoords[0].y + XMVectorGetY(weights) * triangle.TexCoords[1].y + XMVectorGetZ(weights) * triangle.TexCoords[2].y);
+                    albedo *= SampleAlbedo(*triangle.Texture, texCoord);
+                }
+
+                // Lambert, the visibility is applied once all fragments are in
+                XMFLOAT3 fragmentRadiance, fragmentNormal;
+                XMStoreFloat3(&fragmentRadiance, albedo * radiance * XMVectorMax(XMVector3Dot(normal, toLight), XMVectorZero()));
+                XMStoreFloat3(&fragmentNormal, normal);
+
+                auto &voxel = m_Voxels[(size_t)slot * VOXELS_PER_BRICK + LocalVoxelIndex(x, y, z)];
+                UINT64 packed = voxel.load(std::memory_order_relaxed);
+                while (!voxel.compare_exchange_weak(packed, VoxelPacking::Accumulate(packed, fragmentRadiance, fragmentNormal), std::memory_order_relaxed))
+                    ;
+            }
+}
+
+VoxelVolume CpuVoxelizer::Finish()
+{
+    VoxelVolume volume;
+    volume.Bricks = m_Bricks;
+    volume.Voxels.resize(m_Voxels.size());
+    volume.MissingFragments = m_MissingFragments.load();
+
+    for (size_t i = 0; i < m_Voxels.size(); i++)
+        volume.Voxels[i] = m_Voxels[i].load(std::memory_order_relaxed);
+
+    if (m_Settings.Shadows)
+        ApplyShadows(volume);
+
+    if (volume.MissingFragments > 0)
+        LOG_CHANNEL_WARN(Voxel, "CPU voxelizer: {} fragments fell into unallocated bricks.", volume.MissingFragments);
+
+    return volume;
+}
+
+void CpuVoxelizer::ApplyShadows(VoxelVolume &volume) const
+{
+    // one bit per voxel in brick pool order, the occluders of the shadow rays
+    std::vector<UINT64> solid((volume.Voxels.size() + 63) / 64, 0);
+    Parallel::For((UINT)solid.size(), [&](UINT i)
+                  {
+        for (UINT bit = 0; bit < 64 && i * 64 + bit < volume.Voxels.size(); bit++)
+        {
+            if (volume.Voxels[(size_t)i * 64 + bit] >> 52)
+                solid[i] |= 1ull << bit;
+        } },
+                  256);
+
+    Parallel::For((UINT)volume.Bricks.size(), [&](UINT slot)
+                  {
+        XMUINT3 brick = BrickOccupancy::UnpackBrick(volume.Bricks[slot]);
+
+        for (UINT i = 0; i < VOXELS_PER_BRICK; i++)
+        {
+            UINT64 &voxel = volume.Voxels[(size_t)slot * VOXELS_PER_BRICK + i];
+
+            // empty voxels and the ones facing away from the sun stay as they are
+            if ((voxel & RADIANCE_MASK) == 0)
+                continue;
+
+            XMUINT3 local(i / (VOXEL_BRICK_SIZE * VOXEL_BRICK_SIZE), (i / VOXEL_BRICK_SIZE) % VOXEL_BRICK_SIZE, i % VOXEL_BRICK_SIZE);
+            XMVECTOR center = XMVectorSet((brick.x * VOXEL_BRICK_SIZE + local.x) + 0.5f,
+                                          (brick.y * VOXEL_BRICK_SIZE + local.y) + 0.5f,
+                                          (brick.z * VOXEL_BRICK_SIZE + local.z) + 0.5f, 0.0f);
+
+            // off the surface along the normal and towards the sun, in voxel space where y is negated
+            XMFLOAT3 normal = VoxelPacking::UnpackOctahedralNormal((UINT)(voxel >> 32) & 0xFFFFF);
+            XMVECTOR offset = XMVectorSet(normal.x - m_Sun.Direction.x, -(normal.y - m_Sun.Direction.y), normal.z - m_Sun.Direction.z, 0.0f);
+
+            if (IsOccluded(solid, center + offset * m_Settings.ShadowBias))
+                voxel &= ~RADIANCE_MASK;
+        } },
+                  4);
+}
+
+bool CpuVoxelizer::IsOccluded(const std::vector<UINT64> &solid, FXMVECTOR origin) const
+{
+    // 3D DDA through the voxels towards the sun
+    float direction[3] = {-m_Sun.Direction.x, m_Sun.Direction.y, -m_Sun.Direction.z};
+    float position[3] = {XMVectorGetX(origin), XMVectorGetY(origin), XMVectorGetZ(origin)};
+
+    int voxel[3], step[3];
+    float tMax[3], tDelta[3];
+    for (int i = 0; i < 3; i++)
+    {
+        voxel[i] = (int)floorf(position[i]);
+        step[i] = direction[i] > 0.0f ? 1 : -1;
+
+        if (fabsf(direction[i]) < 1.0e-8f)
+        {
+            tMax[i] = FLT_MAX;
+            tDelta[i] = FLT_MAX;
+        }
+        else
+        {
+            float boundary = direction[i] > 0.0f ? voxel[i] + 1.0f : (float)voxel[i];
+            tMax[i] = (boundary - position[i]) / direction[i];
+            tDelta[i] = 1.0f / fabsf(direction[i]);
+        }
+    }
+
+    while (voxel[0] >= 0 && voxel[0] < VOXEL_DIMENSION &&
+           voxel[1] >= 0 && voxel[1] < VOXEL_DIMENSION &&
+           voxel[2] >= 0 && voxel[2] < VOXEL_DIMENSION)
+    {
+        UINT slot = FindBrick(voxel[0], voxel[1], voxel[2]);
+        if (slot != INVALID_BRICK)
+        {
+            size_t index = (size_t)slot * VOXELS_PER_BRICK + LocalVoxelIndex(voxel[0], voxel[1], voxel[2]);
+            if ((solid[index / 64] >> (index % 64)) & 1)
+                return true;
+        }
+
+        int axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+        voxel[axis] += step[axis];
+        tMax[axis] += tDelta[axis];
+    }
+
+    return false;
+}
+
+std::string CpuVoxelizer::CacheFilename(const std::vector<VoxelizerMesh> &meshes, const VoxelizerLight &sun, const VoxelizerSettings &settings)
+{
+    UINT64 hash = FNV_OFFSET_BASIS;
+    hash = HashValue(hash, BAKE_VERSION);
+    hash = HashValue(hash, VOXEL_DIMENSION);
+    hash = HashValue(hash, VOXEL_GRID_SIZE);
+
+    hash = HashValue(hash, sun.Direction);
+    hash = HashValue(hash, sun.Radiance);
+    hash = HashValue(hash, settings.SampleTextures);
+    hash = HashValue(hash, settings.Shadows);
+    hash = HashValue(hash, settings.ShadowBias);
+
+    for (const auto &mesh : meshes)
+    {
+        hash = HashValue(hash, mesh.World);
+
+        const auto &vertices = mesh.Source->Vertices();
+        const auto &indices = mesh.Source->Indices();
+        hash = HashBytes(hash, vertices.data(), vertices.size() * sizeof(Mesh::Vertex));
+        hash = HashBytes(hash, indices.data(), indices.size() * sizeof(Mesh::Index));
+
+        for (const auto &subMesh : mesh.Source->SubMeshes())
+        {
+            hash = HashValue(hash, subMesh.MaterialIndex);
+            hash = HashValue(hash, subMesh.IndexCount);
+            hash = HashValue(hash, subMesh.StartIndexLocation);
+            hash = HashValue(hash, subMesh.BaseVertexLocation);
+            hash = HashValue(hash, subMesh.Transparent);
+        }
+
+        for (const auto &material : mesh.Source->Materials())
+        {
+            hash = HashValue(hash, material.Albedo);
+            hash = HashValue(hash, material.Metalness);
+            hash = HashValue(hash, material.HasAlbedoTexture);
+            hash = HashBytes(hash, material.AlbedoFilename.data(), material.AlbedoFilename.size());
+        }
+    }
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+    return std::string(CACHE_DIRECTORY) + "/" + key + ".voxels";
+}
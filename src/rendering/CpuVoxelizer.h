@@ -0,0 +1,98 @@
+#pragma once
+
+#include "pch.h"
+#include "VoxelBricks.h"
+
+class Mesh;
+class Image;
+
+// the sun, the only light the voxelize pass applies
+struct VoxelizerLight
+{
+    XMFLOAT3 Direction = {0.0f, -1.0f, 0.0f}; // direction the light travels in, world space
+    XMFLOAT3 Radiance = {1.0f, 1.0f, 1.0f};   // color times intensity
+};
+
+struct VoxelizerSettings
+{
+    bool SampleTextures = true; // multiply the material albedo by the albedo texture
+    bool Shadows = true;        // march the voxel grid towards the sun
+    float ShadowBias = 1.5f;    // in voxels, the shadow rays start this far off the surface
+};
+
+struct VoxelizerMesh
+{
+    Mesh *Source;
+    XMFLOAT4X4 World;
+};
+
+// A voxelized scene in the layout of the VXGI brick pool, ready to be copied into its voxel buffer.
+struct VoxelVolume
+{
+    std::vector<UINT> Bricks;   // packed coordinates of the allocated bricks in brick pool order
+    std::vector<UINT64> Voxels; // VOXELS_PER_BRICK records per brick, see VoxelPacking
+    UINT MissingFragments = 0;  // fragments that fell into bricks the occupancy did not allocate
+
+    // the record of a voxel, 0 (empty) outside the allocated bricks
+    UINT64 Voxel(UINT x, UINT y, UINT z) const;
+    UINT NumSolidVoxels() const;
+
+    void MarkBricks(BrickOccupancy &occupancy) const;
+
+    bool Load(const std::string &filename);
+    bool Save(const std::string &filename) const;
+};
+
+// CPU reference of the voxelize pass. Every voxel a triangle overlaps receives a fragment, a
+// conservative superset of what the rasterizer produces, averaged into the voxel records like
+// AccumulateVoxel does. Fragments take the albedo and the interpolated vertex normal at the point
+// of the triangle closest to the voxel centre; normal maps are ignored and the sun visibility
+// comes from marching the voxels themselves instead of the shadow map. Triangles are distributed
+// over all threads and the triangle-voxel test runs 4 separating axes at a time.
+//
+// Serves as the oracle of the GPU voxelizer and bakes the static scene, see CacheFilename.
+class CpuVoxelizer
+{
+public:
+    CpuVoxelizer(const BrickOccupancy &occupancy, const VoxelizerLight &sun, const VoxelizerSettings &settings = {});
+
+    void AddMesh(Mesh &mesh, FXMMATRIX world);
+
+    // world space triangle of a single albedo and its face normal
+    void AddTriangle(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2, const XMFLOAT3 &albedo);
+
+    // applies the sun visibility and hands out the volume
+    VoxelVolume Finish();
+
+    // Bake of the given scene in resources/cache/voxels, keyed by a hash of the meshes, their
+    // placement and materials, the sun and the settings. Texture contents are not part of the key.
+    static std::string CacheFilename(const std::vector<VoxelizerMesh> &meshes, const VoxelizerLight &sun, const VoxelizerSettings &settings = {});
+
+private:
+    struct Triangle
+    {
+        XMFLOAT3 Positions[3]; // voxel space
+        XMFLOAT3 Normals[3];   // world space
+        XMFLOAT2 TexCoords[3];
+        XMFLOAT3 FaceNormal;   // world space, for vertex normals that cancel out
+        XMFLOAT3 Albedo;       // material albedo, diffuse part only
+        const Image *Texture;
+    };
+
+    void VoxelizeTriangle(const Triangle &triangle);
+    void ApplyShadows(VoxelVolume &volume) const;
+    bool IsOccluded(const std::vector<UINT64> &solid, FXMVECTOR origin) const;
+
+    UINT FindBrick(UINT x, UINT y, UINT z) const;
+
+private:
+    VoxelizerLight m_Sun;
+    VoxelizerSettings m_Settings;
+
+    std::vector<UINT> m_Bricks;
+    std::vector<UINT> m_BrickSlots; // brick coordinate -> slot, like the indirection grid of VXGI
+    std::vector<std::atomic<UINT64>> m_Voxels;
+    std::atomic<UINT> m_MissingFragments{0};
+
+    std::unordered_map<std::string, std::shared_ptr<Image>> m_Textures;
+};
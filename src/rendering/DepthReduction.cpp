@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "DepthReduction.h"
+#include "PipelineStates.h"
+#include "dx/Utils.h"
+
+// min and max view depth as float bits, ordered like the values since depths are positive
+static const UINT RESULT_SIZE = 2 * sizeof(UINT);
+
+DepthReduction::DepthReduction(Ref<DxContext> dxContext)
+	: m_Device(dxContext->GetDevice())
+{
+	GpuMemoryScope memoryScope(GpuMemoryCategory::Shadow);
+
+	m_ResultUav = dxContext->GetCbvSrvUavHeap().Alloc();
+
+	BuildBuffers();
+}
+
+void DepthReduction::Reduce(GraphicsCommandList commandList, int frameIndex, Texture &depthBuffer, const XMFLOAT4X4 &proj)
+{
+	D3D12_RESOURCE_BARRIER preBarriers[] =
+		{
+			CD3DX12_RESOURCE_BARRIER::Transition(depthBuffer.Resource.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE,
+												 D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(m_ResultBuffer.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST),
+		};
+	Utils::ResourceBarrier(commandList, _countof(preBarriers), preBarriers);
+
+	commandList->CopyBufferRegion(m_ResultBuffer.Get(), 0, m_ResetBuffer.Get(), 0, RESULT_SIZE);
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_ResultBuffer.Get(),
+																			 D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+
+	PipelineStates::SetPSO(commandList, "depthReduction");
+	commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
+
+	// view depth = B / (ndc depth - A), see NdcDepthToViewDepth in ssao.hlsl
+	float projA = proj._33;
+	float projB = proj._43;
+	UINT resources[] = {depthBuffer.Srv.Index,
+						m_ResultUav.Index,
+						depthBuffer.Width,
+						depthBuffer.Height,
+						*reinterpret_cast<UINT *>(&projA),
+						*reinterpret_cast<UINT *>(&projB)};
+	commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
+	commandList->Dispatch((depthBuffer.Width + 15) / 16, (depthBuffer.Height + 15) / 16, 1);
+
+	D3D12_RESOURCE_BARRIER postBarriers[] =
+		{
+			CD3DX12_RESOURCE_BARRIER::Transition(depthBuffer.Resource.Get(), D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+												 D3D12_RESOURCE_STATE_DEPTH_WRITE),
+			CD3DX12_RESOURCE_BARRIER::Transition(m_ResultBuffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE),
+		};
+	Utils::ResourceBarrier(commandList, _countof(postBarriers), postBarriers);
+
+	commandList->CopyBufferRegion(m_ReadbackBuffers[frameIndex].Get(), 0, m_ResultBuffer.Get(), 0, RESULT_SIZE);
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_ResultBuffer.Get(),
+																			 D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON));
+
+	m_Pending[frameIndex] = true;
+}
+
+void DepthReduction::Update(int frameIndex)
+{
+	if (!m_Pending[frameIndex])
+		return;
+
+	float *result = nullptr;
+	ThrowIfFailed(m_ReadbackBuffers[frameIndex]->Map(0, &CD3DX12_RANGE(0, RESULT_SIZE), reinterpret_cast<void **>(&result)));
+	m_MinDepth = result[0];
+	m_MaxDepth = result[1];
+	m_ReadbackBuffers[frameIndex]->Unmap(0, &CD3DX12_RANGE(0, 0));
+
+	m_Pending[frameIndex] = false;
+}
+
+void DepthReduction::BuildBuffers()
+{
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(RESULT_SIZE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&m_ResultBuffer)));
+
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(RESULT_SIZE),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_ResetBuffer)));
+
+	// an empty range, min at the largest float and max at zero
+	float *reset = nullptr;
+	ThrowIfFailed(m_ResetBuffer->Map(0, nullptr, reinterpret_cast<void **>(&reset)));
+	reset[0] = FLT_MAX;
+	reset[1] = 0.0f;
+	m_ResetBuffer->Unmap(0, nullptr);
+
+	for (int i = 0; i < NUM_FRAMES_IN_FLIGHT; i++)
+	{
+		ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(RESULT_SIZE),
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&m_ReadbackBuffers[i])));
+	}
+
+	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.NumElements = 2;
+	uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+
+	m_Device->CreateUnorderedAccessView(m_ResultBuffer.Get(), nullptr, &uavDesc, m_ResultUav.CPUHandle);
+}
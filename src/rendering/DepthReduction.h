@@ -0,0 +1,41 @@
+#pragma once
+
+#include "pch.h"
+#include "dx/dx.h"
+#include "dx/DxContext.h"
+#include "dx/Descriptor.h"
+
+// Min and max view depth of the pixels in the depth buffer, the sky excluded, for fitting the
+// shadow cascades to what is visible. The result is read back once the frame resource that
+// reduced it comes around again, so it lags NUM_FRAMES_IN_FLIGHT frames behind.
+class DepthReduction
+{
+public:
+	DepthReduction(Ref<DxContext> dxContext);
+
+	// expects the depth buffer in DEPTH_WRITE and leaves it there
+	void Reduce(GraphicsCommandList commandList, int frameIndex, Texture &depthBuffer, const XMFLOAT4X4 &proj);
+
+	// picks up the result reduced with the given frame resource, call after waiting for its fence
+	void Update(int frameIndex);
+
+	// false until a frame with any geometry on screen was read back
+	bool HasResult() const { return m_MaxDepth > m_MinDepth; }
+	float MinDepth() const { return m_MinDepth; }
+	float MaxDepth() const { return m_MaxDepth; }
+
+private:
+	void BuildBuffers();
+
+private:
+	Device m_Device;
+
+	Resource m_ResultBuffer = nullptr;
+	Resource m_ResetBuffer = nullptr;
+	Resource m_ReadbackBuffers[NUM_FRAMES_IN_FLIGHT];
+	bool m_Pending[NUM_FRAMES_IN_FLIGHT] = {};
+	Descriptor m_ResultUav;
+
+	float m_MinDepth = 0.0f;
+	float m_MaxDepth = 0.0f;
+};
@@ -1,21 +1,82 @@
 #include "pch.h"
 #include "EnvironmentMap.h"
 #include "RenderingUtils.h"
+#include "IBLCache.h"
 
-void EnvironmentMap::Load(const std::string &filename)
+void EnvironmentMap::Decode(const std::string &filename)
 {
+	PROFILE_FUNCTION();
+
+	// the GPU path below uses the default bake settings, see IBLBakeSettings
+	IBLBakeSettings settings;
+	m_CacheKey = IBLCache::ComputeKey(filename, settings);
+
+	m_Cached = IBLCache::Load(m_CacheKey, m_Products);
+	if (m_Cached)
+		m_IrradianceSH = SphericalHarmonics::ConvolveIrradiance(SphericalHarmonics::ProjectCubemap(m_Products.EnvMap));
+	else
+		m_Equirect = Image::FromFile(filename);
+}
+
+void EnvironmentMap::Load(Ref<DxContext> dxContext)
+{
+	PROFILE_FUNCTION();
+
+	m_DxContext = dxContext;
+
+	GpuMemoryScope memoryScope(GpuMemoryCategory::IBL);
+
+	if (m_Cached)
+	{
+		CreateFromProducts(m_Products);
+		m_Products = IBLProducts();
+		return;
+	}
+
 	auto device = m_DxContext->GetDevice();
 	auto commandList = m_DxContext->GetCommandList();
 
-	Texture equirectTex = Texture::Create(device, commandList,
-										  Image::FromFile(filename), DXGI_FORMAT_R32G32B32A32_FLOAT, 1);
+	Texture equirectTex = Texture::Create(device, commandList, m_DxContext->GetStagingManager(),
+										  m_Equirect, DXGI_FORMAT_R32G32B32A32_FLOAT, 1);
+	m_Equirect = nullptr;
 
 	m_DxContext->ExecuteCommandList();
-	m_DxContext->Flush();
+	m_DxContext->DeferFlush();
 
 	m_EnvMap = RenderingUtils::Equirect2Cubemap(m_DxContext, equirectTex);
 	RenderingUtils::GenerateMipmaps(m_DxContext, m_EnvMap);
-	m_IrMap = RenderingUtils::ComputeDiffuseIrradianceCubemap(m_DxContext, m_EnvMap);
 	m_SpMap = RenderingUtils::ComputePrefilteredSpecularEnvironmentMap(m_DxContext, m_EnvMap);
 	m_BRDFLUT = RenderingUtils::ComputeBRDFLookUpTable(m_DxContext);
-}
\ No newline at end of file
+
+	TextureData envMap = RenderingUtils::ReadbackTexture(m_DxContext, m_EnvMap);
+	m_IrradianceSH = SphericalHarmonics::ConvolveIrradiance(SphericalHarmonics::ProjectCubemap(envMap));
+
+	IBLProducts products;
+	products.EnvMap = IBLBaker::ConvertToHalf(envMap);
+	products.SpecularMap = IBLBaker::ConvertToHalf(RenderingUtils::ReadbackTexture(m_DxContext, m_SpMap));
+	products.BRDFLUT = RenderingUtils::ReadbackTexture(m_DxContext, m_BRDFLUT); // already R16G16_FLOAT
+
+	IBLCache::Save(m_CacheKey, products);
+}
+
+void EnvironmentMap::CreateFromProducts(const IBLProducts &products)
+{
+	GpuMemoryScope memoryScope(GpuMemoryCategory::IBL);
+
+	auto device = m_DxContext->GetDevice();
+	auto &heap = m_DxContext->GetCbvSrvUavHeap();
+
+	m_EnvMap = RenderingUtils::CreateTexture(m_DxContext, products.EnvMap);
+	m_SpMap = RenderingUtils::CreateTexture(m_DxContext, products.SpecularMap);
+	m_BRDFLUT = RenderingUtils::CreateTexture(m_DxContext, products.BRDFLUT);
+
+	m_DxContext->ExecuteCommandList();
+	m_DxContext->DeferFlush();
+
+	m_EnvMap.Srv = heap.Alloc();
+	m_EnvMap.CreateSrv(device, D3D12_SRV_DIMENSION_TEXTURECUBE);
+	m_SpMap.Srv = heap.Alloc();
+	m_SpMap.CreateSrv(device, D3D12_SRV_DIMENSION_TEXTURECUBE);
+	m_BRDFLUT.Srv = heap.Alloc();
+	m_BRDFLUT.CreateSrv(device, D3D12_SRV_DIMENSION_TEXTURE2D, 0, 1);
+}
@@ -3,23 +3,39 @@
 #include "dx/dx.h"
 #include "dx/DxContext.h"
 #include "dx/Texture.h"
+#include "IBLBaker.h"
+#include "SphericalHarmonics.h"
 
 class EnvironmentMap
 {
 public:
-	EnvironmentMap(Ref<DxContext> dxContext) : m_DxContext(dxContext) {}
-	void Load(const std::string& filename);
+	// reads the environment, or what was baked from it if the IBL cache has it, on any thread and
+	// before there is a device
+	void Decode(const std::string& filename);
+
+	// creates the textures, baking them on the GPU first if they were not cached
+	void Load(Ref<DxContext> dxContext);
 
 	Texture& GetEnvMap() { return m_EnvMap; }
-	Texture& GetIrMap() { return m_IrMap; }
 	Texture& GetSpMap() { return m_SpMap; }
 	Texture& GetBRDFLUT() { return m_BRDFLUT; }
+	const SH9& GetIrradianceSH() const { return m_IrradianceSH; }
+
+private:
+	void CreateFromProducts(const IBLProducts &products);
 
 private:
 	Ref<DxContext> m_DxContext;
 
+	// what Decode read for Load
+	std::string m_CacheKey;
+	bool m_Cached = false;
+	IBLProducts m_Products;
+	Ref<Image> m_Equirect;
+
 	Texture m_EnvMap;
-	Texture m_IrMap;	// Irradiance Cubemap
 	Texture m_SpMap;	// Pre-filtered Specular Cubemap
 	Texture m_BRDFLUT;  // BRDF Look-up Table
+
+	SH9 m_IrradianceSH; // Diffuse irradiance, replaces the irradiance cubemap
 };
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include "Material.h"
 #include "Light.h"
+#include "IndirectDraw.h"
+#include "VoxelClipmap.h"
 
 struct ObjectConstants
 {
@@ -35,6 +37,14 @@ struct PassConstants
 	XMFLOAT2 PreviousJitter;
 	BOOL EnableGI;
 	BOOL EnableIBL;
+	float cbPerObjectPad2[2];
+	XMFLOAT4 IrradianceSH[9];
+	XMFLOAT4 ClipmapLevels[VOXEL_CLIPMAP_MAX_LEVELS]; // xyz: world position of the window's min corner, w: voxel size
+	XMUINT4 ClipmapTexIndices[VOXEL_CLIPMAP_MAX_LEVELS / 4];
+	UINT ClipmapLevelCount = 0;
+	UINT ClipmapResolution = 0;
+	BOOL UseClipmap = FALSE;
+	float cbPerObjectPad3;
 };
 
 struct SSAOConstants
@@ -78,6 +88,7 @@ struct FrameResource
 		SSAOCB = std::make_unique<UploadBuffer<SSAOConstants>>(device, passCount, true);
 		ShadowCB = std::make_unique<UploadBuffer<ShadowPassConstants>>(device, 1, true);
 		LightBuffer = std::make_unique<UploadBuffer<Light>>(device, lightCount, false);
+		IndirectDrawBuffer = std::make_unique<UploadBuffer<IndirectDrawCommand>>(device, MAX_INDIRECT_DRAWS, false);
 	}
 	FrameResource(const FrameResource& rhs) = delete;
 	FrameResource& operator=(const FrameResource& rhs) = delete;
@@ -91,5 +102,8 @@ struct FrameResource
 	std::unique_ptr<UploadBuffer<ShadowPassConstants>> ShadowCB = nullptr;
 	std::unique_ptr<UploadBuffer<Light>> LightBuffer = nullptr;
 
+	// Indirect draw arguments are rebuilt every frame, the upload heap is readable as INDIRECT_ARGUMENT directly.
+	std::unique_ptr<UploadBuffer<IndirectDrawCommand>> IndirectDrawBuffer = nullptr;
+
 	UINT64 Fence = 0;
 };
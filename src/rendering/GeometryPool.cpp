@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "GeometryPool.h"
+#include "dx/Utils.h"
+
+// committed buffers are placed at 64KB granularity
+static UINT64 CommittedBufferSize(UINT64 byteSize)
+{
+	const UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	return (byteSize + alignment - 1) & ~(alignment - 1);
+}
+
+GeometryPool::GeometryPool(Device device, StagingManager &stagingManager, UINT vertexStride, UINT maxVertices, UINT maxIndices)
+	: m_StagingManager(stagingManager), m_VertexStride(vertexStride), m_VertexAllocator(maxVertices), m_IndexAllocator(maxIndices)
+{
+	GpuMemoryScope memoryScope(GpuMemoryCategory::Mesh);
+
+	UINT64 vbByteSize = (UINT64)maxVertices * vertexStride;
+	UINT64 ibByteSize = (UINT64)maxIndices * sizeof(UINT32);
+
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(device.Get(),
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(vbByteSize),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&m_VertexBuffer)));
+	SET_NAME(m_VertexBuffer, "Geometry Pool Vertex Buffer");
+
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(device.Get(),
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(ibByteSize),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&m_IndexBuffer)));
+	SET_NAME(m_IndexBuffer, "Geometry Pool Index Buffer");
+
+	m_VertexBufferView.BufferLocation = m_VertexBuffer->GetGPUVirtualAddress();
+	m_VertexBufferView.SizeInBytes = (UINT)vbByteSize;
+	m_VertexBufferView.StrideInBytes = vertexStride;
+
+	m_IndexBufferView.BufferLocation = m_IndexBuffer->GetGPUVirtualAddress();
+	m_IndexBufferView.SizeInBytes = (UINT)ibByteSize;
+	m_IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
+
+	// buffers start out in COMMON, the first copy promotes them to COPY_DEST implicitly
+	m_InCopyState = true;
+}
+
+GeometryRange GeometryPool::Upload(GraphicsCommandList commandList,
+								   const void *vertices, UINT vertexCount,
+								   const UINT32 *indices, UINT indexCount)
+{
+	GeometryRange range;
+	range.VertexCount = vertexCount;
+	range.IndexCount = indexCount;
+
+	UINT64 baseVertex = m_VertexAllocator.Allocate(vertexCount);
+	UINT64 startIndex = m_IndexAllocator.Allocate(indexCount);
+	ASSERT(baseVertex != RangeAllocator::InvalidOffset && startIndex != RangeAllocator::InvalidOffset,
+		   "Geometry pool is out of memory.");
+
+	range.BaseVertex = (UINT)baseVertex;
+	range.StartIndex = (UINT)startIndex;
+
+	UINT64 vbByteSize = (UINT64)vertexCount * m_VertexStride;
+	UINT64 ibByteSize = (UINT64)indexCount * sizeof(UINT32);
+
+	if (!m_InCopyState)
+	{
+		D3D12_RESOURCE_BARRIER barriers[] =
+			{
+				CD3DX12_RESOURCE_BARRIER::Transition(m_VertexBuffer.Get(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_COPY_DEST),
+				CD3DX12_RESOURCE_BARRIER::Transition(m_IndexBuffer.Get(), D3D12_RESOURCE_STATE_INDEX_BUFFER, D3D12_RESOURCE_STATE_COPY_DEST),
+			};
+		Utils::ResourceBarrier(commandList, 2, barriers);
+		m_InCopyState = true;
+	}
+
+	m_StagingManager.CopyToBuffer(commandList, m_VertexBuffer.Get(), baseVertex * m_VertexStride, vertices, vbByteSize);
+	m_StagingManager.CopyToBuffer(commandList, m_IndexBuffer.Get(), startIndex * sizeof(UINT32), indices, ibByteSize);
+
+	m_NumUploads++;
+	m_PerMeshBufferBytes += CommittedBufferSize(vbByteSize) + CommittedBufferSize(ibByteSize);
+
+	return range;
+}
+
+void GeometryPool::Free(const GeometryRange &range)
+{
+	m_VertexAllocator.Free(range.BaseVertex, range.VertexCount);
+	m_IndexAllocator.Free(range.StartIndex, range.IndexCount);
+}
+
+void GeometryPool::FinishUploads(GraphicsCommandList commandList)
+{
+	if (!m_InCopyState)
+		return;
+
+	D3D12_RESOURCE_BARRIER barriers[] =
+		{
+			CD3DX12_RESOURCE_BARRIER::Transition(m_VertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
+			CD3DX12_RESOURCE_BARRIER::Transition(m_IndexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER),
+		};
+	Utils::ResourceBarrier(commandList, 2, barriers);
+	m_InCopyState = false;
+}
+
+void GeometryPool::Bind(GraphicsCommandList commandList) const
+{
+	ASSERT(!m_InCopyState, "Geometry pool is bound before FinishUploads.");
+
+	commandList->IASetVertexBuffers(0, 1, &m_VertexBufferView);
+	commandList->IASetIndexBuffer(&m_IndexBufferView);
+}
+
+void GeometryPool::LogMemoryReport() const
+{
+	const double MB = 1024.0 * 1024.0;
+
+	UINT64 poolBytes = CommittedBufferSize(m_VertexBufferView.SizeInBytes) + CommittedBufferSize(m_IndexBufferView.SizeInBytes);
+	UINT64 usedBytes = m_VertexAllocator.UsedSize() * m_VertexStride + m_IndexAllocator.UsedSize() * sizeof(UINT32);
+
+	LOG_CHANNEL_INFO(Asset, "Geometry pool: {} meshes, {} vertices, {} indices ({:.2f} MB used)",
+			 m_NumUploads, m_VertexAllocator.UsedSize(), m_IndexAllocator.UsedSize(), usedBytes / MB);
+
+	// the old path kept a default and an upload buffer alive for both the vertices and indices of every mesh
+	LOG_CHANNEL_INFO(Asset, "  per-mesh buffers: {} committed resources, {:.2f} MB ({:.2f} MB of it in upload heaps)",
+			 m_NumUploads * 4, 2 * m_PerMeshBufferBytes / MB, m_PerMeshBufferBytes / MB);
+	LOG_CHANNEL_INFO(Asset, "  geometry pool:    2 committed resources, {:.2f} MB, staging recycled once the copy completes",
+			 poolBytes / MB);
+}
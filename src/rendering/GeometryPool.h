@@ -0,0 +1,53 @@
+#pragma once
+
+#include "pch.h"
+
+#include "core/RangeAllocator.h"
+#include "dx/dx.h"
+#include "dx/StagingManager.h"
+
+// Location of a mesh inside the shared vertex and index buffers.
+struct GeometryRange
+{
+	UINT BaseVertex = 0;
+	UINT VertexCount = 0;
+	UINT StartIndex = 0;
+	UINT IndexCount = 0;
+};
+
+// One large vertex buffer and one large index buffer shared by every mesh,
+// so the input assembler only has to be bound once per pass.
+class GeometryPool
+{
+public:
+	GeometryPool(Device device, StagingManager &stagingManager, UINT vertexStride, UINT maxVertices, UINT maxIndices);
+
+	GeometryRange Upload(GraphicsCommandList commandList,
+						 const void *vertices, UINT vertexCount,
+						 const UINT32 *indices, UINT indexCount);
+	void Free(const GeometryRange &range);
+
+	// transition the buffers back to vertex/index buffer states after a batch of uploads
+	void FinishUploads(GraphicsCommandList commandList);
+
+	void Bind(GraphicsCommandList commandList) const;
+
+	void LogMemoryReport() const;
+
+private:
+	StagingManager &m_StagingManager;
+
+	Resource m_VertexBuffer;
+	Resource m_IndexBuffer;
+	D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
+	D3D12_INDEX_BUFFER_VIEW m_IndexBufferView;
+	bool m_InCopyState = false;
+
+	UINT m_VertexStride;
+	RangeAllocator m_VertexAllocator;
+	RangeAllocator m_IndexAllocator;
+
+	// what the same meshes would have cost with a vertex and index buffer each
+	UINT m_NumUploads = 0;
+	UINT64 m_PerMeshBufferBytes = 0;
+};
@@ -0,0 +1,151 @@
+#include "pch.h"
+#include "GpuProfiler.h"
+
+#ifdef ENABLE_PROFILER
+
+// the GPU and CPU clocks drift apart slowly, they are sampled again every so many frames
+static const UINT CALIBRATION_INTERVAL = 128;
+
+Ref<DxContext> GpuProfiler::s_DxContext;
+ComPtr<ID3D12QueryHeap> GpuProfiler::s_QueryHeap;
+Resource GpuProfiler::s_ReadbackBuffers[NUM_FRAMES_IN_FLIGHT];
+
+std::unique_ptr<GpuTimestamps> GpuProfiler::s_Timestamps;
+std::vector<GpuScopeTiming> GpuProfiler::s_Timings;
+ProfileBuffer *GpuProfiler::s_Track = nullptr;
+GpuClock GpuProfiler::s_Clock;
+UINT GpuProfiler::s_FramesSinceCalibration = 0;
+UINT GpuProfiler::s_FrameIndex = 0;
+double GpuProfiler::s_LastFrameMs = -1.0;
+
+void GpuProfiler::Init(Ref<DxContext> dxContext)
+{
+	s_DxContext = dxContext;
+	s_Timestamps = std::make_unique<GpuTimestamps>(NUM_FRAMES_IN_FLIGHT, MAX_QUERIES_PER_FRAME);
+	s_Track = Profiler::AddTrack("GPU");
+
+	auto device = dxContext->GetDevice();
+
+	D3D12_QUERY_HEAP_DESC heapDesc = {};
+	heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	heapDesc.Count = s_Timestamps->NumQueries();
+	ThrowIfFailed(device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&s_QueryHeap)));
+
+	for (int i = 0; i < NUM_FRAMES_IN_FLIGHT; i++)
+	{
+		ThrowIfFailed(GpuMemory::CreateCommittedResource(device.Get(),
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(MAX_QUERIES_PER_FRAME * sizeof(UINT64)),
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&s_ReadbackBuffers[i])));
+	}
+
+	Calibrate();
+}
+
+void GpuProfiler::Cleanup()
+{
+	for (auto &buffer : s_ReadbackBuffers)
+		buffer = nullptr;
+	s_QueryHeap = nullptr;
+	s_Timestamps = nullptr;
+	s_DxContext = nullptr;
+}
+
+void GpuProfiler::BeginFrame(UINT frameIndex)
+{
+	if (!s_Timestamps)
+		return;
+
+	if (++s_FramesSinceCalibration >= CALIBRATION_INTERVAL)
+		Calibrate();
+
+	s_LastFrameMs = -1.0;
+
+	if (s_Timestamps->IsPending(frameIndex))
+	{
+		UINT64 *timestamps = nullptr;
+		ThrowIfFailed(s_ReadbackBuffers[frameIndex]->Map(0, &CD3DX12_RANGE(0, MAX_QUERIES_PER_FRAME * sizeof(UINT64)),
+														 reinterpret_cast<void **>(&timestamps)));
+
+		s_Timings.clear();
+		s_Timestamps->Read(frameIndex, timestamps, s_Clock, s_Timings);
+		s_ReadbackBuffers[frameIndex]->Unmap(0, &CD3DX12_RANGE(0, 0));
+
+		// gathered with the CPU scopes of the next frame
+		for (const auto &timing : s_Timings)
+		{
+			s_Track->Push(timing.Name, timing.Start, timing.End, timing.Depth);
+
+			// the scope Renderer::BeginFrame opens around everything else
+			if (timing.Depth == 0 && strcmp(timing.Name, "Frame") == 0)
+				s_LastFrameMs = Profiler::TicksToMs(timing.End - timing.Start);
+		}
+	}
+
+	s_FrameIndex = frameIndex;
+	s_Timestamps->BeginFrame(frameIndex);
+}
+
+void GpuProfiler::EndFrame(GraphicsCommandList commandList)
+{
+	if (!s_Timestamps)
+		return;
+
+	UINT firstQuery, numQueries;
+	s_Timestamps->EndFrame(firstQuery, numQueries);
+
+	if (numQueries > 0)
+		commandList->ResolveQueryData(s_QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, numQueries,
+									  s_ReadbackBuffers[s_FrameIndex].Get(), 0);
+}
+
+void GpuProfiler::BeginScope(GraphicsCommandList commandList, const char *name)
+{
+	// an event with an ANSI name (metadata 1) as PIX reads it, frame captures take their passes from it
+	commandList->BeginEvent(1, name, (UINT)strlen(name) + 1);
+
+	if (!s_Timestamps)
+		return;
+
+	UINT query = s_Timestamps->BeginScope(name);
+	if (query != GpuTimestamps::INVALID_QUERY)
+		commandList->EndQuery(s_QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void GpuProfiler::EndScope(GraphicsCommandList commandList)
+{
+	commandList->EndEvent();
+
+	if (!s_Timestamps)
+		return;
+
+	UINT query = s_Timestamps->EndScope();
+	if (query != GpuTimestamps::INVALID_QUERY)
+		commandList->EndQuery(s_QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void GpuProfiler::Calibrate()
+{
+	auto commandQueue = s_DxContext->GetCommandQueue();
+
+	UINT64 frequency = 0;
+	ThrowIfFailed(commandQueue->GetTimestampFrequency(&frequency));
+
+	// the CPU side of the sample is taken between two readings of the profiler clock
+	UINT64 gpuTimestamp = 0;
+	UINT64 cpuTimestamp = 0;
+	int64_t before = Profiler::Now();
+	ThrowIfFailed(commandQueue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp));
+	int64_t after = Profiler::Now();
+
+	s_Clock.GpuTimestamp = gpuTimestamp;
+	s_Clock.CpuTicks = before + (after - before) / 2;
+	s_Clock.CpuTicksPerGpuTick = 1.0e9 / (double)frequency / Profiler::TicksToNs(1);
+
+	s_FramesSinceCalibration = 0;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "pch.h"
+#include "dx/dx.h"
+#include "dx/DxContext.h"
+
+#ifdef ENABLE_PROFILER
+
+#include "GpuTimestamps.h"
+
+// Times render passes on the GPU with timestamp queries. The scopes show up on a "GPU" track of
+// the CPU profiler, in the same timeline as the CPU scopes but only NUM_FRAMES_IN_FLIGHT frames
+// after they were recorded, when the frame resource that resolved them comes around again.
+class GpuProfiler
+{
+public:
+	static const UINT MAX_QUERIES_PER_FRAME = 256;
+
+	static void Init(Ref<DxContext> dxContext);
+	static void Cleanup();
+
+	// reads the timestamps resolved with the frame resource and starts recording into it again,
+	// call after waiting for its fence
+	static void BeginFrame(UINT frameIndex);
+
+	// resolves the timestamps of the frame, call before the command list is executed
+	static void EndFrame(GraphicsCommandList commandList);
+
+	static void BeginScope(GraphicsCommandList commandList, const char *name);
+	static void EndScope(GraphicsCommandList commandList);
+
+	static UINT64 DroppedScopes() { return s_Timestamps ? s_Timestamps->DroppedScopes() : 0; }
+
+	// GPU time of the frame read back with the last BeginFrame, negative if none was
+	static double LastFrameMs() { return s_LastFrameMs; }
+
+private:
+	static void Calibrate();
+
+private:
+	static Ref<DxContext> s_DxContext;
+	static ComPtr<ID3D12QueryHeap> s_QueryHeap;
+	static Resource s_ReadbackBuffers[NUM_FRAMES_IN_FLIGHT];
+
+	static std::unique_ptr<GpuTimestamps> s_Timestamps;
+	static std::vector<GpuScopeTiming> s_Timings;
+	static ProfileBuffer *s_Track;
+	static GpuClock s_Clock;
+	static UINT s_FramesSinceCalibration;
+	static UINT s_FrameIndex;
+	static double s_LastFrameMs;
+};
+
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GraphicsCommandList commandList, const char *name)
+		: m_CommandList(commandList)
+	{
+		GpuProfiler::BeginScope(commandList, name);
+	}
+
+	~GpuProfileScope() { GpuProfiler::EndScope(m_CommandList); }
+
+	GpuProfileScope(const GpuProfileScope &) = delete;
+	GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+
+private:
+	GraphicsCommandList m_CommandList;
+};
+
+// the name has to outlive the profiler, see Profiler::Intern for names built at runtime
+#define PROFILE_GPU_SCOPE(commandList, name) ::GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(commandList, name)
+
+#else
+
+#define PROFILE_GPU_SCOPE(commandList, name)
+
+#endif
@@ -0,0 +1,88 @@
+#include "pch.h"
+#include "GpuTimestamps.h"
+
+#ifdef ENABLE_PROFILER
+
+GpuTimestamps::GpuTimestamps(UINT numFrames, UINT queriesPerFrame)
+	: m_NumFrames(numFrames), m_QueriesPerFrame(queriesPerFrame), m_Frames(numFrames)
+{
+}
+
+void GpuTimestamps::BeginFrame(UINT frameIndex)
+{
+	m_CurrFrame = frameIndex;
+
+	Frame &frame = m_Frames[frameIndex];
+	frame.Scopes.clear();
+	frame.NumQueries = 0;
+	frame.Pending = false;
+
+	m_OpenScopes.clear();
+}
+
+UINT GpuTimestamps::BeginScope(const char *name)
+{
+	Frame &frame = m_Frames[m_CurrFrame];
+
+	// both queries are taken at once, so that a scope that began also ends
+	if (frame.NumQueries + 2 > m_QueriesPerFrame)
+	{
+		m_OpenScopes.push_back(-1);
+		m_DroppedScopes++;
+		return INVALID_QUERY;
+	}
+
+	UINT begin = FirstQuery(m_CurrFrame) + frame.NumQueries;
+	frame.NumQueries += 2;
+
+	m_OpenScopes.push_back((int)frame.Scopes.size());
+	frame.Scopes.push_back({name, begin, INVALID_QUERY, (UINT)m_OpenScopes.size() - 1});
+	return begin;
+}
+
+UINT GpuTimestamps::EndScope()
+{
+	if (m_OpenScopes.empty())
+		return INVALID_QUERY;
+
+	int index = m_OpenScopes.back();
+	m_OpenScopes.pop_back();
+	if (index < 0)
+		return INVALID_QUERY;
+
+	Scope &scope = m_Frames[m_CurrFrame].Scopes[index];
+	scope.End = scope.Begin + 1;
+	return scope.End;
+}
+
+void GpuTimestamps::EndFrame(UINT &firstQuery, UINT &numQueries)
+{
+	Frame &frame = m_Frames[m_CurrFrame];
+	frame.Pending = frame.NumQueries > 0;
+
+	firstQuery = FirstQuery(m_CurrFrame);
+	numQueries = frame.NumQueries;
+}
+
+bool GpuTimestamps::Read(UINT frameIndex, const UINT64 *timestamps, const GpuClock &clock, std::vector<GpuScopeTiming> &timings)
+{
+	Frame &frame = m_Frames[frameIndex];
+	if (!frame.Pending)
+		return false;
+
+	UINT first = FirstQuery(frameIndex);
+	for (const Scope &scope : frame.Scopes)
+	{
+		if (scope.End == INVALID_QUERY)
+			continue;
+
+		int64_t start = clock.ToCpuTicks(timestamps[scope.Begin - first]);
+		int64_t end = clock.ToCpuTicks(timestamps[scope.End - first]);
+		timings.push_back({scope.Name, start, std::max(start, end), scope.Depth});
+	}
+
+	frame.Pending = false;
+	return true;
+}
+
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "pch.h"
+
+#ifdef ENABLE_PROFILER
+
+// Maps GPU timestamps onto the ticks of the CPU profiler, from a sample of both clocks at once.
+struct GpuClock
+{
+	UINT64 GpuTimestamp = 0;
+	int64_t CpuTicks = 0;
+	double CpuTicksPerGpuTick = 1.0;
+
+	int64_t ToCpuTicks(UINT64 gpuTimestamp) const
+	{
+		// signed, the timestamps of a frame are older than the sample they are converted with
+		return CpuTicks + (int64_t)llround((double)(int64_t)(gpuTimestamp - GpuTimestamp) * CpuTicksPerGpuTick);
+	}
+};
+
+struct GpuScopeTiming
+{
+	const char *Name;
+	int64_t Start; // in ticks of Profiler::Now
+	int64_t End;
+	UINT Depth;
+};
+
+// Hands out the timestamp queries of the frames in flight and turns the resolved timestamps back
+// into scopes. Every frame resource owns a range of the query heap, which is resolved into its own
+// readback buffer at the end of the frame and read when the frame resource comes around again,
+// NUM_FRAMES_IN_FLIGHT frames later, once its fence was waited for anyway.
+class GpuTimestamps
+{
+public:
+	static const UINT INVALID_QUERY = UINT_MAX;
+
+	GpuTimestamps(UINT numFrames, UINT queriesPerFrame);
+
+	// starts recording the scopes of a frame resource, its previous results are discarded if they
+	// have not been read
+	void BeginFrame(UINT frameIndex);
+
+	// the query to write the timestamp to, INVALID_QUERY once the frame ran out of queries
+	UINT BeginScope(const char *name);
+	UINT EndScope();
+
+	// the queries of the frame to resolve, numQueries is 0 without any scopes
+	void EndFrame(UINT &firstQuery, UINT &numQueries);
+
+	// returns false if the frame resource has no results pending, timestamps start at the first
+	// query of the frame resource; scopes still open at the end of their frame are skipped
+	bool Read(UINT frameIndex, const UINT64 *timestamps, const GpuClock &clock, std::vector<GpuScopeTiming> &timings);
+
+	bool IsPending(UINT frameIndex) const { return m_Frames[frameIndex].Pending; }
+	UINT FirstQuery(UINT frameIndex) const { return frameIndex * m_QueriesPerFrame; }
+	UINT QueriesPerFrame() const { return m_QueriesPerFrame; }
+	UINT NumQueries() const { return m_NumFrames * m_QueriesPerFrame; }
+	UINT64 DroppedScopes() const { return m_DroppedScopes; }
+
+private:
+	struct Scope
+	{
+		const char *Name;
+		UINT Begin;
+		UINT End; // INVALID_QUERY while the scope is open
+		UINT Depth;
+	};
+
+	struct Frame
+	{
+		std::vector<Scope> Scopes; // in the order they began, a scope before the ones nested in it
+		UINT NumQueries = 0;
+		bool Pending = false;
+	};
+
+private:
+	UINT m_NumFrames;
+	UINT m_QueriesPerFrame;
+
+	std::vector<Frame> m_Frames;
+	UINT m_CurrFrame = 0;
+
+	// the scopes of the current frame that are open, -1 for the ones that did not get queries
+	std::vector<int> m_OpenScopes;
+	UINT64 m_DroppedScopes = 0;
+};
+
+#endif
@@ -0,0 +1,531 @@
+#include "pch.h"
+#include "IBLBaker.h"
+
+#include "core/MathHelper.h"
+#include "core/Parallel.h"
+#include "dx/Texture.h"
+
+static const float Epsilon = 0.00001f;
+
+//
+// Sampling helpers, see utils.hlsl
+//
+
+static float RadicalInverse_VdC(UINT bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return float(bits) * 2.3283064365386963e-10f;
+}
+
+static XMFLOAT2 SampleHammersley(UINT i, float invNumSamples)
+{
+	return XMFLOAT2(i * invNumSamples, RadicalInverse_VdC(i));
+}
+
+static XMVECTOR SampleHemisphere(float u, float v)
+{
+	float phi = v * XM_2PI;
+	float cosTheta = 1.0f - u;
+	float sinTheta = sqrtf(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+	return XMVectorSet(cosf(phi) * sinTheta, sinf(phi) * sinTheta, cosTheta, 0.0f);
+}
+
+static XMVECTOR SampleGGX(float u1, float u2, float roughness)
+{
+	float alpha = roughness * roughness;
+
+	float cosTheta = sqrtf((1.0f - u2) / (1.0f + (alpha * alpha - 1.0f) * u2));
+	float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+	float phi = XM_2PI * u1;
+
+	return XMVectorSet(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta, 0.0f);
+}
+
+static float GASchlickG1(float cosTheta, float k)
+{
+	return cosTheta / (cosTheta * (1.0f - k) + k);
+}
+
+static float GASchlickGGX_IBL(float cosLi, float cosLo, float roughness)
+{
+	float k = (roughness * roughness) / 2.0f;
+	return GASchlickG1(cosLi, k) * GASchlickG1(cosLo, k);
+}
+
+static float NDFGGX(float cosLh, float roughness)
+{
+	float alpha = roughness * roughness;
+	float alphaSq = alpha * alpha;
+
+	float denom = (cosLh * cosLh) * (alphaSq - 1.0f) + 1.0f;
+	return alphaSq / (XM_PI * denom * denom);
+}
+
+static void ComputeBasisVectors(FXMVECTOR N, XMVECTOR &S, XMVECTOR &T)
+{
+	T = XMVector3Cross(N, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	if (XMVectorGetX(XMVector3LengthSq(T)) < Epsilon)
+		T = XMVector3Cross(N, XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+
+	T = XMVector3Normalize(T);
+	S = XMVector3Normalize(XMVector3Cross(N, T));
+}
+
+static XMVECTOR TangentToBasis(FXMVECTOR v, FXMVECTOR N, FXMVECTOR S, GXMVECTOR T)
+{
+	XMVECTOR result = XMVectorMultiply(XMVectorSplatX(v), S);
+	result = XMVectorMultiplyAdd(XMVectorSplatY(v), T, result);
+	return XMVectorMultiplyAdd(XMVectorSplatZ(v), N, result);
+}
+
+// GetSamplingVector in utils.hlsl, texel corners are used on purpose to match the shaders
+static XMVECTOR GetSamplingVector(UINT face, UINT x, UINT y, UINT width, UINT height)
+{
+	float u = 2.0f * (float(x) / width) - 1.0f;
+	float v = 2.0f * (1.0f - float(y) / height) - 1.0f;
+
+	XMVECTOR ret;
+	switch (face)
+	{
+	case 0: ret = XMVectorSet(1.0f, v, -u, 0.0f); break;
+	case 1: ret = XMVectorSet(-1.0f, v, u, 0.0f); break;
+	case 2: ret = XMVectorSet(u, 1.0f, -v, 0.0f); break;
+	case 3: ret = XMVectorSet(u, -1.0f, v, 0.0f); break;
+	case 4: ret = XMVectorSet(u, v, 1.0f, 0.0f); break;
+	default: ret = XMVectorSet(-u, v, -1.0f, 0.0f); break;
+	}
+	return XMVector3Normalize(ret);
+}
+
+//
+// Texture sampling, bilinear filtering with clamped face edges
+//
+
+static XMVECTOR LoadTexel(const float *data, UINT width, UINT x, UINT y)
+{
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(data + 4 * (y * width + x)));
+}
+
+static XMVECTOR SampleBilinear(const float *data, UINT width, UINT height, float s, float t, bool wrap)
+{
+	float px = s * width - 0.5f;
+	float py = t * height - 0.5f;
+
+	float fx = floorf(px);
+	float fy = floorf(py);
+
+	XMVECTOR wx = XMVectorReplicate(px - fx);
+	XMVECTOR wy = XMVectorReplicate(py - fy);
+
+	auto address = [wrap](int coord, UINT size)
+	{
+		if (wrap)
+			return UINT((coord % int(size) + int(size)) % int(size));
+		return UINT(std::clamp(coord, 0, int(size) - 1));
+	};
+
+	UINT x0 = address(int(fx), width), x1 = address(int(fx) + 1, width);
+	UINT y0 = address(int(fy), height), y1 = address(int(fy) + 1, height);
+
+	XMVECTOR top = XMVectorLerpV(LoadTexel(data, width, x0, y0), LoadTexel(data, width, x1, y0), wx);
+	XMVECTOR bottom = XMVectorLerpV(LoadTexel(data, width, x0, y1), LoadTexel(data, width, x1, y1), wx);
+	return XMVectorLerpV(top, bottom, wy);
+}
+
+// D3D cubemap face selection, the inverse of GetSamplingVector
+static UINT DirectionToFace(FXMVECTOR dir, float &s, float &t)
+{
+	XMFLOAT3 d;
+	XMStoreFloat3(&d, dir);
+
+	float ax = fabsf(d.x), ay = fabsf(d.y), az = fabsf(d.z);
+	float u, v, ma;
+	UINT face;
+
+	if (ax >= ay && ax >= az)
+	{
+		face = d.x >= 0.0f ? 0 : 1;
+		ma = ax;
+		u = d.x >= 0.0f ? -d.z : d.z;
+		v = d.y;
+	}
+	else if (ay >= az)
+	{
+		face = d.y >= 0.0f ? 2 : 3;
+		ma = ay;
+		u = d.x;
+		v = d.y >= 0.0f ? -d.z : d.z;
+	}
+	else
+	{
+		face = d.z >= 0.0f ? 4 : 5;
+		ma = az;
+		u = d.z >= 0.0f ? d.x : -d.x;
+		v = d.y;
+	}
+
+	s = 0.5f * (u / ma + 1.0f);
+	t = 0.5f * (1.0f - v / ma);
+	return face;
+}
+
+static XMVECTOR SampleCubeLevel(const TextureData &cube, UINT face, UINT level, float s, float t)
+{
+	return SampleBilinear(cube.Subresource<float>(face, level), cube.LevelWidth(level), cube.LevelHeight(level), s, t, false);
+}
+
+// trilinear sample like SampleLevel with a linear mip filter
+static XMVECTOR SampleCube(const TextureData &cube, FXMVECTOR dir, float level)
+{
+	float s, t;
+	UINT face = DirectionToFace(dir, s, t);
+
+	level = std::clamp(level, 0.0f, float(cube.Levels - 1));
+	UINT level0 = UINT(level);
+	UINT level1 = std::min(level0 + 1, cube.Levels - 1);
+
+	XMVECTOR color = SampleCubeLevel(cube, face, level0, s, t);
+	if (level1 == level0)
+		return color;
+
+	return XMVectorLerp(color, SampleCubeLevel(cube, face, level1, s, t), level - level0);
+}
+
+static TextureData CreateCubemap(UINT size, UINT levels)
+{
+	TextureData texture;
+	texture.Width = size;
+	texture.Height = size;
+	texture.ArraySize = 6;
+	texture.Levels = levels;
+	texture.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	texture.IsCubemap = true;
+	texture.Allocate();
+	return texture;
+}
+
+//
+// Baking
+//
+
+IBLProducts IBLBaker::Bake(const Image &equirect, const IBLBakeSettings &settings)
+{
+	ASSERT(equirect.IsHDR() && equirect.Channels() == 4, "IBL baking expects an RGBA HDR image.");
+
+	LOG_CHANNEL_INFO(IBL, "Baking IBL products on the CPU...");
+
+	TextureData envMap = EquirectToCubemap(equirect, settings.EnvMapSize);
+	GenerateMipmaps(envMap);
+
+	IBLProducts products;
+	products.SpecularMap = ConvertToHalf(ComputeSpecularMap(envMap, settings.SpecularSamples));
+	products.BRDFLUT = ConvertToHalf(ComputeBRDFLUT(settings.BRDFLUTSize, settings.BRDFSamples));
+	products.EnvMap = ConvertToHalf(envMap);
+
+	return products;
+}
+
+TextureData IBLBaker::EquirectToCubemap(const Image &equirect, UINT size)
+{
+	TextureData cubemap = CreateCubemap(size, Texture::NumMipmapLevels(size, size));
+
+	const float *pixels = equirect.Pixels<float>();
+
+	Parallel::For(6 * size, [&](UINT row)
+				  {
+		UINT face = row / size;
+		UINT y = row % size;
+		float *output = cubemap.Subresource<float>(face, 0) + 4 * y * size;
+
+		for (UINT x = 0; x < size; x++)
+		{
+			XMFLOAT3 v;
+			XMStoreFloat3(&v, GetSamplingVector(face, x, y, size, size));
+
+			// convert cartesian direction vector to spherical coordinates
+			float phi = atan2f(v.z, v.x);
+			float theta = acosf(v.y);
+
+			XMVECTOR color = SampleBilinear(pixels, equirect.Width(), equirect.Height(), phi / XM_2PI, theta / XM_PI, true);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4 *>(output + 4 * x), color);
+		} });
+
+	return cubemap;
+}
+
+void IBLBaker::GenerateMipmaps(TextureData &cubemap)
+{
+	for (UINT level = 1; level < cubemap.Levels; level++)
+	{
+		UINT width = cubemap.LevelWidth(level);
+		UINT height = cubemap.LevelHeight(level);
+		UINT inputWidth = cubemap.LevelWidth(level - 1);
+
+		// 2x2 box filter, see downsample_array.hlsl
+		Parallel::For(cubemap.ArraySize * height, [&](UINT row)
+					  {
+			UINT face = row / height;
+			UINT y = row % height;
+
+			const float *input = cubemap.Subresource<float>(face, level - 1);
+			float *output = cubemap.Subresource<float>(face, level) + 4 * y * width;
+
+			for (UINT x = 0; x < width; x++)
+			{
+				XMVECTOR sum = LoadTexel(input, inputWidth, 2 * x, 2 * y);
+				sum += LoadTexel(input, inputWidth, 2 * x + 1, 2 * y);
+				sum += LoadTexel(input, inputWidth, 2 * x, 2 * y + 1);
+				sum += LoadTexel(input, inputWidth, 2 * x + 1, 2 * y + 1);
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4 *>(output + 4 * x), 0.25f * sum);
+			} });
+	}
+}
+
+TextureData IBLBaker::ComputeIrradianceMap(const TextureData &envMap, UINT size, UINT numSamples)
+{
+	LOG_CHANNEL_INFO(IBL, "Computing diffuse irradiance cubemap on the CPU...");
+
+	TextureData irMap = CreateCubemap(size, 1);
+	const float invNumSamples = 1.0f / float(numSamples);
+
+	// Monte Carlo integration of hemispherical irradiance, scaled by 1/PI like the
+	// irradiance map the renderer used to sample
+	Parallel::For(6 * size * size, [&](UINT texel)
+				  {
+		UINT face = texel / (size * size);
+		UINT x = texel % size;
+		UINT y = (texel / size) % size;
+
+		XMVECTOR N = GetSamplingVector(face, x, y, size, size);
+		XMVECTOR S, T;
+		ComputeBasisVectors(N, S, T);
+
+		XMVECTOR irradiance = XMVectorZero();
+		for (UINT i = 0; i < numSamples; i++)
+		{
+			XMFLOAT2 u = SampleHammersley(i, invNumSamples);
+			XMVECTOR Li = TangentToBasis(SampleHemisphere(u.x, u.y), N, S, T);
+			float cosTheta = std::max(0.0f, XMVectorGetX(XMVector3Dot(Li, N)));
+
+			irradiance = XMVectorMultiplyAdd(SampleCube(envMap, Li, 0.0f), XMVectorReplicate(2.0f * cosTheta), irradiance);
+		}
+		irradiance = XMVectorSetW(irradiance * invNumSamples, 1.0f);
+
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4 *>(irMap.Subresource<float>(face, 0) + 4 * (y * size + x)), irradiance); });
+
+	return irMap;
+}
+
+TextureData IBLBaker::ComputeSpecularMap(const TextureData &envMap, UINT numSamples)
+{
+	LOG_CHANNEL_INFO(IBL, "Computing pre-filtered specular environment map on the CPU...");
+
+	TextureData spMap = CreateCubemap(envMap.Width, envMap.Levels);
+	const float invNumSamples = 1.0f / float(numSamples);
+
+	// the 0th mip level is a copy of the environment map
+	for (UINT face = 0; face < 6; face++)
+		memcpy(spMap.Subresource<float>(face, 0), envMap.Subresource<float>(face, 0), envMap.SubresourceSize(0));
+
+	// solid angle associated with a single cubemap texel at zero mipmap level
+	const float wt = 4.0f * XM_PI / (6 * envMap.Width * envMap.Height);
+	const float deltaRoughness = 1.0f / std::max(float(spMap.Levels - 1), 1.0f);
+
+	// see spmap.hlsl
+	for (UINT level = 1; level < spMap.Levels; level++)
+	{
+		UINT size = spMap.LevelWidth(level);
+		float roughness = level * deltaRoughness;
+
+		Parallel::For(6 * size * size, [&](UINT texel)
+					  {
+			UINT face = texel / (size * size);
+			UINT x = texel % size;
+			UINT y = (texel / size) % size;
+
+			XMVECTOR N = GetSamplingVector(face, x, y, size, size);
+			XMVECTOR V = N;
+			XMVECTOR S, T;
+			ComputeBasisVectors(N, S, T);
+
+			XMVECTOR color = XMVectorZero();
+			float weight = 0.0f;
+
+			for (UINT i = 0; i < numSamples; i++)
+			{
+				XMFLOAT2 u = SampleHammersley(i, invNumSamples);
+				XMVECTOR H = TangentToBasis(SampleGGX(u.x, u.y, roughness), N, S, T);
+				XMVECTOR L = 2.0f * XMVector3Dot(V, H) * H - V;
+
+				float NdotL = XMVectorGetX(XMVector3Dot(N, L));
+				if (NdotL > 0.0f)
+				{
+					float NdotH = std::max(XMVectorGetX(XMVector3Dot(N, H)), 0.0f);
+					float pdf = NDFGGX(NdotH, roughness) * 0.25f;
+					float ws = 1.0f / (numSamples * pdf);
+					float mipLevel = std::max(0.5f * log2f(ws / wt) + 1.0f, 0.0f);
+
+					color = XMVectorMultiplyAdd(SampleCube(envMap, L, mipLevel), XMVectorReplicate(NdotL), color);
+					weight += NdotL;
+				}
+			}
+			color = XMVectorSetW(color / weight, 1.0f);
+
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4 *>(spMap.Subresource<float>(face, level) + 4 * (y * size + x)), color); });
+	}
+
+	return spMap;
+}
+
+TextureData IBLBaker::ComputeBRDFLUT(UINT size, UINT numSamples)
+{
+	LOG_CHANNEL_INFO(IBL, "Computing BRDF 2D LUT on the CPU...");
+
+	TextureData lut;
+	lut.Width = size;
+	lut.Height = size;
+	lut.Format = DXGI_FORMAT_R32G32_FLOAT;
+	lut.Allocate();
+
+	const float invNumSamples = 1.0f / float(numSamples);
+
+	// see spbrdf.hlsl
+	Parallel::For(size, [&](UINT y)
+				  {
+		float *output = lut.Subresource<float>(0, 0) + 2 * y * size;
+		float roughness = float(y) / size;
+
+		for (UINT x = 0; x < size; x++)
+		{
+			float NdotV = std::max(float(x) / size, Epsilon);
+			XMVECTOR V = XMVectorSet(sqrtf(1.0f - NdotV * NdotV), 0.0f, NdotV, 0.0f);
+
+			float DFG1 = 0.0f;
+			float DFG2 = 0.0f;
+
+			for (UINT i = 0; i < numSamples; i++)
+			{
+				XMFLOAT2 u = SampleHammersley(i, invNumSamples);
+				XMVECTOR H = SampleGGX(u.x, u.y, roughness);
+				XMVECTOR L = 2.0f * XMVector3Dot(V, H) * H - V;
+
+				float NdotL = XMVectorGetZ(L);
+				float NdotH = XMVectorGetZ(H);
+				float VdotH = std::max(XMVectorGetX(XMVector3Dot(V, H)), 0.0f);
+
+				if (NdotL > 0.0f)
+				{
+					float G = GASchlickGGX_IBL(NdotL, NdotV, roughness);
+					float Gv = G * VdotH / (NdotH * NdotV);
+					float Fc = powf(1.0f - VdotH, 5.0f);
+
+					DFG1 += (1.0f - Fc) * Gv;
+					DFG2 += Fc * Gv;
+				}
+			}
+
+			output[2 * x + 0] = DFG1 * invNumSamples;
+			output[2 * x + 1] = DFG2 * invNumSamples;
+		} });
+
+	return lut;
+}
+
+TextureData IBLBaker::ConvertToHalf(const TextureData &texture)
+{
+	TextureData result = texture;
+	result.Data.clear();
+
+	switch (texture.Format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		result.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		break;
+	case DXGI_FORMAT_R32G32_FLOAT:
+		result.Format = DXGI_FORMAT_R16G16_FLOAT;
+		break;
+	default:
+		ASSERT(false, "Unsupported format for half conversion: {}", (int)texture.Format);
+		return texture;
+	}
+
+	result.Allocate();
+
+	size_t count = texture.Data.size() / sizeof(float);
+	XMConvertFloatToHalfStream(reinterpret_cast<HALF *>(result.Data.data()), sizeof(HALF),
+							   reinterpret_cast<const float *>(texture.Data.data()), sizeof(float), count);
+
+	return result;
+}
+
+TextureData IBLBaker::ConvertToFloat(const TextureData &texture)
+{
+	TextureData result = texture;
+	result.Data.clear();
+
+	switch (texture.Format)
+	{
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		result.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		break;
+	case DXGI_FORMAT_R16G16_FLOAT:
+		result.Format = DXGI_FORMAT_R32G32_FLOAT;
+		break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		return texture;
+	default:
+		ASSERT(false, "Unsupported format for float conversion: {}", (int)texture.Format);
+		return texture;
+	}
+
+	result.Allocate();
+
+	size_t count = texture.Data.size() / sizeof(HALF);
+	XMConvertHalfToFloatStream(reinterpret_cast<float *>(result.Data.data()), sizeof(float),
+							   reinterpret_cast<const HALF *>(texture.Data.data()), sizeof(HALF), count);
+
+	return result;
+}
+
+TextureDifference IBLBaker::Compare(const TextureData &a, const TextureData &b, float tolerance)
+{
+	TextureDifference difference;
+
+	TextureData floatA = ConvertToFloat(a);
+	TextureData floatB = ConvertToFloat(b);
+	if (floatA.Width != floatB.Width || floatA.Height != floatB.Height || floatA.ArraySize != floatB.ArraySize ||
+		floatA.Levels != floatB.Levels || floatA.Format != floatB.Format)
+		return difference;
+
+	difference.SameLayout = true;
+
+	const UINT channels = TextureData::BytesPerPixel(floatA.Format) / sizeof(float);
+	const float *dataA = reinterpret_cast<const float *>(floatA.Data.data());
+	const float *dataB = reinterpret_cast<const float *>(floatB.Data.data());
+
+	difference.NumTexels = floatA.Data.size() / sizeof(float) / channels;
+	double sum = 0.0;
+	for (size_t texel = 0; texel < difference.NumTexels; texel++)
+	{
+		float texelError = 0.0f;
+		for (UINT c = 0; c < channels; c++)
+		{
+			float x = dataA[texel * channels + c];
+			float y = dataB[texel * channels + c];
+			float error = fabsf(x - y) / std::max({fabsf(x), fabsf(y), 1.0f});
+			texelError = std::max(texelError, error);
+		}
+
+		sum += texelError;
+		difference.MaxError = std::max(difference.MaxError, texelError);
+		difference.NumOverTolerance += texelError > tolerance ? 1 : 0;
+	}
+
+	difference.MeanError = difference.NumTexels > 0 ? sum / difference.NumTexels : 0.0;
+	return difference;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "pch.h"
+
+#include "asset/Image.h"
+#include "asset/DDS.h"
+
+// Filter parameters of the image based lighting products. They mirror the texture sizes
+// in RenderingUtils and the sample counts in spmap/spbrdf.hlsl, and are part of the cache key.
+struct IBLBakeSettings
+{
+	UINT EnvMapSize = 1024;
+	UINT SpecularSamples = 1024;
+	UINT BRDFLUTSize = 256;
+	UINT BRDFSamples = 1024;
+};
+
+// How far two textures of the same layout are apart, see IBLBaker::Compare
+struct TextureDifference
+{
+	bool SameLayout = false; // size, mips, slices and channels match, nothing else is filled in otherwise
+	size_t NumTexels = 0;
+	size_t NumOverTolerance = 0;
+	float MaxError = 0.0f;
+	double MeanError = 0.0;
+};
+
+struct IBLProducts
+{
+	TextureData EnvMap;		 // RGBA cubemap with full mip chain
+	TextureData SpecularMap; // RGBA cubemap, roughness increases along the mip chain
+	TextureData BRDFLUT;	 // RG 2D texture
+};
+
+// CPU reference implementation of the IBL pre-processing compute shaders.
+// It follows the shaders step by step so its output can be used to produce the
+// IBL cache without a GPU and to validate the GPU results.
+class IBLBaker
+{
+public:
+	// all products in half float, ready to be written to the cache
+	static IBLProducts Bake(const Image &equirect, const IBLBakeSettings &settings);
+
+	static TextureData EquirectToCubemap(const Image &equirect, UINT size);
+	static void GenerateMipmaps(TextureData &cubemap);
+
+	// brute-force cosine convolution, the reference for the SH irradiance, see SphericalHarmonics
+	static TextureData ComputeIrradianceMap(const TextureData &envMap, UINT size, UINT numSamples);
+	static TextureData ComputeSpecularMap(const TextureData &envMap, UINT numSamples);
+	static TextureData ComputeBRDFLUT(UINT size, UINT numSamples);
+
+	// RGBA32F -> RGBA16F, RG32F -> RG16F
+	static TextureData ConvertToHalf(const TextureData &texture);
+	// RGBA16F -> RGBA32F, RG16F -> RG32F, float textures are returned as they are
+	static TextureData ConvertToFloat(const TextureData &texture);
+
+	// Compares every texel of every mip and slice. The error of a channel is the absolute difference
+	// below 1 and the relative one above, a texel is over the tolerance if any of its channels is.
+	// Half and float textures of the same layout compare, e.g. a GPU bake against the CPU one.
+	static TextureDifference Compare(const TextureData &a, const TextureData &b, float tolerance);
+};
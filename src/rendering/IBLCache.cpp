@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "IBLCache.h"
+
+#include <filesystem>
+#include <fstream>
+
+static const char *CACHE_DIRECTORY = "resources/cache/ibl";
+
+static const UINT64 FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+static const UINT64 FNV_PRIME = 0x100000001b3ull;
+
+static UINT64 HashBytes(UINT64 hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+std::string IBLCache::ComputeKey(const std::string &hdrFilename, const IBLBakeSettings &settings, UINT64 version)
+{
+	UINT64 hash = FNV_OFFSET_BASIS;
+
+	std::ifstream file(hdrFilename, std::ios::binary);
+	ASSERT(file.is_open(), "Failed to open {} for hashing.", hdrFilename);
+
+	std::vector<char> buffer(1 << 20);
+	while (file)
+	{
+		file.read(buffer.data(), buffer.size());
+		hash = HashBytes(hash, buffer.data(), (size_t)file.gcount());
+	}
+
+	hash = HashBytes(hash, &version, sizeof(version));
+	hash = HashBytes(hash, &settings, sizeof(settings));
+
+	char key[17];
+	snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+	return key;
+}
+
+std::string IBLCache::GetFilename(const std::string &key, const char *product)
+{
+	return std::string(CACHE_DIRECTORY) + "/" + key + "_" + product + ".dds";
+}
+
+bool IBLCache::Load(const std::string &key, IBLProducts &products)
+{
+	IBLProducts loaded;
+	if (!DDS::Load(GetFilename(key, "envmap"), loaded.EnvMap) ||
+		!DDS::Load(GetFilename(key, "specular"), loaded.SpecularMap) ||
+		!DDS::Load(GetFilename(key, "brdf"), loaded.BRDFLUT))
+		return false;
+
+	products = std::move(loaded);
+	LOG_CHANNEL_INFO(IBL, "Loaded IBL products from cache: {}", key);
+	return true;
+}
+
+bool IBLCache::Save(const std::string &key, const IBLProducts &products)
+{
+	std::error_code error;
+	std::filesystem::create_directories(CACHE_DIRECTORY, error);
+	if (error)
+	{
+		LOG_CHANNEL_WARN(IBL, "Failed to create IBL cache directory {}: {}", CACHE_DIRECTORY, error.message());
+		return false;
+	}
+
+	bool saved = DDS::Save(GetFilename(key, "envmap"), products.EnvMap) &&
+				 DDS::Save(GetFilename(key, "specular"), products.SpecularMap) &&
+				 DDS::Save(GetFilename(key, "brdf"), products.BRDFLUT);
+
+	if (saved)
+		LOG_CHANNEL_INFO(IBL, "Saved IBL products to cache: {}", key);
+	else
+		LOG_CHANNEL_WARN(IBL, "Failed to save IBL products to cache: {}", key);
+
+	return saved;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "pch.h"
+#include "IBLBaker.h"
+
+// On-disk cache of the baked IBL products. Entries live in resources/cache/ibl and are
+// keyed by a hash of the source HDR file contents and the bake settings, so editing the
+// image or changing any filter parameter produces a new entry instead of a stale hit.
+class IBLCache
+{
+public:
+	// bump when the bake or the file layout changes, old entries are simply never hit again
+	static constexpr UINT64 CACHE_VERSION = 2;
+
+	static std::string ComputeKey(const std::string &hdrFilename, const IBLBakeSettings &settings, UINT64 version = CACHE_VERSION);
+
+	static bool Load(const std::string &key, IBLProducts &products);
+	static bool Save(const std::string &key, const IBLProducts &products);
+
+private:
+	static std::string GetFilename(const std::string &key, const char *product);
+};
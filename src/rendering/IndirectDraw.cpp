@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "IndirectDraw.h"
+
+void IndirectDrawList::Build(const std::vector<Ref<RenderItem>> &renderItems, bool transparent,
+							 D3D12_GPU_VIRTUAL_ADDRESS objectCB, UINT objCBByteSize,
+							 D3D12_GPU_VIRTUAL_ADDRESS matCB, UINT matCBByteSize)
+{
+	// the submeshes of the given kind, in the order DirectDraw visits them
+	m_SubMeshes.clear();
+	for (UINT item = 0; item < (UINT)renderItems.size(); item++)
+	{
+		const auto &subMeshes = renderItems[item]->Mesh->SubMeshes();
+		for (UINT subMesh = 0; subMesh < (UINT)subMeshes.size(); subMesh++)
+		{
+			if (subMeshes[subMesh].Transparent == transparent)
+				m_SubMeshes.push_back({item, subMesh});
+		}
+	}
+
+	Build(renderItems, m_SubMeshes, objectCB, objCBByteSize, matCB, matCBByteSize);
+}
+
+void IndirectDrawList::Build(const std::vector<Ref<RenderItem>> &renderItems, const std::vector<SubMeshRef> &subMeshes,
+							 D3D12_GPU_VIRTUAL_ADDRESS objectCB, UINT objCBByteSize,
+							 D3D12_GPU_VIRTUAL_ADDRESS matCB, UINT matCBByteSize)
+{
+	Clear();
+
+	for (const auto &ref : subMeshes)
+	{
+		const auto &ritem = renderItems[ref.Item];
+		const auto &geometry = ritem->Mesh->Geometry();
+		const auto &submesh = ritem->Mesh->SubMeshes()[ref.SubMesh];
+
+		// start a new batch whenever the topology changes, items without a draw do not split one
+		if (m_Batches.empty() || m_Batches.back().PrimitiveType != ritem->PrimitiveType)
+		{
+			IndirectDrawBatch batch;
+			batch.FirstCommand = (UINT)m_Commands.size();
+			batch.PrimitiveType = ritem->PrimitiveType;
+			m_Batches.push_back(batch);
+		}
+
+		IndirectDrawCommand command;
+		command.ObjectCB = objectCB + ritem->objCBIndex * objCBByteSize;
+		command.MatCB = matCB + (submesh.MaterialIndex + ritem->matCBIndex) * matCBByteSize;
+		command.DrawArguments.IndexCountPerInstance = submesh.IndexCount;
+		command.DrawArguments.InstanceCount = 1;
+		command.DrawArguments.StartIndexLocation = geometry.StartIndex + submesh.StartIndexLocation;
+		command.DrawArguments.BaseVertexLocation = geometry.BaseVertex + submesh.BaseVertexLocation;
+		command.DrawArguments.StartInstanceLocation = 0;
+
+		m_Commands.push_back(command);
+		m_Batches.back().CommandCount++;
+	}
+
+	ASSERT(m_Commands.size() <= MAX_INDIRECT_DRAWS, "Too many indirect draws, increase MAX_INDIRECT_DRAWS.");
+}
+
+void IndirectDrawList::Clear()
+{
+	m_Commands.clear();
+	m_Batches.clear();
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "pch.h"
+
+#include "RenderItem.h"
+#include "PipelineStates.h"
+
+#define MAX_INDIRECT_DRAWS 8192
+
+// Arguments of a single draw consumed by the "draw" command signature.
+// The member order has to match the argument descs in PipelineStates::BuildCommandSignatures.
+struct IndirectDrawCommand
+{
+	D3D12_GPU_VIRTUAL_ADDRESS ObjectCB;
+	D3D12_GPU_VIRTUAL_ADDRESS MatCB;
+	D3D12_DRAW_INDEXED_ARGUMENTS DrawArguments;
+};
+
+// A run of commands sharing the same primitive topology, submitted with one ExecuteIndirect.
+// All meshes live in the geometry pool, so the input assembler does not change between batches.
+struct IndirectDrawBatch
+{
+	UINT FirstCommand = 0;
+	UINT CommandCount = 0;
+
+	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+};
+
+// A single submesh of a render item, e.g. a shadow caster that survived culling
+struct SubMeshRef
+{
+	UINT Item = 0;
+	UINT SubMesh = 0;
+};
+
+// Packs the submeshes of a list of render items into indirect draw arguments on the CPU.
+// The result issues exactly the same draws, in the same order, as Renderer::DrawRenderItems.
+class IndirectDrawList
+{
+public:
+	void Build(const std::vector<Ref<RenderItem>> &renderItems, bool transparent,
+			   D3D12_GPU_VIRTUAL_ADDRESS objectCB, UINT objCBByteSize,
+			   D3D12_GPU_VIRTUAL_ADDRESS matCB, UINT matCBByteSize);
+
+	// packs the given submeshes only, in the order they are listed
+	void Build(const std::vector<Ref<RenderItem>> &renderItems, const std::vector<SubMeshRef> &subMeshes,
+			   D3D12_GPU_VIRTUAL_ADDRESS objectCB, UINT objCBByteSize,
+			   D3D12_GPU_VIRTUAL_ADDRESS matCB, UINT matCBByteSize);
+
+	void Clear();
+
+	const std::vector<IndirectDrawCommand> &Commands() const { return m_Commands; }
+	const std::vector<IndirectDrawBatch> &Batches() const { return m_Batches; }
+
+private:
+	std::vector<IndirectDrawCommand> m_Commands;
+	std::vector<IndirectDrawBatch> m_Batches;
+
+	// the submeshes the first Build packs, kept to reuse its allocation
+	std::vector<SubMeshRef> m_SubMeshes;
+};
+
+// The draws an IndirectDrawList stands in for, issued one call at a time: the object constants and
+// the topology per render item, the material constants and the draw per submesh. Renderer draws
+// this way with indirect draws turned off. The command list is a template parameter so the checks
+// can record the calls without a device.
+class DirectDraw
+{
+public:
+	template <typename CommandList>
+	static void Draw(CommandList &commandList, const std::vector<Ref<RenderItem>> &renderItems, bool transparent,
+					 D3D12_GPU_VIRTUAL_ADDRESS objectCB, UINT objCBByteSize,
+					 D3D12_GPU_VIRTUAL_ADDRESS matCB, UINT matCBByteSize)
+	{
+		for (auto &ritem : renderItems)
+		{
+			commandList.SetGraphicsRootConstantBufferView((UINT)RootParam::ObjectCB, objectCB + ritem->objCBIndex * objCBByteSize);
+			commandList.IASetPrimitiveTopology(ritem->PrimitiveType);
+
+			const auto &geometry = ritem->Mesh->Geometry();
+			for (const auto &submesh : ritem->Mesh->SubMeshes())
+			{
+				if (submesh.Transparent != transparent)
+					continue;
+
+				commandList.SetGraphicsRootConstantBufferView((UINT)RootParam::MatCB, matCB + (submesh.MaterialIndex + ritem->matCBIndex) * matCBByteSize);
+				COUNTER_ADD("Draw Calls", 1);
+				COUNTER_ADD("Triangles", submesh.IndexCount / 3);
+				commandList.DrawIndexedInstanced(submesh.IndexCount, 1,
+												 geometry.StartIndex + submesh.StartIndexLocation,
+												 geometry.BaseVertex + submesh.BaseVertexLocation, 0);
+			}
+		}
+	}
+
+	// draws the given submeshes only, in the order they are listed
+	template <typename CommandList>
+	static void Draw(CommandList &commandList, const std::vector<Ref<RenderItem>> &renderItems, const std::vector<SubMeshRef> &subMeshes,
+					 D3D12_GPU_VIRTUAL_ADDRESS objectCB, UINT objCBByteSize,
+					 D3D12_GPU_VIRTUAL_ADDRESS matCB, UINT matCBByteSize)
+	{
+		for (const auto &ref : subMeshes)
+		{
+			const auto &ritem = renderItems[ref.Item];
+			const auto &geometry = ritem->Mesh->Geometry();
+			const auto &submesh = ritem->Mesh->SubMeshes()[ref.SubMesh];
+
+			commandList.SetGraphicsRootConstantBufferView((UINT)RootParam::ObjectCB, objectCB + ritem->objCBIndex * objCBByteSize);
+			commandList.SetGraphicsRootConstantBufferView((UINT)RootParam::MatCB, matCB + (submesh.MaterialIndex + ritem->matCBIndex) * matCBByteSize);
+			commandList.IASetPrimitiveTopology(ritem->PrimitiveType);
+			COUNTER_ADD("Draw Calls", 1);
+			COUNTER_ADD("Triangles", submesh.IndexCount / 3);
+			commandList.DrawIndexedInstanced(submesh.IndexCount, 1,
+											 geometry.StartIndex + submesh.StartIndexLocation,
+											 geometry.BaseVertex + submesh.BaseVertexLocation, 0);
+		}
+	}
+};
@@ -4,6 +4,8 @@
 #include <filesystem>
 #include <assimp/GltfMaterial.h>
 
+#include "core/Parallel.h"
+
 struct LogStream : public Assimp::LogStream
 {
 	static void initialize()
@@ -16,12 +18,14 @@ struct LogStream : public Assimp::LogStream
 
 	void write(const char* message) override
 	{
-		LOG_WARN("Assimp: {}", message);
+		LOG_CHANNEL_WARN(Asset, "Assimp: {}", message);
 	}
 };
 
 Ref<Mesh> Mesh::FromFile(const std::string& filename)
 {
+	PROFILE_FUNCTION();
+
 	LogStream::initialize();
 	Ref<Mesh> mesh = make_ref<Mesh>();
 
@@ -34,7 +38,7 @@ Ref<Mesh> Mesh::FromFile(const std::string& filename)
 
 	if (std::filesystem::exists(exportPath) && std::filesystem::is_regular_file(exportPath))
 	{
-		LOG_INFO("Loading scene: {}", exportPath.string());
+		LOG_CHANNEL_INFO(Asset, "Loading scene: {}", exportPath.string());
 		scene = importer.ReadFile(exportPath.string(), 0);
 	}
 	else
@@ -51,13 +55,13 @@ Ref<Mesh> Mesh::FromFile(const std::string& filename)
 			aiProcess_JoinIdenticalVertices |
 			aiProcess_ValidateDataStructure;
 
-		LOG_INFO("Loading scene: {}", filename);
+		LOG_CHANNEL_INFO(Asset, "Loading scene: {}", filename);
 		scene = importer.ReadFile(filename, ImportFlags);
 
 		if (scene)
 		{
 			Assimp::Exporter exporter;
-			LOG_INFO("Exporting processed scene: {}", exportPath.string());
+			LOG_CHANNEL_INFO(Asset, "Exporting processed scene: {}", exportPath.string());
 			exporter.Export(scene, "assbin", exportPath.string(), 0);
 		}
 	}
@@ -68,58 +72,78 @@ Ref<Mesh> Mesh::FromFile(const std::string& filename)
 	return mesh;
 }
 
-void Mesh::UploadVertexAndIndexBufferToGPU(Device device, GraphicsCommandList commandList)
+void Mesh::UploadToGeometryPool(GeometryPool& geometryPool, GraphicsCommandList commandList)
 {
-	const UINT vbByteSize = m_Vertices.size() * sizeof(Mesh::Vertex);
-	const UINT ibByteSize = m_Indices.size() * sizeof(Mesh::Index);
-
-	m_VertexBufferGPU = Utils::CreateDefaultBuffer(
-		device, commandList, m_Vertices.data(), vbByteSize, m_VertexBufferUploader);
-
-	m_VertexBufferView.BufferLocation = m_VertexBufferGPU->GetGPUVirtualAddress();
-	m_VertexBufferView.SizeInBytes = vbByteSize;
-	m_VertexBufferView.StrideInBytes = sizeof(Mesh::Vertex);
-
-	m_IndexBufferGPU = Utils::CreateDefaultBuffer(
-		device, commandList, m_Indices.data(), ibByteSize, m_IndexBufferUploader);
-
-	m_IndexBufferView.BufferLocation = m_IndexBufferGPU->GetGPUVirtualAddress();
-	m_IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-	m_IndexBufferView.SizeInBytes = ibByteSize;
+	m_Geometry = geometryPool.Upload(commandList,
+		m_Vertices.data(), (UINT)m_Vertices.size(),
+		m_Indices.data(), (UINT)m_Indices.size());
 }
 
-void Mesh::LoadTextures(Device device, GraphicsCommandList commandList, DescriptorHeap& srvHeap)
+void Mesh::LoadTextures(Device device, GraphicsCommandList commandList, StagingManager& stagingManager, DescriptorHeap& srvHeap)
 {
-	for (auto& material : m_Materials)
+	PROFILE_FUNCTION();
+
+	GpuMemoryScope memoryScope(GpuMemoryCategory::Texture);
+
+	for (UINT i = 0; i < m_Materials.size(); i++)
 	{
+		auto& material = m_Materials[i];
+
 		if (material.HasAlbedoTexture)
 		{
-			material.AlbedoTexture = Texture::Create(device, commandList, Image::FromFile(material.AlbedoFilename), DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, 1);
+			material.AlbedoTexture = Texture::Create(device, commandList, stagingManager, TakeImage(i, 0, material.AlbedoFilename), DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, 1);
 			material.AlbedoTexture.Srv = srvHeap.Alloc();
 			material.AlbedoTexture.CreateSrv(device, D3D12_SRV_DIMENSION_TEXTURE2D, 0, 1);
 		}
 
 		if (material.HasNormalTexture)
 		{
-			material.NormalTexture = Texture::Create(device, commandList, Image::FromFile(material.NormalFilename), DXGI_FORMAT_R8G8B8A8_UNORM, 1);
+			material.NormalTexture = Texture::Create(device, commandList, stagingManager, TakeImage(i, 1, material.NormalFilename), DXGI_FORMAT_R8G8B8A8_UNORM, 1);
 			material.NormalTexture.Srv = srvHeap.Alloc();
 			material.NormalTexture.CreateSrv(device, D3D12_SRV_DIMENSION_TEXTURE2D, 0, 1);
 		}
 
 		if (material.HasMetalnessTexture)
 		{
-			material.MetalnessTexture = Texture::Create(device, commandList, Image::FromFile(material.MetalnessFilename), DXGI_FORMAT_R8G8B8A8_UNORM, 1);
+			material.MetalnessTexture = Texture::Create(device, commandList, stagingManager, TakeImage(i, 2, material.MetalnessFilename), DXGI_FORMAT_R8G8B8A8_UNORM, 1);
 			material.MetalnessTexture.Srv = srvHeap.Alloc();
 			material.MetalnessTexture.CreateSrv(device, D3D12_SRV_DIMENSION_TEXTURE2D, 0, 1);
 		}
 
 		if (material.HasRoughnessTexture)
 		{
-			material.RoughnessTexture = Texture::Create(device, commandList, Image::FromFile(material.RoughnessFilename), DXGI_FORMAT_R8G8B8A8_UNORM, 1);
+			material.RoughnessTexture = Texture::Create(device, commandList, stagingManager, TakeImage(i, 3, material.RoughnessFilename), DXGI_FORMAT_R8G8B8A8_UNORM, 1);
 			material.RoughnessTexture.Srv = srvHeap.Alloc();
 			material.RoughnessTexture.CreateSrv(device, D3D12_SRV_DIMENSION_TEXTURE2D, 0, 1);
 		}
 	}
+
+	m_Images.clear();
+}
+
+void Mesh::DecodeTextures()
+{
+	PROFILE_FUNCTION();
+
+	m_Images.assign(m_Materials.size() * TEXTURES_PER_MATERIAL, nullptr);
+
+	Parallel::For((UINT)m_Images.size(), [&](UINT i)
+	{
+		const auto& material = m_Materials[i / TEXTURES_PER_MATERIAL];
+		const BOOL hasTexture[] = {material.HasAlbedoTexture, material.HasNormalTexture, material.HasMetalnessTexture, material.HasRoughnessTexture};
+		const std::string* filenames[] = {&material.AlbedoFilename, &material.NormalFilename, &material.MetalnessFilename, &material.RoughnessFilename};
+
+		if (hasTexture[i % TEXTURES_PER_MATERIAL])
+			m_Images[i] = Image::FromFile(*filenames[i % TEXTURES_PER_MATERIAL]);
+	});
+}
+
+Ref<Image> Mesh::TakeImage(UINT materialIndex, UINT texture, const std::string& filename)
+{
+	UINT i = materialIndex * TEXTURES_PER_MATERIAL + texture;
+	if (i < m_Images.size() && m_Images[i])
+		return std::move(m_Images[i]);
+	return Image::FromFile(filename);
 }
 
 void Mesh::InitFromScene(const aiScene* scene, const std::string& filename)
@@ -10,6 +10,7 @@
 #include <assimp/LogStream.hpp>
 
 #include "Material.h"
+#include "GeometryPool.h"
 #include "dx/dx.h"
 #include "dx/DescriptorHeap.h"
 #include "dx/Utils.h"
@@ -49,17 +50,24 @@ public:
 	std::vector<SubMesh>& SubMeshes() { return m_SubMeshes; }
 	std::vector<Material>& Materials() { return m_Materials; }
 
-	D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const { return m_VertexBufferView; }
-	D3D12_INDEX_BUFFER_VIEW IndexBufferView() const { return m_IndexBufferView; }
+	// submesh locations are relative to this range of the geometry pool
+	const GeometryRange& Geometry() const { return m_Geometry; }
+	void SetGeometry(const GeometryRange& geometry) { m_Geometry = geometry; }
 
-	void UploadVertexAndIndexBufferToGPU(Device device, GraphicsCommandList commandList);
-	void LoadTextures(Device device, GraphicsCommandList commandList, DescriptorHeap& srvHeap);
+	void UploadToGeometryPool(GeometryPool& geometryPool, GraphicsCommandList commandList);
+	void LoadTextures(Device device, GraphicsCommandList commandList, StagingManager& stagingManager, DescriptorHeap& srvHeap);
+
+	// reads the images of the materials ahead of LoadTextures, on all threads
+	void DecodeTextures();
 
 private:
 	void InitFromScene(const aiScene* scene, const std::string& filename);
 	void InitSubMesh(unsigned int index, const aiMesh* mesh, const aiMaterial* material);
 	void InitMaterials(const aiScene* scene, const std::string& filename);
 
+	// the decoded image of a texture of a material, read now if DecodeTextures did not
+	Ref<Image> TakeImage(UINT materialIndex, UINT texture, const std::string& filename);
+
 private:
 	std::vector<SubMesh> m_SubMeshes;
 	std::vector<Material> m_Materials;
@@ -67,12 +75,9 @@ private:
 	std::vector<Vertex> m_Vertices;
 	std::vector<Index> m_Indices;
 
-	Resource m_VertexBufferGPU = nullptr;
-	Resource m_IndexBufferGPU = nullptr;
-
-	Resource m_VertexBufferUploader = nullptr;
-	Resource m_IndexBufferUploader = nullptr;
+	GeometryRange m_Geometry;
 
-	D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
-	D3D12_INDEX_BUFFER_VIEW m_IndexBufferView;
+	// albedo, normal, metalness and roughness of every material, until they are uploaded
+	static constexpr UINT TEXTURES_PER_MATERIAL = 4;
+	std::vector<Ref<Image>> m_Images;
 };
\ No newline at end of file
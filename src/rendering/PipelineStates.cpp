@@ -1,19 +1,43 @@
 #include "PipelineStates.h"
 #include "dx/Utils.h"
+#include "IndirectDraw.h"
+#include "core/Parallel.h"
 
 RootSignature PipelineStates::m_RootSignature = nullptr;
 std::unordered_map<std::string, PipelineState> PipelineStates::m_PSOs;
+std::unordered_map<std::string, CommandSignature> PipelineStates::m_CommandSignatures;
+ID3D12GraphicsCommandList *PipelineStates::m_LastCommandList = nullptr;
+ID3D12PipelineState *PipelineStates::m_LastPSO = nullptr;
 
 void PipelineStates::Init(Device device)
 {
     BuildRootSignature(device);
     BuildPSOs(device);
+    BuildCommandSignatures(device);
 }
 
 void PipelineStates::Cleanup()
 {
     m_RootSignature = nullptr;
     m_PSOs.clear();
+    m_CommandSignatures.clear();
+}
+
+void PipelineStates::SetPSO(GraphicsCommandList commandList, ID3D12PipelineState *pso)
+{
+    // the state is set either way, ImGui binds a state of its own on the same command list
+    if (commandList.Get() != m_LastCommandList || pso != m_LastPSO)
+        COUNTER_ADD("PSO Switches", 1);
+    commandList->SetPipelineState(pso);
+
+    m_LastCommandList = commandList.Get();
+    m_LastPSO = pso;
+}
+
+void PipelineStates::ResetLastPSO()
+{
+    m_LastCommandList = nullptr;
+    m_LastPSO = nullptr;
 }
 
 void PipelineStates::BuildRootSignature(Device device)
@@ -67,10 +91,22 @@ void PipelineStates::BuildPSOs(Device device)
     graphicsDesc.DSVFormat = DEPTH_STENCIL_FORMAT;
     graphicsDesc.pRootSignature = m_RootSignature.Get();
 
+    // every state is compiled and created on its own thread, the map is only locked to find its slot,
+    // which stays where it is when the map grows
+    std::mutex mutex;
+    auto slot = [&](const std::string &name) -> PipelineState &
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return m_PSOs[name];
+    };
+
+    std::vector<std::function<void()>> builds;
+
     // skybox PSO
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\skybox.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\skybox.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::SkyboxVS);
+        Shader PS = Utils::CompileShader(ShaderTable::SkyboxPS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.InputLayout = {skyBoxInputLayout.data(), (UINT)skyBoxInputLayout.size()};
@@ -84,12 +120,13 @@ void PipelineStates::BuildPSOs(Device device)
         // if the depth buffer was cleared to 1 and the depth function is LESS
         desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["skybox"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("skybox"))));
+    });
 
     // shadow pass
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\shadow.hlsl", nullptr, L"VS", L"vs_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::ShadowVS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.InputLayout = {defaultInputLayout.data(), (UINT)defaultInputLayout.size()};
@@ -102,13 +139,14 @@ void PipelineStates::BuildPSOs(Device device)
         desc.NumRenderTargets = 0;
         desc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["shadow"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("shadow"))));
+    });
 
     // gbuffer pass
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\gbuffer.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\gbuffer.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::GBufferVS);
+        Shader PS = Utils::CompileShader(ShaderTable::GBufferPS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.InputLayout = {defaultInputLayout.data(), (UINT)defaultInputLayout.size()};
@@ -123,13 +161,14 @@ void PipelineStates::BuildPSOs(Device device)
         desc.RTVFormats[4] = GBUFFER_AMBIENT_FORMAT;
         desc.RTVFormats[5] = GBUFFER_VELOCITY_FORMAT;
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["gbuffer"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("gbuffer"))));
+    });
 
     // deferred lighting pass
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\deferredLighting.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\deferredLighting.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::DeferredLightingVS);
+        Shader PS = Utils::CompileShader(ShaderTable::DeferredLightingPS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.VS = CD3DX12_SHADER_BYTECODE(VS->GetBufferPointer(), VS->GetBufferSize());
@@ -138,13 +177,14 @@ void PipelineStates::BuildPSOs(Device device)
         desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
         desc.DepthStencilState.DepthEnable = false;
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["deferredLighting"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("deferredLighting"))));
+    });
 
     // taa
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\taa.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\taa.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::TaaVS);
+        Shader PS = Utils::CompileShader(ShaderTable::TaaPS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -152,13 +192,14 @@ void PipelineStates::BuildPSOs(Device device)
         desc.VS = CD3DX12_SHADER_BYTECODE(VS->GetBufferPointer(), VS->GetBufferSize());
         desc.PS = CD3DX12_SHADER_BYTECODE(PS->GetBufferPointer(), PS->GetBufferSize());
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["taa"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("taa"))));
+    });
 
     // fxaa
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\fxaa.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\fxaa.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::FxaaVS);
+        Shader PS = Utils::CompileShader(ShaderTable::FxaaPS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -166,13 +207,14 @@ void PipelineStates::BuildPSOs(Device device)
         desc.VS = CD3DX12_SHADER_BYTECODE(VS->GetBufferPointer(), VS->GetBufferSize());
         desc.PS = CD3DX12_SHADER_BYTECODE(PS->GetBufferPointer(), PS->GetBufferSize());
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["fxaa"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("fxaa"))));
+    });
 
     // motion blur
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\motionBlur.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\motionBlur.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::MotionBlurVS);
+        Shader PS = Utils::CompileShader(ShaderTable::MotionBlurPS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -180,13 +222,14 @@ void PipelineStates::BuildPSOs(Device device)
         desc.VS = CD3DX12_SHADER_BYTECODE(VS->GetBufferPointer(), VS->GetBufferSize());
         desc.PS = CD3DX12_SHADER_BYTECODE(PS->GetBufferPointer(), PS->GetBufferSize());
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["motionBlur"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("motionBlur"))));
+    });
 
     // tone mapping
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\toneMapping.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\toneMapping.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::ToneMappingVS);
+        Shader PS = Utils::CompileShader(ShaderTable::ToneMappingPS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -194,24 +237,48 @@ void PipelineStates::BuildPSOs(Device device)
         desc.VS = CD3DX12_SHADER_BYTECODE(VS->GetBufferPointer(), VS->GetBufferSize());
         desc.PS = CD3DX12_SHADER_BYTECODE(PS->GetBufferPointer(), PS->GetBufferSize());
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["toneMapping"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("toneMapping"))));
+    });
 
     // clear voxel
+    builds.push_back([&]()
     {
-        Shader CS = Utils::CompileShader(L"shaders\\clearVoxel.hlsl", nullptr, L"main", L"cs_6_6");
+        Shader CS = Utils::CompileShader(ShaderTable::ClearVoxelCS);
 
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
         desc.pRootSignature = m_RootSignature.Get();
         desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
-        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_PSOs["clearVoxel"])));
-    }
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("clearVoxel"))));
+    });
+
+    // clear voxel texture
+    builds.push_back([&]()
+    {
+        Shader CS = Utils::CompileShader(ShaderTable::ClearVoxelTextureCS);
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
+        desc.pRootSignature = m_RootSignature.Get();
+        desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("clearVoxelTexture"))));
+    });
+
+    // begin voxel update
+    builds.push_back([&]()
+    {
+        Shader CS = Utils::CompileShader(ShaderTable::VoxelBeginUpdateCS);
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
+        desc.pRootSignature = m_RootSignature.Get();
+        desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("voxelBeginUpdate"))));
+    });
 
     // voxelize
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\voxelize.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader GS = Utils::CompileShader(L"shaders\\voxelize.hlsl", nullptr, L"GS", L"gs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\voxelize.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::VoxelizeVS);
+        Shader GS = Utils::CompileShader(ShaderTable::VoxelizeGS);
+        Shader PS = Utils::CompileShader(ShaderTable::VoxelizePS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON;
@@ -225,24 +292,59 @@ void PipelineStates::BuildPSOs(Device device)
         desc.GS = CD3DX12_SHADER_BYTECODE(GS->GetBufferPointer(), GS->GetBufferSize());
         desc.PS = CD3DX12_SHADER_BYTECODE(PS->GetBufferPointer(), PS->GetBufferSize());
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["voxelize"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("voxelize"))));
+    });
+
+    // voxelize into a clipmap level
+    builds.push_back([&]()
+    {
+        Shader VS = Utils::CompileShader(ShaderTable::VoxelizeClipmapVS);
+        Shader GS = Utils::CompileShader(ShaderTable::VoxelizeClipmapGS);
+        Shader PS = Utils::CompileShader(ShaderTable::VoxelizeClipmapPS);
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
+        desc.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON;
+        desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+        desc.DepthStencilState.DepthEnable = false;
+        desc.DSVFormat = DXGI_FORMAT_UNKNOWN;
+        desc.NumRenderTargets = 0;
+        desc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+        desc.InputLayout = {defaultInputLayout.data(), (UINT)defaultInputLayout.size()};
+        desc.VS = CD3DX12_SHADER_BYTECODE(VS->GetBufferPointer(), VS->GetBufferSize());
+        desc.GS = CD3DX12_SHADER_BYTECODE(GS->GetBufferPointer(), GS->GetBufferSize());
+        desc.PS = CD3DX12_SHADER_BYTECODE(PS->GetBufferPointer(), PS->GetBufferSize());
+
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("voxelizeClipmap"))));
+    });
 
     // voxel buffer to texture 3d
+    builds.push_back([&]()
     {
-        Shader CS = Utils::CompileShader(L"shaders\\voxelBuffer2Tex.hlsl", nullptr, L"main", L"cs_6_6");
+        Shader CS = Utils::CompileShader(ShaderTable::VoxelBuffer2TexCS);
 
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
         desc.pRootSignature = m_RootSignature.Get();
         desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
-        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_PSOs["voxelBuffer2Tex"])));
-    }
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("voxelBuffer2Tex"))));
+    });
+
+    // clipmap voxel buffer to texture 3d
+    builds.push_back([&]()
+    {
+        Shader CS = Utils::CompileShader(ShaderTable::VoxelClipmapBuffer2TexCS);
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
+        desc.pRootSignature = m_RootSignature.Get();
+        desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("voxelClipmapBuffer2Tex"))));
+    });
 
     // voxel debug
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\voxelDebug.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader GS = Utils::CompileShader(L"shaders\\voxelDebug.hlsl", nullptr, L"GS", L"gs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\voxelDebug.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::VoxelDebugVS);
+        Shader GS = Utils::CompileShader(ShaderTable::VoxelDebugGS);
+        Shader PS = Utils::CompileShader(ShaderTable::VoxelDebugPS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -252,71 +354,84 @@ void PipelineStates::BuildPSOs(Device device)
         desc.GS = CD3DX12_SHADER_BYTECODE(GS->GetBufferPointer(), GS->GetBufferSize());
         desc.PS = CD3DX12_SHADER_BYTECODE(PS->GetBufferPointer(), PS->GetBufferSize());
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["voxelDebug"])));
-    }
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("voxelDebug"))));
+    });
 
     // generate voxel mipmap
+    builds.push_back([&]()
     {
-        Shader CS = Utils::CompileShader(L"shaders\\voxelMipmap.hlsl", nullptr, L"main", L"cs_6_6");
+        Shader CS = Utils::CompileShader(ShaderTable::VoxelMipmapCS);
 
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
         desc.pRootSignature = m_RootSignature.Get();
         desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
-        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_PSOs["voxelMipmap"])));
-    }
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("voxelMipmap"))));
+    });
 
     // voxel second bounce
+    builds.push_back([&]()
     {
-        Shader CS = Utils::CompileShader(L"shaders\\voxelSecondBounce.hlsl", nullptr, L"main", L"cs_6_6");
+        Shader CS = Utils::CompileShader(ShaderTable::VoxelSecondBounceCS);
 
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
         desc.pRootSignature = m_RootSignature.Get();
         desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
-        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_PSOs["voxelSecondBounce"])));
-    }
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("voxelSecondBounce"))));
+    });
+
+    // view depth range of the visible pixels, the shadow cascades are fitted to it
+    builds.push_back([&]()
+    {
+        Shader CS = Utils::CompileShader(ShaderTable::DepthReductionCS);
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
+        desc.pRootSignature = m_RootSignature.Get();
+        desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("depthReduction"))));
+    });
 
     // equirect to cubemap
+    builds.push_back([&]()
     {
-        Shader CS = Utils::CompileShader(L"shaders\\equirect2Cube.hlsl", nullptr, L"main", L"cs_6_6");
+        Shader CS = Utils::CompileShader(ShaderTable::Equirect2CubeCS);
 
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
         desc.pRootSignature = m_RootSignature.Get();
         desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
-        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_PSOs["equirect2Cube"])));
-    }
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("equirect2Cube"))));
+    });
 
     // ibl
+    builds.push_back([&]()
     {
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
         desc.pRootSignature = m_RootSignature.Get();
 
-        Shader CS = Utils::CompileShader(L"shaders\\irmap.hlsl", nullptr, L"main", L"cs_6_6");
+        Shader CS = Utils::CompileShader(ShaderTable::SpMapCS);
         desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
-        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_PSOs["irmap"])));
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("spmap"))));
 
-        CS = Utils::CompileShader(L"shaders\\spmap.hlsl", nullptr, L"main", L"cs_6_6");
+        CS = Utils::CompileShader(ShaderTable::SpBRDFCS);
         desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
-        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_PSOs["spmap"])));
-
-        CS = Utils::CompileShader(L"shaders\\spbrdf.hlsl", nullptr, L"main", L"cs_6_6");
-        desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
-        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_PSOs["spbrdf"])));
-    }
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("spbrdf"))));
+    });
 
     // mipmap
+    builds.push_back([&]()
     {
-        Shader CS = Utils::CompileShader(L"shaders\\downsample_array.hlsl", nullptr, L"downsample_linear", L"cs_6_6");
+        Shader CS = Utils::CompileShader(ShaderTable::MipmapCS);
 
         D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
         desc.pRootSignature = m_RootSignature.Get();
         desc.CS = CD3DX12_SHADER_BYTECODE(CS->GetBufferPointer(), CS->GetBufferSize());
-        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_PSOs["mipmap"])));
-    }
+        ThrowIfFailed(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&slot("mipmap"))));
+    });
 
     // debug texture
+    builds.push_back([&]()
     {
-        Shader VS = Utils::CompileShader(L"shaders\\debug.hlsl", nullptr, L"VS", L"vs_6_6");
-        Shader PS = Utils::CompileShader(L"shaders\\debug.hlsl", nullptr, L"PS", L"ps_6_6");
+        Shader VS = Utils::CompileShader(ShaderTable::DebugVS);
+        Shader PS = Utils::CompileShader(ShaderTable::DebugPS);
 
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = graphicsDesc;
         desc.VS = CD3DX12_SHADER_BYTECODE(VS->GetBufferPointer(), VS->GetBufferSize());
@@ -325,7 +440,29 @@ void PipelineStates::BuildPSOs(Device device)
         desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
         desc.DepthStencilState.DepthEnable = false;
 
-        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&m_PSOs["debug"])));
+        ThrowIfFailed(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&slot("debug"))));
+    });
+
+    Parallel::For((UINT)builds.size(), [&](UINT i) { builds[i](); });
+}
+
+void PipelineStates::BuildCommandSignatures(Device device)
+{
+    // draw: per-draw object/material constant buffers followed by an indexed draw, see IndirectDrawCommand
+    {
+        D3D12_INDIRECT_ARGUMENT_DESC arguments[3] = {};
+        arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+        arguments[0].ConstantBufferView.RootParameterIndex = (UINT)RootParam::ObjectCB;
+        arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+        arguments[1].ConstantBufferView.RootParameterIndex = (UINT)RootParam::MatCB;
+        arguments[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+        D3D12_COMMAND_SIGNATURE_DESC desc = {};
+        desc.ByteStride = sizeof(IndirectDrawCommand);
+        desc.NumArgumentDescs = _countof(arguments);
+        desc.pArgumentDescs = arguments;
+
+        ThrowIfFailed(device->CreateCommandSignature(&desc, m_RootSignature.Get(), IID_PPV_ARGS(&m_CommandSignatures["draw"])));
     }
 }
 
@@ -34,14 +34,28 @@ public:
     static void Cleanup();
 
     static ID3D12RootSignature *GetRootSignature() { return m_RootSignature.Get(); }
+
     static ID3D12PipelineState *GetPSO(const std::string &name) { return m_PSOs[name].Get(); }
 
+    // Sets the state on the command list and counts a PSO switch when it differs from the state set
+    // on it last. ResetLastPSO forgets that state, for a command list that starts a new recording.
+    static void SetPSO(GraphicsCommandList commandList, ID3D12PipelineState *pso);
+    static void SetPSO(GraphicsCommandList commandList, const std::string &name) { SetPSO(commandList, GetPSO(name)); }
+    static void ResetLastPSO();
+
+    static ID3D12CommandSignature *GetCommandSignature(const std::string &name) { return m_CommandSignatures[name].Get(); }
+
 private:
     static void BuildRootSignature(Device device);
     static void BuildPSOs(Device device);
+    static void BuildCommandSignatures(Device device);
     static std::vector<CD3DX12_STATIC_SAMPLER_DESC> GetStaticSamplers();
 
 private:
     static RootSignature m_RootSignature;
     static std::unordered_map<std::string, PipelineState> m_PSOs;
+    static std::unordered_map<std::string, CommandSignature> m_CommandSignatures;
+
+    static ID3D12GraphicsCommandList *m_LastCommandList;
+    static ID3D12PipelineState *m_LastPSO;
 };
\ No newline at end of file
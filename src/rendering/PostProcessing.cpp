@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "PostProcessing.h"
 #include "PipelineStates.h"
+#include "GpuProfiler.h"
+#include "dx/Utils.h"
 #include "RenderingSettings.h"
 
 #include "rendering/RenderingSettings.h"
@@ -10,6 +12,8 @@ extern RenderingSettings g_RenderingSettings;
 PostProcessing::PostProcessing(Ref<DxContext> dxContext, UINT width, UINT height)
 	: m_Device(dxContext->GetDevice()), m_Width(width), m_Height(height)
 {
+	GpuMemoryScope memoryScope(GpuMemoryCategory::RenderTarget);
+
 	for (int i = 0; i < 2; i++)
 	{
 		m_Textures[i] = Texture::Create(m_Device, width, height, 1, BACK_BUFFER_FORMAT, 1);
@@ -37,10 +41,13 @@ void PostProcessing::OnResize(UINT width, UINT height)
 
 void PostProcessing::Render(GraphicsCommandList commandList, Texture &backBuffer, Texture &velocityBuffer)
 {
+	PROFILE_FUNCTION();
+	PROFILE_GPU_SCOPE(commandList, "PostProcessing");
+
 	m_CurrTexture = -1;
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON));
 
 	if (g_RenderingSettings.EnableMotionBlur)
 	{
@@ -63,18 +70,20 @@ void PostProcessing::Render(GraphicsCommandList commandList, Texture &backBuffer
 
 void PostProcessing::Pass(GraphicsCommandList commandList, Texture &backBuffer, const std::string &passName, UINT *addtionalResources, UINT numResources)
 {
+	PROFILE_GPU_SCOPE(commandList, Profiler::Intern(passName));
+
 	auto &input = m_CurrTexture == -1 ? backBuffer : m_Textures[m_CurrTexture];
 	m_CurrTexture = (m_CurrTexture + 1) % 2;
 	auto &output = m_Textures[m_CurrTexture];
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(output.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(output.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
 	float clearValue[] = {0.0f, 0.0f, 0.0f, 0.0f};
 	commandList->ClearRenderTargetView(output.Rtv.CPUHandle, clearValue, 0, nullptr);
 	commandList->OMSetRenderTargets(1, &output.Rtv.CPUHandle, true, nullptr);
 
-	commandList->SetPipelineState(PipelineStates::GetPSO(passName));
+	PipelineStates::SetPSO(commandList, passName);
 
 	std::vector<UINT> resources(1 + numResources);
 	resources[0] = input.Srv.Index;
@@ -83,10 +92,11 @@ void PostProcessing::Pass(GraphicsCommandList commandList, Texture &backBuffer,
 
 	commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, resources.size(), resources.data(), 0);
 
+	COUNTER_ADD("Draw Calls", 1);
 	commandList->DrawInstanced(3, 1, 0, 0);
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(output.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(output.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON));
 }
 
 void PostProcessing::CopyToBackBuffer(GraphicsCommandList commandList, Texture &backBuffer)
@@ -94,9 +104,9 @@ void PostProcessing::CopyToBackBuffer(GraphicsCommandList commandList, Texture &
 	// no post processing steps have been done, no need to copy
 	if (m_CurrTexture == -1)
 	{
-		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Resource.Get(),
-																			  D3D12_RESOURCE_STATE_COMMON,
-																			  D3D12_RESOURCE_STATE_RENDER_TARGET));
+		Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Resource.Get(),
+																				 D3D12_RESOURCE_STATE_COMMON,
+																				 D3D12_RESOURCE_STATE_RENDER_TARGET));
 		return;
 	}
 
@@ -109,7 +119,7 @@ void PostProcessing::CopyToBackBuffer(GraphicsCommandList commandList, Texture &
 		CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET),
 		CD3DX12_RESOURCE_BARRIER::Transition(texture.Resource.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON)};
 
-	commandList->ResourceBarrier(2, preCopyBarriers);
+	Utils::ResourceBarrier(commandList, _countof(preCopyBarriers), preCopyBarriers);
 	commandList->CopyResource(backBuffer.Resource.Get(), texture.Resource.Get());
-	commandList->ResourceBarrier(2, postCopyBarriers);
+	Utils::ResourceBarrier(commandList, _countof(postCopyBarriers), postCopyBarriers);
 }
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "pch.h"
+
+#include "core/MathHelper.h"
+#include "Mesh.h"
+
+struct RenderItem
+{
+	XMFLOAT4X4 World = MathHelper::Identity4x4();
+
+	int NumFramesDirty = NUM_FRAMES_IN_FLIGHT;
+	UINT objCBIndex = -1;
+	UINT matCBIndex = -1;
+
+	// static items are drawn into the cached shadow layer, moving one redraws every cascade
+	bool Static = true;
+
+	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	Ref<Mesh> Mesh;
+};
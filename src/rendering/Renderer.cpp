@@ -3,10 +3,43 @@
 #include "RenderingSettings.h"
 
 extern RenderingSettings g_RenderingSettings;
+extern RenderingStats g_RenderingStats;
 
-Renderer::Renderer(Ref<DxContext> dxContext, UINT width, UINT height)
-	: m_DxContext(dxContext), m_Width(width), m_Height(height)
+Renderer::Renderer(UINT width, UINT height)
+	: m_Width(width), m_Height(height)
 {
+	m_EnvironmentMap = std::make_unique<EnvironmentMap>();
+
+	m_ScreenViewport = {0, 0, (float)width, float(height), 0.0f, 1.0f};
+	m_ScissorRect = {0, 0, (long)width, (long)height};
+	m_Camera.SetLens(0.25f * MathHelper::Pi, (float)width / height, 1.0f, 1000.0f);
+	m_Camera.SetPosition(-2.29, 5.11, 1.15);
+
+	// the voxel bake lights the scene with the sun before there is a device
+	BuildLightingDataBuffer();
+}
+
+void Renderer::AddInitSteps(InitGraph &graph, const Ref<DxContext> &dxContext)
+{
+	const auto mainThread = InitGraph::Affinity::MainThread;
+
+	// the files are read and the shaders compiled on worker threads, the device is free threaded
+	graph.Add("Shaders", {"DxContext"}, [&dxContext]() { PipelineStates::Init(dxContext->GetDevice()); });
+	graph.Add("Scene", {}, [this]() { LoadScene(); });
+	graph.Add("Environment", {}, [this]() { m_EnvironmentMap->Decode("resources/textures/kloppenheim_06_puresky_4k.hdr"); });
+	graph.Add("Voxel bake", {"Scene"}, [this]() { BakeVoxels(); });
+
+	// whatever records commands stays on the main thread
+	graph.Add("Renderer", {"DxContext", "Shaders"}, [this, &dxContext]() { Init(dxContext); }, mainThread);
+	graph.Add("Render items", {"Renderer", "Scene"}, [this]() { BuildRenderItems(); }, mainThread);
+	graph.Add("Voxel bricks", {"Render items", "Voxel bake"}, [this]() { BuildVoxelBricks(); }, mainThread);
+	graph.Add("IBL", {"Renderer", "Environment"}, [this]() { LoadEnvironmentMap(); }, mainThread);
+}
+
+void Renderer::Init(Ref<DxContext> dxContext)
+{
+	m_DxContext = dxContext;
+
 	UINT passCount = 1;
 	UINT objectCount = 3;
 	UINT materialCount = 200;
@@ -15,26 +48,28 @@ Renderer::Renderer(Ref<DxContext> dxContext, UINT width, UINT height)
 	for (int i = 0; i < NUM_FRAMES_IN_FLIGHT; ++i)
 		m_FrameResources.push_back(std::make_unique<FrameResource>(dxContext->GetDevice(), passCount, objectCount, materialCount, lightCount));
 
-	PipelineStates::Init(dxContext->GetDevice());
+#ifdef ENABLE_PROFILER
+	GpuProfiler::Init(dxContext);
+#endif
 
-	m_EnvironmentMap = std::make_unique<EnvironmentMap>(dxContext);
 	m_CascadedShadowMap = std::make_unique<CascadedShadowMap>(dxContext);
-	m_PostProcessing = std::make_unique<PostProcessing>(dxContext, width, height);
-	m_SSAO = std::make_unique<SSAO>(dxContext, width, height);
-	m_TAA = std::make_unique<TAA>(dxContext, width, height);
+	m_DepthReduction = std::make_unique<DepthReduction>(dxContext);
+	m_PostProcessing = std::make_unique<PostProcessing>(dxContext, m_Width, m_Height);
+	m_SSAO = std::make_unique<SSAO>(dxContext, m_Width, m_Height);
+	m_TAA = std::make_unique<TAA>(dxContext, m_Width, m_Height);
 	m_VXGI = std::make_unique<VXGI>(dxContext, VOXEL_DIMENSION);
+	// 4 levels of 128^3 starting at the voxel size of the fixed grid, the last one spans 204.8 units
+	m_VXGIClipmap = std::make_unique<VXGIClipmap>(dxContext, 4, 128, VOXEL_GRID_SIZE * 2.0f);
 
 	BuildResources();
 	AllocateDescriptors();
 	BuildDescriptors();
-
-	m_ScreenViewport = {0, 0, (float)width, float(height), 0.0f, 1.0f};
-	m_ScissorRect = {0, 0, (long)width, (long)height};
-	m_Camera.SetLens(0.25f * MathHelper::Pi, (float)width / height, 1.0f, 1000.0f);
 }
 
 void Renderer::BuildResources()
 {
+	GpuMemoryScope memoryScope(GpuMemoryCategory::GBuffer);
+
 	m_GBufferAlbedo = Texture::Create(m_DxContext->GetDevice(), m_Width, m_Height, 1, GBUFFER_ALBEDO_FORMAT, 1);
 	m_GBufferNormal = Texture::Create(m_DxContext->GetDevice(), m_Width, m_Height, 1, GBUFFER_NORMAL_FORMAT, 1);
 	m_GBufferMetalness = Texture::Create(m_DxContext->GetDevice(), m_Width, m_Height, 1, GBUFFER_METALNESS_FORMAT, 1);
@@ -81,44 +116,86 @@ void Renderer::BuildDescriptors()
 	m_GBufferVelocity.CreateRtv(m_DxContext->GetDevice(), D3D12_RTV_DIMENSION_TEXTURE2D);
 }
 
-void Renderer::Setup()
-{
-	BuildRenderItems();
-	BuildLightingDataBuffer();
-
-	m_EnvironmentMap->Load("resources/textures/kloppenheim_06_puresky_4k.hdr");
-	m_Camera.SetPosition(-2.29, 5.11, 1.15);
-}
-
 void Renderer::OnUpdate(Timer &timer)
 {
-	OnKeyboardInput(timer.DeltaTime());
+	PROFILE_FUNCTION();
+
+	if (m_InputEnabled)
+		OnKeyboardInput(timer.DeltaTime());
 	m_Camera.UpdateViewMatrix();
 
 	// LOG_INFO("Camera: {} {} {}", XMVectorGetX(m_Camera.GetPosition()), XMVectorGetY(m_Camera.GetPosition()), XMVectorGetZ(m_Camera.GetPosition()));
 
 	UpdateLights(timer);
 	UpdateObjectConstantBuffers();
+
+	// whatever the inactive voxel scene missed meanwhile is revoxelized when switching back
+	if (g_RenderingSettings.GI.UseClipmap != m_VoxelClipmapActive)
+	{
+		m_VoxelClipmapActive = g_RenderingSettings.GI.UseClipmap;
+		if (m_VoxelClipmapActive)
+			m_VXGIClipmap->GetClipmap().Invalidate();
+		else
+			m_VoxelDirtyRegions.MarkAll();
+		m_VoxelSceneReady = false;
+	}
+
+	// the clipmap has to be recentred before its origins are written to the pass constants
+	if (g_RenderingSettings.GI.UseClipmap && (g_RenderingSettings.GI.DynamicUpdate || !m_VoxelSceneReady))
+		UpdateVoxelClipmap();
+
 	UpdateMainPassConstantBuffer(timer);
 	UpdateMaterialConstantBuffer();
 	UpdateSSAOConstantBuffer();
 
-	m_CascadedShadowMap->CalcOrthoProjs(m_Camera, m_Lights[0]);
+	// the depth range of the visible pixels lags a few frames behind
+	UpdateShadowCasterBounds();
+	if (m_DepthReduction->HasResult())
+		m_CascadedShadowMap->CalcOrthoProjs(m_Camera, m_Lights[0], m_ShadowCasterBounds,
+											m_DepthReduction->MinDepth(), m_DepthReduction->MaxDepth());
+	else
+		m_CascadedShadowMap->CalcOrthoProjs(m_Camera, m_Lights[0], m_ShadowCasterBounds);
+	CullShadowCasters();
 	UpdateShadowPassCB();
 }
 
 void Renderer::BeginFrame()
 {
+	PROFILE_FUNCTION();
+
 	m_CurrFrameResourceIndex = (m_CurrFrameResourceIndex + 1) % NUM_FRAMES_IN_FLIGHT;
-	m_DxContext->WaitForFenceValue(CurrFrameResource()->Fence);
+	{
+		PROFILE_SCOPE("WaitForFrameResource");
+		int64_t waitStart = Clock::System().Now();
+		m_DxContext->WaitForFenceValue(CurrFrameResource()->Fence);
+		m_WaitTimeMs = (Clock::System().Now() - waitStart) * 1.0e-6;
+	}
+
+#ifdef ENABLE_PROFILER
+	GpuProfiler::BeginFrame(m_CurrFrameResourceIndex);
+#endif
+
+	m_VXGI->UpdateStats(m_CurrFrameResourceIndex);
+	m_DepthReduction->Update(m_CurrFrameResourceIndex);
+
+	COUNTER_SET("CBV/SRV/UAV Descriptors", m_DxContext->GetCbvSrvUavHeap().Size);
+	COUNTER_SET("RTV Descriptors", m_DxContext->GetRtvHeap().Size);
+	COUNTER_SET("DSV Descriptors", m_DxContext->GetDsvHeap().Size);
 
 	auto commandList = m_DxContext->GetCommandList();
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_DxContext->CurrentBackBuffer().Resource.Get(),
-																		  D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	PipelineStates::ResetLastPSO();
+#ifdef ENABLE_PROFILER
+	GpuProfiler::BeginScope(commandList, "Frame");
+#endif
+
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_DxContext->CurrentBackBuffer().Resource.Get(),
+																			 D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
 }
 
 void Renderer::Render()
 {
+	PROFILE_FUNCTION();
+
 	auto commandList = m_DxContext->GetCommandList();
 
 	// set the descriptor heap and a universal root signature thanks to Bindless Rendering
@@ -139,6 +216,10 @@ void Renderer::Render()
 	auto shadowCB = CurrFrameResource()->ShadowCB->GetResource();
 	commandList->SetGraphicsRootConstantBufferView((UINT)RootParam::ShadowCB, shadowCB->GetGPUVirtualAddress());
 
+	// pack the draw arguments of this frame, shared by the shadow, voxelization and g-buffer passes
+	if (g_RenderingSettings.UseIndirectDraw)
+		BuildIndirectDrawCommands();
+
 	// cascaded shadow from directional light
 	ShadowMapPass(commandList);
 
@@ -146,13 +227,53 @@ void Renderer::Render()
 	if (g_RenderingSettings.GI.DebugVoxel || g_RenderingSettings.AntialisingMethod != Antialising::TAA)
 		m_TAA->Reset();
 
-	// re-voxelize the whole scene if required
-	if (g_RenderingSettings.GI.DynamicUpdate)
+	// voxelize the whole scene once, then only the dirty bricks within the budget if required
+	g_RenderingStats.GI.UpdatedBricks = 0;
+	g_RenderingStats.GI.VoxelsTouched = 0;
+	g_RenderingStats.GI.SecondBounceBricks = 0;
+	g_RenderingStats.GI.Dispatches = 0;
+
+	if (g_RenderingSettings.GI.UseClipmap)
 	{
+		// the clipmap regions were queued in OnUpdate
+		VoxelizeClipmap(commandList);
+		m_VoxelSceneReady = true;
+	}
+	else if (g_RenderingSettings.GI.DynamicUpdate || !m_VoxelSceneReady)
+	{
+		UpdateVoxelDirtyRegions();
+
+		UINT budget = m_VoxelSceneReady ? std::max(g_RenderingSettings.GI.UpdateBudget, 1) : UINT_MAX;
+		auto bricks = m_VoxelDirtyRegions.Pop(budget);
+
+		const auto &gi = g_RenderingSettings.GI;
+		m_VXGI->ConfigureSchedule((VoxelSchedulePattern)gi.SecondBounceSchedule, gi.SecondBounceFraction,
+								  std::max(gi.SecondBounceBudget, 1), gi.SecondBounceBlend);
+
 		commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
-		VoxelizeScene(commandList);
+		if (m_VXGI->BeginUpdate(commandList, m_CurrFrameResourceIndex, bricks))
+		{
+			VoxelizeScene(commandList);
+			g_RenderingStats.GI.UpdatedBricks = bricks.size();
+		}
+
+		// static bricks still see their surroundings change, their second bounce is time sliced
+		m_VXGI->UpdateSecondBounce(commandList);
+
+		g_RenderingStats.GI.VoxelsTouched = m_VXGI->GetVoxelsTouched();
+		g_RenderingStats.GI.SecondBounceBricks = m_VXGI->GetSecondBounceBricks();
+		g_RenderingStats.GI.SecondBounceSlices = m_VXGI->GetScheduleSlices();
+		g_RenderingStats.GI.Dispatches = m_VXGI->GetDispatchCount();
+
+		m_VoxelSceneReady = true;
 	}
 
+	g_RenderingStats.GI.DirtyBricks = m_VoxelDirtyRegions.NumDirty();
+
+	COUNTER_ADD("Voxels Updated", g_RenderingStats.GI.VoxelsTouched);
+	COUNTER_ADD("Bricks Updated", g_RenderingStats.GI.UpdatedBricks);
+	COUNTER_SET("Dirty Bricks", g_RenderingStats.GI.DirtyBricks);
+
 	if (g_RenderingSettings.GI.DebugVoxel)
 	{
 		DebugVoxel(commandList);
@@ -161,6 +282,9 @@ void Renderer::Render()
 	{
 		GBufferPass(commandList);
 
+		if (g_RenderingSettings.FitCascadesToDepth)
+			m_DepthReduction->Reduce(commandList, m_CurrFrameResourceIndex, m_DxContext->DepthStencilBuffer(), m_Camera.GetProj4x4f());
+
 		commandList->ClearRenderTargetView(m_DxContext->CurrentBackBuffer().Rtv.CPUHandle, Colors::Black, 0, nullptr);
 		commandList->OMSetRenderTargets(1, &m_DxContext->CurrentBackBuffer().Rtv.CPUHandle, true, &m_DxContext->DepthStencilBuffer().Dsv.CPUHandle);
 
@@ -179,12 +303,24 @@ void Renderer::Render()
 
 void Renderer::EndFrame()
 {
+	PROFILE_FUNCTION();
+
 	auto commandList = m_DxContext->GetCommandList();
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_DxContext->CurrentBackBuffer().Resource.Get(),
-																		  D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_DxContext->CurrentBackBuffer().Resource.Get(),
+																			 D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+
+#ifdef ENABLE_PROFILER
+	// the frame scope spans the UI as well, which is recorded between Render and EndFrame
+	GpuProfiler::EndScope(commandList);
+	GpuProfiler::EndFrame(commandList);
+#endif
 
 	CurrFrameResource()->Fence = m_DxContext->ExecuteCommandList();
+
+	PROFILE_SCOPE("Present");
+	int64_t presentStart = Clock::System().Now();
 	m_DxContext->Present(g_RenderingSettings.EnableVSync);
+	m_WaitTimeMs += (Clock::System().Now() - presentStart) * 1.0e-6;
 }
 
 //
@@ -228,20 +364,15 @@ void Renderer::BuildLightingDataBuffer()
 	m_Lights[2].Range = 5;*/
 }
 
-void Renderer::BuildRenderItems()
+void Renderer::LoadScene()
 {
-	auto commandList = m_DxContext->GetCommandList();
-	auto device = m_DxContext->GetDevice();
-	auto &cbvSrvUavHeap = m_DxContext->GetCbvSrvUavHeap();
+	PROFILE_FUNCTION();
 
 	m_Skybox = Mesh::FromFile("resources/meshes/skybox.gltf");
-	m_Skybox->UploadVertexAndIndexBufferToGPU(device, commandList);
 
 #if TEST_SCENE
 	Ref<RenderItem> testScene = std::make_shared<RenderItem>();
 	testScene->Mesh = Mesh::FromFile("resources/low_poly_winter_scene/scene.gltf");
-	testScene->Mesh->UploadVertexAndIndexBufferToGPU(device, commandList);
-	testScene->Mesh->LoadTextures(device, commandList, cbvSrvUavHeap);
 	testScene->objCBIndex = 0;
 	testScene->matCBIndex = 0;
 	m_RenderItems.push_back(testScene);
@@ -250,8 +381,6 @@ void Renderer::BuildRenderItems()
 #if SPONZA_SCENE
 	Ref<RenderItem> sponza = std::make_shared<RenderItem>();
 	sponza->Mesh = Mesh::FromFile("resources/sponza/NewSponza_Main_glTF_002.gltf");
-	sponza->Mesh->UploadVertexAndIndexBufferToGPU(device, commandList);
-	sponza->Mesh->LoadTextures(device, commandList, cbvSrvUavHeap);
 	sponza->objCBIndex = 0;
 	sponza->matCBIndex = 0;
 
@@ -259,16 +388,351 @@ void Renderer::BuildRenderItems()
 
 	Ref<RenderItem> sponzaCurtain = std::make_shared<RenderItem>();
 	sponzaCurtain->Mesh = Mesh::FromFile("resources/sponza/NewSponza_Curtains_glTF.gltf");
-	sponzaCurtain->Mesh->UploadVertexAndIndexBufferToGPU(device, commandList);
-	sponzaCurtain->Mesh->LoadTextures(device, commandList, cbvSrvUavHeap);
 	sponzaCurtain->objCBIndex = 1;
 	sponzaCurtain->matCBIndex = sponza->Mesh->Materials().size();
 
 	m_RenderItems.push_back(sponzaCurtain);
 #endif
 
+	for (auto &ritem : m_RenderItems)
+		ritem->Mesh->DecodeTextures();
+
+	BuildShadowCasterBounds();
+}
+
+void Renderer::BuildRenderItems()
+{
+	PROFILE_FUNCTION();
+
+	auto commandList = m_DxContext->GetCommandList();
+	auto device = m_DxContext->GetDevice();
+	auto &cbvSrvUavHeap = m_DxContext->GetCbvSrvUavHeap();
+	auto &stagingManager = m_DxContext->GetStagingManager();
+
+	for (auto &ritem : m_RenderItems)
+		ritem->Mesh->LoadTextures(device, commandList, stagingManager, cbvSrvUavHeap);
+
+	// every mesh is uploaded into one shared vertex and index buffer
+	UINT numVertices = m_Skybox->Vertices().size();
+	UINT numIndices = m_Skybox->Indices().size();
+	for (auto &ritem : m_RenderItems)
+	{
+		numVertices += ritem->Mesh->Vertices().size();
+		numIndices += ritem->Mesh->Indices().size();
+	}
+
+	m_GeometryPool = std::make_unique<GeometryPool>(device, stagingManager, sizeof(Mesh::Vertex), numVertices, numIndices);
+
+	m_Skybox->UploadToGeometryPool(*m_GeometryPool, commandList);
+	for (auto &ritem : m_RenderItems)
+		ritem->Mesh->UploadToGeometryPool(*m_GeometryPool, commandList);
+
+	m_GeometryPool->FinishUploads(commandList);
+
 	m_DxContext->ExecuteCommandList();
-	m_DxContext->Flush();
+	m_DxContext->DeferFlush();
+
+	m_GeometryPool->LogMemoryReport();
+}
+
+void Renderer::BakeVoxels()
+{
+	PROFILE_FUNCTION();
+
+	std::vector<VoxelizerMesh> meshes;
+	for (auto &ritem : m_RenderItems)
+		meshes.push_back({ritem->Mesh.get(), ritem->World});
+
+	const auto &sun = m_Lights[0];
+	VoxelizerLight voxelizerSun;
+	voxelizerSun.Direction = XMFLOAT3(sun.DirectionWS.x, sun.DirectionWS.y, sun.DirectionWS.z);
+	voxelizerSun.Radiance = XMFLOAT3(sun.Color.x * sun.Intensity, sun.Color.y * sun.Intensity, sun.Color.z * sun.Intensity);
+
+	// The static scene is voxelized on the CPU once and loaded from the bake afterwards, which
+	// skips both the occupancy and the first GPU voxelization. Only the bricks touched by the
+	// scene are allocated in the voxel grid.
+	std::string bakeFilename = CpuVoxelizer::CacheFilename(meshes, voxelizerSun);
+
+	VoxelVolume &volume = m_VoxelBake;
+	BrickOccupancy &occupancy = m_VoxelBakeOccupancy;
+	if (volume.Load(bakeFilename))
+	{
+		volume.MarkBricks(occupancy);
+	}
+	else
+	{
+		for (auto &mesh : meshes)
+			occupancy.AddMesh(*mesh.Source, XMLoadFloat4x4(&mesh.World));
+
+		CpuVoxelizer voxelizer(occupancy, voxelizerSun);
+		for (auto &mesh : meshes)
+			voxelizer.AddMesh(*mesh.Source, XMLoadFloat4x4(&mesh.World));
+
+		volume = voxelizer.Finish();
+		volume.Save(bakeFilename);
+	}
+}
+
+void Renderer::BuildVoxelBricks()
+{
+	PROFILE_FUNCTION();
+
+	m_VXGI->BuildBricks(m_VoxelBakeOccupancy);
+	m_VXGI->UploadVoxels(m_VoxelBake.Bricks, m_VoxelBake.Voxels);
+	m_VoxelDirtyRegions.Reset(m_VoxelBakeOccupancy);
+
+	// the voxels are on the GPU now
+	m_VoxelBake = VoxelVolume();
+
+	// local bounds of every render item, used to find the bricks it covers when it moves
+	m_RenderItemBounds.clear();
+	for (auto &ritem : m_RenderItems)
+	{
+		const auto &vertices = ritem->Mesh->Vertices();
+
+		BoundingBox bounds;
+		BoundingBox::CreateFromPoints(bounds, vertices.size(), &vertices[0].Position, sizeof(Mesh::Vertex));
+		m_RenderItemBounds.push_back(bounds);
+	}
+
+	// the uploaded voxels match the current items and sun, only later changes are revoxelized
+	UpdateVoxelDirtyRegions();
+	m_VoxelDirtyRegions.Pop(UINT_MAX);
+	m_VoxelSceneReady = true;
+}
+
+void Renderer::LoadEnvironmentMap()
+{
+	m_EnvironmentMap->Load(m_DxContext);
+	memcpy(m_MainPassCB.IrradianceSH, m_EnvironmentMap->GetIrradianceSH().Coefficients, sizeof(m_MainPassCB.IrradianceSH));
+}
+
+void Renderer::BuildShadowCasterBounds()
+{
+	PROFILE_FUNCTION();
+
+	m_SubMeshBounds.clear();
+	m_ShadowCasters.clear();
+
+	for (UINT i = 0; i < m_RenderItems.size(); i++)
+	{
+		const auto &vertices = m_RenderItems[i]->Mesh->Vertices();
+		const auto &indices = m_RenderItems[i]->Mesh->Indices();
+
+		// the shadow pass only draws the opaque submeshes
+		const auto &submeshes = m_RenderItems[i]->Mesh->SubMeshes();
+		for (UINT j = 0; j < submeshes.size(); j++)
+		{
+			const auto &submesh = submeshes[j];
+			if (submesh.Transparent || submesh.IndexCount == 0)
+				continue;
+
+			XMVECTOR minPoint = XMVectorReplicate(FLT_MAX);
+			XMVECTOR maxPoint = XMVectorReplicate(-FLT_MAX);
+			for (UINT k = 0; k < submesh.IndexCount; k++)
+			{
+				XMVECTOR position = XMLoadFloat3(&vertices[indices[submesh.StartIndexLocation + k] + submesh.BaseVertexLocation].Position);
+				minPoint = XMVectorMin(minPoint, position);
+				maxPoint = XMVectorMax(maxPoint, position);
+			}
+
+			BoundingBox bounds;
+			BoundingBox::CreateFromPoints(bounds, minPoint, maxPoint);
+			m_SubMeshBounds.push_back(bounds);
+			m_ShadowCasters.push_back({i, j});
+		}
+	}
+
+	m_ShadowCasterBounds.resize(m_SubMeshBounds.size());
+}
+
+void Renderer::UpdateShadowCasterBounds()
+{
+	PROFILE_FUNCTION();
+
+	bool staticCastersMoved = false;
+
+	for (size_t i = 0; i < m_SubMeshBounds.size(); i++)
+	{
+		const auto &ritem = m_RenderItems[m_ShadowCasters[i].Item];
+
+		BoundingBox bounds;
+		m_SubMeshBounds[i].Transform(bounds, XMLoadFloat4x4(&ritem->World));
+
+		const BoundingBox &prev = m_ShadowCasterBounds[i];
+		if (ritem->Static && !(XMVector3Equal(XMLoadFloat3(&prev.Center), XMLoadFloat3(&bounds.Center)) &&
+							   XMVector3Equal(XMLoadFloat3(&prev.Extents), XMLoadFloat3(&bounds.Extents))))
+			staticCastersMoved = true;
+
+		m_ShadowCasterBounds[i] = bounds;
+	}
+
+	// the cached layer holds the static casters where they were drawn
+	if (staticCastersMoved)
+		m_CascadedShadowMap->InvalidateStaticCasters();
+}
+
+void Renderer::CullShadowCasters()
+{
+	PROFILE_FUNCTION();
+
+	const auto &fit = m_CascadedShadowMap->Fit();
+	m_ShadowCasterCulling.SetCasters(m_ShadowCasterBounds, fit.LightView);
+
+	// the blocker search of PCSS reaches this far around a receiver, LIGHT_SIZE in PCSS.hlsl
+	float searchWidth = 2.0f * fit.Radius[0] * g_RenderingSettings.ShadowSoftness * 0.04f;
+
+	int numDynamicCasters = 0;
+	for (const auto &caster : m_ShadowCasters)
+		numDynamicCasters += m_RenderItems[caster.Item]->Static ? 0 : 1;
+
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		auto &staticCasters = m_StaticCascadeCasters[i];
+		auto &dynamicCasters = m_DynamicCascadeCasters[i];
+		staticCasters.clear();
+		dynamicCasters.clear();
+
+		// the casters whose shadow can fall into the slice of the view frustum, give or take two texels
+		CasterCullVolume volume;
+		float margin = searchWidth + 4.0f * fit.Radius[i] / SHADOW_MAP_SIZE;
+		ShadowCasterCulling::SliceVolume(m_Camera, fit, i, g_RenderingSettings.CascadeTransitionRatio, margin, volume);
+		m_ShadowCasterCulling.Cull(volume, m_VisibleCasters);
+
+		for (UINT index : m_VisibleCasters)
+		{
+			const auto &caster = m_ShadowCasters[index];
+			(m_RenderItems[caster.Item]->Static ? staticCasters : dynamicCasters).push_back(caster);
+		}
+
+		// the cached layer outlives the slice it was drawn for, so only its projection can cull it
+		if (g_RenderingSettings.CacheStaticShadows)
+		{
+			staticCasters.clear();
+			ShadowCasterCulling::ProjectionVolume(fit, i, volume);
+			m_ShadowCasterCulling.Cull(volume, m_VisibleCasters);
+
+			for (UINT index : m_VisibleCasters)
+			{
+				const auto &caster = m_ShadowCasters[index];
+				if (m_RenderItems[caster.Item]->Static)
+					staticCasters.push_back(caster);
+			}
+		}
+
+		g_RenderingStats.Shadow.CascadeCasters[i] = (int)(staticCasters.size() + dynamicCasters.size());
+	}
+
+	g_RenderingStats.Shadow.ShadowCasters = (int)m_ShadowCasters.size();
+	g_RenderingStats.Shadow.DynamicCasters = numDynamicCasters;
+
+	int numCulled = 0;
+	for (int i = 0; i < NUM_CASCADES; i++)
+		numCulled += (int)m_ShadowCasters.size() - g_RenderingStats.Shadow.CascadeCasters[i];
+	COUNTER_ADD("Shadow Casters Culled", numCulled);
+}
+
+void Renderer::UpdateVoxelDirtyRegions()
+{
+	PROFILE_FUNCTION();
+
+	for (int i = 0; i < m_RenderItems.size(); i++)
+	{
+		auto bounds = VoxelDirtyRegions::ToVoxelSpace(m_RenderItemBounds[i], XMLoadFloat4x4(&m_RenderItems[i]->World));
+		m_VoxelDirtyRegions.UpdateItem(i, bounds);
+	}
+
+	// the voxels store direct lighting, so a change of the sun invalidates all of them
+	if (VoxelLightingChanged())
+		m_VoxelDirtyRegions.MarkAll();
+}
+
+void Renderer::UpdateVoxelClipmap()
+{
+	PROFILE_FUNCTION();
+
+	auto &clipmap = m_VXGIClipmap->GetClipmap();
+
+	if (VoxelLightingChanged())
+		clipmap.Invalidate();
+
+	clipmap.Update(m_Camera.GetPosition());
+
+	// the regions an item leaves and enters are revoxelized in every level they overlap
+	m_ClipmapItemBounds.resize(m_RenderItems.size(), BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(-1, -1, -1)));
+	for (int i = 0; i < m_RenderItems.size(); i++)
+	{
+		BoundingBox bounds;
+		m_RenderItemBounds[i].Transform(bounds, XMLoadFloat4x4(&m_RenderItems[i]->World));
+
+		const BoundingBox &prev = m_ClipmapItemBounds[i];
+		if (XMVector3Equal(XMLoadFloat3(&prev.Center), XMLoadFloat3(&bounds.Center)) &&
+			XMVector3Equal(XMLoadFloat3(&prev.Extents), XMLoadFloat3(&bounds.Extents)))
+			continue;
+
+		if (prev.Extents.x >= 0.0f)
+			clipmap.MarkBounds(prev);
+		clipmap.MarkBounds(bounds);
+		m_ClipmapItemBounds[i] = bounds;
+	}
+}
+
+bool Renderer::VoxelLightingChanged()
+{
+	const auto &sun = m_Lights[0];
+	if (XMVector4Equal(XMLoadFloat4(&sun.DirectionWS), XMLoadFloat4(&m_VoxelizedSunDirection)) &&
+		sun.Intensity == m_VoxelizedSunIntensity)
+		return false;
+
+	m_VoxelizedSunDirection = sun.DirectionWS;
+	m_VoxelizedSunIntensity = sun.Intensity;
+	return true;
+}
+
+void Renderer::BuildIndirectDrawCommands()
+{
+	PROFILE_FUNCTION();
+
+	auto objectCB = CurrFrameResource()->ObjectCB->GetResource();
+	UINT objCBByteSize = Utils::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+
+	auto matCB = CurrFrameResource()->MatCB->GetResource();
+	UINT matCBByteSize = Utils::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+	m_OpaqueDrawList.Build(m_RenderItems, false,
+						   objectCB->GetGPUVirtualAddress(), objCBByteSize,
+						   matCB->GetGPUVirtualAddress(), matCBByteSize);
+
+	auto indirectDrawBuffer = CurrFrameResource()->IndirectDrawBuffer.get();
+
+	const auto &commands = m_OpaqueDrawList.Commands();
+	for (int i = 0; i < commands.size(); i++)
+		indirectDrawBuffer->CopyData(i, commands[i]);
+
+	// the casters of each cascade follow in the same buffer
+	UINT firstCommand = (UINT)commands.size();
+	auto append = [&](IndirectDrawList &drawList, const std::vector<SubMeshRef> &casters)
+	{
+		drawList.Build(m_RenderItems, casters,
+					   objectCB->GetGPUVirtualAddress(), objCBByteSize,
+					   matCB->GetGPUVirtualAddress(), matCBByteSize);
+
+		const auto &casterCommands = drawList.Commands();
+		ASSERT(firstCommand + casterCommands.size() <= MAX_INDIRECT_DRAWS, "Too many indirect draws, increase MAX_INDIRECT_DRAWS.");
+
+		for (int i = 0; i < casterCommands.size(); i++)
+			indirectDrawBuffer->CopyData(firstCommand + i, casterCommands[i]);
+
+		UINT first = firstCommand;
+		firstCommand += (UINT)casterCommands.size();
+		return first;
+	};
+
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		m_StaticCasterFirstCommands[i] = append(m_StaticCasterDrawLists[i], m_StaticCascadeCasters[i]);
+		m_DynamicCasterFirstCommands[i] = append(m_DynamicCasterDrawLists[i], m_DynamicCascadeCasters[i]);
+	}
 }
 
 //
@@ -277,10 +741,13 @@ void Renderer::BuildRenderItems()
 
 void Renderer::GBufferPass(GraphicsCommandList commandList)
 {
+	PROFILE_FUNCTION();
+	PROFILE_GPU_SCOPE(commandList, "GBufferPass");
+
 	commandList->RSSetViewports(1, &m_ScreenViewport);
 	commandList->RSSetScissorRects(1, &m_ScissorRect);
 
-	commandList->SetPipelineState(PipelineStates::GetPSO("gbuffer"));
+	PipelineStates::SetPSO(commandList, "gbuffer");
 
 	D3D12_RESOURCE_BARRIER preBarriers[] =
 		{
@@ -291,7 +758,7 @@ void Renderer::GBufferPass(GraphicsCommandList commandList)
 			CD3DX12_RESOURCE_BARRIER::Transition(m_GBufferAmbient.Resource.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET),
 			CD3DX12_RESOURCE_BARRIER::Transition(m_GBufferVelocity.Resource.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET),
 		};
-	commandList->ResourceBarrier(6, preBarriers);
+	Utils::ResourceBarrier(commandList, _countof(preBarriers), preBarriers);
 
 	commandList->ClearRenderTargetView(m_GBufferAlbedo.Rtv.CPUHandle, XMVECTORF32{0.0f, 0.0f, 0.0f, 0.0f}, 0, nullptr);
 	commandList->ClearRenderTargetView(m_GBufferNormal.Rtv.CPUHandle, XMVECTORF32{0.0f, 0.0f, 0.0f, 0.0f}, 0, nullptr);
@@ -317,12 +784,15 @@ void Renderer::GBufferPass(GraphicsCommandList commandList)
 			CD3DX12_RESOURCE_BARRIER::Transition(m_GBufferAmbient.Resource.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON),
 			CD3DX12_RESOURCE_BARRIER::Transition(m_GBufferVelocity.Resource.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON),
 		};
-	commandList->ResourceBarrier(6, postBarriers);
+	Utils::ResourceBarrier(commandList, _countof(postBarriers), postBarriers);
 }
 
 void Renderer::DeferredLightingPass(GraphicsCommandList commandList)
 {
-	commandList->SetPipelineState(PipelineStates::GetPSO("deferredLighting"));
+	PROFILE_FUNCTION();
+	PROFILE_GPU_SCOPE(commandList, "DeferredLightingPass");
+
+	PipelineStates::SetPSO(commandList, "deferredLighting");
 
 	UINT resources[] = {m_GBufferAlbedo.Srv.Index,
 						m_GBufferNormal.Srv.Index,
@@ -332,7 +802,6 @@ void Renderer::DeferredLightingPass(GraphicsCommandList commandList)
 						m_DxContext->DepthStencilBuffer().Srv.Index,
 						m_CascadedShadowMap->Srv(4).Index,
 						m_VXGI->GetTextureSrv(g_RenderingSettings.GI.SecondBounce ? 1 : 0).Index,
-						m_EnvironmentMap->GetIrMap().Srv.Index,
 						m_EnvironmentMap->GetSpMap().Srv.Index,
 						m_EnvironmentMap->GetBRDFLUT().Srv.Index};
 
@@ -340,102 +809,286 @@ void Renderer::DeferredLightingPass(GraphicsCommandList commandList)
 
 	// fullscreen triangle
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	COUNTER_ADD("Draw Calls", 1);
 	commandList->DrawInstanced(3, 1, 0, 0);
 }
 
 void Renderer::DrawRenderItems(GraphicsCommandList commandList, bool transparent)
 {
+	// only the opaque list is packed for ExecuteIndirect
+	if (g_RenderingSettings.UseIndirectDraw && !transparent)
+	{
+		DrawRenderItemsIndirect(commandList, m_OpaqueDrawList);
+		return;
+	}
+
 	auto objectCB = CurrFrameResource()->ObjectCB->GetResource();
 	UINT objCBByteSize = Utils::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 
 	auto matCB = CurrFrameResource()->MatCB->GetResource();
 	UINT matCBByteSize = Utils::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
-	for (auto &ritem : m_RenderItems)
+	m_GeometryPool->Bind(commandList);
+
+	DirectDraw::Draw(*commandList.Get(), m_RenderItems, transparent,
+					 objectCB->GetGPUVirtualAddress(), objCBByteSize,
+					 matCB->GetGPUVirtualAddress(), matCBByteSize);
+}
+
+void Renderer::DrawRenderItemsIndirect(GraphicsCommandList commandList, const IndirectDrawList &drawList, UINT firstCommand)
+{
+	auto argumentBuffer = CurrFrameResource()->IndirectDrawBuffer->GetResource();
+	auto commandSignature = PipelineStates::GetCommandSignature("draw");
+
+	m_GeometryPool->Bind(commandList);
+
+	for (const auto &batch : drawList.Batches())
 	{
-		// set object constant buffer
-		auto objCBAddress = objectCB->GetGPUVirtualAddress() + ritem->objCBIndex * objCBByteSize;
-		commandList->SetGraphicsRootConstantBufferView((UINT)RootParam::ObjectCB, objCBAddress);
+		commandList->IASetPrimitiveTopology(batch.PrimitiveType);
 
-		auto &mesh = ritem->Mesh;
-		commandList->IASetVertexBuffers(0, 1, &mesh->VertexBufferView());
-		commandList->IASetIndexBuffer(&mesh->IndexBufferView());
-		commandList->IASetPrimitiveTopology(ritem->PrimitiveType);
+		// the arguments were packed on the CPU, so the draws inside are known
+		UINT64 numIndices = 0;
+		for (UINT i = 0; i < batch.CommandCount; i++)
+			numIndices += drawList.Commands()[batch.FirstCommand + i].DrawArguments.IndexCountPerInstance;
+		COUNTER_ADD("Draw Calls", batch.CommandCount);
+		COUNTER_ADD("Triangles", numIndices / 3);
 
-		for (const auto &submesh : mesh->SubMeshes())
-		{
-			if (submesh.Transparent != transparent)
-				continue;
+		commandList->ExecuteIndirect(commandSignature, batch.CommandCount, argumentBuffer,
+									 (firstCommand + batch.FirstCommand) * sizeof(IndirectDrawCommand), nullptr, 0);
+	}
+}
 
-			// set material constant buffer
-			auto matCBAddress = matCB->GetGPUVirtualAddress() + (submesh.MaterialIndex + ritem->matCBIndex) * matCBByteSize;
-			auto &material = mesh->Materials()[submesh.MaterialIndex];
+void Renderer::DrawSubMeshes(GraphicsCommandList commandList, const std::vector<SubMeshRef> &subMeshes)
+{
+	auto objectCB = CurrFrameResource()->ObjectCB->GetResource();
+	UINT objCBByteSize = Utils::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 
-			commandList->SetGraphicsRootConstantBufferView((UINT)RootParam::MatCB, matCBAddress);
-			commandList->DrawIndexedInstanced(submesh.IndexCount, 1,
-											  submesh.StartIndexLocation, submesh.BaseVertexLocation, 0);
-		}
+	auto matCB = CurrFrameResource()->MatCB->GetResource();
+	UINT matCBByteSize = Utils::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+
+	m_GeometryPool->Bind(commandList);
+
+	DirectDraw::Draw(*commandList.Get(), m_RenderItems, subMeshes,
+					 objectCB->GetGPUVirtualAddress(), objCBByteSize,
+					 matCB->GetGPUVirtualAddress(), matCBByteSize);
+}
+
+void Renderer::DrawShadowCasters(GraphicsCommandList commandList, UINT cascade, bool staticCasters)
+{
+	if (g_RenderingSettings.UseIndirectDraw)
+	{
+		if (staticCasters)
+			DrawRenderItemsIndirect(commandList, m_StaticCasterDrawLists[cascade], m_StaticCasterFirstCommands[cascade]);
+		else
+			DrawRenderItemsIndirect(commandList, m_DynamicCasterDrawLists[cascade], m_DynamicCasterFirstCommands[cascade]);
+	}
+	else
+	{
+		DrawSubMeshes(commandList, staticCasters ? m_StaticCascadeCasters[cascade] : m_DynamicCascadeCasters[cascade]);
 	}
 }
 
 void Renderer::ShadowMapPass(GraphicsCommandList commandList)
 {
+	PROFILE_FUNCTION();
+	PROFILE_GPU_SCOPE(commandList, "ShadowMapPass");
+
 	commandList->RSSetViewports(1, &m_CascadedShadowMap->Viewport());
 	commandList->RSSetScissorRects(1, &m_CascadedShadowMap->ScissorRect());
 
-	commandList->SetPipelineState(PipelineStates::GetPSO("shadow"));
+	PipelineStates::SetPSO(commandList, "shadow");
+
+	g_RenderingStats.Shadow.CascadeRedraws = m_CascadedShadowMap->StaticRedrawCount();
+
+	if (!g_RenderingSettings.CacheStaticShadows)
+	{
+		Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_CascadedShadowMap->GetResource(),
+																				 D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+
+		for (UINT i = 0; i < NUM_CASCADES; i++)
+		{
+			// Bind cascade shadow index
+			commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, 1, &i, 0);
+
+			commandList->ClearDepthStencilView(m_CascadedShadowMap->Dsv(i).CPUHandle,
+											   D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+			commandList->OMSetRenderTargets(0, nullptr, false, &m_CascadedShadowMap->Dsv(i).CPUHandle);
+
+			DrawShadowCasters(commandList, i, true);
+			DrawShadowCasters(commandList, i, false);
+			m_CascadeHasDynamicCasters[i] = false;
+		}
+
+		Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_CascadedShadowMap->GetResource(),
+																				 D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ));
+		return;
+	}
+
+	// redraw the static layer of the cascades whose projection changed
+	auto staticLayer = m_CascadedShadowMap->GetStaticResource();
+	if (m_CascadedShadowMap->StaticRedrawCount() > 0)
+	{
+		Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(staticLayer,
+																				 D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+
+		for (UINT i = 0; i < NUM_CASCADES; i++)
+		{
+			if (!m_CascadedShadowMap->NeedsStaticRedraw(i))
+				continue;
+
+			commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, 1, &i, 0);
+
+			commandList->ClearDepthStencilView(m_CascadedShadowMap->StaticDsv(i).CPUHandle,
+											   D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+			commandList->OMSetRenderTargets(0, nullptr, false, &m_CascadedShadowMap->StaticDsv(i).CPUHandle);
+
+			DrawShadowCasters(commandList, i, true);
+		}
+
+		Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(staticLayer,
+																				 D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+	}
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_CascadedShadowMap->GetResource(),
-																		  D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+	// a cascade is copied again when its layer changed or dynamic casters were or will be drawn on top
+	bool needsCopy[NUM_CASCADES];
+	bool anyCopy = false;
+	bool anyDynamic = false;
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		bool hasDynamic = !m_DynamicCascadeCasters[i].empty();
+		needsCopy[i] = m_CascadedShadowMap->NeedsStaticRedraw(i) || hasDynamic || m_CascadeHasDynamicCasters[i];
+		m_CascadeHasDynamicCasters[i] = hasDynamic;
+
+		anyCopy |= needsCopy[i];
+		anyDynamic |= hasDynamic;
+	}
+
+	// otherwise the shadow map still holds what was drawn last frame
+	if (!anyCopy)
+		return;
+
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_CascadedShadowMap->GetResource(),
+																			 D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST));
 
 	for (UINT i = 0; i < NUM_CASCADES; i++)
 	{
-		// Bind cascade shadow index
-		commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, 1, &i, 0);
+		if (!needsCopy[i])
+			continue;
+
+		// the depth plane only, the stencil is never used
+		UINT subresource = D3D12CalcSubresource(0, i, 0, 1, NUM_CASCADES);
+		CD3DX12_TEXTURE_COPY_LOCATION dst(m_CascadedShadowMap->GetResource(), subresource);
+		CD3DX12_TEXTURE_COPY_LOCATION src(staticLayer, subresource);
+		commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	}
+
+	if (!anyDynamic)
+	{
+		Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_CascadedShadowMap->GetResource(),
+																				 D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+		return;
+	}
+
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_CascadedShadowMap->GetResource(),
+																			 D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+
+	for (UINT i = 0; i < NUM_CASCADES; i++)
+	{
+		if (!m_CascadeHasDynamicCasters[i])
+			continue;
 
-		commandList->ClearDepthStencilView(m_CascadedShadowMap->Dsv(i).CPUHandle,
-										   D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+		commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, 1, &i, 0);
 		commandList->OMSetRenderTargets(0, nullptr, false, &m_CascadedShadowMap->Dsv(i).CPUHandle);
 
-		DrawRenderItems(commandList);
+		DrawShadowCasters(commandList, i, false);
 	}
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_CascadedShadowMap->GetResource(),
-																		  D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_CascadedShadowMap->GetResource(),
+																			 D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ));
 }
 
 void Renderer::DrawSkybox(GraphicsCommandList commandList)
 {
-	commandList->SetPipelineState(PipelineStates::GetPSO("skybox"));
+	PROFILE_FUNCTION();
+	PROFILE_GPU_SCOPE(commandList, "DrawSkybox");
+
+	PipelineStates::SetPSO(commandList, "skybox");
 	commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, 1,
 											   &m_EnvironmentMap->GetEnvMap().Srv.Index, 0);
 
-	commandList->IASetVertexBuffers(0, 1, &m_Skybox->VertexBufferView());
-	commandList->IASetIndexBuffer(&m_Skybox->IndexBufferView());
+	m_GeometryPool->Bind(commandList);
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	commandList->DrawIndexedInstanced(m_Skybox->SubMeshes()[0].IndexCount, 1, 0, 0, 0);
+	const auto &geometry = m_Skybox->Geometry();
+	COUNTER_ADD("Draw Calls", 1);
+	COUNTER_ADD("Triangles", m_Skybox->SubMeshes()[0].IndexCount / 3);
+	commandList->DrawIndexedInstanced(m_Skybox->SubMeshes()[0].IndexCount, 1, geometry.StartIndex, geometry.BaseVertex, 0);
 }
 
 void Renderer::VoxelizeScene(GraphicsCommandList commandList)
 {
+	PROFILE_FUNCTION();
+	PROFILE_GPU_SCOPE(commandList, "VoxelizeScene");
+
 	commandList->OMSetRenderTargets(0, nullptr, false, nullptr);
 
 	commandList->RSSetViewports(1, &m_VXGI->GetViewPort());
 	commandList->RSSetScissorRects(1, &m_VXGI->GetScissorRect());
 
-	commandList->SetPipelineState(PipelineStates::GetPSO("voxelize"));
+	PipelineStates::SetPSO(commandList, "voxelize");
 
-	UINT resources[] = {m_VXGI->GetVoxelBufferUav().Index, m_CascadedShadowMap->Srv(4).Index};
+	UINT resources[] = {m_VXGI->GetVoxelBufferUav().Index,
+						m_CascadedShadowMap->Srv(4).Index,
+						m_VXGI->GetBrickIndirectionSrv().Index,
+						m_VXGI->GetStatsUav().Index,
+						m_VXGI->GetBrickUpdateMaskUav().Index,
+						m_VXGI->GetUpdateStamp()};
 	commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
 
 	DrawRenderItems(commandList, false);
 
 	m_VXGI->BufferToTexture3D(commandList);
+	m_VXGI->ReadbackStats(commandList, m_CurrFrameResourceIndex);
+}
+
+void Renderer::VoxelizeClipmap(GraphicsCommandList commandList)
+{
+	PROFILE_FUNCTION();
+	PROFILE_GPU_SCOPE(commandList, "VoxelizeClipmap");
+
+	auto &clipmap = m_VXGIClipmap->GetClipmap();
+
+	commandList->OMSetRenderTargets(0, nullptr, false, nullptr);
+
+	commandList->RSSetViewports(1, &m_VXGIClipmap->GetViewPort());
+	commandList->RSSetScissorRects(1, &m_VXGIClipmap->GetScissorRect());
+
+	commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
+
+	for (UINT level = 0; level < clipmap.NumLevels(); level++)
+	{
+		for (const auto &region : clipmap.TakeDirtyRegions(level))
+		{
+			PipelineStates::SetPSO(commandList, "voxelizeClipmap");
+
+			auto resources = m_VXGIClipmap->GetVoxelizeResources(level, region, m_CascadedShadowMap->Srv(4).Index);
+			commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), &resources, 0);
+
+			DrawRenderItems(commandList, false);
+
+			Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::UAV(nullptr));
+			m_VXGIClipmap->BufferToTexture3D(commandList, level, region);
+
+			g_RenderingStats.GI.VoxelsTouched += region.Volume();
+		}
+	}
 }
 
 void Renderer::DebugVoxel(GraphicsCommandList commandList)
 {
+	PROFILE_FUNCTION();
+	PROFILE_GPU_SCOPE(commandList, "DebugVoxel");
+
 	commandList->ClearRenderTargetView(m_DxContext->CurrentBackBuffer().Rtv.CPUHandle, XMVECTORF32{0.0f, 0.0f, 0.0f, 1.0f}, 0, nullptr);
 	commandList->ClearDepthStencilView(m_DxContext->DepthStencilBuffer().Dsv.CPUHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
@@ -443,7 +1096,7 @@ void Renderer::DebugVoxel(GraphicsCommandList commandList)
 	commandList->RSSetScissorRects(1, &m_ScissorRect);
 
 	commandList->OMSetRenderTargets(1, &m_DxContext->CurrentBackBuffer().Rtv.CPUHandle, true, &m_DxContext->DepthStencilBuffer().Dsv.CPUHandle);
-	commandList->SetPipelineState(PipelineStates::GetPSO("voxelDebug"));
+	PipelineStates::SetPSO(commandList, "voxelDebug");
 
 	UINT resources[] = {m_VXGI->GetTextureSrv(g_RenderingSettings.GI.SecondBounce ? 1 : 0).Index, static_cast<UINT>(g_RenderingSettings.GI.DebugVoxelMipLevel)};
 	commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
@@ -451,6 +1104,7 @@ void Renderer::DebugVoxel(GraphicsCommandList commandList)
 	UINT dimension = VOXEL_DIMENSION / pow(2, g_RenderingSettings.GI.DebugVoxelMipLevel);
 
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
+	COUNTER_ADD("Draw Calls", 1);
 	commandList->DrawInstanced(pow(dimension, 3), 1, 0, 0);
 }
 
@@ -461,12 +1115,13 @@ void Renderer::Debug(GraphicsCommandList commandList, Descriptor srv, UINT slot)
 
 	commandList->OMSetRenderTargets(1, &m_DxContext->CurrentBackBuffer().Rtv.CPUHandle, true, nullptr);
 
-	commandList->SetPipelineState(PipelineStates::GetPSO("debug"));
+	PipelineStates::SetPSO(commandList, "debug");
 
 	UINT resources[] = {srv.Index, slot};
 	commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
 
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	COUNTER_ADD("Draw Calls", 1);
 	commandList->DrawInstanced(6, 1, 0, 0);
 }
 
@@ -510,6 +1165,8 @@ void Renderer::OnMouseInput(int dxPixel, int dyPixel)
 
 void Renderer::UpdateLights(Timer &timer)
 {
+	PROFILE_FUNCTION();
+
 	m_Lights[0].DirectionWS = CalcSunDir(g_RenderingSettings.SunTheta, g_RenderingSettings.SunPhi);
 	m_Lights[0].Intensity = g_RenderingSettings.SunLightIntensity;
 
@@ -534,6 +1191,8 @@ void Renderer::UpdateLights(Timer &timer)
 
 void Renderer::UpdateObjectConstantBuffers()
 {
+	PROFILE_FUNCTION();
+
 	auto objectCB = CurrFrameResource()->ObjectCB.get();
 
 	for (auto &ritem : m_RenderItems)
@@ -564,6 +1223,8 @@ void Renderer::UpdateObjectConstantBuffers()
 
 void Renderer::UpdateMainPassConstantBuffer(Timer &timer)
 {
+	PROFILE_FUNCTION();
+
 	XMMATRIX view = m_Camera.GetView();
 	XMMATRIX proj = m_Camera.GetProj();
 
@@ -612,6 +1273,8 @@ void Renderer::UpdateMainPassConstantBuffer(Timer &timer)
 	m_MainPassCB.DeltaTime = timer.DeltaTime();
 	m_MainPassCB.EnableGI = g_RenderingSettings.GI.Enable;
 	m_MainPassCB.EnableIBL = g_RenderingSettings.EnableIBL;
+	m_MainPassCB.UseClipmap = g_RenderingSettings.GI.UseClipmap;
+	m_VXGIClipmap->FillPassConstants(m_MainPassCB);
 
 	m_MainPassCB.Jitter = XMFLOAT2(jitterX, jitterY);
 	m_MainPassCB.PreviousJitter = XMFLOAT2(m_PreviousJitterX, m_PreviousJitterY);
@@ -628,6 +1291,8 @@ void Renderer::UpdateMainPassConstantBuffer(Timer &timer)
 
 void Renderer::UpdateMaterialConstantBuffer()
 {
+	PROFILE_FUNCTION();
+
 	auto matCB = CurrFrameResource()->MatCB.get();
 
 	for (auto ritem : m_RenderItems)
@@ -640,6 +1305,8 @@ void Renderer::UpdateMaterialConstantBuffer()
 
 void Renderer::UpdateSSAOConstantBuffer()
 {
+	PROFILE_FUNCTION();
+
 	SSAOConstants ssaoCB;
 
 	XMMATRIX view = m_Camera.GetView();
@@ -675,6 +1342,8 @@ void Renderer::UpdateSSAOConstantBuffer()
 
 void Renderer::UpdateShadowPassCB()
 {
+	PROFILE_FUNCTION();
+
 	for (int i = 0; i < NUM_CASCADES; i++)
 	{
 		XMMATRIX viewProj = m_CascadedShadowMap->ViewProjMatrix(i);
@@ -684,6 +1353,14 @@ void Renderer::UpdateShadowPassCB()
 	}
 
 	m_ShadowPassCB.CascadeEnds[NUM_CASCADES] = m_CascadedShadowMap->CascadeEnds(NUM_CASCADES);
+
+	g_RenderingStats.Shadow.VisibleMinDepth = m_DepthReduction->MinDepth();
+	g_RenderingStats.Shadow.VisibleMaxDepth = m_DepthReduction->MaxDepth();
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		g_RenderingStats.Shadow.CascadeExtents[i] = m_CascadedShadowMap->CascadeRadius(i);
+		g_RenderingStats.Shadow.CascadeDepthRanges[i] = m_CascadedShadowMap->CascadeDepthRange(i);
+	}
 	m_ShadowPassCB.TransitionRatio = g_RenderingSettings.CascadeTransitionRatio;
 	m_ShadowPassCB.Softness = g_RenderingSettings.ShadowSoftness;
 	m_ShadowPassCB.ShowCascades = g_RenderingSettings.ShowCascades;
@@ -5,6 +5,7 @@
 #include "core/Window.h"
 #include "core/Timer.h"
 #include "core/MathHelper.h"
+#include "core/InitGraph.h"
 
 #include "dx/DxContext.h"
 #include "dx/Utils.h"
@@ -16,38 +17,41 @@
 #include "Light.h"
 #include "Mesh.h"
 #include "CascadedShadowMap.h"
+#include "DepthReduction.h"
+#include "ShadowCasterCulling.h"
 #include "EnvironmentMap.h"
 #include "RenderingUtils.h"
 #include "PipelineStates.h"
+#include "GpuProfiler.h"
 #include "SSAO.h"
 #include "TAA.h"
 #include "VXGI.h"
+#include "VXGIClipmap.h"
+#include "VoxelDirtyRegions.h"
+#include "CpuVoxelizer.h"
+#include "RenderItem.h"
+#include "IndirectDraw.h"
+#include "GeometryPool.h"
 
 #define SPONZA_SCENE 0
 #define TEST_SCENE (!SPONZA_SCENE)
 
-struct RenderItem
-{
-	XMFLOAT4X4 World = MathHelper::Identity4x4();
-
-	int NumFramesDirty = NUM_FRAMES_IN_FLIGHT;
-	UINT objCBIndex = -1;
-	UINT matCBIndex = -1;
-
-	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	Ref<Mesh> Mesh;
-};
-
 struct Renderer
 {
 public:
-	Renderer(Ref<DxContext> dxContext, UINT width, UINT height);
+	Renderer(UINT width, UINT height);
 	~Renderer()
 	{
+#ifdef ENABLE_PROFILER
+		GpuProfiler::Cleanup();
+#endif
 		PipelineStates::Cleanup();
 	}
 
-	void Setup();
+	// Adds the steps that set the renderer up to the startup graph, to run after a step "DxContext"
+	// that creates dxContext. The assets are read and the shaders compiled on worker threads.
+	void AddInitSteps(InitGraph &graph, const Ref<DxContext> &dxContext);
+
 	void OnUpdate(Timer &timer);
 
 	void BeginFrame();
@@ -61,8 +65,16 @@ public:
 	void OnMouseInput(int dxPixel, int dyPixel);
 
 	Light &GetDirectionalLight() { return m_Lights[0]; }
+	Camera &GetCamera() { return m_Camera; }
+
+	// WASD moves the camera unless it is scripted
+	void SetInputEnabled(bool enabled) { m_InputEnabled = enabled; }
+
+	// time the last frame spent waiting for its frame resource and in Present
+	double GetWaitTimeMs() const { return m_WaitTimeMs; }
 
 private:
+	void Init(Ref<DxContext> dxContext);
 	void BuildResources();
 	void AllocateDescriptors();
 	void BuildDescriptors();
@@ -77,16 +89,31 @@ private:
 	void UpdateShadowPassCB();
 
 	void BuildLightingDataBuffer();
+	void LoadScene();
 	void BuildRenderItems();
+	void BakeVoxels();
+	void BuildVoxelBricks();
+	void LoadEnvironmentMap();
+	void BuildShadowCasterBounds();
+	void UpdateShadowCasterBounds();
+	void CullShadowCasters();
+	void UpdateVoxelDirtyRegions();
+	void UpdateVoxelClipmap();
+	bool VoxelLightingChanged();
+	void BuildIndirectDrawCommands();
 
 	void GBufferPass(GraphicsCommandList commandList);
 	void DeferredLightingPass(GraphicsCommandList commandList);
 
 	void ShadowMapPass(GraphicsCommandList commandList);
 	void DrawRenderItems(GraphicsCommandList commandList, bool transparent = false);
+	void DrawRenderItemsIndirect(GraphicsCommandList commandList, const IndirectDrawList &drawList, UINT firstCommand = 0);
+	void DrawSubMeshes(GraphicsCommandList commandList, const std::vector<SubMeshRef> &subMeshes);
+	void DrawShadowCasters(GraphicsCommandList commandList, UINT cascade, bool staticCasters);
 	void DrawSkybox(GraphicsCommandList commandList);
 
 	void VoxelizeScene(GraphicsCommandList commandList);
+	void VoxelizeClipmap(GraphicsCommandList commandList);
 	void DebugVoxel(GraphicsCommandList commandList);
 
 	// divide the whole window into 4x4 grid, and draw the texture at slot <slot>
@@ -108,10 +135,32 @@ private:
 	ShadowPassConstants m_ShadowPassCB;
 
 	Camera m_Camera;
+	bool m_InputEnabled = true;
+	double m_WaitTimeMs = 0.0;
 	std::unique_ptr<CascadedShadowMap> m_CascadedShadowMap;
+	std::unique_ptr<DepthReduction> m_DepthReduction;
+
+	// the shadow cascades are fitted to the submeshes, their local bounds and render items
+	std::vector<BoundingBox> m_SubMeshBounds;
+	std::vector<SubMeshRef> m_ShadowCasters;
+	std::vector<BoundingBox> m_ShadowCasterBounds;
+
+	// the casters of each cascade, the static ones are cached, the dynamic ones drawn on top every frame
+	ShadowCasterCulling m_ShadowCasterCulling;
+	std::vector<UINT> m_VisibleCasters;
+	std::vector<SubMeshRef> m_StaticCascadeCasters[NUM_CASCADES];
+	std::vector<SubMeshRef> m_DynamicCascadeCasters[NUM_CASCADES];
+	IndirectDrawList m_StaticCasterDrawLists[NUM_CASCADES];
+	IndirectDrawList m_DynamicCasterDrawLists[NUM_CASCADES];
+	UINT m_StaticCasterFirstCommands[NUM_CASCADES] = {};
+	UINT m_DynamicCasterFirstCommands[NUM_CASCADES] = {};
+	bool m_CascadeHasDynamicCasters[NUM_CASCADES] = {}; // drawn into the shadow map on top of the copy
+
+	std::unique_ptr<GeometryPool> m_GeometryPool;
 
 	Ref<Mesh> m_Skybox;
 	std::vector<Ref<RenderItem>> m_RenderItems;
+	IndirectDrawList m_OpaqueDrawList;
 
 	std::unique_ptr<SSAO> m_SSAO;
 	std::unique_ptr<EnvironmentMap> m_EnvironmentMap;
@@ -119,6 +168,20 @@ private:
 	std::unique_ptr<PostProcessing> m_PostProcessing;
 	std::unique_ptr<VXGI> m_VXGI;
 
+	// static geometry is voxelized once, afterwards only dirty bricks are revoxelized
+	VoxelDirtyRegions m_VoxelDirtyRegions;
+	std::vector<BoundingBox> m_RenderItemBounds;
+	VoxelVolume m_VoxelBake; // until it is uploaded
+	BrickOccupancy m_VoxelBakeOccupancy;
+	XMFLOAT4 m_VoxelizedSunDirection = {};
+	float m_VoxelizedSunIntensity = 0.0f;
+	bool m_VoxelSceneReady = false;
+
+	// the clipmap follows the camera and revoxelizes the slabs scrolled in and the moved items
+	std::unique_ptr<VXGIClipmap> m_VXGIClipmap;
+	std::vector<BoundingBox> m_ClipmapItemBounds;
+	bool m_VoxelClipmapActive = false;
+
 	std::vector<Light> m_Lights;
 
 	Texture m_GBufferAlbedo;
@@ -10,22 +10,37 @@ enum class Antialising
 struct VXGISettings
 {
 	bool Enable = true;
+	bool UseClipmap = true; // camera centred clipmap instead of the fixed voxel grid
 	bool DynamicUpdate = true;
 	bool SecondBounce = true;
 	bool DebugVoxel = false;
 	int DebugVoxelMipLevel = 0;
+	int UpdateBudget = 1024; // bricks revoxelized per frame
+
+	// time slicing of the second bounce of the static bricks
+	int SecondBounceSchedule = 0; // VoxelSchedulePattern
+	float SecondBounceFraction = 0.125f; // of the bricks refreshed per frame
+	int SecondBounceBudget = 2048; // bricks refreshed per frame at most
+	float SecondBounceBlend = 0.5f; // weight of the new value of a refreshed brick
 };
 
 struct RenderingSettings
 {
 	// Display Settings
 	bool EnableVSync = false;
+	int FrameRateLimit = 0; // frames per second, 0 for no limit
+	bool SmoothDeltaTime = true; // average the delta time over the last frames
 	bool EnableIBL = false;
+	bool UseIndirectDraw = true;
 
 	// Shadow Settings
 	float MaxShadowDistance = 100.f;
 	float CascadeRangeScale = 1.5f;
 	float CascadeTransitionRatio = 0.2f;
+	bool FitCascadesToScene = true; // splits and cascade volumes from the caster bounds
+	bool FitCascadesToDepth = true; // splits from the depth range of the visible pixels as well
+	bool CacheStaticShadows = true; // redraw the static casters of a cascade only when its projection changes
+	int DistantCascadeInterval = 1; // frames the last two cascades may keep their projection while it covers the view
 	float ShadowSoftness = 0.6;
 	bool ShowCascades = false;
 	bool UseVogelDiskSample = true;
@@ -47,4 +62,41 @@ struct RenderingSettings
 	// float SunTheta = 240;
 	// float SunPhi = 40;
 	// float SunLightIntensity = 4.0f;
+};
+
+// Per frame numbers written by the renderer and shown in the UI
+struct VXGIStats
+{
+	int DirtyBricks = 0;
+	int UpdatedBricks = 0;
+	int VoxelsTouched = 0;
+	int SecondBounceBricks = 0;
+	int SecondBounceSlices = 0;
+	int Dispatches = 0;
+};
+
+struct ShadowStats
+{
+	float VisibleMinDepth = 0.0f; // depth reduction read back, both zero until there is one
+	float VisibleMaxDepth = 0.0f;
+	float CascadeExtents[4] = {}; // half extent of the square each cascade covers
+	float CascadeDepthRanges[4] = {}; // light space depth range of each cascade
+	int CascadeRedraws = 0; // cascades whose static casters were redrawn this frame
+	int ShadowCasters = 0; // opaque submeshes
+	int DynamicCasters = 0; // of them belonging to items that are not static
+	int CascadeCasters[4] = {}; // casters left in each cascade after culling
+};
+
+struct PacingStats
+{
+	float DeadlineErrorP50 = 0.0f; // us the frame pacer returned after the deadline, over the last frames
+	float DeadlineErrorP99 = 0.0f;
+	float SpinMargin = 0.0f; // ms
+};
+
+struct RenderingStats
+{
+	VXGIStats GI;
+	ShadowStats Shadow;
+	PacingStats Pacing;
 };
\ No newline at end of file
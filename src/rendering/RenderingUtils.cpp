@@ -3,47 +3,9 @@
 #include "dx/Utils.h"
 #include "PipelineStates.h"
 
-Texture RenderingUtils::ComputeDiffuseIrradianceCubemap(Ref<DxContext> dxContext, Texture &inputTex)
-{
-	LOG_INFO("Computing diffuse irradiance cubemp...");
-
-	auto device = dxContext->GetDevice();
-	auto commandList = dxContext->GetCommandList();
-	auto &heap = dxContext->GetCbvSrvUavHeap();
-
-	Texture outputTex = Texture::Create(device, 32, 32, 6, DXGI_FORMAT_R32G32B32A32_FLOAT, 1);
-	outputTex.Srv = heap.Alloc();
-	outputTex.CreateSrv(device, D3D12_SRV_DIMENSION_TEXTURECUBE, 0, 1);
-
-	DescriptorHeapMark mark(heap);
-	outputTex.Uav = heap.Alloc();
-	outputTex.CreateUav(device, 0);
-
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
-
-	ID3D12DescriptorHeap *descriptorHeaps[] = {heap.Heap.Get()};
-	commandList->SetDescriptorHeaps(1, descriptorHeaps);
-
-	commandList->SetPipelineState(PipelineStates::GetPSO("irmap"));
-	commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
-
-	UINT resources[] = {inputTex.Srv.Index, outputTex.Uav.Index};
-	commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
-
-	commandList->Dispatch(outputTex.Width / 32, outputTex.Height / 32, 6);
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON));
-
-	dxContext->ExecuteCommandList();
-	dxContext->Flush();
-
-	return outputTex;
-}
-
 Texture RenderingUtils::ComputePrefilteredSpecularEnvironmentMap(Ref<DxContext> dxContext, Texture &inputTex)
 {
-	LOG_INFO("Computing pre-filtered specular environment map...");
+	LOG_CHANNEL_INFO(IBL, "Computing pre-filtered specular environment map...");
 
 	auto device = dxContext->GetDevice();
 	auto commandList = dxContext->GetCommandList();
@@ -67,7 +29,7 @@ Texture RenderingUtils::ComputePrefilteredSpecularEnvironmentMap(Ref<DxContext>
 			CD3DX12_RESOURCE_BARRIER::Transition(inputTex.Resource.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
 		};
 
-	commandList->ResourceBarrier(2, preCopyBarriers);
+	Utils::ResourceBarrier(commandList, 2, preCopyBarriers);
 	for (UINT arraySlice = 0; arraySlice < 6; arraySlice++)
 	{
 		auto subresourceIndex = D3D12CalcSubresource(0, arraySlice, 0, outputTex.Levels, 6);
@@ -77,13 +39,13 @@ Texture RenderingUtils::ComputePrefilteredSpecularEnvironmentMap(Ref<DxContext>
 			&CD3DX12_TEXTURE_COPY_LOCATION(inputTex.Resource.Get(), subresourceIndex),
 			nullptr);
 	}
-	commandList->ResourceBarrier(2, postCopyBarriers);
+	Utils::ResourceBarrier(commandList, 2, postCopyBarriers);
 
 	// pre-filter rest of the mip chain
 	ID3D12DescriptorHeap *descriptorHeaps[] = {heap.Heap.Get()};
 	commandList->SetDescriptorHeaps(1, descriptorHeaps);
 
-	commandList->SetPipelineState(PipelineStates::GetPSO("spmap"));
+	PipelineStates::SetPSO(commandList, "spmap");
 	commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
 
 	const float deltaRoughness = 1.0f / std::max(float(outputTex.Levels - 1), 1.0f);
@@ -100,8 +62,8 @@ Texture RenderingUtils::ComputePrefilteredSpecularEnvironmentMap(Ref<DxContext>
 
 		commandList->Dispatch(numGroups, numGroups, 6);
 	}
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON));
 
 	dxContext->ExecuteCommandList();
 	dxContext->Flush();
@@ -111,7 +73,7 @@ Texture RenderingUtils::ComputePrefilteredSpecularEnvironmentMap(Ref<DxContext>
 
 Texture RenderingUtils::ComputeBRDFLookUpTable(Ref<DxContext> dxContext)
 {
-	LOG_INFO("Computing BRDF 2D LUT for split-sum approximation...");
+	LOG_CHANNEL_INFO(IBL, "Computing BRDF 2D LUT for split-sum approximation...");
 
 	auto device = dxContext->GetDevice();
 	auto commandList = dxContext->GetCommandList();
@@ -125,21 +87,21 @@ Texture RenderingUtils::ComputeBRDFLookUpTable(Ref<DxContext> dxContext)
 	outputTex.Uav = heap.Alloc();
 	outputTex.CreateUav(device, 0);
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
 	ID3D12DescriptorHeap *descriptorHeaps[] = {heap.Heap.Get()};
 	commandList->SetDescriptorHeaps(1, descriptorHeaps);
 
-	commandList->SetPipelineState(PipelineStates::GetPSO("spbrdf"));
+	PipelineStates::SetPSO(commandList, "spbrdf");
 	commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
 
 	UINT resources[] = {outputTex.Uav.Index};
 	commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
 
 	commandList->Dispatch(outputTex.Width / 32, outputTex.Height / 32, 1);
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(),
-																		  D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON));
 
 	dxContext->ExecuteCommandList();
 	dxContext->Flush();
@@ -149,7 +111,7 @@ Texture RenderingUtils::ComputeBRDFLookUpTable(Ref<DxContext> dxContext)
 
 Texture RenderingUtils::Equirect2Cubemap(Ref<DxContext> dxContext, Texture &inputTex)
 {
-	LOG_INFO("Converting equirect texture to cubemp...");
+	LOG_CHANNEL_INFO(IBL, "Converting equirect texture to cubemp...");
 
 	auto commandList = dxContext->GetCommandList();
 	auto device = dxContext->GetDevice();
@@ -166,12 +128,12 @@ Texture RenderingUtils::Equirect2Cubemap(Ref<DxContext> dxContext, Texture &inpu
 	inputTex.Srv = cbvSrvUavHeap.Alloc();
 	inputTex.CreateSrv(device, D3D12_SRV_DIMENSION_TEXTURE2D, 0, 1);
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(outputTex.Resource.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
 	ID3D12DescriptorHeap *descriptorHeaps[] = {cbvSrvUavHeap.Heap.Get()};
 	commandList->SetDescriptorHeaps(1, descriptorHeaps);
 
-	commandList->SetPipelineState(PipelineStates::GetPSO("equirect2Cube"));
+	PipelineStates::SetPSO(commandList, "equirect2Cube");
 	commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
 
 	UINT resources[] = {inputTex.Srv.Index, outputTex.Uav.Index};
@@ -179,9 +141,9 @@ Texture RenderingUtils::Equirect2Cubemap(Ref<DxContext> dxContext, Texture &inpu
 
 	commandList->Dispatch(outputTex.Width / 32, outputTex.Height / 32, 6);
 
-	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
-										outputTex.Resource.Get(),
-										D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON));
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(
+										   outputTex.Resource.Get(),
+										   D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON));
 
 	dxContext->ExecuteCommandList();
 	dxContext->Flush();
@@ -202,7 +164,7 @@ void RenderingUtils::GenerateMipmaps(Ref<DxContext> dxContext, Texture &texture)
 
 	DescriptorHeapMark mark(cbvSrvUavHeap);
 
-	LOG_INFO("Generating mipmap for the environment map...");
+	LOG_CHANNEL_INFO(IBL, "Generating mipmap for the environment map...");
 
 	auto desc = texture.Resource->GetDesc();
 	auto depth = desc.DepthOrArraySize;
@@ -210,7 +172,7 @@ void RenderingUtils::GenerateMipmaps(Ref<DxContext> dxContext, Texture &texture)
 	ID3D12DescriptorHeap *heaps[] = {cbvSrvUavHeap.Heap.Get()};
 	commandList->SetDescriptorHeaps(1, heaps);
 
-	commandList->SetPipelineState(PipelineStates::GetPSO("mipmap"));
+	PipelineStates::SetPSO(commandList, "mipmap");
 	commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
 
 	std::vector<CD3DX12_RESOURCE_BARRIER> preDispatchBarriers(depth);
@@ -236,7 +198,7 @@ void RenderingUtils::GenerateMipmaps(Ref<DxContext> dxContext, Texture &texture)
 																					D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, subresourceIndex);
 		}
 
-		commandList->ResourceBarrier(depth, preDispatchBarriers.data());
+		Utils::ResourceBarrier(commandList, depth, preDispatchBarriers.data());
 
 		UINT resources[] = {tempTex.Srv.Index, tempTex.Uav.Index};
 		commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
@@ -244,7 +206,7 @@ void RenderingUtils::GenerateMipmaps(Ref<DxContext> dxContext, Texture &texture)
 		UINT threadGroupCount = std::max<UINT>(levelWidth / 8, 1);
 		commandList->Dispatch(threadGroupCount, threadGroupCount, depth);
 
-		commandList->ResourceBarrier(depth, postDispatchBarriers.data());
+		Utils::ResourceBarrier(commandList, depth, postDispatchBarriers.data());
 	}
 
 	dxContext->ExecuteCommandList();
@@ -264,4 +226,109 @@ float RenderingUtils::Halton(UINT i, UINT b)
 	}
 
 	return r;
-}
\ No newline at end of file
+}
+Texture RenderingUtils::CreateTexture(Ref<DxContext> dxContext, const TextureData &data)
+{
+	auto device = dxContext->GetDevice();
+	auto commandList = dxContext->GetCommandList();
+
+	Texture texture = Texture::Create(device, data.Width, data.Height, data.ArraySize, data.Format, data.Levels);
+
+	const UINT numSubresources = data.ArraySize * data.Levels;
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources(numSubresources);
+
+	for (UINT arraySlice = 0; arraySlice < data.ArraySize; arraySlice++)
+	{
+		for (UINT level = 0; level < data.Levels; level++)
+		{
+			auto &sub = subresources[D3D12CalcSubresource(level, arraySlice, 0, data.Levels, data.ArraySize)];
+			sub.pData = data.Data.data() + data.SubresourceOffset(arraySlice, level);
+			sub.RowPitch = data.RowPitch(level);
+			sub.SlicePitch = data.SubresourceSize(level);
+		}
+	}
+
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(texture.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+
+	dxContext->GetStagingManager().CopyToTexture(commandList, texture.Resource.Get(), 0, numSubresources, subresources.data());
+
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(texture.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON));
+
+	return texture;
+}
+
+TextureData RenderingUtils::ReadbackTexture(Ref<DxContext> dxContext, Texture &texture)
+{
+	auto device = dxContext->GetDevice();
+	auto commandList = dxContext->GetCommandList();
+
+	const D3D12_RESOURCE_DESC desc = texture.Resource->GetDesc();
+
+	TextureData data;
+	data.Width = (UINT)desc.Width;
+	data.Height = desc.Height;
+	data.ArraySize = desc.DepthOrArraySize;
+	data.Levels = desc.MipLevels;
+	data.Format = desc.Format;
+	data.IsCubemap = desc.DepthOrArraySize == 6;
+	data.Allocate();
+
+	const UINT numSubresources = data.ArraySize * data.Levels;
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(numSubresources);
+	std::vector<UINT> numRows(numSubresources);
+	std::vector<UINT64> rowSizes(numSubresources);
+	UINT64 totalBytes = 0;
+
+	device->GetCopyableFootprints(&desc, 0, numSubresources, 0, footprints.data(), numRows.data(), rowSizes.data(), &totalBytes);
+
+	Resource readbackBuffer;
+	ThrowIfFailed(GpuMemory::CreateCommittedResource(device.Get(),
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(totalBytes),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&readbackBuffer)));
+
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(texture.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE));
+
+	for (UINT i = 0; i < numSubresources; i++)
+	{
+		commandList->CopyTextureRegion(
+			&CD3DX12_TEXTURE_COPY_LOCATION(readbackBuffer.Get(), footprints[i]),
+			0, 0, 0,
+			&CD3DX12_TEXTURE_COPY_LOCATION(texture.Resource.Get(), i),
+			nullptr);
+	}
+
+	Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(texture.Resource.Get(),
+																			 D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON));
+
+	dxContext->ExecuteCommandList();
+	dxContext->Flush();
+
+	// strip the row padding required by the copy footprints
+	BYTE *mapped = nullptr;
+	ThrowIfFailed(readbackBuffer->Map(0, &CD3DX12_RANGE(0, totalBytes), reinterpret_cast<void **>(&mapped)));
+
+	for (UINT arraySlice = 0; arraySlice < data.ArraySize; arraySlice++)
+	{
+		for (UINT level = 0; level < data.Levels; level++)
+		{
+			UINT i = D3D12CalcSubresource(level, arraySlice, 0, data.Levels, data.ArraySize);
+			BYTE *dest = data.Subresource<BYTE>(arraySlice, level);
+
+			for (UINT row = 0; row < numRows[i]; row++)
+				memcpy(dest + row * data.RowPitch(level),
+					   mapped + footprints[i].Offset + row * footprints[i].Footprint.RowPitch,
+					   data.RowPitch(level));
+		}
+	}
+
+	readbackBuffer->Unmap(0, &CD3DX12_RANGE(0, 0));
+
+	return data;
+}
@@ -4,17 +4,21 @@
 #include "dx/dx.h"
 #include "dx/DxContext.h"
 #include "dx/Texture.h"
+#include "asset/DDS.h"
 
 class RenderingUtils
 {
 public:
 	static Texture Equirect2Cubemap(Ref<DxContext> dxContext, Texture &inputTex);
 
-	static Texture ComputeDiffuseIrradianceCubemap(Ref<DxContext> dxContext, Texture &inputTex);
 	static Texture ComputePrefilteredSpecularEnvironmentMap(Ref<DxContext> dxContext, Texture &inputTex);
 	static Texture ComputeBRDFLookUpTable(Ref<DxContext> dxContext);
 
 	static void GenerateMipmaps(Ref<DxContext> dxContext, Texture &texture);
 
+	// GPU <-> CPU transfers of every subresource, used by the IBL cache
+	static Texture CreateTexture(Ref<DxContext> dxContext, const TextureData &data);
+	static TextureData ReadbackTexture(Ref<DxContext> dxContext, Texture &texture);
+
 	static float Halton(UINT i, UINT b);
 };
@@ -1,10 +1,13 @@
 #include "pch.h"
 #include "SSAO.h"
 #include "dx/Utils.h"
+#include "PipelineStates.h"
 
 SSAO::SSAO(Ref<DxContext> dxContext, UINT width, UINT height)
 	: m_Device(dxContext->GetDevice()), m_RenderTargetWidth(width), m_RenderTargetHeight(height)
 {
+	GpuMemoryScope memoryScope(GpuMemoryCategory::RenderTarget);
+
 	BuildRootSignature();
 	BuildPSOs();
 
@@ -92,8 +95,8 @@ void SSAO::ComputeSSAO(GraphicsCommandList cmdList, Texture normalMap, Descripto
 	// We compute the initial SSAO to AmbientMap0.
 
 	// Change to RENDER_TARGET.
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_AmbientMap0.Resource.Get(),
-																	  D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	Utils::ResourceBarrier(cmdList, CD3DX12_RESOURCE_BARRIER::Transition(m_AmbientMap0.Resource.Get(),
+																		 D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
 	float clearValue[] = {1.0f, 1.0f, 1.0f, 1.0f};
 	cmdList->ClearRenderTargetView(m_AmbientMap0.Rtv.CPUHandle, clearValue, 0, nullptr);
@@ -102,7 +105,7 @@ void SSAO::ComputeSSAO(GraphicsCommandList cmdList, Texture normalMap, Descripto
 	cmdList->OMSetRenderTargets(1, &m_AmbientMap0.Rtv.CPUHandle, true, nullptr);
 
 	cmdList->SetGraphicsRootSignature(m_SSAORootSig.Get());
-	cmdList->SetPipelineState(m_SSAOPso.Get());
+	PipelineStates::SetPSO(cmdList, m_SSAOPso.Get());
 
 	// Bind the constant buffer for this pass.
 	auto ssaoCBAddress = currFrame->SSAOCB->GetResource()->GetGPUVirtualAddress();
@@ -117,18 +120,19 @@ void SSAO::ComputeSSAO(GraphicsCommandList cmdList, Texture normalMap, Descripto
 	cmdList->IASetVertexBuffers(0, 0, nullptr);
 	cmdList->IASetIndexBuffer(nullptr);
 	cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	COUNTER_ADD("Draw Calls", 1);
 	cmdList->DrawInstanced(6, 1, 0, 0);
 
 	// Change back to GENERIC_READ so we can read the texture in a shader.
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_AmbientMap0.Resource.Get(),
-																	  D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON));
+	Utils::ResourceBarrier(cmdList, CD3DX12_RESOURCE_BARRIER::Transition(m_AmbientMap0.Resource.Get(),
+																		 D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON));
 
 	BlurAmbientMap(cmdList, normalMap, currFrame, blurCount);
 }
 
 void SSAO::BlurAmbientMap(GraphicsCommandList cmdList, Texture normalMap, FrameResource *currFrame, int blurCount)
 {
-	cmdList->SetPipelineState(m_BlurPso.Get());
+	PipelineStates::SetPSO(cmdList, m_BlurPso.Get());
 
 	auto ssaoCBAddress = currFrame->SSAOCB->GetResource()->GetGPUVirtualAddress();
 	cmdList->SetGraphicsRootConstantBufferView(0, ssaoCBAddress);
@@ -163,8 +167,8 @@ void SSAO::BlurAmbientMap(GraphicsCommandList cmdList, Texture normalMap, bool h
 		cmdList->SetGraphicsRoot32BitConstant(1, 0, 0);
 	}
 
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(output,
-																	  D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	Utils::ResourceBarrier(cmdList, CD3DX12_RESOURCE_BARRIER::Transition(output,
+																		 D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
 	float clearValue[] = {1.0f, 1.0f, 1.0f, 1.0f};
 	cmdList->ClearRenderTargetView(outputRtv, clearValue, 0, nullptr);
@@ -183,10 +187,11 @@ void SSAO::BlurAmbientMap(GraphicsCommandList cmdList, Texture normalMap, bool h
 	cmdList->IASetVertexBuffers(0, 0, nullptr);
 	cmdList->IASetIndexBuffer(nullptr);
 	cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	COUNTER_ADD("Draw Calls", 1);
 	cmdList->DrawInstanced(6, 1, 0, 0);
 
-	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(output,
-																	  D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON));
+	Utils::ResourceBarrier(cmdList, CD3DX12_RESOURCE_BARRIER::Transition(output,
+																		 D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COMMON));
 }
 
 void SSAO::BuildRootSignature()
@@ -242,11 +247,11 @@ void SSAO::BuildRootSignature()
 
 void SSAO::BuildPSOs()
 {
-	Shader ssaoVSByteCode = Utils::CompileShader(L"Shaders\\ssao.hlsl", nullptr, L"VS", L"vs_6_6");
-	Shader ssaoPSByteCode = Utils::CompileShader(L"Shaders\\ssao.hlsl", nullptr, L"PS", L"ps_6_6");
+	Shader ssaoVSByteCode = Utils::CompileShader(ShaderTable::SSAOVS);
+	Shader ssaoPSByteCode = Utils::CompileShader(ShaderTable::SSAOPS);
 
-	Shader ssaoBlurVSByteCode = Utils::CompileShader(L"Shaders\\ssaoBlur.hlsl", nullptr, L"VS", L"vs_6_6");
-	Shader ssaoBlurPSByteCode = Utils::CompileShader(L"Shaders\\ssaoBlur.hlsl", nullptr, L"PS", L"ps_6_6");
+	Shader ssaoBlurVSByteCode = Utils::CompileShader(ShaderTable::SSAOBlurVS);
+	Shader ssaoBlurPSByteCode = Utils::CompileShader(ShaderTable::SSAOBlurPS);
 
 	//
 	// PSO for SSAO.
@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "ShadowCascadeCache.h"
+
+void ShadowCascadeCache::Update(CascadeFit &fit, FXMVECTOR lightDir, const ShadowCacheSettings &settings)
+{
+	XMVECTOR direction = XMVector3Normalize(lightDir);
+	if (!SameDirection(direction, XMLoadFloat3(&m_LightDirection), settings.DirectionEpsilon))
+	{
+		Invalidate();
+		XMStoreFloat3(&m_LightDirection, direction);
+	}
+
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		Entry &entry = m_Entries[i];
+		entry.Age++;
+
+		bool keep = entry.Valid && SameProjection(entry.ViewProj, fit.ViewProj[i], settings.MatrixEpsilon);
+
+		// a distant cascade may cover a few frames of camera motion before it is refitted
+		if (!keep && entry.Valid && i >= settings.FirstDistantCascade && entry.Age < settings.DistantInterval)
+			keep = Covers(entry, fit, i);
+
+		m_Redraw[i] = !keep;
+		if (keep)
+		{
+			fit.ViewProj[i] = entry.ViewProj;
+			fit.Center[i] = entry.Center;
+			fit.Radius[i] = entry.Radius;
+			fit.LightNear[i] = entry.LightNear;
+			fit.LightFar[i] = entry.LightFar;
+			continue;
+		}
+
+		entry.ViewProj = fit.ViewProj[i];
+		entry.Center = fit.Center[i];
+		entry.Radius = fit.Radius[i];
+		entry.LightNear = fit.LightNear[i];
+		entry.LightFar = fit.LightFar[i];
+		entry.Age = 0;
+		entry.Valid = true;
+	}
+}
+
+void ShadowCascadeCache::Invalidate()
+{
+	for (auto &entry : m_Entries)
+		entry.Valid = false;
+}
+
+int ShadowCascadeCache::RedrawCount() const
+{
+	int count = 0;
+	for (int i = 0; i < NUM_CASCADES; i++)
+		count += m_Redraw[i] ? 1 : 0;
+	return count;
+}
+
+bool ShadowCascadeCache::SameDirection(FXMVECTOR a, FXMVECTOR b, float epsilon)
+{
+	return 1.0f - XMVectorGetX(XMVector3Dot(a, b)) <= epsilon;
+}
+
+bool ShadowCascadeCache::SameProjection(FXMMATRIX a, CXMMATRIX b, float epsilon)
+{
+	XMVECTOR e = XMVectorReplicate(epsilon);
+	for (int i = 0; i < 4; i++)
+	{
+		if (!XMVector4NearEqual(a.r[i], b.r[i], e))
+			return false;
+	}
+	return true;
+}
+
+bool ShadowCascadeCache::Covers(const Entry &entry, const CascadeFit &fit, int cascade) const
+{
+	// both squares are in the same light space, the sun did not turn
+	const XMFLOAT2 &center = fit.Center[cascade];
+	float radius = fit.Radius[cascade];
+
+	return fabsf(center.x - entry.Center.x) + radius <= entry.Radius &&
+		   fabsf(center.y - entry.Center.y) + radius <= entry.Radius &&
+		   entry.LightNear <= fit.LightNear[cascade] && fit.LightFar[cascade] <= entry.LightFar;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "pch.h"
+#include "CascadeFitting.h"
+
+struct ShadowCacheSettings
+{
+	float DirectionEpsilon = 1.0e-4f; // 1 - cosine of the angle the sun may turn before every cascade is redrawn
+	float MatrixEpsilon = 1.0e-5f; // per element, absorbs the rounding of an unchanged snapped projection
+
+	// the cascades from FirstDistantCascade on keep their projection for up to DistantInterval frames
+	// as long as it still covers the fitted one, 1 refits them every frame like the others
+	int FirstDistantCascade = 2;
+	int DistantInterval = 1;
+};
+
+// Decides which shadow cascades need their static casters redrawn. The static casters of every
+// cascade are kept in a separate depth layer, which only has to be redrawn when the snapped
+// projection of the cascade changed, the sun turned or a static caster moved. Otherwise the layer
+// is copied into the shadow map as it is and only the dynamic casters are drawn on top of it.
+class ShadowCascadeCache
+{
+public:
+	// compares the fitted cascades with the cached ones; a cascade that is not redrawn keeps the
+	// cached projection the layer was drawn with, which is written back into fit
+	void Update(CascadeFit &fit, FXMVECTOR lightDir, const ShadowCacheSettings &settings);
+
+	// redraws every cascade with the next update, e.g. after a static caster moved
+	void Invalidate();
+
+	bool NeedsRedraw(int cascade) const { return m_Redraw[cascade]; }
+	int RedrawCount() const;
+
+	static bool SameDirection(FXMVECTOR a, FXMVECTOR b, float epsilon);
+	static bool SameProjection(FXMMATRIX a, CXMMATRIX b, float epsilon);
+
+private:
+	struct Entry
+	{
+		XMMATRIX ViewProj;
+		XMFLOAT2 Center;
+		float Radius;
+		float LightNear;
+		float LightFar;
+		int Age = 0; // frames since the layer was redrawn
+		bool Valid = false;
+	};
+
+	bool Covers(const Entry &entry, const CascadeFit &fit, int cascade) const;
+
+private:
+	Entry m_Entries[NUM_CASCADES];
+	bool m_Redraw[NUM_CASCADES] = {};
+	XMFLOAT3 m_LightDirection = {0.0f, 0.0f, 0.0f};
+};
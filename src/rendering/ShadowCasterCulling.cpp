@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "ShadowCasterCulling.h"
+
+void ShadowCasterCulling::SetCasters(const std::vector<BoundingBox> &bounds, FXMMATRIX lightView)
+{
+	m_Count = bounds.size();
+	size_t padded = (m_Count + 3) & ~size_t(3);
+
+	m_MinX.assign(padded, FLT_MAX);
+	m_MaxX.assign(padded, -FLT_MAX);
+	m_MinY.assign(padded, FLT_MAX);
+	m_MaxY.assign(padded, -FLT_MAX);
+	m_MinZ.assign(padded, FLT_MAX);
+
+	for (size_t i = 0; i < m_Count; i++)
+	{
+		BoundingBox boundsLS;
+		bounds[i].Transform(boundsLS, lightView);
+
+		m_MinX[i] = boundsLS.Center.x - boundsLS.Extents.x;
+		m_MaxX[i] = boundsLS.Center.x + boundsLS.Extents.x;
+		m_MinY[i] = boundsLS.Center.y - boundsLS.Extents.y;
+		m_MaxY[i] = boundsLS.Center.y + boundsLS.Extents.y;
+		m_MinZ[i] = boundsLS.Center.z - boundsLS.Extents.z;
+	}
+}
+
+void ShadowCasterCulling::Cull(const CasterCullVolume &volume, std::vector<UINT> &visible) const
+{
+	visible.clear();
+
+	// the square, narrowed to the outline's bounds if there is one
+	float minX = volume.Center.x - volume.Radius;
+	float maxX = volume.Center.x + volume.Radius;
+	float minY = volume.Center.y - volume.Radius;
+	float maxY = volume.Center.y + volume.Radius;
+	float farZ = volume.LightFar;
+
+	// separating axes of the outline, its range along each edge normal widened by the margin
+	struct Axis
+	{
+		XMVECTOR NormalX, NormalY, AbsX, AbsY, Min, Max;
+	};
+	Axis axes[MAX_OUTLINE_VERTICES];
+	int numAxes = 0;
+
+	if (volume.OutlineSize > 0)
+	{
+		float outlineMinX = FLT_MAX, outlineMaxX = -FLT_MAX;
+		float outlineMinY = FLT_MAX, outlineMaxY = -FLT_MAX;
+		for (int i = 0; i < volume.OutlineSize; i++)
+		{
+			outlineMinX = std::min(outlineMinX, volume.Outline[i].x);
+			outlineMaxX = std::max(outlineMaxX, volume.Outline[i].x);
+			outlineMinY = std::min(outlineMinY, volume.Outline[i].y);
+			outlineMaxY = std::max(outlineMaxY, volume.Outline[i].y);
+		}
+		minX = std::max(minX, outlineMinX - volume.Margin);
+		maxX = std::min(maxX, outlineMaxX + volume.Margin);
+		minY = std::max(minY, outlineMinY - volume.Margin);
+		maxY = std::min(maxY, outlineMaxY + volume.Margin);
+		farZ = std::min(farZ, volume.OutlineFar);
+
+		for (int i = 0; i < volume.OutlineSize; i++)
+		{
+			const XMFLOAT2 &a = volume.Outline[i];
+			const XMFLOAT2 &b = volume.Outline[(i + 1) % volume.OutlineSize];
+			float length = sqrtf((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+			float nx = (a.y - b.y) / length;
+			float ny = (b.x - a.x) / length;
+
+			float lo = FLT_MAX, hi = -FLT_MAX;
+			for (int k = 0; k < volume.OutlineSize; k++)
+			{
+				float d = nx * volume.Outline[k].x + ny * volume.Outline[k].y;
+				lo = std::min(lo, d);
+				hi = std::max(hi, d);
+			}
+
+			Axis &axis = axes[numAxes++];
+			axis.NormalX = XMVectorReplicate(nx);
+			axis.NormalY = XMVectorReplicate(ny);
+			axis.AbsX = XMVectorReplicate(fabsf(nx));
+			axis.AbsY = XMVectorReplicate(fabsf(ny));
+			axis.Min = XMVectorReplicate(lo - volume.Margin);
+			axis.Max = XMVectorReplicate(hi + volume.Margin);
+		}
+	}
+
+	XMVECTOR volumeMinX = XMVectorReplicate(minX);
+	XMVECTOR volumeMaxX = XMVectorReplicate(maxX);
+	XMVECTOR volumeMinY = XMVectorReplicate(minY);
+	XMVECTOR volumeMaxY = XMVectorReplicate(maxY);
+	XMVECTOR volumeFarZ = XMVectorReplicate(farZ);
+	XMVECTOR half = XMVectorReplicate(0.5f);
+
+	// four boxes at a time
+	for (size_t i = 0; i < m_MinX.size(); i += 4)
+	{
+		XMVECTOR boxMinX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&m_MinX[i]));
+		XMVECTOR boxMaxX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&m_MaxX[i]));
+		XMVECTOR boxMinY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&m_MinY[i]));
+		XMVECTOR boxMaxY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&m_MaxY[i]));
+		XMVECTOR boxMinZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&m_MinZ[i]));
+
+		XMVECTOR inside = XMVectorLessOrEqual(boxMinX, volumeMaxX);
+		inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(boxMaxX, volumeMinX));
+		inside = XMVectorAndInt(inside, XMVectorLessOrEqual(boxMinY, volumeMaxY));
+		inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(boxMaxY, volumeMinY));
+		inside = XMVectorAndInt(inside, XMVectorLess(boxMinZ, volumeFarZ));
+
+		if (numAxes > 0)
+		{
+			XMVECTOR centerX = (boxMinX + boxMaxX) * half;
+			XMVECTOR centerY = (boxMinY + boxMaxY) * half;
+			XMVECTOR extentX = (boxMaxX - boxMinX) * half;
+			XMVECTOR extentY = (boxMaxY - boxMinY) * half;
+
+			for (int k = 0; k < numAxes; k++)
+			{
+				const Axis &axis = axes[k];
+				XMVECTOR center = XMVectorMultiplyAdd(axis.NormalX, centerX, axis.NormalY * centerY);
+				XMVECTOR radius = XMVectorMultiplyAdd(axis.AbsX, extentX, axis.AbsY * extentY);
+
+				inside = XMVectorAndInt(inside, XMVectorLessOrEqual(center - radius, axis.Max));
+				inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(center + radius, axis.Min));
+			}
+		}
+
+		uint32_t mask[4];
+		XMStoreInt4(mask, inside);
+		for (int k = 0; k < 4; k++)
+		{
+			if (mask[k])
+				visible.push_back((UINT)(i + k));
+		}
+	}
+}
+
+void ShadowCasterCulling::ProjectionVolume(const CascadeFit &fit, int cascade, CasterCullVolume &volume)
+{
+	volume = {};
+	volume.Center = fit.Center[cascade];
+	volume.Radius = fit.Radius[cascade];
+	volume.LightFar = fit.LightFar[cascade];
+}
+
+void ShadowCasterCulling::SliceVolume(const Camera &camera, const CascadeFit &fit, int cascade, float transitionRatio,
+									  float margin, CasterCullVolume &volume)
+{
+	ProjectionVolume(fit, cascade, volume);
+
+	float sliceNear = fit.Ends[cascade];
+	float sliceFar = fit.Ends[cascade + 1];
+	if (cascade > 0)
+		sliceNear -= (fit.Ends[cascade] - fit.Ends[cascade - 1]) * transitionRatio;
+
+	float tanY = tanf(0.5f * camera.GetFovY());
+	float tanX = tanY * camera.GetAspect();
+
+	// corners of the slice in light space, sorted by x then y for the convex hull
+	XMFLOAT3 corners[8];
+	int numCorners = 0;
+	for (float z : {sliceNear, sliceFar})
+	{
+		for (float sx : {-1.0f, 1.0f})
+		{
+			for (float sy : {-1.0f, 1.0f})
+			{
+				XMVECTOR cornerWS = camera.GetPosition() + camera.GetLook() * z +
+									camera.GetRight() * (sx * z * tanX) + camera.GetUp() * (sy * z * tanY);
+				XMStoreFloat3(&corners[numCorners++], XMVector3TransformCoord(cornerWS, fit.LightView));
+			}
+		}
+	}
+
+	volume.OutlineFar = -FLT_MAX;
+	for (const auto &corner : corners)
+		volume.OutlineFar = std::max(volume.OutlineFar, corner.z);
+
+	std::sort(corners, corners + 8, [](const XMFLOAT3 &a, const XMFLOAT3 &b)
+			  { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+
+	// Andrew's monotone chain, the lower hull then the upper one
+	auto cross = [](const XMFLOAT2 &o, const XMFLOAT2 &a, const XMFLOAT3 &b)
+	{
+		return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+	};
+
+	XMFLOAT2 hull[2 * 8];
+	int size = 0;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		int start = size;
+		for (int k = 0; k < 8; k++)
+		{
+			const XMFLOAT3 &corner = corners[pass == 0 ? k : 7 - k];
+			while (size >= start + 2 && cross(hull[size - 2], hull[size - 1], corner) <= 0.0f)
+				size--;
+			hull[size++] = XMFLOAT2(corner.x, corner.y);
+		}
+		// the last point is the first of the other half
+		size--;
+	}
+
+	// a slice seen edge on gives no outline, the square still bounds it
+	if (size < 3)
+		return;
+
+	volume.OutlineSize = size;
+	for (int k = 0; k < size; k++)
+		volume.Outline[k] = hull[k];
+	volume.Margin = margin;
+}
+
+bool ShadowCasterCulling::IntersectsReference(const BoundingBox &boundsLS, const CasterCullVolume &volume)
+{
+	float boxMinZ = boundsLS.Center.z - boundsLS.Extents.z;
+	if (!(boxMinZ < volume.LightFar))
+		return false;
+	if (volume.OutlineSize > 0 && !(boxMinZ < volume.OutlineFar))
+		return false;
+
+	// the half planes bounding the volume: n.p <= d
+	std::vector<XMFLOAT3> planes = {
+		{1.0f, 0.0f, volume.Center.x + volume.Radius},
+		{-1.0f, 0.0f, -(volume.Center.x - volume.Radius)},
+		{0.0f, 1.0f, volume.Center.y + volume.Radius},
+		{0.0f, -1.0f, -(volume.Center.y - volume.Radius)},
+	};
+
+	for (int i = 0; i < volume.OutlineSize; i++)
+	{
+		const XMFLOAT2 &a = volume.Outline[i];
+		const XMFLOAT2 &b = volume.Outline[(i + 1) % volume.OutlineSize];
+		float length = sqrtf((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+		XMFLOAT2 n((a.y - b.y) / length, (b.x - a.x) / length);
+
+		float lo = FLT_MAX, hi = -FLT_MAX;
+		for (int k = 0; k < volume.OutlineSize; k++)
+		{
+			float d = n.x * volume.Outline[k].x + n.y * volume.Outline[k].y;
+			lo = std::min(lo, d);
+			hi = std::max(hi, d);
+		}
+		planes.push_back({n.x, n.y, hi + volume.Margin});
+		planes.push_back({-n.x, -n.y, -(lo - volume.Margin)});
+	}
+
+	if (volume.OutlineSize > 0)
+	{
+		float lo = FLT_MAX, hi = -FLT_MAX;
+		for (int k = 0; k < volume.OutlineSize; k++)
+		{
+			lo = std::min(lo, volume.Outline[k].x);
+			hi = std::max(hi, volume.Outline[k].x);
+		}
+		planes.push_back({1.0f, 0.0f, hi + volume.Margin});
+		planes.push_back({-1.0f, 0.0f, -(lo - volume.Margin)});
+
+		lo = FLT_MAX, hi = -FLT_MAX;
+		for (int k = 0; k < volume.OutlineSize; k++)
+		{
+			lo = std::min(lo, volume.Outline[k].y);
+			hi = std::max(hi, volume.Outline[k].y);
+		}
+		planes.push_back({0.0f, 1.0f, hi + volume.Margin});
+		planes.push_back({0.0f, -1.0f, -(lo - volume.Margin)});
+	}
+
+	// clip the box's rectangle against every half plane, it is visible if anything is left
+	const XMFLOAT3 &c = boundsLS.Center;
+	const XMFLOAT3 &e = boundsLS.Extents;
+	std::vector<XMFLOAT2> polygon = {{c.x - e.x, c.y - e.y}, {c.x + e.x, c.y - e.y}, {c.x + e.x, c.y + e.y}, {c.x - e.x, c.y + e.y}};
+
+	for (const auto &plane : planes)
+	{
+		std::vector<XMFLOAT2> clipped;
+		for (size_t i = 0; i < polygon.size(); i++)
+		{
+			const XMFLOAT2 &a = polygon[i];
+			const XMFLOAT2 &b = polygon[(i + 1) % polygon.size()];
+			float da = plane.x * a.x + plane.y * a.y - plane.z;
+			float db = plane.x * b.x + plane.y * b.y - plane.z;
+
+			if (da <= 0.0f)
+				clipped.push_back(a);
+			if ((da < 0.0f && db > 0.0f) || (da > 0.0f && db < 0.0f))
+			{
+				float t = da / (da - db);
+				clipped.push_back(XMFLOAT2(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y)));
+			}
+		}
+
+		polygon = std::move(clipped);
+		if (polygon.empty())
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "pch.h"
+#include "Camera.h"
+#include "CascadeFitting.h"
+
+#define MAX_OUTLINE_VERTICES 8
+
+// Light space volume a caster has to reach to be drawn into a cascade. Extruded toward the light,
+// a caster is inside if it overlaps the square of the cascade and starts in front of LightFar.
+// With an outline it also has to overlap the cascade's slice of the view frustum seen from the
+// light, widened by Margin for the shadow filter, and start in front of the slice.
+struct CasterCullVolume
+{
+	XMFLOAT2 Center = {0.0f, 0.0f};
+	float Radius = 0.0f;
+	float LightFar = 0.0f;
+
+	// convex, counterclockwise, no outline test without vertices
+	XMFLOAT2 Outline[MAX_OUTLINE_VERTICES];
+	int OutlineSize = 0;
+	float OutlineFar = 0.0f; // farthest light space depth of the slice
+	float Margin = 0.0f;
+};
+
+// Culls the shadow casters per cascade. The boxes are transformed to light space once per frame
+// and stored as structure of arrays, so that the volume tests run on four boxes at a time.
+class ShadowCasterCulling
+{
+public:
+	void SetCasters(const std::vector<BoundingBox> &bounds, FXMMATRIX lightView);
+
+	// indices of the casters inside the volume, in increasing order
+	void Cull(const CasterCullVolume &volume, std::vector<UINT> &visible) const;
+
+	size_t Size() const { return m_Count; }
+
+	// volume of the projection of a cascade only
+	static void ProjectionVolume(const CascadeFit &fit, int cascade, CasterCullVolume &volume);
+
+	// volume of a cascade and its slice of the view frustum, reaching back over the transition
+	static void SliceVolume(const Camera &camera, const CascadeFit &fit, int cascade, float transitionRatio,
+							float margin, CasterCullVolume &volume);
+
+	// tests a single light space box by clipping it against the volume, for checking Cull
+	static bool IntersectsReference(const BoundingBox &boundsLS, const CasterCullVolume &volume);
+
+private:
+	size_t m_Count = 0;
+
+	// light space bounds, padded to a multiple of 4 with empty boxes
+	std::vector<float> m_MinX;
+	std::vector<float> m_MaxX;
+	std::vector<float> m_MinY;
+	std::vector<float> m_MaxY;
+	std::vector<float> m_MinZ;
+};
@@ -0,0 +1,174 @@
+#include "pch.h"
+#include "SphericalHarmonics.h"
+
+#include "core/Parallel.h"
+
+// real SH basis, see "An Efficient Representation for Irradiance Environment Maps"
+static void EvaluateBasis(FXMVECTOR direction, float basis[9])
+{
+	XMFLOAT3 d;
+	XMStoreFloat3(&d, direction);
+
+	basis[0] = 0.282095f;
+	basis[1] = 0.488603f * d.y;
+	basis[2] = 0.488603f * d.z;
+	basis[3] = 0.488603f * d.x;
+	basis[4] = 1.092548f * d.x * d.y;
+	basis[5] = 1.092548f * d.y * d.z;
+	basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+	basis[7] = 1.092548f * d.x * d.z;
+	basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+// direction through the center of a cubemap texel, same face layout as GetSamplingVector in utils.hlsl
+static XMVECTOR TexelDirection(UINT face, float u, float v)
+{
+	switch (face)
+	{
+	case 0: return XMVectorSet(1.0f, v, -u, 0.0f);
+	case 1: return XMVectorSet(-1.0f, v, u, 0.0f);
+	case 2: return XMVectorSet(u, 1.0f, -v, 0.0f);
+	case 3: return XMVectorSet(u, -1.0f, v, 0.0f);
+	case 4: return XMVectorSet(u, v, 1.0f, 0.0f);
+	default: return XMVectorSet(-u, v, -1.0f, 0.0f);
+	}
+}
+
+static XMVECTOR LoadTexel(const TextureData &cubemap, UINT face, UINT level, UINT x, UINT y)
+{
+	UINT index = y * cubemap.LevelWidth(level) + x;
+
+	if (cubemap.Format == DXGI_FORMAT_R16G16B16A16_FLOAT)
+		return PackedVector::XMLoadHalf4(cubemap.Subresource<PackedVector::XMHALF4>(face, level) + index);
+
+	return XMLoadFloat4(cubemap.Subresource<XMFLOAT4>(face, level) + index);
+}
+
+SH9 SphericalHarmonics::ProjectCubemap(const TextureData &cubemap, UINT maxSize)
+{
+	ASSERT(cubemap.IsCubemap, "SH projection expects a cubemap.");
+	ASSERT(cubemap.Format == DXGI_FORMAT_R32G32B32A32_FLOAT || cubemap.Format == DXGI_FORMAT_R16G16B16A16_FLOAT,
+		   "Unsupported cubemap format for SH projection: {}", (int)cubemap.Format);
+
+	UINT level = 0;
+	while (level + 1 < cubemap.Levels && cubemap.LevelWidth(level) > maxSize)
+		level++;
+
+	const UINT size = cubemap.LevelWidth(level);
+	const float texelSize = 2.0f / size;
+
+	// one partial sum per row keeps the reduction deterministic regardless of the thread count
+	struct RowSum
+	{
+		XMVECTOR Coefficients[9];
+		float Weight;
+	};
+	std::vector<RowSum> rowSums(6 * size);
+
+	Parallel::For(6 * size, [&](UINT row)
+				  {
+		UINT face = row / size;
+		UINT y = row % size;
+		float v = 1.0f - (y + 0.5f) * texelSize;
+
+		RowSum sum = {};
+		for (UINT x = 0; x < size; x++)
+		{
+			float u = (x + 0.5f) * texelSize - 1.0f;
+
+			// differential solid angle of the texel
+			float r2 = 1.0f + u * u + v * v;
+			float weight = texelSize * texelSize / (r2 * sqrtf(r2));
+
+			float basis[9];
+			EvaluateBasis(XMVector3Normalize(TexelDirection(face, u, v)), basis);
+
+			XMVECTOR color = LoadTexel(cubemap, face, level, x, y);
+			for (UINT i = 0; i < 9; i++)
+				sum.Coefficients[i] = XMVectorMultiplyAdd(color, XMVectorReplicate(basis[i] * weight), sum.Coefficients[i]);
+
+			sum.Weight += weight;
+		}
+		rowSums[row] = sum; });
+
+	XMVECTOR coefficients[9] = {};
+	float totalWeight = 0.0f;
+
+	for (const auto &sum : rowSums)
+	{
+		for (UINT i = 0; i < 9; i++)
+			coefficients[i] += sum.Coefficients[i];
+		totalWeight += sum.Weight;
+	}
+
+	// the weights add up to 4 PI up to discretization error
+	XMVECTOR normalization = XMVectorReplicate(4.0f * XM_PI / totalWeight);
+
+	SH9 sh;
+	for (UINT i = 0; i < 9; i++)
+		XMStoreFloat4(&sh.Coefficients[i], XMVectorSetW(coefficients[i] * normalization, 0.0f));
+
+	return sh;
+}
+
+SH9 SphericalHarmonics::ConvolveIrradiance(const SH9 &radiance)
+{
+	// cosine lobe band factors PI, 2PI/3, PI/4, divided by PI
+	static const float bandFactors[9] = {1.0f,
+										 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+										 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+
+	SH9 irradiance;
+	for (UINT i = 0; i < 9; i++)
+		XMStoreFloat4(&irradiance.Coefficients[i], XMLoadFloat4(&radiance.Coefficients[i]) * bandFactors[i]);
+
+	return irradiance;
+}
+
+XMVECTOR SphericalHarmonics::Evaluate(const SH9 &sh, FXMVECTOR direction)
+{
+	float basis[9];
+	EvaluateBasis(direction, basis);
+
+	XMVECTOR result = XMVectorZero();
+	for (UINT i = 0; i < 9; i++)
+		result = XMVectorMultiplyAdd(XMLoadFloat4(&sh.Coefficients[i]), XMVectorReplicate(basis[i]), result);
+
+	return XMVectorMax(result, XMVectorZero());
+}
+
+float SphericalHarmonics::MaxRelativeError(const SH9 &irradiance, const TextureData &irradianceMap)
+{
+	const UINT size = irradianceMap.Width;
+
+	// errors are measured relative to the mean irradiance, dark directions would blow up a per-texel ratio
+	XMVECTOR sum = XMVectorZero();
+	for (UINT face = 0; face < 6; face++)
+		for (UINT i = 0; i < size * size; i++)
+			sum += LoadTexel(irradianceMap, face, 0, i % size, i / size);
+
+	float meanMagnitude = std::max(XMVectorGetX(XMVector3Length(sum)) / (6 * size * size), 1e-6f);
+
+	std::vector<float> rowErrors(6 * size, 0.0f);
+
+	Parallel::For(6 * size, [&](UINT row)
+				  {
+		UINT face = row / size;
+		UINT y = row % size;
+
+		// the irradiance map is baked at texel corners, see GetSamplingVector
+		float v = 2.0f * (1.0f - float(y) / size) - 1.0f;
+
+		for (UINT x = 0; x < size; x++)
+		{
+			float u = 2.0f * (float(x) / size) - 1.0f;
+
+			XMVECTOR reference = LoadTexel(irradianceMap, face, 0, x, y);
+			XMVECTOR reconstructed = Evaluate(irradiance, XMVector3Normalize(TexelDirection(face, u, v)));
+
+			float error = XMVectorGetX(XMVector3Length(reconstructed - reference));
+			rowErrors[row] = std::max(rowErrors[row], error / meanMagnitude);
+		} });
+
+	return *std::max_element(rowErrors.begin(), rowErrors.end());
+}
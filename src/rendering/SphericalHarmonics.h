@@ -0,0 +1,32 @@
+#pragma once
+
+#include "pch.h"
+#include "asset/DDS.h"
+
+// Order 2 (9 coefficient) spherical harmonics of an RGB signal.
+// Each coefficient is stored as a float4 so the array can be copied into a
+// constant buffer as is, the w component is unused.
+struct SH9
+{
+	XMFLOAT4 Coefficients[9] = {};
+};
+
+class SphericalHarmonics
+{
+public:
+	// Projects the radiance of a RGBA32F/RGBA16F cubemap, using the first mip level
+	// that is no larger than maxSize. Texels are weighted by their solid angle.
+	static SH9 ProjectCubemap(const TextureData &cubemap, UINT maxSize = 128);
+
+	// Convolves radiance with the clamped cosine lobe. The result is divided by PI to
+	// follow the convention of the old irradiance map (exitant radiance of a white
+	// Lambertian surface), so shading can use it without further scaling.
+	static SH9 ConvolveIrradiance(const SH9 &radiance);
+
+	static XMVECTOR Evaluate(const SH9 &sh, FXMVECTOR direction);
+
+	// Largest error of the SH reconstruction against every texel of a brute-force
+	// convolved irradiance cubemap (see IBLBaker::ComputeIrradianceMap), relative
+	// to the mean irradiance of the cubemap.
+	static float MaxRelativeError(const SH9 &irradiance, const TextureData &irradianceMap);
+};
@@ -2,10 +2,13 @@
 #include "TAA.h"
 #include "dx/Utils.h"
 #include "PipelineStates.h"
+#include "GpuProfiler.h"
 
 TAA::TAA(Ref<DxContext> dxContext, UINT width, UINT height)
 	: m_DxContext(dxContext), m_Device(dxContext->GetDevice())
 {
+	GpuMemoryScope memoryScope(GpuMemoryCategory::RenderTarget);
+
 	m_HistoryBuffer = Texture::Create(m_Device, width, height, 1, BACK_BUFFER_FORMAT, 1);
 	m_SourceBuffer = Texture::Create(m_Device, width, height, 1, BACK_BUFFER_FORMAT, 1);
 
@@ -18,6 +21,9 @@ TAA::TAA(Ref<DxContext> dxContext, UINT width, UINT height)
 
 void TAA::Render(GraphicsCommandList commandList, Texture &velocityBuffer)
 {
+	PROFILE_FUNCTION();
+	PROFILE_GPU_SCOPE(commandList, "TAA");
+
 	auto &backBuffer = m_DxContext->CurrentBackBuffer();
 
 	// No need to perform anything for the first frame
@@ -31,11 +37,11 @@ void TAA::Render(GraphicsCommandList commandList, Texture &velocityBuffer)
 			CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Resource.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
 			CD3DX12_RESOURCE_BARRIER::Transition(m_SourceBuffer.Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON)};
 
-		commandList->ResourceBarrier(2, preCopyBarriers);
+		Utils::ResourceBarrier(commandList, _countof(preCopyBarriers), preCopyBarriers);
 		commandList->CopyResource(m_SourceBuffer.Resource.Get(), backBuffer.Resource.Get());
-		commandList->ResourceBarrier(2, postCopyBarriers);
+		Utils::ResourceBarrier(commandList, _countof(postCopyBarriers), postCopyBarriers);
 
-		commandList->SetPipelineState(PipelineStates::GetPSO("taa"));
+		PipelineStates::SetPSO(commandList, "taa");
 
 		UINT resources[] = {
 			m_SourceBuffer.Srv.Index,
@@ -45,6 +51,7 @@ void TAA::Render(GraphicsCommandList commandList, Texture &velocityBuffer)
 
 		commandList->SetGraphicsRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
 
+		COUNTER_ADD("Draw Calls", 1);
 		commandList->DrawInstanced(3, 1, 0, 0);
 	}
 
@@ -57,9 +64,9 @@ void TAA::Render(GraphicsCommandList commandList, Texture &velocityBuffer)
 			CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Resource.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
 			CD3DX12_RESOURCE_BARRIER::Transition(m_HistoryBuffer.Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON)};
 
-		commandList->ResourceBarrier(2, preCopyBarriers);
+		Utils::ResourceBarrier(commandList, _countof(preCopyBarriers), preCopyBarriers);
 		commandList->CopyResource(m_HistoryBuffer.Resource.Get(), backBuffer.Resource.Get());
-		commandList->ResourceBarrier(2, postCopyBarriers);
+		Utils::ResourceBarrier(commandList, _countof(postCopyBarriers), postCopyBarriers);
 	}
 
 	m_FirstFrame = false;
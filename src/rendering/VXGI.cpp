@@ -1,8 +1,15 @@
 #include "VXGI.h"
 #include "PipelineStates.h"
+#include "GpuProfiler.h"
+#include "dx/Utils.h"
 
 VXGI::VXGI(Ref<DxContext> dxContext, UINT size)
+    : m_DxContext(dxContext), m_Size(size)
 {
+    GpuMemoryScope memoryScope(GpuMemoryCategory::Voxel);
+
+    ASSERT(size == VOXEL_DIMENSION, "The voxel grid size must match VOXEL_DIMENSION: size = {}", size);
+
     m_Device = dxContext->GetDevice();
     m_ViewPort = {0.0f, 0.0f, (float)size, (float)size, 0.0f, 1.0f};
     m_ScissorRect = {0, 0, (int)size, (int)size};
@@ -12,6 +19,14 @@ VXGI::VXGI(Ref<DxContext> dxContext, UINT size)
         m_MipLevels++;
     m_TextureUav.resize(m_MipLevels * 2);
 
+    // tiled 3D textures need tier 3, unmapped tiles then read as zero and writes to them are dropped
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    ThrowIfFailed(m_Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+    m_UseReservedTextures = options.TiledResourcesTier >= D3D12_TILED_RESOURCES_TIER_3;
+
+    if (!m_UseReservedTextures)
+        LOG_CHANNEL_WARN(Voxel, "Tiled 3D textures are not supported, the voxel textures are allocated densely.");
+
     // allocate descriptors
     m_TextureSrv[0] = dxContext->GetCbvSrvUavHeap().Alloc();
     m_TextureSrv[1] = dxContext->GetCbvSrvUavHeap().Alloc();
@@ -19,53 +34,203 @@ VXGI::VXGI(Ref<DxContext> dxContext, UINT size)
         m_TextureUav[i] = dxContext->GetCbvSrvUavHeap().Alloc();
 
     m_VoxelBufferUav = dxContext->GetCbvSrvUavHeap().Alloc();
+    m_BrickIndirectionSrv = dxContext->GetCbvSrvUavHeap().Alloc();
+    m_BrickListSrv = dxContext->GetCbvSrvUavHeap().Alloc();
+    m_StatsUav = dxContext->GetCbvSrvUavHeap().Alloc();
+    m_BrickUpdateMaskUav = dxContext->GetCbvSrvUavHeap().Alloc();
+    for (int i = 0; i < NUM_FRAMES_IN_FLIGHT; i++)
+        m_UpdateListSrv[i] = dxContext->GetCbvSrvUavHeap().Alloc();
+
+    BuildStatsBuffers();
+}
 
-    // build resources and descriptors
-    OnResize(size, size, size);
+void VXGI::BuildBricks(const BrickOccupancy &occupancy)
+{
+    GpuMemoryScope memoryScope(GpuMemoryCategory::Voxel);
+
+    auto commandList = m_DxContext->GetCommandList();
 
-    // initialize the voxel buffer to zero
-    auto commandList = dxContext->GetCommandList();
+    BuildBrickBuffers(commandList, occupancy);
+    BuildTextures(occupancy);
+    BuildDescriptors();
 
-    ID3D12DescriptorHeap *descriptorHeaps[] = {dxContext->GetCbvSrvUavHeap().Get()};
+    ID3D12DescriptorHeap *descriptorHeaps[] = {m_DxContext->GetCbvSrvUavHeap().Get()};
     commandList->SetDescriptorHeaps(1, descriptorHeaps);
+    commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
+
+    // the voxel buffer is reset before every update after that,
+    // texels outside the occupied bricks are never written again
+    ClearVoxels(commandList);
+    ClearTextures(commandList);
+
+    m_DxContext->ExecuteCommandList();
+    m_DxContext->DeferFlush();
+
+    m_MemoryReport = VoxelMemoryReport::Estimate(occupancy);
+    m_MemoryReport.SparseTextureBytes = m_TextureBytes;
+    m_MemoryReport.Log("scene");
+}
+
+void VXGI::ConfigureSchedule(VoxelSchedulePattern pattern, float fraction, UINT maxBricksPerFrame, float blendFactor)
+{
+    m_ScheduleFraction = fraction;
+    m_ScheduleMaxBricks = maxBricksPerFrame;
+    m_BlendFactor = blendFactor;
+
+    m_Schedule.Configure(pattern, VoxelUpdateSchedule::SliceCount(m_NumBricks, fraction, maxBricksPerFrame));
+}
+
+bool VXGI::BeginUpdate(GraphicsCommandList commandList, int frameIndex, const std::vector<UINT> &bricks)
+{
+    if (BuildUpdateList(frameIndex, bricks) == 0)
+        return false;
+
+    m_UpdateStamp++;
 
-    commandList->SetPipelineState(PipelineStates::GetPSO("clearVoxel"));
+    UINT resources[] = {m_VoxelBufferUav.Index,
+                        m_UpdateListSrv[frameIndex].Index,
+                        m_BrickUpdateMaskUav.Index,
+                        m_UpdateStamp};
+
+    PipelineStates::SetPSO(commandList, "voxelBeginUpdate");
+    commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
+    commandList->Dispatch(m_UpdateCounts[0][0], 1, 1);
+    m_DispatchCount++;
+
+    Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::UAV(nullptr));
+
+    return true;
+}
+
+void VXGI::UploadVoxels(const std::vector<UINT> &bricks, const std::vector<UINT64> &voxels)
+{
+    ASSERT(bricks.size() == m_NumBricks && voxels.size() * sizeof(UINT64) == (UINT64)m_NumBricks * VOXELS_PER_BRICK * sizeof(Voxel),
+           "The uploaded voxels must match the brick pool: {} bricks, {} voxels", bricks.size(), voxels.size());
+
+    auto commandList = m_DxContext->GetCommandList();
+
+    ID3D12DescriptorHeap *descriptorHeaps[] = {m_DxContext->GetCbvSrvUavHeap().Get()};
+    commandList->SetDescriptorHeaps(1, descriptorHeaps);
     commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
-    commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, 1, &m_VoxelBufferUav.Index, 0);
 
-    UINT groupSize = size / 8;
-    commandList->Dispatch(groupSize, groupSize, groupSize);
+    Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_VoxelBuffer.Get(),
+                                                                             D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+    m_DxContext->GetStagingManager().CopyToBuffer(commandList, m_VoxelBuffer.Get(), 0, voxels.data(), voxels.size() * sizeof(UINT64));
+    Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_VoxelBuffer.Get(),
+                                                                             D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+
+    // every brick counts as revoxelized, so both textures and their mips are filled without blending
+    BuildUpdateList(0, bricks);
+    BufferToTexture3D(commandList);
+    UpdateSecondBounce(commandList);
 
-    dxContext->ExecuteCommandList();
-    dxContext->Flush();
+    m_DxContext->ExecuteCommandList();
+    m_DxContext->DeferFlush();
 }
 
-void VXGI::OnResize(UINT x, UINT y, UINT z)
+UINT VXGI::BuildUpdateList(int frameIndex, const std::vector<UINT> &bricks)
 {
-    if (m_X == x && m_Y == y && m_Z == z)
-        return;
+    std::vector<UINT> slots;
+    std::vector<UINT> dirtyBricks;
+    std::vector<bool> dirty(m_NumBricks, false);
+    slots.reserve(bricks.size());
+    for (UINT packed : bricks)
+    {
+        XMUINT3 brick = BrickOccupancy::UnpackBrick(packed);
+        UINT slot = m_BrickSlots[(brick.x * VOXEL_BRICK_DIMENSION + brick.y) * VOXEL_BRICK_DIMENSION + brick.z];
+        if (slot != INVALID_BRICK)
+        {
+            slots.push_back(slot);
+            dirtyBricks.push_back(packed);
+            dirty[slot] = true;
+        }
+    }
 
-    m_X = x;
-    m_Y = y;
-    m_Z = z;
+    auto updateList = m_UpdateLists[frameIndex].get();
+    m_UpdateListIndex = frameIndex;
+    m_DispatchCount = 0;
+    m_VoxelsTouched = 0;
 
-    BuildResources();
-    BuildDescriptors();
+    for (int i = 0; i < 2; i++)
+    {
+        m_UpdateOffsets[i].assign(m_MipLevels, 0);
+        m_UpdateCounts[i].assign(m_MipLevels, 0);
+    }
+
+    // level 0 bricks by slot, the revoxelized ones first so both textures share them
+    UINT count = 0;
+    for (UINT slot : slots)
+        updateList->CopyData(count++, slot);
+    m_UpdateCounts[0][0] = slots.size();
+
+    std::vector<UINT> secondBounceBricks = dirtyBricks;
+    for (UINT slot : m_Schedule.Slice(m_ScheduleFrame++))
+    {
+        if (dirty[slot])
+            continue;
+
+        updateList->CopyData(count++, slot);
+        secondBounceBricks.push_back(m_Schedule.Brick(slot));
+    }
+    m_UpdateCounts[1][0] = secondBounceBricks.size();
+    m_VoxelsTouched += (slots.size() + secondBounceBricks.size()) * VOXELS_PER_BRICK;
+
+    // the parents of every other level by coordinate
+    AppendParentBricks(updateList, count, dirtyBricks, 0);
+    AppendParentBricks(updateList, count, secondBounceBricks, 1);
+
+    return slots.size();
+}
+
+void VXGI::AppendParentBricks(UploadBuffer<UINT> *updateList, UINT &count, std::vector<UINT> bricks, int index)
+{
+    for (UINT level = 1; level < m_MipLevels; level++)
+    {
+        for (UINT &packed : bricks)
+        {
+            XMUINT3 brick = BrickOccupancy::UnpackBrick(packed);
+            packed = BrickOccupancy::PackBrick(brick.x >> 1, brick.y >> 1, brick.z >> 1);
+        }
+        std::sort(bricks.begin(), bricks.end());
+        bricks.erase(std::unique(bricks.begin(), bricks.end()), bricks.end());
+
+        m_UpdateOffsets[index][level] = count;
+        m_UpdateCounts[index][level] = bricks.size();
+        for (UINT packed : bricks)
+            updateList->CopyData(count++, packed);
+
+        UINT levelWidth = std::min(m_Size >> level, (UINT)VOXEL_BRICK_SIZE);
+        m_VoxelsTouched += bricks.size() * levelWidth * levelWidth * levelWidth;
+    }
 }
 
 void VXGI::BufferToTexture3D(GraphicsCommandList commandList)
 {
-    UINT resources[2] = {m_VoxelBufferUav.Index,
-                         m_TextureUav[0].Index};
+    PROFILE_GPU_SCOPE(commandList, "BufferToTexture3D");
 
-    commandList->SetPipelineState(PipelineStates::GetPSO("voxelBuffer2Tex"));
-    commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, 2, resources, 0);
+    UINT resources[] = {m_VoxelBufferUav.Index,
+                        m_TextureUav[0].Index,
+                        m_BrickListSrv.Index,
+                        m_UpdateListSrv[m_UpdateListIndex].Index};
 
-    UINT groupSize = std::max(VOXEL_DIMENSION / 8, 1);
-    commandList->Dispatch(groupSize, groupSize, groupSize);
+    PipelineStates::SetPSO(commandList, "voxelBuffer2Tex");
+    commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
+
+    // one thread group per updated brick
+    commandList->Dispatch(m_UpdateCounts[0][0], 1, 1);
+    m_DispatchCount++;
 
     // generate mipmap for the first texture
     GenVoxelMipmap(commandList, 0);
+}
+
+void VXGI::UpdateSecondBounce(GraphicsCommandList commandList)
+{
+    if (m_UpdateCounts[1].empty() || m_UpdateCounts[1][0] == 0)
+        return;
+
+    // the cones read the first texture and its mips
+    Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::UAV(nullptr));
 
     // write the second bounce color to the second texture
     ComputeSecondBound(commandList);
@@ -76,67 +241,305 @@ void VXGI::BufferToTexture3D(GraphicsCommandList commandList)
 
 void VXGI::GenVoxelMipmap(GraphicsCommandList commandList, int index)
 {
-    commandList->SetPipelineState(PipelineStates::GetPSO("voxelMipmap"));
+    PipelineStates::SetPSO(commandList, "voxelMipmap");
 
+    // only the bricks above updated bricks are filtered
     for (int i = 1, levelWidth = VOXEL_DIMENSION / 2; i < m_MipLevels; i++, levelWidth /= 2)
     {
-        UINT resources[] = {m_TextureUav[index * m_MipLevels + i - 1].Index,
-                            m_TextureUav[index * m_MipLevels + i].Index};
-        commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, 2, resources, 0);
+        if (m_UpdateCounts[index][i] == 0)
+            continue;
 
-        UINT count = std::max(levelWidth / 8, 1);
-        commandList->Dispatch(count, count, count);
+        UINT resources[] = {m_TextureUav[index * m_MipLevels + i - 1].Index,
+                            m_TextureUav[index * m_MipLevels + i].Index,
+                            m_UpdateListSrv[m_UpdateListIndex].Index,
+                            m_UpdateOffsets[index][i],
+                            (UINT)levelWidth};
+        commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
+
+        commandList->Dispatch(m_UpdateCounts[index][i], 1, 1);
+        m_DispatchCount++;
     }
 }
 
 void VXGI::ComputeSecondBound(GraphicsCommandList commandList)
 {
+    // the revoxelized bricks have no history worth keeping, the slice is blended with it
     UINT resources[] = {m_VoxelBufferUav.Index,
                         m_TextureSrv[0].Index,
-                        m_TextureUav[m_MipLevels].Index}; // second 3d texture uav (first mip level)
+                        m_TextureUav[m_MipLevels].Index, // second 3d texture uav (first mip level)
+                        m_BrickListSrv.Index,
+                        m_UpdateListSrv[m_UpdateListIndex].Index,
+                        m_UpdateCounts[0][0],
+                        *reinterpret_cast<UINT *>(&m_BlendFactor)};
 
-    commandList->SetPipelineState(PipelineStates::GetPSO("voxelSecondBounce"));
+    PipelineStates::SetPSO(commandList, "voxelSecondBounce");
     commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
 
-    UINT groupSize = std::max(VOXEL_DIMENSION / 8, 1);
-    commandList->Dispatch(groupSize, groupSize, groupSize);
+    commandList->Dispatch(m_UpdateCounts[1][0], 1, 1);
+    m_DispatchCount++;
+}
+
+void VXGI::ClearVoxels(GraphicsCommandList commandList)
+{
+    PipelineStates::SetPSO(commandList, "clearVoxel");
+    commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, 1, &m_VoxelBufferUav.Index, 0);
+
+    commandList->Dispatch(m_NumBricks, 1, 1);
+}
+
+void VXGI::ClearTextures(GraphicsCommandList commandList)
+{
+    PipelineStates::SetPSO(commandList, "clearVoxelTexture");
+
+    for (int i = 0; i < m_MipLevels * 2; i++)
+    {
+        UINT levelWidth = std::max(m_Size >> (i % m_MipLevels), 1u);
+        UINT resources[] = {m_TextureUav[i].Index, levelWidth};
+        commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
+
+        UINT count = (levelWidth + 7) / 8;
+        commandList->Dispatch(count, count, count);
+    }
 }
 
-void VXGI::BuildResources()
+void VXGI::ReadbackStats(GraphicsCommandList commandList, int frameIndex)
+{
+    const UINT64 byteSize = (UINT)VoxelStat::Count * sizeof(UINT);
+
+    Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_StatsBuffer.Get(),
+                                                                             D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
+    commandList->CopyBufferRegion(m_StatsReadbackBuffers[frameIndex].Get(), 0, m_StatsBuffer.Get(), 0, byteSize);
+
+    // reset the counters for the next frame
+    Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_StatsBuffer.Get(),
+                                                                             D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+    commandList->CopyBufferRegion(m_StatsBuffer.Get(), 0, m_StatsZeroBuffer.Get(), 0, byteSize);
+    Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::Transition(m_StatsBuffer.Get(),
+                                                                             D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+
+    m_StatsPending[frameIndex] = true;
+}
+
+void VXGI::UpdateStats(int frameIndex)
+{
+    if (!m_StatsPending[frameIndex])
+        return;
+
+    const UINT64 byteSize = (UINT)VoxelStat::Count * sizeof(UINT);
+
+    UINT *stats = nullptr;
+    ThrowIfFailed(m_StatsReadbackBuffers[frameIndex]->Map(0, &CD3DX12_RANGE(0, byteSize), reinterpret_cast<void **>(&stats)));
+    memcpy(m_Stats, stats, byteSize);
+    m_StatsReadbackBuffers[frameIndex]->Unmap(0, &CD3DX12_RANGE(0, 0));
+
+    m_StatsPending[frameIndex] = false;
+
+    if (m_Stats[(int)VoxelStat::MissingBrickFragments] > 0)
+        LOG_CHANNEL_WARN(Voxel, "{} voxel fragments fell into unallocated bricks.", m_Stats[(int)VoxelStat::MissingBrickFragments]);
+}
+
+void VXGI::BuildBrickBuffers(GraphicsCommandList commandList, const BrickOccupancy &occupancy)
+{
+    // brick lists of all mip levels in one buffer
+    std::vector<UINT> brickList;
+    m_BrickListOffsets.clear();
+    m_BrickListCounts.clear();
+
+    for (UINT level = 0; level < m_MipLevels; level++)
+    {
+        auto bricks = occupancy.OccupiedBricks(level);
+        m_BrickListOffsets.push_back(brickList.size());
+        m_BrickListCounts.push_back(bricks.size());
+        brickList.insert(brickList.end(), bricks.begin(), bricks.end());
+    }
+
+    m_NumBricks = m_BrickListCounts[0];
+
+    // same layout as Flatten in voxelUtils.hlsl
+    m_BrickSlots.assign(VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION, INVALID_BRICK);
+    for (UINT slot = 0; slot < m_NumBricks; slot++)
+    {
+        XMUINT3 brick = BrickOccupancy::UnpackBrick(brickList[slot]);
+        m_BrickSlots[(brick.x * VOXEL_BRICK_DIMENSION + brick.y) * VOXEL_BRICK_DIMENSION + brick.z] = slot;
+    }
+
+    auto &stagingManager = m_DxContext->GetStagingManager();
+    m_BrickIndirection = Utils::CreateDefaultBuffer(m_Device, commandList, m_BrickSlots.data(), m_BrickSlots.size() * sizeof(UINT), stagingManager);
+    m_BrickList = Utils::CreateDefaultBuffer(m_Device, commandList, brickList.data(), brickList.size() * sizeof(UINT), stagingManager);
+
+    // an update never lists more bricks per level and texture than are occupied
+    for (int i = 0; i < NUM_FRAMES_IN_FLIGHT; i++)
+        m_UpdateLists[i] = std::make_unique<UploadBuffer<UINT>>(m_Device, std::max<UINT>(2 * brickList.size(), 1), false);
+
+    m_Schedule.Reset(occupancy.OccupiedBricks(0));
+    m_Schedule.Configure(m_Schedule.Pattern(), VoxelUpdateSchedule::SliceCount(m_NumBricks, m_ScheduleFraction, m_ScheduleMaxBricks));
+
+    m_BrickUpdateMask = nullptr;
+    ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(std::max(m_NumBricks, 1u) * sizeof(UINT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+        D3D12_RESOURCE_STATE_COMMON,
+        nullptr,
+        IID_PPV_ARGS(&m_BrickUpdateMask)));
+
+    UINT64 byteSize = (UINT64)std::max(m_NumBricks, 1u) * VOXELS_PER_BRICK * sizeof(Voxel);
+    m_VoxelBuffer = nullptr;
+    ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+        D3D12_RESOURCE_STATE_COMMON,
+        nullptr,
+        IID_PPV_ARGS(&m_VoxelBuffer)));
+}
+
+void VXGI::BuildTextures(const BrickOccupancy &occupancy)
 {
     D3D12_RESOURCE_DESC texDesc = {};
     texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
     texDesc.Alignment = 0;
-    texDesc.Width = m_X;
-    texDesc.Height = m_Y;
-    texDesc.DepthOrArraySize = m_Z;
+    texDesc.Width = m_Size;
+    texDesc.Height = m_Size;
+    texDesc.DepthOrArraySize = m_Size;
     texDesc.MipLevels = m_MipLevels;
     texDesc.Format = m_TextureFormat;
     texDesc.SampleDesc = {1, 0};
-    texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    texDesc.Layout = m_UseReservedTextures ? D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE : D3D12_TEXTURE_LAYOUT_UNKNOWN;
     texDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
+    m_TextureBytes = 0;
+
     for (int i = 0; i < 2; i++)
     {
         m_VolumeTexture[i] = nullptr;
 
-        ThrowIfFailed(m_Device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &texDesc,
-            D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-            nullptr,
-            IID_PPV_ARGS(m_VolumeTexture[i].GetAddressOf())));
+        if (m_UseReservedTextures)
+        {
+            ThrowIfFailed(m_Device->CreateReservedResource(
+                &texDesc,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                nullptr,
+                IID_PPV_ARGS(m_VolumeTexture[i].GetAddressOf())));
+        }
+        else
+        {
+            ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+                &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+                D3D12_HEAP_FLAG_NONE,
+                &texDesc,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                nullptr,
+                IID_PPV_ARGS(m_VolumeTexture[i].GetAddressOf())));
+
+            m_TextureBytes += m_Device->GetResourceAllocationInfo(0, 1, &texDesc).SizeInBytes;
+        }
+    }
+
+    if (m_UseReservedTextures)
+        MapTextureTiles(occupancy);
+}
+
+void VXGI::MapTextureTiles(const BrickOccupancy &occupancy)
+{
+    // both textures share the same description and therefore the same tiling
+    UINT numTiles = 0;
+    D3D12_PACKED_MIP_INFO packedMipInfo = {};
+    D3D12_TILE_SHAPE tileShape = {};
+    UINT numSubresourceTilings = m_MipLevels;
+    std::vector<D3D12_SUBRESOURCE_TILING> subresourceTilings(m_MipLevels);
+    m_Device->GetResourceTiling(m_VolumeTexture[0].Get(), &numTiles, &packedMipInfo, &tileShape,
+                                &numSubresourceTilings, 0, subresourceTilings.data());
+
+    std::vector<D3D12_TILED_RESOURCE_COORDINATE> coordinates;
+    for (UINT level = 0; level < packedMipInfo.NumStandardMips; level++)
+    {
+        auto tiles = occupancy.OccupiedTiles(level, tileShape.WidthInTexels, tileShape.HeightInTexels, tileShape.DepthInTexels);
+        for (UINT packed : tiles)
+        {
+            XMUINT3 tile = BrickOccupancy::UnpackBrick(packed);
+            coordinates.push_back(CD3DX12_TILED_RESOURCE_COORDINATE(tile.x, tile.y, tile.z, level));
+        }
+    }
+
+    // the packed mip tail is always mapped as a whole
+    for (UINT i = 0; i < packedMipInfo.NumTilesForPackedMips; i++)
+        coordinates.push_back(CD3DX12_TILED_RESOURCE_COORDINATE(i, 0, 0, packedMipInfo.NumStandardMips));
+
+    const UINT numMappedTiles = coordinates.size();
+
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes = 2ull * numMappedTiles * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+    heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+    m_TileHeap = nullptr;
+    ThrowIfFailed(GpuMemory::CreateHeap(m_Device.Get(), &heapDesc, IID_PPV_ARGS(&m_TileHeap)));
+
+    // every tile is its own range, the first texture takes the first half of the heap
+    std::vector<UINT> heapRangeStartOffsets(numMappedTiles);
+    std::vector<UINT> rangeTileCounts(numMappedTiles, 1);
+
+    auto commandQueue = m_DxContext->GetCommandQueue();
+    for (int i = 0; i < 2; i++)
+    {
+        for (UINT tile = 0; tile < numMappedTiles; tile++)
+            heapRangeStartOffsets[tile] = i * numMappedTiles + tile;
+
+        commandQueue->UpdateTileMappings(m_VolumeTexture[i].Get(), numMappedTiles, coordinates.data(), nullptr,
+                                         m_TileHeap.Get(), numMappedTiles, nullptr,
+                                         heapRangeStartOffsets.data(), rangeTileCounts.data(),
+                                         D3D12_TILE_MAPPING_FLAG_NONE);
     }
 
-    UINT byteSize = (m_X * m_Y * m_Z) * sizeof(Voxel);
-    ThrowIfFailed(m_Device->CreateCommittedResource(
+    m_TextureBytes = heapDesc.SizeInBytes;
+}
+
+void VXGI::BuildStatsBuffers()
+{
+    const UINT64 byteSize = (UINT)VoxelStat::Count * sizeof(UINT);
+
+    ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
         D3D12_HEAP_FLAG_NONE,
         &CD3DX12_RESOURCE_DESC::Buffer(byteSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
         D3D12_RESOURCE_STATE_COMMON,
         nullptr,
-        IID_PPV_ARGS(&m_VoxelBuffer)));
+        IID_PPV_ARGS(&m_StatsBuffer)));
+
+    ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&m_StatsZeroBuffer)));
+
+    void *zeros = nullptr;
+    ThrowIfFailed(m_StatsZeroBuffer->Map(0, nullptr, &zeros));
+    memset(zeros, 0, byteSize);
+    m_StatsZeroBuffer->Unmap(0, nullptr);
+
+    for (int i = 0; i < NUM_FRAMES_IN_FLIGHT; i++)
+    {
+        ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&m_StatsReadbackBuffers[i])));
+    }
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+    uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+    uavDesc.Buffer.FirstElement = 0;
+    uavDesc.Buffer.NumElements = (UINT)VoxelStat::Count;
+    uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+
+    m_Device->CreateUnorderedAccessView(m_StatsBuffer.Get(), nullptr, &uavDesc, m_StatsUav.CPUHandle);
 }
 
 void VXGI::BuildDescriptors()
@@ -167,10 +570,38 @@ void VXGI::BuildDescriptors()
     voxelUavDesc.Format = DXGI_FORMAT_UNKNOWN;
     voxelUavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
     voxelUavDesc.Buffer.FirstElement = 0;
-    voxelUavDesc.Buffer.NumElements = m_X * m_Y * m_Z;
+    voxelUavDesc.Buffer.NumElements = std::max(m_NumBricks, 1u) * VOXELS_PER_BRICK;
     voxelUavDesc.Buffer.StructureByteStride = sizeof(Voxel);
     voxelUavDesc.Buffer.CounterOffsetInBytes = 0;
     voxelUavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
 
     m_Device->CreateUnorderedAccessView(m_VoxelBuffer.Get(), nullptr, &voxelUavDesc, m_VoxelBufferUav.CPUHandle);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC bufferSrvDesc = {};
+    bufferSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    bufferSrvDesc.Format = DXGI_FORMAT_UNKNOWN;
+    bufferSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    bufferSrvDesc.Buffer.FirstElement = 0;
+    bufferSrvDesc.Buffer.StructureByteStride = sizeof(UINT);
+    bufferSrvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+
+    bufferSrvDesc.Buffer.NumElements = VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION;
+    m_Device->CreateShaderResourceView(m_BrickIndirection.Get(), &bufferSrvDesc, m_BrickIndirectionSrv.CPUHandle);
+
+    bufferSrvDesc.Buffer.NumElements = m_BrickListOffsets.back() + m_BrickListCounts.back();
+    m_Device->CreateShaderResourceView(m_BrickList.Get(), &bufferSrvDesc, m_BrickListSrv.CPUHandle);
+
+    bufferSrvDesc.Buffer.NumElements = std::max(2 * bufferSrvDesc.Buffer.NumElements, 1u);
+    for (int i = 0; i < NUM_FRAMES_IN_FLIGHT; i++)
+        m_Device->CreateShaderResourceView(m_UpdateLists[i]->GetResource(), &bufferSrvDesc, m_UpdateListSrv[i].CPUHandle);
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC maskUavDesc = {};
+    maskUavDesc.Format = DXGI_FORMAT_UNKNOWN;
+    maskUavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+    maskUavDesc.Buffer.FirstElement = 0;
+    maskUavDesc.Buffer.NumElements = std::max(m_NumBricks, 1u);
+    maskUavDesc.Buffer.StructureByteStride = sizeof(UINT);
+    maskUavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+
+    m_Device->CreateUnorderedAccessView(m_BrickUpdateMask.Get(), nullptr, &maskUavDesc, m_BrickUpdateMaskUav.CPUHandle);
 }
@@ -2,50 +2,152 @@
 #include "dx/dx.h"
 #include "dx/DxContext.h"
 #include "dx/Descriptor.h"
+#include "dx/UploadBuffer.h"
+#include "VoxelBricks.h"
+#include "VoxelUpdateSchedule.h"
 
-#define VOXEL_DIMENSION 256
-
-struct Voxel
+// GPU counters written during voxelization, see VOXEL_STAT_* in voxelUtils.hlsl
+enum class VoxelStat
 {
-    UINT64 Radiance;
-    UINT64 Normal;
+    MissingBrickFragments = 0, // fragments that fell into a brick the CPU occupancy did not allocate
+    Count
 };
 
 class VXGI
 {
 public:
     VXGI(Ref<DxContext> dxContext, UINT size);
-    void OnResize(UINT x, UINT y, UINT z);
+
+    // allocates the bricks touched by the scene and maps the texture tiles covering them
+    void BuildBricks(const BrickOccupancy &occupancy);
 
     D3D12_VIEWPORT &GetViewPort() { return m_ViewPort; }
     D3D12_RECT &GetScissorRect() { return m_ScissorRect; }
 
     Descriptor &GetVoxelBufferUav() { return m_VoxelBufferUav; }
+    Descriptor &GetBrickIndirectionSrv() { return m_BrickIndirectionSrv; }
+    Descriptor &GetStatsUav() { return m_StatsUav; }
     Descriptor &GetTextureSrv(int i) { return m_TextureSrv[i]; }
 
+    // The second bounce of a brick changes whenever the light around it does, so besides the
+    // revoxelized bricks it refreshes one slice of the schedule every update and blends the
+    // result with the previous value of the slice.
+    void ConfigureSchedule(VoxelSchedulePattern pattern, float fraction, UINT maxBricksPerFrame, float blendFactor);
+    UINT GetScheduleSlices() const { return m_Schedule.NumSlices(); }
+
+    // Starts revoxelizing the given bricks (packed coordinates): clears them in the brick pool and
+    // stamps them so the voxelizer only writes fragments inside them, then schedules the next
+    // second bounce slice. Returns false if there is nothing to revoxelize. BufferToTexture3D and
+    // the mips then only process these bricks.
+    bool BeginUpdate(GraphicsCommandList commandList, int frameIndex, const std::vector<UINT> &bricks);
     void BufferToTexture3D(GraphicsCommandList commandList);
 
+    // Fills the brick pool with voxels computed elsewhere, a bake of the CPU voxelizer, and builds
+    // both volume textures from it. The bricks must be the ones BuildBricks allocated, in pool order.
+    void UploadVoxels(const std::vector<UINT> &bricks, const std::vector<UINT64> &voxels);
+
+    // second bounce of the revoxelized bricks and of the scheduled slice, and its mips
+    void UpdateSecondBounce(GraphicsCommandList commandList);
+
+    // bricks whose second bounce the last update refreshed, and the dispatches it recorded
+    UINT GetSecondBounceBricks() const { return m_UpdateCounts[1].empty() ? 0 : m_UpdateCounts[1][0]; }
+    UINT GetDispatchCount() const { return m_DispatchCount; }
+
+    Descriptor &GetBrickUpdateMaskUav() { return m_BrickUpdateMaskUav; }
+    UINT GetUpdateStamp() const { return m_UpdateStamp; }
+
+    // texels of both volume textures written by the last update, mips included
+    UINT GetVoxelsTouched() const { return m_VoxelsTouched; }
+
+    // the stats written in a frame are read back when its frame resource comes around again
+    void ReadbackStats(GraphicsCommandList commandList, int frameIndex);
+    void UpdateStats(int frameIndex);
+    UINT GetStat(VoxelStat stat) const { return m_Stats[(int)stat]; }
+
+    const VoxelMemoryReport &GetMemoryReport() const { return m_MemoryReport; }
+
 private:
+    // fills the update list of the frame, returns the number of revoxelized bricks
+    UINT BuildUpdateList(int frameIndex, const std::vector<UINT> &bricks);
+
     void GenVoxelMipmap(GraphicsCommandList commandList, int index);
     void ComputeSecondBound(GraphicsCommandList commandList);
+    void AppendParentBricks(UploadBuffer<UINT> *updateList, UINT &count, std::vector<UINT> bricks, int index);
 
-    void BuildResources();
+    void ClearVoxels(GraphicsCommandList commandList);
+    void ClearTextures(GraphicsCommandList commandList);
+
+    void BuildBrickBuffers(GraphicsCommandList commandList, const BrickOccupancy &occupancy);
+    void BuildTextures(const BrickOccupancy &occupancy);
+    void MapTextureTiles(const BrickOccupancy &occupancy);
+    void BuildStatsBuffers();
     void BuildDescriptors();
 
 private:
+    Ref<DxContext> m_DxContext;
     Device m_Device;
 
+    // brick pool, VOXELS_PER_BRICK voxels for every occupied brick
     Resource m_VoxelBuffer = nullptr;
     Descriptor m_VoxelBufferUav;
+    UINT m_NumBricks = 0;
+
+    // brick coordinate -> slot in the brick pool, INVALID_BRICK if not allocated
+    Resource m_BrickIndirection = nullptr;
+    Descriptor m_BrickIndirectionSrv;
+
+    // packed coordinates of the occupied bricks of every mip level, level 0 is in pool order
+    Resource m_BrickList = nullptr;
+    Descriptor m_BrickListSrv;
+    std::vector<UINT> m_BrickListOffsets;
+    std::vector<UINT> m_BrickListCounts;
+    std::vector<UINT> m_BrickSlots; // CPU copy of the indirection grid
+
+    // per frame list of the bricks to update: the pool slots of the revoxelized bricks followed
+    // by the slots of the second bounce slice, then the packed coordinates of the parent bricks
+    // for every other mip level of both textures. Offsets and counts are per texture and level.
+    std::unique_ptr<UploadBuffer<UINT>> m_UpdateLists[NUM_FRAMES_IN_FLIGHT];
+    Descriptor m_UpdateListSrv[NUM_FRAMES_IN_FLIGHT];
+    int m_UpdateListIndex = 0;
+    std::vector<UINT> m_UpdateOffsets[2];
+    std::vector<UINT> m_UpdateCounts[2];
+    UINT m_VoxelsTouched = 0;
+    UINT m_DispatchCount = 0;
+
+    VoxelUpdateSchedule m_Schedule;
+    UINT64 m_ScheduleFrame = 0;
+    float m_ScheduleFraction = 1.0f;
+    UINT m_ScheduleMaxBricks = UINT_MAX;
+    float m_BlendFactor = 1.0f;
+
+    // stamp of the last update that scheduled each pool slot
+    Resource m_BrickUpdateMask = nullptr;
+    Descriptor m_BrickUpdateMaskUav;
+    UINT m_UpdateStamp = 0;
 
     Resource m_VolumeTexture[2];
     DXGI_FORMAT m_TextureFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
     UINT m_MipLevels = 0;
 
+    // the volume textures are reserved resources backed by tiles for the occupied bricks only
+    // when the device supports tiled 3D textures, and committed resources otherwise
+    bool m_UseReservedTextures = false;
+    ComPtr<ID3D12Heap> m_TileHeap = nullptr;
+    UINT64 m_TextureBytes = 0;
+
     Descriptor m_TextureSrv[2];
     std::vector<Descriptor> m_TextureUav;
 
-    UINT m_X = -1, m_Y = -1, m_Z = -1;
+    Resource m_StatsBuffer = nullptr;
+    Resource m_StatsZeroBuffer = nullptr;
+    Resource m_StatsReadbackBuffers[NUM_FRAMES_IN_FLIGHT];
+    bool m_StatsPending[NUM_FRAMES_IN_FLIGHT] = {};
+    Descriptor m_StatsUav;
+    UINT m_Stats[(int)VoxelStat::Count] = {};
+
+    VoxelMemoryReport m_MemoryReport;
+
+    UINT m_Size;
     D3D12_VIEWPORT m_ViewPort;
     D3D12_RECT m_ScissorRect;
-};
\ No newline at end of file
+};
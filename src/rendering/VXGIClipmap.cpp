@@ -0,0 +1,181 @@
+#include "VXGIClipmap.h"
+#include "FrameResource.h"
+#include "PipelineStates.h"
+#include "GpuProfiler.h"
+#include "VoxelBricks.h"
+#include "dx/Utils.h"
+
+VXGIClipmap::VXGIClipmap(Ref<DxContext> dxContext, UINT numLevels, UINT resolution, float baseVoxelSize)
+    : m_DxContext(dxContext), m_Clipmap(numLevels, resolution, baseVoxelSize)
+{
+    GpuMemoryScope memoryScope(GpuMemoryCategory::Voxel);
+
+    m_Device = dxContext->GetDevice();
+    m_ViewPort = {0.0f, 0.0f, (float)resolution, (float)resolution, 0.0f, 1.0f};
+    m_ScissorRect = {0, 0, (int)resolution, (int)resolution};
+
+    // allocate descriptors
+    for (UINT i = 0; i < numLevels; i++)
+    {
+        m_TextureSrv.push_back(dxContext->GetCbvSrvUavHeap().Alloc());
+        m_TextureUav.push_back(dxContext->GetCbvSrvUavHeap().Alloc());
+    }
+    m_VoxelBufferUav = dxContext->GetCbvSrvUavHeap().Alloc();
+
+    BuildResources();
+    BuildDescriptors();
+    Clear();
+
+    LOG_CHANNEL_INFO(Voxel, "Voxel clipmap: {} levels of {}^3, {:.2f} MB", numLevels, resolution, m_Clipmap.MemoryBytes() / (1024.0f * 1024.0f));
+}
+
+ClipmapVoxelizeResources VXGIClipmap::GetVoxelizeResources(UINT level, const ClipmapRegion &region, UINT shadowMapTexIndex) const
+{
+    ClipmapVoxelizeResources resources;
+    resources.VoxelIndex = m_VoxelBufferUav.Index;
+    resources.ShadowMapTexIndex = shadowMapTexIndex;
+    resources.Origin = m_Clipmap.Origin(level);
+    resources.VoxelSize = m_Clipmap.VoxelSize(level);
+    resources.Resolution = m_Clipmap.Resolution();
+    resources.RegionMin = region.Min;
+    resources.RegionMax = region.Max;
+    return resources;
+}
+
+void VXGIClipmap::BufferToTexture3D(GraphicsCommandList commandList, UINT level, const ClipmapRegion &region)
+{
+    PROFILE_GPU_SCOPE(commandList, "BufferToTexture3D");
+
+    UINT resources[] = {m_VoxelBufferUav.Index,
+                        m_TextureUav[level].Index,
+                        m_Clipmap.Resolution(),
+                        (UINT)region.Min.x, (UINT)region.Min.y, (UINT)region.Min.z,
+                        (UINT)region.Max.x, (UINT)region.Max.y, (UINT)region.Max.z};
+
+    PipelineStates::SetPSO(commandList, "voxelClipmapBuffer2Tex");
+    commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
+
+    commandList->Dispatch((region.Max.x - region.Min.x + 7) / 8,
+                          (region.Max.y - region.Min.y + 7) / 8,
+                          (region.Max.z - region.Min.z + 7) / 8);
+
+    // the next region reuses the voxel buffer
+    Utils::ResourceBarrier(commandList, CD3DX12_RESOURCE_BARRIER::UAV(nullptr));
+}
+
+void VXGIClipmap::FillPassConstants(PassConstants &passConstants) const
+{
+    passConstants.ClipmapLevelCount = m_Clipmap.NumLevels();
+    passConstants.ClipmapResolution = m_Clipmap.Resolution();
+
+    for (UINT level = 0; level < m_Clipmap.NumLevels(); level++)
+    {
+        const XMINT3 &origin = m_Clipmap.Origin(level);
+        float voxelSize = m_Clipmap.VoxelSize(level);
+        passConstants.ClipmapLevels[level] = XMFLOAT4(origin.x * voxelSize, origin.y * voxelSize, origin.z * voxelSize, voxelSize);
+
+        UINT *indices = &passConstants.ClipmapTexIndices[level / 4].x;
+        indices[level % 4] = m_TextureSrv[level].Index;
+    }
+}
+
+void VXGIClipmap::BuildResources()
+{
+    UINT resolution = m_Clipmap.Resolution();
+
+    D3D12_RESOURCE_DESC texDesc = {};
+    texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+    texDesc.Alignment = 0;
+    texDesc.Width = resolution;
+    texDesc.Height = resolution;
+    texDesc.DepthOrArraySize = resolution;
+    texDesc.MipLevels = 1;
+    texDesc.Format = m_TextureFormat;
+    texDesc.SampleDesc = {1, 0};
+    texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    texDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+    m_Textures.resize(m_Clipmap.NumLevels());
+    for (auto &texture : m_Textures)
+    {
+        ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &texDesc,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+            nullptr,
+            IID_PPV_ARGS(texture.GetAddressOf())));
+    }
+
+    UINT64 byteSize = (UINT64)resolution * resolution * resolution * sizeof(Voxel);
+    ThrowIfFailed(GpuMemory::CreateCommittedResource(m_Device.Get(),
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+        D3D12_RESOURCE_STATE_COMMON,
+        nullptr,
+        IID_PPV_ARGS(&m_VoxelBuffer)));
+}
+
+void VXGIClipmap::BuildDescriptors()
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Format = m_TextureFormat;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+    srvDesc.Texture3D.MostDetailedMip = 0;
+    srvDesc.Texture3D.MipLevels = 1;
+    srvDesc.Texture3D.ResourceMinLODClamp = 0.0f;
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+    uavDesc.Format = m_TextureFormat;
+    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE3D;
+    uavDesc.Texture3D.MipSlice = 0;
+    uavDesc.Texture3D.FirstWSlice = 0;
+    uavDesc.Texture3D.WSize = -1;
+
+    for (UINT i = 0; i < m_Textures.size(); i++)
+    {
+        m_Device->CreateShaderResourceView(m_Textures[i].Get(), &srvDesc, m_TextureSrv[i].CPUHandle);
+        m_Device->CreateUnorderedAccessView(m_Textures[i].Get(), nullptr, &uavDesc, m_TextureUav[i].CPUHandle);
+    }
+
+    UINT resolution = m_Clipmap.Resolution();
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC voxelUavDesc{};
+    voxelUavDesc.Format = DXGI_FORMAT_UNKNOWN;
+    voxelUavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+    voxelUavDesc.Buffer.FirstElement = 0;
+    voxelUavDesc.Buffer.NumElements = resolution * resolution * resolution;
+    voxelUavDesc.Buffer.StructureByteStride = sizeof(Voxel);
+    voxelUavDesc.Buffer.CounterOffsetInBytes = 0;
+    voxelUavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+
+    m_Device->CreateUnorderedAccessView(m_VoxelBuffer.Get(), nullptr, &voxelUavDesc, m_VoxelBufferUav.CPUHandle);
+}
+
+void VXGIClipmap::Clear()
+{
+    auto commandList = m_DxContext->GetCommandList();
+
+    ID3D12DescriptorHeap *descriptorHeaps[] = {m_DxContext->GetCbvSrvUavHeap().Get()};
+    commandList->SetDescriptorHeaps(1, descriptorHeaps);
+    commandList->SetComputeRootSignature(PipelineStates::GetRootSignature());
+
+    // clearVoxel clears VOXELS_PER_BRICK voxels per thread group
+    UINT resolution = m_Clipmap.Resolution();
+    PipelineStates::SetPSO(commandList, "clearVoxel");
+    commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, 1, &m_VoxelBufferUav.Index, 0);
+    commandList->Dispatch(resolution * resolution * resolution / VOXELS_PER_BRICK, 1, 1);
+
+    PipelineStates::SetPSO(commandList, "clearVoxelTexture");
+    for (auto &uav : m_TextureUav)
+    {
+        UINT resources[] = {uav.Index, resolution};
+        commandList->SetComputeRoot32BitConstants((UINT)RootParam::RenderResources, sizeof(resources) / sizeof(UINT), resources, 0);
+        commandList->Dispatch(resolution / 8, resolution / 8, resolution / 8);
+    }
+
+    m_DxContext->ExecuteCommandList();
+    m_DxContext->DeferFlush();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "pch.h"
+#include "dx/dx.h"
+#include "dx/DxContext.h"
+#include "dx/Descriptor.h"
+#include "VoxelClipmap.h"
+
+struct PassConstants;
+
+// Root constants of voxelize.hlsl compiled with VOXEL_CLIPMAP
+struct ClipmapVoxelizeResources
+{
+    UINT VoxelIndex;
+    UINT ShadowMapTexIndex;
+    XMINT3 Origin;
+    float VoxelSize;
+    UINT Resolution;
+    XMINT3 RegionMin;
+    XMINT3 RegionMax;
+};
+
+// GPU side of the camera-centred voxel clipmap: one toroidally addressed volume texture per
+// level and a voxel buffer shared by all levels, which are voxelized one region at a time.
+class VXGIClipmap
+{
+public:
+    VXGIClipmap(Ref<DxContext> dxContext, UINT numLevels, UINT resolution, float baseVoxelSize);
+
+    VoxelClipmap &GetClipmap() { return m_Clipmap; }
+
+    D3D12_VIEWPORT &GetViewPort() { return m_ViewPort; }
+    D3D12_RECT &GetScissorRect() { return m_ScissorRect; }
+
+    ClipmapVoxelizeResources GetVoxelizeResources(UINT level, const ClipmapRegion &region, UINT shadowMapTexIndex) const;
+
+    // resolves the voxelized region into the level texture and clears it in the voxel buffer
+    void BufferToTexture3D(GraphicsCommandList commandList, UINT level, const ClipmapRegion &region);
+
+    void FillPassConstants(PassConstants &passConstants) const;
+
+private:
+    void BuildResources();
+    void BuildDescriptors();
+    void Clear();
+
+private:
+    Ref<DxContext> m_DxContext;
+    Device m_Device;
+
+    VoxelClipmap m_Clipmap;
+
+    std::vector<Resource> m_Textures;
+    std::vector<Descriptor> m_TextureSrv;
+    std::vector<Descriptor> m_TextureUav;
+    DXGI_FORMAT m_TextureFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+    Resource m_VoxelBuffer = nullptr;
+    Descriptor m_VoxelBufferUav;
+
+    D3D12_VIEWPORT m_ViewPort;
+    D3D12_RECT m_ScissorRect;
+};
@@ -0,0 +1,247 @@
+#include "pch.h"
+#include "VoxelBricks.h"
+
+#include "Mesh.h"
+#include "core/Parallel.h"
+
+static const UINT NUM_BRICKS = VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION;
+
+// a small margin keeps fragments on brick boundaries from landing in unallocated bricks
+static const float BRICK_MARGIN = 0.01f;
+
+// separating axis test, see "Fast 3D Triangle-Box Overlap Testing" by Tomas Akenine-Moller
+bool TriangleBoxOverlap(const XMFLOAT3 &center, float halfSize, const XMFLOAT3 triangle[3])
+{
+    float v[3][3];
+    for (int i = 0; i < 3; i++)
+    {
+        v[i][0] = triangle[i].x - center.x;
+        v[i][1] = triangle[i].y - center.y;
+        v[i][2] = triangle[i].z - center.z;
+    }
+
+    auto overlapsOnAxis = [&](float ax, float ay, float az, float radius)
+    {
+        float p0 = v[0][0] * ax + v[0][1] * ay + v[0][2] * az;
+        float p1 = v[1][0] * ax + v[1][1] * ay + v[1][2] * az;
+        float p2 = v[2][0] * ax + v[2][1] * ay + v[2][2] * az;
+        return std::min({p0, p1, p2}) <= radius && std::max({p0, p1, p2}) >= -radius;
+    };
+
+    // cross products of the box axes and the triangle edges
+    for (int k = 0; k < 3; k++)
+    {
+        float ex = v[(k + 1) % 3][0] - v[k][0];
+        float ey = v[(k + 1) % 3][1] - v[k][1];
+        float ez = v[(k + 1) % 3][2] - v[k][2];
+
+        if (!overlapsOnAxis(0.0f, -ez, ey, halfSize * (fabsf(ez) + fabsf(ey))) ||
+            !overlapsOnAxis(ez, 0.0f, -ex, halfSize * (fabsf(ez) + fabsf(ex))) ||
+            !overlapsOnAxis(-ey, ex, 0.0f, halfSize * (fabsf(ey) + fabsf(ex))))
+            return false;
+    }
+
+    // box face normals
+    if (!overlapsOnAxis(1.0f, 0.0f, 0.0f, halfSize) ||
+        !overlapsOnAxis(0.0f, 1.0f, 0.0f, halfSize) ||
+        !overlapsOnAxis(0.0f, 0.0f, 1.0f, halfSize))
+        return false;
+
+    // triangle plane
+    float e0[3] = {v[1][0] - v[0][0], v[1][1] - v[0][1], v[1][2] - v[0][2]};
+    float e1[3] = {v[2][0] - v[0][0], v[2][1] - v[0][1], v[2][2] - v[0][2]};
+    float nx = e0[1] * e1[2] - e0[2] * e1[1];
+    float ny = e0[2] * e1[0] - e0[0] * e1[2];
+    float nz = e0[0] * e1[1] - e0[1] * e1[0];
+
+    float distance = nx * v[0][0] + ny * v[0][1] + nz * v[0][2];
+    return fabsf(distance) <= halfSize * (fabsf(nx) + fabsf(ny) + fabsf(nz));
+}
+
+BrickOccupancy::BrickOccupancy()
+    : m_Bits((NUM_BRICKS + 31) / 32)
+{
+    Clear();
+}
+
+void BrickOccupancy::Clear()
+{
+    for (auto &bits : m_Bits)
+        bits.store(0, std::memory_order_relaxed);
+}
+
+void BrickOccupancy::MarkBrick(UINT x, UINT y, UINT z)
+{
+    UINT index = (z * VOXEL_BRICK_DIMENSION + y) * VOXEL_BRICK_DIMENSION + x;
+    m_Bits[index / 32].fetch_or(1u << (index % 32), std::memory_order_relaxed);
+}
+
+bool BrickOccupancy::IsOccupied(UINT x, UINT y, UINT z) const
+{
+    UINT index = (z * VOXEL_BRICK_DIMENSION + y) * VOXEL_BRICK_DIMENSION + x;
+    return (m_Bits[index / 32].load(std::memory_order_relaxed) >> (index % 32)) & 1;
+}
+
+UINT BrickOccupancy::NumOccupied() const
+{
+    UINT count = 0;
+    for (auto &bits : m_Bits)
+    {
+        UINT value = bits.load(std::memory_order_relaxed);
+        for (; value; value &= value - 1)
+            count++;
+    }
+    return count;
+}
+
+void BrickOccupancy::AddTriangle(FXMVECTOR v0, FXMVECTOR v1, FXMVECTOR v2)
+{
+    XMFLOAT3 triangle[3];
+    XMStoreFloat3(&triangle[0], v0);
+    XMStoreFloat3(&triangle[1], v1);
+    XMStoreFloat3(&triangle[2], v2);
+
+    XMFLOAT3 minPoint, maxPoint;
+    XMStoreFloat3(&minPoint, XMVectorMin(XMVectorMin(v0, v1), v2));
+    XMStoreFloat3(&maxPoint, XMVectorMax(XMVectorMax(v0, v1), v2));
+
+    const float dimension = (float)VOXEL_DIMENSION;
+    if (maxPoint.x < 0.0f || maxPoint.y < 0.0f || maxPoint.z < 0.0f ||
+        minPoint.x >= dimension || minPoint.y >= dimension || minPoint.z >= dimension)
+        return;
+
+    auto brickRange = [](float minValue, float maxValue, int &first, int &last)
+    {
+        first = std::max(int(floorf((minValue - BRICK_MARGIN) / VOXEL_BRICK_SIZE)), 0);
+        last = std::min(int(floorf((maxValue + BRICK_MARGIN) / VOXEL_BRICK_SIZE)), VOXEL_BRICK_DIMENSION - 1);
+    };
+
+    int x0, x1, y0, y1, z0, z1;
+    brickRange(minPoint.x, maxPoint.x, x0, x1);
+    brickRange(minPoint.y, maxPoint.y, y0, y1);
+    brickRange(minPoint.z, maxPoint.z, z0, z1);
+
+    const float halfSize = VOXEL_BRICK_SIZE * 0.5f + BRICK_MARGIN;
+
+    for (int z = z0; z <= z1; z++)
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+            {
+                if (IsOccupied(x, y, z))
+                    continue;
+
+                XMFLOAT3 center((x + 0.5f) * VOXEL_BRICK_SIZE, (y + 0.5f) * VOXEL_BRICK_SIZE, (z + 0.5f) * VOXEL_BRICK_SIZE);
+                if (TriangleBoxOverlap(center, halfSize, triangle))
+                    MarkBrick(x, y, z);
+            }
+}
+
+void BrickOccupancy::AddMesh(Mesh &mesh, FXMMATRIX world)
+{
+    const auto &vertices = mesh.Vertices();
+    const auto &indices = mesh.Indices();
+
+    std::vector<XMFLOAT3> positions(vertices.size());
+    Parallel::For((UINT)vertices.size(), [&](UINT i)
+                  { XMStoreFloat3(&positions[i], WorldToVoxelSpace(XMVector3TransformCoord(XMLoadFloat3(&vertices[i].Position), world))); },
+                  4096);
+
+    // resolve the submesh base vertices up front so all triangles can be processed in one go
+    std::vector<UINT> triangles;
+    triangles.reserve(indices.size());
+    for (const auto &subMesh : mesh.SubMeshes())
+    {
+        for (UINT i = 0; i < subMesh.IndexCount; i++)
+            triangles.push_back(indices[subMesh.StartIndexLocation + i] + subMesh.BaseVertexLocation);
+    }
+
+    Parallel::For((UINT)triangles.size() / 3, [&](UINT i)
+                  { AddTriangle(XMLoadFloat3(&positions[triangles[3 * i + 0]]),
+                                XMLoadFloat3(&positions[triangles[3 * i + 1]]),
+                                XMLoadFloat3(&positions[triangles[3 * i + 2]])); },
+                  1024);
+}
+
+std::vector<UINT> BrickOccupancy::OccupiedBricks(UINT level) const
+{
+    std::vector<UINT> bricks;
+
+    for (UINT z = 0; z < VOXEL_BRICK_DIMENSION; z++)
+        for (UINT y = 0; y < VOXEL_BRICK_DIMENSION; y++)
+            for (UINT x = 0; x < VOXEL_BRICK_DIMENSION; x++)
+                if (IsOccupied(x, y, z))
+                    bricks.push_back(PackBrick(x >> level, y >> level, z >> level));
+
+    std::sort(bricks.begin(), bricks.end());
+    bricks.erase(std::unique(bricks.begin(), bricks.end()), bricks.end());
+    return bricks;
+}
+
+std::vector<UINT> BrickOccupancy::OccupiedTiles(UINT level, UINT tileWidth, UINT tileHeight, UINT tileDepth) const
+{
+    std::vector<UINT> tiles;
+
+    for (UINT packed : OccupiedBricks(0))
+    {
+        XMUINT3 brick = UnpackBrick(packed);
+
+        // texel range of the brick at this mip level
+        XMUINT3 first((brick.x * VOXEL_BRICK_SIZE) >> level, (brick.y * VOXEL_BRICK_SIZE) >> level, (brick.z * VOXEL_BRICK_SIZE) >> level);
+        XMUINT3 last(((brick.x + 1) * VOXEL_BRICK_SIZE - 1) >> level, ((brick.y + 1) * VOXEL_BRICK_SIZE - 1) >> level, ((brick.z + 1) * VOXEL_BRICK_SIZE - 1) >> level);
+
+        for (UINT z = first.z / tileDepth; z <= last.z / tileDepth; z++)
+            for (UINT y = first.y / tileHeight; y <= last.y / tileHeight; y++)
+                for (UINT x = first.x / tileWidth; x <= last.x / tileWidth; x++)
+                    tiles.push_back(PackBrick(x, y, z));
+    }
+
+    std::sort(tiles.begin(), tiles.end());
+    tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+    return tiles;
+}
+
+void VoxelMemoryReport::Log(const std::string &name) const
+{
+    const float MB = 1024.0f * 1024.0f;
+
+    LOG_CHANNEL_INFO(Voxel, "Voxel memory ({}): {} of {} bricks occupied", name, NumBricks, NUM_BRICKS);
+    LOG_CHANNEL_INFO(Voxel, "    dense:  {:.2f} MB (buffer {:.2f} MB, textures {:.2f} MB)",
+             DenseBytes() / MB, DenseBufferBytes / MB, DenseTextureBytes / MB);
+    LOG_CHANNEL_INFO(Voxel, "    sparse: {:.2f} MB (buffer {:.2f} MB, textures {:.2f} MB), {:.1f}% of dense",
+             SparseBytes() / MB, SparseBufferBytes / MB, SparseTextureBytes / MB,
+             100.0f * SparseBytes() / std::max<UINT64>(DenseBytes(), 1));
+}
+
+VoxelMemoryReport VoxelMemoryReport::Estimate(const BrickOccupancy &occupancy)
+{
+    const UINT64 TILE_SIZE = 64 * 1024;
+    const UINT TEXEL_SIZE = 8; // R16G16B16A16_FLOAT
+    const UINT TILE_WIDTH = 32, TILE_HEIGHT = 16, TILE_DEPTH = 16;
+
+    VoxelMemoryReport report;
+    report.NumBricks = occupancy.NumOccupied();
+
+    report.DenseBufferBytes = (UINT64)VOXEL_DIMENSION * VOXEL_DIMENSION * VOXEL_DIMENSION * sizeof(Voxel);
+    report.SparseBufferBytes = (UINT64)report.NumBricks * VOXELS_PER_BRICK * sizeof(Voxel) + NUM_BRICKS * sizeof(UINT);
+
+    UINT64 packedMipBytes = 0;
+    UINT64 numTiles = 0;
+
+    for (UINT level = 0, dimension = VOXEL_DIMENSION; dimension > 0; level++, dimension /= 2)
+    {
+        UINT64 levelBytes = (UINT64)dimension * dimension * dimension * TEXEL_SIZE;
+        report.DenseTextureBytes += 2 * levelBytes;
+        report.SparseBufferBytes += occupancy.OccupiedBricks(level).size() * sizeof(UINT);
+
+        // mips that do not fill a whole tile are packed together at the end of the resource
+        if (dimension >= TILE_WIDTH)
+            numTiles += occupancy.OccupiedTiles(level, TILE_WIDTH, TILE_HEIGHT, TILE_DEPTH).size();
+        else
+            packedMipBytes += levelBytes;
+    }
+
+    numTiles += (packedMipBytes + TILE_SIZE - 1) / TILE_SIZE;
+    report.SparseTextureBytes = 2 * numTiles * TILE_SIZE;
+
+    return report;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "pch.h"
+#include "VoxelPacking.h"
+
+#define VOXEL_DIMENSION 256
+
+// the voxel grid is stored sparsely in bricks of 8^3 voxels
+#define VOXEL_BRICK_SIZE 8
+#define VOXEL_BRICK_DIMENSION (VOXEL_DIMENSION / VOXEL_BRICK_SIZE)
+#define VOXELS_PER_BRICK (VOXEL_BRICK_SIZE * VOXEL_BRICK_SIZE * VOXEL_BRICK_SIZE)
+#define INVALID_BRICK 0xFFFFFFFF
+
+// mirrors constants.hlsl, a voxel spans 2 * VOXEL_GRID_SIZE world units
+const float VOXEL_GRID_SIZE = 0.1f;
+
+// mirrors Voxel in structs.hlsl
+struct Voxel
+{
+#if VOXEL_COMPACT_PACKING
+    UINT64 Packed; // see VoxelPacking
+#else
+    UINT64 Radiance;
+    UINT64 Normal;
+#endif
+};
+
+class Mesh;
+
+// separating axis test of a triangle against the cube of the given centre and half size
+bool TriangleBoxOverlap(const XMFLOAT3 &center, float halfSize, const XMFLOAT3 triangle[3]);
+
+// World space -> continuous voxel space, the CPU version of WorldPosToVoxelIndex in voxelUtils.hlsl
+inline XMVECTOR WorldToVoxelSpace(FXMVECTOR position)
+{
+    const float scale = 0.5f / VOXEL_GRID_SIZE;
+    return XMVectorMultiplyAdd(position, XMVectorSet(scale, -scale, scale, 0.0f), XMVectorReplicate(VOXEL_DIMENSION * 0.5f));
+}
+
+// Which bricks of the voxel grid are touched by scene geometry. This is the CPU reference
+// the sparse voxel storage is allocated from: a brick the GPU voxelizer writes to must be
+// marked here, so the test is conservative and errs on the side of allocating.
+class BrickOccupancy
+{
+public:
+    BrickOccupancy();
+
+    void Clear();
+
+    // vertices in voxel space
+    void AddTriangle(FXMVECTOR v0, FXMVECTOR v1, FXMVECTOR v2);
+    void AddMesh(Mesh &mesh, FXMMATRIX world);
+
+    // marks a brick directly, for occupancies restored from a bake
+    void MarkBrick(UINT x, UINT y, UINT z);
+
+    bool IsOccupied(UINT x, UINT y, UINT z) const;
+    UINT NumOccupied() const;
+
+    // packed brick coordinates at the given mip level, sorted. A brick of a coarser level
+    // is occupied when any level 0 brick it covers is occupied.
+    std::vector<UINT> OccupiedBricks(UINT level = 0) const;
+
+    // tiles of a volume texture mip level that overlap occupied bricks, packed like bricks
+    std::vector<UINT> OccupiedTiles(UINT level, UINT tileWidth, UINT tileHeight, UINT tileDepth) const;
+
+    static UINT PackBrick(UINT x, UINT y, UINT z) { return x | (y << 10) | (z << 20); }
+    static XMUINT3 UnpackBrick(UINT packed) { return XMUINT3(packed & 0x3FF, (packed >> 10) & 0x3FF, (packed >> 20) & 0x3FF); }
+
+private:
+    std::vector<std::atomic<UINT>> m_Bits;
+};
+
+// Dense vs sparse memory of the voxel scene: the Voxel buffer plus the two mipped
+// R16G16B16A16_FLOAT volume textures (direct light and second bounce).
+struct VoxelMemoryReport
+{
+    UINT NumBricks = 0;
+
+    UINT64 DenseBufferBytes = 0;
+    UINT64 DenseTextureBytes = 0;
+
+    UINT64 SparseBufferBytes = 0; // brick pool, indirection grid and brick lists
+    UINT64 SparseTextureBytes = 0; // mapped 64KB tiles
+
+    UINT64 DenseBytes() const { return DenseBufferBytes + DenseTextureBytes; }
+    UINT64 SparseBytes() const { return SparseBufferBytes + SparseTextureBytes; }
+
+    void Log(const std::string &name) const;
+
+    // the texture part uses the standard 64KB tile shape of 64 bit 3D textures (32x16x16)
+    static VoxelMemoryReport Estimate(const BrickOccupancy &occupancy);
+};
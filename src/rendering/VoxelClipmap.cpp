@@ -0,0 +1,209 @@
+#include "pch.h"
+#include "VoxelClipmap.h"
+#include "VoxelBricks.h"
+
+static int FloorDiv(float value, float size)
+{
+    return (int)floorf(value / size);
+}
+
+// non-negative remainder, so negative voxel coordinates wrap around too
+static UINT WrapCoord(int value, UINT resolution)
+{
+    int r = value % (int)resolution;
+    return r < 0 ? r + resolution : r;
+}
+
+ClipmapRegion ClipmapRegion::Intersect(const ClipmapRegion &a, const ClipmapRegion &b)
+{
+    ClipmapRegion region;
+    region.Min = XMINT3(std::max(a.Min.x, b.Min.x), std::max(a.Min.y, b.Min.y), std::max(a.Min.z, b.Min.z));
+    region.Max = XMINT3(std::min(a.Max.x, b.Max.x), std::min(a.Max.y, b.Max.y), std::min(a.Max.z, b.Max.z));
+    return region;
+}
+
+VoxelClipmap::VoxelClipmap(UINT numLevels, UINT resolution, float baseVoxelSize)
+    : m_NumLevels(numLevels), m_Resolution(resolution), m_BaseVoxelSize(baseVoxelSize),
+      m_Origins(numLevels, XMINT3(0, 0, 0)), m_DirtyRegions(numLevels)
+{
+    ASSERT(numLevels > 0 && numLevels <= VOXEL_CLIPMAP_MAX_LEVELS, "Invalid number of clipmap levels: {}", numLevels);
+    ASSERT(resolution % 8 == 0, "The clipmap resolution must be a multiple of 8: {}", resolution);
+}
+
+XMINT3 VoxelClipmap::CenteredOrigin(UINT level, FXMVECTOR center) const
+{
+    XMINT3 voxel = WorldToVoxel(level, center);
+    int half = m_Resolution / 2;
+    return XMINT3(voxel.x - half, voxel.y - half, voxel.z - half);
+}
+
+void VoxelClipmap::Update(FXMVECTOR center)
+{
+    for (UINT level = 0; level < m_NumLevels; level++)
+    {
+        XMINT3 origin = CenteredOrigin(level, center);
+
+        if (!m_Initialized)
+        {
+            m_Origins[level] = origin;
+            m_DirtyRegions[level].assign(1, Window(level));
+            continue;
+        }
+
+        auto regions = ScrollRegions(m_Origins[level], origin, m_Resolution);
+        m_DirtyRegions[level].insert(m_DirtyRegions[level].end(), regions.begin(), regions.end());
+        m_Origins[level] = origin;
+    }
+
+    m_Initialized = true;
+}
+
+void VoxelClipmap::Invalidate()
+{
+    for (UINT level = 0; level < m_NumLevels; level++)
+        m_DirtyRegions[level].assign(1, Window(level));
+}
+
+void VoxelClipmap::MarkBounds(const BoundingBox &bounds)
+{
+    XMVECTOR minPoint = XMLoadFloat3(&bounds.Center) - XMLoadFloat3(&bounds.Extents);
+    XMVECTOR maxPoint = XMLoadFloat3(&bounds.Center) + XMLoadFloat3(&bounds.Extents);
+
+    for (UINT level = 0; level < m_NumLevels; level++)
+    {
+        // conservative rasterization can write one voxel past the geometry
+        XMINT3 first = WorldToVoxel(level, minPoint);
+        XMINT3 last = WorldToVoxel(level, maxPoint);
+        ClipmapRegion region = {XMINT3(first.x - 1, first.y - 1, first.z - 1), XMINT3(last.x + 2, last.y + 2, last.z + 2)};
+
+        region = ClipmapRegion::Intersect(region, Window(level));
+        if (!region.Empty())
+            m_DirtyRegions[level].push_back(region);
+    }
+}
+
+std::vector<ClipmapRegion> VoxelClipmap::TakeDirtyRegions(UINT level)
+{
+    // regions queued before the last scroll may have partly left the window,
+    // the part outside would alias valid texels
+    std::vector<ClipmapRegion> regions;
+    for (const auto &region : m_DirtyRegions[level])
+    {
+        ClipmapRegion clipped = ClipmapRegion::Intersect(region, Window(level));
+        if (!clipped.Empty())
+            regions.push_back(clipped);
+    }
+
+    m_DirtyRegions[level].clear();
+    return regions;
+}
+
+ClipmapRegion VoxelClipmap::Window(UINT level) const
+{
+    const XMINT3 &origin = m_Origins[level];
+    int res = m_Resolution;
+    return {origin, XMINT3(origin.x + res, origin.y + res, origin.z + res)};
+}
+
+XMINT3 VoxelClipmap::WorldToVoxel(UINT level, FXMVECTOR position) const
+{
+    float size = VoxelSize(level);
+    return XMINT3(FloorDiv(XMVectorGetX(position), size),
+                  FloorDiv(XMVectorGetY(position), size),
+                  FloorDiv(XMVectorGetZ(position), size));
+}
+
+XMUINT3 VoxelClipmap::VoxelToTexel(const XMINT3 &voxel) const
+{
+    return XMUINT3(WrapCoord(voxel.x, m_Resolution), WrapCoord(voxel.y, m_Resolution), WrapCoord(voxel.z, m_Resolution));
+}
+
+bool VoxelClipmap::Contains(UINT level, const XMINT3 &voxel) const
+{
+    ClipmapRegion window = Window(level);
+    return voxel.x >= window.Min.x && voxel.y >= window.Min.y && voxel.z >= window.Min.z &&
+           voxel.x < window.Max.x && voxel.y < window.Max.y && voxel.z < window.Max.z;
+}
+
+UINT VoxelClipmap::LevelForPosition(FXMVECTOR position) const
+{
+    for (UINT level = 0; level < m_NumLevels; level++)
+    {
+        XMINT3 voxel = WorldToVoxel(level, position);
+        ClipmapRegion window = Window(level);
+        if (voxel.x > window.Min.x && voxel.y > window.Min.y && voxel.z > window.Min.z &&
+            voxel.x < window.Max.x - 1 && voxel.y < window.Max.y - 1 && voxel.z < window.Max.z - 1)
+            return level;
+    }
+    return m_NumLevels;
+}
+
+std::vector<ClipmapRegion> VoxelClipmap::ScrollRegions(const XMINT3 &oldOrigin, const XMINT3 &newOrigin, UINT resolution)
+{
+    int res = resolution;
+    ClipmapRegion window = {newOrigin, XMINT3(newOrigin.x + res, newOrigin.y + res, newOrigin.z + res)};
+
+    int dx = newOrigin.x - oldOrigin.x;
+    int dy = newOrigin.y - oldOrigin.y;
+    int dz = newOrigin.z - oldOrigin.z;
+
+    if (abs(dx) >= res || abs(dy) >= res || abs(dz) >= res)
+        return {window};
+
+    std::vector<ClipmapRegion> regions;
+
+    // every slab shrinks the window left for the next axis, so the regions never overlap
+    ClipmapRegion rest = window;
+
+    if (dx != 0)
+    {
+        ClipmapRegion slab = rest;
+        if (dx > 0)
+        {
+            slab.Min.x = rest.Max.x - dx;
+            rest.Max.x = slab.Min.x;
+        }
+        else
+        {
+            slab.Max.x = rest.Min.x - dx;
+            rest.Min.x = slab.Max.x;
+        }
+        regions.push_back(slab);
+    }
+
+    if (dy != 0)
+    {
+        ClipmapRegion slab = rest;
+        if (dy > 0)
+        {
+            slab.Min.y = rest.Max.y - dy;
+            rest.Max.y = slab.Min.y;
+        }
+        else
+        {
+            slab.Max.y = rest.Min.y - dy;
+            rest.Min.y = slab.Max.y;
+        }
+        regions.push_back(slab);
+    }
+
+    if (dz != 0)
+    {
+        ClipmapRegion slab = rest;
+        if (dz > 0)
+            slab.Min.z = rest.Max.z - dz;
+        else
+            slab.Max.z = rest.Min.z - dz;
+        regions.push_back(slab);
+    }
+
+    return regions;
+}
+
+UINT64 VoxelClipmap::MemoryBytes() const
+{
+    const UINT TEXEL_SIZE = 8; // R16G16B16A16_FLOAT
+
+    UINT64 voxels = (UINT64)m_Resolution * m_Resolution * m_Resolution;
+    return m_NumLevels * voxels * TEXEL_SIZE + voxels * sizeof(Voxel);
+}
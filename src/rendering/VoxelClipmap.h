@@ -0,0 +1,74 @@
+#pragma once
+
+#include "pch.h"
+
+// mirrors VOXEL_CLIPMAP_MAX_LEVELS in constants.hlsl
+#define VOXEL_CLIPMAP_MAX_LEVELS 8
+
+// Box of voxels [Min, Max) in the integer voxel coordinates of one clipmap level
+struct ClipmapRegion
+{
+    XMINT3 Min;
+    XMINT3 Max;
+
+    bool Empty() const { return Min.x >= Max.x || Min.y >= Max.y || Min.z >= Max.z; }
+    UINT64 Volume() const { return Empty() ? 0 : (UINT64)(Max.x - Min.x) * (Max.y - Min.y) * (Max.z - Min.z); }
+
+    static ClipmapRegion Intersect(const ClipmapRegion &a, const ClipmapRegion &b);
+};
+
+// Camera-centred voxel clipmap. Every level has the same resolution and twice the voxel
+// size of the previous one. Voxel coordinates are world aligned, floor(position / voxelSize),
+// and are stored toroidally: voxel v lives at texel v mod resolution, so moving a level only
+// requires revoxelizing the slabs that scrolled into it.
+class VoxelClipmap
+{
+public:
+    VoxelClipmap(UINT numLevels, UINT resolution, float baseVoxelSize);
+
+    // recentres the levels on the position and queues the newly exposed regions
+    void Update(FXMVECTOR center);
+
+    // queues the whole clipmap, e.g. when the lighting changed
+    void Invalidate();
+
+    // queues the voxels of every level overlapped by a world space box, e.g. a moved object
+    void MarkBounds(const BoundingBox &bounds);
+
+    // removes the queued regions of a level, clipped to its current window
+    std::vector<ClipmapRegion> TakeDirtyRegions(UINT level);
+
+    UINT NumLevels() const { return m_NumLevels; }
+    UINT Resolution() const { return m_Resolution; }
+    float VoxelSize(UINT level) const { return m_BaseVoxelSize * (1 << level); }
+
+    // voxels covered by a level, its min corner is Origin
+    const XMINT3 &Origin(UINT level) const { return m_Origins[level]; }
+    ClipmapRegion Window(UINT level) const;
+
+    XMINT3 WorldToVoxel(UINT level, FXMVECTOR position) const;
+    XMUINT3 VoxelToTexel(const XMINT3 &voxel) const;
+    bool Contains(UINT level, const XMINT3 &voxel) const;
+
+    // finest level whose window contains the position with a one voxel border for filtering,
+    // NumLevels() if none does
+    UINT LevelForPosition(FXMVECTOR position) const;
+
+    // regions of the new window that were not part of the old one, disjoint slabs along x, y and z
+    static std::vector<ClipmapRegion> ScrollRegions(const XMINT3 &oldOrigin, const XMINT3 &newOrigin, UINT resolution);
+
+    // one R16G16B16A16_FLOAT texture per level plus the shared voxel buffer
+    UINT64 MemoryBytes() const;
+
+private:
+    XMINT3 CenteredOrigin(UINT level, FXMVECTOR center) const;
+
+private:
+    UINT m_NumLevels;
+    UINT m_Resolution;
+    float m_BaseVoxelSize;
+
+    bool m_Initialized = false;
+    std::vector<XMINT3> m_Origins;
+    std::vector<std::vector<ClipmapRegion>> m_DirtyRegions;
+};
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "VoxelDirtyRegions.h"
+
+static const UINT NUM_BRICKS = VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION;
+
+// conservative rasterization can write one voxel past the geometry
+static const float REGION_MARGIN = 1.0f;
+
+static UINT BrickIndex(UINT x, UINT y, UINT z)
+{
+    return (z * VOXEL_BRICK_DIMENSION + y) * VOXEL_BRICK_DIMENSION + x;
+}
+
+void VoxelDirtyRegions::Reset(const BrickOccupancy &occupancy)
+{
+    m_Occupied.assign(NUM_BRICKS, false);
+    m_Queued.assign(NUM_BRICKS, false);
+    m_Queue.clear();
+    m_Items.clear();
+
+    for (UINT packed : occupancy.OccupiedBricks())
+    {
+        XMUINT3 brick = BrickOccupancy::UnpackBrick(packed);
+        m_Occupied[BrickIndex(brick.x, brick.y, brick.z)] = true;
+    }
+}
+
+bool VoxelDirtyRegions::UpdateItem(UINT id, const BoundingBox &bounds)
+{
+    auto it = m_Items.find(id);
+    if (it != m_Items.end())
+    {
+        const BoundingBox &prev = it->second;
+        if (XMVector3Equal(XMLoadFloat3(&prev.Center), XMLoadFloat3(&bounds.Center)) &&
+            XMVector3Equal(XMLoadFloat3(&prev.Extents), XMLoadFloat3(&bounds.Extents)))
+            return false;
+
+        // the voxels the item leaves behind have to be rewritten too
+        MarkRegion(prev);
+    }
+
+    MarkRegion(bounds);
+    m_Items[id] = bounds;
+    return true;
+}
+
+void VoxelDirtyRegions::RemoveItem(UINT id)
+{
+    auto it = m_Items.find(id);
+    if (it == m_Items.end())
+        return;
+
+    MarkRegion(it->second);
+    m_Items.erase(it);
+}
+
+void VoxelDirtyRegions::MarkRegion(const BoundingBox &bounds)
+{
+    XMFLOAT3 minPoint, maxPoint;
+    XMStoreFloat3(&minPoint, XMLoadFloat3(&bounds.Center) - XMLoadFloat3(&bounds.Extents));
+    XMStoreFloat3(&maxPoint, XMLoadFloat3(&bounds.Center) + XMLoadFloat3(&bounds.Extents));
+
+    const float dimension = (float)VOXEL_DIMENSION;
+    if (maxPoint.x + REGION_MARGIN < 0.0f || maxPoint.y + REGION_MARGIN < 0.0f || maxPoint.z + REGION_MARGIN < 0.0f ||
+        minPoint.x - REGION_MARGIN >= dimension || minPoint.y - REGION_MARGIN >= dimension || minPoint.z - REGION_MARGIN >= dimension)
+        return;
+
+    auto brickRange = [](float minValue, float maxValue, int &first, int &last)
+    {
+        first = std::max(int(floorf((minValue - REGION_MARGIN) / VOXEL_BRICK_SIZE)), 0);
+        last = std::min(int(floorf((maxValue + REGION_MARGIN) / VOXEL_BRICK_SIZE)), VOXEL_BRICK_DIMENSION - 1);
+    };
+
+    int x0, x1, y0, y1, z0, z1;
+    brickRange(minPoint.x, maxPoint.x, x0, x1);
+    brickRange(minPoint.y, maxPoint.y, y0, y1);
+    brickRange(minPoint.z, maxPoint.z, z0, z1);
+
+    for (int z = z0; z <= z1; z++)
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                MarkBrick(BrickIndex(x, y, z));
+}
+
+void VoxelDirtyRegions::MarkAll()
+{
+    for (UINT i = 0; i < m_Occupied.size(); i++)
+        MarkBrick(i);
+}
+
+void VoxelDirtyRegions::MarkBrick(UINT index)
+{
+    if (!m_Occupied[index] || m_Queued[index])
+        return;
+
+    m_Queued[index] = true;
+    m_Queue.push_back(index);
+}
+
+std::vector<UINT> VoxelDirtyRegions::Pop(UINT budget)
+{
+    std::vector<UINT> bricks;
+    bricks.reserve(std::min<size_t>(budget, m_Queue.size()));
+
+    while (!m_Queue.empty() && bricks.size() < budget)
+    {
+        UINT index = m_Queue.front();
+        m_Queue.pop_front();
+        m_Queued[index] = false;
+
+        UINT x = index % VOXEL_BRICK_DIMENSION;
+        UINT y = (index / VOXEL_BRICK_DIMENSION) % VOXEL_BRICK_DIMENSION;
+        UINT z = index / (VOXEL_BRICK_DIMENSION * VOXEL_BRICK_DIMENSION);
+        bricks.push_back(BrickOccupancy::PackBrick(x, y, z));
+    }
+
+    return bricks;
+}
+
+bool VoxelDirtyRegions::IsDirty(UINT x, UINT y, UINT z) const
+{
+    return m_Queued[BrickIndex(x, y, z)];
+}
+
+BoundingBox VoxelDirtyRegions::ToVoxelSpace(const BoundingBox &localBounds, FXMMATRIX world)
+{
+    // the affine part of WorldToVoxelSpace
+    const float scale = 0.5f / VOXEL_GRID_SIZE;
+    const float offset = VOXEL_DIMENSION * 0.5f;
+    XMMATRIX worldToVoxel = XMMatrixScaling(scale, -scale, scale) * XMMatrixTranslation(offset, offset, offset);
+
+    BoundingBox bounds;
+    localBounds.Transform(bounds, world * worldToVoxel);
+    return bounds;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "pch.h"
+#include "VoxelBricks.h"
+
+#include <deque>
+
+// Bookkeeping for incremental revoxelization. Bricks are marked dirty when the geometry or
+// lighting covering them changes and are handed out oldest first, a budgeted number per frame.
+// Only bricks allocated in the occupancy are ever queued, and a brick is queued at most once.
+class VoxelDirtyRegions
+{
+public:
+    VoxelDirtyRegions() = default;
+
+    void Reset(const BrickOccupancy &occupancy);
+
+    // bounds in voxel space. The bricks under the previous and the new bounds are marked
+    // when the item is new or its bounds changed. Returns whether anything was marked.
+    bool UpdateItem(UINT id, const BoundingBox &bounds);
+    void RemoveItem(UINT id);
+
+    void MarkRegion(const BoundingBox &bounds);
+    void MarkAll();
+
+    // removes up to budget bricks from the queue, packed like BrickOccupancy::PackBrick
+    std::vector<UINT> Pop(UINT budget);
+
+    UINT NumDirty() const { return m_Queue.size(); }
+    bool IsDirty(UINT x, UINT y, UINT z) const;
+
+    // local space bounds -> voxel space bounds
+    static BoundingBox ToVoxelSpace(const BoundingBox &localBounds, FXMMATRIX world);
+
+private:
+    void MarkBrick(UINT index);
+
+private:
+    std::vector<bool> m_Occupied;
+    std::vector<bool> m_Queued;
+    std::deque<UINT> m_Queue;
+    std::unordered_map<UINT, BoundingBox> m_Items;
+};
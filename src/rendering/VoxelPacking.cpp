@@ -0,0 +1,116 @@
+#include "pch.h"
+#include "VoxelPacking.h"
+
+static const int RGB9E5_MANTISSA_BITS = 9;
+static const int RGB9E5_EXP_BIAS = 15;
+
+UINT VoxelPacking::PackRGB9E5(const XMFLOAT3 &rgb)
+{
+    float r = std::clamp(rgb.x, 0.0f, MAX_RADIANCE);
+    float g = std::clamp(rgb.y, 0.0f, MAX_RADIANCE);
+    float b = std::clamp(rgb.z, 0.0f, MAX_RADIANCE);
+
+    // black would take the log of zero, any value below the smallest exponent encodes the same
+    float maxColor = std::max(std::max(r, g), std::max(b, 1.0e-20f));
+
+    int exponent = std::max(-RGB9E5_EXP_BIAS - 1, (int)floorf(log2f(maxColor))) + 1 + RGB9E5_EXP_BIAS;
+    float denom = exp2f((float)(exponent - RGB9E5_EXP_BIAS - RGB9E5_MANTISSA_BITS));
+
+    // rounding can carry the largest mantissa into the next exponent
+    if (floorf(maxColor / denom + 0.5f) == 512.0f)
+    {
+        denom *= 2;
+        exponent++;
+    }
+
+    UINT mr = (UINT)floorf(r / denom + 0.5f);
+    UINT mg = (UINT)floorf(g / denom + 0.5f);
+    UINT mb = (UINT)floorf(b / denom + 0.5f);
+    return mr | (mg << 9) | (mb << 18) | ((UINT)exponent << 27);
+}
+
+XMFLOAT3 VoxelPacking::UnpackRGB9E5(UINT packed)
+{
+    int exponent = packed >> 27;
+    float scale = exp2f((float)(exponent - RGB9E5_EXP_BIAS - RGB9E5_MANTISSA_BITS));
+    return XMFLOAT3((packed & 0x1FF) * scale, ((packed >> 9) & 0x1FF) * scale, ((packed >> 18) & 0x1FF) * scale);
+}
+
+UINT VoxelPacking::PackOctahedralNormal(const XMFLOAT3 &normal)
+{
+    float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    float x = normal.x / length;
+    float y = normal.y / length;
+
+    if (normal.z < 0)
+    {
+        float ox = (1 - fabsf(y)) * (x >= 0 ? 1.0f : -1.0f);
+        float oy = (1 - fabsf(x)) * (y >= 0 ? 1.0f : -1.0f);
+        x = ox;
+        y = oy;
+    }
+
+    UINT qx = (UINT)roundf(std::clamp(x * 0.5f + 0.5f, 0.0f, 1.0f) * 1023.0f);
+    UINT qy = (UINT)roundf(std::clamp(y * 0.5f + 0.5f, 0.0f, 1.0f) * 1023.0f);
+    return qx | (qy << 10);
+}
+
+XMFLOAT3 VoxelPacking::UnpackOctahedralNormal(UINT packed)
+{
+    float x = (packed & 0x3FF) / 1023.0f * 2 - 1;
+    float y = ((packed >> 10) & 0x3FF) / 1023.0f * 2 - 1;
+    float z = 1 - fabsf(x) - fabsf(y);
+
+    float t = std::clamp(-z, 0.0f, 1.0f);
+    x += x >= 0 ? -t : t;
+    y += y >= 0 ? -t : t;
+
+    XMFLOAT3 normal;
+    XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+    return normal;
+}
+
+UINT64 VoxelPacking::PackVoxel(const XMFLOAT3 &radiance, const XMFLOAT3 &normal, UINT coverage)
+{
+    return (UINT64)PackRGB9E5(radiance) |
+           ((UINT64)PackOctahedralNormal(normal) << 32) |
+           ((UINT64)std::min(coverage, MAX_COVERAGE) << 52);
+}
+
+void VoxelPacking::UnpackVoxel(UINT64 packed, XMFLOAT3 &radiance, XMFLOAT3 &normal, UINT &coverage)
+{
+    radiance = UnpackRGB9E5((UINT)packed);
+    normal = UnpackOctahedralNormal((UINT)(packed >> 32) & 0xFFFFF);
+    coverage = (UINT)(packed >> 52);
+}
+
+UINT64 VoxelPacking::Accumulate(UINT64 packed, const XMFLOAT3 &radiance, const XMFLOAT3 &normal)
+{
+    // an interpolated normal is shorter than one and would weigh less in the average
+    XMVECTOR newNormal = XMVector3Normalize(XMLoadFloat3(&normal));
+    XMFLOAT3 unitNormal;
+    XMStoreFloat3(&unitNormal, newNormal);
+
+    XMFLOAT3 prevRadiance, prevNormal;
+    UINT coverage;
+    UnpackVoxel(packed, prevRadiance, prevNormal, coverage);
+
+    if (coverage == 0)
+        return PackVoxel(radiance, unitNormal, 1);
+
+    // the weight of a new fragment stops shrinking once the coverage saturates
+    float weight = 1.0f / (coverage + 1);
+
+    XMFLOAT3 averageRadiance;
+    XMStoreFloat3(&averageRadiance, XMVectorLerp(XMLoadFloat3(&prevRadiance), XMLoadFloat3(&radiance), weight));
+
+    XMVECTOR averageNormal = XMVectorLerp(XMLoadFloat3(&prevNormal), newNormal, weight);
+
+    // opposite normals cancel out, keep the new one then
+    if (XMVectorGetX(XMVector3LengthSq(averageNormal)) <= 1.0e-8f)
+        averageNormal = newNormal;
+
+    XMFLOAT3 packedNormal;
+    XMStoreFloat3(&packedNormal, XMVector3Normalize(averageNormal));
+    return PackVoxel(averageRadiance, packedNormal, coverage + 1);
+}
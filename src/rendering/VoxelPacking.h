@@ -0,0 +1,35 @@
+#pragma once
+
+#include "pch.h"
+
+// mirrors VOXEL_COMPACT_PACKING in constants.hlsl
+#define VOXEL_COMPACT_PACKING 1
+
+// CPU mirror of the compact voxel record of voxelUtils.hlsl, one 64-bit word per voxel:
+//   bits  0-31 radiance, RGB9E5 (9 bit mantissas, 5 bit shared exponent)
+//   bits 32-51 normal, octahedral with 10 bits per axis
+//   bits 52-63 coverage, number of fragments averaged so far, saturating
+class VoxelPacking
+{
+public:
+    static constexpr float MAX_RADIANCE = 65408.0f; // (511 / 512) * 2^16
+    static constexpr UINT MAX_COVERAGE = 4095;
+
+    // negative components are clamped to zero and the ones above MAX_RADIANCE to MAX_RADIANCE
+    static UINT PackRGB9E5(const XMFLOAT3 &rgb);
+    static XMFLOAT3 UnpackRGB9E5(UINT packed);
+
+    // 20 bits, the normal needs not be normalized but must not be zero
+    static UINT PackOctahedralNormal(const XMFLOAT3 &normal);
+    static XMFLOAT3 UnpackOctahedralNormal(UINT packed);
+
+    static UINT64 PackVoxel(const XMFLOAT3 &radiance, const XMFLOAT3 &normal, UINT coverage);
+    static void UnpackVoxel(UINT64 packed, XMFLOAT3 &radiance, XMFLOAT3 &normal, UINT &coverage);
+
+    // Averages a fragment into the record, the body of the compare exchange loop of AccumulateVoxel,
+    // the same as AccumulatePackedVoxel. The n-th fragment moves the average by its difference over
+    // n + 1 (n capped at MAX_COVERAGE), which is rounded away once it is below half a mantissa unit
+    // of the RGB9E5 radiance or a step of the octahedral normal. The average then stops following
+    // new fragments, and stays within a few percent of the mean of all of them for noisy input.
+    static UINT64 Accumulate(UINT64 packed, const XMFLOAT3 &radiance, const XMFLOAT3 &normal);
+};
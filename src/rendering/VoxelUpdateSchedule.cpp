@@ -0,0 +1,57 @@
+#include "pch.h"
+#include "VoxelUpdateSchedule.h"
+
+void VoxelUpdateSchedule::Reset(const std::vector<UINT> &bricks)
+{
+    m_Bricks = bricks;
+    Build();
+}
+
+void VoxelUpdateSchedule::Configure(VoxelSchedulePattern pattern, UINT numSlices)
+{
+    numSlices = std::max(numSlices, 1u);
+    if (pattern == m_Pattern && numSlices == m_Slices.size())
+        return;
+
+    m_Pattern = pattern;
+    m_Slices.resize(numSlices);
+    Build();
+}
+
+const std::vector<UINT> &VoxelUpdateSchedule::Slice(UINT64 frame) const
+{
+    return m_Slices[frame % m_Slices.size()];
+}
+
+UINT VoxelUpdateSchedule::SliceCount(UINT numBricks, float fraction, UINT maxBricksPerFrame)
+{
+    if (numBricks == 0)
+        return 1;
+
+    fraction = std::clamp(fraction, 1.0f / numBricks, 1.0f);
+    UINT slices = (UINT)ceilf(1.0f / fraction);
+
+    maxBricksPerFrame = std::max(maxBricksPerFrame, 1u);
+    slices = std::max(slices, (numBricks + maxBricksPerFrame - 1) / maxBricksPerFrame);
+
+    return std::min(slices, numBricks);
+}
+
+void VoxelUpdateSchedule::Build()
+{
+    UINT numSlices = m_Slices.size();
+    for (auto &slice : m_Slices)
+        slice.clear();
+
+    for (UINT slot = 0; slot < m_Bricks.size(); slot++)
+    {
+        UINT index = slot % numSlices;
+        if (m_Pattern == VoxelSchedulePattern::Checkerboard)
+        {
+            XMUINT3 brick = BrickOccupancy::UnpackBrick(m_Bricks[slot]);
+            index = (brick.x + brick.y + brick.z) % numSlices;
+        }
+
+        m_Slices[index].push_back(slot);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "pch.h"
+#include "VoxelBricks.h"
+
+enum class VoxelSchedulePattern
+{
+    Interleaved = 0, // every NumSlices-th slot of the brick pool
+    Checkerboard,    // diagonal planes of bricks, a 3D checkerboard with two slices
+};
+
+// Time slicing of the work that is refreshed even when the scene is static, the second bounce.
+// The occupied bricks are split into NumSlices slices and frame n refreshes slice n % NumSlices,
+// so every brick is refreshed exactly once per cycle. The split only depends on the bricks and
+// the configuration, never on timing.
+class VoxelUpdateSchedule
+{
+public:
+    VoxelUpdateSchedule() = default;
+
+    // packed coordinates of the occupied bricks in brick pool order
+    void Reset(const std::vector<UINT> &bricks);
+    void Configure(VoxelSchedulePattern pattern, UINT numSlices);
+
+    // brick pool slots refreshed in the given frame
+    const std::vector<UINT> &Slice(UINT64 frame) const;
+
+    UINT NumSlices() const { return (UINT)m_Slices.size(); }
+    VoxelSchedulePattern Pattern() const { return m_Pattern; }
+    UINT Brick(UINT slot) const { return m_Bricks[slot]; }
+
+    // slices needed to refresh at least the given fraction of the bricks every frame. The
+    // interleaved slices then never hold more than maxBricksPerFrame bricks, the checkerboard
+    // ones only on average
+    static UINT SliceCount(UINT numBricks, float fraction, UINT maxBricksPerFrame);
+
+private:
+    void Build();
+
+private:
+    std::vector<UINT> m_Bricks;
+    std::vector<std::vector<UINT>> m_Slices = {{}};
+    VoxelSchedulePattern m_Pattern = VoxelSchedulePattern::Interleaved;
+};
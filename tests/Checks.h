@@ -0,0 +1,66 @@
+#pragma once
+
+#include "pch.h"
+
+// The checks run on the CPU without a window or a device. Each logs what does not hold and
+// returns 0 if everything does, 1 otherwise. See tests/main.cpp for their names.
+
+// Logs every condition of a check that does not hold, under the prefix of the check, and counts them
+class Checker
+{
+public:
+	explicit Checker(const char *prefix) : m_Prefix(prefix) {}
+
+	void Check(bool condition, const std::string &message)
+	{
+		if (!condition)
+		{
+			LOG_ERROR("{}: {}", m_Prefix, message);
+			m_Failures++;
+		}
+	}
+
+	// logs the number of failed conditions and returns the exit code of the check
+	int Result() const
+	{
+		LOG_INFO("{}: {} check(s) failed", m_Prefix, m_Failures);
+		return m_Failures == 0 ? 0 : 1;
+	}
+
+	int Failures() const { return m_Failures; }
+
+private:
+	const char *m_Prefix;
+	int m_Failures = 0;
+};
+
+int CheckSHIrradiance();
+int CheckIBLCache();
+
+int CheckVoxelDirtyRegions();
+int CheckBrickOccupancy();
+int CheckVoxelClipmap();
+int CheckVoxelSchedule();
+int CheckVoxelPacking();
+int CheckCpuVoxelizer();
+
+int CheckCascadeFitting();
+int CheckShadowCache();
+int CheckShadowCulling();
+
+int CheckIndirectDraw();
+
+int CheckGpuMemory();
+int CheckFrameCapture();
+int CheckStagingRing();
+
+int CheckBenchmark();
+int CheckFramePacer();
+int CheckCounters();
+int CheckInitGraph();
+int CheckRangeAllocator();
+
+#ifdef ENABLE_PROFILER
+int CheckProfiler();
+int CheckGpuTimestamps();
+#endif
@@ -0,0 +1,767 @@
+#include "pch.h"
+#include "Checks.h"
+#include "Benchmark.h"
+#include "core/FramePacer.h"
+#include "core/InitGraph.h"
+#include "core/RangeAllocator.h"
+#include "core/Timer.h"
+
+#include <random>
+
+// Checks the camera path files, the spline through their keys, the settings changes, the frame
+// statistics and comparing results with a baseline, without rendering anything.
+// Usage: YARendererChecks benchmark
+int CheckBenchmark()
+{
+	Checker checker("Benchmark");
+
+	auto near = [](const XMFLOAT3 &a, const XMFLOAT3 &b)
+	{
+		return fabsf(a.x - b.x) < 1.0e-4f && fabsf(a.y - b.y) < 1.0e-4f && fabsf(a.z - b.z) < 1.0e-4f;
+	};
+
+	auto parse = [](const char *text, CameraPath &path)
+	{
+		std::istringstream in(text);
+		std::string error;
+		return path.Parse(in, error);
+	};
+
+	// the first two segments move at a constant speed, which the spline has to keep
+	CameraPath path;
+	checker.Check(parse("# flight\n"
+						"timestep 0.25\n"
+						"warmup 2\n"
+						"key 0  0 0 0  0 0 1\n"
+						"key 1  1 0 0  1 0 1  # straight on\n"
+						"key 2  2 0 0  2 0 1\n"
+						"key 4  2 4 0  2 4 1\n"
+						"set 1.5 GI.SecondBounce 0\n"
+						"set 0.5 EnableMotionBlur 0\n",
+						path),
+				  "valid path is rejected");
+
+	checker.Check(path.Keys().size() == 4 && path.Duration() == 4.0f && path.TimeStep() == 0.25f && path.WarmupFrames() == 2, "path is read wrong");
+	checker.Check(path.SettingChanges().size() == 2 && path.SettingChanges()[0].Name == "EnableMotionBlur", "settings changes are not sorted by time");
+
+	XMFLOAT3 position, target;
+	for (const auto &key : path.Keys())
+	{
+		path.Sample(key.Time, position, target);
+		checker.Check(near(position, key.Position) && near(target, key.Target), "spline misses a key");
+	}
+
+	path.Sample(0.5f, position, target);
+	checker.Check(near(position, XMFLOAT3(0.5f, 0.0f, 0.0f)) && near(target, XMFLOAT3(0.5f, 0.0f, 1.0f)), "spline does not keep a constant speed");
+
+	path.Sample(-1.0f, position, target);
+	checker.Check(near(position, path.Keys().front().Position), "spline is not clamped at the start");
+	path.Sample(10.0f, position, target);
+	checker.Check(near(position, path.Keys().back().Position), "spline is not clamped at the end");
+
+	XMFLOAT3 before, after;
+	path.Sample(2.0f - 1.0e-3f, before, target);
+	path.Sample(2.0f + 1.0e-3f, after, target);
+	checker.Check(fabsf(before.x - after.x) + fabsf(before.y - after.y) < 0.02f, "spline jumps at a key");
+
+	CameraPath invalid;
+	checker.Check(!parse("key 1 0 0 0 0 0 1\nkey 0 0 0 0 0 0 1\n", invalid), "keys going back in time are accepted");
+	checker.Check(!parse("key 0 0 0 0 0 0\n", invalid), "incomplete key is accepted");
+	checker.Check(!parse("fly 0 0 0\nkey 0 0 0 0 0 0 1\n", invalid), "unknown command is accepted");
+	checker.Check(!parse("timestep 0.1\n", invalid), "path without keys is accepted");
+
+	CameraPath unknownSetting;
+	parse("key 0 0 0 0 0 0 1\nset 0 NoSuchSetting 1\n", unknownSetting);
+	Benchmark rejected(3);
+	checker.Check(!rejected.SetPath(unknownSetting), "unknown setting is accepted");
+
+	// 2 warmup frames at the start, then the path from 0 to 4 seconds in steps of 0.25
+	const int gpuLatency = 3;
+	Benchmark benchmark(gpuLatency);
+	checker.Check(benchmark.SetPath(path), "path is rejected");
+
+	Camera camera;
+	camera.SetLens(0.25f * MathHelper::Pi, 16.0f / 9.0f, 0.5f, 1000.0f);
+	RenderingSettings settings;
+
+	int frame = 0;
+	while (benchmark.BeginFrame(camera, settings))
+	{
+		if (frame == 1)
+			checker.Check(near(camera.GetPosition3f(), path.Keys().front().Position), "camera moves during the warmup");
+
+		benchmark.EndFrame(frame, 100.0 + frame);
+		frame++;
+	}
+
+	const auto &frames = benchmark.Frames();
+	checker.Check(frame == 2 + 17 && frames.size() == 17, "wrong number of frames");
+	checker.Check(near(camera.GetPosition3f(), path.Keys().back().Position), "camera does not end at the last key");
+	checker.Check(!settings.EnableMotionBlur && !settings.GI.SecondBounce, "settings are not changed");
+
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		checker.Check(frames[i].Time == i * 0.25 && frames[i].CpuMs == 2 + i, "CPU time of a frame is recorded wrong");
+
+		bool arrived = i + gpuLatency < frames.size();
+		checker.Check(arrived ? frames[i].GpuMs == 100.0 + 2 + gpuLatency + i : frames[i].GpuMs < 0.0, "GPU time is not matched with its frame");
+	}
+
+	// 1 to 100 ms
+	std::vector<double> samples;
+	for (int i = 100; i >= 1; i--)
+		samples.push_back(i);
+
+	FrameStats stats = FrameStats::Compute(samples);
+	checker.Check(stats.Count == 100 && stats.Min == 1.0 && stats.Max == 100.0 && fabs(stats.Mean - 50.5) < 1.0e-9, "frame stats are wrong");
+	checker.Check(fabs(stats.P50 - 50.5) < 1.0e-9 && fabs(stats.P95 - 95.05) < 1.0e-9 && fabs(stats.P99 - 99.01) < 1.0e-9, "percentiles are wrong");
+	checker.Check(fabs(stats.StdDev - 29.011491975882) < 1.0e-9, "standard deviation is wrong");
+
+	// the results read back from JSON compare equal, a slower run fails
+	std::stringstream json;
+	benchmark.WriteJson(json);
+
+	BenchmarkResults results = benchmark.Results();
+	BenchmarkResults baseline;
+	checker.Check(Benchmark::ReadJson(json, baseline), "results cannot be read back");
+	checker.Check(baseline.Cpu.Count == results.Cpu.Count && fabs(baseline.Cpu.P95 - results.Cpu.P95) < 1.0e-6 &&
+					  fabs(baseline.Gpu.StdDev - results.Gpu.StdDev) < 1.0e-6,
+				  "results are not read back as written");
+
+	checker.Check(Benchmark::Compare(results, baseline, 0.05) == 0, "same results are a regression");
+
+	BenchmarkResults slower = results;
+	slower.Cpu.Mean *= 1.2;
+	slower.Cpu.P99 *= 1.2;
+	slower.Gpu.P50 *= 1.03;
+	checker.Check(Benchmark::Compare(slower, baseline, 0.05) == 2, "regressions beyond the tolerance are not found");
+
+	return checker.Result();
+}
+
+// Drives the timer and the frame pacer with a fake clock: the deltas and their smoothing, that a
+// paced frame ends on its deadline whatever the work and the oversleep, that the spin margin grows
+// to cover a late scheduler and that a hitch starts the schedule over instead of rushing frames.
+// Usage: YARendererChecks frame-pacer
+int CheckFramePacer()
+{
+	Checker checker("Frame pacer");
+
+	const int64_t ms = 1'000'000;
+
+	{
+		FakeClock clock;
+		Timer timer(clock);
+		timer.Reset();
+
+		clock.Advance(16 * ms);
+		timer.Tick();
+		checker.Check(fabs(timer.DeltaTime() - 0.016f) < 1e-6f, "the delta is the time between ticks");
+
+		clock.Advance(4 * ms);
+		timer.Tick();
+		checker.Check(fabs(timer.TotalTime() - 0.020f) < 1e-6f, "the total time counts from the reset");
+
+		timer.SetFixedDeltaTime(0.5);
+		timer.Tick();
+		checker.Check(timer.DeltaTime() == 0.5f && fabs(timer.TotalTime() - 0.520f) < 1e-6f, "a fixed delta ignores the clock");
+	}
+
+	{
+		FakeClock clock;
+		Timer timer(clock);
+		timer.SetSmoothing(8);
+		timer.Reset();
+
+		// frames alternating between 10 and 22 ms
+		double maxJitter = 0.0;
+		for (int frame = 0; frame < 64; frame++)
+		{
+			clock.Advance(frame % 2 == 0 ? 10 * ms : 22 * ms);
+			timer.Tick();
+			if (frame >= 8)
+				maxJitter = std::max(maxJitter, fabs(timer.DeltaTime() - 0.016f));
+		}
+		checker.Check(maxJitter < 1e-6f, "the smoothed delta of alternating frames is their mean");
+		checker.Check(fabs(timer.RawDeltaTime() - 0.022f) < 1e-6f, "the raw delta is kept");
+
+		// takes the place of a 10 ms frame
+		clock.Advance(96 * ms);
+		timer.Tick();
+		checker.Check(fabs(timer.DeltaTime() - (0.016f + 0.086f / 8)) < 1e-6f, "a hitch is spread over the smoothed frames");
+
+		timer.SetSmoothing(1);
+		clock.Advance(30 * ms);
+		timer.Tick();
+		checker.Check(fabs(timer.DeltaTime() - 0.030f) < 1e-6f, "a smoothing of one frame is the raw delta");
+	}
+
+	{
+		FakeClock clock;
+		clock.Step = 1000;
+		FramePacer pacer(clock);
+
+		pacer.Wait();
+		checker.Check(clock.Sleeps == 0, "no limit does not wait");
+
+		pacer.SetTargetFps(60.0);
+		pacer.Wait();
+		int64_t start = clock.Now();
+
+		std::mt19937 rng(7);
+		std::uniform_int_distribution<int64_t> work(1 * ms, 12 * ms);
+		int64_t minError = 0;
+		int64_t maxError = 0;
+		for (int frame = 1; frame <= 100; frame++)
+		{
+			clock.Advance(work(rng));
+			pacer.Wait();
+
+			int64_t deadline = start + frame * (int64_t)(1.0e9 / 60.0);
+			int64_t now = clock.Now();
+			minError = std::min(minError, now - deadline);
+			maxError = std::max(maxError, now - deadline);
+		}
+		checker.Check(maxError <= clock.Step, "paced frames end on their deadline");
+		checker.Check(minError >= 0, "paced frames do not end early");
+		checker.Check(clock.Sleeps == 100, "the wait before the margin is slept");
+		checker.Check(pacer.DeadlineErrors().Count == 100, "every paced frame records its error");
+	}
+
+	{
+		// a scheduler waking up 3 ms late
+		FakeClock clock;
+		clock.Step = 1000;
+		clock.Oversleep = 3 * ms;
+		FramePacer pacer(clock);
+		pacer.SetTargetFps(60.0);
+		pacer.Wait();
+
+		for (int frame = 0; frame < 10; frame++)
+		{
+			clock.Advance(2 * ms);
+			pacer.Wait();
+		}
+		checker.Check(pacer.SpinMarginMs() > 3.0, "the spin margin grows over the oversleep");
+
+		FrameStats before = pacer.DeadlineErrors();
+		pacer.SetTargetFps(0.0);
+		pacer.SetTargetFps(60.0);
+		pacer.Wait();
+		for (int frame = 0; frame < 10; frame++)
+		{
+			clock.Advance(2 * ms);
+			pacer.Wait();
+		}
+		FrameStats after = pacer.DeadlineErrors();
+		checker.Check(before.Max > 500.0, "the first frames with the initial margin wake up late");
+		checker.Check(after.Max < 10.0, "a grown margin keeps the frames on their deadline");
+	}
+
+	{
+		FakeClock clock;
+		clock.Step = 1000;
+		FramePacer pacer(clock);
+		pacer.SetTargetFps(100.0);
+		pacer.Wait();
+
+		clock.Advance(55 * ms);
+		pacer.Wait();
+		int sleeps = clock.Sleeps;
+		int64_t afterHitch = clock.Now();
+
+		clock.Advance(1 * ms);
+		pacer.Wait();
+		checker.Check(clock.Sleeps == sleeps + 1, "the frame after a hitch waits");
+		checker.Check(clock.Now() - afterHitch >= 9 * ms, "the frame after a hitch gets a whole period");
+
+		pacer.SetSpinEnabled(false);
+		clock.Advance(1 * ms);
+		pacer.Wait();
+		checker.Check(pacer.LastSpinMs() < 0.01, "without spinning the whole wait is slept");
+	}
+
+	return checker.Result();
+}
+
+// Adds to counters from 8 threads while the main thread closes frames and checks that no add is
+// lost, that registering is idempotent from any thread, that gauges keep their value, that the
+// history wraps around, and that the CSV and the benchmark JSON carry the counters.
+// Usage: YARendererChecks counters
+int CheckCounters()
+{
+	Checker checker("Counters");
+
+	{
+		auto counters = std::make_unique<CounterRegistry>();
+		const int numThreads = 8;
+		const int numAdds = 200000;
+
+		std::atomic<int> running = numThreads;
+		std::vector<std::thread> threads;
+		std::vector<int> ids(numThreads);
+		for (int t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([&, t]()
+								 {
+				// every thread registers the same names, and one of its own
+				int draws = counters->Register("Draws");
+				int bytes = counters->Register("Bytes");
+				ids[t] = counters->Register(("Thread " + std::to_string(t)).c_str());
+
+				for (int i = 0; i < numAdds; i++)
+				{
+					counters->Add(draws);
+					counters->Add(bytes, 3);
+					counters->Add(ids[t]);
+				}
+				running--; });
+		}
+
+		// closes frames while the threads add, every add has to land in exactly one of them
+		int64_t draws = 0, bytes = 0;
+		int frames = 0;
+		auto closeFrame = [&]()
+		{
+			counters->NewFrame();
+			frames++;
+			for (int id = 0; id < counters->Count(); id++)
+			{
+				if (counters->Name(id) == "Draws")
+					draws += counters->LastFrame(id);
+				else if (counters->Name(id) == "Bytes")
+					bytes += counters->LastFrame(id);
+			}
+		};
+		while (running > 0)
+			closeFrame();
+		for (auto &thread : threads)
+			thread.join();
+		closeFrame();
+
+		checker.Check(counters->Count() == 2 + numThreads, "the threads registered " + std::to_string(counters->Count()) + " counters");
+		checker.Check(draws == (int64_t)numThreads * numAdds, "lost adds: " + std::to_string(draws) + " draws");
+		checker.Check(bytes == 3 * (int64_t)numThreads * numAdds, "lost adds: " + std::to_string(bytes) + " bytes");
+
+		std::unordered_set<int> unique(ids.begin(), ids.end());
+		checker.Check(unique.size() == numThreads, "the names of the threads share ids");
+		LOG_INFO("Counters: {} threads added {} times each over {} frame(s)", numThreads, 3 * numAdds, frames);
+	}
+
+	{
+		auto counters = std::make_unique<CounterRegistry>();
+		int frame = counters->Register("Frame");
+		int gauge = counters->Register("Descriptors", CounterKind::Gauge);
+		checker.Check(counters->Register("Descriptors") == gauge && counters->Kind(gauge) == CounterKind::Gauge, "a second registration changes the counter");
+
+		counters->Set(gauge, 42);
+		for (int i = 0; i < CounterRegistry::HISTORY_SIZE + 60; i++)
+		{
+			counters->Add(frame, i);
+			counters->NewFrame();
+		}
+		checker.Check(counters->Value(frame) == 0, "a frame counter is not cleared");
+		checker.Check(counters->LastFrame(gauge) == 42 && counters->Value(gauge) == 42, "a gauge loses its value");
+		checker.Check(counters->Frames() == CounterRegistry::HISTORY_SIZE, "the history holds more than its size");
+
+		const float *history = counters->History(frame);
+		int offset = counters->HistoryOffset();
+		checker.Check(history[offset] == 60.0f, "the history does not start at the oldest frame");
+		checker.Check(history[(offset + CounterRegistry::HISTORY_SIZE - 1) % CounterRegistry::HISTORY_SIZE] == CounterRegistry::HISTORY_SIZE + 59.0f,
+					  "the history does not end at the last frame");
+
+		std::ostringstream csv;
+		counters->WriteCsv(csv);
+		std::string text = csv.str();
+		checker.Check(text.rfind("frame,Frame,Descriptors\n0,60,42\n", 0) == 0, "the CSV starts with " + text.substr(0, 32));
+		checker.Check(std::count(text.begin(), text.end(), '\n') == CounterRegistry::HISTORY_SIZE + 1, "the CSV has a row per frame");
+
+		for (int i = counters->Count(); i < CounterRegistry::MAX_COUNTERS; i++)
+			counters->Register(("Filler " + std::to_string(i)).c_str());
+		int overflow = counters->Register("Overflow");
+		counters->Add(overflow);
+		checker.Check(overflow == CounterRegistry::INVALID_ID, "a full table registers a counter");
+	}
+
+	{
+		CameraPath path;
+		std::istringstream in("timestep 0.5\nwarmup 1\nkey 0  0 0 0  0 0 1\nkey 1  1 0 0  1 0 1\n");
+		std::string error;
+		checker.Check(path.Parse(in, error), "the camera path is rejected: " + error);
+
+		auto counters = std::make_unique<CounterRegistry>();
+		int draws = counters->Register("Draw Calls");
+
+		Benchmark benchmark(0);
+		benchmark.SetPath(path);
+		Camera camera;
+		RenderingSettings settings;
+		for (int frame = 0; benchmark.BeginFrame(camera, settings); frame++)
+		{
+			counters->NewFrame();
+			counters->Add(draws, 100 + frame);
+			benchmark.RecordCounters(*counters);
+			benchmark.EndFrame(1.0, -1.0);
+		}
+
+		// the warmup frame drew 100
+		BenchmarkResults results = benchmark.Results();
+		checker.Check(results.Counters.size() == 1 && results.Counters[0].first == "Draw Calls", "the benchmark misses the counter");
+		checker.Check(results.Counters.size() == 1 && results.Counters[0].second.Count == 3 && results.Counters[0].second.Min == 101.0 &&
+						  results.Counters[0].second.Max == 103.0,
+					  "the benchmark counts the warmup frames");
+
+		std::ostringstream json;
+		benchmark.WriteJson(json);
+		checker.Check(json.str().find("\"counters\": {\n    \"Draw Calls\": {\"count\": 3") != std::string::npos, "the JSON misses the counters");
+
+		std::istringstream jsonIn(json.str());
+		BenchmarkResults read;
+		checker.Check(Benchmark::ReadJson(jsonIn, read) && read.Cpu.Count == 3, "the JSON with counters does not read back");
+	}
+
+	return checker.Result();
+}
+
+// Runs small startup graphs: on one thread against a fake clock to check the order, the times,
+// the critical path and the report, and on workers to check that independent steps overlap,
+// that main thread steps stay on the calling thread and that a failing step stops the graph.
+// Also checks that Parallel::For hands an exception of a worker on to the caller.
+// Usage: YARendererChecks init-graph
+int CheckInitGraph()
+{
+	Checker checker("InitGraph");
+
+	const auto mainThread = InitGraph::Affinity::MainThread;
+	auto nothing = []() {};
+
+	{
+		InitGraph unknown;
+		unknown.Add("Renderer", {"DxContext"}, nothing);
+		checker.Check(unknown.Validate() == "step 'Renderer' depends on 'DxContext', which is no step", "an unknown dependency: " + unknown.Validate());
+		checker.Check(!unknown.Run(0), "a graph with an unknown dependency runs");
+
+		InitGraph twice;
+		twice.Add("Scene", {}, nothing);
+		twice.Add("Scene", {}, nothing);
+		checker.Check(!twice.Validate().empty(), "a step is added twice");
+
+		InitGraph cycle;
+		cycle.Add("A", {"B"}, nothing);
+		cycle.Add("B", {"A"}, nothing);
+		cycle.Add("C", {}, nothing);
+		cycle.Add("D", {"C", "B"}, nothing);
+		checker.Check(cycle.Validate() == "the steps 'A', 'B', 'D' depend on each other", "a cycle: " + cycle.Validate());
+	}
+
+	// without workers every step runs on the calling thread, as soon as it is ready
+	{
+		FakeClock clock;
+		InitGraph graph(clock);
+		std::vector<std::string> order;
+		auto step = [&](const char *name, int64_t ms)
+		{
+			return [&order, &clock, name, ms]()
+			{
+				order.push_back(name);
+				clock.Advance(ms * 1'000'000);
+			};
+		};
+
+		graph.Add("Upload", {"Renderer", "Scene"}, step("Upload", 5), mainThread);
+		graph.Add("Device", {}, step("Device", 10), mainThread);
+		graph.Add("Scene", {}, step("Scene", 20));
+		graph.Add("Shaders", {"Device"}, step("Shaders", 30));
+		graph.Add("Renderer", {"Device", "Shaders"}, step("Renderer", 5), mainThread);
+
+		checker.Check(graph.Run(0), "a valid graph does not run");
+		checker.Check(order == std::vector<std::string>{"Device", "Scene", "Shaders", "Renderer", "Upload"}, "the steps ran out of order");
+
+		const auto &steps = graph.Steps();
+		checker.Check(steps[0].Start == 65'000'000 && steps[0].End == 70'000'000 && steps[3].Start == 30'000'000, "wrong step times");
+		checker.Check(std::all_of(steps.begin(), steps.end(), [](const InitGraph::Step &s) { return s.Thread == 0; }), "a step ran on a worker");
+		checker.Check(graph.Total() == 70'000'000, "a total of " + std::to_string(graph.Total()));
+
+		int64_t critical = 0;
+		std::vector<size_t> path = graph.CriticalPath(&critical);
+		checker.Check(path == std::vector<size_t>{1, 3, 4, 0} && critical == 50'000'000, "the critical path is not Device > Shaders > Renderer > Upload");
+
+		std::ostringstream report;
+		graph.WriteReport(report);
+		checker.Check(report.str().find("Startup: 5 steps in 70.0 ms, critical path 50.0 ms, 70.0 ms of work") != std::string::npos, "wrong totals in the report");
+		checker.Check(report.str().find("critical path (*): Device > Shaders > Renderer > Upload") != std::string::npos, "the report misses the critical path");
+		checker.Check(report.str().find("Scene") < report.str().find("Shaders"), "the report is not in the order the steps started");
+	}
+
+	// two workers: each of the first steps waits until the other one has started
+	{
+		InitGraph graph;
+		std::atomic<int> started = 0;
+		std::atomic<int> met = 0;
+		auto rendezvous = [&]()
+		{
+			started++;
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+			while (started < 2 && std::chrono::steady_clock::now() < deadline)
+				std::this_thread::yield();
+			met += started == 2 ? 1 : 0;
+		};
+
+		std::thread::id caller = std::this_thread::get_id();
+		std::atomic<bool> mainOnCaller = false, workersElsewhere = true;
+		auto worker = [&]()
+		{
+			rendezvous();
+			if (std::this_thread::get_id() == caller)
+				workersElsewhere = false;
+		};
+
+		graph.Add("Decode", {}, worker);
+		graph.Add("Compile", {}, worker);
+		graph.Add("Upload", {"Decode", "Compile"}, [&]() { mainOnCaller = std::this_thread::get_id() == caller; }, mainThread);
+
+		checker.Check(graph.Run(2), "the graph does not run on workers");
+		checker.Check(met == 2, "independent steps do not run at the same time");
+		checker.Check(mainOnCaller && workersElsewhere, "the steps ran on the wrong threads");
+		checker.Check(graph.Steps()[2].Start >= std::max(graph.Steps()[0].End, graph.Steps()[1].End), "a step started before its dependencies ended");
+	}
+
+	// a failing step lets the running ones finish and skips its dependents
+	{
+		InitGraph graph;
+		std::atomic<bool> independentStarted = false, independentRan = false, dependentRan = false;
+		graph.Add("Throws", {}, [&]()
+		{
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+			while (!independentStarted && std::chrono::steady_clock::now() < deadline)
+				std::this_thread::yield();
+			throw std::runtime_error("no device");
+		});
+		graph.Add("Independent", {}, [&]()
+		{
+			independentStarted = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			independentRan = true;
+		}, mainThread);
+		graph.Add("Dependent", {"Throws"}, [&]() { dependentRan = true; }, mainThread);
+
+		std::string message;
+		try
+		{
+			graph.Run(1);
+		}
+		catch (const std::runtime_error &e)
+		{
+			message = e.what();
+		}
+		checker.Check(message == "no device", "the exception of a step is not passed on");
+		checker.Check(independentRan, "a running step was cut off");
+		checker.Check(!dependentRan, "a step ran after its dependency failed");
+	}
+
+	// Parallel::For, which the shader compile step runs on, passes the first exception on once all threads are joined
+	{
+		std::atomic<UINT> calls = 0;
+		std::string message;
+		try
+		{
+			Parallel::For(64, [&](UINT i)
+			{
+				calls++;
+				if (i % 16 == 3)
+					throw std::runtime_error("no shader " + std::to_string(i));
+			});
+		}
+		catch (const std::runtime_error &e)
+		{
+			message = e.what();
+		}
+		checker.Check(message.rfind("no shader ", 0) == 0, "the exception of Parallel::For is not passed on");
+		checker.Check(calls <= 64, "Parallel::For called func " + std::to_string(calls) + " times");
+	}
+
+	return checker.Result();
+}
+
+// Allocates and frees ranges of a small address space and checks aligned offsets and the padding
+// in front of them, that a freed range merges with its neighbours on both sides, that a request
+// that does not fit fails without changing anything and that the holes of a fragmented space are
+// reused.
+// Usage: YARendererChecks range-allocator
+int CheckRangeAllocator()
+{
+	Checker checker("RangeAllocator");
+
+	const UINT64 invalid = RangeAllocator::InvalidOffset;
+
+	{
+		RangeAllocator allocator(1000);
+		checker.Check(allocator.Allocate(3) == 0, "the first range does not start at 0");
+		checker.Check(allocator.Allocate(8, 16) == 16, "an aligned range is not aligned");
+		checker.Check(allocator.Allocate(13) == 3, "the padding in front of an aligned range is not free");
+		checker.Check(allocator.Allocate(4, 4) == 24, "an aligned offset that needs no padding moved");
+		checker.Check(allocator.Allocate(1, 256) == 256, "a large alignment is not kept");
+		checker.Check(allocator.UsedSize() == 29 && allocator.NumFreeRanges() == 2, "the padding counts as used");
+	}
+
+	{
+		RangeAllocator allocator(100);
+		UINT64 a = allocator.Allocate(10);
+		UINT64 b = allocator.Allocate(10);
+		UINT64 c = allocator.Allocate(10);
+		checker.Check(allocator.Allocate(70) == 30 && allocator.LargestFreeRange() == 0, "the ranges do not fill the space");
+
+		allocator.Free(a, 10);
+		allocator.Free(c, 10);
+		checker.Check(allocator.NumFreeRanges() == 2, "ranges that are not neighbours merged");
+		allocator.Free(b, 10);
+		checker.Check(allocator.NumFreeRanges() == 1 && allocator.LargestFreeRange() == 30, "a freed range does not merge on both sides");
+		checker.Check(allocator.Allocate(30) == 0, "the merged range is not handed out");
+	}
+
+	{
+		RangeAllocator allocator(64);
+		checker.Check(allocator.Allocate(0) == invalid && allocator.Allocate(65) == invalid, "an empty or oversized range was handed out");
+		checker.Check(allocator.Allocate(1) == 0, "the first range does not start at 0");
+		checker.Check(allocator.Allocate(32, 64) == invalid, "an aligned range past the end was handed out");
+		checker.Check(allocator.Allocate(63) == 1 && allocator.Allocate(1) == invalid, "a full allocator handed out a range");
+		checker.Check(allocator.UsedSize() == 64 && allocator.NumFreeRanges() == 0, "a failed request changed the allocator");
+
+		allocator.Free(invalid, 8);
+		checker.Check(allocator.UsedSize() == 64, "freeing the invalid offset changed the allocator");
+	}
+
+	{
+		RangeAllocator allocator(100);
+		for (UINT64 i = 0; i < 10; i++)
+			allocator.Allocate(10);
+		for (UINT64 i = 0; i < 10; i += 2)
+			allocator.Free(i * 10, 10);
+
+		checker.Check(allocator.NumFreeRanges() == 5 && allocator.LargestFreeRange() == 10, "the space is not fragmented");
+		checker.Check(allocator.Allocate(20) == invalid, "a range larger than every hole was handed out");
+		checker.Check(allocator.Allocate(10) == 0 && allocator.Allocate(5) == 20 && allocator.Allocate(5) == 25, "the holes are not reused first to last");
+
+		allocator.Free(0, 10);
+		allocator.Free(20, 10);
+		for (UINT64 i = 1; i < 10; i += 2)
+			allocator.Free(i * 10, 10);
+		checker.Check(allocator.UsedSize() == 0 && allocator.NumFreeRanges() == 1 && allocator.LargestFreeRange() == 100, "freeing everything does not give one range back");
+	}
+
+	return checker.Result();
+}
+
+#ifdef ENABLE_PROFILER
+// Records nested scopes on the main thread and on short lived worker threads and checks the
+// hierarchy of the gathered frames, that exited threads hand their buffers on, that a full buffer
+// drops its oldest events and that every scope ends up in the Chrome trace.
+// Usage: YARendererChecks profiler
+int CheckProfiler()
+{
+	Checker checker("Profiler");
+
+	PROFILE_THREAD("Main");
+	uint32_t mainThread = Profiler::ThreadBuffer()->Id();
+	checker.Check(Profiler::ThreadName(mainThread) == "Main", "main thread is not named");
+
+	std::vector<ProfileFrame> frames;
+	PROFILE_FRAME();
+
+	// the hierarchy of a single thread
+	{
+		PROFILE_SCOPE("Outer");
+		{
+			PROFILE_SCOPE("Inner");
+			PROFILE_SCOPE("Innermost");
+		}
+		PROFILE_SCOPE("Sibling \"quoted\" \\");
+	}
+	PROFILE_FRAME();
+	frames.push_back(Profiler::LastFrame());
+
+	const auto &events = frames.back().Events;
+	checker.Check(events.size() == 4, "wrong number of nested scopes");
+	if (events.size() == 4)
+	{
+		checker.Check(std::string(events[0].Name) == "Outer" && events[0].Depth == 0, "outer scope");
+		checker.Check(std::string(events[1].Name) == "Inner" && events[1].Depth == 1, "inner scope");
+		checker.Check(std::string(events[2].Name) == "Innermost" && events[2].Depth == 2, "innermost scope");
+		checker.Check(events[3].Depth == 1, "sibling scope");
+
+		for (int i = 1; i < 4; i++)
+		{
+			const ProfileEvent &parent = events[i == 2 ? 1 : 0];
+			checker.Check(parent.Start <= events[i].Start && events[i].End <= parent.End, "nested scope outside its parent");
+		}
+	}
+
+	// threads come and go like the ones of Parallel::For
+	const int numThreads = 4;
+	const int numScopes = 100;
+	for (int round = 0; round < 3; round++)
+	{
+		// all of them are alive at once, a thread that starts after another one exited takes over its buffer
+		std::atomic<int> started = 0;
+		std::vector<std::thread> threads;
+		for (int i = 0; i < numThreads; i++)
+		{
+			threads.emplace_back([&started]()
+								 {
+									 PROFILE_THREAD("Worker");
+									 started++;
+									 while (started < numThreads)
+										 std::this_thread::yield();
+
+									 for (int j = 0; j < numScopes; j++)
+									 {
+										 PROFILE_SCOPE("Work");
+										 PROFILE_SCOPE("Nested Work");
+									 } });
+		}
+		for (auto &thread : threads)
+			thread.join();
+
+		PROFILE_FRAME();
+		frames.push_back(Profiler::LastFrame());
+
+		std::map<uint32_t, int> perThread;
+		for (const auto &event : frames.back().Events)
+			perThread[event.Thread]++;
+
+		checker.Check(perThread.size() == numThreads && perThread.count(mainThread) == 0, "scopes of the worker threads are missing");
+		for (const auto &[thread, count] : perThread)
+			checker.Check(count == 2 * numScopes, "a worker thread lost scopes");
+	}
+	checker.Check(Profiler::NumBuffers() == 1 + numThreads, "buffers of exited threads are not reused");
+
+	// a buffer that is not gathered in time keeps the newest events
+	uint64_t dropped = Profiler::DroppedEvents();
+	for (uint32_t i = 0; i < ProfileBuffer::Capacity + 100; i++)
+	{
+		PROFILE_SCOPE("Overflow");
+	}
+	PROFILE_FRAME();
+	checker.Check(Profiler::LastFrame().Events.size() == ProfileBuffer::Capacity, "full buffer kept the wrong number of events");
+	checker.Check(Profiler::DroppedEvents() - dropped == 100, "dropped events are not counted");
+
+	std::ostringstream trace;
+	Profiler::WriteChromeTrace(trace, frames);
+	std::string json = trace.str();
+
+	size_t numEvents = 0;
+	for (const auto &frame : frames)
+		numEvents += frame.Events.size();
+
+	size_t numComplete = 0;
+	for (size_t pos = json.find("\"ph\":\"X\""); pos != std::string::npos; pos = json.find("\"ph\":\"X\"", pos + 1))
+		numComplete++;
+
+	checker.Check(numComplete == numEvents, "trace is missing scopes");
+	checker.Check(json.find("\"Sibling \\\"quoted\\\" \\\\\"") != std::string::npos, "scope names are not escaped");
+	checker.Check(json.find("{\"name\":\"Main\"}") != std::string::npos, "trace is missing the thread names");
+	checker.Check(json.rfind("]}\n") == json.size() - 3, "trace is not terminated");
+
+	return checker.Result();
+}
+#endif
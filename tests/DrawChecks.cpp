@@ -0,0 +1,175 @@
+#include "pch.h"
+#include "Checks.h"
+#include "rendering/IndirectDraw.h"
+
+// Stands in for the command list of the direct path and keeps every draw with the state it was
+// issued with
+struct DrawRecorder
+{
+	D3D12_GPU_VIRTUAL_ADDRESS ObjectCB = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS MatCB = 0;
+	D3D12_PRIMITIVE_TOPOLOGY Topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+	struct Draw
+	{
+		IndirectDrawCommand Command;
+		D3D12_PRIMITIVE_TOPOLOGY Topology;
+	};
+	std::vector<Draw> Draws;
+
+	void SetGraphicsRootConstantBufferView(UINT parameter, D3D12_GPU_VIRTUAL_ADDRESS address)
+	{
+		(parameter == (UINT)RootParam::ObjectCB ? ObjectCB : MatCB) = address;
+	}
+
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) { Topology = topology; }
+
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+	{
+		Draw draw;
+		draw.Command.ObjectCB = ObjectCB;
+		draw.Command.MatCB = MatCB;
+		draw.Command.DrawArguments = {indexCount, instanceCount, startIndex, baseVertex, startInstance};
+		draw.Topology = Topology;
+		Draws.push_back(draw);
+	}
+};
+
+// Builds indirect draw lists of made up render items and checks them against the calls of the
+// direct path: the same draw arguments and constant buffer addresses in the same order, under the
+// same topology, with a new batch exactly where the topology changes between draws.
+// Usage: YARendererChecks indirect-draw
+int CheckIndirectDraw()
+{
+	Checker checker("IndirectDraw");
+
+	const auto triangles = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	const auto lines = D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+
+	// a submesh per entry of transparent, each with a material of its own
+	UINT nextObject = 0, nextMaterial = 0;
+	auto item = [&](D3D12_PRIMITIVE_TOPOLOGY topology, std::vector<bool> transparent)
+	{
+		auto ritem = make_ref<RenderItem>();
+		ritem->PrimitiveType = topology;
+		ritem->objCBIndex = nextObject++;
+		ritem->matCBIndex = nextMaterial;
+		ritem->Mesh = make_ref<Mesh>();
+
+		GeometryRange geometry;
+		geometry.BaseVertex = 1000 * ritem->objCBIndex;
+		geometry.StartIndex = 3000 * ritem->objCBIndex;
+		ritem->Mesh->SetGeometry(geometry);
+
+		for (UINT i = 0; i < transparent.size(); i++)
+		{
+			Mesh::SubMesh submesh;
+			submesh.MaterialIndex = i;
+			submesh.IndexCount = 3 * (i + 1) * (ritem->objCBIndex + 1);
+			submesh.StartIndexLocation = 30 * i;
+			submesh.BaseVertexLocation = 10 * i;
+			submesh.Transparent = transparent[i];
+			ritem->Mesh->SubMeshes().push_back(submesh);
+		}
+		nextMaterial += (UINT)transparent.size();
+		return ritem;
+	};
+
+	// the transparent only item in the middle has no opaque draw and must not split the triangles
+	std::vector<Ref<RenderItem>> items = {
+		item(triangles, {false, false}),
+		item(triangles, {false, true}),
+		item(lines, {true}),
+		item(triangles, {false}),
+		item(lines, {false, false}),
+		item(triangles, {true, false}),
+		item(triangles, {}),
+	};
+
+	const D3D12_GPU_VIRTUAL_ADDRESS objectCB = 0x10000, matCB = 0x80000;
+	const UINT objCBByteSize = 256, matCBByteSize = 512;
+
+	auto compare = [&](const char *name, const IndirectDrawList &list, const DrawRecorder &direct)
+	{
+		const auto &commands = list.Commands();
+		checker.Check(commands.size() == direct.Draws.size(), std::string(name) + ": " + std::to_string(commands.size()) + " commands for " + std::to_string(direct.Draws.size()) + " direct draws");
+
+		UINT numCommands = 0;
+		for (const auto &batch : list.Batches())
+		{
+			checker.Check(batch.FirstCommand == numCommands && batch.CommandCount > 0, std::string(name) + ": the batches do not cover the commands one after the other");
+			for (UINT i = batch.FirstCommand; i < batch.FirstCommand + batch.CommandCount && i < direct.Draws.size() && i < commands.size(); i++)
+			{
+				const auto &expected = direct.Draws[i];
+				const auto &args = commands[i].DrawArguments;
+				const auto &directArgs = expected.Command.DrawArguments;
+
+				checker.Check(batch.PrimitiveType == expected.Topology, std::string(name) + ": command " + std::to_string(i) + " is drawn with another topology");
+				checker.Check(commands[i].ObjectCB == expected.Command.ObjectCB, std::string(name) + ": command " + std::to_string(i) + " has another object constant buffer");
+				checker.Check(commands[i].MatCB == expected.Command.MatCB, std::string(name) + ": command " + std::to_string(i) + " has another material constant buffer");
+				checker.Check(args.IndexCountPerInstance == directArgs.IndexCountPerInstance && args.InstanceCount == directArgs.InstanceCount &&
+								  args.StartIndexLocation == directArgs.StartIndexLocation && args.BaseVertexLocation == directArgs.BaseVertexLocation &&
+								  args.StartInstanceLocation == directArgs.StartInstanceLocation,
+							  std::string(name) + ": command " + std::to_string(i) + " has other draw arguments");
+			}
+			numCommands += batch.CommandCount;
+		}
+		checker.Check(numCommands == commands.size(), std::string(name) + ": commands outside of every batch");
+
+		// a batch ends where the topology changes and nowhere else
+		for (size_t i = 1; i < list.Batches().size(); i++)
+			checker.Check(list.Batches()[i].PrimitiveType != list.Batches()[i - 1].PrimitiveType, std::string(name) + ": two batches in a row share a topology");
+	};
+
+	{
+		IndirectDrawList list;
+		list.Build(items, false, objectCB, objCBByteSize, matCB, matCBByteSize);
+		DrawRecorder direct;
+		DirectDraw::Draw(direct, items, false, objectCB, objCBByteSize, matCB, matCBByteSize);
+		compare("opaque", list, direct);
+
+		// triangles of items 0, 1 and 3, lines of item 4, triangles of item 5
+		std::vector<UINT> counts;
+		for (const auto &batch : list.Batches())
+			counts.push_back(batch.CommandCount);
+		checker.Check(counts == std::vector<UINT>{4, 2, 1}, "the opaque draws are not batched as 4 triangles, 2 lines, 1 triangles");
+
+		// item 3, submesh 0: object 3, material 5, its geometry at 3000 vertices and 9000 indices
+		if (list.Commands().size() > 3)
+		{
+			const auto &command = list.Commands()[3];
+			checker.Check(command.ObjectCB == objectCB + 3 * objCBByteSize && command.MatCB == matCB + 5 * matCBByteSize, "wrong constant buffers for item 3");
+			checker.Check(command.DrawArguments.StartIndexLocation == 9000 && command.DrawArguments.BaseVertexLocation == 3000 &&
+							  command.DrawArguments.IndexCountPerInstance == 12,
+						  "wrong draw arguments for item 3");
+		}
+	}
+
+	{
+		IndirectDrawList list;
+		list.Build(items, true, objectCB, objCBByteSize, matCB, matCBByteSize);
+		DrawRecorder direct;
+		DirectDraw::Draw(direct, items, true, objectCB, objCBByteSize, matCB, matCBByteSize);
+		compare("transparent", list, direct);
+		checker.Check(list.Batches().size() == 3, "the transparent draws are not batched as triangles, lines, triangles");
+	}
+
+	{
+		// shadow casters in culling order, across items and topologies
+		std::vector<SubMeshRef> casters = {{4, 1}, {0, 1}, {0, 0}, {3, 0}, {4, 0}, {2, 0}};
+		IndirectDrawList list;
+		list.Build(items, casters, objectCB, objCBByteSize, matCB, matCBByteSize);
+		DrawRecorder direct;
+		DirectDraw::Draw(direct, items, casters, objectCB, objCBByteSize, matCB, matCBByteSize);
+		compare("casters", list, direct);
+		checker.Check(list.Batches().size() == 3, "the casters are not batched as lines, triangles, lines");
+	}
+
+	{
+		IndirectDrawList list;
+		list.Build({items[2], items[6]}, false, objectCB, objCBByteSize, matCB, matCBByteSize);
+		checker.Check(list.Commands().empty() && list.Batches().empty(), "items without opaque submeshes left commands or batches");
+	}
+
+	return checker.Result();
+}
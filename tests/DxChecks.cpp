@@ -0,0 +1,373 @@
+#include "pch.h"
+#include "Checks.h"
+#include "core/Clock.h"
+#include "dx/GpuMemoryTracker.h"
+#include "dx/FrameCapture.h"
+#include "dx/StagingRing.h"
+#include "rendering/GpuTimestamps.h"
+
+// Feeds resource descriptions to the GPU memory tracker and checks the estimated sizes and the
+// totals and peaks per category, without a device.
+// Usage: YARendererChecks gpu-memory
+int CheckGpuMemory()
+{
+	Checker checker("GpuMemory");
+
+	const UINT64 KB = 1024;
+	const UINT64 MB = 1024 * KB;
+
+	checker.Check(GpuMemoryTracker::EstimateSize(CD3DX12_RESOURCE_DESC::Buffer(1)) == 64 * KB, "buffers are not rounded up to 64KB");
+	checker.Check(GpuMemoryTracker::EstimateSize(CD3DX12_RESOURCE_DESC::Buffer(64 * KB)) == 64 * KB, "aligned buffer grows");
+	checker.Check(GpuMemoryTracker::EstimateSize(CD3DX12_RESOURCE_DESC::Buffer(64 * KB + 1)) == 128 * KB, "buffer is not rounded up");
+
+	// 1920 * 1080 * 4 bytes fill 126.6 pages of 64KB
+	auto gbuffer = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 1920, 1080, 1, 1);
+	checker.Check(GpuMemoryTracker::EstimateSize(gbuffer) == 127 * 64 * KB, "wrong size of a render target");
+
+	// 1398101 pixels in the full chain of 1024^2
+	auto mipmapped = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, 1024, 1024, 1, 0);
+	checker.Check(GpuMemoryTracker::EstimateSize(mipmapped) == 86 * 64 * KB, "wrong size of a full mip chain");
+
+	auto cubemap = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT, 1024, 1024, 6, 1);
+	checker.Check(GpuMemoryTracker::EstimateSize(cubemap) == 96 * MB, "array slices are not counted");
+
+	// 2396745 voxels of 8 bytes in 8 levels of 128^3
+	auto volume = CD3DX12_RESOURCE_DESC::Tex3D(DXGI_FORMAT_R16G16B16A16_FLOAT, 128, 128, 128, 8);
+	checker.Check(GpuMemoryTracker::EstimateSize(volume) == 293 * 64 * KB, "wrong size of a 3D texture");
+
+	auto bc1 = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_BC1_UNORM, 256, 256, 1, 1);
+	checker.Check(GpuMemoryTracker::EstimateSize(bc1) == 64 * KB, "wrong size of a BC1 texture");
+	bc1.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+	checker.Check(GpuMemoryTracker::EstimateSize(bc1) == 32 * KB, "small alignment is not used");
+
+	auto bc7 = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_BC7_UNORM, 2, 2, 1, 1);
+	bc7.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+	checker.Check(GpuMemoryTracker::EstimateSize(bc7) == 4 * KB, "a partial block is not a whole block");
+
+	auto msaa = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 1920, 1080, 1, 1, 4);
+	checker.Check(GpuMemoryTracker::EstimateSize(msaa) == 32 * MB, "multisampled textures are not rounded up to 4MB");
+
+	GpuMemoryTracker tracker;
+	UINT64 albedo = tracker.Add(GpuMemoryCategory::GBuffer, GpuMemoryTracker::EstimateSize(gbuffer), &gbuffer);
+	UINT64 shadow = tracker.Add(GpuMemoryCategory::Shadow, 64 * MB);
+	UINT64 normal = tracker.Add(GpuMemoryCategory::GBuffer, 16 * MB);
+
+	checker.Check(tracker.Count(GpuMemoryCategory::GBuffer) == 2 && tracker.Bytes(GpuMemoryCategory::GBuffer) == 127 * 64 * KB + 16 * MB, "category totals are wrong");
+	checker.Check(tracker.TotalBytes() == tracker.Bytes(GpuMemoryCategory::GBuffer) + 64 * MB, "total is wrong");
+
+	UINT64 peak = tracker.TotalBytes();
+	tracker.Remove(albedo);
+	tracker.Remove(albedo);
+	tracker.Remove(GpuMemoryTracker::INVALID_ID);
+	checker.Check(tracker.Count(GpuMemoryCategory::GBuffer) == 1 && tracker.Bytes(GpuMemoryCategory::GBuffer) == 16 * MB, "removing does not update the category");
+	checker.Check(tracker.PeakBytes(GpuMemoryCategory::GBuffer) == 127 * 64 * KB + 16 * MB && tracker.PeakTotalBytes() == peak, "peaks do not stay");
+
+	// a resize that frees before it allocates does not raise the peak
+	tracker.Remove(normal);
+	normal = tracker.Add(GpuMemoryCategory::GBuffer, 16 * MB);
+	checker.Check(tracker.PeakTotalBytes() == peak, "peak grows when a resource is recreated");
+
+	tracker.ResetPeaks();
+	checker.Check(tracker.PeakTotalBytes() == 80 * MB && tracker.PeakBytes(GpuMemoryCategory::GBuffer) == 16 * MB, "peaks are not reset");
+
+	tracker.Remove(shadow);
+	checker.Check(tracker.Bytes(GpuMemoryCategory::Shadow) == 0 && tracker.PeakBytes(GpuMemoryCategory::Shadow) == 64 * MB, "emptied category is wrong");
+
+	tracker.Add(GpuMemoryCategory::Voxel, 32 * MB, &volume);
+	std::ostringstream json;
+	tracker.WriteJson(json);
+	std::string text = json.str();
+	size_t voxel = text.find("{\"category\": \"Voxel\", \"bytes\": 33554432, \"dimension\": \"texture3d\"");
+	size_t gbufferEntry = text.find("{\"category\": \"GBuffer\", \"bytes\": 16777216, \"dimension\": \"heap\"}");
+	checker.Check(text.find("\"total\": {\"bytes\": 50331648, \"peak\": 83886080}") != std::string::npos, "JSON total is wrong");
+	checker.Check(text.find("{\"name\": \"Shadow\", \"count\": 0, \"bytes\": 0, \"peak\": 67108864}") != std::string::npos, "JSON categories are wrong");
+	checker.Check(voxel != std::string::npos && gbufferEntry != std::string::npos && voxel < gbufferEntry, "JSON allocations are not sorted by size");
+
+	return checker.Result();
+}
+
+// Records a synthetic frame the way CaptureCommandList would, writes and reads it back, and checks
+// the statistics of its passes, then that truncated or foreign files are rejected.
+// Usage: YARendererChecks frame-capture
+int CheckFrameCapture()
+{
+	Checker checker("FrameCapture");
+
+	FrameCapture recorded;
+	auto record = [&](CaptureOp op, std::initializer_list<uint32_t> args = {}, uint64_t object = 0, const void *data = nullptr, uint32_t dataSize = 0)
+	{
+		CaptureCommand command;
+		command.Op = op;
+		std::copy(args.begin(), args.end(), command.Args);
+		command.Objects[0] = object;
+		recorded.Add(command, data, dataSize);
+	};
+	auto beginPass = [&](const char *name)
+	{ record(CaptureOp::BeginPass, {}, 0, name, (uint32_t)strlen(name)); };
+
+	const uint64_t pso = 0x100, otherPso = 0x200, rootSignature = 0x300, passCB = 0x10000, objectCB = 0x10100;
+	std::vector<uint8_t> constants(256, 7);
+	recorded.AddBuffer(passCB, constants.data(), 256);
+	recorded.AddBuffer(objectCB, constants.data(), 256);
+	recorded.AddBuffer(objectCB, constants.data(), 16);
+	checker.Check(recorded.Buffers().size() == 2 && recorded.Buffers()[1].Bytes.size() == 256, "a buffer is captured twice");
+
+	// outside of any pass: 2 barriers in one call
+	record(CaptureOp::ResetState);
+	record(CaptureOp::Barrier, {2, 2, 0});
+
+	beginPass("GBuffer");
+	record(CaptureOp::SetRootSignature, {0}, rootSignature);
+	record(CaptureOp::SetRootSignature, {0}, rootSignature); // redundant
+	record(CaptureOp::SetRootView, {0, 0, (uint32_t)CaptureView::CBV}, passCB);
+	record(CaptureOp::SetPipelineState, {}, pso);
+	for (int i = 0; i < 3; i++)
+	{
+		// the same object constants every time, bound again after the first
+		record(CaptureOp::SetPipelineState, {}, pso);
+		record(CaptureOp::SetRootView, {0, 1, (uint32_t)CaptureView::CBV}, objectCB);
+		record(CaptureOp::DrawIndexed, {36, 2});
+	}
+
+	beginPass("Sky");
+	uint32_t index = 5;
+	record(CaptureOp::SetPipelineState, {}, otherPso);
+	record(CaptureOp::SetRootConstants, {0, 2, 0}, 0, &index, sizeof(index));
+	record(CaptureOp::SetRootConstants, {0, 2, 0}, 0, &index, sizeof(index)); // redundant
+	record(CaptureOp::Draw, {3, 1});
+	record(CaptureOp::EndPass);
+	record(CaptureOp::EndPass);
+
+	beginPass("Voxels");
+	record(CaptureOp::SetRootSignature, {1}, rootSignature);
+	record(CaptureOp::SetRootConstants, {1, 2, 0}, 0, &index, sizeof(index)); // compute is bound apart
+	record(CaptureOp::Dispatch, {4, 4, 2});
+	record(CaptureOp::Barrier, {1, 0, 1});
+	record(CaptureOp::ExecuteIndirect, {10});
+	record(CaptureOp::EndPass);
+	record(CaptureOp::EndPass); // unmatched
+
+	std::stringstream stream;
+	recorded.Write(stream);
+	std::string bytes = stream.str();
+
+	FrameCapture capture;
+	std::string error;
+	checker.Check(FrameCapture::Read(stream, capture, error), "the capture does not read back: " + error);
+	checker.Check(capture.Commands().size() == recorded.Commands().size() && capture.Data() == recorded.Data() &&
+					  capture.Buffers().size() == 2 && capture.Buffers()[0].Bytes == constants,
+				  "the capture reads back differently");
+
+	std::vector<CapturePassStats> passes = capture.Analyze();
+	checker.Check(passes.size() == 4, std::to_string(passes.size()) + " passes instead of the frame and 3");
+	if (passes.size() == 4)
+	{
+		const CapturePassStats &frame = passes[0], &gbuffer = passes[1], &sky = passes[2], &voxels = passes[3];
+		checker.Check(gbuffer.Name == "GBuffer" && sky.Name == "GBuffer/Sky" && sky.Depth == 2 && voxels.Name == "Voxels", "the passes are not nested as recorded");
+
+		checker.Check(frame.Draws == 14 && gbuffer.Draws == 4 && sky.Draws == 1 && voxels.Draws == 10, "wrong draw counts");
+		checker.Check(gbuffer.Primitives == 3 * 24 + 1, "wrong primitive count of " + std::to_string(gbuffer.Primitives));
+		checker.Check(voxels.Dispatches == 1 && voxels.ThreadGroups == 32, "wrong dispatches");
+		checker.Check(frame.Barriers == 3 && frame.BarrierCalls == 2 && gbuffer.Barriers == 0 && voxels.Barriers == 1, "wrong barrier counts");
+
+		// root signature twice, pass CB, PSO 4 times, object CB 3 times; then the sky's PSO and constants twice
+		checker.Check(gbuffer.StateSets == 13 && gbuffer.RedundantStateSets == 7, "GBuffer sets " + std::to_string(gbuffer.StateSets) + " states, " + std::to_string(gbuffer.RedundantStateSets) + " of them redundant");
+		checker.Check(sky.StateSets == 3 && sky.RedundantStateSets == 1, "the sky sets its constants only once");
+		checker.Check(voxels.StateSets == 2 && voxels.RedundantStateSets == 0, "compute bindings are mixed with graphics bindings");
+
+		checker.Check(gbuffer.BytesBound == 4 * 256 + 2 * 4 && sky.BytesBound == 8 && frame.BytesBound == gbuffer.BytesBound + 4, "wrong bytes bound");
+	}
+
+	std::ostringstream report;
+	FrameCapture::WriteReport(report, passes);
+	checker.Check(report.str().find("\n    Sky ") != std::string::npos, "the report does not indent nested passes");
+
+	std::string truncated = bytes.substr(0, bytes.size() - 100);
+	std::stringstream truncatedStream(truncated);
+	checker.Check(!FrameCapture::Read(truncatedStream, capture, error), "a truncated capture is read");
+
+	std::string foreign = bytes;
+	foreign[0] = 'X';
+	std::stringstream foreignStream(foreign);
+	checker.Check(!FrameCapture::Read(foreignStream, capture, error) && error == "not a frame capture", "a foreign file is read");
+
+	// the op of the first command follows the 20 bytes of the header
+	std::string badOp = bytes;
+	badOp[20] = (char)CaptureOp::Count;
+	std::stringstream badOpStream(badOp);
+	checker.Check(!FrameCapture::Read(badOpStream, capture, error), "an unknown command is read");
+
+	return checker.Result();
+}
+
+// Drives the staging ring with made up fence values: that a full ring refuses, that completing a
+// fence gives back exactly the submissions up to it, in the order they were submitted, that an
+// allocation past the end wraps around to the reclaimed space and that alignment padding is used.
+// Usage: YARendererChecks staging-ring
+int CheckStagingRing()
+{
+	Checker checker("StagingRing");
+
+	const UINT64 invalid = StagingRing::InvalidOffset;
+	StagingRing ring(100);
+
+	checker.Check(ring.Allocate(0, 1) == invalid && ring.Allocate(101, 1) == invalid, "an empty or oversized allocation succeeded");
+
+	checker.Check(ring.Allocate(5, 1) == 0 && ring.Allocate(10, 16) == 16, "an aligned allocation is not aligned");
+	checker.Check(ring.UsedBytes() == 26 && ring.PendingBytes() == 26, "the alignment padding is not counted");
+	ring.Submit(1);
+	checker.Check(ring.PendingBytes() == 0, "Submit leaves bytes pending");
+
+	checker.Check(ring.Allocate(30, 1) == 26, "the ring does not continue after the last submission");
+	ring.Submit(2);
+	checker.Check(ring.Allocate(34, 1) == 56, "an allocation up to the end fails");
+	ring.Submit(3);
+	ring.Submit(4); // nothing pending, no submission
+
+	// full: [0, 90) is in flight and the 10 bytes at the end are too few
+	checker.Check(ring.Allocate(20, 1) == invalid && ring.UsedBytes() == 90, "a full ring handed out memory");
+
+	// a fence that covers none of the submissions gives nothing back
+	ring.Reclaim(0);
+	checker.Check(ring.UsedBytes() == 90 && ring.Allocate(20, 1) == invalid, "nothing completed but memory was reclaimed");
+
+	// partial: only the first submission is done, 26 bytes are free at the start
+	ring.Reclaim(1);
+	checker.Check(ring.UsedBytes() == 64, "reclaiming fence 1 did not give back its 26 bytes");
+	checker.Check(ring.Allocate(27, 1) == invalid, "an allocation larger than the reclaimed space wrapped around");
+
+	// wraps around, the 10 bytes at the end become padding
+	checker.Check(ring.Allocate(20, 1) == 0, "the allocation does not wrap around to the start");
+	checker.Check(ring.UsedBytes() == 94, "the wrap-around padding is not counted");
+	ring.Submit(5);
+
+	// up to the tail at 26, then full until fence 2 is done
+	checker.Check(ring.Allocate(6, 1) == 20 && ring.Allocate(1, 1) == invalid, "the ring handed out memory past its tail");
+	ring.Submit(6);
+
+	// reclaim is in fence order: fence 3 completes 2 and 3, not the later wrapped ones
+	ring.Reclaim(3);
+	checker.Check(ring.UsedBytes() == 36, "reclaiming fence 3 did not give back fences 2 and 3");
+	checker.Check(ring.Allocate(50, 1) == 26, "the space of fences 2 and 3 is not reused");
+	ring.Submit(7);
+
+	ring.Reclaim(6);
+	checker.Check(ring.UsedBytes() == 50, "reclaiming fence 6 did not give back the wrapped submissions");
+	ring.Reclaim(7);
+	checker.Check(ring.UsedBytes() == 0, "the ring is not empty after every fence completed");
+
+	// a drained ring starts over at the beginning, so a large allocation does not have to wrap
+	checker.Check(ring.Allocate(100, 1) == 0, "a drained ring does not start over");
+
+	return checker.Result();
+}
+
+#ifdef ENABLE_PROFILER
+// Runs the timestamp query bookkeeping of the GPU profiler on made up timestamps: every frame
+// resource keeps to its range of queries and runs out of them without failing, the scopes nest,
+// the results of a frame come back NUM_FRAMES_IN_FLIGHT frames later and only once, and the GPU
+// ticks map onto the CPU clock.
+// Usage: YARendererChecks gpu-timestamps
+int CheckGpuTimestamps()
+{
+	Checker checker("GPU timestamps");
+
+	// 2.5 CPU ticks per GPU tick, both clocks sampled at GPU tick 1000
+	GpuClock clock;
+	clock.GpuTimestamp = 1000;
+	clock.CpuTicks = 5000;
+	clock.CpuTicksPerGpuTick = 2.5;
+	checker.Check(clock.ToCpuTicks(1400) == 6000, "later timestamp is mapped wrong");
+	checker.Check(clock.ToCpuTicks(600) == 4000, "earlier timestamp is mapped wrong");
+
+	const UINT queriesPerFrame = 8;
+	GpuClock identity;
+
+	// the query heap the GPU writes to, and the readback buffers it is resolved into
+	GpuTimestamps timestamps(NUM_FRAMES_IN_FLIGHT, queriesPerFrame);
+	std::vector<UINT64> heap(timestamps.NumQueries(), 0);
+	std::vector<std::vector<UINT64>> readback(NUM_FRAMES_IN_FLIGHT, std::vector<UINT64>(queriesPerFrame, 0));
+
+	auto resolve = [&](UINT frameIndex)
+	{
+		UINT firstQuery, numQueries;
+		timestamps.EndFrame(firstQuery, numQueries);
+		checker.Check(firstQuery == timestamps.FirstQuery(frameIndex), "resolves the queries of another frame resource");
+		std::copy(heap.begin() + firstQuery, heap.begin() + firstQuery + numQueries, readback[frameIndex].begin());
+	};
+
+	const int numFrames = 4 * NUM_FRAMES_IN_FLIGHT;
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		UINT frameIndex = frame % NUM_FRAMES_IN_FLIGHT;
+
+		// the frame resource comes around again, its fence has been waited for
+		std::vector<GpuScopeTiming> timings;
+		bool read = timestamps.Read(frameIndex, readback[frameIndex].data(), identity, timings);
+		checker.Check(read == (frame >= NUM_FRAMES_IN_FLIGHT), "results are not read NUM_FRAMES_IN_FLIGHT frames later");
+
+		if (read)
+		{
+			int64_t base = (frame - NUM_FRAMES_IN_FLIGHT) * 1000;
+			checker.Check(timings.size() == 3, "wrong number of scopes read");
+			if (timings.size() == 3)
+			{
+				checker.Check(std::string(timings[0].Name) == "Frame" && timings[0].Depth == 0, "frame scope");
+				checker.Check(std::string(timings[1].Name) == "Pass" && timings[1].Depth == 1, "pass scope");
+				checker.Check(std::string(timings[2].Name) == "Nested Pass" && timings[2].Depth == 2, "nested pass scope");
+				checker.Check(timings[0].Start == base && timings[0].End == base + 100, "frame scope timed wrong");
+				checker.Check(timings[1].Start == base + 10 && timings[1].End == base + 40, "pass scope timed wrong");
+				checker.Check(timings[2].Start == base + 20 && timings[2].End == base + 30, "nested pass scope timed wrong");
+			}
+
+			timings.clear();
+			checker.Check(!timestamps.Read(frameIndex, readback[frameIndex].data(), identity, timings), "results are read twice");
+		}
+
+		timestamps.BeginFrame(frameIndex);
+
+		UINT64 base = frame * 1000;
+		UINT queries[6];
+		queries[0] = timestamps.BeginScope("Frame");
+		queries[1] = timestamps.BeginScope("Pass");
+		queries[2] = timestamps.BeginScope("Nested Pass");
+		queries[3] = timestamps.EndScope();
+		queries[4] = timestamps.EndScope();
+		queries[5] = timestamps.EndScope();
+
+		UINT64 ticks[6] = {base, base + 10, base + 20, base + 30, base + 40, base + 100};
+		for (int i = 0; i < 6; i++)
+		{
+			UINT first = timestamps.FirstQuery(frameIndex);
+			checker.Check(queries[i] >= first && queries[i] < first + queriesPerFrame, "query outside the range of the frame resource");
+			if (queries[i] < heap.size())
+				heap[queries[i]] = ticks[i];
+		}
+
+		resolve(frameIndex);
+	}
+
+	// 4 scopes fit into 8 queries, the fifth is dropped along with its end
+	timestamps.BeginFrame(0);
+	for (int i = 0; i < 4; i++)
+		checker.Check(timestamps.BeginScope("Fits") != GpuTimestamps::INVALID_QUERY, "scope did not get queries");
+	checker.Check(timestamps.BeginScope("Dropped") == GpuTimestamps::INVALID_QUERY, "scope got queries beyond the frame");
+	checker.Check(timestamps.EndScope() == GpuTimestamps::INVALID_QUERY, "dropped scope ends with a query");
+	checker.Check(timestamps.DroppedScopes() == 1, "dropped scope is not counted");
+
+	// the inner scopes end, the outer ones are still open when the frame ends
+	for (int i = 0; i < 2; i++)
+		checker.Check(timestamps.EndScope() != GpuTimestamps::INVALID_QUERY, "scope did not end");
+
+	UINT firstQuery, numQueries;
+	timestamps.EndFrame(firstQuery, numQueries);
+	checker.Check(numQueries == queriesPerFrame, "wrong number of queries to resolve");
+
+	std::vector<UINT64> zeros(queriesPerFrame, 0);
+	std::vector<GpuScopeTiming> timings;
+	timestamps.Read(0, zeros.data(), identity, timings);
+	checker.Check(timings.size() == 2, "open scopes are read");
+
+	return checker.Result();
+}
+#endif
@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "Checks.h"
+#include "rendering/IBLCache.h"
+#include "rendering/SphericalHarmonics.h"
+
+#include <filesystem>
+
+// Compares the SH irradiance with a brute-force cosine convolution of a synthetic environment map:
+// a constant sky with a sharp sun, a wide blue lobe and a dim ground bounce, so it runs without an
+// HDR file. The sharpest lobe is what the 9 coefficients miss the most.
+// Usage: YARendererChecks sh
+int CheckSHIrradiance()
+{
+	const float tolerance = 0.05f;
+	const UINT size = 64;
+
+	struct Lobe
+	{
+		XMVECTOR Direction;
+		XMVECTOR Color;
+		float Exponent;
+	};
+	const Lobe lobes[] = {
+		{XMVector3Normalize(XMVectorSet(0.3f, 1.0f, 0.2f, 0.0f)), XMVectorSet(4.0f, 3.6f, 3.0f, 0.0f), 8.0f},
+		{XMVector3Normalize(XMVectorSet(-0.8f, 0.1f, 0.5f, 0.0f)), XMVectorSet(0.3f, 0.6f, 1.5f, 0.0f), 2.0f},
+		{XMVector3Normalize(XMVectorSet(0.2f, -1.0f, -0.4f, 0.0f)), XMVectorSet(0.5f, 0.4f, 0.25f, 0.0f), 1.0f},
+	};
+	const XMVECTOR sky = XMVectorSet(0.15f, 0.2f, 0.3f, 1.0f);
+
+	TextureData envMap;
+	envMap.Width = size;
+	envMap.Height = size;
+	envMap.ArraySize = 6;
+	envMap.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	envMap.IsCubemap = true;
+	envMap.Allocate();
+
+	for (UINT face = 0; face < 6; face++)
+	{
+		XMFLOAT4 *texels = envMap.Subresource<XMFLOAT4>(face, 0);
+		for (UINT y = 0; y < size; y++)
+		{
+			for (UINT x = 0; x < size; x++)
+			{
+				// texel centres, same face layout as GetSamplingVector in utils.hlsl
+				float u = 2.0f * (x + 0.5f) / size - 1.0f;
+				float v = 1.0f - 2.0f * (y + 0.5f) / size;
+
+				XMVECTOR direction;
+				switch (face)
+				{
+				case 0: direction = XMVectorSet(1.0f, v, -u, 0.0f); break;
+				case 1: direction = XMVectorSet(-1.0f, v, u, 0.0f); break;
+				case 2: direction = XMVectorSet(u, 1.0f, -v, 0.0f); break;
+				case 3: direction = XMVectorSet(u, -1.0f, v, 0.0f); break;
+				case 4: direction = XMVectorSet(u, v, 1.0f, 0.0f); break;
+				default: direction = XMVectorSet(-u, v, -1.0f, 0.0f); break;
+				}
+				direction = XMVector3Normalize(direction);
+
+				XMVECTOR radiance = sky;
+				for (const auto &lobe : lobes)
+				{
+					float cosine = std::max(0.0f, XMVectorGetX(XMVector3Dot(direction, lobe.Direction)));
+					radiance = XMVectorMultiplyAdd(lobe.Color, XMVectorReplicate(powf(cosine, lobe.Exponent)), radiance);
+				}
+				XMStoreFloat4(&texels[y * size + x], radiance);
+			}
+		}
+	}
+
+	SH9 irradiance = SphericalHarmonics::ConvolveIrradiance(SphericalHarmonics::ProjectCubemap(envMap));
+	TextureData reference = IBLBaker::ComputeIrradianceMap(envMap, 32, 64 * 1024);
+
+	float error = SphericalHarmonics::MaxRelativeError(irradiance, reference);
+	LOG_INFO("SH irradiance max relative error: {:.4f} (tolerance {:.4f})", error, tolerance);
+
+	return error <= tolerance ? 0 : 1;
+}
+
+// Checks that the cache key follows the source file, every bake setting and the cache version, and
+// that the texture comparison finds a changed texel after a half float DDS round trip.
+// Usage: YARendererChecks ibl-cache
+int CheckIBLCache()
+{
+	Checker checker("IBL cache");
+
+	auto temp = [](const char *name) { return (std::filesystem::temp_directory_path() / name).string(); };
+	auto write = [](const std::string &filename, const std::string &contents) { std::ofstream(filename, std::ios::binary) << contents; };
+
+	{
+		std::string hdr = temp("yarenderer_check.hdr");
+		write(hdr, "#?RADIANCE not really an image");
+
+		IBLBakeSettings settings;
+		std::string key = IBLCache::ComputeKey(hdr, settings);
+		checker.Check(key.size() == 16, "the key is not 16 hex digits: " + key);
+		checker.Check(IBLCache::ComputeKey(hdr, settings) == key, "the key is not deterministic");
+		checker.Check(IBLCache::ComputeKey(hdr, settings, IBLCache::CACHE_VERSION) == key, "the key does not default to the cache version");
+		checker.Check(IBLCache::ComputeKey(hdr, settings, IBLCache::CACHE_VERSION + 1) != key, "the key does not change with the cache version");
+
+		UINT IBLBakeSettings::*fields[] = {&IBLBakeSettings::EnvMapSize, &IBLBakeSettings::SpecularSamples,
+											&IBLBakeSettings::BRDFLUTSize, &IBLBakeSettings::BRDFSamples};
+		for (size_t i = 0; i < _countof(fields); i++)
+		{
+			IBLBakeSettings changed = settings;
+			changed.*fields[i] *= 2;
+			checker.Check(IBLCache::ComputeKey(hdr, changed) != key, "the key does not change with bake setting " + std::to_string(i));
+		}
+
+		write(hdr, "#?RADIANCE not really an image either");
+		checker.Check(IBLCache::ComputeKey(hdr, settings) != key, "the key does not change with the source file");
+
+		std::error_code error;
+		std::filesystem::remove(hdr, error);
+	}
+
+	{
+		TextureData texture;
+		texture.Width = 8;
+		texture.Height = 8;
+		texture.Levels = 4;
+		texture.ArraySize = 6;
+		texture.IsCubemap = true;
+		texture.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		texture.Allocate();
+
+		float *data = reinterpret_cast<float *>(texture.Data.data());
+		size_t count = texture.Data.size() / sizeof(float);
+		for (size_t i = 0; i < count; i++)
+			data[i] = (float)(i % 97) * 0.25f;
+
+		std::string dds = temp("yarenderer_check.dds");
+		TextureData loaded;
+		checker.Check(DDS::Save(dds, IBLBaker::ConvertToHalf(texture)) && DDS::Load(dds, loaded), "the DDS round trip fails");
+		std::error_code error;
+		std::filesystem::remove(dds, error);
+
+		TextureDifference same = IBLBaker::Compare(loaded, texture, 0.001f);
+		checker.Check(same.SameLayout && same.NumTexels == count / 4, "the half and the float texture do not compare");
+		checker.Check(same.NumOverTolerance == 0 && same.MaxError < 0.001f, "the half round trip is off by " + std::to_string(same.MaxError));
+
+		// one channel of one texel in the last face off by 10%
+		TextureData changed = texture;
+		changed.Subresource<float>(5, 2)[1] = 24.0f * 1.1f;
+		texture.Subresource<float>(5, 2)[1] = 24.0f;
+		TextureDifference off = IBLBaker::Compare(changed, texture, 0.05f);
+		checker.Check(off.NumOverTolerance == 1, std::to_string(off.NumOverTolerance) + " texel(s) over the tolerance instead of 1");
+		checker.Check(fabsf(off.MaxError - 0.1f / 1.1f) < 1.0e-5f, "the error is not relative above 1: " + std::to_string(off.MaxError));
+		checker.Check(IBLBaker::Compare(changed, texture, 0.1f).NumOverTolerance == 0, "a texel within the tolerance counts");
+
+		TextureData smaller = texture;
+		smaller.Levels = 3;
+		smaller.Allocate();
+		checker.Check(!IBLBaker::Compare(smaller, texture, 1.0f).SameLayout, "textures with different mips compare");
+	}
+
+	return checker.Result();
+}
@@ -0,0 +1,497 @@
+#include "pch.h"
+#include "Checks.h"
+#include "ShadowScene.h"
+#include "rendering/CascadeFitting.h"
+#include "rendering/ShadowCascadeCache.h"
+#include "rendering/ShadowCasterCulling.h"
+
+// Fits the shadow cascades to synthetic scenes and checks that every visible receiver falls into
+// its cascade, that no caster is clipped, that fitting tightens the volumes and that the
+// projections keep to the texel grid while the camera moves.
+// Usage: YARendererChecks cascade-fitting
+int CheckCascadeFitting()
+{
+	Checker checker("Cascade fitting");
+
+	float ends[NUM_CASCADES + 1];
+	CascadeFitting::Splits(1.0f, 101.0f, 1.5f, ends);
+	checker.Check(ends[0] == 1.0f && ends[NUM_CASCADES] == 101.0f, "the splits must start and end at the given depths");
+	for (int i = 1; i < NUM_CASCADES; i++)
+		checker.Check(fabsf((ends[i + 1] - ends[i]) / (ends[i] - ends[i - 1]) - 1.5f) < 1.0e-3f, "each cascade must be range scale times deeper than the previous one");
+
+	for (float extent : {0.3f, 1.0f, 7.77f, 12.5f, 100.0f, 1234.5f})
+	{
+		float quantized = CascadeFitting::QuantizeExtent(extent);
+		checker.Check(quantized >= extent && quantized <= extent * 1.0625f, "a quantized extent must lie within 1/16 of an octave above it");
+		checker.Check(CascadeFitting::QuantizeExtent(quantized) == quantized, "quantizing must be idempotent");
+
+		float depth = CascadeFitting::QuantizeDepthDown(extent);
+		checker.Check(depth <= extent && depth >= extent / 1.0625f, "a quantized depth must lie within 1/16 of an octave below it");
+		checker.Check(CascadeFitting::QuantizeDepthDown(depth) == depth, "quantizing depths must be idempotent");
+	}
+
+	// boxes in front of, behind and beside a camera looking down +z
+	Camera camera;
+	camera.SetLens(0.25f * MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+	camera.LookAt(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+
+	std::vector<BoundingBox> boxes = {
+		BoundingBox(XMFLOAT3(0.0f, 0.0f, 25.0f), XMFLOAT3(5.0f, 5.0f, 5.0f)),
+		BoundingBox(XMFLOAT3(0.0f, 0.0f, -20.0f), XMFLOAT3(5.0f, 5.0f, 5.0f)),
+		BoundingBox(XMFLOAT3(100.0f, 0.0f, 25.0f), XMFLOAT3(5.0f, 5.0f, 5.0f)),
+	};
+	float minDepth, maxDepth;
+	checker.Check(CascadeFitting::ViewDepthRange(camera, boxes, 100.0f, minDepth, maxDepth) &&
+					  fabsf(minDepth - 20.0f) < 1.0e-3f && fabsf(maxDepth - 30.0f) < 1.0e-3f,
+				  "the view depth range must only cover the boxes inside the view frustum");
+	checker.Check(!CascadeFitting::ViewDepthRange(camera, {boxes[1], boxes[2]}, 100.0f, minDepth, maxDepth), "boxes outside the view frustum must give no depth range");
+
+	// a ground plane with pillars and a tower, seen from above its edge
+	std::vector<BoundingBox> scene = {BoundingBox(XMFLOAT3(0.0f, -0.25f, 0.0f), XMFLOAT3(30.0f, 0.25f, 30.0f))};
+	for (int x = -2; x <= 2; x++)
+		for (int z = -2; z <= 2; z++)
+			scene.push_back(BoundingBox(XMFLOAT3(x * 12.0f, 3.0f, z * 12.0f), XMFLOAT3(0.5f, 3.0f, 0.5f)));
+	scene.push_back(BoundingBox(XMFLOAT3(20.0f, 15.0f, 25.0f), XMFLOAT3(3.0f, 15.0f, 3.0f)));
+
+	camera.LookAt(XMFLOAT3(-5.0f, 8.0f, -45.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+
+	XMVECTOR lightDir = XMVector3Normalize(XMVectorSet(0.3f, -1.0f, 0.4f, 0.0f));
+
+	// points on the surfaces of the boxes
+	std::vector<XMVECTOR> points;
+	for (const auto &box : scene)
+	{
+		const int n = 8;
+		for (int x = 0; x <= n; x++)
+			for (int y = 0; y <= n; y++)
+				for (int z = 0; z <= n; z++)
+				{
+					if (x != 0 && x != n && y != 0 && y != n && z != 0 && z != n)
+						continue;
+
+					XMVECTOR t = XMVectorSet((float)x / n, (float)y / n, (float)z / n, 0.0f) * 2.0f - XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f);
+					points.push_back(XMVectorSetW(XMLoadFloat3(&box.Center) + t * XMLoadFloat3(&box.Extents), 1.0f));
+				}
+	}
+
+	auto inCascade = [](const CascadeFit &fit, int cascade, FXMVECTOR point)
+	{
+		XMFLOAT3 ndc;
+		XMStoreFloat3(&ndc, XMVector3TransformCoord(point, fit.ViewProj[cascade]));
+		const float epsilon = 1.0e-4f;
+		return fabsf(ndc.x) <= 1.0f + epsilon && fabsf(ndc.y) <= 1.0f + epsilon && ndc.z >= -epsilon && ndc.z <= 1.0f + epsilon;
+	};
+
+	// every visible point within the shadow distance must be inside the cascade GetCascadeIndex
+	// picks, and inside the next one as well where the two are blended
+	auto checkCoverage = [&](const CascadeFit &fit, float transitionRatio)
+	{
+		float tanY = tanf(0.5f * camera.GetFovY());
+		float tanX = tanY * camera.GetAspect();
+
+		bool covered = true;
+		for (const auto &point : points)
+		{
+			XMFLOAT3 view;
+			XMStoreFloat3(&view, XMVector3TransformCoord(point, camera.GetView()));
+			if (view.z < camera.GetNearZ() || fabsf(view.x) > view.z * tanX || fabsf(view.y) > view.z * tanY)
+				continue;
+
+			int cascade = -1;
+			for (int i = NUM_CASCADES - 1; i >= 0; i--)
+				if (view.z < fit.Ends[i + 1])
+					cascade = i;
+
+			if (cascade == -1)
+				continue;
+
+			covered &= inCascade(fit, cascade, point);
+
+			float cascadeLength = fit.Ends[cascade + 1] - fit.Ends[cascade];
+			if (cascade + 1 < NUM_CASCADES && view.z >= fit.Ends[cascade + 1] - cascadeLength * transitionRatio)
+				covered &= inCascade(fit, cascade + 1, point);
+		}
+		return covered;
+	};
+
+	// nothing in a cascade's square may be clipped by its near plane
+	auto checkCasters = [&](const CascadeFit &fit)
+	{
+		bool unclipped = true;
+		for (int i = 0; i < NUM_CASCADES; i++)
+			for (const auto &point : points)
+			{
+				XMFLOAT3 ndc;
+				XMStoreFloat3(&ndc, XMVector3TransformCoord(point, fit.ViewProj[i]));
+				if (fabsf(ndc.x) <= 1.0f && fabsf(ndc.y) <= 1.0f)
+					unclipped &= ndc.z >= -1.0e-4f;
+			}
+		return unclipped;
+	};
+
+	CascadeFitSettings settings;
+	CascadeFitSettings unfittedSettings;
+	unfittedSettings.FitToScene = false;
+
+	CascadeFit fit, unfitted;
+	CascadeFitting::Fit(camera, lightDir, scene, settings, fit);
+	CascadeFitting::Fit(camera, lightDir, scene, unfittedSettings, unfitted);
+
+	checker.Check(checkCoverage(unfitted, unfittedSettings.TransitionRatio), "the unfitted cascades must cover the visible receivers");
+	checker.Check(checkCoverage(fit, settings.TransitionRatio), "the fitted cascades must cover the visible receivers");
+	checker.Check(checkCasters(fit), "the fitted cascades must not clip casters");
+
+	// the splits differ, so compare the volumes the cascades span
+	bool tighter = true;
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		float volume = fit.Radius[i] * fit.Radius[i] * (fit.LightFar[i] - fit.LightNear[i]);
+		float unfittedVolume = unfitted.Radius[i] * unfitted.Radius[i] * (unfitted.LightFar[i] - unfitted.LightNear[i]);
+		tighter &= volume < unfittedVolume;
+		LOG_INFO("Cascade {}: ends {} - {}, extent {} (unfitted {}), depth {} (unfitted {})", i, fit.Ends[i], fit.Ends[i + 1],
+				 2.0f * fit.Radius[i], 2.0f * unfitted.Radius[i], fit.LightFar[i] - fit.LightNear[i], unfitted.LightFar[i] - unfitted.LightNear[i]);
+	}
+	checker.Check(tighter, "fitting must shrink the cascade volumes");
+	checker.Check(fit.Ends[NUM_CASCADES] < settings.MaxShadowDistance, "the splits must end at the farthest visible box");
+
+	// the depth range of the visible pixels narrows the splits further
+	CascadeFitSettings depthSettings;
+	depthSettings.MinDepth = 10.0f;
+	depthSettings.MaxDepth = 30.0f;
+
+	CascadeFit depthFit;
+	CascadeFitting::Fit(camera, lightDir, scene, depthSettings, depthFit);
+	checker.Check(depthFit.Ends[NUM_CASCADES] <= CascadeFitting::QuantizeExtent(33.0f) && depthFit.Ends[1] < fit.Ends[1], "the splits must follow the visible depth range");
+	checker.Check(checkCoverage(depthFit, depthSettings.TransitionRatio), "the cascades fitted to the visible depth must cover the receivers up to it");
+
+	// the jitter of the depth buffer from frame to frame must not move the splits
+	CascadeFitSettings jitteredSettings = depthSettings;
+	jitteredSettings.MinDepth = 10.01f;
+	jitteredSettings.MaxDepth = 29.98f;
+
+	CascadeFit jitteredFit;
+	CascadeFitting::Fit(camera, lightDir, scene, jitteredSettings, jitteredFit);
+	checker.Check(memcmp(jitteredFit.Ends, depthFit.Ends, sizeof(depthFit.Ends)) == 0, "a slightly different visible depth range must give the same splits");
+
+	// moving the camera a little keeps a world point at the same fraction of a texel in the
+	// cascades whose extent did not change
+	Camera moved = camera;
+	moved.LookAt(XMFLOAT3(-4.93f, 8.0f, -44.96f), XMFLOAT3(0.07f, 0.0f, 0.04f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+	moved.UpdateViewMatrix();
+
+	auto checkSnapping = [&](const CascadeFitSettings &settings, int &compared)
+	{
+		CascadeFit before, after;
+		CascadeFitting::Fit(camera, lightDir, scene, settings, before);
+		CascadeFitting::Fit(moved, lightDir, scene, settings, after);
+
+		bool snapped = true;
+		for (int i = 0; i < NUM_CASCADES; i++)
+		{
+			if (after.Radius[i] != before.Radius[i])
+				continue;
+
+			for (XMVECTOR point : {XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(7.3f, 1.1f, -3.9f, 1.0f)})
+			{
+				XMFLOAT3 ndcBefore, ndcAfter;
+				XMStoreFloat3(&ndcBefore, XMVector3TransformCoord(point, before.ViewProj[i]));
+				XMStoreFloat3(&ndcAfter, XMVector3TransformCoord(point, after.ViewProj[i]));
+
+				float dx = (ndcAfter.x - ndcBefore.x) * 0.5f * SHADOW_MAP_SIZE;
+				float dy = (ndcAfter.y - ndcBefore.y) * 0.5f * SHADOW_MAP_SIZE;
+				snapped &= fabsf(dx - roundf(dx)) < 0.05f && fabsf(dy - roundf(dy)) < 0.05f;
+			}
+			compared++;
+		}
+		return snapped;
+	};
+
+	int compared = 0;
+	checker.Check(checkSnapping(unfittedSettings, compared) && compared == NUM_CASCADES, "the unfitted cascades must move in whole texels");
+	compared = 0;
+	checker.Check(checkSnapping(settings, compared) && compared > 0, "the fitted cascades must move in whole texels");
+
+	// without bounds and with the sun straight above, the cascades must stay valid
+	CascadeFit emptyFit;
+	CascadeFitting::Fit(camera, XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f), {}, settings, emptyFit);
+
+	bool valid = emptyFit.Ends[NUM_CASCADES] == settings.MaxShadowDistance;
+	for (int i = 0; i < NUM_CASCADES; i++)
+	{
+		XMFLOAT4X4 matrix;
+		XMStoreFloat4x4(&matrix, emptyFit.ViewProj[i]);
+		for (int k = 0; k < 16; k++)
+			valid &= std::isfinite(matrix.m[k / 4][k % 4]);
+		valid &= emptyFit.Radius[i] > 0.0f && emptyFit.LightFar[i] > emptyFit.LightNear[i];
+	}
+	checker.Check(valid, "a scene without bounds must fall back to the bounding spheres");
+
+	// fitting all cascades at once must give what fitting them one by one gave
+	std::mt19937 rng(11);
+	std::vector<BoundingBox> scratch;
+	float maxError = 0.0f;
+	for (int view = 0; view < 32; view++)
+	{
+		std::vector<BoundingBox> randomScene = RandomShadowScene(rng, 200);
+		Camera randomCamera;
+		XMVECTOR randomLight;
+		RandomShadowView(rng, randomCamera, randomLight);
+
+		CascadeFitSettings randomSettings;
+		randomSettings.FitToScene = view % 4 != 0;
+		if (view % 2 == 0)
+		{
+			randomSettings.MinDepth = 5.0f;
+			randomSettings.MaxDepth = 60.0f;
+		}
+
+		CascadeFit batched, reference;
+		CascadeFitting::Fit(randomCamera, randomLight, randomScene, randomSettings, batched, scratch);
+		CascadeFitting::FitReference(randomCamera, randomLight, randomScene, randomSettings, reference);
+
+		for (int i = 0; i < NUM_CASCADES; i++)
+		{
+			XMFLOAT4X4 a, b;
+			XMStoreFloat4x4(&a, batched.ViewProj[i]);
+			XMStoreFloat4x4(&b, reference.ViewProj[i]);
+			for (int k = 0; k < 16; k++)
+				maxError = std::max(maxError, fabsf(a.m[k / 4][k % 4] - b.m[k / 4][k % 4]) / std::max(1.0f, fabsf(b.m[k / 4][k % 4])));
+
+			float scale = std::max(1.0f, reference.Radius[i]);
+			maxError = std::max(maxError, fabsf(batched.Radius[i] - reference.Radius[i]) / scale);
+			maxError = std::max(maxError, fabsf(batched.Center[i].x - reference.Center[i].x) / scale);
+			maxError = std::max(maxError, fabsf(batched.Center[i].y - reference.Center[i].y) / scale);
+			maxError = std::max(maxError, fabsf(batched.LightNear[i] - reference.LightNear[i]) / scale);
+			maxError = std::max(maxError, fabsf(batched.LightFar[i] - reference.LightFar[i]) / scale);
+		}
+		for (int i = 0; i <= NUM_CASCADES; i++)
+			maxError = std::max(maxError, fabsf(batched.Ends[i] - reference.Ends[i]));
+	}
+	LOG_INFO("Cascade fitting: largest difference to the reference {}", maxError);
+	checker.Check(maxError < 1.0e-5f, "the batched fit must match the reference");
+
+	return checker.Result();
+}
+
+// Runs the shadow cascade cache on synthetic cascades and checks when the static layers are
+// redrawn: unchanged or only rounded projections keep them, a texel of motion, a turned sun or an
+// invalidation redraws them, and distant cascades keep a covering projection for a few frames.
+// Usage: YARendererChecks shadow-cache
+int CheckShadowCache()
+{
+	Checker checker("Shadow cache");
+
+	XMVECTOR lightDir = XMVector3Normalize(XMVectorSet(0.3f, -1.0f, 0.4f, 0.0f));
+
+	// cascades doubling in size around the origin of light space, shifted by whole texels
+	auto makeFit = [](FXMVECTOR direction, float shiftTexels, float shrink)
+	{
+		XMMATRIX lightView = XMMatrixLookToLH(XMVectorZero(), direction, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+		CascadeFit fit = {};
+		for (int i = 0; i < NUM_CASCADES; i++)
+		{
+			float radius = 10.0f * (1 << i) - shrink;
+			float shift = shiftTexels * 2.0f * radius / SHADOW_MAP_SIZE;
+			fit.Center[i] = XMFLOAT2(shift, 0.0f);
+			fit.Radius[i] = radius;
+			fit.LightNear[i] = -50.0f;
+			fit.LightFar[i] = 50.0f;
+			fit.ViewProj[i] = lightView * XMMatrixOrthographicOffCenterLH(shift - radius, shift + radius, -radius, radius, -50.0f, 50.0f);
+		}
+		return fit;
+	};
+
+	auto sameMatrix = [](FXMMATRIX a, CXMMATRIX b)
+	{
+		return memcmp(&a, &b, sizeof(XMMATRIX)) == 0;
+	};
+
+	ShadowCascadeCache cache;
+	ShadowCacheSettings settings;
+
+	CascadeFit fit = makeFit(lightDir, 0.0f, 0.0f);
+	cache.Update(fit, lightDir, settings);
+	checker.Check(cache.RedrawCount() == NUM_CASCADES, "the first update must redraw every cascade");
+
+	fit = makeFit(lightDir, 0.0f, 0.0f);
+	cache.Update(fit, lightDir, settings);
+	checker.Check(cache.RedrawCount() == 0, "an unchanged projection must keep the cached layers");
+
+	// rounding noise on the matrices keeps the layers and the projections they were drawn with
+	CascadeFit cached = makeFit(lightDir, 0.0f, 0.0f);
+	fit = cached;
+	fit.ViewProj[1].r[3] = fit.ViewProj[1].r[3] + XMVectorReplicate(1.0e-7f);
+	cache.Update(fit, lightDir, settings);
+	checker.Check(cache.RedrawCount() == 0, "rounding noise must not redraw a cascade");
+	checker.Check(sameMatrix(fit.ViewProj[1], cached.ViewProj[1]), "a kept cascade must use the projection its layer was drawn with");
+
+	// a snapped projection moving by a texel
+	fit = makeFit(lightDir, 1.0f, 0.0f);
+	cache.Update(fit, lightDir, settings);
+	checker.Check(cache.RedrawCount() == NUM_CASCADES, "moving by a texel must redraw the cascades");
+
+	// the sun turning a little below and above the epsilon
+	XMVECTOR nudged = XMVector3Normalize(lightDir + XMVectorSet(1.0e-4f, 0.0f, 0.0f, 0.0f));
+	checker.Check(ShadowCascadeCache::SameDirection(lightDir, nudged, settings.DirectionEpsilon), "a tiny turn must count as the same direction");
+
+	XMVECTOR turned = XMVector3Normalize(lightDir + XMVectorSet(0.05f, 0.0f, 0.0f, 0.0f));
+	checker.Check(!ShadowCascadeCache::SameDirection(lightDir, turned, settings.DirectionEpsilon), "a visible turn must not count as the same direction");
+
+	fit = makeFit(lightDir, 1.0f, 0.0f);
+	CascadeFit turnedFit = fit; // the projections kept the same, only the direction is compared
+	cache.Update(turnedFit, turned, settings);
+	checker.Check(cache.RedrawCount() == NUM_CASCADES, "turning the sun must redraw every cascade");
+
+	fit = makeFit(turned, 1.0f, 0.0f);
+	cache.Update(fit, turned, settings);
+	cache.Update(fit, turned, settings);
+	cache.Invalidate();
+	cache.Update(fit, turned, settings);
+	checker.Check(cache.RedrawCount() == NUM_CASCADES, "an invalidated cache must redraw every cascade");
+
+	// distant cascades keep a projection covering the fitted one until the interval runs out
+	ShadowCacheSettings distantSettings;
+	distantSettings.DistantInterval = 4;
+
+	ShadowCascadeCache distantCache;
+	CascadeFit held = makeFit(lightDir, 0.0f, 0.0f);
+	distantCache.Update(held, lightDir, distantSettings);
+
+	int distantRedraws = 0;
+	bool nearRedrawn = true;
+	bool heldRestored = true;
+	for (int frame = 1; frame <= 8; frame++)
+	{
+		// shrinking by more than they move, so the held squares still cover the fitted ones
+		fit = makeFit(lightDir, (float)frame, 0.5f * frame);
+		distantCache.Update(fit, lightDir, distantSettings);
+
+		for (int i = 0; i < distantSettings.FirstDistantCascade; i++)
+			nearRedrawn &= distantCache.NeedsRedraw(i);
+		for (int i = distantSettings.FirstDistantCascade; i < NUM_CASCADES; i++)
+		{
+			distantRedraws += distantCache.NeedsRedraw(i) ? 1 : 0;
+			if (!distantCache.NeedsRedraw(i))
+				heldRestored &= fit.Radius[i] == held.Radius[i] && fit.Center[i].x == held.Center[i].x;
+			else
+				held.Radius[i] = fit.Radius[i], held.Center[i] = fit.Center[i];
+		}
+	}
+	checker.Check(nearRedrawn, "the near cascades must follow the fit every frame");
+	checker.Check(distantRedraws == 2 * (NUM_CASCADES - distantSettings.FirstDistantCascade), "a distant cascade must be refitted once per interval");
+	checker.Check(heldRestored, "a held cascade must keep the square its layer was drawn with");
+
+	// a fitted square reaching outside the held one is refitted right away
+	fit = makeFit(lightDir, 0.0f, -1.0f);
+	distantCache.Update(fit, lightDir, distantSettings);
+	checker.Check(distantCache.RedrawCount() == NUM_CASCADES, "a held cascade that no longer covers the fit must be redrawn");
+
+	return checker.Result();
+}
+
+// Culls random boxes against the cascades of random views and compares the result with clipping
+// each box against the volume on its own. Then shoots rays from points in each slice toward the
+// light and checks that every box they hit was kept, and that culling drops the rest of the scene.
+// Usage: YARendererChecks shadow-culling
+int CheckShadowCulling()
+{
+	Checker checker("Shadow culling");
+
+	std::mt19937 rng(7);
+	auto uniform = [&](float lo, float hi)
+	{
+		return std::uniform_real_distribution<float>(lo, hi)(rng);
+	};
+
+	int mismatches = 0;
+	int missed = 0;
+	int kept = 0;
+	int tested = 0;
+
+	for (int view = 0; view < 16; view++)
+	{
+		std::vector<BoundingBox> scene = RandomShadowScene(rng, 301);
+
+		Camera camera;
+		XMVECTOR lightDir;
+		RandomShadowView(rng, camera, lightDir);
+
+		CascadeFitSettings settings;
+		settings.FitToScene = view % 2 == 0;
+
+		CascadeFit fit;
+		CascadeFitting::Fit(camera, lightDir, scene, settings, fit);
+
+		ShadowCasterCulling culling;
+		culling.SetCasters(scene, fit.LightView);
+		checker.Check(culling.Size() == scene.size(), "every box must be a caster");
+
+		std::vector<BoundingBox> sceneLS(scene.size());
+		for (size_t i = 0; i < scene.size(); i++)
+			scene[i].Transform(sceneLS[i], fit.LightView);
+
+		for (int i = 0; i < NUM_CASCADES; i++)
+		{
+			CasterCullVolume projection, slice;
+			ShadowCasterCulling::ProjectionVolume(fit, i, projection);
+			ShadowCasterCulling::SliceVolume(camera, fit, i, settings.TransitionRatio, 0.1f, slice);
+			checker.Check(slice.OutlineSize >= 3, "a slice must have an outline");
+
+			for (const auto *volume : {&projection, &slice})
+			{
+				std::vector<UINT> visible;
+				culling.Cull(*volume, visible);
+
+				std::vector<UINT> reference;
+				for (UINT k = 0; k < sceneLS.size(); k++)
+				{
+					if (ShadowCasterCulling::IntersectsReference(sceneLS[k], *volume))
+						reference.push_back(k);
+				}
+				mismatches += visible != reference ? 1 : 0;
+			}
+
+			std::vector<UINT> visible;
+			culling.Cull(slice, visible);
+			kept += (int)visible.size();
+			tested += (int)scene.size();
+
+			// receivers in the slice and the square, any box between them and the light casts onto them
+			float sliceNear = i > 0 ? fit.Ends[i] - (fit.Ends[i] - fit.Ends[i - 1]) * settings.TransitionRatio : fit.Ends[i];
+			float tanY = tanf(0.5f * camera.GetFovY());
+			float tanX = tanY * camera.GetAspect();
+
+			for (int sample = 0; sample < 200; sample++)
+			{
+				float z = uniform(sliceNear, fit.Ends[i + 1]);
+				XMVECTOR pointWS = camera.GetPosition() + camera.GetLook() * z + camera.GetRight() * (uniform(-1.0f, 1.0f) * z * tanX) +
+								   camera.GetUp() * (uniform(-1.0f, 1.0f) * z * tanY);
+				XMFLOAT3 point;
+				XMStoreFloat3(&point, XMVector3TransformCoord(pointWS, fit.LightView));
+
+				if (fabsf(point.x - fit.Center[i].x) > fit.Radius[i] || fabsf(point.y - fit.Center[i].y) > fit.Radius[i] ||
+					point.z >= fit.LightFar[i])
+					continue;
+
+				for (UINT k = 0; k < sceneLS.size(); k++)
+				{
+					const BoundingBox &box = sceneLS[k];
+					bool occludes = fabsf(point.x - box.Center.x) <= box.Extents.x && fabsf(point.y - box.Center.y) <= box.Extents.y &&
+									box.Center.z - box.Extents.z < point.z;
+					if (occludes && !std::binary_search(visible.begin(), visible.end(), k))
+						missed++;
+				}
+			}
+		}
+	}
+
+	checker.Check(mismatches == 0, "culling must match clipping each box against the volume");
+	checker.Check(missed == 0, "every box between a receiver and the light must be kept");
+	checker.Check(kept < tested / 2, "culling must drop most of a scene spread far beyond the view");
+	LOG_INFO("Shadow culling: kept {} of {} caster tests", kept, tested);
+
+	return checker.Result();
+}
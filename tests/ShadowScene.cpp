@@ -0,0 +1,36 @@
+#include "pch.h"
+#include "ShadowScene.h"
+
+std::vector<BoundingBox> RandomShadowScene(std::mt19937 &rng, int count)
+{
+	auto uniform = [&](float lo, float hi)
+	{
+		return std::uniform_real_distribution<float>(lo, hi)(rng);
+	};
+
+	std::vector<BoundingBox> scene;
+	for (int i = 0; i < count; i++)
+	{
+		XMFLOAT3 center(uniform(-150.0f, 150.0f), uniform(0.0f, 20.0f), uniform(-150.0f, 150.0f));
+		XMFLOAT3 extents(uniform(0.1f, 5.0f), uniform(0.1f, 10.0f), uniform(0.1f, 5.0f));
+		scene.push_back(BoundingBox(center, extents));
+	}
+	scene.push_back(BoundingBox(XMFLOAT3(0.0f, -0.5f, 0.0f), XMFLOAT3(150.0f, 0.5f, 150.0f)));
+	return scene;
+}
+
+void RandomShadowView(std::mt19937 &rng, Camera &camera, XMVECTOR &lightDir)
+{
+	auto uniform = [&](float lo, float hi)
+	{
+		return std::uniform_real_distribution<float>(lo, hi)(rng);
+	};
+
+	camera.SetLens(0.25f * MathHelper::Pi, 16.0f / 9.0f, 0.5f, 1000.0f);
+	XMFLOAT3 position(uniform(-50.0f, 50.0f), uniform(2.0f, 30.0f), uniform(-50.0f, 50.0f));
+	XMFLOAT3 target(uniform(-50.0f, 50.0f), 0.0f, uniform(-50.0f, 50.0f));
+	camera.LookAt(position, target, XMFLOAT3(0.0f, 1.0f, 0.0f));
+	camera.UpdateViewMatrix();
+
+	lightDir = XMVector3Normalize(XMVectorSet(uniform(-1.0f, 1.0f), uniform(-1.0f, -0.2f), uniform(-1.0f, 1.0f), 0.0f));
+}
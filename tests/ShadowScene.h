@@ -0,0 +1,12 @@
+#pragma once
+
+#include "pch.h"
+#include "rendering/Camera.h"
+
+#include <random>
+
+// Boxes of all sizes scattered over a few hundred metres on a ground plane
+std::vector<BoundingBox> RandomShadowScene(std::mt19937 &rng, int count);
+
+// A random camera above the scene and a random sun
+void RandomShadowView(std::mt19937 &rng, Camera &camera, XMVECTOR &lightDir);
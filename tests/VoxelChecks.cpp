@@ -0,0 +1,567 @@
+#include "pch.h"
+#include "Checks.h"
+#include "rendering/VoxelBricks.h"
+#include "rendering/Mesh.h"
+#include "rendering/VoxelDirtyRegions.h"
+#include "rendering/VoxelClipmap.h"
+#include "rendering/VoxelUpdateSchedule.h"
+#include "rendering/VoxelPacking.h"
+#include "rendering/CpuVoxelizer.h"
+
+#include <filesystem>
+#include <random>
+
+// Runs the dirty brick bookkeeping of the incremental revoxelization on a synthetic scene.
+// Usage: YARendererChecks voxel-dirty
+int CheckVoxelDirtyRegions()
+{
+	Checker checker("Voxel dirty regions");
+
+	// a floor quad at y = 0 spanning the whole grid
+	const float extent = VOXEL_DIMENSION * VOXEL_GRID_SIZE;
+	XMVECTOR corners[4] = {
+		WorldToVoxelSpace(XMVectorSet(-extent, 0.0f, -extent, 1.0f)),
+		WorldToVoxelSpace(XMVectorSet(extent, 0.0f, -extent, 1.0f)),
+		WorldToVoxelSpace(XMVectorSet(extent, 0.0f, extent, 1.0f)),
+		WorldToVoxelSpace(XMVectorSet(-extent, 0.0f, extent, 1.0f)),
+	};
+
+	BrickOccupancy occupancy;
+	occupancy.AddTriangle(corners[0], corners[1], corners[2]);
+	occupancy.AddTriangle(corners[0], corners[2], corners[3]);
+
+	VoxelDirtyRegions dirtyRegions;
+	dirtyRegions.Reset(occupancy);
+	checker.Check(dirtyRegions.NumDirty() == 0, "a reset queue must be empty");
+
+	BoundingBox local(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	BoundingBox bounds = VoxelDirtyRegions::ToVoxelSpace(local, XMMatrixIdentity());
+
+	checker.Check(dirtyRegions.UpdateItem(0, bounds), "a new item must mark its bricks");
+	UINT marked = dirtyRegions.NumDirty();
+	checker.Check(marked > 0, "an item on the floor must cover occupied bricks");
+	checker.Check(!dirtyRegions.UpdateItem(0, bounds), "an unchanged item must not mark anything");
+	checker.Check(dirtyRegions.NumDirty() == marked, "bricks must be queued at most once");
+
+	// an item floating above the floor only covers empty bricks
+	BoundingBox floating = VoxelDirtyRegions::ToVoxelSpace(local, XMMatrixTranslation(0.0f, 10.0f, 0.0f));
+	dirtyRegions.UpdateItem(1, floating);
+	checker.Check(dirtyRegions.NumDirty() == marked, "unallocated bricks must not be queued");
+
+	// budgeted pops drain the queue oldest first
+	auto first = dirtyRegions.Pop(1);
+	checker.Check(first.size() == 1, "a pop must respect the budget");
+	checker.Check(dirtyRegions.NumDirty() == marked - 1, "popped bricks must leave the queue");
+	dirtyRegions.Pop(UINT_MAX);
+	checker.Check(dirtyRegions.NumDirty() == 0, "an unlimited pop must drain the queue");
+
+	// moving an item marks both where it was and where it is
+	BoundingBox moved = VoxelDirtyRegions::ToVoxelSpace(local, XMMatrixTranslation(5.0f, 0.0f, 0.0f));
+	checker.Check(dirtyRegions.UpdateItem(0, moved), "a moved item must mark its bricks");
+	XMUINT3 oldBrick = BrickOccupancy::UnpackBrick(first[0]);
+	checker.Check(dirtyRegions.IsDirty(oldBrick.x, oldBrick.y, oldBrick.z), "a moved item must mark the bricks it left");
+
+	dirtyRegions.MarkAll();
+	checker.Check(dirtyRegions.NumDirty() == occupancy.NumOccupied(), "marking everything must queue every occupied brick once");
+
+	return checker.Result();
+}
+
+// Adds a box mesh to the brick occupancy and compares the result with the bricks its faces pass
+// through. The faces lie in the middle of bricks, so the conservative test has nothing to round.
+// Usage: YARendererChecks brick-occupancy
+int CheckBrickOccupancy()
+{
+	Checker checker("Brick occupancy");
+
+	// a unit cube, three faces per submesh and each submesh with vertices of its own
+	Mesh cube;
+	const UINT faces[6][4] = {{0, 2, 6, 4}, {2, 3, 7, 6}, {0, 1, 3, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {4, 5, 7, 6}};
+	for (UINT s = 0; s < 2; s++)
+	{
+		Mesh::SubMesh submesh;
+		submesh.MaterialIndex = 0;
+		submesh.BaseVertexLocation = (INT)cube.Vertices().size();
+		submesh.StartIndexLocation = (UINT)cube.Indices().size();
+		submesh.IndexCount = 18;
+		cube.SubMeshes().push_back(submesh);
+
+		for (UINT corner = 0; corner < 8; corner++)
+		{
+			Mesh::Vertex vertex = {};
+			vertex.Position = XMFLOAT3((float)(corner & 1), (float)((corner >> 1) & 1), (float)((corner >> 2) & 1));
+			cube.Vertices().push_back(vertex);
+		}
+
+		for (UINT f = 3 * s; f < 3 * s + 3; f++)
+			for (UINT corner : {0, 1, 2, 0, 2, 3})
+				cube.Indices().push_back(faces[f][corner]);
+	}
+
+	// voxels 132 to 156 on every axis, the middle of bricks 16 and 19, y points down in voxel space
+	const float voxelSize = 2.0f * VOXEL_GRID_SIZE;
+	const float first = 132.0f, last = 156.0f, centre = VOXEL_DIMENSION * 0.5f;
+	XMMATRIX world = XMMatrixScaling((last - first) * voxelSize, (last - first) * voxelSize, (last - first) * voxelSize) *
+					 XMMatrixTranslation((first - centre) * voxelSize, (centre - last) * voxelSize, (first - centre) * voxelSize);
+
+	BrickOccupancy occupancy;
+	occupancy.AddMesh(cube, world);
+
+	// the shell of the 4^3 bricks around the box, the 2^3 bricks inside it are not touched
+	std::vector<UINT> expected;
+	for (UINT z = 16; z <= 19; z++)
+		for (UINT y = 16; y <= 19; y++)
+			for (UINT x = 16; x <= 19; x++)
+				if (x == 16 || x == 19 || y == 16 || y == 19 || z == 16 || z == 19)
+					expected.push_back(BrickOccupancy::PackBrick(x, y, z));
+	std::sort(expected.begin(), expected.end());
+
+	checker.Check(occupancy.NumOccupied() == 56, "the box must touch the 56 bricks of its shell");
+	checker.Check(occupancy.OccupiedBricks() == expected, "the box must touch exactly the bricks of its shell");
+	checker.Check(!occupancy.IsOccupied(17, 17, 17) && !occupancy.IsOccupied(18, 18, 18), "the bricks inside the box must stay empty");
+
+	std::vector<UINT> coarse;
+	for (UINT z = 8; z <= 9; z++)
+		for (UINT y = 8; y <= 9; y++)
+			for (UINT x = 8; x <= 9; x++)
+				coarse.push_back(BrickOccupancy::PackBrick(x, y, z));
+	checker.Check(occupancy.OccupiedBricks(1) == coarse, "level 1 must cover the level 0 bricks of the box");
+
+	// adding the same mesh again changes nothing
+	occupancy.AddMesh(cube, world);
+	checker.Check(occupancy.OccupiedBricks() == expected, "adding a mesh twice must not mark more bricks");
+
+	occupancy.Clear();
+	checker.Check(occupancy.NumOccupied() == 0, "a cleared occupancy must be empty");
+
+	return checker.Result();
+}
+
+// Checks the toroidal addressing and the scroll regions of the voxel clipmap.
+// Usage: YARendererChecks voxel-clipmap
+int CheckVoxelClipmap()
+{
+	Checker checker("Voxel clipmap");
+
+	const UINT resolution = 64;
+
+	// every voxel of the new window is either scrolled in exactly once or was already in the old one
+	auto checkScroll = [&](XMINT3 oldOrigin, XMINT3 newOrigin)
+	{
+		auto regions = VoxelClipmap::ScrollRegions(oldOrigin, newOrigin, resolution);
+		int res = resolution;
+		ClipmapRegion oldWindow = {oldOrigin, XMINT3(oldOrigin.x + res, oldOrigin.y + res, oldOrigin.z + res)};
+		ClipmapRegion newWindow = {newOrigin, XMINT3(newOrigin.x + res, newOrigin.y + res, newOrigin.z + res)};
+
+		UINT64 scrolled = 0;
+		for (size_t i = 0; i < regions.size(); i++)
+		{
+			scrolled += regions[i].Volume();
+			checker.Check(ClipmapRegion::Intersect(regions[i], newWindow).Volume() == regions[i].Volume(), "scroll regions must lie inside the new window");
+			checker.Check(ClipmapRegion::Intersect(regions[i], oldWindow).Empty(), "scroll regions must not cover the old window");
+			for (size_t j = i + 1; j < regions.size(); j++)
+				checker.Check(ClipmapRegion::Intersect(regions[i], regions[j]).Empty(), "scroll regions must be disjoint");
+		}
+
+		UINT64 kept = ClipmapRegion::Intersect(oldWindow, newWindow).Volume();
+		checker.Check(scrolled + kept == newWindow.Volume(), "scroll regions and the kept voxels must cover the new window");
+	};
+
+	checkScroll(XMINT3(0, 0, 0), XMINT3(0, 0, 0));
+	checkScroll(XMINT3(0, 0, 0), XMINT3(1, 0, 0));
+	checkScroll(XMINT3(0, 0, 0), XMINT3(-3, 5, -7));
+	checkScroll(XMINT3(-10, 20, 30), XMINT3(-12, 20, 41));
+	checkScroll(XMINT3(0, 0, 0), XMINT3(63, -63, 1));
+	checkScroll(XMINT3(0, 0, 0), XMINT3(64, 0, 0));
+	checkScroll(XMINT3(5, 5, 5), XMINT3(-500, 7, 5));
+
+	checker.Check(VoxelClipmap::ScrollRegions(XMINT3(0, 0, 0), XMINT3(0, 0, 0), resolution).empty(), "an unmoved window must not scroll anything");
+
+	// voxels one resolution apart share a texel, the window never holds both
+	VoxelClipmap clipmap(4, resolution, 0.2f);
+	XMUINT3 texel = clipmap.VoxelToTexel(XMINT3(-1, -64, -65));
+	checker.Check(texel.x == 63 && texel.y == 0 && texel.z == 63, "negative voxels must wrap around");
+	texel = clipmap.VoxelToTexel(XMINT3(130, 64, 0));
+	checker.Check(texel.x == 2 && texel.y == 0 && texel.z == 0, "positive voxels must wrap around");
+
+	XMINT3 voxel = clipmap.WorldToVoxel(0, XMVectorSet(-0.1f, 0.3f, 0.0f, 1.0f));
+	checker.Check(voxel.x == -1 && voxel.y == 1 && voxel.z == 0, "world positions must floor to voxels");
+
+	// the first update queues every window whole
+	clipmap.Update(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	for (UINT level = 0; level < clipmap.NumLevels(); level++)
+	{
+		auto regions = clipmap.TakeDirtyRegions(level);
+		checker.Check(regions.size() == 1 && regions[0].Volume() == clipmap.Window(level).Volume(), "the first update must queue the whole window");
+		checker.Check(clipmap.VoxelSize(level) == 0.2f * (1 << level), "every level must double the voxel size");
+		checker.Check(clipmap.TakeDirtyRegions(level).empty(), "taken regions must leave the queue");
+	}
+
+	// a move of one finest voxel only scrolls a single slab of the finest level
+	clipmap.Update(XMVectorSet(0.2f, 0.0f, 0.0f, 1.0f));
+	auto regions = clipmap.TakeDirtyRegions(0);
+	checker.Check(regions.size() == 1 && regions[0].Volume() == resolution * resolution, "a one voxel move must scroll one slab");
+	checker.Check(clipmap.TakeDirtyRegions(3).empty(), "a coarse level must not scroll before the camera crosses its voxel");
+
+	// regions queued before a later scroll are clipped to the current window
+	clipmap.MarkBounds(BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1000.0f, 1000.0f, 1000.0f)));
+	clipmap.Update(XMVectorSet(100.0f, 0.0f, 0.0f, 1.0f));
+	for (UINT level = 0; level < clipmap.NumLevels(); level++)
+	{
+		for (const auto &region : clipmap.TakeDirtyRegions(level))
+			checker.Check(ClipmapRegion::Intersect(region, clipmap.Window(level)).Volume() == region.Volume(), "taken regions must lie inside the window");
+	}
+
+	// the finest level containing a position with a border voxel is picked
+	XMVECTOR center = XMVectorSet(100.0f, 0.0f, 0.0f, 1.0f);
+	checker.Check(clipmap.LevelForPosition(center) == 0, "the camera position must use the finest level");
+	float halfExtent0 = clipmap.VoxelSize(0) * resolution * 0.5f;
+	checker.Check(clipmap.LevelForPosition(center + XMVectorSet(halfExtent0 * 1.5f, 0.0f, 0.0f, 0.0f)) == 1, "a position outside the finest level must use the next one");
+	checker.Check(clipmap.LevelForPosition(center + XMVectorSet(1.0e5f, 0.0f, 0.0f, 0.0f)) == clipmap.NumLevels(), "a position outside every level must be reported");
+
+	return checker.Result();
+}
+
+// Checks that the second bounce time slicing is deterministic and refreshes every brick once per cycle.
+// Usage: YARendererChecks voxel-schedule
+int CheckVoxelSchedule()
+{
+	Checker checker("Voxel schedule");
+
+	// a solid 10^3 block of bricks in pool order
+	std::vector<UINT> bricks;
+	for (UINT x = 0; x < 10; x++)
+		for (UINT y = 0; y < 10; y++)
+			for (UINT z = 0; z < 10; z++)
+				bricks.push_back(BrickOccupancy::PackBrick(x, y, z));
+	UINT numBricks = bricks.size();
+
+	checker.Check(VoxelUpdateSchedule::SliceCount(numBricks, 0.125f, UINT_MAX) == 8, "the fraction must set the slice count");
+	checker.Check(VoxelUpdateSchedule::SliceCount(numBricks, 1.0f, 100) == 10, "the budget must add slices");
+	checker.Check(VoxelUpdateSchedule::SliceCount(numBricks, 0.0f, UINT_MAX) == numBricks, "there must not be more slices than bricks");
+	checker.Check(VoxelUpdateSchedule::SliceCount(0, 0.5f, 1) == 1, "an empty scene must have one slice");
+
+	for (auto pattern : {VoxelSchedulePattern::Interleaved, VoxelSchedulePattern::Checkerboard})
+	{
+		for (UINT numSlices : {1, 2, 3, 8, 1000})
+		{
+			VoxelUpdateSchedule schedule;
+			schedule.Reset(bricks);
+			schedule.Configure(pattern, numSlices);
+			checker.Check(schedule.NumSlices() == numSlices, "the schedule must have the configured slices");
+
+			// every brick exactly once per cycle, starting at any frame
+			std::vector<UINT> refreshed(numBricks, 0);
+			UINT64 firstFrame = 12345;
+			for (UINT64 frame = firstFrame; frame < firstFrame + numSlices; frame++)
+				for (UINT slot : schedule.Slice(frame))
+					refreshed[slot]++;
+			checker.Check(std::all_of(refreshed.begin(), refreshed.end(), [](UINT n) { return n == 1; }), "a cycle must refresh every brick once");
+
+			// the same configuration always gives the same slices
+			VoxelUpdateSchedule other;
+			other.Configure(pattern, numSlices);
+			other.Reset(bricks);
+			for (UINT64 frame = 0; frame < numSlices; frame++)
+				checker.Check(schedule.Slice(frame) == other.Slice(frame), "the schedule must be deterministic");
+			checker.Check(schedule.Slice(3) == schedule.Slice(3 + numSlices), "the schedule must repeat every cycle");
+
+			if (pattern == VoxelSchedulePattern::Interleaved)
+			{
+				for (UINT i = 0; i < numSlices; i++)
+				{
+					size_t size = schedule.Slice(i).size();
+					checker.Check(size == numBricks / numSlices || size == (numBricks + numSlices - 1) / numSlices, "interleaved slices must be balanced");
+				}
+			}
+		}
+	}
+
+	// with two slices face neighbours are never refreshed in the same frame
+	VoxelUpdateSchedule checkerboard;
+	checkerboard.Reset(bricks);
+	checkerboard.Configure(VoxelSchedulePattern::Checkerboard, 2);
+	for (UINT slot : checkerboard.Slice(0))
+	{
+		XMUINT3 brick = BrickOccupancy::UnpackBrick(checkerboard.Brick(slot));
+		checker.Check((brick.x + brick.y + brick.z) % 2 == 0, "a checkerboard slice must not contain face neighbours");
+	}
+
+	return checker.Result();
+}
+
+// Checks the round-trip error and the overflow behaviour of the compact voxel record.
+// Usage: YARendererChecks voxel-packing
+int CheckVoxelPacking()
+{
+	Checker checker("Voxel packing");
+
+	// 9 bit mantissas round to half a unit of the largest component, 1 / 512 plus float rounding
+	const float radianceTolerance = 1.0f / 500.0f;
+	const float normalToleranceDegrees = 0.5f;
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	float maxRadianceError = 0.0f;
+	float maxNormalError = 0.0f;
+	for (int i = 0; i < 100000; i++)
+	{
+		// radiance spread over the exponent range
+		float scale = powf(2.0f, unit(random) * 30.0f - 14.0f);
+		XMFLOAT3 radiance(unit(random) * scale, unit(random) * scale, unit(random) * scale);
+		XMFLOAT3 decoded = VoxelPacking::UnpackRGB9E5(VoxelPacking::PackRGB9E5(radiance));
+
+		float maxComponent = std::max({radiance.x, radiance.y, radiance.z, 1.0e-4f});
+		float error = std::max({fabsf(decoded.x - radiance.x), fabsf(decoded.y - radiance.y), fabsf(decoded.z - radiance.z)});
+		maxRadianceError = std::max(maxRadianceError, error / maxComponent);
+
+		XMVECTOR normal = XMVector3Normalize(XMVectorSet(unit(random) * 2 - 1, unit(random) * 2 - 1, unit(random) * 2 - 1, 0.0f));
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, normal);
+		XMFLOAT3 decodedNormal = VoxelPacking::UnpackOctahedralNormal(VoxelPacking::PackOctahedralNormal(n));
+
+		float cosAngle = std::min(XMVectorGetX(XMVector3Dot(normal, XMLoadFloat3(&decodedNormal))), 1.0f);
+		maxNormalError = std::max(maxNormalError, XMConvertToDegrees(acosf(cosAngle)));
+	}
+
+	LOG_INFO("Voxel packing: max radiance error {:.5f} (tolerance {:.5f}), max normal error {:.3f} deg (tolerance {:.3f})",
+			 maxRadianceError, radianceTolerance, maxNormalError, normalToleranceDegrees);
+	checker.Check(maxRadianceError <= radianceTolerance, "the radiance round trip must stay within half a mantissa unit");
+	checker.Check(maxNormalError <= normalToleranceDegrees, "the normal round trip must stay within the tolerance");
+
+	// the axes and the octahedron folds survive exactly enough to keep their sign
+	for (XMFLOAT3 axis : {XMFLOAT3(1, 0, 0), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, -1, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, -1)})
+	{
+		XMFLOAT3 decoded = VoxelPacking::UnpackOctahedralNormal(VoxelPacking::PackOctahedralNormal(axis));
+		checker.Check(XMVectorGetX(XMVector3Dot(XMLoadFloat3(&axis), XMLoadFloat3(&decoded))) > 0.9999f, "axis normals must round trip");
+	}
+
+	// out of range radiance clamps instead of wrapping
+	XMFLOAT3 black = VoxelPacking::UnpackRGB9E5(VoxelPacking::PackRGB9E5(XMFLOAT3(0.0f, 0.0f, 0.0f)));
+	checker.Check(black.x == 0.0f && black.y == 0.0f && black.z == 0.0f, "black must round trip exactly");
+
+	XMFLOAT3 clamped = VoxelPacking::UnpackRGB9E5(VoxelPacking::PackRGB9E5(XMFLOAT3(1.0e9f, -5.0f, 70000.0f)));
+	checker.Check(clamped.x == VoxelPacking::MAX_RADIANCE && clamped.y == 0.0f && clamped.z == VoxelPacking::MAX_RADIANCE, "radiance must clamp to the representable range");
+
+	// the coverage saturates while the running average keeps converging
+	UINT64 packed = 0;
+	for (int i = 0; i < 10000; i++)
+		packed = VoxelPacking::Accumulate(packed, XMFLOAT3(i % 2 ? 2.0f : 4.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+
+	XMFLOAT3 radiance, normal;
+	UINT coverage;
+	VoxelPacking::UnpackVoxel(packed, radiance, normal, coverage);
+	checker.Check(coverage == VoxelPacking::MAX_COVERAGE, "the coverage must saturate");
+	checker.Check(fabsf(radiance.x - 3.0f) < 0.05f && fabsf(radiance.y - 1.0f) < 0.01f && radiance.z == 0.0f, "the saturated average must stay close to the mean");
+	checker.Check(normal.y > 0.999f, "the averaged normal must stay on the common normal");
+
+	// Many noisy fragments: once a fragment moves the average by less than the packing can hold it
+	// is rounded away, the average stops following and must still end close to the mean of all.
+	// The normals are also passed scaled by powers of two, which normalize to the same bits and
+	// must not change their weight.
+	const float driftTolerance = 0.05f;
+	const float driftNormalToleranceDegrees = 5.0f;
+
+	XMVECTOR baseNormal = XMVector3Normalize(XMVectorSet(0.3f, 0.5f, -0.8f, 0.0f));
+	packed = 0;
+	UINT64 packedUnit = 0;
+	XMVECTOR radianceSum = XMVectorZero();
+	XMVECTOR normalSum = XMVectorZero();
+	const int numFragments = 20000;
+	for (int i = 0; i < numFragments; i++)
+	{
+		XMFLOAT3 fragmentRadiance(1.0f + 2.0f * unit(random), 0.5f + unit(random), 0.1f + 0.2f * unit(random));
+		XMVECTOR jitter = XMVectorSet(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f, 0.0f) * 0.6f;
+		XMVECTOR fragmentNormal = XMVector3Normalize(baseNormal + jitter);
+		radianceSum += XMLoadFloat3(&fragmentRadiance);
+		normalSum += fragmentNormal;
+
+		XMFLOAT3 unitNormal, scaledNormal;
+		XMStoreFloat3(&unitNormal, fragmentNormal);
+		XMStoreFloat3(&scaledNormal, fragmentNormal * exp2f((float)(i % 5) - 2.0f));
+		packed = VoxelPacking::Accumulate(packed, fragmentRadiance, scaledNormal);
+		packedUnit = VoxelPacking::Accumulate(packedUnit, fragmentRadiance, unitNormal);
+	}
+	checker.Check(packed == packedUnit, "the length of a fragment normal must not change the average");
+
+	XMFLOAT3 meanRadiance;
+	XMStoreFloat3(&meanRadiance, radianceSum / (float)numFragments);
+	VoxelPacking::UnpackVoxel(packed, radiance, normal, coverage);
+
+	float radianceDrift = std::max({fabsf(radiance.x - meanRadiance.x), fabsf(radiance.y - meanRadiance.y), fabsf(radiance.z - meanRadiance.z)}) / meanRadiance.x;
+	float cosNormalDrift = std::min(XMVectorGetX(XMVector3Dot(XMVector3Normalize(normalSum), XMLoadFloat3(&normal))), 1.0f);
+	float normalDrift = XMConvertToDegrees(acosf(cosNormalDrift));
+
+	LOG_INFO("Voxel packing: drift after {} fragments {:.4f} of the radiance (tolerance {:.4f}), {:.3f} deg of the normal (tolerance {:.3f})",
+			 numFragments, radianceDrift, driftTolerance, normalDrift, driftNormalToleranceDegrees);
+	checker.Check(radianceDrift <= driftTolerance, "the average of many fragments must stay close to their mean radiance");
+	checker.Check(normalDrift <= driftNormalToleranceDegrees, "the average of many fragments must stay close to their mean normal");
+
+	// an empty record and the first fragment
+	VoxelPacking::UnpackVoxel(0, radiance, normal, coverage);
+	checker.Check(coverage == 0, "a cleared record must be empty");
+	packed = VoxelPacking::Accumulate(0, XMFLOAT3(1.0f, 0.5f, 0.25f), XMFLOAT3(0.0f, 0.0f, -1.0f));
+	VoxelPacking::UnpackVoxel(packed, radiance, normal, coverage);
+	checker.Check(coverage == 1 && radiance.x == 1.0f && radiance.y == 0.5f && radiance.z == 0.25f && normal.z < -0.999f, "the first fragment must be stored as is");
+
+	checker.Check(sizeof(Voxel) == (VOXEL_COMPACT_PACKING ? 8 : 16), "the voxel record must match the shader layout");
+
+	return checker.Result();
+}
+
+// Checks the SIMD triangle-voxel test of the CPU voxelizer against the scalar one, that the brick
+// occupancy holds every fragment, the lighting and shadowing of a plane and the bake round trip.
+// Usage: YARendererChecks cpu-voxelizer
+int CheckCpuVoxelizer()
+{
+	Checker checker("CPU voxelizer");
+
+	auto voxelOf = [](FXMVECTOR position)
+	{
+		XMFLOAT3 voxel;
+		XMStoreFloat3(&voxel, XMVectorFloor(WorldToVoxelSpace(position)));
+		return XMINT3((int)voxel.x, (int)voxel.y, (int)voxel.z);
+	};
+
+	// random triangles around the grid centre, world space
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+	std::uniform_real_distribution<float> offset(-0.8f, 0.8f);
+
+	std::vector<XMFLOAT3> triangles;
+	for (int i = 0; i < 3 * 2000; i++)
+	{
+		if (i % 3 == 0)
+			triangles.push_back(XMFLOAT3(position(random), position(random), position(random)));
+		else
+			triangles.push_back(XMFLOAT3(triangles[i - i % 3].x + offset(random), triangles[i - i % 3].y + offset(random), triangles[i - i % 3].z + offset(random)));
+	}
+
+	BrickOccupancy occupancy;
+	for (size_t i = 0; i < triangles.size(); i += 3)
+		occupancy.AddTriangle(WorldToVoxelSpace(XMLoadFloat3(&triangles[i])),
+							  WorldToVoxelSpace(XMLoadFloat3(&triangles[i + 1])),
+							  WorldToVoxelSpace(XMLoadFloat3(&triangles[i + 2])));
+
+	VoxelizerSettings unshadowed;
+	unshadowed.Shadows = false;
+
+	CpuVoxelizer voxelizer(occupancy, VoxelizerLight(), unshadowed);
+	for (size_t i = 0; i < triangles.size(); i += 3)
+		voxelizer.AddTriangle(XMLoadFloat3(&triangles[i]), XMLoadFloat3(&triangles[i + 1]), XMLoadFloat3(&triangles[i + 2]), XMFLOAT3(0.5f, 0.5f, 0.5f));
+
+	VoxelVolume volume = voxelizer.Finish();
+	checker.Check(volume.MissingFragments == 0, "the brick occupancy must hold every fragment");
+
+	// reference coverage of the scalar test, voxels within rounding distance of touching may go either way
+	const int first = VOXEL_DIMENSION / 2 - 25, last = VOXEL_DIMENSION / 2 + 25, size = last - first;
+	std::vector<bool> covered(size * size * size, false);
+	std::vector<bool> ambiguous(size * size * size, false);
+
+	for (size_t i = 0; i < triangles.size(); i += 3)
+	{
+		XMFLOAT3 triangle[3];
+		for (int k = 0; k < 3; k++)
+			XMStoreFloat3(&triangle[k], WorldToVoxelSpace(XMLoadFloat3(&triangles[i + k])));
+
+		XMINT3 minVoxel, maxVoxel;
+		XMStoreSInt3(&minVoxel, XMVectorMax(XMVectorFloor(XMVectorMin(XMVectorMin(XMLoadFloat3(&triangle[0]), XMLoadFloat3(&triangle[1])), XMLoadFloat3(&triangle[2]))) - g_XMOne, XMVectorReplicate((float)first)));
+		XMStoreSInt3(&maxVoxel, XMVectorMin(XMVectorFloor(XMVectorMax(XMVectorMax(XMLoadFloat3(&triangle[0]), XMLoadFloat3(&triangle[1])), XMLoadFloat3(&triangle[2]))) + g_XMOne, XMVectorReplicate((float)last - 1)));
+
+		for (int x = minVoxel.x; x <= maxVoxel.x; x++)
+			for (int y = minVoxel.y; y <= maxVoxel.y; y++)
+				for (int z = minVoxel.z; z <= maxVoxel.z; z++)
+				{
+					XMFLOAT3 center(x + 0.5f, y + 0.5f, z + 0.5f);
+					int index = ((x - first) * size + (y - first)) * size + (z - first);
+
+					if (TriangleBoxOverlap(center, 0.5f - 1.0e-3f, triangle))
+						covered[index] = true;
+					else if (TriangleBoxOverlap(center, 0.5f + 1.0e-3f, triangle))
+						ambiguous[index] = true;
+				}
+	}
+
+	UINT mismatches = 0;
+	for (int x = first; x < last; x++)
+		for (int y = first; y < last; y++)
+			for (int z = first; z < last; z++)
+			{
+				int index = ((x - first) * size + (y - first)) * size + (z - first);
+				bool solid = (volume.Voxel(x, y, z) >> 52) != 0;
+				if (solid != covered[index] && !(ambiguous[index] && !covered[index]))
+					mismatches++;
+			}
+
+	LOG_INFO("CPU voxelizer: {} solid voxels, {} mismatches with the scalar test", volume.NumSolidVoxels(), mismatches);
+	checker.Check(mismatches == 0, "the coverage must match the scalar separating axis test");
+
+	// a lit plane and a strip above it that shadows its middle, the sun shines straight down
+	std::vector<XMFLOAT3> quads;
+	auto addQuad = [&](float y, float x0, float x1, float z0, float z1)
+	{
+		// wound so the face normal points up
+		for (XMFLOAT3 p : {XMFLOAT3(x0, y, z0), XMFLOAT3(x0, y, z1), XMFLOAT3(x1, y, z0),
+						   XMFLOAT3(x1, y, z1), XMFLOAT3(x1, y, z0), XMFLOAT3(x0, y, z1)})
+			quads.push_back(p);
+	};
+	addQuad(1.05f, -2.0f, 2.0f, -2.0f, 2.0f);
+	addQuad(3.05f, -0.5f, 0.5f, -2.0f, 2.0f);
+
+	BrickOccupancy planeOccupancy;
+	for (size_t i = 0; i < quads.size(); i += 3)
+		planeOccupancy.AddTriangle(WorldToVoxelSpace(XMLoadFloat3(&quads[i])),
+								   WorldToVoxelSpace(XMLoadFloat3(&quads[i + 1])),
+								   WorldToVoxelSpace(XMLoadFloat3(&quads[i + 2])));
+
+	VoxelizerLight sun;
+	sun.Direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+	sun.Radiance = XMFLOAT3(2.0f, 2.0f, 2.0f);
+
+	VoxelVolume planes[2];
+	for (int shadows = 0; shadows < 2; shadows++)
+	{
+		VoxelizerSettings settings;
+		settings.Shadows = shadows;
+
+		CpuVoxelizer planeVoxelizer(planeOccupancy, sun, settings);
+		for (size_t i = 0; i < quads.size(); i += 3)
+			planeVoxelizer.AddTriangle(XMLoadFloat3(&quads[i]), XMLoadFloat3(&quads[i + 1]), XMLoadFloat3(&quads[i + 2]), XMFLOAT3(0.5f, 0.25f, 1.0f));
+		planes[shadows] = planeVoxelizer.Finish();
+	}
+
+	auto sample = [&](const VoxelVolume &plane, float x, float y, float z, XMFLOAT3 &radiance, XMFLOAT3 &normal)
+	{
+		XMINT3 voxel = voxelOf(XMVectorSet(x, y, z, 1.0f));
+		UINT coverage;
+		VoxelPacking::UnpackVoxel(plane.Voxel(voxel.x, voxel.y, voxel.z), radiance, normal, coverage);
+		return coverage;
+	};
+
+	auto isLit = [](const XMFLOAT3 &radiance)
+	{
+		return fabsf(radiance.x - 1.0f) < 0.01f && fabsf(radiance.y - 0.5f) < 0.01f && fabsf(radiance.z - 2.0f) < 0.01f;
+	};
+
+	XMFLOAT3 radiance, normal;
+	checker.Check(sample(planes[1], 1.5f, 1.05f, 0.5f, radiance, normal) > 0 && isLit(radiance) && normal.y > 0.999f, "a plane facing the sun must receive albedo times radiance");
+	checker.Check(sample(planes[1], 0.0f, 1.05f, 0.5f, radiance, normal) > 0 && radiance.x == 0.0f && radiance.y == 0.0f && radiance.z == 0.0f, "the strip must shadow the plane below it");
+	checker.Check(sample(planes[0], 0.0f, 1.05f, 0.5f, radiance, normal) > 0 && isLit(radiance), "without shadows the plane below the strip must be lit");
+	checker.Check(sample(planes[1], 0.0f, 3.05f, 0.5f, radiance, normal) > 0 && isLit(radiance), "the strip must not shadow itself");
+	checker.Check(sample(planes[1], 2.5f, 1.05f, 0.0f, radiance, normal) == 0, "voxels off the geometry must stay empty");
+
+	// the bake round trip and its key
+	std::string filename = (std::filesystem::temp_directory_path() / "yarenderer_check.voxels").string();
+	VoxelVolume loaded;
+	checker.Check(planes[1].Save(filename) && loaded.Load(filename), "the bake must be saved and loaded");
+	checker.Check(loaded.Bricks == planes[1].Bricks && loaded.Voxels == planes[1].Voxels, "the bake must round trip exactly");
+
+	std::error_code error;
+	std::filesystem::remove(filename, error);
+
+	checker.Check(CpuVoxelizer::CacheFilename({}, sun) == CpuVoxelizer::CacheFilename({}, sun), "the bake key must be deterministic");
+	checker.Check(CpuVoxelizer::CacheFilename({}, sun) != CpuVoxelizer::CacheFilename({}, VoxelizerLight()), "the bake key must depend on the sun");
+
+	return checker.Result();
+}
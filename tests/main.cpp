@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "Checks.h"
+
+struct Check
+{
+	const char *Name;
+	int (*Func)();
+};
+
+static const Check s_Checks[] = {
+	{"sh", CheckSHIrradiance},
+	{"ibl-cache", CheckIBLCache},
+	{"voxel-dirty", CheckVoxelDirtyRegions},
+	{"brick-occupancy", CheckBrickOccupancy},
+	{"voxel-clipmap", CheckVoxelClipmap},
+	{"voxel-schedule", CheckVoxelSchedule},
+	{"voxel-packing", CheckVoxelPacking},
+	{"cpu-voxelizer", CheckCpuVoxelizer},
+	{"cascade-fitting", CheckCascadeFitting},
+	{"shadow-cache", CheckShadowCache},
+	{"shadow-culling", CheckShadowCulling},
+	{"indirect-draw", CheckIndirectDraw},
+	{"gpu-memory", CheckGpuMemory},
+	{"frame-capture", CheckFrameCapture},
+	{"staging-ring", CheckStagingRing},
+	{"benchmark", CheckBenchmark},
+	{"frame-pacer", CheckFramePacer},
+	{"counters", CheckCounters},
+	{"init-graph", CheckInitGraph},
+	{"range-allocator", CheckRangeAllocator},
+#ifdef ENABLE_PROFILER
+	{"profiler", CheckProfiler},
+	{"gpu-timestamps", CheckGpuTimestamps},
+#endif
+};
+
+// Runs the named checks, or all of them without a name, and fails if any of them does. CTest runs
+// every check on its own, see tests/CMakeLists.txt.
+// Usage: YARendererChecks [check...]
+int main(int argc, char const *argv[])
+{
+	Log::Init();
+
+	std::vector<const Check *> checks;
+	for (int i = 1; i < argc; i++)
+	{
+		auto it = std::find_if(std::begin(s_Checks), std::end(s_Checks), [&](const Check &check) { return argv[i] == std::string(check.Name); });
+		if (it == std::end(s_Checks))
+		{
+			LOG_ERROR("Checks: unknown check {}", argv[i]);
+			return 1;
+		}
+		checks.push_back(&*it);
+	}
+
+	if (checks.empty())
+	{
+		for (const auto &check : s_Checks)
+			checks.push_back(&check);
+	}
+
+	int failed = 0;
+	for (const Check *check : checks)
+		failed += check->Func() == 0 ? 0 : 1;
+
+	if (checks.size() > 1)
+		LOG_INFO("Checks: {} of {} failed", failed, checks.size());
+	return failed == 0 ? 0 : 1;
+}
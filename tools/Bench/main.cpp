@@ -0,0 +1,247 @@
+#include "pch.h"
+#include "ShadowScene.h"
+#include "core/FramePacer.h"
+#include "core/FrameStats.h"
+#include "rendering/CascadeFitting.h"
+
+#include <spdlog/sinks/basic_file_sink.h>
+
+// Times fitting the cascades every frame of a camera flying over a random scene, batched and one
+// cascade after the other, and prints the cost per frame.
+// Usage: YARendererBench cascade-fitting [boxes]
+int BenchCascadeFitting(int numBoxes)
+{
+	std::mt19937 rng(3);
+	std::vector<BoundingBox> scene = RandomShadowScene(rng, numBoxes);
+	XMVECTOR lightDir = XMVector3Normalize(XMVectorSet(0.3f, -1.0f, 0.4f, 0.0f));
+
+	const int numFrames = 2000;
+	std::vector<Camera> cameras(numFrames);
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		float t = frame / (float)numFrames * MathHelper::Pi * 2.0f;
+		cameras[frame].SetLens(0.25f * MathHelper::Pi, 16.0f / 9.0f, 0.5f, 1000.0f);
+		cameras[frame].LookAt(XMFLOAT3(60.0f * cosf(t), 10.0f, 60.0f * sinf(t)), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f));
+		cameras[frame].UpdateViewMatrix();
+	}
+
+	CascadeFitSettings settings;
+	settings.MinDepth = 5.0f;
+	settings.MaxDepth = 80.0f;
+
+	// the checksum keeps the fits from being optimized away
+	float checksum = 0.0f;
+	auto time = [&](auto &&fitFrame)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			CascadeFit fit;
+			fitFrame(cameras[frame], fit);
+			checksum += fit.Radius[NUM_CASCADES - 1];
+		}
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		return (double)elapsed.count() / numFrames;
+	};
+
+	std::vector<BoundingBox> scratch;
+	double batched = time([&](const Camera &camera, CascadeFit &fit)
+						  { CascadeFitting::Fit(camera, lightDir, scene, settings, fit, scratch); });
+	double reference = time([&](const Camera &camera, CascadeFit &fit)
+							{ CascadeFitting::FitReference(camera, lightDir, scene, settings, fit); });
+
+	LOG_INFO("Cascade fitting with {} boxes over {} frames (checksum {})", scene.size(), numFrames, checksum);
+	LOG_INFO("  batched:   {:.0f} ns per frame", batched);
+	LOG_INFO("  reference: {:.0f} ns per frame", reference);
+	return 0;
+}
+
+// Logs from 8 threads at once into log_bench.txt, synchronously and through the async queue with
+// both overflow policies, and prints the time each call keeps its thread busy.
+// Usage: YARendererBench log [messages per thread]
+int BenchLog(int argc, char const *argv[])
+{
+	const int numThreads = 8;
+	const int numMessages = argc >= 3 ? std::stoi(argv[2]) : 20000;
+
+	auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>("log_bench.txt", true);
+
+	auto run = [&](const char *name, std::shared_ptr<spdlog::logger> logger, std::shared_ptr<spdlog::details::thread_pool> threadPool)
+	{
+		std::vector<std::vector<double>> latencies(numThreads);
+		std::atomic<int> ready = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([&, t]()
+								 {
+				latencies[t].reserve(numMessages);
+
+				// all threads start logging together
+				ready++;
+				while (ready < numThreads)
+					std::this_thread::yield();
+
+				for (int i = 0; i < numMessages; i++)
+				{
+					auto begin = std::chrono::steady_clock::now();
+					logger->info("thread {} message {} value {:.3f}", t, i, i * 0.5);
+					auto end = std::chrono::steady_clock::now();
+					latencies[t].push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+				} });
+		}
+		for (auto &thread : threads)
+			thread.join();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// the time the queue takes to drain is not part of the calls
+		logger->flush();
+
+		std::vector<double> samples;
+		for (auto &thread : latencies)
+			samples.insert(samples.end(), thread.begin(), thread.end());
+		FrameStats stats = FrameStats::Compute(std::move(samples));
+
+		LOG_INFO("  {}: mean {:.2f} us, p50 {:.2f} us, p99 {:.2f} us, max {:.1f} us, {:.0f} messages/s, {} dropped",
+				 name, stats.Mean, stats.P50, stats.P99, stats.Max, stats.Count / seconds, threadPool ? threadPool->overrun_counter() : 0);
+	};
+
+	LOG_INFO("Logging: {} threads, {} messages each", numThreads, numMessages);
+
+	run("sync       ", std::make_shared<spdlog::logger>("sync", sink), nullptr);
+
+	auto blockPool = std::make_shared<spdlog::details::thread_pool>(8192, 1);
+	run("async block", std::make_shared<spdlog::async_logger>("block", sink, blockPool, spdlog::async_overflow_policy::block), blockPool);
+
+	auto dropPool = std::make_shared<spdlog::details::thread_pool>(8192, 1);
+	run("async drop ", std::make_shared<spdlog::async_logger>("drop", sink, dropPool, spdlog::async_overflow_policy::overrun_oldest), dropPool);
+
+	return 0;
+}
+
+// Paces frames of random work on the system clock, with and without spinning the last part of
+// the wait, and prints how late the frames end and the time spent spinning.
+// Usage: YARendererBench frame-pacer [fps] [frames]
+int BenchFramePacer(double fps, int numFrames)
+{
+	auto run = [&](const char *name, bool spin)
+	{
+		Clock &clock = Clock::System();
+		FramePacer pacer(clock);
+		pacer.SetTargetFps(fps);
+		pacer.SetSpinEnabled(spin);
+
+		std::mt19937 rng(5);
+		std::uniform_real_distribution<double> work(0.1, 0.6);
+		const int64_t period = (int64_t)(1.0e9 / fps);
+
+		std::vector<double> errors;
+		double spinMs = 0.0;
+		pacer.Wait();
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			// busy like a frame that takes part of the period
+			int64_t end = clock.Now() + (int64_t)(work(rng) * period);
+			while (clock.Now() < end)
+				;
+
+			pacer.Wait();
+			spinMs += pacer.LastSpinMs();
+		}
+
+		FrameStats stats = pacer.DeadlineErrors();
+		LOG_INFO("  {}: p50 {:.0f} us, p95 {:.0f} us, p99 {:.0f} us, max {:.0f} us late, {:.2f} ms spun per frame, margin {:.2f} ms",
+				 name, stats.P50, stats.P95, stats.P99, stats.Max, spinMs / numFrames, pacer.SpinMarginMs());
+	};
+
+	LOG_INFO("Frame pacing: {} frames at {:.0f} fps, errors of the last {} frames", numFrames, fps, std::min<int>(numFrames, FramePacer::HISTORY_SIZE));
+	run("sleep      ", false);
+	run("sleep+spin ", true);
+	return 0;
+}
+
+#ifdef ENABLE_PROFILER
+// Times recording empty scopes, flat and nested, and gathering them at the frame boundary, and
+// warns if a scope costs more than 50 ns. The cost of a bare timestamp is printed for reference,
+// every scope takes two of them.
+// Usage: YARendererBench profiler
+int BenchProfiler()
+{
+	const int numFrames = 10000;
+	const int scopesPerFrame = 1000;
+
+	// gathering is timed on its own, it happens once per frame and not per scope
+	double gatherNs = 0.0;
+	auto time = [&](auto &&scopes)
+	{
+		double recordNs = 0.0;
+		gatherNs = 0.0;
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < scopesPerFrame; i++)
+				scopes();
+			auto recorded = std::chrono::steady_clock::now();
+			PROFILE_FRAME();
+			auto gathered = std::chrono::steady_clock::now();
+
+			recordNs += std::chrono::duration<double, std::nano>(recorded - start).count();
+			gatherNs += std::chrono::duration<double, std::nano>(gathered - recorded).count();
+		}
+		return recordNs / ((double)numFrames * scopesPerFrame);
+	};
+
+	// the checksum keeps the timestamps from being optimized away
+	int64_t checksum = 0;
+	double timestamp = time([&]()
+							{ checksum += Profiler::Now(); });
+
+	double flat = time([]()
+					   { PROFILE_SCOPE("Flat"); });
+	double flatGather = gatherNs / ((double)numFrames * scopesPerFrame);
+
+	double nested = time([]()
+						 {
+							 PROFILE_SCOPE("Outer");
+							 PROFILE_SCOPE("Inner"); }) / 2.0;
+
+	LOG_INFO("Profiler: {} frames of {} scopes (checksum {})", numFrames, scopesPerFrame, checksum & 1);
+	LOG_INFO("  timestamp: {:.1f} ns", timestamp);
+	LOG_INFO("  flat:      {:.1f} ns per scope", flat);
+	LOG_INFO("  nested:    {:.1f} ns per scope", nested);
+	LOG_INFO("  gather:    {:.1f} ns per scope", flatGather);
+
+	const double budget = 50.0;
+	if (flat > budget || nested > budget)
+		LOG_WARN("Profiler: a scope costs more than {:.0f} ns", budget);
+	return 0;
+}
+#endif
+
+// Micro benchmarks of engine parts that run on the CPU, they print their times and do not fail.
+// Usage: YARendererBench <bench> [arguments]
+int main(int argc, char const *argv[])
+{
+	Log::Init();
+
+	std::string bench = argc >= 2 ? argv[1] : "";
+
+	if (bench == "cascade-fitting" && argc <= 3)
+		return BenchCascadeFitting(argc == 3 ? std::stoi(argv[2]) : 1000);
+
+	if (bench == "log" && argc <= 3)
+		return BenchLog(argc, argv);
+
+	if (bench == "frame-pacer" && argc <= 4)
+		return BenchFramePacer(argc >= 3 ? std::stod(argv[2]) : 120.0, argc == 4 ? std::stoi(argv[3]) : 600);
+
+#ifdef ENABLE_PROFILER
+	if (bench == "profiler" && argc == 2)
+		return BenchProfiler();
+#endif
+
+	LOG_ERROR("Usage: YARendererBench cascade-fitting [boxes] | log [messages per thread] | frame-pacer [fps] [frames] | profiler");
+	return 1;
+}
@@ -0,0 +1,57 @@
+#include "pch.h"
+#include "rendering/IBLCache.h"
+
+// Fills the IBL cache with the CPU baker, no window or D3D12 device is created.
+// Usage: YARendererIBL bake <equirect.hdr>
+int BakeIBL(const std::string &filename)
+{
+	IBLBakeSettings settings;
+	std::string key = IBLCache::ComputeKey(filename, settings);
+
+	IBLProducts products = IBLBaker::Bake(*Image::FromFile(filename), settings);
+	return IBLCache::Save(key, products) ? 0 : 1;
+}
+
+// Compares two DDS files texel by texel, e.g. a cache entry baked on the GPU with the one of the
+// CPU baker, and fails if the layouts differ or any texel is off by more than the tolerance, 0.01
+// by default.
+// Usage: YARendererIBL compare <a.dds> <b.dds> [tolerance]
+int CompareDDS(const std::string &filenameA, const std::string &filenameB, float tolerance)
+{
+	TextureData a, b;
+	if (!DDS::Load(filenameA, a) || !DDS::Load(filenameB, b))
+	{
+		LOG_ERROR("IBL: cannot read {} or {}", filenameA, filenameB);
+		return 1;
+	}
+
+	TextureDifference difference = IBLBaker::Compare(a, b, tolerance);
+	if (!difference.SameLayout)
+	{
+		LOG_ERROR("IBL: {}x{}, {} slice(s), {} mip(s) do not match {}x{}, {} slice(s), {} mip(s)", a.Width, a.Height, a.ArraySize, a.Levels,
+				  b.Width, b.Height, b.ArraySize, b.Levels);
+		return 1;
+	}
+
+	LOG_INFO("IBL: {} texels, max error {:.5f}, mean error {:.6f}, {} over the tolerance of {}", difference.NumTexels, difference.MaxError,
+			 difference.MeanError, difference.NumOverTolerance, tolerance);
+	return difference.NumOverTolerance == 0 ? 0 : 1;
+}
+
+// Bakes the IBL products of an environment map on the CPU and compares baked textures.
+// Usage: YARendererIBL <command> [arguments]
+int main(int argc, char const *argv[])
+{
+	Log::Init();
+
+	std::string command = argc >= 2 ? argv[1] : "";
+
+	if (command == "bake" && argc == 3)
+		return BakeIBL(argv[2]);
+
+	if (command == "compare" && argc >= 4 && argc <= 5)
+		return CompareDDS(argv[2], argv[3], argc == 5 ? std::stof(argv[4]) : 0.01f);
+
+	LOG_ERROR("Usage: YARendererIBL bake <equirect.hdr> | compare <a.dds> <b.dds> [tolerance]");
+	return 1;
+}
@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "dx/FrameCapture.h"
+#include "rendering/Mesh.h"
+#include "rendering/VoxelBricks.h"
+#include "rendering/VoxelClipmap.h"
+
+// Logs the dense vs sparse voxel memory of both scenes from the CPU brick occupancy,
+// and the memory of the camera centred clipmap configurations.
+// Usage: YARendererReport voxels
+int VoxelReport()
+{
+	std::vector<std::pair<std::string, std::vector<std::string>>> scenes = {
+		{"test scene", {"resources/low_poly_winter_scene/scene.gltf"}},
+		{"sponza", {"resources/sponza/NewSponza_Main_glTF_002.gltf", "resources/sponza/NewSponza_Curtains_glTF.gltf"}},
+	};
+
+	for (auto &[name, filenames] : scenes)
+	{
+		BrickOccupancy occupancy;
+		for (auto &filename : filenames)
+			occupancy.AddMesh(*Mesh::FromFile(filename), XMMatrixIdentity());
+
+		VoxelMemoryReport::Estimate(occupancy).Log(name);
+	}
+
+	// the clipmap does not depend on the scene, compare it with the dense 256^3 grid
+	const float MB = 1024.0f * 1024.0f;
+	UINT64 denseBytes = VoxelMemoryReport::Estimate(BrickOccupancy()).DenseBytes();
+
+	for (UINT resolution : {64, 128})
+	{
+		VoxelClipmap clipmap(4, resolution, VOXEL_GRID_SIZE * 2.0f);
+		float extent = clipmap.VoxelSize(clipmap.NumLevels() - 1) * resolution;
+
+		LOG_INFO("Voxel clipmap: {} levels of {}^3, {:.1f} units wide: {:.2f} MB, {:.1f}% of the dense grid",
+				 clipmap.NumLevels(), resolution, extent, clipmap.MemoryBytes() / MB,
+				 100.0f * clipmap.MemoryBytes() / denseBytes);
+	}
+
+	return 0;
+}
+
+// Prints the statistics of a frame captured with the "Capture Frame" button, per pass: draws and
+// the primitives of the direct ones, dispatches, barriers and the calls that issued them, state
+// sets and how many of them changed nothing, and the bytes of root constants and constant buffers
+// bound. Needs no GPU.
+// Usage: YARendererReport capture <file>
+int AnalyzeCapture(const std::string &filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		LOG_ERROR("FrameCapture: cannot open {}", filename);
+		return 1;
+	}
+
+	FrameCapture capture;
+	std::string error;
+	if (!FrameCapture::Read(file, capture, error))
+	{
+		LOG_ERROR("FrameCapture: cannot read {}: {}", filename, error);
+		return 1;
+	}
+
+	LOG_INFO("FrameCapture: {} command(s), {} constant buffer(s) in {}", capture.Commands().size(), capture.Buffers().size(), filename);
+
+	std::ostringstream report;
+	FrameCapture::WriteReport(report, capture.Analyze());
+
+	std::istringstream lines(report.str());
+	for (std::string line; std::getline(lines, line);)
+		LOG_INFO("{}", line);
+	return 0;
+}
+
+// Reports on data the renderer uses or writes, without a window or a device.
+// Usage: YARendererReport <report> [arguments]
+int main(int argc, char const *argv[])
+{
+	Log::Init();
+
+	std::string report = argc >= 2 ? argv[1] : "";
+
+	if (report == "voxels" && argc == 2)
+		return VoxelReport();
+
+	if (report == "capture" && argc == 3)
+		return AnalyzeCapture(argv[2]);
+
+	LOG_ERROR("Usage: YARendererReport voxels | capture <file>");
+	return 1;
+}
@@ -0,0 +1,270 @@
+#include "ShaderCost.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+static bool StartsWith(const std::string &text, const std::string &prefix)
+{
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+static bool Contains(const std::string &text, const char *part)
+{
+    return text.find(part) != std::string::npos;
+}
+
+static std::string Trim(const std::string &text)
+{
+    size_t begin = text.find_first_not_of(" \t");
+    size_t end = text.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+// bytes of an alloca of an array, e.g. "alloca [16 x float], align 4"
+static int AllocaBytes(const std::string &line)
+{
+    size_t pos = line.find("alloca [");
+    if (pos == std::string::npos)
+        return 0;
+
+    std::istringstream in(line.substr(pos + 8));
+    int count = 0;
+    std::string x, type;
+    in >> count >> x >> type;
+
+    int size = 4;
+    if (StartsWith(type, "half") || StartsWith(type, "i16"))
+        size = 2;
+    else if (StartsWith(type, "double") || StartsWith(type, "i64"))
+        size = 8;
+    return count * size;
+}
+
+ShaderCost ShaderCostReport::Parse(const std::string &name, const std::string &disassembly)
+{
+    ShaderCost cost;
+    cost.Name = name;
+
+    enum class Section
+    {
+        None,
+        Buffers,
+        Bindings,
+        Function
+    } section = Section::None;
+
+    int lastSize = 0;
+    bool inCBuffer = false;
+
+    std::istringstream lines(disassembly);
+    for (std::string line; std::getline(lines, line);)
+    {
+        if (StartsWith(line, "; Buffer Definitions:"))
+        {
+            section = Section::Buffers;
+            continue;
+        }
+        if (StartsWith(line, "; Resource Bindings:"))
+        {
+            section = Section::Bindings;
+            continue;
+        }
+        if (StartsWith(line, "define "))
+        {
+            section = Section::Function;
+            continue;
+        }
+
+        if (section == Section::Buffers)
+        {
+            // the size of a constant buffer is the last one given before the brace that closes it
+            std::string text = Trim(line.substr(std::min<size_t>(1, line.size())));
+            if (StartsWith(text, "cbuffer "))
+            {
+                inCBuffer = true;
+                lastSize = 0;
+                cost.CBuffers++;
+            }
+            else if (inCBuffer && text == "}")
+            {
+                inCBuffer = false;
+                cost.CBufferBytes += lastSize;
+            }
+            else if (size_t pos = text.find("Size:"); inCBuffer && pos != std::string::npos)
+            {
+                lastSize = atoi(text.c_str() + pos + 5);
+            }
+            else if (!StartsWith(line, ";"))
+            {
+                section = Section::None;
+            }
+        }
+        else if (section == Section::Bindings)
+        {
+            // Name, Type, Format, Dim, ID, HLSL Bind, Count
+            std::istringstream row(line.substr(std::min<size_t>(1, line.size())));
+            std::string bindingName, type;
+            row >> bindingName >> type;
+
+            if (!StartsWith(line, ";"))
+                section = Section::None;
+            else if (type == "texture")
+                cost.Textures++;
+            else if (type == "sampler")
+                cost.Samplers++;
+            else if (type == "UAV")
+                cost.UAVs++;
+        }
+        else if (section == Section::Function)
+        {
+            std::string text = Trim(line);
+            if (text == "}")
+            {
+                section = Section::None;
+                continue;
+            }
+
+            // labels, comments and debug intrinsics are no instructions
+            if (text.empty() || text[0] == ';' || text.back() == ':' || Contains(text, "; preds =") ||
+                Contains(text, "@llvm.dbg."))
+                continue;
+
+            cost.Instructions++;
+            cost.Values += text[0] == '%' && Contains(text, " = ") ? 1 : 0;
+
+            if (Contains(text, "@dx.op.sample") || Contains(text, "@dx.op.textureGather"))
+                cost.Samples++;
+            else if (Contains(text, "@dx.op.textureLoad") || Contains(text, "@dx.op.bufferLoad") ||
+                     Contains(text, "@dx.op.rawBufferLoad"))
+                cost.Loads++;
+            else if (Contains(text, "@dx.op.cbufferLoad"))
+                cost.CBufferLoads++;
+
+            if (StartsWith(text, "br i1") || StartsWith(text, "switch "))
+                cost.Branches++;
+            if (Contains(text, "!llvm.loop"))
+                cost.Loops++;
+
+            cost.TempBytes += AllocaBytes(text);
+        }
+    }
+
+    return cost;
+}
+
+const std::vector<ShaderCostReport::Metric> &ShaderCostReport::Metrics()
+{
+    static const std::vector<Metric> metrics = {
+        {"instructions", &ShaderCost::Instructions},
+        {"samples", &ShaderCost::Samples},
+        {"loads", &ShaderCost::Loads},
+        {"cbufferLoads", &ShaderCost::CBufferLoads},
+        {"branches", &ShaderCost::Branches},
+        {"loops", &ShaderCost::Loops},
+        {"values", &ShaderCost::Values},
+        {"tempBytes", &ShaderCost::TempBytes},
+        {"cbuffers", &ShaderCost::CBuffers},
+        {"cbufferBytes", &ShaderCost::CBufferBytes},
+        {"textures", &ShaderCost::Textures},
+        {"samplers", &ShaderCost::Samplers},
+        {"uavs", &ShaderCost::UAVs},
+    };
+    return metrics;
+}
+
+void ShaderCostReport::WriteJson(std::ostream &out, const std::vector<ShaderCost> &costs)
+{
+    out << "{\n  \"shaders\": [";
+    for (size_t i = 0; i < costs.size(); i++)
+    {
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"name\": \"" << costs[i].Name << "\"";
+        for (const auto &metric : Metrics())
+            out << ", \"" << metric.Key << "\": " << costs[i].*metric.Value;
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// reads back what WriteJson wrote, an object per line
+bool ShaderCostReport::ReadJson(std::istream &in, std::vector<ShaderCost> &costs)
+{
+    costs.clear();
+
+    bool shaders = false;
+    for (std::string line; std::getline(in, line);)
+    {
+        if (Contains(line, "\"shaders\""))
+        {
+            shaders = true;
+            continue;
+        }
+
+        size_t pos = line.find("{\"name\": \"");
+        if (!shaders || pos == std::string::npos)
+            continue;
+
+        size_t begin = pos + 10;
+        size_t end = line.find('"', begin);
+        if (end == std::string::npos)
+            return false;
+
+        ShaderCost cost;
+        cost.Name = line.substr(begin, end - begin);
+        for (const auto &metric : Metrics())
+        {
+            size_t key = line.find("\"" + std::string(metric.Key) + "\":", end);
+            if (key != std::string::npos)
+                cost.*metric.Value = atoi(line.c_str() + line.find(':', key) + 1);
+        }
+        costs.push_back(cost);
+    }
+
+    return shaders;
+}
+
+std::vector<std::string> ShaderCostReport::Diff(const std::vector<ShaderCost> &current, const std::vector<ShaderCost> &previous)
+{
+    std::map<std::string, const ShaderCost *> before;
+    for (const auto &cost : previous)
+        before[cost.Name] = &cost;
+
+    std::vector<std::string> lines;
+    for (const auto &cost : current)
+    {
+        auto it = before.find(cost.Name);
+        if (it == before.end())
+        {
+            lines.push_back(cost.Name + ": new, " + std::to_string(cost.Instructions) + " instructions");
+            continue;
+        }
+
+        const ShaderCost &base = *it->second;
+        before.erase(it);
+
+        for (const auto &metric : Metrics())
+        {
+            int value = cost.*metric.Value, baseValue = base.*metric.Value;
+            if (value == baseValue)
+                continue;
+
+            std::ostringstream line;
+            line << cost.Name << ": " << metric.Key << " " << baseValue << " -> " << value << " (" << (value > baseValue ? "+" : "")
+                 << value - baseValue;
+            if (baseValue != 0)
+            {
+                line.precision(1);
+                line << ", " << (value > baseValue ? "+" : "") << std::fixed << 100.0 * (value - baseValue) / baseValue << "%";
+            }
+            line << ")";
+            lines.push_back(line.str());
+        }
+    }
+
+    for (const auto &[name, cost] : before)
+        lines.push_back(name + ": removed");
+
+    return lines;
+}
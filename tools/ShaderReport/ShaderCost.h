@@ -0,0 +1,50 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Static cost of one compiled entry point, read from its DXIL disassembly. DXIL is SSA and has no
+// registers, the SSA values and the indexable temp arrays stand in for register pressure. Loops that
+// were not unrolled count once, Loops tells how many of them there are.
+struct ShaderCost
+{
+    std::string Name; // file:entry, with the defines in brackets
+
+    int Instructions = 0;
+    int Samples = 0;      // sample* and gather* operations
+    int Loads = 0;        // texture, buffer and raw buffer loads
+    int CBufferLoads = 0; // 16 byte rows read from constant buffers
+    int Branches = 0;     // conditional branches and switches
+    int Loops = 0;
+    int Values = 0;    // SSA values defined
+    int TempBytes = 0; // indexable temp arrays
+
+    // from the resource bindings and buffer definitions DXC reflects into the disassembly
+    int CBuffers = 0;
+    int CBufferBytes = 0;
+    int Textures = 0;
+    int Samplers = 0;
+    int UAVs = 0;
+};
+
+class ShaderCostReport
+{
+public:
+    static ShaderCost Parse(const std::string &name, const std::string &disassembly);
+
+    // one shader per line, so the report diffs well in git
+    static void WriteJson(std::ostream &out, const std::vector<ShaderCost> &costs);
+    static bool ReadJson(std::istream &in, std::vector<ShaderCost> &costs);
+
+    // a line per metric that changed, per shader that was added or removed
+    static std::vector<std::string> Diff(const std::vector<ShaderCost> &current, const std::vector<ShaderCost> &previous);
+
+    struct Metric
+    {
+        const char *Key;
+        int ShaderCost::*Value;
+    };
+    static const std::vector<Metric> &Metrics();
+};
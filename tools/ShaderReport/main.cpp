@@ -0,0 +1,356 @@
+#include "ShaderCost.h"
+#include "dx/ShaderArguments.h"
+#include "dx/ShaderTable.h"
+
+#ifdef _WIN32
+#include <atlbase.h>
+#endif
+#include <dxcapi.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+static std::string Narrow(const std::wstring &text)
+{
+    return std::string(text.begin(), text.end());
+}
+
+static std::string EntryName(const ShaderEntry &shader)
+{
+    std::string name = Narrow(shader.File) + ":" + Narrow(shader.Entry);
+    for (size_t i = 0; i < shader.Defines.size(); i++)
+        name += (i == 0 ? "[" : ",") + shader.Defines[i].first + "=" + shader.Defines[i].second;
+    return shader.Defines.empty() ? name : name + "]";
+}
+
+class ShaderCompiler
+{
+public:
+    bool Init()
+    {
+        return SUCCEEDED(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&m_Utils))) &&
+               SUCCEEDED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&m_Compiler))) &&
+               SUCCEEDED(m_Utils->CreateDefaultIncludeHandler(&m_IncludeHandler));
+    }
+
+    // compiles as Utils::CompileShader does and disassembles the DXIL, reflection included
+    bool Disassemble(const ShaderEntry &shader, const std::string &directory, std::string &disassembly, std::string &error)
+    {
+        std::wstring filename = std::wstring(directory.begin(), directory.end()) + L"/" + shader.File;
+
+        CComPtr<IDxcBlobEncoding> source;
+        if (FAILED(m_Utils->LoadFile(filename.c_str(), nullptr, &source)))
+        {
+            error = "cannot read " + Narrow(filename);
+            return false;
+        }
+
+        std::vector<std::wstring> arguments = ShaderArguments(shader.Entry, shader.Target, shader.Defines);
+        std::vector<LPCWSTR> compilationArguments;
+        for (const auto &argument : arguments)
+            compilationArguments.push_back(argument.c_str());
+
+        DxcBuffer sourceBuffer = {source->GetBufferPointer(), source->GetBufferSize(), DXC_CP_ACP};
+        CComPtr<IDxcResult> result;
+        HRESULT status = E_FAIL;
+        if (FAILED(m_Compiler->Compile(&sourceBuffer, compilationArguments.data(), (UINT32)compilationArguments.size(),
+                                       m_IncludeHandler, IID_PPV_ARGS(&result))) ||
+            FAILED(result->GetStatus(&status)) || FAILED(status))
+        {
+            CComPtr<IDxcBlobUtf8> errors;
+            if (result)
+                result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr);
+            error = errors && errors->GetStringLength() ? errors->GetStringPointer() : "compilation failed";
+            return false;
+        }
+
+        CComPtr<IDxcBlob> object;
+        result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&object), nullptr);
+
+        DxcBuffer objectBuffer = {object->GetBufferPointer(), object->GetBufferSize(), 0};
+        CComPtr<IDxcResult> disassembled;
+        CComPtr<IDxcBlobUtf8> text;
+        if (FAILED(m_Compiler->Disassemble(&objectBuffer, IID_PPV_ARGS(&disassembled))) ||
+            FAILED(disassembled->GetOutput(DXC_OUT_DISASSEMBLY, IID_PPV_ARGS(&text), nullptr)) || !text)
+        {
+            error = "disassembly failed";
+            return false;
+        }
+
+        disassembly.assign(text->GetStringPointer(), text->GetStringLength());
+        return true;
+    }
+
+private:
+    CComPtr<IDxcUtils> m_Utils;
+    CComPtr<IDxcCompiler3> m_Compiler;
+    CComPtr<IDxcIncludeHandler> m_IncludeHandler;
+};
+
+static void PrintTable(std::vector<ShaderCost> costs)
+{
+    // the heaviest first
+    std::stable_sort(costs.begin(), costs.end(),
+                     [](const ShaderCost &a, const ShaderCost &b) { return a.Instructions > b.Instructions; });
+
+    printf("%-48s %8s %8s %6s %6s %6s %8s %6s %8s\n", "Shader", "Instrs", "Samples", "Loads", "Branch", "Loops",
+           "Values", "Temps", "CB bytes");
+    for (const auto &cost : costs)
+    {
+        printf("%-48s %8d %8d %6d %6d %6d %8d %6d %8d\n", cost.Name.c_str(), cost.Instructions, cost.Samples, cost.Loads,
+               cost.Branches, cost.Loops, cost.Values, cost.TempBytes, cost.CBufferBytes);
+    }
+}
+
+// Parses a disassembly in the format DXC prints and checks the numbers read from it, then that
+// the JSON reads back and that the diff reports changed, new and removed shaders.
+static int Check()
+{
+    int failures = 0;
+    auto check = [&](bool condition, const std::string &message)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "ShaderReport: %s\n", message.c_str());
+            failures++;
+        }
+    };
+
+    const char *disassembly = R"(;
+; Buffer Definitions:
+;
+; cbuffer PassCB
+; {
+;
+;   struct PassCB
+;   {
+;
+;       column_major float4x4 View;                   ; Offset:    0
+;       float3 EyePosW;                               ; Offset:   64
+;
+;   } PassCB;                                         ; Offset:    0 Size:    76
+;
+; }
+;
+; cbuffer LightCB
+; {
+;
+;   struct LightCB
+;   {
+;
+;       struct struct.Light
+;       {
+;
+;           float3 Direction;                         ; Offset:    0
+;
+;       } Lights[2];;                                 ; Offset:    0 Size:    28
+;
+;   } LightCB;                                        ; Offset:    0 Size:    28
+;
+; }
+;
+; Resource bind info for Voxels
+; {
+;
+;   uint $Element;                                    ; Offset:    0 Size:     4
+;
+; }
+;
+;
+; Resource Bindings:
+;
+; Name                                 Type  Format         Dim      ID      HLSL Bind  Count
+; ------------------------------ ---------- ------- ----------- ------- -------------- ------
+; PassCB                            cbuffer      NA          NA     CB0            cb0     1
+; LightCB                           cbuffer      NA          NA     CB1            cb1     1
+; LinearClamp                       sampler      NA          NA      S0             s0     1
+; ShadowMap                         texture     f32     2darray      T0             t0     1
+; Voxels                                UAV  struct         r/w      U0             u0     1
+;
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+
+define void @PS() {
+  %1 = alloca [16 x float], align 4
+  %2 = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %3, i32 0)
+  call void @llvm.dbg.value(metadata float %4, i64 0, metadata !12, metadata !13), !dbg !14
+  br label %5
+
+; <label>:5                                       ; preds = %5, %0
+  %6 = phi i32 [ 0, %0 ], [ %9, %5 ]
+  %7 = call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62, %dx.types.Handle %3, i32 0)
+  %8 = call %dx.types.ResRet.f32 @dx.op.textureGather.f32(i32 73, %dx.types.Handle %3, i32 0)
+  %9 = add nuw nsw i32 %6, 1
+  %10 = icmp eq i32 %9, 100
+  br i1 %10, label %11, label %5, !llvm.loop !15
+
+; <label>:11                                      ; preds = %5
+  %12 = call %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32(i32 139, %dx.types.Handle %3, i32 0)
+  call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float 1.0)
+  ret void
+}
+
+declare void @dx.op.storeOutput.f32(i32, i32, i32, i8, float) #0
+)";
+
+    ShaderCost cost = ShaderCostReport::Parse("test.hlsl:PS", disassembly);
+    check(cost.Instructions == 12, "counted " + std::to_string(cost.Instructions) + " instructions instead of 12");
+    check(cost.Values == 8, "counted " + std::to_string(cost.Values) + " values instead of 8");
+    check(cost.Samples == 2 && cost.Loads == 1 && cost.CBufferLoads == 1, "wrong sample and load counts");
+    check(cost.Branches == 1 && cost.Loops == 1, "wrong branch and loop counts");
+    check(cost.TempBytes == 64, "counted " + std::to_string(cost.TempBytes) + " temp bytes instead of 64");
+    check(cost.CBuffers == 2 && cost.CBufferBytes == 76 + 28, "counted " + std::to_string(cost.CBufferBytes) + " bytes of constant buffers");
+    check(cost.Textures == 1 && cost.Samplers == 1 && cost.UAVs == 1, "wrong resource bindings");
+
+    ShaderCost other;
+    other.Name = "other.hlsl:main";
+    other.Instructions = 40;
+
+    std::stringstream json;
+    ShaderCostReport::WriteJson(json, {cost, other});
+
+    std::vector<ShaderCost> read;
+    check(ShaderCostReport::ReadJson(json, read), "the JSON does not read back");
+    check(read.size() == 2 && read[0].Name == cost.Name && read[0].CBufferBytes == cost.CBufferBytes &&
+              read[0].UAVs == 1 && read[1].Instructions == 40,
+          "the JSON reads back differently");
+
+    ShaderCost heavier = cost;
+    heavier.Instructions = 15;
+    ShaderCost added;
+    added.Name = "added.hlsl:VS";
+
+    std::vector<std::string> diff = ShaderCostReport::Diff({heavier, added}, {cost, other});
+    check(diff.size() == 3, std::to_string(diff.size()) + " lines of diff instead of 3");
+    check(diff.size() == 3 && diff[0] == "test.hlsl:PS: instructions 12 -> 15 (+3, +25.0%)", "the diff is " + (diff.empty() ? "empty" : diff[0]));
+    check(diff.size() == 3 && diff[1] == "added.hlsl:VS: new, 0 instructions" && diff[2] == "other.hlsl:main: removed",
+          "the diff misses new or removed shaders");
+    check(ShaderCostReport::Diff({cost}, {cost}).empty(), "the diff of a report with itself is not empty");
+
+    printf("ShaderReport: %d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
+// The report as committed in HEAD, from git, so it is not the file being rewritten
+static bool ReadCommittedReport(const std::string &path, std::vector<ShaderCost> &costs)
+{
+#ifdef _WIN32
+    FILE *pipe = _popen(("git show HEAD:./" + path + " 2>nul").c_str(), "r");
+#else
+    FILE *pipe = popen(("git show HEAD:./" + path + " 2>/dev/null").c_str(), "r");
+#endif
+    if (!pipe)
+        return false;
+
+    std::string text;
+    char buffer[4096];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), pipe)) > 0;)
+        text.append(buffer, read);
+
+#ifdef _WIN32
+    bool shown = _pclose(pipe) == 0;
+#else
+    bool shown = pclose(pipe) == 0;
+#endif
+    std::istringstream json(text);
+    return shown && ShaderCostReport::ReadJson(json, costs);
+}
+
+// Compiles every entry point of the ShaderTable with DXC, writes their static costs to a JSON report
+// and prints what changed against a baseline: the given one, else shaders/shaderCosts.json as
+// committed in HEAD, read with git so that a report rewritten by an earlier run is never the
+// baseline. Run from the root of the repository.
+// Usage: ShaderReport [--shaders <dir>] [--out <report.json>] [--baseline <report.json>]
+//        ShaderReport --check
+int main(int argc, char const *argv[])
+{
+    std::string shaders = "shaders";
+    const std::string committed = "shaders/shaderCosts.json";
+    std::string out = committed;
+    std::string baseline;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--check" && argc == 2)
+            return Check();
+        else if (arg == "--shaders" && i + 1 < argc)
+            shaders = argv[++i];
+        else if (arg == "--out" && i + 1 < argc)
+            out = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baseline = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: ShaderReport [--shaders <dir>] [--out <report.json>] [--baseline <report.json>]\n"
+                            "       ShaderReport --check\n");
+            return 1;
+        }
+    }
+
+    // read before the report is written, --out may name the --baseline file
+    std::vector<ShaderCost> previous;
+    bool hasPrevious = false;
+    if (baseline.empty())
+    {
+        hasPrevious = ReadCommittedReport(committed, previous);
+    }
+    else
+    {
+        std::ifstream previousFile(baseline);
+        hasPrevious = previousFile && ShaderCostReport::ReadJson(previousFile, previous);
+    }
+
+    if (!hasPrevious)
+    {
+        fprintf(stderr, "\n"
+                        "ShaderReport: WARNING: no baseline, %s\n"
+                        "ShaderReport: WARNING: nothing is compared, commit %s or pass --baseline\n\n",
+                baseline.empty() ? ("HEAD holds no " + committed).c_str() : ("cannot read " + baseline).c_str(), committed.c_str());
+    }
+
+    ShaderCompiler compiler;
+    if (!compiler.Init())
+    {
+        fprintf(stderr, "ShaderReport: cannot create the DXC compiler\n");
+        return 1;
+    }
+
+    std::vector<ShaderCost> costs;
+    int errors = 0;
+    for (const ShaderEntry *shader : ShaderTable::All)
+    {
+        std::string name = EntryName(*shader);
+        std::string disassembly, error;
+        if (!compiler.Disassemble(*shader, shaders, disassembly, error))
+        {
+            fprintf(stderr, "ShaderReport: %s: %s\n", name.c_str(), error.c_str());
+            errors++;
+            continue;
+        }
+
+        costs.push_back(ShaderCostReport::Parse(name, disassembly));
+    }
+
+    PrintTable(costs);
+
+    std::ofstream file(out);
+    ShaderCostReport::WriteJson(file, costs);
+    if (!file)
+    {
+        fprintf(stderr, "ShaderReport: cannot write %s\n", out.c_str());
+        return 1;
+    }
+    printf("ShaderReport: wrote %zu shader(s) to %s\n", costs.size(), out.c_str());
+
+    if (hasPrevious)
+    {
+        std::vector<std::string> diff = ShaderCostReport::Diff(costs, previous);
+        printf("ShaderReport: %zu change(s) against %s\n", diff.size(), baseline.empty() ? ("HEAD:" + committed).c_str() : baseline.c_str());
+        for (const auto &line : diff)
+            printf("  %s\n", line.c_str());
+    }
+
+    return errors == 0 ? 0 : 1;
+}